@@ -0,0 +1,444 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  plArrayBench - Replays the list traffic of a plPageTreeMgr::Render frame
+//  (cull tree scratch, harvest, draw list sort, span sort and face sort) on
+//  a made up scene, once with the hsTArray/hsLargeArray lists those paths
+//  used to have and once with the hsFastArray ones they have now.
+//
+//  Each set runs warm, with the lists kept from frame to frame the way the
+//  static scratch lists are in the real thing, and cold, with new lists
+//  every frame like the locals in plCutter and plDynaDecalMgr. Reported per
+//  frame are the reallocations, the bytes shuffled into new blocks when
+//  a list grows, the bytes copied handing vis lists to the sorted draw list,
+//  and the time.
+//
+//  The scene comes from a fixed seed and each frame reseeds from its frame
+//  number, so both sets replay exactly the same frames.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "HeadSpin.h"
+#include "hsTemplates.h"
+#include "hsFastArray.h"
+#include "hsTimer.h"
+
+#include <vector>
+
+//// Stats ////////////////////////////////////////////////////////////////////
+
+struct plArrayStats
+{
+    double      fReallocs;
+    double      fBytesMoved;
+    double      fBytesCopied;
+    double      fSecs;
+
+    plArrayStats() : fReallocs(0), fBytesMoved(0), fBytesCopied(0), fSecs(0) {}
+};
+
+static plArrayStats gStats;
+
+static inline void INoteGrowth(uint32_t oldAlloc, uint32_t newAlloc, uint32_t count, uint32_t size)
+{
+    if( oldAlloc != newAlloc )
+    {
+        gStats.fReallocs++;
+        gStats.fBytesMoved += double(count) * size;
+    }
+}
+
+// Every list operation goes through these so both kinds of list are
+// measured the same way, by watching their allocation size.
+template <class A, class T>
+static inline void IAppend(A& a, const T& item)
+{
+    uint32_t alloc = a.GetNumAlloc();
+    uint32_t count = a.GetCount();
+    a.Append(item);
+    INoteGrowth(alloc, a.GetNumAlloc(), count, sizeof(T));
+}
+
+template <class A>
+static inline void ISetCount(A& a, uint32_t n, uint32_t size)
+{
+    uint32_t alloc = a.GetNumAlloc();
+    uint32_t count = a.GetCount();
+    a.SetCount(n);
+    INoteGrowth(alloc, a.GetNumAlloc(), count, size);
+}
+
+//// Scene ////////////////////////////////////////////////////////////////////
+
+static inline uint32_t IRand(uint32_t& seed)
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+struct plBenchDrawable
+{
+    uint16_t    fNumSpans;
+    bool        fSortSpans;
+    uint32_t    fNumTris;   // non-zero if it gets its faces sorted
+};
+
+struct plBenchScene
+{
+    std::vector<std::vector<plBenchDrawable> > fNodes;
+
+    void Make(uint32_t numNodes, uint32_t seed)
+    {
+        fNodes.resize(numNodes);
+        uint32_t i;
+        for( i = 0; i < numNodes; i++ )
+        {
+            fNodes[i].resize(4 + IRand(seed) % 60);
+            uint32_t j;
+            for( j = 0; j < fNodes[i].size(); j++ )
+            {
+                plBenchDrawable& d = fNodes[i][j];
+                d.fNumSpans = uint16_t(1 + IRand(seed) % 400);
+                d.fSortSpans = !(IRand(seed) % 8);
+                d.fNumTris = !(IRand(seed) % 40) ? 2000 + IRand(seed) % 60000 : 0;
+            }
+        }
+    }
+};
+
+// Same shape as plDrawVisList, copy included.
+class plBenchDrawVis
+{
+public:
+    plBenchDrawVis() : fDrawable(nil) {}
+    virtual ~plBenchDrawVis() {}
+
+    const plBenchDrawable*  fDrawable;
+    hsTArray<int16_t>       fVisList;
+
+    plBenchDrawVis& operator=(const plBenchDrawVis& v) { fDrawable = v.fDrawable; fVisList = v.fVisList; return *this; }
+};
+
+struct plBenchSortElem
+{
+    uint32_t    fKey;
+    void*       fBody;
+    void*       fNext;
+};
+
+struct plBenchSpanPair
+{
+    uint16_t    fDrawable;
+    uint16_t    fSpan;
+};
+
+//// List Sets ////////////////////////////////////////////////////////////////
+// The lists that didn't change (the harvest lists handed through plPipeline,
+// and the draw lists whose entries keep their vis lists between frames) are
+// the same in both.
+
+struct plBenchCommonLists
+{
+    hsTArray<int16_t>       fNodeList;
+    hsTArray<int16_t>       fVisSpans;
+    hsTArray<plBenchDrawVis> fLevList;
+    hsTArray<plBenchDrawVis> fSortedList;
+};
+
+struct plBenchOldLists : public plBenchCommonLists
+{
+    hsLargeArray<int16_t>           fClear;
+    hsLargeArray<int16_t>           fSplit;
+    hsLargeArray<int16_t>           fCulled;
+    hsTArray<plBenchSortElem>       fSortElems;
+    hsTArray<plBenchDrawVis*>       fDrawables;
+    hsTArray<plBenchSpanPair>       fPairs;
+    hsTArray<uint32_t>              fNumDrawn;
+    hsLargeArray<plBenchSortElem>   fFaceSort;
+    hsLargeArray<uint16_t>          fTriList;
+
+    static const char* Name() { return "hsTArray"; }
+
+    void SortAppend(plBenchDrawVis& drawVis)
+    {
+        gStats.fBytesCopied += drawVis.fVisList.GetCount() * sizeof(int16_t);
+        IAppend(fSortedList, drawVis);
+    }
+};
+
+struct plBenchNewLists : public plBenchCommonLists
+{
+    hsFastArray<int16_t>            fClear;
+    hsFastArray<int16_t>            fSplit;
+    hsFastArray<int16_t>            fCulled;
+    hsFastArray<plBenchSortElem>    fSortElems;
+    hsFastArray<plBenchDrawVis*>    fDrawables;
+    hsFastArray<plBenchSpanPair>    fPairs;
+    hsFastArray<uint32_t>           fNumDrawn;
+    hsFastArray<plBenchSortElem>    fFaceSort;
+    hsFastArray<uint16_t>           fTriList;
+
+    static const char* Name() { return "hsFastArray"; }
+
+    void SortAppend(plBenchDrawVis& drawVis)
+    {
+        uint32_t alloc = fSortedList.GetNumAlloc();
+        uint32_t count = fSortedList.GetCount();
+        plBenchDrawVis* sorted = fSortedList.Push();
+        INoteGrowth(alloc, fSortedList.GetNumAlloc(), count, sizeof(plBenchDrawVis));
+        sorted->fDrawable = drawVis.fDrawable;
+        sorted->fVisList.Swap(drawVis.fVisList);
+    }
+};
+
+//// Frame ////////////////////////////////////////////////////////////////////
+
+// Like plCullNode::ITestNode, each level pushes onto the shared scratch lists,
+// recurses, then pops back to where it started.
+template <class L>
+static void ICullNode(L& lists, uint32_t depth, uint32_t& seed)
+{
+    uint32_t clearStart = lists.fClear.GetCount();
+    uint32_t splitStart = lists.fSplit.GetCount();
+    uint32_t cullStart = lists.fCulled.GetCount();
+
+    uint32_t n = IRand(seed) % 48;
+    uint32_t i;
+    for( i = 0; i < n; i++ )
+    {
+        switch( IRand(seed) % 3 )
+        {
+        case 0: IAppend(lists.fClear, int16_t(i)); break;
+        case 1: IAppend(lists.fSplit, int16_t(i)); break;
+        default: IAppend(lists.fCulled, int16_t(i)); break;
+        }
+    }
+    if( depth )
+    {
+        ICullNode(lists, depth-1, seed);
+        ICullNode(lists, depth-1, seed);
+    }
+
+    ISetCount(lists.fClear, clearStart, sizeof(int16_t));
+    ISetCount(lists.fSplit, splitStart, sizeof(int16_t));
+    ISetCount(lists.fCulled, cullStart, sizeof(int16_t));
+}
+
+template <class L>
+static void IFrame(L& lists, const plBenchScene& scene, uint32_t frame)
+{
+    uint32_t seed = frame * 2654435761u + 1;
+
+    // Cull tree
+    ICullNode(lists, 7, seed);
+
+    // Harvest, then collect each visible node's drawables
+    lists.fNodeList.SetCount(0);
+    lists.fLevList.SetCount(0);
+    uint32_t i;
+    for( i = 0; i < scene.fNodes.size(); i++ )
+    {
+        if( IRand(seed) % 4 )
+            IAppend(lists.fNodeList, int16_t(i));
+    }
+    for( i = 0; i < lists.fNodeList.GetCount(); i++ )
+    {
+        const std::vector<plBenchDrawable>& node = scene.fNodes[lists.fNodeList[i]];
+        uint32_t j;
+        for( j = 0; j < node.size(); j++ )
+        {
+            if( !(IRand(seed) % 3) )
+                continue;
+
+            lists.fVisSpans.SetCount(0);
+            uint32_t k;
+            for( k = 0; k < node[j].fNumSpans; k++ )
+            {
+                if( IRand(seed) % 2 )
+                    IAppend(lists.fVisSpans, int16_t(k));
+            }
+            if( !lists.fVisSpans.GetCount() )
+                continue;
+
+            uint32_t alloc = lists.fLevList.GetNumAlloc();
+            uint32_t count = lists.fLevList.GetCount();
+            plBenchDrawVis* drawVis = lists.fLevList.Push();
+            INoteGrowth(alloc, lists.fLevList.GetNumAlloc(), count, sizeof(plBenchDrawVis));
+            drawVis->fDrawable = &node[j];
+            drawVis->fVisList.Swap(lists.fVisSpans);
+        }
+    }
+
+    // Sort by level, as in plPageTreeMgr::ISortByLevel
+    ISetCount(lists.fSortElems, lists.fLevList.GetCount(), sizeof(plBenchSortElem));
+    for( i = 0; i < lists.fLevList.GetCount(); i++ )
+    {
+        lists.fSortElems[i].fKey = IRand(seed);
+        lists.fSortElems[i].fBody = &lists.fLevList[i];
+    }
+    lists.fSortedList.SetCount(0);
+    for( i = 0; i < lists.fLevList.GetCount(); i++ )
+        lists.SortAppend(*(plBenchDrawVis*)lists.fSortElems[lists.fLevList.GetCount() - 1 - i].fBody);
+
+    // Span sorting and face sorting
+    for( i = 0; i < lists.fSortedList.GetCount(); i++ )
+    {
+        plBenchDrawVis& drawVis = lists.fSortedList[i];
+        if( drawVis.fDrawable->fSortSpans )
+        {
+            uint32_t j;
+            for( j = 0; j < drawVis.fVisList.GetCount(); j++ )
+            {
+                plBenchSpanPair pair;
+                pair.fDrawable = uint16_t(lists.fDrawables.GetCount());
+                pair.fSpan = drawVis.fVisList[j];
+                IAppend(lists.fPairs, pair);
+            }
+            IAppend(lists.fDrawables, &drawVis);
+
+            ISetCount(lists.fSortElems, lists.fPairs.GetCount(), sizeof(plBenchSortElem));
+            uint32_t alloc = lists.fNumDrawn.GetNumAlloc();
+            lists.fNumDrawn.SetCountAndZero(lists.fDrawables.GetCount());
+            INoteGrowth(alloc, lists.fNumDrawn.GetNumAlloc(), 0, sizeof(uint32_t));
+
+            lists.fDrawables.SetCount(0);
+            lists.fPairs.SetCount(0);
+        }
+        if( drawVis.fDrawable->fNumTris )
+        {
+            ISetCount(lists.fTriList, drawVis.fDrawable->fNumTris * 3, sizeof(uint16_t));
+            ISetCount(lists.fFaceSort, drawVis.fDrawable->fNumTris, sizeof(plBenchSortElem));
+        }
+    }
+}
+
+//// Runs /////////////////////////////////////////////////////////////////////
+
+template <class L>
+static plArrayStats IRunWarm(const plBenchScene& scene, uint32_t numFrames)
+{
+    gStats = plArrayStats();
+    L* lists = new L;
+
+    double start = hsTimer::GetSeconds();
+    uint32_t i;
+    for( i = 0; i < numFrames; i++ )
+        IFrame(*lists, scene, i);
+    gStats.fSecs = hsTimer::GetSeconds() - start;
+
+    delete lists;
+    return gStats;
+}
+
+template <class L>
+static plArrayStats IRunCold(const plBenchScene& scene, uint32_t numFrames)
+{
+    gStats = plArrayStats();
+
+    double start = hsTimer::GetSeconds();
+    uint32_t i;
+    for( i = 0; i < numFrames; i++ )
+    {
+        L* lists = new L;
+        IFrame(*lists, scene, i);
+        delete lists;
+    }
+    gStats.fSecs = hsTimer::GetSeconds() - start;
+
+    return gStats;
+}
+
+static void IPrintStats(const char* name, const char* run, const plArrayStats& stats, uint32_t numFrames)
+{
+    printf("%-12s %-5s %10.1f %12.1f %12.1f %10.3f\n", name, run,
+        stats.fReallocs / numFrames,
+        stats.fBytesMoved / numFrames / 1024.0,
+        stats.fBytesCopied / numFrames / 1024.0,
+        stats.fSecs * 1000.0 / numFrames);
+}
+
+template <class L>
+static void IRun(const plBenchScene& scene, uint32_t numFrames)
+{
+    IPrintStats(L::Name(), "warm", IRunWarm<L>(scene, numFrames), numFrames);
+    IPrintStats(L::Name(), "cold", IRunCold<L>(scene, numFrames), numFrames);
+}
+
+//// main ////////////////////////////////////////////////////////////////////
+
+int PrintHelp()
+{
+    puts("");
+    puts("Usage: plArrayBench [numFrames [numNodes [seed]]]");
+    puts("Where:");
+    puts("       numFrames is how many frames to replay (default 300)");
+    puts("       numNodes is how many scene nodes to make up (default 40)");
+    puts("       seed picks the scene (default 1)");
+    puts("");
+
+    return -1;
+}
+
+int main(int argc, char* argv[])
+{
+    if( (argc > 1) && ((argv[1][0] == '-') || (argv[1][0] == '/')) )
+        return PrintHelp();
+
+    uint32_t numFrames = argc > 1 ? atoi(argv[1]) : 300;
+    uint32_t numNodes = argc > 2 ? atoi(argv[2]) : 40;
+    uint32_t seed = argc > 3 ? atoi(argv[3]) : 1;
+    if( !numFrames || !numNodes || (numNodes > 0x7fff) )
+        return PrintHelp();
+
+    plBenchScene scene;
+    scene.Make(numNodes, seed);
+
+    printf("%u frames, %u nodes, seed %u\n\n", numFrames, numNodes, seed);
+    printf("%-12s %-5s %10s %12s %12s %10s\n", "lists", "run", "reallocs", "KB moved", "KB copied", "ms");
+
+    IRun<plBenchOldLists>(scene, numFrames);
+    IRun<plBenchNewLists>(scene, numFrames);
+
+    return 0;
+}
@@ -55,7 +55,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "pnMessage/plClientMsg.h"
 #include "pfCamera/plVirtualCamNeu.h"
 #include "hsTimer.h"
-#include "plPipeline/hsG3DDeviceSelector.h"
+#include "hsThread.h"
 #include "plFile/plEncryptedStream.h"
 #include "plFileUtils.h"
 #include "plInputCore/plInputManager.h"
@@ -93,11 +93,11 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plStatGather/plProfileManagerFull.h"
 
 #include "plPipeline.h"
-#include "plPipeline/plPipelineCreate.h"
 #include "plPipeline/plPipeDebugFlags.h"
 #include "plPipeline/plTransitionMgr.h"
 #include "plPipeline/plCaptureRender.h"
 #include "plPipeline/plDynamicEnvMap.h"
+#include "plNullPipeline/plNullPipeline.h"
 #include "plNetClient/plLinkEffectsMgr.h"
 #include "plAvatar/plAvatarClothing.h"
 #include "plAvatar/plArmatureMod.h"
@@ -143,6 +143,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "pfJournalBook/pfJournalBook.h"
 
 #include "plAvatar/plAGAnimInstance.h"
+#include "plAvatar/plAGMasterMod.h"
+#include "plDrawable/plMorphSequence.h"
 #include "plAgeLoader/plAgeLoader.h"
 
 #include "plQuality.h"
@@ -173,7 +175,9 @@ bool plClient::fDelayMS = false;
 
 plClient* plClient::fInstance=nil;
 
+#ifdef HS_BUILD_FOR_WIN32
 static hsTArray<HMODULE>        fLoadedDLLs;
+#endif
 
 plClient::plClient()
 : fPipeline(nil),
@@ -349,6 +353,7 @@ bool plClient::Shutdown()
     if (plSimulationMgr::GetInstance())
         plSimulationMgr::Shutdown();
     plAvatarMgr::ShutDown();
+    plMorphSequence::Shutdown();
     plRelevanceMgr::DeInit();
     
     if (fPageMgr)
@@ -485,77 +490,15 @@ void plClient::ISetGraphicsDefaults()
 bool plClient::InitPipeline()
 {
     hsStatusMessage("InitPipeline client\n");
-    HWND hWnd = fWindowHndl;
-    
-    hsG3DDeviceModeRecord dmr;
-    hsG3DDeviceSelector devSel;
-    devSel.Enumerate(hWnd);
-    devSel.RemoveUnusableDevModes(true);
-
-    if (!devSel.GetDefault(&dmr))
-    {
-        hsMessageBox("No suitable rendering devices found.","Plasma", hsMessageBoxNormal, hsMessageBoxIconError);
-        return true;
-    }
-
-    hsG3DDeviceRecord *rec = (hsG3DDeviceRecord *)dmr.GetDevice();
-    int res = -1;
 
-    if(!plPipeline::fInitialPipeParams.Windowed)
-    {
-        // find our resolution if we're not in windowed mode
-        for ( int i = 0; i < rec->GetModes().GetCount(); i++ )
-        {
-            hsG3DDeviceMode *mode = rec->GetMode(i);
-            if ((mode->GetWidth() == plPipeline::fInitialPipeParams.Width) &&
-                (mode->GetHeight() == plPipeline::fInitialPipeParams.Height) &&
-                (mode->GetColorDepth() == plPipeline::fInitialPipeParams.ColorDepth))
-            {
-                res = i;
-                break;
-            }
-        }
-        if(res != -1)
-        {
-            // found it set it as the current mode.
-            dmr = hsG3DDeviceModeRecord(*rec, *rec->GetMode(res));
-        }
-        else
-        {
-            ISetGraphicsDefaults();
-        }
-    }
-
-    if(plPipeline::fInitialPipeParams.TextureQuality == -1)
-    {
-        plPipeline::fInitialPipeParams.TextureQuality = dmr.GetDevice()->GetCap(hsG3DDeviceSelector::kCapsPixelShader) ? 2 : 1;
-    }
+    plPipeline *pipe = nil;
+    if( HasFlag(kFlagHeadless) )
+        pipe = new plNullPipeline( plPipeline::fInitialPipeParams.Width, plPipeline::fInitialPipeParams.Height );
     else
-    {
-        // clamp value to range
-        if(plPipeline::fInitialPipeParams.TextureQuality > 2) plPipeline::fInitialPipeParams.TextureQuality = 2;
-        if(plPipeline::fInitialPipeParams.TextureQuality < 0) plPipeline::fInitialPipeParams.TextureQuality = 0;
-        plBitmap::SetGlobalLevelChopCount(2 - plPipeline::fInitialPipeParams.TextureQuality);
-    }
+        pipe = ICreateDevicePipeline();
+    if( !pipe )
+        return true;
 
-    plPipeline *pipe = plPipelineCreate::CreatePipeline( hWnd, &dmr );
-    if( pipe->GetErrorString() != nil )
-    {
-        ISetGraphicsDefaults();
-#ifdef PLASMA_EXTERNAL_RELEASE
-        hsMessageBox("There was an error initializing the video card.\nSetting defaults.", "Error", hsMessageBoxNormal);
-#else
-        hsMessageBox( pipe->GetErrorString(), "Error creating pipeline", hsMessageBoxNormal );
-#endif
-        delete pipe;
-        devSel.GetDefault(&dmr);
-        pipe = plPipelineCreate::CreatePipeline( hWnd, &dmr );
-        if(pipe->GetErrorString() != nil)
-        {
-            // not much else we can do
-            return true;
-        }
-    }
     fPipeline = pipe;
 
     hsVector3 up;
@@ -1498,10 +1441,12 @@ bool plClient::StartInit()
 
     // the dx8 audio system MUST be initialized
     // before the database is loaded
-    HWND hWnd = fWindowHndl;
-    SetForegroundWindow(fWindowHndl);
+#ifdef HS_BUILD_FOR_WIN32
+    if( !HasFlag(kFlagHeadless) )
+        SetForegroundWindow(fWindowHndl);
+#endif
 
-    plgAudioSys::Init(hWnd);
+    plgAudioSys::Init(fWindowHndl);
     gAudio = plgAudioSys::Sys();
 
     RegisterAs( kClient_KEY );
@@ -1558,8 +1503,11 @@ bool plClient::StartInit()
     //commenting out publisher splash for MORE
     //IPlayIntroBink("avi/intro0.bik", delay, 0.f, 0.f, 1.f, 1.f, 0.75);
     //if( GetDone() ) return false;
-    IPlayIntroBink("avi/intro1.bik", 0.f, 0.f, 0.f, 1.f, 1.f, 0.75);
-    if( GetDone() ) return false;
+    if( !HasFlag(kFlagHeadless) )
+    {
+        IPlayIntroBink("avi/intro1.bik", 0.f, 0.f, 0.f, 1.f, 1.f, 0.75);
+        if( GetDone() ) return false;
+    }
     plgDispatch::Dispatch()->RegisterForExactType(plMovieMsg::Index(), GetKey());
 
     //
@@ -1637,6 +1585,7 @@ void    plClient::IPatchGlobalAgeFiles( void )
 
 void plClient::InitDLLs()
 {
+#ifdef HS_BUILD_FOR_WIN32
     hsStatusMessage("Init dlls client\n");
     char str[255];
     typedef void (*PInitGlobalsFunc) (hsResMgr *, plFactory *, plTimerCallbackManager *, plTimerShare*,
@@ -1655,10 +1604,12 @@ void plClient::InitDLLs()
             fLoadedDLLs.Append(hMod);
         }
     }
+#endif
 }
 
 void plClient::ShutdownDLLs()
 {
+#ifdef HS_BUILD_FOR_WIN32
     int j;
     for( j = 0; j < fLoadedDLLs.GetCount(); j++ )
     {
@@ -1667,6 +1618,7 @@ void plClient::ShutdownDLLs()
             hsStatusMessage("Failed to free lib\n");
     }
     fLoadedDLLs.Reset();
+#endif
 }
 
 bool plClient::MainLoop()
@@ -1696,7 +1648,7 @@ bool plClient::MainLoop()
 #endif
 
     if(plClient::fDelayMS)
-        Sleep(5);
+        hsSleep::Sleep(5);
     
     // Reset our stats
     plProfileManager::Instance().BeginFrame();
@@ -1790,8 +1742,10 @@ bool plClient::IUpdate()
     plProfile_EndTiming(TimeMsg);
 
     plProfile_BeginTiming(EvalMsg);
+    plAGMasterMod::BeginGraphBatch();
     plEvalMsg* eval = new plEvalMsg(nil, nil, nil, nil);
     plgDispatch::MsgSend(eval);
+    plAGMasterMod::EndGraphBatch();
     plProfile_EndTiming(EvalMsg);
 
     char *xFormLap1 = "Main";
@@ -1887,8 +1841,10 @@ bool plClient::IDraw()
     plProfile_EndTiming(VisEval);
 
     plProfile_BeginTiming(RenderMsg);
+    plMorphSequence::BeginMorphBatch();
     plRenderMsg* rendMsg = new plRenderMsg(fPipeline);
     plgDispatch::MsgSend(rendMsg);
+    plMorphSequence::EndMorphBatch();
     plProfile_EndTiming(RenderMsg);
 
     plPreResourceMsg* preMsg = new plPreResourceMsg(fPipeline);
@@ -2103,78 +2059,6 @@ void plClient::IAddRenderRequest(plRenderRequest* req)
     }
 }
 
-hsG3DDeviceModeRecord plClient::ILoadDevMode(const char* devModeFile)
-{
-    hsStatusMessage("Load DevMode client\n");
-    HWND hWnd = fWindowHndl;
-
-    hsUNIXStream    stream;
-    bool            gottaCreate = false;
-
-    // If DevModeFind is specified, use the old method
-//  if ((GetGameFlags() & kDevModeFind))
-//      FindAndSaveDevMode(hWnd, devModeFile);
-    // Otherwise, use the new method
-    hsG3DDeviceModeRecord dmr;
-    if (stream.Open(devModeFile, "rb"))
-    {
-        /// It's there, but is the device record valid?
-        hsG3DDeviceRecord selRec;
-        hsG3DDeviceMode selMode;
-
-        selRec.Read(&stream);
-        if( selRec.IsInvalid() )
-        {
-            hsStatusMessage( "WARNING: Old DeviceRecord found on file. Setting defaults..." );
-            gottaCreate = true;
-        }
-        else
-        {
-            /// Read the rest in
-            selMode.Read(&stream);
-
-            uint16_t performance = stream.ReadLE16();
-
-            if( performance < 25 )
-                plBitmap::SetGlobalLevelChopCount( 2 );
-            else if( performance < 75 )
-                plBitmap::SetGlobalLevelChopCount( 1 );
-            else
-                plBitmap::SetGlobalLevelChopCount( 0 );
-        }
-        stream.Close();
-
-        dmr = hsG3DDeviceModeRecord(selRec, selMode);
-    }
-    else
-        gottaCreate = true;
-
-    if( gottaCreate )
-    {
-
-        hsG3DDeviceSelector devSel;
-        devSel.Enumerate(hWnd);
-        devSel.RemoveUnusableDevModes(true);
-
-        if (!devSel.GetDefault(&dmr))
-        {
-            //hsAssert(0, "plGame::LoadDevMode - No acceptable hardware found");
-            hsMessageBox("No suitable rendering devices found.","realMYST",hsMessageBoxNormal);
-            return dmr;
-        }
-
-        if (stream.Open(devModeFile, "wb"))
-        {
-            dmr.GetDevice()->Write(&stream);
-            dmr.GetMode()->Write(&stream);
-            stream.WriteLE16((uint16_t)(0*100));
-            stream.Close();
-        }
-
-    }
-    return dmr;
-}
-
 void plClient::ResetDisplayDevice(int Width, int Height, int ColorDepth, bool Windowed, int NumAASamples, int MaxAnisotropicSamples, bool VSync)
 {
     if(!fPipeline) return;
@@ -2199,36 +2083,7 @@ void plClient::ResizeDisplayDevice(int Width, int Height, bool Windowed)
         pfGameGUIMgr::GetInstance()->SetAspectRatio( aspectratio );
 
 
-    uint32_t winStyle, winExStyle;
-    if( Windowed )
-    {
-        // WS_VISIBLE appears necessary to avoid leaving behind framebuffer junk when going from windowed to a smaller window
-        winStyle = WS_OVERLAPPEDWINDOW | WS_VISIBLE;
-        winExStyle = WS_EX_APPWINDOW | WS_EX_WINDOWEDGE;
-    } else {
-        winStyle = WS_POPUP;
-        winExStyle = WS_EX_APPWINDOW;
-    }
-    SetWindowLong(fWindowHndl, GWL_STYLE, winStyle);
-    SetWindowLong(fWindowHndl, GWL_EXSTYLE, winExStyle);
-
-
-    uint32_t flags = SWP_NOCOPYBITS | SWP_SHOWWINDOW | SWP_FRAMECHANGED;
-    uint32_t OutsideWidth, OutsideHeight;
-    HWND insertAfter;
-    if( Windowed )
-    {
-        RECT winRect = { 0, 0, Width, Height };
-        AdjustWindowRectEx(&winRect, winStyle, false, winExStyle);
-        OutsideWidth = winRect.right - winRect.left;
-        OutsideHeight = winRect.bottom - winRect.top;
-        insertAfter = HWND_NOTOPMOST;
-    } else {
-        OutsideWidth = Width;
-        OutsideHeight = Height;
-        insertAfter = HWND_TOP;
-    }
-    SetWindowPos( fWindowHndl, insertAfter, 0, 0, OutsideWidth, OutsideHeight, flags );
+    IResizeWindow(Width, Height, Windowed);
 }
 
 void WriteBool(hsStream *stream, char *name, bool on )
@@ -2255,90 +2110,7 @@ void WriteString(hsStream *stream, const char *name, const char *val)
 // Detect audio/video settings and save them to their respective ini file, if ini files don't exist
 void plClient::IDetectAudioVideoSettings()
 {
-    // Setup default pipeline settings
-    bool devmode = true;
-    hsG3DDeviceModeRecord dmr;
-    hsG3DDeviceSelector devSel;
-    devSel.Enumerate(fWindowHndl);
-    devSel.RemoveUnusableDevModes(true);
-
-    if (!devSel.GetDefault(&dmr))
-        devmode = false;
-    hsG3DDeviceRecord *rec = (hsG3DDeviceRecord *)dmr.GetDevice();
-    const hsG3DDeviceMode *mode = dmr.GetMode();
-
-    bool pixelshaders = rec->GetCap(hsG3DDeviceSelector::kCapsPixelShader);
-    int psMajor = 0, psMinor = 0;
-    rec->GetPixelShaderVersion(psMajor, psMinor);
-    bool refDevice = false;
-    if(rec->GetG3DHALorHEL() == hsG3DDeviceSelector::kHHD3DRefDev)
-        refDevice = true;
-
-    plPipeline::fDefaultPipeParams.ColorDepth = hsG3DDeviceSelector::kDefaultDepth;
-#if defined(HS_DEBUGGING) || defined(DEBUG)
-    plPipeline::fDefaultPipeParams.Windowed = true;
-#else
-    plPipeline::fDefaultPipeParams.Windowed = false;
-#endif
-
-    // Use current desktop resolution for fullscreen mode
-    if(!plPipeline::fDefaultPipeParams.Windowed)
-    {
-        plPipeline::fDefaultPipeParams.Width = GetSystemMetrics(SM_CXSCREEN);
-        plPipeline::fDefaultPipeParams.Height = GetSystemMetrics(SM_CYSCREEN);
-    }
-    else
-    {
-        plPipeline::fDefaultPipeParams.Width = hsG3DDeviceSelector::kDefaultWidth;
-        plPipeline::fDefaultPipeParams.Height = hsG3DDeviceSelector::kDefaultHeight;
-    }
-
-    plPipeline::fDefaultPipeParams.Shadows = 0;
-    // enable shadows if TnL is available, meaning not an intel extreme.
-    if(rec->GetG3DHALorHEL() == hsG3DDeviceSelector::kHHD3DTnLHalDev)
-        plPipeline::fDefaultPipeParams.Shadows = 1;
-
-    // enable planar reflections if pixelshaders are available
-    if(pixelshaders && !refDevice)
-    {
-    plPipeline::fDefaultPipeParams.PlanarReflections = 1;
-    }
-    else
-    {
-    plPipeline::fDefaultPipeParams.PlanarReflections = 0;
-    }
-
-    // enable 2x antialiasing and anisotropic to 2 samples if pixelshader version is greater that 2.0
-    if(psMajor >= 2 && !refDevice)
-    {
-        plPipeline::fDefaultPipeParams.AntiAliasingAmount = rec->GetMaxAnisotropicSamples() ? 2 : 0;
-        plPipeline::fDefaultPipeParams.AnisotropicLevel = mode->GetNumFSAATypes() ? 2 : 0;
-    }
-    else
-    {
-        plPipeline::fDefaultPipeParams.AntiAliasingAmount = 0;
-        plPipeline::fDefaultPipeParams.AnisotropicLevel = 0;
-    }
-
-    if(refDevice)
-    {
-        plPipeline::fDefaultPipeParams.TextureQuality = 0;
-        plPipeline::fDefaultPipeParams.VideoQuality = 0;
-
-    }
-    else
-    {
-        plPipeline::fDefaultPipeParams.TextureQuality = psMajor >= 2 ? 2 : 1;
-        plPipeline::fDefaultPipeParams.VideoQuality = pixelshaders ? 2 : 1;
-    }
-    plPipeline::fDefaultPipeParams.VSync = false;
-
-    // card specific overrides
-    if(rec->GetDriverDesc() && strstr(rec->GetDriverDesc(), "FX 5200"))
-    {
-        plPipeline::fDefaultPipeParams.AntiAliasingAmount = 0;
-    }
-
+    IDetectVideoSettings();
 
     int val = 0;
     hsStream *stream = nil;
@@ -2433,18 +2205,6 @@ void plClient::WindowActivate(bool active)
     fWindowActive = active;
 }
 
-void plClient::FlashWindow()
-{
-#ifdef HS_BUILD_FOR_WIN32
-    FLASHWINFO info;
-    info.cbSize = sizeof(info);
-    info.dwFlags = FLASHW_TIMERNOFG | FLASHW_ALL;
-    info.hwnd = fWindowHndl;
-    info.uCount = -1;
-    FlashWindowEx(&info);
-#endif
-}
-
 //============================================================================
 void plClient::IOnAsyncInitComplete () {
     // Init State Desc Language (files should now be downloaded and in place)
@@ -2457,7 +2217,9 @@ void plClient::IOnAsyncInitComplete () {
 
     // Load our custom fonts from our current dat directory
     fFontCache->LoadCustomFonts("dat");
+#ifdef HS_BUILD_FOR_WIN32
     plWinFontCache::GetInstance().LoadCustomFonts("dat");
+#endif
 
     // We'd like to do a SetHoldLoadRequests here, but the GUI stuff doesn't draw right
     // if you try to delay the loading for it.  To work around that, we allocate a
@@ -58,7 +58,6 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 class plSceneNode;
 class plPipeline;
-class hsG3DDeviceModeRecord;
 class plInputManager;
 class plInputController;
 class plSceneObject;
@@ -134,8 +133,6 @@ protected:
 
     pfGameGUIMgr            *fGameGUIMgr;
 
-    virtual hsG3DDeviceModeRecord ILoadDevMode(const char* devModeFile);
-
     bool                    IUpdate();
     bool                    IDraw();
     bool                    IDrawProgress();
@@ -213,6 +210,12 @@ protected:
     void IRoomLoaded(plSceneNode* node, bool hold);
     void IRoomUnloaded(plSceneNode* node);
     void ISetGraphicsDefaults();
+
+    // The window and the display device. plClientDevice.cpp has the Direct3D
+    // versions, plClientHeadless.cpp the ones for a client that has neither.
+    plPipeline* ICreateDevicePipeline();
+    void IDetectVideoSettings();
+    void IResizeWindow(int Width, int Height, bool Windowed);
     
 public:
 
@@ -253,6 +256,7 @@ public:
         kFlagDBGDisableRRequests,
         kFlagAsyncInitComplete,
         kFlagGlobalDataLoaded,
+        kFlagHeadless,          // No window or device, see plNullPipeline. Set before InitPipeline.
     };
 
     bool HasFlag(int f) const { return fFlags.IsBitSet(f); }
@@ -0,0 +1,267 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  plClientDevice - The parts of plClient that deal with the window and the
+//  Direct3D device: picking a device mode, creating the pipeline on it and
+//  sizing the window to match. plClient.cpp itself doesn't touch either, so
+//  a client that never has a window (see plClientHeadless.cpp) can be built
+//  without them.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "HeadSpin.h"
+#include "plClient.h"
+#include "plPipeline.h"
+#include "plPipeline/hsG3DDeviceSelector.h"
+#include "plPipeline/plPipelineCreate.h"
+#include "plGImage/plBitmap.h"
+
+plPipeline* plClient::ICreateDevicePipeline()
+{
+    HWND hWnd = fWindowHndl;
+    
+    hsG3DDeviceModeRecord dmr;
+    hsG3DDeviceSelector devSel;
+    devSel.Enumerate(hWnd);
+    devSel.RemoveUnusableDevModes(true);
+
+    if (!devSel.GetDefault(&dmr))
+    {
+        hsMessageBox("No suitable rendering devices found.","Plasma", hsMessageBoxNormal, hsMessageBoxIconError);
+        return nil;
+    }
+
+    hsG3DDeviceRecord *rec = (hsG3DDeviceRecord *)dmr.GetDevice();
+    int res = -1;
+
+    if(!plPipeline::fInitialPipeParams.Windowed)
+    {
+        // find our resolution if we're not in windowed mode
+        for ( int i = 0; i < rec->GetModes().GetCount(); i++ )
+        {
+            hsG3DDeviceMode *mode = rec->GetMode(i);
+            if ((mode->GetWidth() == plPipeline::fInitialPipeParams.Width) &&
+                (mode->GetHeight() == plPipeline::fInitialPipeParams.Height) &&
+                (mode->GetColorDepth() == plPipeline::fInitialPipeParams.ColorDepth))
+            {
+                res = i;
+                break;
+            }
+        }
+        if(res != -1)
+        {
+            // found it set it as the current mode.
+            dmr = hsG3DDeviceModeRecord(*rec, *rec->GetMode(res));
+        }
+        else
+        {
+            ISetGraphicsDefaults();
+        }
+    }
+
+    if(plPipeline::fInitialPipeParams.TextureQuality == -1)
+    {
+        plPipeline::fInitialPipeParams.TextureQuality = dmr.GetDevice()->GetCap(hsG3DDeviceSelector::kCapsPixelShader) ? 2 : 1;
+    }
+    else
+    {
+        // clamp value to range
+        if(plPipeline::fInitialPipeParams.TextureQuality > 2) plPipeline::fInitialPipeParams.TextureQuality = 2;
+        if(plPipeline::fInitialPipeParams.TextureQuality < 0) plPipeline::fInitialPipeParams.TextureQuality = 0;
+        plBitmap::SetGlobalLevelChopCount(2 - plPipeline::fInitialPipeParams.TextureQuality);
+    }
+
+    plPipeline *pipe = plPipelineCreate::CreatePipeline( hWnd, &dmr );
+    if( pipe->GetErrorString() != nil )
+    {
+        ISetGraphicsDefaults();
+#ifdef PLASMA_EXTERNAL_RELEASE
+        hsMessageBox("There was an error initializing the video card.\nSetting defaults.", "Error", hsMessageBoxNormal);
+#else
+        hsMessageBox( pipe->GetErrorString(), "Error creating pipeline", hsMessageBoxNormal );
+#endif
+        delete pipe;
+        devSel.GetDefault(&dmr);
+        pipe = plPipelineCreate::CreatePipeline( hWnd, &dmr );
+        if(pipe->GetErrorString() != nil)
+        {
+            // not much else we can do
+            return nil;
+        }
+    }
+
+    return pipe;
+}
+
+// Fill in the default pipeline settings from what the default device can do
+void plClient::IDetectVideoSettings()
+{
+    // Setup default pipeline settings
+    bool devmode = true;
+    hsG3DDeviceModeRecord dmr;
+    hsG3DDeviceSelector devSel;
+    devSel.Enumerate(fWindowHndl);
+    devSel.RemoveUnusableDevModes(true);
+
+    if (!devSel.GetDefault(&dmr))
+        devmode = false;
+    hsG3DDeviceRecord *rec = (hsG3DDeviceRecord *)dmr.GetDevice();
+    const hsG3DDeviceMode *mode = dmr.GetMode();
+
+    bool pixelshaders = rec->GetCap(hsG3DDeviceSelector::kCapsPixelShader);
+    int psMajor = 0, psMinor = 0;
+    rec->GetPixelShaderVersion(psMajor, psMinor);
+    bool refDevice = false;
+    if(rec->GetG3DHALorHEL() == hsG3DDeviceSelector::kHHD3DRefDev)
+        refDevice = true;
+
+    plPipeline::fDefaultPipeParams.ColorDepth = hsG3DDeviceSelector::kDefaultDepth;
+#if defined(HS_DEBUGGING) || defined(DEBUG)
+    plPipeline::fDefaultPipeParams.Windowed = true;
+#else
+    plPipeline::fDefaultPipeParams.Windowed = false;
+#endif
+
+    // Use current desktop resolution for fullscreen mode
+    if(!plPipeline::fDefaultPipeParams.Windowed)
+    {
+        plPipeline::fDefaultPipeParams.Width = GetSystemMetrics(SM_CXSCREEN);
+        plPipeline::fDefaultPipeParams.Height = GetSystemMetrics(SM_CYSCREEN);
+    }
+    else
+    {
+        plPipeline::fDefaultPipeParams.Width = hsG3DDeviceSelector::kDefaultWidth;
+        plPipeline::fDefaultPipeParams.Height = hsG3DDeviceSelector::kDefaultHeight;
+    }
+
+    plPipeline::fDefaultPipeParams.Shadows = 0;
+    // enable shadows if TnL is available, meaning not an intel extreme.
+    if(rec->GetG3DHALorHEL() == hsG3DDeviceSelector::kHHD3DTnLHalDev)
+        plPipeline::fDefaultPipeParams.Shadows = 1;
+
+    // enable planar reflections if pixelshaders are available
+    if(pixelshaders && !refDevice)
+    {
+    plPipeline::fDefaultPipeParams.PlanarReflections = 1;
+    }
+    else
+    {
+    plPipeline::fDefaultPipeParams.PlanarReflections = 0;
+    }
+
+    // enable 2x antialiasing and anisotropic to 2 samples if pixelshader version is greater that 2.0
+    if(psMajor >= 2 && !refDevice)
+    {
+        plPipeline::fDefaultPipeParams.AntiAliasingAmount = rec->GetMaxAnisotropicSamples() ? 2 : 0;
+        plPipeline::fDefaultPipeParams.AnisotropicLevel = mode->GetNumFSAATypes() ? 2 : 0;
+    }
+    else
+    {
+        plPipeline::fDefaultPipeParams.AntiAliasingAmount = 0;
+        plPipeline::fDefaultPipeParams.AnisotropicLevel = 0;
+    }
+
+    if(refDevice)
+    {
+        plPipeline::fDefaultPipeParams.TextureQuality = 0;
+        plPipeline::fDefaultPipeParams.VideoQuality = 0;
+
+    }
+    else
+    {
+        plPipeline::fDefaultPipeParams.TextureQuality = psMajor >= 2 ? 2 : 1;
+        plPipeline::fDefaultPipeParams.VideoQuality = pixelshaders ? 2 : 1;
+    }
+    plPipeline::fDefaultPipeParams.VSync = false;
+
+    // card specific overrides
+    if(rec->GetDriverDesc() && strstr(rec->GetDriverDesc(), "FX 5200"))
+    {
+        plPipeline::fDefaultPipeParams.AntiAliasingAmount = 0;
+    }
+}
+
+void plClient::IResizeWindow(int Width, int Height, bool Windowed)
+{
+    uint32_t winStyle, winExStyle;
+    if( Windowed )
+    {
+        // WS_VISIBLE appears necessary to avoid leaving behind framebuffer junk when going from windowed to a smaller window
+        winStyle = WS_OVERLAPPEDWINDOW | WS_VISIBLE;
+        winExStyle = WS_EX_APPWINDOW | WS_EX_WINDOWEDGE;
+    } else {
+        winStyle = WS_POPUP;
+        winExStyle = WS_EX_APPWINDOW;
+    }
+    SetWindowLong(fWindowHndl, GWL_STYLE, winStyle);
+    SetWindowLong(fWindowHndl, GWL_EXSTYLE, winExStyle);
+
+
+    uint32_t flags = SWP_NOCOPYBITS | SWP_SHOWWINDOW | SWP_FRAMECHANGED;
+    uint32_t OutsideWidth, OutsideHeight;
+    HWND insertAfter;
+    if( Windowed )
+    {
+        RECT winRect = { 0, 0, Width, Height };
+        AdjustWindowRectEx(&winRect, winStyle, false, winExStyle);
+        OutsideWidth = winRect.right - winRect.left;
+        OutsideHeight = winRect.bottom - winRect.top;
+        insertAfter = HWND_NOTOPMOST;
+    } else {
+        OutsideWidth = Width;
+        OutsideHeight = Height;
+        insertAfter = HWND_TOP;
+    }
+    SetWindowPos( fWindowHndl, insertAfter, 0, 0, OutsideWidth, OutsideHeight, flags );
+}
+
+void plClient::FlashWindow()
+{
+    FLASHWINFO info;
+    info.cbSize = sizeof(info);
+    info.dwFlags = FLASHW_TIMERNOFG | FLASHW_ALL;
+    info.hwnd = fWindowHndl;
+    info.uCount = -1;
+    FlashWindowEx(&info);
+}
@@ -0,0 +1,85 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  plClientHeadless - Stands in for plClientDevice.cpp in a client that never
+//  has a window or a display device, like plFrameBench. Nothing here needs
+//  Windows or Direct3D. Such a client has to set plClient::kFlagHeadless
+//  before InitPipeline, which then makes a plNullPipeline.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "HeadSpin.h"
+#include "plClient.h"
+#include "plPipeline.h"
+
+plPipeline* plClient::ICreateDevicePipeline()
+{
+    hsStatusMessage("No display device in this build, set kFlagHeadless\n");
+    return nil;
+}
+
+// What a TnL card with 2.0 pixel shaders gets from plClientDevice.cpp, so the
+// CPU side does the same work (shadows, reflections) it would on real hardware.
+void plClient::IDetectVideoSettings()
+{
+    plPipeline::fDefaultPipeParams.ColorDepth = 32;
+    plPipeline::fDefaultPipeParams.Windowed = true;
+    plPipeline::fDefaultPipeParams.Width = 800;
+    plPipeline::fDefaultPipeParams.Height = 600;
+    plPipeline::fDefaultPipeParams.Shadows = 1;
+    plPipeline::fDefaultPipeParams.PlanarReflections = 1;
+    plPipeline::fDefaultPipeParams.AntiAliasingAmount = 0;
+    plPipeline::fDefaultPipeParams.AnisotropicLevel = 0;
+    plPipeline::fDefaultPipeParams.TextureQuality = 2;
+    plPipeline::fDefaultPipeParams.VideoQuality = 2;
+    plPipeline::fDefaultPipeParams.VSync = false;
+}
+
+void plClient::IResizeWindow(int Width, int Height, bool Windowed)
+{
+}
+
+void plClient::FlashWindow()
+{
+}
@@ -1192,6 +1192,9 @@ LONG WINAPI plCustomUnhandledExceptionFilter( struct _EXCEPTION_POINTERS *Except
     // Before we do __ANYTHING__, pass the exception to plCrashHandler
     s_crash.ReportCrash(ExceptionInfo);
 
+    // Get whatever the logs still have queued onto the disk
+    plStatusLogMgr::GetInstance().Flush(true);
+
     // Now, try to create a nice exception dialog after plCrashHandler is done.
     s_crash.WaitForHandle();
     HWND parentHwnd = (gClient == nil) ? GetActiveWindow() : gClient->GetWindowHandle();
@@ -1397,6 +1400,9 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE hPrevInst, LPSTR lpCmdLine, int nC
     oldFilter = SetUnhandledExceptionFilter( plCustomUnhandledExceptionFilter );
 #endif
 
+    // Log files are written in the background from here on
+    plStatusLogMgr::GetInstance().StartWriter();
+
     //
     // Set up to log errors by using hsDebugMessage
     //
@@ -1517,6 +1523,9 @@ int WINAPI WinMain(HINSTANCE hInst, HINSTANCE hPrevInst, LPSTR lpCmdLine, int nC
     if (gDebugFile)
         fclose(gDebugFile);
 
+    // Write out what's queued and stop the writer thread before static teardown
+    plStatusLogMgr::GetInstance().StopWriter();
+
     // Uninstall our unhandled exception filter, if we installed one
 #ifndef HS_DEBUGGING
     SetUnhandledExceptionFilter( oldFilter );
@@ -0,0 +1,616 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  plFrameBench - Runs the client headless (plNullPipeline, no window, no
+//  device) through a fixed number of frames of an age, flying the camera
+//  along a scripted path, and dumps what the frames cost to a json file.
+//
+//  Sim time steps a fixed 1/30 sec per frame no matter how long a frame
+//  takes, so two runs over the same data see the same scene. Everything
+//  in the profile vars is reported, along with heap traffic and what the
+//  null pipeline would have drawn.
+//
+//  Camera path files are one waypoint per line, position then look at
+//  point, in world feet:
+//      x y z  atX atY atZ
+//  Blank lines and lines starting with # are skipped. The frames are spread
+//  evenly over the path.
+//
+//  With -occ the path is flown again once per plPipeline::OcclusionMode, and
+//  frame times, draw counts and the harvest and occlusion stats for each
+//  mode go in an "occlusion" array, so the cull tree and the occlusion
+//  buffer can be compared on the same frames.
+//
+//  This is the real plClient, built with plClientHeadless.cpp in place of
+//  the window and Direct3D code, so none of that is needed to build it.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "HeadSpin.h"
+#include "hsTimer.h"
+#include "hsMatrix44.h"
+#include "hsGeometry3.h"
+#include "plFileUtils.h"
+#include "plgDispatch.h"
+#include "plPipeline.h"
+#include "plProfileManager.h"
+
+#ifdef HS_BUILD_FOR_WIN32
+#include <shobjidl.h>
+#endif
+#include <algorithm>
+
+#include "plClient.h"
+#include "plClientResMgr/plClientResMgr.h"
+#include "plResMgr/plResManager.h"
+#include "plNetClientComm/plNetClientComm.h"
+#include "plNetClient/plNetClientMgr.h"
+#include "plNetClient/plNetLinkingMgr.h"
+#include "plAgeLoader/plAgeLoader.h"
+#include "plAvatar/plAvatarMgr.h"
+#include "plMessage/plRenderMsg.h"
+#include "pnMessage/plWarpMsg.h"
+#include "plNullPipeline/plNullPipeline.h"
+#include "plStatGather/plProfileManagerFull.h"
+#include "plPhysX/plSimulationMgr.h"
+#include "pfConsoleCore/pfConsoleEngine.h"
+
+PF_CONSOLE_LINK_ALL()
+
+//// Globals plClient expects from its winmain ///////////////////////////////
+
+plClient*       gClient = nil;
+#ifdef HS_BUILD_FOR_WIN32
+ITaskbarList3*  gTaskbarList = nil;
+#endif
+
+extern bool gDataServerLocal;
+
+//// Heap Traffic /////////////////////////////////////////////////////////////
+// Counted for the whole process, the bench just reads the deltas per frame.
+
+static long gNumAllocs = 0;
+static long gAllocBytes = 0;
+
+void* operator new(size_t size)
+{
+    AtomicAdd(&gNumAllocs, 1);
+    AtomicAdd(&gAllocBytes, (long)size);
+    void* p = malloc(size ? size : 1);
+    if (!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* p)
+{
+    free(p);
+}
+
+void operator delete[](void* p)
+{
+    free(p);
+}
+
+//// plFrameBenchClient ///////////////////////////////////////////////////////
+// The virtual camera would otherwise drag the view back to wherever it
+// thinks it should be during the update, so the path camera is put back in
+// just before the scene is drawn.
+
+class plFrameBenchClient : public plClient
+{
+protected:
+    bool        fCamValid;
+    hsMatrix44  fWorldToCam;
+    hsMatrix44  fCamToWorld;
+
+public:
+    plFrameBenchClient() : fCamValid(false) {}
+
+    void SetCamera(const hsPoint3& from, const hsPoint3& at)
+    {
+        hsVector3 up(0, 0, 1.f);
+        hsVector3 view(from - at);
+        view.Normalize();
+        up = (view % up) % view;
+
+        fWorldToCam.MakeCamera(&from, &at, &up);
+        fWorldToCam.GetInverse(&fCamToWorld);
+        fCamValid = true;
+
+        GetPipeline()->SetWorldToCamera(fWorldToCam, fCamToWorld);
+    }
+
+    virtual bool MsgReceive(plMessage* msg)
+    {
+        if (fCamValid && plRenderMsg::ConvertNoRef(msg))
+        {
+            GetPipeline()->SetWorldToCamera(fWorldToCam, fCamToWorld);
+            return true;
+        }
+        return plClient::MsgReceive(msg);
+    }
+};
+
+//// Camera Path //////////////////////////////////////////////////////////////
+
+struct plBenchWaypoint
+{
+    hsPoint3    fPos;
+    hsPoint3    fAt;
+};
+
+static bool ILoadCameraPath(const char* fileName, std::vector<plBenchWaypoint>& path)
+{
+    FILE* fp = fopen(fileName, "rt");
+    if (!fp)
+        return false;
+
+    char line[256];
+    while (fgets(line, sizeof(line), fp))
+    {
+        if (line[0] == '#')
+            continue;
+
+        plBenchWaypoint wp;
+        if (sscanf(line, "%f %f %f %f %f %f",
+                &wp.fPos.fX, &wp.fPos.fY, &wp.fPos.fZ,
+                &wp.fAt.fX, &wp.fAt.fY, &wp.fAt.fZ) == 6)
+            path.push_back(wp);
+    }
+    fclose(fp);
+
+    return !path.empty();
+}
+
+static void IEvalCameraPath(const std::vector<plBenchWaypoint>& path, float t, hsPoint3& pos, hsPoint3& at)
+{
+    if (path.size() == 1)
+    {
+        pos = path[0].fPos;
+        at = path[0].fAt;
+        return;
+    }
+
+    float seg = t * float(path.size() - 1);
+    int i = hsMinimum(int(seg), int(path.size()) - 2);
+    float frac = seg - float(i);
+
+    const plBenchWaypoint& a = path[i];
+    const plBenchWaypoint& b = path[i+1];
+    pos = a.fPos + (b.fPos - a.fPos) * frac;
+    at = a.fAt + (b.fAt - a.fAt) * frac;
+}
+
+//// Stats ////////////////////////////////////////////////////////////////////
+
+struct plBenchStat
+{
+    plProfileVar*   fVar;
+    double          fTotal;
+    float           fMax;
+};
+
+// One pass over the camera path.
+struct plBenchRun
+{
+    uint8_t                     fOccMode;
+    std::vector<float>          fFrameMS;
+    std::vector<plBenchStat>    fStats;
+    double                      fAllocs;
+    double                      fAllocBytes;
+    double                      fDrawCalls;
+    double                      fDrawTris;
+    double                      fMatChanges;
+};
+
+static const char* kOccModeNames[] = { "none", "cull tree", "occlusion buffer", "both" };
+
+// Average per frame of a profile var, by name. 0 if there's no such var.
+static double IStatAvg(const plBenchRun& run, const char* name)
+{
+    int i;
+    for (i = 0; i < run.fStats.size(); i++)
+    {
+        if (!strcmp(run.fStats[i].fVar->GetName(), name))
+            return run.fFrameMS.empty() ? 0 : run.fStats[i].fTotal / run.fFrameMS.size();
+    }
+    return 0;
+}
+
+// Sorts frameMS
+static void IWriteFrameMS(FILE* fp, std::vector<float>& frameMS)
+{
+    double totalMS = 0;
+    int i;
+    for (i = 0; i < frameMS.size(); i++)
+        totalMS += frameMS[i];
+    std::sort(frameMS.begin(), frameMS.end());
+
+    fprintf(fp, "\"frame_ms\": { \"avg\": %.3f, \"p50\": %.3f, \"p95\": %.3f, \"max\": %.3f }",
+        totalMS / frameMS.size(),
+        frameMS[frameMS.size() / 2],
+        frameMS[(frameMS.size() * 95) / 100],
+        frameMS.back());
+}
+
+static void IWriteJson(const char* fileName, const char* ageName, plBenchRun& run, std::vector<plBenchRun>& occRuns)
+{
+    FILE* fp = fopen(fileName, "wt");
+    if (!fp)
+    {
+        printf("Can't open %s for writing\n", fileName);
+        return;
+    }
+
+    uint32_t numFrames = run.fFrameMS.size();
+
+    fprintf(fp, "{\n");
+    fprintf(fp, "  \"age\": \"%s\",\n", ageName);
+    fprintf(fp, "  \"frames\": %u,\n", numFrames);
+    fprintf(fp, "  \"occlusion_mode\": \"%s\",\n", kOccModeNames[run.fOccMode]);
+    fprintf(fp, "  ");
+    IWriteFrameMS(fp, run.fFrameMS);
+    fprintf(fp, ",\n");
+    fprintf(fp, "  \"allocs_per_frame\": %.1f,\n", run.fAllocs / numFrames);
+    fprintf(fp, "  \"alloc_bytes_per_frame\": %.1f,\n", run.fAllocBytes / numFrames);
+    fprintf(fp, "  \"draw\": { \"calls\": %.1f, \"tris\": %.1f, \"material_changes\": %.1f },\n",
+        run.fDrawCalls / numFrames, run.fDrawTris / numFrames, run.fMatChanges / numFrames);
+
+    const std::vector<plBenchStat>& stats = run.fStats;
+
+    fprintf(fp, "  \"stats\": [\n");
+    int i;
+    for (i = 0; i < stats.size(); i++)
+    {
+        plProfileVar* var = stats[i].fVar;
+
+        const char* type = "count";
+        if (var->GetDisplayFlags() & plProfileBase::kDisplayTime)
+            type = "ms";
+        else if (var->GetDisplayFlags() & plProfileBase::kDisplayMem)
+            type = "bytes";
+
+        fprintf(fp, "    { \"group\": \"%s\", \"name\": \"%s\", \"type\": \"%s\", \"avg\": %.3f, \"max\": %.3f }%s\n",
+            var->GetGroup(), var->GetName(), type,
+            stats[i].fTotal / numFrames, stats[i].fMax,
+            (i + 1 < stats.size()) ? "," : "");
+    }
+    fprintf(fp, "  ]%s\n", occRuns.empty() ? "" : ",");
+
+    if (!occRuns.empty())
+    {
+        fprintf(fp, "  \"occlusion\": [\n");
+        for (i = 0; i < occRuns.size(); i++)
+        {
+            plBenchRun& occ = occRuns[i];
+            uint32_t n = occ.fFrameMS.size();
+
+            fprintf(fp, "    { \"mode\": \"%s\", \"frames\": %u, ", kOccModeNames[occ.fOccMode], n);
+            IWriteFrameMS(fp, occ.fFrameMS);
+            fprintf(fp, ",\n");
+            fprintf(fp, "      \"draw\": { \"calls\": %.1f, \"tris\": %.1f },\n",
+                occ.fDrawCalls / n, occ.fDrawTris / n);
+            fprintf(fp, "      \"harvest_ms\": %.3f, \"occluder_build_ms\": %.3f, \"occbuf_raster_ms\": %.3f, \"occbuf_test_ms\": %.3f,\n",
+                IStatAvg(occ, "Harvest"), IStatAvg(occ, "Occluder Build"),
+                IStatAvg(occ, "OccBuf Raster"), IStatAvg(occ, "OccBuf Test"));
+            fprintf(fp, "      \"occ_polys\": %.1f, \"cull_tree_nodes\": %.1f, \"occbuf_tested\": %.1f, \"occbuf_culled\": %.1f }%s\n",
+                IStatAvg(occ, "OccPoly"), IStatAvg(occ, "OccNode"),
+                IStatAvg(occ, "OccBuf Tested"), IStatAvg(occ, "OccBuf Culled"),
+                (i + 1 < occRuns.size()) ? "," : "");
+        }
+        fprintf(fp, "  ]\n");
+    }
+    fprintf(fp, "}\n");
+
+    fclose(fp);
+}
+
+//// IPump ////////////////////////////////////////////////////////////////////
+// Run frames until done() says so, or we give up.
+
+template <class T>
+static bool IPump(T done, uint32_t maxFrames)
+{
+    uint32_t i;
+    for (i = 0; i < maxFrames; i++)
+    {
+        if (done())
+            return true;
+        gClient->MainLoop();
+        if (gClient->GetDone())
+            return false;
+    }
+    return done();
+}
+
+static bool IInitDone()
+{
+    return gClient->HasFlag(plClient::kFlagAsyncInitComplete)
+        && gClient->HasFlag(plClient::kFlagGlobalDataLoaded);
+}
+
+static bool IAgeLoaded()
+{
+    return !plAgeLoader::GetInstance()->IsLoadingAge()
+        && plAgeLoader::GetInstance()->PendingPageIns().empty();
+}
+
+//// IRunPath ///////////////////////////////////////////////////////////////
+// Fly the path once in run.fOccMode. The first few frames sit at the start of
+// the path uncounted, so a mode switch or the jump back from the end of the
+// last pass doesn't land in the numbers.
+
+static void IRunPath(plFrameBenchClient* client, const std::vector<plBenchWaypoint>& path,
+                     uint32_t numFrames, const plKey& avatar, plBenchRun& run)
+{
+    plPipeline* pipe = gClient->GetPipeline();
+    pipe->SetOcclusionMode(run.fOccMode);
+
+    hsPoint3 pos, at;
+    IEvalCameraPath(path, 0, pos, at);
+    client->SetCamera(pos, at);
+
+    const uint32_t kSettleFrames = 5;
+    uint32_t i;
+    for (i = 0; i < kSettleFrames; i++)
+        gClient->MainLoop();
+
+    plProfileManager& profMgr = plProfileManager::Instance();
+
+    run.fStats.resize(profMgr.GetNumVars());
+    for (i = 0; i < run.fStats.size(); i++)
+    {
+        run.fStats[i].fVar = profMgr.GetVar(i);
+        run.fStats[i].fTotal = 0;
+        run.fStats[i].fMax = 0;
+    }
+
+    plNullPipeline* nullPipe = plNullPipeline::ConvertNoRef(pipe);
+
+    run.fFrameMS.clear();
+    run.fFrameMS.reserve(numFrames);
+    run.fAllocs = run.fAllocBytes = 0;
+    run.fDrawCalls = run.fDrawTris = run.fMatChanges = 0;
+
+    for (i = 0; i < numFrames; i++)
+    {
+        float t = numFrames > 1 ? float(i) / float(numFrames - 1) : 0;
+        IEvalCameraPath(path, t, pos, at);
+        client->SetCamera(pos, at);
+
+        if (avatar)
+        {
+            hsVector3 trans(pos.fX, pos.fY, pos.fZ);
+            hsMatrix44 l2w;
+            l2w.MakeTranslateMat(&trans);
+            plWarpMsg* warp = new plWarpMsg(nil, avatar, plWarpMsg::kFlushTransform | plWarpMsg::kZeroVelocity, l2w);
+            warp->Send();
+        }
+
+        long startAllocs = gNumAllocs;
+        long startBytes = gAllocBytes;
+        double startTime = hsTimer::GetSeconds();
+
+        gClient->MainLoop();
+
+        run.fFrameMS.push_back(float((hsTimer::GetSeconds() - startTime) * 1000.0));
+        run.fAllocs += gNumAllocs - startAllocs;
+        run.fAllocBytes += gAllocBytes - startBytes;
+
+        int j;
+        for (j = 0; j < run.fStats.size(); j++)
+        {
+            float val = run.fStats[j].fVar->GetValueFloat();
+            run.fStats[j].fTotal += val;
+            run.fStats[j].fMax = hsMaximum(run.fStats[j].fMax, val);
+        }
+
+        if (nullPipe)
+        {
+            run.fDrawCalls += nullPipe->GetDrawCalls().size();
+            run.fDrawTris += nullPipe->GetNumDrawTris();
+            run.fMatChanges += nullPipe->GetNumMaterialChanges();
+        }
+
+        if (gClient->GetDone())
+            break;
+    }
+}
+
+//// main ////////////////////////////////////////////////////////////////////
+
+int PrintHelp()
+{
+    puts("");
+    puts("Usage: plFrameBench [-occ] ageName numFrames cameraPath outFile [avatarName]");
+    puts("Where:");
+    puts("       -occ also flies the path once per occlusion mode and compares them");
+    puts("       ageName is the age to load, from the local dat directory");
+    puts("       numFrames is how many frames to measure");
+    puts("       cameraPath is a text file of waypoints (x y z atX atY atZ per line)");
+    puts("       outFile is where the json results are written");
+    puts("       avatarName (optional) loads that avatar and walks it along the path");
+    puts("");
+
+    return -1;
+}
+
+int main(int argc, char* argv[])
+{
+    bool compareOcc = false;
+    if (argc > 1 && !strcmp(argv[1], "-occ"))
+    {
+        compareOcc = true;
+        argc--;
+        argv++;
+    }
+
+    if (argc < 5)
+        return PrintHelp();
+
+    const char* ageName = argv[1];
+    uint32_t numFrames = atoi(argv[2]);
+    const char* pathFile = argv[3];
+    const char* outFile = argv[4];
+    const char* avatarName = argc > 5 ? argv[5] : nil;
+
+    if (!numFrames)
+        return PrintHelp();
+
+    std::vector<plBenchWaypoint> path;
+    if (!ILoadCameraPath(pathFile, path))
+    {
+        printf("No waypoints in %s\n", pathFile);
+        return -1;
+    }
+
+    PF_CONSOLE_INIT_ALL()
+
+    // Local data only, nothing gets patched or linked over the net.
+    gDataServerLocal = true;
+
+    plResManager* resMgr = new plResManager;
+    resMgr->SetDataPath("dat");
+    hsgResMgr::Init(resMgr);
+
+    if (plFileUtils::FileExists("resource.dat"))
+        plClientResMgr::Instance().ILoadResources("resource.dat");
+
+    NetCommStartup();
+
+    plFrameBenchClient* client = new plFrameBenchClient;
+    gClient = client;
+    gClient->SetFlag(plClient::kFlagHeadless);
+
+    plSimulationMgr::Init();
+    if (!plSimulationMgr::GetInstance())
+    {
+        puts("Couldn't start PhysX");
+        return -1;
+    }
+    plSimulationMgr::GetInstance()->Suspend();
+
+    if (gClient->InitPipeline() || !gClient->StartInit())
+    {
+        puts("Client init failed");
+        return -1;
+    }
+
+    // Fixed sim step, so a slow frame doesn't change what the next one sees.
+    hsTimer::SetRealTime(false);
+    hsTimer::SetFrameTimeInc(1.f / 30.f);
+
+    const uint32_t kMaxLoadFrames = 100000;
+    if (!IPump(IInitDone, kMaxLoadFrames))
+    {
+        puts("Client never finished init");
+        return -1;
+    }
+
+    plgDispatch::Dispatch()->RegisterForExactType(plRenderMsg::Index(), gClient->GetKey());
+
+    // We're loading the age ourselves, don't let the net client link us to StartUp.
+    plNetLinkingMgr::GetInstance()->SetEnabled(false);
+    if (!plAgeLoader::GetInstance()->LoadAge(ageName) || !IPump(IAgeLoaded, kMaxLoadFrames))
+    {
+        printf("Couldn't load age %s\n", ageName);
+        return -1;
+    }
+
+    plKey avatar;
+    if (avatarName)
+        avatar = plAvatarMgr::GetInstance()->LoadAvatar(avatarName, "FrameBench", false, nil, nil);
+
+    // Settle in, let the avatar finish loading and anything that pages in
+    // on the first frames do so before we start counting.
+    hsPoint3 pos, at;
+    IEvalCameraPath(path, 0, pos, at);
+    client->SetCamera(pos, at);
+
+    const uint32_t kWarmupFrames = 30;
+    uint32_t i;
+    for (i = 0; i < kWarmupFrames; i++)
+        gClient->MainLoop();
+
+    plProfileManagerFull::Instance().ActivateAllStats();
+
+    plBenchRun run;
+    run.fOccMode = gClient->GetPipeline()->GetOcclusionMode();
+    IRunPath(client, path, numFrames, avatar, run);
+
+    std::vector<plBenchRun> occRuns;
+    if (compareOcc && !gClient->GetDone())
+    {
+        occRuns.resize(plPipeline::kNumOcclusionModes);
+        for (i = 0; i < occRuns.size(); i++)
+        {
+            occRuns[i].fOccMode = i;
+            IRunPath(client, path, numFrames, avatar, occRuns[i]);
+            if (gClient->GetDone())
+            {
+                occRuns.resize(i + 1);
+                break;
+            }
+
+            printf("%-18s harvest %7.3f ms, %8.1f draws per frame\n", kOccModeNames[i],
+                IStatAvg(occRuns[i], "Harvest"), occRuns[i].fDrawCalls / occRuns[i].fFrameMS.size());
+        }
+        gClient->GetPipeline()->SetOcclusionMode(run.fOccMode);
+    }
+
+    IWriteJson(outFile, ageName, run, occRuns);
+
+    gClient->Shutdown();
+    gClient = nil;
+    hsgResMgr::Shutdown();
+    NetCommShutdown();
+
+    return 0;
+}
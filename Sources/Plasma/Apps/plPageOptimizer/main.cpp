@@ -48,15 +48,40 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plPageOptimizer.h"
 #include "../plFile/plFileUtils.h"
 
+static void PrintUsage()
+{
+    printf("Usage: plPageOptimizer [-trace readtimings.log] [-identical] page.prp [page.prp ...]\n");
+    printf("    -trace      Lay objects out in the order they were read in a Registry.LogReadTimes log\n");
+    printf("    -identical  List bitmaps that are byte-for-byte identical across the given pages (report only)\n");
+}
+
 int main(int argc, char* argv[])
 {
-    if (argc != 2)
+    const char* tracePath = nil;
+    bool reportIdentical = false;
+    std::vector<const char*> pages;
+
+    for (int i = 1; i < argc; i++)
     {
-        printf("plPageOptimizer: wrong number of arguments");
-        return 1;
+        if (strcmp(argv[i], "-trace") == 0 && i + 1 < argc)
+            tracePath = argv[++i];
+        else if (strcmp(argv[i], "-identical") == 0)
+            reportIdentical = true;
+        else if (argv[i][0] == '-')
+        {
+            PrintUsage();
+            return 1;
+        }
+        else
+            pages.push_back(argv[i]);
     }
 
-    printf("Optimizing %s...", plFileUtils::GetFileName(argv[1]));
+    if (pages.empty())
+    {
+        printf("plPageOptimizer: wrong number of arguments\n");
+        PrintUsage();
+        return 1;
+    }
 
     plFontCache* fontCache;
 #ifndef _DEBUG
@@ -78,20 +103,34 @@ int main(int argc, char* argv[])
     }
 #endif
 
+    plIdenticalBitmapReport bitmapReport;
+
+    for (int i = 0; i < pages.size(); i++)
+    {
+        printf("Optimizing %s...", plFileUtils::GetFileName(pages[i]));
+
 #ifndef _DEBUG
-    try
+        try
 #endif
-    {
-        plPageOptimizer optimizer(argv[1]);
-        optimizer.Optimize();
-    }
+        {
+            plPageOptimizer optimizer(pages[i]);
+            if (tracePath && !optimizer.ReadLoadTrace(tracePath))
+                printf("(couldn't read load trace %s) ", tracePath);
+            if (reportIdentical)
+                optimizer.SetBitmapReport(&bitmapReport);
+            optimizer.Optimize();
+        }
 #ifndef _DEBUG
-    catch (...)
-    {
-        printf(" ***crashed on optimizing");
-        return 2;
-    }
+        catch (...)
+        {
+            printf(" ***crashed on optimizing");
+            return 2;
+        }
 #endif
+    }
+
+    if (reportIdentical)
+        bitmapReport.Report();
 
 #ifndef _DEBUG
     try
@@ -51,14 +51,18 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "../pnKeyedObject/plKeyImp.h"
 
 #include "../plFile/plFileUtils.h"
+#include "../pnEncryption/plChecksum.h"
 #include "hsStream.h"
 
+#include <algorithm>
+
 plPageOptimizer* plPageOptimizer::fInstance = nil;
 
 plPageOptimizer::plPageOptimizer(const char* pagePath) :
     fOptimized(true),
     fPageNode(nil),
-    fPagePath(pagePath)
+    fPagePath(pagePath),
+    fBitmapReport(nil)
 {
     fInstance = this;
 
@@ -71,21 +75,128 @@ plPageOptimizer::plPageOptimizer(const char* pagePath) :
 
 void plPageOptimizer::IFindLoc()
 {
-    class plPageIt : public plRegistryPageIterator 
+    // We may be one of a batch of pages, so look ours up by path
+    plRegistryPageNode* pageNode = fResMgr->FindSinglePage(fPagePath);
+    if (pageNode)
+        fLoc = pageNode->GetPageInfo().GetLocation();
+}
+
+std::string plPageOptimizer::IMakeTraceName(const char* className, const char* objName)
+{
+    std::string name = className;
+    name += ':';
+    name += objName;
+    return name;
+}
+
+bool plPageOptimizer::ReadLoadTrace(const char* tracePath)
+{
+    hsUNIXStream trace;
+    if (!trace.Open(tracePath, "rt"))
+        return false;
+
+    // Each object line is "name, class, size, ms".  Names can have commas
+    // in them, so pick the line apart from the end.  Anything else (page
+    // timings, the header) won't parse and is skipped.
+    char line[1024];
+    while (trace.ReadLn(line, sizeof(line) - 1))
     {
-    public:
-        plLocation fLoc;
+        char* fields[3];
+        int numFields = 0;
+        char* end = line + strlen(line);
+        for (char* c = end - 1; c > line && numFields < 3; c--)
+        {
+            if (c[0] == ',' && c[1] == ' ')
+            {
+                *c = 0;
+                fields[numFields++] = c + 2;
+            }
+        }
+        if (numFields < 3)
+            continue;
+
+        // fields are in reverse: ms, size, class
+        std::string name = IMakeTraceName(fields[2], line);
+        if (fTraceRank.find(name) == fTraceRank.end())
+        {
+            uint32_t rank = (uint32_t)fTraceRank.size();
+            fTraceRank[name] = rank;
+        }
+    }
+
+    trace.Close();
+    return !fTraceRank.empty();
+}
+
+uint32_t plPageOptimizer::IGetTraceRank(const plKey& key) const
+{
+    const char* className = plFactory::GetNameOfClass(key->GetUoid().GetClassType());
+    TraceRankMap::const_iterator it = fTraceRank.find(IMakeTraceName(className, key->GetName().c_str()));
+    if (it == fTraceRank.end())
+        return uint32_t(-1);
+    return it->second;
+}
+
+void plPageOptimizer::ISortByTrace()
+{
+    if (fTraceRank.empty())
+        return;
 
-        virtual bool EatPage(plRegistryPageNode* keyNode)
+    // Stable, so anything the trace didn't see stays in the order our own
+    // load found it, after everything it did see.
+    class RankLess
+    {
+        const plPageOptimizer* fOpt;
+    public:
+        RankLess(const plPageOptimizer* opt) : fOpt(opt) {}
+        bool operator()(const plKey& a, const plKey& b) const
         {
-            fLoc = keyNode->GetPageInfo().GetLocation();
-            return true;
+            return fOpt->IGetTraceRank(a) < fOpt->IGetTraceRank(b);
         }
     };
+    std::stable_sort(fKeyLoadOrder.begin(), fKeyLoadOrder.end(), RankLess(this));
+}
+
+// Walk the objects in the order they'll be read, counting every time the
+// layout has to jump somewhere other than the next byte.
+void plPageOptimizer::ICountSeeks(const KeyVec& order, const SpanMap& spans, uint32_t& seeks, uint32_t& skipped) const
+{
+    seeks = 0;
+    skipped = 0;
+    uint32_t lastEnd = fPageNode->GetPageInfo().GetDataStart();
+    for (int i = 0; i < order.size(); i++)
+    {
+        SpanMap::const_iterator it = spans.find(order[i]);
+        if (it == spans.end())
+            continue;
 
-    plPageIt it;
-    fResMgr->IterateAllPages(&it);
-    fLoc = it.fLoc;
+        const Span& span = it->second;
+        if (span.fStartPos != lastEnd)
+        {
+            seeks++;
+            skipped += (span.fStartPos > lastEnd) ? span.fStartPos - lastEnd : lastEnd - span.fStartPos;
+        }
+        lastEnd = span.fStartPos + span.fLen;
+    }
+}
+
+void plPageOptimizer::IReportSeeks(const KeyVec& order) const
+{
+    uint32_t oldSeeks, oldSkipped;
+    uint32_t newSeeks, newSkipped;
+    ICountSeeks(order, fOldSpans, oldSeeks, oldSkipped);
+    ICountSeeks(order, fNewSpans, newSeeks, newSkipped);
+
+    uint32_t totalBytes = 0;
+    for (int i = 0; i < order.size(); i++)
+    {
+        SpanMap::const_iterator it = fNewSpans.find(order[i]);
+        if (it != fNewSpans.end())
+            totalBytes += it->second.fLen;
+    }
+
+    printf("seeks %u -> %u, bytes seeked over %u -> %u, %u bytes of objects...",
+        oldSeeks, newSeeks, oldSkipped, newSkipped, totalBytes);
 }
 
 void plPageOptimizer::Optimize()
@@ -159,6 +270,15 @@ void plPageOptimizer::Optimize()
         plFileUtils::RemoveFile(fTempPagePath);
         printf("failed.  File sizes different\n");
     }
+
+    // Let go of our keys so the page can be removed before the next one
+    fAllKeys.clear();
+    fKeyLoadOrder.clear();
+    fLoadedKeys.clear();
+    fOldSpans.clear();
+    fNewSpans.clear();
+    fPageNode = nil;
+    fResMgr->RemoveSinglePage(fPagePath);
 }
 
 void plPageOptimizer::KeyedObjectProc(plKey key)
@@ -197,6 +317,13 @@ void plPageOptimizer::IWriteKeyData(hsStream* oldPage, hsStream* newPage, plKey
     uint32_t startPos = keyImp->GetStartPos();
     uint32_t len = keyImp->GetDataLen();
 
+    Span& oldSpan = fOldSpans[key];
+    oldSpan.fStartPos = startPos;
+    oldSpan.fLen = len;
+
+    if (fBitmapReport)
+        fBitmapReport->AddObject(fPageNode->GetPageInfo().GetPage(), key, oldPage);
+
     oldPage->SetPosition(startPos);
     if (len > fBuf.size())
         fBuf.resize(len);
@@ -208,6 +335,10 @@ void plPageOptimizer::IWriteKeyData(hsStream* oldPage, hsStream* newPage, plKey
     if (newStartPos != startPos)
         fOptimized = false;
 
+    Span& newSpan = fNewSpans[key];
+    newSpan.fStartPos = newStartPos;
+    newSpan.fLen = len;
+
     keyImp->SetStartPos(newStartPos);
     newPage->Write(len, &fBuf[0]);
 }
@@ -230,9 +361,9 @@ void plPageOptimizer::IRewritePage()
         oldPage.Read(dataStart, &fBuf[0]);
         newPage.Write(dataStart, &fBuf[0]);
 
-        int size = (int)fKeyLoadOrder.size();
-        for (int i = 0; i < size; i++)
-            IWriteKeyData(&oldPage, &newPage, fKeyLoadOrder[i]);
+        ISortByTrace();
+
+        KeyVec writeOrder = fKeyLoadOrder;
 
         // If there are any objects that we didn't write (because they didn't load for
         // some reason), put them at the end
@@ -240,9 +371,16 @@ void plPageOptimizer::IRewritePage()
         {
             bool found = (fLoadedKeys.find(fAllKeys[i]) != fLoadedKeys.end());
             if (!found)
-                IWriteKeyData(&oldPage, &newPage, fAllKeys[i]);
+                writeOrder.push_back(fAllKeys[i]);
         }
 
+        int size = (int)writeOrder.size();
+        for (int i = 0; i < size; i++)
+            IWriteKeyData(&oldPage, &newPage, writeOrder[i]);
+
+        // Only the objects that actually load are read in order
+        IReportSeeks(fKeyLoadOrder);
+
         uint32_t newKeyStart = newPage.GetPosition();
         uint32_t oldKeyStart = pageInfo.GetIndexStart();
         oldPage.SetPosition(oldKeyStart);
@@ -283,3 +421,71 @@ void plPageOptimizer::IRewritePage()
         oldPage.Close();
     }
 }
+
+//////////////////////////////////////////////////////////////////////////////
+
+plIdenticalBitmapReport::plIdenticalBitmapReport()
+{
+    fBitmapClass = plFactory::FindClassIndex("plBitmap");
+}
+
+void plIdenticalBitmapReport::AddObject(const char* pageName, const plKey& key, hsStream* page)
+{
+    if (!plFactory::DerivesFrom(fBitmapClass, key->GetUoid().GetClassType()))
+        return;
+
+    plKeyImp* keyImp = (plKeyImp*)key;
+    uint32_t startPos = keyImp->GetStartPos();
+    uint32_t len = keyImp->GetDataLen();
+
+    // Skip the creatable index and the object's own key, which are
+    // different for every object and would hide any duplicates.
+    page->SetPosition(startPos);
+    page->ReadLE16();
+    if (page->ReadBool())
+    {
+        plUoid uoid;
+        uoid.Read(page);
+    }
+
+    uint32_t headerLen = page->GetPosition() - startPos;
+    if (headerLen >= len)
+        return;
+
+    uint32_t payloadLen = len - headerLen;
+    if (payloadLen > fBuf.size())
+        fBuf.resize(payloadLen);
+    page->Read(payloadLen, &fBuf[0]);
+
+    plMD5Checksum sum(payloadLen, &fBuf[0]);
+
+    Payload payload;
+    payload.fPage = pageName;
+    payload.fName = key->GetName().c_str();
+    payload.fLen = payloadLen;
+    fPayloads[sum.GetAsHexString()].push_back(payload);
+}
+
+void plIdenticalBitmapReport::Report() const
+{
+    uint32_t numSame = 0;
+    uint32_t bytesSaved = 0;
+
+    PayloadMap::const_iterator it;
+    for (it = fPayloads.begin(); it != fPayloads.end(); it++)
+    {
+        const PayloadVec& objs = it->second;
+        if (objs.size() < 2)
+            continue;
+
+        printf("%s (%u bytes) is identical to:\n", objs[0].fName.c_str(), objs[0].fLen);
+        for (int i = 1; i < objs.size(); i++)
+        {
+            printf("    %s in %s\n", objs[i].fName.c_str(), objs[i].fPage.c_str());
+            numSame++;
+            bytesSaved += objs[i].fLen;
+        }
+    }
+
+    printf("%u identical bitmaps, %u bytes if the exporter shared them (nothing was merged)\n", numSame, bytesSaved);
+}
@@ -46,21 +46,38 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "../pnKeyedObject/plUoid.h"
 #include <vector>
 #include <set>
+#include <map>
+#include <string>
 
 class plRegistryPageNode;
 class plResManager;
+class plIdenticalBitmapReport;
+class hsStream;
 
 class plPageOptimizer
 {
 protected:
     typedef std::vector<plKey> KeyVec;
     typedef std::set<plKey> KeySet;
+    typedef std::map<std::string, uint32_t> TraceRankMap;
+
+    struct Span
+    {
+        uint32_t fStartPos;
+        uint32_t fLen;
+    };
+    typedef std::map<plKey, Span> SpanMap;
 
     KeyVec fKeyLoadOrder;   // The order objects were loaded in
     KeySet fLoadedKeys;     // Keys we've loaded objects for, for quick lookup
     KeyVec fAllKeys;        // All the keys in the page
     std::vector<uint8_t> fBuf;
 
+    TraceRankMap fTraceRank;    // "class:name" -> order it was read in the load trace
+    SpanMap fOldSpans;          // Where each object's data was before we moved it
+    SpanMap fNewSpans;          // And where we wrote it
+    plIdenticalBitmapReport* fBitmapReport;
+
     bool fOptimized;        // True after optimization if the page was already optimized
 
     const char* fPagePath;          // Path to our page
@@ -73,6 +90,12 @@ protected:
     static plPageOptimizer* fInstance;
     static void KeyedObjectProc(plKey key);
 
+    static std::string IMakeTraceName(const char* className, const char* objName);
+    uint32_t IGetTraceRank(const plKey& key) const;
+    void ISortByTrace();
+    void ICountSeeks(const KeyVec& order, const SpanMap& spans, uint32_t& seeks, uint32_t& skipped) const;
+    void IReportSeeks(const KeyVec& order) const;
+
     void IWriteKeyData(hsStream* oldPage, hsStream* newPage, plKey key);
     void IFindLoc();
     void IRewritePage();
@@ -80,7 +103,44 @@ protected:
 public:
     plPageOptimizer(const char* pagePath);
 
+    // Read a load trace (readtimings.log from Registry.LogReadTimes) and
+    // lay objects out in the order the client actually read them, rather
+    // than the order loading the scene node by itself pulls them in.
+    bool ReadLoadTrace(const char* tracePath);
+
+    // Hand every object in the page to report as we copy it
+    void SetBitmapReport(plIdenticalBitmapReport* report) { fBitmapReport = report; }
+
     void Optimize();
 };
 
+// Lists byte-identical bitmap payloads across all the pages it's shown.
+// Each object's data, minus the creatable index and self key it starts
+// with, is hashed. This is a report only and nothing is merged: every
+// object reads its own key back out of its data, so two keys can't share
+// one copy, and moving one into a shared page means rewriting every
+// reference to it, which is a job for the exporter, not a post-process.
+class plIdenticalBitmapReport
+{
+protected:
+    struct Payload
+    {
+        std::string fPage;
+        std::string fName;
+        uint32_t fLen;
+    };
+    typedef std::vector<Payload> PayloadVec;
+    typedef std::map<std::string, PayloadVec> PayloadMap;
+
+    PayloadMap fPayloads;       // MD5 of the payload -> every object with it
+    uint16_t fBitmapClass;
+    std::vector<uint8_t> fBuf;
+
+public:
+    plIdenticalBitmapReport();
+
+    void AddObject(const char* pageName, const plKey& key, hsStream* page);
+    void Report() const;
+};
+
 #endif // plPageOptimizer_h_inc
\ No newline at end of file
@@ -0,0 +1,299 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  plSkinBench - Times plSoftwareSkin on made up skinned spans, without a
+//  client or a device. For each of the vertex layouts the avatars and the
+//  skinned props use, the straight FPU blend, the SSE1 blend and the
+//  threaded blend at each thread count are run over the same verts, and
+//  checked against the FPU one.
+//
+//  Errors are relative to the size of the result, since positions go out
+//  to a few hundred feet. The threaded runs go through the same dispatcher
+//  as BlendVerts, so they should match it exactly.
+//
+//  The verts and palette come from a fixed seed, so runs are comparable.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "HeadSpin.h"
+#include "hsGeometry3.h"
+#include "hsMatrix44.h"
+#include "hsTimer.h"
+
+#include "plPipeline/plGBufferGroup.h"
+#include "plSoftwareSkin/plSoftwareSkin.h"
+
+#include <math.h>
+#include <vector>
+
+//// Spans ////////////////////////////////////////////////////////////////////
+
+static inline uint32_t IRand(uint32_t& seed)
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+static inline float IRandRange(uint32_t& seed, float lo, float hi)
+{
+    return lo + (hi - lo) * float(IRand(seed) & 0xffff) / float(0xffff);
+}
+
+struct plSkinBenchLayout
+{
+    const char* fName;
+    int         fNumWeights;
+    bool        fHasIndices;
+    uint8_t     fNumUVs;
+
+    uint8_t Format() const
+    {
+        uint8_t format = plGBufferGroup::UVCountToFormat(fNumUVs);
+        switch( fNumWeights )
+        {
+            case 1: format |= plGBufferGroup::kSkin1Weight; break;
+            case 2: format |= plGBufferGroup::kSkin2Weights; break;
+            default: format |= plGBufferGroup::kSkin3Weights; break;
+        }
+        if( fHasIndices )
+            format |= plGBufferGroup::kSkinIndices;
+        return format;
+    }
+    uint32_t SrcStride() const
+    {
+        return sizeof(float) * (3 + fNumWeights + 3 + 3 * fNumUVs) + sizeof(uint32_t) * (2 + (fHasIndices ? 1 : 0));
+    }
+    uint32_t DstStride() const
+    {
+        return sizeof(float) * (3 + 3 + 3 * fNumUVs) + sizeof(uint32_t) * 2;
+    }
+};
+
+static const plSkinBenchLayout kLayouts[] =
+{
+    { "1 weight",                1, false, 1 },
+    { "2 weights",               2, false, 1 },
+    { "3 weights, indices",      3, true,  1 },  // the avatars
+    { "3 weights, indices, 2uv", 3, true, 2 },
+};
+
+static void IMakePalette(std::vector<hsMatrix44>& palette, int numBones, uint32_t& seed)
+{
+    palette.resize(numBones);
+    int i;
+    for( i = 0; i < numBones; i++ )
+    {
+        hsMatrix44& xfm = palette[i];
+        int r, c;
+        for( r = 0; r < 3; r++ )
+        {
+            for( c = 0; c < 3; c++ )
+                xfm.fMap[r][c] = IRandRange(seed, -1.f, 1.f);
+            xfm.fMap[r][3] = IRandRange(seed, -100.f, 100.f);
+        }
+        xfm.fMap[3][0] = xfm.fMap[3][1] = xfm.fMap[3][2] = 0;
+        xfm.fMap[3][3] = 1.f;
+        xfm.NotIdentity();
+    }
+}
+
+static void IMakeVerts(std::vector<uint8_t>& src, const plSkinBenchLayout& layout, int numVerts, int numBones, uint32_t& seed)
+{
+    uint32_t stride = layout.SrcStride();
+    src.resize(numVerts * stride);
+    int i;
+    for( i = 0; i < numVerts; i++ )
+    {
+        float* f = (float*)&src[i * stride];
+        *f++ = IRandRange(seed, -10.f, 10.f);
+        *f++ = IRandRange(seed, -10.f, 10.f);
+        *f++ = IRandRange(seed, -10.f, 10.f);
+
+        // Weights summing to at most 1, the last bone gets what's left over.
+        float left = 1.f;
+        int j;
+        for( j = 0; j < layout.fNumWeights; j++ )
+        {
+            float w = IRandRange(seed, 0, left);
+            *f++ = w;
+            left -= w;
+        }
+
+        if( layout.fHasIndices )
+        {
+            uint32_t indices = 0;
+            for( j = 0; j < 4; j++ )
+                indices |= (IRand(seed) % numBones) << (j * 8);
+            *(uint32_t*)f++ = indices;
+        }
+
+        hsVector3 norm(IRandRange(seed, -1.f, 1.f), IRandRange(seed, -1.f, 1.f), IRandRange(seed, -1.f, 1.f));
+        norm.Normalize();
+        *f++ = norm.fX;
+        *f++ = norm.fY;
+        *f++ = norm.fZ;
+        *(uint32_t*)f++ = 0xffffffff;
+        *(uint32_t*)f++ = 0xff000000;
+        for( j = 0; j < layout.fNumUVs; j++ )
+        {
+            *f++ = IRandRange(seed, 0, 1.f);
+            *f++ = IRandRange(seed, 0, 1.f);
+            *f++ = 0;
+        }
+    }
+}
+
+//// Checks ///////////////////////////////////////////////////////////////////
+
+// Worst relative position or normal error, huge if anything else got mangled
+static float IMaxError(const std::vector<uint8_t>& ref, const std::vector<uint8_t>& out, uint32_t stride, int numVerts)
+{
+    float maxErr = 0;
+    int i;
+    for( i = 0; i < numVerts; i++ )
+    {
+        const float* a = (const float*)&ref[i * stride];
+        const float* b = (const float*)&out[i * stride];
+        int j;
+        for( j = 0; j < 6; j++ )
+            maxErr = hsMaximum(maxErr, fabsf(a[j] - b[j]) / hsMaximum(1.f, fabsf(a[j])));
+        if( memcmp(a + 6, b + 6, stride - sizeof(float) * 6) )
+            return 1.e30f;
+    }
+    return maxErr;
+}
+
+//// Runs /////////////////////////////////////////////////////////////////////
+
+typedef void (*plBlendFunc)(const hsMatrix44*, int, const uint8_t*, uint8_t, uint32_t, uint8_t*, uint32_t, uint32_t, uint16_t);
+
+static double ITime(plBlendFunc blend, const std::vector<hsMatrix44>& palette, const std::vector<uint8_t>& src,
+                    const plSkinBenchLayout& layout, std::vector<uint8_t>& out, int numVerts, int numPasses)
+{
+    out.resize(numVerts * layout.DstStride());
+
+    double start = hsTimer::GetSeconds();
+    int i;
+    for( i = 0; i < numPasses; i++ )
+        blend(&palette[0], palette.size(), &src[0], layout.Format(), layout.SrcStride(),
+            &out[0], layout.DstStride(), numVerts, 0);
+    return (hsTimer::GetSeconds() - start) * 1000.0 / numPasses;
+}
+
+static void IRunLayout(const plSkinBenchLayout& layout, int numVerts, int numBones, int numPasses, int maxThreads)
+{
+    uint32_t seed = 1;
+    std::vector<hsMatrix44> palette;
+    IMakePalette(palette, numBones, seed);
+    std::vector<uint8_t> src;
+    IMakeVerts(src, layout, numVerts, numBones, seed);
+
+    std::vector<uint8_t> ref, out, dispatched;
+    uint32_t stride = layout.DstStride();
+
+    double fpuMS = ITime(plSoftwareSkin::BlendVertsRef, palette, src, layout, ref, numVerts, numPasses);
+    printf("%-24s %-12s %10.3f\n", layout.fName, "fpu", fpuMS);
+
+    if( plSoftwareSkin::HasSSE1() )
+    {
+        double sseMS = ITime(plSoftwareSkin::BlendVertsSSE1, palette, src, layout, out, numVerts, numPasses);
+        printf("%-24s %-12s %10.3f %8.2fx %10g\n", layout.fName, "sse1", sseMS, fpuMS / sseMS,
+            IMaxError(ref, out, stride, numVerts));
+    }
+
+    ITime(plSoftwareSkin::BlendVerts, palette, src, layout, dispatched, numVerts, 1);
+
+    int n;
+    for( n = 0; n <= maxThreads; n++ )
+    {
+        plSoftwareSkin::SetNumThreads(n);
+
+        char name[32];
+        sprintf(name, "threaded +%d", n);
+        double ms = ITime(plSoftwareSkin::BlendVertsThreaded, palette, src, layout, out, numVerts, numPasses);
+        printf("%-24s %-12s %10.3f %8.2fx %10g%s\n", layout.fName, name, ms, fpuMS / ms,
+            IMaxError(ref, out, stride, numVerts), out == dispatched ? "" : "  OUTPUT DIFFERS");
+    }
+    plSoftwareSkin::Shutdown();
+}
+
+//// main ////////////////////////////////////////////////////////////////////
+
+int PrintHelp()
+{
+    puts("");
+    puts("Usage: plSkinBench [numVerts [numBones [numPasses [maxThreads]]]]");
+    puts("Where:");
+    puts("       numVerts is how many verts in each span (default 16384)");
+    puts("       numBones is the palette size, at most 256 (default 64)");
+    puts("       numPasses is how many times each blend is timed (default 20)");
+    puts("       maxThreads is the most extra skinning threads to try (default 3)");
+    puts("");
+
+    return -1;
+}
+
+int main(int argc, char* argv[])
+{
+    if( (argc > 1) && ((argv[1][0] == '-') || (argv[1][0] == '/')) )
+        return PrintHelp();
+
+    int numVerts = argc > 1 ? atoi(argv[1]) : 16384;
+    int numBones = argc > 2 ? atoi(argv[2]) : 64;
+    int numPasses = argc > 3 ? atoi(argv[3]) : 20;
+    int maxThreads = argc > 4 ? atoi(argv[4]) : 3;
+    if( (numVerts < 1) || (numBones < 1) || (numBones > 256) || (numPasses < 1) ||
+        (maxThreads < 0) || (maxThreads > plSoftwareSkin::kMaxThreads) )
+        return PrintHelp();
+
+    printf("%d verts, %d bones, %d passes, sse1 %s\n\n", numVerts, numBones, numPasses,
+        plSoftwareSkin::HasSSE1() ? "yes" : "no");
+    printf("%-24s %-12s %10s %9s %10s\n", "layout", "blend", "ms", "vs fpu", "max error");
+
+    int i;
+    for( i = 0; i < sizeof(kLayouts) / sizeof(kLayouts[0]); i++ )
+        IRunLayout(kLayouts[i], numVerts, numBones, numPasses, maxThreads);
+
+    return 0;
+}
@@ -0,0 +1,207 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+//////////////////////////////////////////////////////////////////////////////
+//
+//  plSoundDecodeBench - Decodes every .ogg in a folder through the sound
+//  preloader, the way an age's static sounds get loaded after linking in,
+//  and reports how long it takes with one decode thread and with the pool
+//  sized to the machine (or the number of threads asked for).
+//
+//  Every eighth sound is queued as one that's waiting to play and the rest
+//  get a made up distance to the listener, so the time until the waiting
+//  sounds are ready shows the queue ordering as well as the throughput.
+//  Each sound is polled with AsyncLoad once a "frame", like plSound does.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#include "HeadSpin.h"
+#include "hsFiles.h"
+#include "hsTemplates.h"
+#include "hsThread.h"
+#include "hsTimer.h"
+
+#include "plAudioCore/plSoundBuffer.h"
+
+//// Helpers /////////////////////////////////////////////////////////////////
+
+static void IFindFiles(const char* folder, hsTArray<char*>& files)
+{
+    hsFolderIterator iter(folder);
+    while (iter.NextFileSuffix(".ogg"))
+    {
+        char path[kFolderIterator_MaxPath];
+        iter.GetPathAndName(path);
+        files.Append(hsStrcpy(path));
+    }
+}
+
+//// IRun ////////////////////////////////////////////////////////////////////
+//  Decodes all the files once with the given number of threads (0 for the
+//  default pool) and prints a line of results.
+
+static void IRun(const hsTArray<char*>& files, int numThreads, uint32_t seed)
+{
+    plSoundBuffer::Init(numThreads);
+
+    hsTArray<plSoundBuffer*> bufs;
+    hsTArray<bool> done;
+    for (int i = 0; i < files.GetCount(); i++)
+    {
+        plSoundBuffer* buf = new plSoundBuffer(files[i], plSoundBuffer::kStreamCompressed);
+        if (!buf->IsValid())
+        {
+            delete buf;
+            continue;
+        }
+
+        seed = seed * 1103515245 + 12345;
+        float dist = (float)((seed >> 16) & 0x3ff);
+        buf->SetDecodePriority((bufs.GetCount() & 7) == 0, dist * dist);
+
+        bufs.Append(buf);
+        done.Append(false);
+    }
+
+    plSoundDecodeStats dummy;
+    plSoundBuffer::GrabDecodeStats(dummy);
+
+    double startTime = hsTimer::GetSeconds();
+    double playingReadyTime = 0;
+    int numLeft = bufs.GetCount();
+    int numPlayingLeft = (bufs.GetCount() + 7) / 8;
+    int numErrors = 0;
+    while (numLeft)
+    {
+        for (int i = 0; i < bufs.GetCount(); i++)
+        {
+            if (done[i])
+                continue;
+
+            plSoundBuffer::ELoadReturnVal retVal = bufs[i]->AsyncLoad(plAudioFileReader::kStreamNative);
+            if (retVal == plSoundBuffer::kPending)
+                continue;
+
+            if (retVal == plSoundBuffer::kError)
+                numErrors++;
+            done[i] = true;
+            numLeft--;
+            if (bufs[i]->GetDecodePlaying() && !--numPlayingLeft)
+                playingReadyTime = hsTimer::GetSeconds() - startTime;
+        }
+        if (numLeft)
+            hsSleep::Sleep(1);
+    }
+    double secs = hsTimer::GetSeconds() - startTime;
+
+    plSoundDecodeStats stats;
+    plSoundBuffer::GrabDecodeStats(stats);
+
+    double mb = stats.fBytesDecoded / (1024.0 * 1024.0);
+    double avgWait = stats.fNumDecoded ? stats.fWaitSecs / stats.fNumDecoded : 0;
+    printf("%7d %7d %9.1f %9.1f %9.1f %10.1f %10.1f %11.1f %6d\n",
+        plSoundBuffer::GetNumDecodeThreads(),
+        stats.fNumDecoded,
+        mb,
+        secs * 1000.0,
+        secs > 0 ? mb / secs : 0,
+        avgWait * 1000.0,
+        stats.fMaxWaitSecs * 1000.0,
+        playingReadyTime * 1000.0,
+        numErrors);
+
+    for (int i = 0; i < bufs.GetCount(); i++)
+        delete bufs[i];
+
+    plSoundBuffer::Shutdown();
+}
+
+//// main ////////////////////////////////////////////////////////////////////
+
+int PrintHelp()
+{
+    puts("");
+    puts("Usage: plSoundDecodeBench folder [numThreads [numPasses]]");
+    puts("Where:");
+    puts("       folder holds the .ogg files to decode");
+    puts("       numThreads is the pool size to compare against one thread");
+    puts("         (default is one per core less one)");
+    puts("       numPasses is how many times to run each (default 3)");
+    puts("");
+    puts("The first pass of each set pays for reading the files off the disk.");
+    puts("");
+
+    return -1;
+}
+
+int main(int argc, char* argv[])
+{
+    if( (argc < 2) || (argv[1][0] == '-') )
+        return PrintHelp();
+
+    int numThreads = argc > 2 ? atoi(argv[2]) : 0;
+    int numPasses = argc > 3 ? atoi(argv[3]) : 3;
+    if( (numThreads < 0) || (numPasses < 1) )
+        return PrintHelp();
+
+    hsTArray<char*> files;
+    IFindFiles(argv[1], files);
+    if( !files.GetCount() )
+    {
+        printf("No .ogg files in %s\n", argv[1]);
+        return -1;
+    }
+
+    printf("%d files in %s\n\n", files.GetCount(), argv[1]);
+    printf("%7s %7s %9s %9s %9s %10s %10s %11s %6s\n",
+        "threads", "sounds", "MB", "ms", "MB/s", "avg wait", "max wait", "playing at", "errors");
+
+    for (int pass = 0; pass < numPasses; pass++)
+        IRun(files, 1, 1);
+    for (int pass = 0; pass < numPasses; pass++)
+        IRun(files, numThreads, 1);
+
+    for (int i = 0; i < files.GetCount(); i++)
+        delete [] files[i];
+
+    return 0;
+}
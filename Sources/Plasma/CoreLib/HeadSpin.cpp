@@ -49,6 +49,68 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "hsTemplates.h"
 
 
+///////////////////////////////////////////////////////////////////////////
+/////////////////// Endian Swapping ///////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////
+
+// Swaps eight bytes' worth of elements per step with plain shifts and
+// masks, which the compiler can keep in (or widen to) vector registers.
+// memcpy keeps unaligned arrays legal.
+
+void hsSwapEndianArray16(void* values, int count)
+{
+    uint8_t* p = (uint8_t*)values;
+    int i = 0;
+    for (; i + 4 <= count; i += 4, p += 8)
+    {
+        uint64_t x;
+        memcpy(&x, p, 8);
+        x = ((x & 0x00ff00ff00ff00ffULL) << 8) | ((x >> 8) & 0x00ff00ff00ff00ffULL);
+        memcpy(p, &x, 8);
+    }
+    for (; i < count; i++, p += 2)
+    {
+        uint16_t x;
+        memcpy(&x, p, 2);
+        x = hsSwapEndian16(x);
+        memcpy(p, &x, 2);
+    }
+}
+
+void hsSwapEndianArray32(void* values, int count)
+{
+    uint8_t* p = (uint8_t*)values;
+    int i = 0;
+    for (; i + 2 <= count; i += 2, p += 8)
+    {
+        uint64_t x;
+        memcpy(&x, p, 8);
+        x = ((x & 0x00ff00ff00ff00ffULL) << 8) | ((x >> 8) & 0x00ff00ff00ff00ffULL);
+        x = ((x & 0x0000ffff0000ffffULL) << 16) | ((x >> 16) & 0x0000ffff0000ffffULL);
+        memcpy(p, &x, 8);
+    }
+    if (i < count)
+    {
+        uint32_t x;
+        memcpy(&x, p, 4);
+        x = hsSwapEndian32(x);
+        memcpy(p, &x, 4);
+    }
+}
+
+void hsSwapEndianArray64(void* values, int count)
+{
+    uint8_t* p = (uint8_t*)values;
+    for (int i = 0; i < count; i++, p += 8)
+    {
+        uint64_t x;
+        memcpy(&x, p, 8);
+        x = hsSwapEndian64(x);
+        memcpy(p, &x, 8);
+    }
+}
+
+
 ///////////////////////////////////////////////////////////////////////////
 /////////////////// For Status Messages ///////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////
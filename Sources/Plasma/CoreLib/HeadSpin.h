@@ -201,6 +201,11 @@ inline double hsSwapEndianDouble(double dvalue)
     return *(double*)&value;
 }
 
+// In-place swap of count 16, 32 or 64 bit elements
+void hsSwapEndianArray16(void* values, int count);
+void hsSwapEndianArray32(void* values, int count);
+void hsSwapEndianArray64(void* values, int count);
+
 #if LITTLE_ENDIAN
     #define hsToBE16(n)         hsSwapEndian16(n)
     #define hsToBE32(n)         hsSwapEndian32(n)
@@ -564,4 +569,16 @@ inline long AtomicSet(long* value, long set)
 #endif
 }
 
+// if (*value == compare) *value = set; return whether it was set; thread safe
+inline bool AtomicCompareSet(long* value, long compare, long set)
+{
+#ifdef HS_BUILD_FOR_WIN32
+    return InterlockedCompareExchange(value, set, compare) == compare;
+#elif __GNUC__
+    return __sync_bool_compare_and_swap(value, compare, set);
+#else
+#   error "No Atomic Compare Set support on this architecture"
+#endif
+}
+
 #endif
@@ -0,0 +1,542 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#ifndef hsFastArray_inc
+#define hsFastArray_inc
+
+#include "HeadSpin.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <new>
+#include <utility>
+#include <type_traits>
+
+///////////////////////////////////////////////////////////////////////////////
+// hsFastArray - Growable array for the per frame lists.
+//
+// Looks like hsTArray from the outside (GetCount, SetCount, Push, Append,
+// ExpandAndZero, etc.), with the differences that matter on hot paths:
+//  - 32 bit counts, so no 64k ceiling.
+//  - Storage is raw memory. Reserve() doesn't construct anything, and growing
+//    relocates the elements already there instead of default constructing a
+//    whole new block and copying them over one by one.
+//  - Types for which hsFastArrayTraits<T>::kTrivial is set (anything trivially
+//    copyable, so ints, pointers, plain structs) are moved around with
+//    memcpy/memmove and grow with realloc. As with hsTArray, SetCount leaves
+//    new trivial elements uninitialized.
+//  - Elements are moved rather than copied when the array grows, and the
+//    array itself can be moved (handing over the block) or swapped.
+//
+// Unlike hsTArray, shrinking the count really does destroy the elements past
+// the end. Things like plCullPoly that hang onto their own buffers between
+// frames by being left alive past the count of a scratch hsTArray want to
+// stay in an hsTArray.
+//
+// hsSmallArray<T, N> is the same thing with room for N elements inside the
+// object itself, so short lists never touch the heap at all.
+///////////////////////////////////////////////////////////////////////////////
+
+template <class T> struct hsFastArrayTraits
+{
+#if defined(_MSC_VER) && (_MSC_VER < 1700)
+    enum { kTrivial = __has_trivial_copy(T) && __has_trivial_destructor(T) };
+#else
+    enum { kTrivial = std::is_trivially_copyable<T>::value };
+#endif
+};
+
+#ifdef HS_DEBUGGING
+    #define hsFastArray_ValidateIndex(index)        hsAssert((index) < fCount, "bad index")
+    #define hsFastArray_ValidateInsertIndex(index)  hsAssert((index) <= fCount, "bad index")
+#else
+    #define hsFastArray_ValidateIndex(index)
+    #define hsFastArray_ValidateInsertIndex(index)
+#endif
+
+template <class T> class hsFastArray
+{
+protected:
+    T*          fArray;
+    uint32_t    fCount;
+    uint32_t    fCapacity;
+
+    // Storage that came with the object (see hsSmallArray). Never freed.
+    T*          fInline;
+    uint32_t    fInlineCapacity;
+
+    hsFastArray(T* inlineArray, uint32_t inlineCapacity)
+        : fArray(inlineArray), fCount(0), fCapacity(inlineCapacity),
+          fInline(inlineArray), fInlineCapacity(inlineCapacity) {}
+
+    void        IGrow(uint32_t minCapacity);
+    void        IRealloc(uint32_t capacity);
+    void        IFreeHeap();
+    void        IMoveFrom(hsFastArray<T>& src);
+
+    static void IConstruct(T* dst, uint32_t count);
+    static void IDestroy(T* dst, uint32_t count);
+    static void ICopy(T* dst, const T* src, uint32_t count);
+    static void IRelocate(T* dst, T* src, uint32_t count);
+
+public:
+    enum {
+        kMissingIndex = -1
+    };
+
+    hsFastArray() : fArray(nil), fCount(0), fCapacity(0), fInline(nil), fInlineCapacity(0) {}
+    hsFastArray(const hsFastArray<T>& src);
+    hsFastArray(hsFastArray<T>&& src);
+    ~hsFastArray() { IDestroy(fArray, fCount); IFreeHeap(); }
+
+    hsFastArray<T>& operator=(const hsFastArray<T>& src);
+    hsFastArray<T>& operator=(hsFastArray<T>&& src);
+
+    void        Swap(hsFastArray<T>& src);
+
+    uint32_t    GetCount() const { return fCount; }
+    uint32_t    Count() const { return fCount; }
+    uint32_t    GetNumAlloc() const { return fCapacity; }
+    bool        IsEmpty() const { return !fCount; }
+
+    T&          operator[](uint32_t index) { hsFastArray_ValidateIndex(index); return fArray[index]; }
+    const T&    operator[](uint32_t index) const { hsFastArray_ValidateIndex(index); return fArray[index]; }
+    const T&    Get(uint32_t index) const { hsFastArray_ValidateIndex(index); return fArray[index]; }
+    void        Set(uint32_t index, const T& item) { hsFastArray_ValidateIndex(index); fArray[index] = item; }
+
+    T*          AcquireArray() { return fArray; }
+    const T*    AcquireArray() const { return fArray; }
+
+    // Make room for at least count elements without constructing any of them.
+    void        Reserve(uint32_t count) { if( count > fCapacity ) IRealloc(count); }
+    // Same as Reserve, named to match hsTArray.
+    void        Expand(uint32_t count) { Reserve(count); }
+
+    void        SetCount(uint32_t count);
+    void        SetCountAndZero(uint32_t count);    // block clear, trivial types only
+    void        ExpandAndZero(uint32_t count);      // same, but never shrinks
+    void        Reset();                            // empty and give back the memory
+
+    T*          Push();
+    void        Push(const T& item) { Append(item); }
+    void        Push(T&& item) { Append(std::move(item)); }
+    void        Append(const T& item);
+    void        Append(T&& item);
+    void        Append(const T* items, uint32_t count);
+    T           Pop();
+    const T&    Peek() const { hsFastArray_ValidateIndex(fCount-1); return fArray[fCount-1]; }
+
+    T*          Insert(uint32_t index);
+    void        Insert(uint32_t index, const T& item) { T tmp(item); *Insert(index) = std::move(tmp); }
+    void        Remove(uint32_t index) { Remove(index, 1); }
+    void        Remove(uint32_t index, uint32_t count);
+    bool        RemoveItem(const T& item);
+    int         Find(const T& item) const;
+};
+
+template <class T, uint32_t N> class hsSmallArray : public hsFastArray<T>
+{
+protected:
+    union
+    {
+        uint8_t     fBytes[N * sizeof(T)];
+        double      fAlignD;
+        void*       fAlignP;
+        int64_t     fAlignI;
+    }           fStorage;
+
+public:
+    hsSmallArray() : hsFastArray<T>((T*)fStorage.fBytes, N) {}
+    hsSmallArray(const hsFastArray<T>& src) : hsFastArray<T>((T*)fStorage.fBytes, N) { hsFastArray<T>::operator=(src); }
+    hsSmallArray(const hsSmallArray<T, N>& src) : hsFastArray<T>((T*)fStorage.fBytes, N) { hsFastArray<T>::operator=(src); }
+    hsSmallArray(hsFastArray<T>&& src) : hsFastArray<T>((T*)fStorage.fBytes, N) { this->IMoveFrom(src); }
+    hsSmallArray(hsSmallArray<T, N>&& src) : hsFastArray<T>((T*)fStorage.fBytes, N) { this->IMoveFrom(src); }
+
+    hsSmallArray<T, N>& operator=(const hsFastArray<T>& src) { hsFastArray<T>::operator=(src); return *this; }
+    hsSmallArray<T, N>& operator=(const hsSmallArray<T, N>& src) { hsFastArray<T>::operator=(src); return *this; }
+    hsSmallArray<T, N>& operator=(hsFastArray<T>&& src) { hsFastArray<T>::operator=(std::move(src)); return *this; }
+    hsSmallArray<T, N>& operator=(hsSmallArray<T, N>&& src) { hsFastArray<T>::operator=(std::move(src)); return *this; }
+};
+
+//////////////  Element helpers
+
+template <class T> void hsFastArray<T>::IConstruct(T* dst, uint32_t count)
+{
+    if( hsFastArrayTraits<T>::kTrivial )
+        return;
+    uint32_t i;
+    for( i = 0; i < count; i++ )
+        new (&dst[i]) T;
+}
+
+template <class T> void hsFastArray<T>::IDestroy(T* dst, uint32_t count)
+{
+    if( hsFastArrayTraits<T>::kTrivial )
+        return;
+    uint32_t i;
+    for( i = 0; i < count; i++ )
+        dst[i].~T();
+}
+
+// Copy construct into uninitialized dst.
+template <class T> void hsFastArray<T>::ICopy(T* dst, const T* src, uint32_t count)
+{
+    if( hsFastArrayTraits<T>::kTrivial )
+    {
+        if( count )
+            memcpy(dst, src, count * sizeof(T));
+        return;
+    }
+    uint32_t i;
+    for( i = 0; i < count; i++ )
+        new (&dst[i]) T(src[i]);
+}
+
+// Move construct into uninitialized dst, leaving src uninitialized.
+template <class T> void hsFastArray<T>::IRelocate(T* dst, T* src, uint32_t count)
+{
+    if( hsFastArrayTraits<T>::kTrivial )
+    {
+        if( count )
+            memcpy(dst, src, count * sizeof(T));
+        return;
+    }
+    uint32_t i;
+    for( i = 0; i < count; i++ )
+    {
+        new (&dst[i]) T(std::move(src[i]));
+        src[i].~T();
+    }
+}
+
+//////////////  Storage
+
+template <class T> void hsFastArray<T>::IRealloc(uint32_t capacity)
+{
+    hsAssert(capacity >= fCount, "Realloc would lose elements");
+
+    const bool onHeap = fArray && (fArray != fInline);
+    if( hsFastArrayTraits<T>::kTrivial && onHeap )
+    {
+        // realloc may well manage it without moving anything.
+        fArray = (T*)realloc(fArray, capacity * sizeof(T));
+    }
+    else
+    {
+        T* newArray = (T*)malloc(capacity * sizeof(T));
+        IRelocate(newArray, fArray, fCount);
+        if( onHeap )
+            free(fArray);
+        fArray = newArray;
+    }
+    fCapacity = capacity;
+}
+
+template <class T> void hsFastArray<T>::IGrow(uint32_t minCapacity)
+{
+    // Half again as much, like hsTArray, but never fewer than 8.
+    uint32_t capacity = fCapacity + (fCapacity >> 1);
+    if( capacity < 8 )
+        capacity = 8;
+    if( capacity < minCapacity )
+        capacity = minCapacity;
+    IRealloc(capacity);
+}
+
+// Elements should already be destroyed.
+template <class T> void hsFastArray<T>::IFreeHeap()
+{
+    if( fArray != fInline )
+    {
+        free(fArray);
+        fArray = fInline;
+        fCapacity = fInlineCapacity;
+    }
+}
+
+// We're empty. Take src's block if it has one of its own, otherwise
+// move its elements over one at a time.
+template <class T> void hsFastArray<T>::IMoveFrom(hsFastArray<T>& src)
+{
+    hsAssert(!fCount, "Moving into a non-empty array");
+
+    if( src.fArray != src.fInline )
+    {
+        IFreeHeap();
+        fArray = src.fArray;
+        fCapacity = src.fCapacity;
+        fCount = src.fCount;
+
+        src.fArray = src.fInline;
+        src.fCapacity = src.fInlineCapacity;
+        src.fCount = 0;
+    }
+    else
+    {
+        Reserve(src.fCount);
+        IRelocate(fArray, src.fArray, src.fCount);
+        fCount = src.fCount;
+        src.fCount = 0;
+    }
+}
+
+//////////////  Public hsFastArray methods
+
+template <class T> hsFastArray<T>::hsFastArray(const hsFastArray<T>& src)
+    : fArray(nil), fCount(0), fCapacity(0), fInline(nil), fInlineCapacity(0)
+{
+    operator=(src);
+}
+
+template <class T> hsFastArray<T>::hsFastArray(hsFastArray<T>&& src)
+    : fArray(nil), fCount(0), fCapacity(0), fInline(nil), fInlineCapacity(0)
+{
+    IMoveFrom(src);
+}
+
+template <class T> hsFastArray<T>& hsFastArray<T>::operator=(const hsFastArray<T>& src)
+{
+    if( &src == this )
+        return *this;
+
+    IDestroy(fArray, fCount);
+    fCount = 0;
+    Reserve(src.fCount);
+    ICopy(fArray, src.fArray, src.fCount);
+    fCount = src.fCount;
+
+    return *this;
+}
+
+template <class T> hsFastArray<T>& hsFastArray<T>::operator=(hsFastArray<T>&& src)
+{
+    if( &src == this )
+        return *this;
+
+    IDestroy(fArray, fCount);
+    fCount = 0;
+    IMoveFrom(src);
+
+    return *this;
+}
+
+template <class T> void hsFastArray<T>::Swap(hsFastArray<T>& src)
+{
+    if( (fArray != fInline) && (src.fArray != src.fInline) )
+    {
+        // Both on the heap, just trade blocks.
+        std::swap(fArray, src.fArray);
+        std::swap(fCount, src.fCount);
+        std::swap(fCapacity, src.fCapacity);
+        return;
+    }
+
+    hsFastArray<T> tmp(std::move(*this));
+    *this = std::move(src);
+    src = std::move(tmp);
+}
+
+template <class T> void hsFastArray<T>::SetCount(uint32_t count)
+{
+    if( count > fCount )
+    {
+        if( count > fCapacity )
+            IGrow(count);
+        IConstruct(fArray + fCount, count - fCount);
+    }
+    else
+    {
+        IDestroy(fArray + count, fCount - count);
+    }
+    fCount = count;
+}
+
+template <class T> void hsFastArray<T>::SetCountAndZero(uint32_t count)
+{
+    hsAssert(hsFastArrayTraits<T>::kTrivial, "Block clearing a non-trivial type");
+    if( count > fCapacity )
+        IGrow(count);
+    if( count )
+        memset(fArray, 0, count * sizeof(T));
+    fCount = count;
+}
+
+template <class T> void hsFastArray<T>::ExpandAndZero(uint32_t count)
+{
+    hsAssert(hsFastArrayTraits<T>::kTrivial, "Block clearing a non-trivial type");
+    if( count > fCount )
+    {
+        if( count > fCapacity )
+            IGrow(count);
+        memset(fArray + fCount, 0, (count - fCount) * sizeof(T));
+        fCount = count;
+    }
+}
+
+template <class T> void hsFastArray<T>::Reset()
+{
+    IDestroy(fArray, fCount);
+    fCount = 0;
+    IFreeHeap();
+}
+
+template <class T> T* hsFastArray<T>::Push()
+{
+    if( fCount == fCapacity )
+        IGrow(fCount + 1);
+    T* item = fArray + fCount++;
+    if( !hsFastArrayTraits<T>::kTrivial )
+        new (item) T;
+    return item;
+}
+
+template <class T> void hsFastArray<T>::Append(const T& item)
+{
+    if( fCount == fCapacity )
+    {
+        // item might live in the block we're about to move.
+        T tmp(item);
+        IGrow(fCount + 1);
+        new (&fArray[fCount++]) T(std::move(tmp));
+        return;
+    }
+    new (&fArray[fCount++]) T(item);
+}
+
+template <class T> void hsFastArray<T>::Append(T&& item)
+{
+    if( fCount == fCapacity )
+    {
+        T tmp(std::move(item));
+        IGrow(fCount + 1);
+        new (&fArray[fCount++]) T(std::move(tmp));
+        return;
+    }
+    new (&fArray[fCount++]) T(std::move(item));
+}
+
+template <class T> void hsFastArray<T>::Append(const T* items, uint32_t count)
+{
+    hsAssert((items + count <= fArray) || (items >= fArray + fCapacity), "Appending from ourselves");
+    if( fCount + count > fCapacity )
+        IGrow(fCount + count);
+    ICopy(fArray + fCount, items, count);
+    fCount += count;
+}
+
+template <class T> T hsFastArray<T>::Pop()
+{
+    hsFastArray_ValidateIndex(fCount-1);
+    T item(std::move(fArray[--fCount]));
+    IDestroy(fArray + fCount, 1);
+    return item;
+}
+
+template <class T> T* hsFastArray<T>::Insert(uint32_t index)
+{
+    hsFastArray_ValidateInsertIndex(index);
+    if( fCount == fCapacity )
+        IGrow(fCount + 1);
+
+    if( hsFastArrayTraits<T>::kTrivial )
+    {
+        memmove(fArray + index + 1, fArray + index, (fCount - index) * sizeof(T));
+        fCount++;
+        return fArray + index;
+    }
+
+    if( index == fCount )
+    {
+        new (&fArray[fCount++]) T;
+        return fArray + index;
+    }
+
+    new (&fArray[fCount]) T(std::move(fArray[fCount-1]));
+    uint32_t i;
+    for( i = fCount-1; i > index; i-- )
+        fArray[i] = std::move(fArray[i-1]);
+    fArray[index] = T();
+    fCount++;
+
+    return fArray + index;
+}
+
+template <class T> void hsFastArray<T>::Remove(uint32_t index, uint32_t count)
+{
+    hsFastArray_ValidateIndex(index);
+    hsFastArray_ValidateIndex(index + count - 1);
+
+    if( hsFastArrayTraits<T>::kTrivial )
+    {
+        memmove(fArray + index, fArray + index + count, (fCount - index - count) * sizeof(T));
+    }
+    else
+    {
+        uint32_t i;
+        for( i = index; i + count < fCount; i++ )
+            fArray[i] = std::move(fArray[i + count]);
+        IDestroy(fArray + fCount - count, count);
+    }
+    fCount -= count;
+}
+
+template <class T> bool hsFastArray<T>::RemoveItem(const T& item)
+{
+    int idx = Find(item);
+    if( idx == kMissingIndex )
+        return false;
+    Remove(idx);
+    return true;
+}
+
+template <class T> int hsFastArray<T>::Find(const T& item) const
+{
+    uint32_t i;
+    for( i = 0; i < fCount; i++ )
+    {
+        if( fArray[i] == item )
+            return int(i);
+    }
+    return kMissingIndex;
+}
+
+#endif // hsFastArray_inc
@@ -281,6 +281,18 @@ void hsQuat::SetFromSlerp(hsQuat *q1, hsQuat *q2, float t)
 #define EPSILON 1.0E-6          /* a tiny number */
 
 void hsQuat::SetFromSlerp(const hsQuat &a, const hsQuat &b, float alpha, int spin)
+{
+    float beta;
+    GetSlerpWeights(a, b, alpha, &beta, &alpha, spin);
+
+    /* interpolate */
+    fX = beta*a.fX + alpha*b.fX;
+    fY = beta*a.fY + alpha*b.fY;
+    fZ = beta*a.fZ + alpha*b.fZ;
+    fW = beta*a.fW + alpha*b.fW;
+}
+
+void hsQuat::GetSlerpWeights(const hsQuat &a, const hsQuat &b, float alpha, float *wA, float *wB, int spin)
 //  double alpha;           /* interpolation parameter (0 to 1) */
 //  Quaternion *a, *b;      /* start and end unit quaternions */
 //  int spin;           /* number of extra spin rotations */
@@ -324,11 +336,8 @@ void hsQuat::SetFromSlerp(const hsQuat &a, const hsQuat &b, float alpha, int spi
     if (bflip)
         alpha = -alpha;
 
-    /* interpolate */
-    fX = beta*a.fX + alpha*b.fX;
-    fY = beta*a.fY + alpha*b.fY;
-    fZ = beta*a.fZ + alpha*b.fZ;
-    fW = beta*a.fW + alpha*b.fW;
+    *wA = beta;
+    *wB = alpha;
 }
 #endif
 
@@ -67,6 +67,8 @@ public:
     hsQuat& SetFromMatrix44(const hsMatrix44& mat);
     void SetFromMatrix(const hsMatrix44 *mat);
     void SetFromSlerp(const hsQuat &q1, const hsQuat &q2, float t, int spin=0);
+    // Weights w1, w2 such that w1*q1 + w2*q2 is the slerp of q1 and q2 at t.
+    static void GetSlerpWeights(const hsQuat &q1, const hsQuat &q2, float t, float *w1, float *w2, int spin=0);
     void Set(float X, float Y, float Z, float W)  
         { fX = X; fY = Y; fZ = Z; fW = W; }
     void GetAngleAxis(float *rad, hsVector3 *axis) const;
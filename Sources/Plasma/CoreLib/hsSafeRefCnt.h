@@ -42,24 +42,39 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #ifndef HS_SAFE_REF_CNT_H
 #define HS_SAFE_REF_CNT_H
 
+#include "HeadSpin.h"
 #include "hsRefCnt.h"
-#include "hsThread.h"
 
 //
 // Thread Safe RefCounter
+// The count is changed with atomic adds (full barriers on both Win32 and
+// gcc), so no lock is taken.  IRef/IUnRef are called just before the count
+// changes and may run on several threads at once.
 //
 
 class hsSafeRefCnt : public hsRefCnt
 {
 private:
-    static hsMutex fMutex;
+    long fSafeRefCnt;
 protected:
     virtual void IRef() { } 
     virtual void IUnRef() { }; 
 public:
-    virtual int RefCnt() const { hsTempMutexLock temp(fMutex); return hsRefCnt::RefCnt(); }
-    void UnRef() { hsTempMutexLock temp(fMutex); IUnRef(); hsRefCnt::UnRef(); }
-    void Ref() { hsTempMutexLock temp(fMutex); IRef(); hsRefCnt::Ref(); }
+    hsSafeRefCnt() : fSafeRefCnt(1) {}
+
+    virtual int RefCnt() const { return fSafeRefCnt; }
+    void UnRef()
+    {
+        IUnRef();
+        hsDebugCode(hsAssert(fSafeRefCnt >= 1, "UnRef on a deleted object");)
+        if (AtomicAdd(&fSafeRefCnt, -1) == 1)
+        {
+            // last ref, nobody else can see us.  Leave the count at 1 like hsRefCnt does
+            fSafeRefCnt = 1;
+            delete this;
+        }
+    }
+    void Ref() { IRef(); AtomicAdd(&fSafeRefCnt, 1); }
 };
 
 #endif //HS_SAFE_REF_CNT_H
@@ -365,11 +365,6 @@ bool hsStream::ReadBOOL()
     return val != 0;
 }
 
-bool hsStream::ReadBool() // Virtual, faster version in sub classes
-{
-    return (this->ReadByte() != 0);
-}
-
 void hsStream::ReadBool(int count, bool values[])
 {
     this->Read(count, values);
@@ -494,73 +489,42 @@ bool hsStream::ReadLn(char *s, uint32_t maxLen, const char beginComment, const c
     return true;
 }
 
-uint16_t hsStream::ReadLE16()
-{
-    uint16_t  value;
-    this->Read(sizeof(uint16_t), &value);
-    value = hsToLE16(value);
-    return value;
-}
-
+// The array reads pull the whole run in one go and then swap it in place
+// on big-endian hosts; on little-endian ones the swap compiles away.
 void hsStream::ReadLE16(int count, uint16_t values[])
 {
-    this->Read(count * sizeof(uint16_t), values);
-    for (int i = 0; i < count; i++)
-        values[i] = hsToLE16(values[i]);
-}
-
-uint32_t hsStream::ReadLE32()
-{
-    uint32_t  value;
-    Read4Bytes(&value);
-    value = hsToLE32(value);
-    return value;
+    if (!IReadWindow(count * sizeof(uint16_t), values))
+        this->Read(count * sizeof(uint16_t), values);
+#if !LITTLE_ENDIAN
+    hsSwapEndianArray16(values, count);
+#endif
 }
 
 void hsStream::ReadLE32(int count, uint32_t values[])
 {
-    this->Read(count * sizeof(uint32_t), values);
-    for (int i = 0; i < count; i++)
-        values[i] = hsToLE32(values[i]);
-}
-
-uint32_t hsStream::ReadBE32()
-{
-    uint32_t  value;
-    Read4Bytes(&value);
-    value = hsToBE32(value);
-    return value;
-}
-
-double hsStream::ReadLEDouble()
-{
-    double  value;
-    Read8Bytes(&value);
-    value = hsToLEDouble(value);
-    return value;
+    if (!IReadWindow(count * sizeof(uint32_t), values))
+        this->Read(count * sizeof(uint32_t), values);
+#if !LITTLE_ENDIAN
+    hsSwapEndianArray32(values, count);
+#endif
 }
 
 void hsStream::ReadLEDouble(int count, double values[])
 {
-    this->Read(count * sizeof(double), values);
-    for (int i = 0; i < count; i++)
-        values[i] = hsToLEDouble(values[i]);
-}
-
-
-float hsStream::ReadLEFloat()
-{
-    float   value;
-    Read4Bytes(&value);
-    value = hsToLEFloat(value);
-    return value;
+    if (!IReadWindow(count * sizeof(double), values))
+        this->Read(count * sizeof(double), values);
+#if !LITTLE_ENDIAN
+    hsSwapEndianArray64(values, count);
+#endif
 }
 
 void hsStream::ReadLEFloat(int count, float values[])
 {
-    this->Read(count * sizeof(float), values);
-    for (int i = 0; i < count; i++)
-        values[i] = hsToLEFloat(values[i]);
+    if (!IReadWindow(count * sizeof(float), values))
+        this->Read(count * sizeof(float), values);
+#if !LITTLE_ENDIAN
+    hsSwapEndianArray32(values, count);
+#endif
 }
 
 float hsStream::ReadBEFloat()
@@ -600,10 +564,38 @@ void  hsStream::WriteLE16(uint16_t value)
     this->Write(sizeof(int16_t), &value);
 }
 
+// Array writes go out in one Write on little-endian hosts. Big-endian hosts
+// swap through a small stack buffer so the caller's data is left alone.
+#if !LITTLE_ENDIAN
+static void IWriteSwapped(hsStream* s, const void* values, int count, int elemSize)
+{
+    uint64_t swapped[64];
+    const int perChunk = sizeof(swapped) / elemSize;
+    const uint8_t* src = (const uint8_t*)values;
+    while (count > 0)
+    {
+        int n = count < perChunk ? count : perChunk;
+        memcpy(swapped, src, n * elemSize);
+        switch (elemSize)
+        {
+        case 2: hsSwapEndianArray16(swapped, n); break;
+        case 4: hsSwapEndianArray32(swapped, n); break;
+        case 8: hsSwapEndianArray64(swapped, n); break;
+        }
+        s->Write(n * elemSize, swapped);
+        src += n * elemSize;
+        count -= n;
+    }
+}
+#endif
+
 void  hsStream::WriteLE16(int count, const uint16_t values[])
 {
-    for (int i = 0; i < count; i++)
-        this->WriteLE16(values[i]);
+#if LITTLE_ENDIAN
+    this->Write(count * sizeof(uint16_t), values);
+#else
+    IWriteSwapped(this, values, count, sizeof(uint16_t));
+#endif
 }
 
 void  hsStream::WriteLE32(uint32_t value)
@@ -614,8 +606,11 @@ void  hsStream::WriteLE32(uint32_t value)
 
 void  hsStream::WriteLE32(int count, const uint32_t values[])
 {
-    for (int i = 0; i < count; i++)
-        this->WriteLE32(values[i]);
+#if LITTLE_ENDIAN
+    this->Write(count * sizeof(uint32_t), values);
+#else
+    IWriteSwapped(this, values, count, sizeof(uint32_t));
+#endif
 }
 
 void hsStream::WriteBE32(uint32_t value)
@@ -632,8 +627,11 @@ void hsStream::WriteLEDouble(double value)
 
 void hsStream::WriteLEDouble(int count, const double values[])
 {
-    for (int i = 0; i < count; i++)
-        this->WriteLEDouble(values[i]);
+#if LITTLE_ENDIAN
+    this->Write(count * sizeof(double), values);
+#else
+    IWriteSwapped(this, values, count, sizeof(double));
+#endif
 }
 
 void hsStream::WriteLEFloat(float value)
@@ -644,8 +642,11 @@ void hsStream::WriteLEFloat(float value)
 
 void hsStream::WriteLEFloat(int count, const float values[])
 {
-    for (int i = 0; i < count; i++)
-        this->WriteLEFloat(values[i]);
+#if LITTLE_ENDIAN
+    this->Write(count * sizeof(float), values);
+#else
+    IWriteSwapped(this, values, count, sizeof(float));
+#endif
 }
 
 void hsStream::WriteBEFloat(float value)
@@ -1128,19 +1129,19 @@ void hsNullStream::Truncate()
 
 bool hsReadOnlyStream::AtEnd()
 {
-    return fData >= fStop;
+    return fReadWindow >= fStop;
 }
 
 uint32_t hsReadOnlyStream::Read(uint32_t byteCount, void* buffer)
 {
-    if (fData + byteCount > fStop)
+    if (fReadWindow + byteCount > fStop)
     {
         hsThrow("Attempting to read past end of stream");
         byteCount = GetSizeLeft();
     }
 
-    HSMemory::BlockMove(fData, buffer, byteCount);
-    fData += byteCount;
+    HSMemory::BlockMove(fReadWindow, buffer, byteCount);
+    fReadWindow += byteCount;
     fBytesRead += byteCount;
     fPosition += byteCount;
     return byteCount;
@@ -1156,8 +1157,8 @@ void hsReadOnlyStream::Skip(uint32_t deltaByteCount)
 {
     fBytesRead += deltaByteCount;
     fPosition += deltaByteCount;
-    fData += deltaByteCount;
-    if (fData > fStop)
+    fReadWindow += deltaByteCount;
+    if (fReadWindow > fStop)
         hsThrow( "Skip went past end of stream");
 }
 
@@ -1165,7 +1166,7 @@ void hsReadOnlyStream::Rewind()
 {
     fBytesRead = 0;
     fPosition = 0;
-    fData = fStart;
+    fReadWindow = fStart;
 }
 
 void hsReadOnlyStream::Truncate()
@@ -1175,8 +1176,8 @@ void hsReadOnlyStream::Truncate()
 
 void hsReadOnlyStream::CopyToMem(void* mem)
 {
-    if (fData < fStop)
-        HSMemory::BlockMove(fData, mem, fStop-fData);
+    if (fReadWindow < fStop)
+        HSMemory::BlockMove(fReadWindow, mem, fStop-fReadWindow);
 }
 
 
@@ -1189,10 +1190,10 @@ uint32_t hsWriteOnlyStream::Read(uint32_t byteCount, void* buffer)
 
 uint32_t hsWriteOnlyStream::Write(uint32_t byteCount, const void* buffer)
 {
-    if (fData + byteCount > fStop)
+    if (fReadWindow + byteCount > fStop)
         hsThrow("Write past end of stream");
-    HSMemory::BlockMove(buffer, fData, byteCount);
-    fData += byteCount;
+    HSMemory::BlockMove(buffer, (char*)fReadWindow, byteCount);
+    fReadWindow += byteCount;
     fBytesRead += byteCount;
     fPosition += byteCount;
     return byteCount;
@@ -1388,6 +1389,8 @@ bool hsBufferedStream::Close()
     if (fRef)
         rtn = fclose(fRef);
     fRef = nil;
+    fBufferLen = 0;
+    IUpdateReadWindow();
 
 #ifdef LOG_BUFFERED
     hsUNIXStream s;
@@ -1433,6 +1436,25 @@ void hsBufferedStream::SetFileRef(FILE* ref)
     fBufferLen = 0;
     fPosition = 0;
     fWriteBufferUsed = false;
+    IUpdateReadWindow();
+}
+
+// Expose what's left of the buffered block, minus its last byte. Read is
+// what notices a block has been used up and marks the buffer empty, so the
+// inline reads must never be the ones to finish it.
+void hsBufferedStream::IUpdateReadWindow()
+{
+    if (fBufferLen > 0 && !fWriteBufferUsed)
+    {
+        uint32_t bufferPos = fPosition % kBufferSize;
+        if (bufferPos + 1 < fBufferLen)
+        {
+            fReadWindow = &fBuffer[bufferPos];
+            fReadWindowEnd = &fBuffer[fBufferLen - 1];
+            return;
+        }
+    }
+    fReadWindow = fReadWindowEnd = nil;
 }
 
 uint32_t hsBufferedStream::Read(uint32_t bytes, void* buffer)
@@ -1507,6 +1529,7 @@ uint32_t hsBufferedStream::Read(uint32_t bytes, void* buffer)
         }
     }
 
+    IUpdateReadWindow();
     return numReadBytes;
 }
 
@@ -1514,6 +1537,7 @@ uint32_t hsBufferedStream::Write(uint32_t bytes, const void* buffer)
 {
     hsAssert(fRef, "fRef uninitialized");
     fWriteBufferUsed = true;
+    IUpdateReadWindow();
     int amtWritten = fwrite((void*)buffer, 1, bytes, fRef);
     fPosition += amtWritten;
     return amtWritten;
@@ -1566,6 +1590,7 @@ void hsBufferedStream::Skip(uint32_t delta)
     }
 
     fPosition += delta;
+    IUpdateReadWindow();
 }
 
 void hsBufferedStream::Rewind()
@@ -1580,6 +1605,7 @@ void hsBufferedStream::Rewind()
         fBufferLen = 0;
 
     fPosition = 0;
+    IUpdateReadWindow();
 }
 
 uint32_t hsBufferedStream::GetEOF()
@@ -78,9 +78,37 @@ protected:
     uint32_t      fBytesRead;
     uint32_t      fPosition;
 
+    // Unread bytes at fPosition that the subclass already has in memory.
+    // The typed reads below copy straight out of this window and bump
+    // fPosition and fBytesRead themselves, so a subclass that sets it must
+    // either use fReadWindow as its cursor or keep its cursor in fPosition.
+    // Streams that need to see every read (loggers, write-only streams)
+    // just leave it empty.
+    const char*   fReadWindow;
+    const char*   fReadWindowEnd;
+
     bool      IsTokenSeparator(char c);
+
+    bool IReadWindow(uint32_t byteCount, void* buffer)
+    {
+        if (fReadWindowEnd - fReadWindow < (ptrdiff_t)byteCount)
+            return false;
+        memcpy(buffer, fReadWindow, byteCount);
+        fReadWindow += byteCount;
+        fPosition += byteCount;
+        fBytesRead += byteCount;
+        return true;
+    }
+    uint8_t IReadUInt8()
+    {
+        uint8_t value;
+        if (!IReadWindow(sizeof(uint8_t), &value))
+            value = this->ReadByte();
+        return value;
+    }
+
 public:
-                hsStream() : fBytesRead(0), fPosition(0) {}
+                hsStream() : fBytesRead(0), fPosition(0), fReadWindow(nil), fReadWindowEnd(nil) {}
     virtual     ~hsStream();
 
     virtual bool      Open(const char *, const char * = "rb")=0;
@@ -120,6 +148,15 @@ public:
 
     virtual uint32_t  GetEOF();
     uint32_t          GetSizeLeft();
+
+    // Contiguous bytes at the current position the stream already holds in
+    // memory, or 0 if it has none. Bulk parsers can work straight out of
+    // them and Skip past what they consumed.
+    uint32_t          GetReadWindow(const void** data) const
+                      {
+                          *data = fReadWindow;
+                          return fReadWindowEnd > fReadWindow ? uint32_t(fReadWindowEnd - fReadWindow) : 0;
+                      }
     virtual void      CopyToMem(void* mem);
     virtual bool      IsCompressed() { return false; }
 
@@ -147,13 +184,31 @@ public:
     // Reads a 4-byte BOOLean
     bool            ReadBOOL();
     // Reads a 1-byte boolean
-    bool            ReadBool();
+    bool            ReadBool() { return IReadUInt8() != 0; }
     void            ReadBool(int count, bool values[]);
-    uint16_t        ReadLE16();
+    uint16_t        ReadLE16()
+                    {
+                        uint16_t value;
+                        if (!IReadWindow(sizeof(uint16_t), &value))
+                            this->Read(sizeof(uint16_t), &value);
+                        return hsToLE16(value);
+                    }
     void            ReadLE16(int count, uint16_t values[]);
-    uint32_t        ReadLE32();
+    uint32_t        ReadLE32()
+                    {
+                        uint32_t value;
+                        if (!IReadWindow(sizeof(uint32_t), &value))
+                            Read4Bytes(&value);
+                        return hsToLE32(value);
+                    }
     void            ReadLE32(int count, uint32_t values[]);
-    uint32_t        ReadBE32();
+    uint32_t        ReadBE32()
+                    {
+                        uint32_t value;
+                        if (!IReadWindow(sizeof(uint32_t), &value))
+                            Read4Bytes(&value);
+                        return hsToBE32(value);
+                    }
 
     void            WriteBOOL(bool value);
     void            WriteBool(bool value);
@@ -168,8 +223,8 @@ public:
 
     /* Overloaded  Begin (8 & 16 & 32 int)*/
     /* yes, swapping an 8 bit value does nothing, just useful*/
-    void            ReadLE(bool* value) { *value = this->ReadByte() ? true : false; }
-    void            ReadLE(uint8_t* value) { *value = this->ReadByte(); }
+    void            ReadLE(bool* value) { *value = this->IReadUInt8() ? true : false; }
+    void            ReadLE(uint8_t* value) { *value = this->IReadUInt8(); }
     void            ReadLE(int count, uint8_t values[]) { this->Read(count, values); }
     void            ReadLE(uint16_t* value) { *value = this->ReadLE16(); }
     void            ReadLE(int count, uint16_t values[]) { this->ReadLE16(count, values); }
@@ -193,9 +248,9 @@ public:
     void            WriteLE(int count, const uint16_t values[]) { this->WriteLE16(count, values); }
     void            WriteLE(uint32_t value) { this->WriteLE32(value); }
     void            WriteLE(int count, const  uint32_t values[]) { this->WriteLE32(count, values); }
-    void            ReadLE(int8_t* value) { *value = this->ReadByte(); }
+    void            ReadLE(int8_t* value) { *value = this->IReadUInt8(); }
     void            ReadLE(int count, int8_t values[]) { this->Read(count, values); }
-    void            ReadLE(char* value) { *value = (char)this->ReadByte(); }
+    void            ReadLE(char* value) { *value = (char)this->IReadUInt8(); }
     void            ReadLE(int count, char values[]) { this->Read(count, values); }
     void            ReadLE(int16_t* value) { *value = (int16_t)this->ReadLE16(); }
     void            ReadLE(int count, int16_t values[]) { this->ReadLE16(count, (uint16_t*)values); }
@@ -226,9 +281,21 @@ public:
     /* Overloaded  End */
 
 
-    float           ReadLEFloat();
+    float           ReadLEFloat()
+                    {
+                        float value;
+                        if (!IReadWindow(sizeof(float), &value))
+                            Read4Bytes(&value);
+                        return hsToLEFloat(value);
+                    }
     void            ReadLEFloat(int count, float values[]);
-    double          ReadLEDouble();
+    double          ReadLEDouble()
+                    {
+                        double value;
+                        if (!IReadWindow(sizeof(double), &value))
+                            Read8Bytes(&value);
+                        return hsToLEDouble(value);
+                    }
     void            ReadLEDouble(int count, double values[]);
     float           ReadBEFloat();
     void            WriteLEFloat(float value);
@@ -411,16 +478,16 @@ public:
 };
 
 // read only mem stream
+// The read window is the cursor: fReadWindow walks from fStart to fStop.
 class hsReadOnlyStream : public hsStream {
 protected:
     char*   fStart;
-    char*   fData;
     char*   fStop;
 public:
     hsReadOnlyStream(int size, const void* data) { Init(size, data); }
     hsReadOnlyStream() {}
 
-    virtual void      Init(int size, const void* data) { fStart=((char*)data); fData=((char*)data); fStop=((char*)data + size); }
+    virtual void      Init(int size, const void* data) { fStart=((char*)data); fReadWindow=fStart; fStop=((char*)data + size); fReadWindowEnd=fStop; }
     virtual bool      Open(const char *, const char *)    { hsAssert(0, "hsReadOnlyStream::Open  NotImplemented"); return false; }
     virtual bool      Open(const wchar_t *, const wchar_t *)  { hsAssert(0, "hsReadOnlyStream::Open  NotImplemented"); return false; }
     virtual bool      Close() { hsAssert(0, "hsReadOnlyStream::Close  NotImplemented"); return false; }
@@ -436,11 +503,15 @@ public:
 };
 
 // write only mem stream
+// Shares the read-only stream's cursor, but with an empty read window so
+// reads still land in Read and throw.
 class hsWriteOnlyStream : public hsReadOnlyStream {
 public:
-    hsWriteOnlyStream(int size, const void* data) : hsReadOnlyStream(size, data) {}
+    hsWriteOnlyStream(int size, const void* data) : hsReadOnlyStream(size, data) { fReadWindowEnd = fStart; }
     hsWriteOnlyStream() {}
 
+    virtual void      Init(int size, const void* data) { hsReadOnlyStream::Init(size, data); fReadWindowEnd = fStart; }
+
     virtual bool      Open(const char *, const char *)    { hsAssert(0, "hsWriteOnlyStream::Open  NotImplemented"); return false; }
     virtual bool      Open(const wchar_t *, const wchar_t *)  { hsAssert(0, "hsWriteOnlyStream::Open  NotImplemented"); return false; }
     virtual bool      Close() { hsAssert(0, "hsWriteOnlyStream::Close  NotImplemented"); return false; }
@@ -493,6 +564,8 @@ class hsBufferedStream : public hsStream
 
     bool fWriteBufferUsed;
 
+    void IUpdateReadWindow();
+
 #ifdef HS_DEBUGGING
     // For doing statistics on how efficient we are
     int fBufferHits, fBufferMisses;
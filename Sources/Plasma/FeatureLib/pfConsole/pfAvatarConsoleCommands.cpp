@@ -89,6 +89,9 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plNetClient/plNetClientMgr.h"
 #include "plDrawable/plInstanceDrawInterface.h"
 #include "plDrawable/plDrawableSpans.h"
+#include "plDrawable/plMorphSequence.h"
+#include "plResMgr/plResManager.h"
+#include "plResMgr/plRegistryHelpers.h"
 
 #define PF_SANITY_CHECK( cond, msg ) { if( !( cond ) ) { PrintString( msg ); return; } }
 
@@ -904,6 +907,57 @@ PF_CONSOLE_CMD( Avatar_Warp, WarpToXYZ, "float x, float y, float z", "Warp our a
     plAvatarMgr::WarpPlayerToXYZ((float)params[0], (float)params[1], (float)params[2]);
 }
 
+PF_CONSOLE_CMD( Avatar, BenchmarkMorph, "...",
+                "Time the old per-array morph apply against the accumulate path on every active morph sequence, and check they match. Param is (optional) pass count" )
+{
+    int numPasses = ( numParams > 0 ) ? hsMaximum(1, (int)params[0]) : 20;
+
+    hsTArray<plKey> keys;
+    plKeyCollector collector( keys );
+    ((plResManager*)hsgResMgr::ResMgr())->IterateKeys( &collector );
+
+    int numSeqs = 0;
+    double totalOld = 0, totalNew = 0;
+    float worstPos = 0, worstNorm = 0;
+    int i;
+    for( i = 0; i < keys.GetCount(); i++ )
+    {
+        plMorphSequence* seq = plMorphSequence::ConvertNoRef( keys[i]->ObjectIsLoaded() );
+        if( !seq )
+            continue;
+
+        double oldSecs, newSecs;
+        float maxPosErr, maxNormErr;
+        uint32_t numVerts;
+        if( !seq->Benchmark(numPasses, oldSecs, newSecs, maxPosErr, maxNormErr, numVerts) )
+            continue;
+
+        PrintStringF(PrintString, "%s: %d verts, old %.3f ms, new %.3f ms, max pos err %g, max norm err %g",
+            keys[i]->GetName().c_str(), numVerts, oldSecs * 1.e3, newSecs * 1.e3, maxPosErr, maxNormErr);
+
+        numSeqs++;
+        totalOld += oldSecs;
+        totalNew += newSecs;
+        worstPos = hsMaximum(worstPos, maxPosErr);
+        worstNorm = hsMaximum(worstNorm, maxNormErr);
+    }
+
+    if( !numSeqs )
+    {
+        PrintString("No active morph sequences loaded");
+        return;
+    }
+    PrintStringF(PrintString, "%d sequences: old %.3f ms, new %.3f ms, max pos err %g, max norm err %g",
+        numSeqs, totalOld * 1.e3, totalNew * 1.e3, worstPos, worstNorm);
+}
+
+PF_CONSOLE_CMD( Avatar, MorphThreads, "int num",
+                "Extra threads to sum the morph layers of all avatars on, 0 to morph each one as it's applied" )
+{
+    plMorphSequence::SetNumThreads( (int)params[0] );
+    PrintStringF(PrintString, "Morphs summed on up to %d extra threads", plMorphSequence::GetNumThreads());
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////
 //
 // AG (Animation Graph)
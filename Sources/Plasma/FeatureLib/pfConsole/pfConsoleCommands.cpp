@@ -95,6 +95,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "pfConsole.h"
 #include "pfConsoleCore/pfConsoleContext.h"
 #include "plResMgr/plKeyFinder.h"
+#include "plResMgr/plRegistryHelpers.h"
+#include "plResMgr/plRegistryNode.h"
 #include "plModifier/plSimpleModifier.h"
 #include "plAvatar/plAvatarMgr.h"
 #include "plAvatar/plAvatarTasks.h"
@@ -466,6 +468,64 @@ PF_CONSOLE_BASE_CMD( ShowStatusLog, "string logName", "Advances the status log d
     plStatusLogMgr::GetInstance().SetCurrStatusLog( params[ 0 ] );
 }
 
+class plLogBenchThread : public hsThread
+{
+public:
+    plStatusLog*    fLog;
+    int             fId;
+    int             fNumLines;
+
+    virtual hsError Run()
+    {
+        int i;
+        for( i = 0; i < fNumLines; i++ )
+            fLog->AddLineF( "bench thread %d line %d", fId, i );
+        return hsOK;
+    }
+};
+
+PF_CONSOLE_BASE_CMD( BenchmarkLogging, "...", "Logs from several threads at once and reports lines per second. Params are (optional) thread count and lines per thread" )
+{
+    int numThreads = 4;
+    int numLines = 10000;
+    if( numParams > 0 )
+        numThreads = params[ 0 ];
+    if( numParams > 1 )
+        numLines = params[ 1 ];
+    if( numThreads < 1 )
+        numThreads = 1;
+
+    plStatusLog* log = plStatusLogMgr::GetInstance().CreateStatusLog( plStatusLogMgr::kDefaultNumLines, "LogBench.log",
+                                                                    plStatusLog::kFilledBackground | plStatusLog::kTimestamp | plStatusLog::kThreadID );
+
+    plLogBenchThread* threads = new plLogBenchThread[ numThreads ];
+
+    double start = hsTimer::GetSeconds();
+    int i;
+    for( i = 0; i < numThreads; i++ )
+    {
+        threads[ i ].fLog = log;
+        threads[ i ].fId = i;
+        threads[ i ].fNumLines = numLines;
+        threads[ i ].Start();
+    }
+    for( i = 0; i < numThreads; i++ )
+        threads[ i ].Stop();
+    double queued = hsTimer::GetSeconds() - start;
+
+    plStatusLogMgr::GetInstance().Flush();
+    double written = hsTimer::GetSeconds() - start;
+
+    delete [] threads;
+    delete log;
+
+    char str[ 256 ];
+    sprintf( str, "%d lines from %d threads: queued in %.1fms, on disk in %.1fms (%.0f lines/sec)",
+        numThreads * numLines, numThreads, queued * 1.e3, written * 1.e3,
+        written > 0 ? numThreads * numLines / written : 0. );
+    PrintString( str );
+}
+
 #endif // LIMIT_CONSOLE_COMMANDS
 
 
@@ -1350,6 +1410,626 @@ PF_CONSOLE_CMD( Graphics_Renderer, MaxCullNodes, "...", "Limit occluder processi
     PrintString( str );
 }
 
+PF_CONSOLE_CMD( Graphics_Renderer, OcclusionMode, "...", "Where occluders go: 0=nowhere, 1=cull tree, 2=occlusion buffer, 3=both" )
+{
+    hsAssert( pfConsole::GetPipeline() != nil, "Cannot use this command before pipeline initialization" );
+
+    static const char* modeNames[] = { "off", "cull tree", "occlusion buffer", "cull tree and occlusion buffer" };
+
+    if( numParams > 0 )
+    {
+        int mode = (int) params[0];
+        if( (mode < 0) || (mode >= plPipeline::kNumOcclusionModes) )
+        {
+            PrintString( "Occlusion mode must be 0-3." );
+            return;
+        }
+        pfConsole::GetPipeline()->SetOcclusionMode(mode);
+    }
+
+    char    str[ 256 ];
+    sprintf( str, "Occlusion now %s.", modeNames[ pfConsole::GetPipeline()->GetOcclusionMode() ] );
+    PrintString( str );
+}
+
+#include "plDrawable/plSpaceTree.h"
+#include "plDrawable/plSpaceTreeMaker.h"
+#include "plIntersect/plVolumeIsect.h"
+#include "plGLight/plLightInfo.h"
+#include "pnEncryption/plRandom.h"
+
+PF_CONSOLE_CMD( Graphics_Renderer, BenchmarkLightCache, "...",
+                "Time finding the spans lit by many lights, with and without the light caches. Params are (optional) number of spans, lights and frames" )
+{
+    int numLeaves = 4000;
+    int numLights = 400;
+    int numFrames = 100;
+    if( numParams > 0 )
+        numLeaves = hsMaximum(1, hsMinimum(16000, (int)params[0]));   // Tree nodes are int16_t indices
+    if( numParams > 1 )
+        numLights = hsMaximum(1, (int)params[1]);
+    if( numParams > 2 )
+        numFrames = hsMaximum(1, (int)params[2]);
+
+    // A flat 1000 foot square level, strewn with spans from 1 to 10 feet across.
+    const float kLevelSize = 1000.f;
+    plRandom rand(1);
+    plSpaceTreeMaker maker;
+    maker.Reset();
+    int i;
+    for( i = 0; i < numLeaves; i++ )
+    {
+        hsPoint3 pos(rand.RandRangeF(0, kLevelSize), rand.RandRangeF(0, kLevelSize), rand.RandRangeF(0, 50.f));
+        hsVector3 size(rand.RandRangeF(1.f, 10.f), rand.RandRangeF(1.f, 10.f), rand.RandRangeF(1.f, 10.f));
+        hsBounds3Ext bnd;
+        bnd.Reset(&pos);
+        pos += size;
+        bnd.Union(&pos);
+        maker.AddLeaf(bnd);
+    }
+    plSpaceTree* space = maker.MakeTree();
+    maker.Cleanup();
+
+    // Omnis and spots, 20 to 60 feet. Every 8th one moves each frame.
+    hsTArray<plVolumeIsect*> lights;
+    hsTArray<plLightAffectedCache> caches;
+    hsTArray<uint32_t> serials;
+    caches.SetCount(numLights);
+    serials.SetCount(numLights);
+    for( i = 0; i < numLights; i++ )
+    {
+        hsVector3 pos(rand.RandRangeF(0, kLevelSize), rand.RandRangeF(0, kLevelSize), rand.RandRangeF(10.f, 60.f));
+        hsMatrix44 l2w, w2l;
+        l2w.MakeTranslateMat(&pos);
+        l2w.GetInverse(&w2l);
+        if( i & 1 )
+        {
+            plConeIsect* cone = new plConeIsect;
+            cone->SetAngle(rand.RandRangeF(0.3f, 1.f));
+            cone->SetLength(rand.RandRangeF(20.f, 60.f));
+            cone->SetTransform(l2w, w2l);
+            lights.Append(cone);
+        }
+        else
+        {
+            plSphereIsect* sphere = new plSphereIsect;
+            sphere->SetRadius(rand.RandRangeF(20.f, 60.f));
+            sphere->SetTransform(l2w, w2l);
+            lights.Append(sphere);
+        }
+        serials[i] = 0;
+    }
+
+    // The view is a 300 foot sphere circling the level.
+    plSphereIsect view;
+    view.SetRadius(300.f);
+
+    hsTArray<int16_t> visList;
+    hsTArray<int16_t> oldList;
+    hsTArray<int16_t> newList;
+    hsBitVector cache;
+
+    double oldSecs = 0;
+    double newSecs = 0;
+    int mismatches = 0;
+    uint32_t numLit = 0;
+    int frame;
+    for( frame = 0; frame < numFrames; frame++ )
+    {
+        float ang = frame * 2.f * float(M_PI) / numFrames;
+        hsVector3 pos(kLevelSize * (0.5f + 0.3f * cos(ang)), kLevelSize * (0.5f + 0.3f * sin(ang)), 20.f);
+        hsMatrix44 v2w, w2v;
+        v2w.MakeTranslateMat(&pos);
+        v2w.GetInverse(&w2v);
+        view.SetTransform(v2w, w2v);
+        visList.SetCount(0);
+        space->HarvestLeaves(&view, visList);
+
+        for( i = 0; i < numLights; i += 8 )
+        {
+            hsVector3 pos(rand.RandRangeF(0, kLevelSize), rand.RandRangeF(0, kLevelSize), rand.RandRangeF(10.f, 60.f));
+            hsMatrix44 l2w, w2l;
+            l2w.MakeTranslateMat(&pos);
+            l2w.GetInverse(&w2l);
+            lights[i]->SetTransform(l2w, w2l);
+            serials[i]++;
+        }
+
+        int j;
+        for( j = 0; j < numLights; j++ )
+        {
+            double start = hsTimer::GetSeconds();
+            cache.Clear();
+            space->EnableLeaves(visList, cache);
+            oldList.SetCount(0);
+            space->HarvestEnabledLeaves(lights[j], cache, oldList);
+            oldSecs += hsTimer::GetSeconds() - start;
+        }
+
+        double start = hsTimer::GetSeconds();
+        cache.Clear();
+        space->EnableLeaves(visList, cache);
+        for( j = 0; j < numLights; j++ )
+        {
+            newList.SetCount(0);
+            caches[j].Harvest(space, lights[j], serials[j], visList, cache, newList);
+            numLit += newList.GetCount();
+        }
+        newSecs += hsTimer::GetSeconds() - start;
+
+        // Check against the plain walk, off the clock.
+        for( j = 0; j < numLights; j++ )
+        {
+            oldList.SetCount(0);
+            space->HarvestEnabledLeaves(lights[j], cache, oldList);
+            newList.SetCount(0);
+            caches[j].Harvest(space, lights[j], serials[j], visList, cache, newList);
+            if( (oldList.GetCount() != newList.GetCount())
+                || (oldList.GetCount() && memcmp(oldList.AcquireArray(), newList.AcquireArray(), oldList.GetCount() * sizeof(int16_t))) )
+                mismatches++;
+        }
+    }
+
+    PrintStringF(PrintString, "%d spans, %d lights, %d frames, %.1f lit spans per light per frame",
+        numLeaves, numLights, numFrames, float(numLit) / (numLights * numFrames));
+    PrintStringF(PrintString, "Tree walk per light: %.3f ms/frame", oldSecs * 1.e3 / numFrames);
+    PrintStringF(PrintString, "Light caches: %.3f ms/frame", newSecs * 1.e3 / numFrames);
+    PrintStringF(PrintString, "%d mismatched lists", mismatches);
+
+    for( i = 0; i < lights.GetCount(); i++ )
+        delete lights[i];
+    delete space;
+}
+
+#include "plDrawable/plClusterGroup.h"
+#include "plDrawable/plCluster.h"
+#include "plDrawable/plSpanTemplate.h"
+
+PF_CONSOLE_CMD( Graphics_Renderer, ClusterThreads, "int num", "Most threads to decode a cluster group's vertices on at load" )
+{
+    plClusterGroup::SetUnPackThreads( (int)params[0] );
+    PrintStringF(PrintString, "Unpacking clusters on up to %d threads", plClusterGroup::GetUnPackThreads());
+}
+
+PF_CONSOLE_CMD( Graphics_Renderer, BenchmarkClusters, "...",
+                "Time decoding every loaded cluster group, on one thread and on many, and report packed and unpacked sizes. Param is (optional) thread count" )
+{
+    int numThreads = ( numParams > 0 ) ? hsMaximum(1, (int)params[0]) : plClusterGroup::GetUnPackThreads();
+
+    hsTArray<plKey> keys;
+    plKeyCollector collector( keys );
+    ((plResManager*)hsgResMgr::ResMgr())->IterateKeys( &collector );
+
+    std::vector<plClusterUnPackJob> jobs;
+    std::vector<std::vector<uint8_t> > verts;
+    uint32_t numGroups = 0;
+    uint32_t numInsts = 0;
+    uint32_t packedBytes = 0;
+    uint32_t unpackedBytes = 0;
+    int i;
+    for( i = 0; i < keys.GetCount(); i++ )
+    {
+        plClusterGroup* group = plClusterGroup::ConvertNoRef( keys[i]->ObjectIsLoaded() );
+        if( !group || !group->GetTemplate() )
+            continue;
+        numGroups++;
+
+        const plSpanTemplate* templ = group->GetTemplate();
+        int j;
+        for( j = 0; j < group->GetNumClusters(); j++ )
+        {
+            const plCluster* cluster = group->GetCluster(j);
+            numInsts += cluster->NumInsts();
+            packedBytes += cluster->PackedSize();
+            unpackedBytes += cluster->NumInsts() * (templ->VertSize() + templ->IndexSize());
+
+            plClusterUnPackJob job;
+            job.fCluster = cluster;
+            verts.push_back(std::vector<uint8_t>(cluster->NumInsts() * templ->VertSize() + 1));
+            job.fVDst = &verts.back()[0];
+            jobs.push_back(job);
+        }
+    }
+    if( jobs.empty() )
+    {
+        PrintString("No cluster groups loaded");
+        return;
+    }
+    // The vectors may have moved as they were appended.
+    for( i = 0; i < jobs.size(); i++ )
+        jobs[i].fVDst = &verts[i][0];
+
+    double start = hsTimer::GetSeconds();
+    plCluster::UnPackJobs(&jobs[0], jobs.size(), 1);
+    double serialSecs = hsTimer::GetSeconds() - start;
+
+    start = hsTimer::GetSeconds();
+    plCluster::UnPackJobs(&jobs[0], jobs.size(), numThreads);
+    double threadedSecs = hsTimer::GetSeconds() - start;
+
+    PrintStringF(PrintString, "%d groups, %d clusters, %d instances", numGroups, (int)jobs.size(), numInsts);
+    PrintStringF(PrintString, "Decode: %.2f ms on 1 thread, %.2f ms on %d", serialSecs * 1.e3, threadedSecs * 1.e3, numThreads);
+    PrintStringF(PrintString, "Packed %d KB, unpacked %d KB", packedBytes / 1024, unpackedBytes / 1024);
+}
+
+#include "plPipeline/plGBufferGroup.h"
+#include "plPipeline/plVertCoder.h"
+
+PF_CONSOLE_CMD( Graphics_Renderer, BlockVertDecode, "bool on", "Decode page vertex buffers a channel at a time instead of a vertex at a time" )
+{
+    plVertCoder::SetBlockDecode( (bool)params[0] );
+    PrintStringF(PrintString, "Block vertex decoding %s", plVertCoder::GetBlockDecode() ? "on" : "off");
+}
+
+#include "plSoftwareSkin/plSoftwareSkin.h"
+
+PF_CONSOLE_CMD( Graphics_Renderer, SkinThreads, "int num", "Extra threads to software skin big spans on, 0 for none" )
+{
+    plSoftwareSkin::SetNumThreads( (int)params[0] );
+    PrintStringF(PrintString, "Software skinning on up to %d extra threads", plSoftwareSkin::GetNumThreads());
+}
+
+PF_CONSOLE_CMD( Graphics_Renderer, BenchmarkSkin, "...",
+                "Check the SSE1 software skinning against the FPU reference on random palettes, with max error and timings. Params are (optional) vert count, bone count and pass count" )
+{
+    int numVerts = ( numParams > 0 ) ? hsMaximum(1, (int)params[0]) : 8192;
+    int numBones = ( numParams > 1 ) ? hsMaximum(1, hsMinimum(256, (int)params[1])) : 64;
+    int numPasses = ( numParams > 2 ) ? hsMaximum(1, (int)params[2]) : 20;
+
+    // The avatar layout: 3 weights, packed indices, one uvw channel.
+    const uint8_t format = plGBufferGroup::kSkin3Weights | plGBufferGroup::kSkinIndices | plGBufferGroup::UVCountToFormat(1);
+    const uint32_t srcStride = sizeof(float) * (3 + 3 + 3 + 3) + sizeof(uint32_t) * 3;
+    const uint32_t dstStride = sizeof(float) * (3 + 3 + 3) + sizeof(uint32_t) * 2;
+
+    plRandom rand(1);
+
+    std::vector<hsMatrix44> palette(numBones);
+    int i;
+    for( i = 0; i < numBones; i++ )
+    {
+        hsMatrix44& xfm = palette[i];
+        int r, c;
+        for( r = 0; r < 3; r++ )
+        {
+            for( c = 0; c < 3; c++ )
+                xfm.fMap[r][c] = rand.RandMinusOneToOne();
+            xfm.fMap[r][3] = rand.RandRangeF(-100.f, 100.f);
+        }
+        xfm.fMap[3][0] = xfm.fMap[3][1] = xfm.fMap[3][2] = 0;
+        xfm.fMap[3][3] = 1.f;
+        xfm.NotIdentity();
+    }
+
+    std::vector<uint8_t> src(numVerts * srcStride);
+    for( i = 0; i < numVerts; i++ )
+    {
+        float* f = (float*)&src[i * srcStride];
+        *f++ = rand.RandRangeF(-10.f, 10.f);
+        *f++ = rand.RandRangeF(-10.f, 10.f);
+        *f++ = rand.RandRangeF(-10.f, 10.f);
+
+        // Weights summing to at most 1, the fourth is what's left over.
+        float w0 = rand.RandZeroToOne();
+        float w1 = rand.RandZeroToOne() * (1.f - w0);
+        float w2 = rand.RandZeroToOne() * (1.f - w0 - w1);
+        *f++ = w0;
+        *f++ = w1;
+        *f++ = w2;
+
+        uint32_t indices = 0;
+        int j;
+        for( j = 0; j < 4; j++ )
+            indices |= (uint32_t(rand.Rand()) % numBones) << (j * 8);
+        *(uint32_t*)f++ = indices;
+
+        hsVector3 norm(rand.RandMinusOneToOne(), rand.RandMinusOneToOne(), rand.RandMinusOneToOne());
+        norm.Normalize();
+        *f++ = norm.fX;
+        *f++ = norm.fY;
+        *f++ = norm.fZ;
+        *(uint32_t*)f++ = 0xffffffff;
+        *(uint32_t*)f++ = 0xff000000;
+        *f++ = rand.RandZeroToOne();
+        *f++ = rand.RandZeroToOne();
+        *f++ = 0;
+    }
+
+    std::vector<uint8_t> ref(numVerts * dstStride);
+    std::vector<uint8_t> out(numVerts * dstStride);
+
+    double start = hsTimer::GetSeconds();
+    for( i = 0; i < numPasses; i++ )
+        plSoftwareSkin::BlendVertsRef(&palette[0], numBones, &src[0], format, srcStride, &ref[0], dstStride, numVerts, 0);
+    double fpuSecs = (hsTimer::GetSeconds() - start) / numPasses;
+
+    PrintStringF(PrintString, "%d verts, %d bones: fpu %.3f ms", numVerts, numBones, fpuSecs * 1.e3);
+
+    if( !plSoftwareSkin::HasSSE1() )
+    {
+        PrintString("No SSE1 on this cpu, nothing to compare");
+        return;
+    }
+
+    start = hsTimer::GetSeconds();
+    for( i = 0; i < numPasses; i++ )
+        plSoftwareSkin::BlendVertsSSE1(&palette[0], numBones, &src[0], format, srcStride, &out[0], dstStride, numVerts, 0);
+    double sseSecs = (hsTimer::GetSeconds() - start) / numPasses;
+
+    float maxPosErr = 0;
+    float maxNormErr = 0;
+    for( i = 0; i < numVerts; i++ )
+    {
+        const float* a = (const float*)&ref[i * dstStride];
+        const float* b = (const float*)&out[i * dstStride];
+        int j;
+        for( j = 0; j < 3; j++ )
+        {
+            // Relative to the size of the result, since positions go out to a few hundred feet.
+            maxPosErr = hsMaximum(maxPosErr, fabsf(a[j] - b[j]) / hsMaximum(1.f, fabsf(a[j])));
+            maxNormErr = hsMaximum(maxNormErr, fabsf(a[j + 3] - b[j + 3]) / hsMaximum(1.f, fabsf(a[j + 3])));
+        }
+        if( memcmp(a + 6, b + 6, dstStride - sizeof(float) * 6) )
+            maxNormErr = 1.e30f;    // colors or uvws got mangled
+    }
+
+    // Threaded goes through the dispatcher, so on this cpu it should match sse1 exactly.
+    std::vector<uint8_t> sseOut(out);
+    start = hsTimer::GetSeconds();
+    for( i = 0; i < numPasses; i++ )
+        plSoftwareSkin::BlendVertsThreaded(&palette[0], numBones, &src[0], format, srcStride, &out[0], dstStride, numVerts, 0);
+    double threadedSecs = (hsTimer::GetSeconds() - start) / numPasses;
+
+    PrintStringF(PrintString, "sse1 %.3f ms, threaded (%d extra) %.3f ms, %s", sseSecs * 1.e3,
+        plSoftwareSkin::GetNumThreads(), threadedSecs * 1.e3, out == sseOut ? "same output" : "OUTPUT DIFFERS");
+    PrintStringF(PrintString, "max relative error vs fpu: position %g, normal %g", maxPosErr, maxNormErr);
+}
+
+PF_CONSOLE_CMD( Graphics_Renderer, BenchmarkVertCoder, "...",
+                "Re-encode every loaded page vertex buffer and time decoding it per vertex and in blocks. Param is (optional) pass count" )
+{
+    int numPasses = ( numParams > 0 ) ? hsMaximum(1, (int)params[0]) : 5;
+
+    hsTArray<plKey> keys;
+    plKeyCollector collector( keys );
+    ((plResManager*)hsgResMgr::ResMgr())->IterateKeys( &collector );
+
+    class Buffer
+    {
+    public:
+        uint8_t     fFormat;
+        uint32_t    fStride;
+        uint16_t    fNumVerts;
+        uint32_t    fCodedStart;
+        uint32_t    fCodedLen;
+    };
+    std::vector<Buffer> buffers;
+    hsRAMStream ram;
+    uint32_t rawBytes = 0;
+    int i;
+    for( i = 0; i < keys.GetCount(); i++ )
+    {
+        plDrawableSpans* drawable = plDrawableSpans::ConvertNoRef( keys[i]->ObjectIsLoaded() );
+        if( !drawable )
+            continue;
+
+        int j;
+        for( j = 0; j < drawable->GetNumBufferGroups(); j++ )
+        {
+            plGBufferGroup* group = drawable->GetBufferGroup(j);
+            if( !(group->GetVertexFormat() & plGBufferGroup::kEncoded) )
+                continue;
+
+            int k;
+            for( k = 0; k < group->GetNumVertexBuffers(); k++ )
+            {
+                if( group->GetNumCells(k) != 1 )
+                    continue;
+
+                Buffer buff;
+                buff.fFormat = group->GetVertexFormat();
+                buff.fStride = group->GetVertexSize();
+                buff.fNumVerts = (uint16_t)(group->GetVertBufferSize(k) / buff.fStride);
+                buff.fCodedStart = ram.GetPosition();
+
+                plVertCoder coder;
+                coder.Write(&ram, group->GetVertBufferData(k), buff.fFormat, buff.fStride, buff.fNumVerts);
+
+                buff.fCodedLen = ram.GetPosition() - buff.fCodedStart;
+                buffers.push_back(buff);
+                rawBytes += buff.fNumVerts * buff.fStride;
+            }
+        }
+    }
+    if( !rawBytes )
+    {
+        PrintString("No encoded vertex buffers loaded");
+        return;
+    }
+
+    std::vector<uint8_t> coded(ram.GetEOF());
+    ram.Rewind();
+    ram.CopyToMem(&coded[0]);
+
+    std::vector<uint8_t> perVert(rawBytes);
+    std::vector<uint8_t> block(rawBytes);
+    double perVertSecs = 1.e33;
+    double blockSecs = 1.e33;
+    plVertCoder coder;
+    int pass;
+    for( pass = 0; pass < numPasses; pass++ )
+    {
+        hsReadOnlyStream s(coded.size(), &coded[0]);
+        uint8_t* dst = &perVert[0];
+        double start = hsTimer::GetSeconds();
+        for( i = 0; i < buffers.size(); i++ )
+        {
+            coder.ReadPerVertex(&s, dst, buffers[i].fFormat, buffers[i].fStride, buffers[i].fNumVerts);
+            dst += buffers[i].fNumVerts * buffers[i].fStride;
+        }
+        perVertSecs = hsMinimum(perVertSecs, hsTimer::GetSeconds() - start);
+
+        bool wasBlock = plVertCoder::GetBlockDecode();
+        plVertCoder::SetBlockDecode(true);
+        s.Rewind();
+        dst = &block[0];
+        start = hsTimer::GetSeconds();
+        for( i = 0; i < buffers.size(); i++ )
+        {
+            coder.Read(&s, dst, buffers[i].fFormat, buffers[i].fStride, buffers[i].fNumVerts);
+            dst += buffers[i].fNumVerts * buffers[i].fStride;
+        }
+        blockSecs = hsMinimum(blockSecs, hsTimer::GetSeconds() - start);
+        plVertCoder::SetBlockDecode(wasBlock);
+    }
+
+    PrintStringF(PrintString, "%d vertex buffers, %d KB coded, %d KB decoded", (int)buffers.size(), (int)coded.size() / 1024, rawBytes / 1024);
+    PrintStringF(PrintString, "Decode: %.2f ms per vertex, %.2f ms in blocks (best of %d)", perVertSecs * 1.e3, blockSecs * 1.e3, numPasses);
+    PrintStringF(PrintString, "Results %s", memcmp(&perVert[0], &block[0], rawBytes) ? "DIFFER" : "match");
+}
+
+#include "plIntersect/plSoftVolumeTypes.h"
+
+PF_CONSOLE_CMD( Graphics_Renderer, SoftVolumeCache, "bool on", "Cache soft volume strengths until some volume changes" )
+{
+    plSoftVolume::SetUseCache( (bool)params[0] );
+    PrintStringF(PrintString, "Soft volume cache %s", plSoftVolume::GetUseCache() ? "on" : "off");
+}
+
+// Builds a soft volume tree depth levels deep, cycling through union, intersect and
+// invert nodes over sphere and box leaves scattered through a 100 foot cube.
+static plSoftVolume* IMakeBenchSoftVolume(plRandom& rand, int depth, int fanOut, hsTArray<plSoftVolume*>& made)
+{
+    plSoftVolume* vol = nil;
+    if( !depth )
+    {
+        plSoftVolumeSimple* simple = new plSoftVolumeSimple;
+        hsPoint3 center(rand.RandRangeF(0, 100.f), rand.RandRangeF(0, 100.f), rand.RandRangeF(0, 100.f));
+        float size = rand.RandRangeF(10.f, 40.f);
+        if( rand.Rand() & 1 )
+        {
+            plSphereIsect* sphere = new plSphereIsect;
+            sphere->SetCenter(center);
+            sphere->SetRadius(size);
+            simple->SetVolume(sphere);
+        }
+        else
+        {
+            plConvexIsect* box = new plConvexIsect;
+            int i;
+            for( i = 0; i < 3; i++ )
+            {
+                hsVector3 norm(0, 0, 0);
+                norm[i] = 1.f;
+                box->AddPlaneUnchecked(norm, center[i] + size);
+                norm[i] = -1.f;
+                box->AddPlaneUnchecked(norm, -center[i] + size);
+            }
+            simple->SetVolume(box);
+        }
+        simple->SetDistance(rand.RandRangeF(1.f, 10.f));
+        hsMatrix44 ident;
+        ident.Reset();
+        simple->SetTransform(ident, ident);
+        vol = simple;
+    }
+    else
+    {
+        plSoftVolumeComplex* complex = nil;
+        int numSubs = fanOut;
+        switch( depth % 3 )
+        {
+        case 0:
+            complex = new plSoftVolumeUnion;
+            break;
+        case 1:
+            complex = new plSoftVolumeIntersect;
+            break;
+        case 2:
+            complex = new plSoftVolumeInvert;
+            numSubs = 1;
+            break;
+        }
+        int i;
+        for( i = 0; i < numSubs; i++ )
+        {
+            plGenRefMsg* refMsg = new plGenRefMsg(nil, plRefMsg::kOnCreate, 0, plSoftVolume::kSubVolume);
+            refMsg->SetRef(IMakeBenchSoftVolume(rand, depth - 1, fanOut, made));
+            complex->MsgReceive(refMsg);
+            hsRefCnt_SafeUnRef(refMsg);
+        }
+        vol = complex;
+    }
+    made.Append(vol);
+    return vol;
+}
+
+PF_CONSOLE_CMD( Graphics_Renderer, BenchmarkSoftVolumes, "...",
+                "Time evaluating a nested soft volume tree one point at a time, batched, and again from the cache. Params are (optional) depth, fan out and number of points" )
+{
+    int depth = 4;
+    int fanOut = 3;
+    int numPoints = 4096;
+    if( numParams > 0 )
+        depth = hsMaximum(0, hsMinimum(8, (int)params[0]));
+    if( numParams > 1 )
+        fanOut = hsMaximum(1, hsMinimum(8, (int)params[1]));
+    if( numParams > 2 )
+        numPoints = hsMaximum(1, (int)params[2]);
+
+    plRandom rand(1);
+    hsTArray<plSoftVolume*> made;
+    plSoftVolume* root = IMakeBenchSoftVolume(rand, depth, fanOut, made);
+
+    std::vector<hsPoint3> pos(numPoints);
+    int i;
+    for( i = 0; i < numPoints; i++ )
+        pos[i].Set(rand.RandRangeF(0, 100.f), rand.RandRangeF(0, 100.f), rand.RandRangeF(0, 100.f));
+
+    std::vector<float> single(numPoints);
+    std::vector<float> batched(numPoints);
+    std::vector<float> cached(numPoints);
+
+    bool wasCaching = plSoftVolume::GetUseCache();
+    plSoftVolume::SetUseCache(false);
+    double start = hsTimer::GetSeconds();
+    for( i = 0; i < numPoints; i++ )
+        single[i] = root->GetStrength(pos[i]);
+    double singleSecs = hsTimer::GetSeconds() - start;
+
+    start = hsTimer::GetSeconds();
+    root->GetStrengths(&pos[0], numPoints, &batched[0]);
+    double batchSecs = hsTimer::GetSeconds() - start;
+
+    // The way the pipeline lights spans: a chunk cached in one batch, then each point
+    // asked for on its own, and asked again by a second render pass.
+    plSoftVolume::SetUseCache(true);
+    const int kChunk = 32;
+    start = hsTimer::GetSeconds();
+    for( i = 0; i < numPoints; i += kChunk )
+    {
+        const int cnt = hsMinimum(kChunk, numPoints - i);
+        root->CacheStrengths(&pos[i], cnt);
+        int pass;
+        for( pass = 0; pass < 2; pass++ )
+        {
+            int j;
+            for( j = i; j < i + cnt; j++ )
+                cached[j] = root->GetStrength(pos[j]);
+        }
+    }
+    double cachedSecs = hsTimer::GetSeconds() - start;
+    plSoftVolume::SetUseCache(wasCaching);
+
+    for( i = 0; i < made.GetCount(); i++ )
+        delete made[i];
+
+    PrintStringF(PrintString, "%d volumes, %d points", made.GetCount(), numPoints);
+    PrintStringF(PrintString, "One at a time %.3f ms, batched %.3f ms, batched and queried twice from the cache %.3f ms",
+        singleSecs * 1.e3, batchSecs * 1.e3, cachedSecs * 1.e3);
+    PrintStringF(PrintString, "Results %s", memcmp(&single[0], &batched[0], numPoints * sizeof(float))
+        || memcmp(&single[0], &cached[0], numPoints * sizeof(float)) ? "DIFFER" : "match");
+}
+
 
 #endif // LIMIT_CONSOLE_COMMANDS
 
@@ -2799,6 +3479,159 @@ PF_CONSOLE_CMD(Registry, LogReadTimes, "", "Dumps the time for each object read
     ((plResManager*)hsgResMgr::ResMgr())->LogReadTimes(true);
 }
 
+class plUoidCollector : public plRegistryKeyIterator
+{
+public:
+    std::vector<plUoid> fUoids;
+
+    virtual bool EatKey(const plKey& key)
+    {
+        fUoids.push_back(key->GetUoid());
+        return true;
+    }
+};
+
+PF_CONSOLE_CMD( Registry, BenchmarkFindKey, "", "Times FindKey by uoid and by name over every registered key and reports key name storage" )
+{
+    plResManager* resMgr = (plResManager*)hsgResMgr::ResMgr();
+
+    plUoidCollector collector;
+    resMgr->IterateKeys(&collector);
+    int numKeys = collector.fUoids.size();
+
+    // Names copied per uoid, as each uoid carried its own string before interning
+    uint32_t perUoidBytes = 0;
+    int i;
+    for( i = 0; i < numKeys; i++ )
+        perUoidBytes += collector.fUoids[ i ].GetObjectName().GetSize() + 1;
+
+    double start = hsTimer::GetSeconds();
+    int found = 0;
+    for( i = 0; i < numKeys; i++ )
+    {
+        if( resMgr->FindKey( collector.fUoids[ i ] ) )
+            found++;
+    }
+    double byUoid = hsTimer::GetSeconds() - start;
+
+    // Without an object id the registry has to search by name
+    start = hsTimer::GetSeconds();
+    int foundByName = 0;
+    for( i = 0; i < numKeys; i++ )
+    {
+        const plUoid& u = collector.fUoids[ i ];
+        if( resMgr->FindKey( plUoid( u.GetLocation(), u.GetClassType(), u.GetObjectName(), u.GetLoadMask() ) ) )
+            foundByName++;
+    }
+    double byName = hsTimer::GetSeconds() - start;
+
+    PrintStringF( PrintString, "%d keys: FindKey by uoid %.2fms (%d found), by name %.2fms (%d found)",
+        numKeys, byUoid * 1.e3, found, byName * 1.e3, foundByName );
+    PrintStringF( PrintString, "%d interned names in %d bytes, %d bytes if each key held its own name",
+        plKeyNameTable::GetNumNames(), plKeyNameTable::GetMemUsed(), perUoidBytes );
+}
+
+// Stream that never exposes a read window, so every typed read takes the
+// virtual path the way it did before the window existed
+class plNoWindowReadStream : public hsReadOnlyStream
+{
+public:
+    virtual void Init(uint32_t size, const void* data)
+    {
+        hsReadOnlyStream::Init(size, data);
+        fReadWindowEnd = fStart;
+    }
+};
+
+static uint32_t IParseObjectData(hsStream* s)
+{
+    // Roughly the mix of reads an object's Read() does; the values are
+    // garbage, we only care about the cost of getting them
+    uint32_t sum = 0;
+    while( s->GetSizeLeft() >= 16 )
+    {
+        sum += s->ReadLE16();
+        sum += s->ReadLE32();
+        sum += s->ReadByte();
+        sum += (uint32_t)s->ReadLEFloat();
+        sum += s->ReadBool();
+        sum += s->ReadLE32();
+        sum += s->ReadByte();
+        sum += s->ReadLE16();
+    }
+    return sum;
+}
+
+PF_CONSOLE_CMD( Registry, BenchmarkRead, "...", "Reads every object in the loaded pages into memory and times parsing them "
+               "with and without the stream read window. Param is (optional) pass count" )
+{
+    int passes = ( numParams > 0 ) ? (int)params[ 0 ] : 10;
+
+    plResManager* resMgr = (plResManager*)hsgResMgr::ResMgr();
+
+    hsTArray<plKey> keys;
+    plKeyCollector collector( keys );
+    resMgr->IterateKeys( &collector );
+
+    std::vector<std::vector<uint8_t> > objects;
+    uint32_t totalBytes = 0;
+    int i;
+    for( i = 0; i < keys.GetCount(); i++ )
+    {
+        plKeyImp* imp = (plKeyImp*)keys[ i ];
+        if( imp->GetDataLen() == 0 )
+            continue;
+
+        plRegistryPageNode* page = resMgr->FindPage( imp->GetUoid().GetLocation() );
+        if( page == nil )
+            continue;
+
+        hsStream* stream = page->OpenStream();
+        if( stream == nil )
+            continue;
+
+        objects.push_back( std::vector<uint8_t>( imp->GetDataLen() ) );
+        stream->SetPosition( imp->GetStartPos() );
+        stream->Read( imp->GetDataLen(), &objects.back()[ 0 ] );
+        page->CloseStream();
+
+        totalBytes += imp->GetDataLen();
+    }
+
+    uint32_t sum = 0;
+    hsReadOnlyStream windowed;
+    double start = hsTimer::GetSeconds();
+    int p;
+    for( p = 0; p < passes; p++ )
+    {
+        for( i = 0; i < objects.size(); i++ )
+        {
+            windowed.Init( objects[ i ].size(), &objects[ i ][ 0 ] );
+            sum += IParseObjectData( &windowed );
+        }
+    }
+    double withWindow = hsTimer::GetSeconds() - start;
+
+    plNoWindowReadStream virt;
+    start = hsTimer::GetSeconds();
+    for( p = 0; p < passes; p++ )
+    {
+        for( i = 0; i < objects.size(); i++ )
+        {
+            virt.Init( objects[ i ].size(), &objects[ i ][ 0 ] );
+            sum -= IParseObjectData( &virt );
+        }
+    }
+    double withoutWindow = hsTimer::GetSeconds() - start;
+
+    double mb = double( totalBytes ) * passes / ( 1024. * 1024. );
+    PrintStringF( PrintString, "%d objects, %d bytes, %d passes", objects.size(), totalBytes, passes );
+    PrintStringF( PrintString, "Read window: %.2fms (%.1f MB/s), virtual reads: %.2fms (%.1f MB/s)%s",
+        withWindow * 1.e3, withWindow > 0 ? mb / withWindow : 0.,
+        withoutWindow * 1.e3, withoutWindow > 0 ? mb / withoutWindow : 0.,
+        sum != 0 ? " MISMATCH" : "" );
+}
+
 #endif // LIMIT_CONSOLE_COMMANDS
 
 
@@ -4682,6 +5515,66 @@ PF_CONSOLE_CMD( Access,
 
 }
 
+PF_CONSOLE_CMD( Access,
+                    LOSBench,
+                    "...",
+                    "Fire a grid of LOS rays through the screen, singly and batched, and report timings. Params are (optional) grid size and distance" )
+{
+    int gridSize = 64;
+    float dist = 1.e5f;
+    if( numParams > 0 )
+        gridSize = params[0];
+    if( numParams > 1 )
+        dist = params[1];
+    if( gridSize < 1 )
+        gridSize = 1;
+
+    plPipeline* pipe = pfConsole::GetPipeline();
+    const int numRays = gridSize * gridSize;
+
+    std::vector<int32_t> sx(numRays);
+    std::vector<int32_t> sy(numRays);
+    int i, j;
+    for( j = 0; j < gridSize; j++ )
+    {
+        for( i = 0; i < gridSize; i++ )
+        {
+            sx[j * gridSize + i] = int32_t((i + 0.5f) * pipe->Width() / gridSize);
+            sy[j * gridSize + i] = int32_t((j + 0.5f) * pipe->Height() / gridSize);
+        }
+    }
+
+    std::vector<hsPoint3> from(numRays, pipe->GetViewPositionWorld());
+    std::vector<hsPoint3> targ(numRays);
+    pipe->ScreenToWorldPoint(numRays, sizeof(int32_t), &sx[0], &sy[0], dist, sizeof(hsPoint3), &targ[0]);
+
+    std::vector<plVisHit> hits(numRays);
+    bool* isHit = new bool[numRays];
+
+    // Both passes start with a cold triangle cache, so they pay the same fetch costs.
+    plVisLOSMgr::Instance()->FlushCache();
+    double start = hsTimer::GetSeconds();
+    int numSingle = 0;
+    for( i = 0; i < numRays; i++ )
+    {
+        if( plVisLOSMgr::Instance()->Check(from[i], targ[i], hits[i]) )
+            numSingle++;
+    }
+    double single = hsTimer::GetSeconds() - start;
+
+    plVisLOSMgr::Instance()->FlushCache();
+    start = hsTimer::GetSeconds();
+    int numBatch = plVisLOSMgr::Instance()->CheckBatch(&from[0], &targ[0], &hits[0], isHit, numRays);
+    double batch = hsTimer::GetSeconds() - start;
+
+    delete [] isHit;
+
+    char buff[256];
+    sprintf(buff, "%d rays: single %.2fms (%d hits), batched %.2fms (%d hits)",
+        numRays, single * 1.e3, numSingle, batch * 1.e3, numBatch);
+    PrintString(buff);
+}
+
 #include "plMessage/plBulletMsg.h"
 
 plSceneObject* gunObj = nil;
@@ -5265,6 +6158,18 @@ PF_CONSOLE_CMD( Wave, Graph,    // Group name, Function name
     }
 }
 
+PF_CONSOLE_CMD( Wave, ThreadedUpdate, "bool on", "Run the per frame wave state updates on the wave update thread" )
+{
+    plWaveSet7::SetThreadedUpdate( (bool)params[0] );
+    PrintStringF(PrintString, "Threaded wave update %s", plWaveSet7::GetThreadedUpdate() ? "on" : "off");
+}
+
+PF_CONSOLE_CMD( Wave, CacheShoreTex, "bool on", "Keep generated shore textures around for the next age load" )
+{
+    plWaveSet7::SetCacheShoreTex( (bool)params[0] );
+    PrintStringF(PrintString, "Shore texture cache %s", plWaveSet7::GetCacheShoreTex() ? "on" : "off");
+}
+
 // Geometric wave param block 
 PF_CONSOLE_CMD( Wave_Set, GeoLen,   // Group name, Function name
                 "string waveSet, ...",          // Params none
@@ -6653,6 +7558,74 @@ PF_CONSOLE_CMD( Animation,
     PrintString(buff);
 }
 
+#include "plAvatar/plAGCompiledGraph.h"
+#include "plAvatar/plArmatureMod.h"
+
+PF_CONSOLE_CMD( Animation,
+               UseCompiledGraph,
+               "bool on",
+               "Evaluate transform channels through the flattened per-avatar graph instead of the channel tree" )
+{
+    plAGMasterMod::fUseCompiledGraph = (bool)params[0];
+    PrintStringF(PrintString, "Compiled animation graph is now %s", plAGMasterMod::fUseCompiledGraph ? "ON" : "OFF");
+}
+
+PF_CONSOLE_CMD( Animation,
+               GraphThreads,
+               "int num",
+               "Extra threads to evaluate the compiled graphs of all avatars on, 0 to evaluate each one as it's applied" )
+{
+    plAGCompiledGraph::SetNumThreads((int)params[0]);
+    PrintStringF(PrintString, "Compiled graphs evaluated on up to %d extra threads", plAGCompiledGraph::GetNumThreads());
+}
+
+PF_CONSOLE_CMD( Animation,
+               BenchmarkGraph,
+               "...",
+               "Times the local avatar's transform evaluation through the channel tree and the compiled graph. Param is (optional) iteration count" )
+{
+    plArmatureMod *avMod = plAvatarMgr::GetInstance()->GetLocalAvatar();
+    if (!avMod)
+    {
+        PrintString("No local avatar");
+        return;
+    }
+
+    int iterations = (numParams > 0) ? (int)params[0] : 200;
+    if (iterations < 1)
+        iterations = 1;
+
+    bool wasCompiled = plAGMasterMod::fUseCompiledGraph;
+    double time = hsTimer::GetSysSeconds();
+
+    plAGMasterMod::fUseCompiledGraph = false;
+    double start = hsTimer::GetSeconds();
+    int i;
+    for (i = 0; i < iterations; i++)
+        avMod->AdvanceAnimsToTime(time);
+    double tree = hsTimer::GetSeconds() - start;
+
+    plAGMasterMod::fUseCompiledGraph = true;
+    avMod->AdvanceAnimsToTime(time);    // build outside the timing
+    start = hsTimer::GetSeconds();
+    for (i = 0; i < iterations; i++)
+        avMod->AdvanceAnimsToTime(time);
+    double compiled = hsTimer::GetSeconds() - start;
+
+    plAGMasterMod::fUseCompiledGraph = wasCompiled;
+
+    PrintStringF(PrintString, "%d evals: channel tree %.3fms/eval, compiled %.3fms/eval",
+        iterations, tree * 1.e3 / iterations, compiled * 1.e3 / iterations);
+
+    const plAGCompiledGraph *graph = avMod->GetCompiledGraph();
+    if (graph)
+    {
+        PrintStringF(PrintString, "%d bones (%d fallback), %d ops, %d blends, %d shared scalars",
+            graph->GetNumBones(), graph->GetNumFallbacks(), graph->GetNumOps(),
+            graph->GetNumBlends(), graph->GetNumScalars());
+    }
+}
+
 #endif // LIMIT_CONSOLE_COMMANDS
 
 ////////////////////////////////////////////////////////////////////////
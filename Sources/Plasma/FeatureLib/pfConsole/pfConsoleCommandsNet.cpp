@@ -66,10 +66,14 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "pnModifier/plLogicModBase.h"
 #include "pfCharacter/plPlayerModifier.h"
 #include "hsTimer.h"
+#include "hsThread.h"
 #include "pnMessage/plClientMsg.h"
 #include "pnMessage/plEnableMsg.h"
 #include "pnMessage/plAudioSysMsg.h"
 #include "plNetMessage/plNetMessage.h"
+#include "plNetMessage/plNetCommonMessage.h"
+#include "plNetMessage/plNetMsgHelpers.h"
+#include "plCompression/plZlibCompress.h"
 #include "plMessage/plAvatarMsg.h"
 #include "plMessage/plOneShotMsg.h"
 #include "plMessage/plConsoleMsg.h"
@@ -96,8 +100,10 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plNetCommon/plSpawnPointInfo.h"
 
 #include "plSDL/plSDL.h"
+#include "pnNetCommon/plSDLTypes.h"
 
 #include "plNetGameLib/plNetGameLib.h"
+#include "pnNetCli/pnNetCli.h"
 
 #include "pfGameMgr/pfGameMgr.h"
 
@@ -262,6 +268,91 @@ PF_CONSOLE_CMD( Net,        // groupName
 
 }
 
+PF_CONSOLE_CMD( Net,        // groupName
+               Interest,    // fxnName
+               "bool on", // paramList
+               "Hold back avatar physics and particle updates when no other player's relevance regions care about them" )    // helpString
+{
+    bool on = params[0];
+    plNetClientMgr::GetInstance()->InterestMgr().SetEnabled(on);
+}
+
+PF_CONSOLE_CMD( Net,        // groupName
+               InterestHints,   // fxnName
+               "bool on", // paramList
+               "Tell the server which players care about us along with our relevance regions. Needs a server that understands them" )    // helpString
+{
+    bool on = params[0];
+    plNetClientMgr::GetInstance()->InterestMgr().SetSendHints(on);
+}
+
+PF_CONSOLE_CMD( Net,        // groupName
+               InterestDeferInterval,   // fxnName
+               "float secs", // paramList
+               "How often held back updates go out anyway, in seconds" )    // helpString
+{
+    plNetClientMgr::GetInstance()->InterestMgr().SetDeferInterval((float)params[0]);
+}
+
+PF_CONSOLE_CMD( Net,        // groupName
+               InterestStats,   // fxnName
+               "...", // paramList
+               "Show how much low priority traffic the relevance regions saved. Pass 'clear' to start over" )    // helpString
+{
+    plNetClientInterest& interest = plNetClientMgr::GetInstance()->InterestMgr();
+    if (numParams > 0 && !stricmp(params[0], "clear"))
+    {
+        interest.ClearStats();
+        PrintString("Interest stats cleared");
+        return;
+    }
+
+    const plNetClientInterest::Stats& stats = interest.GetStats();
+    PrintStringF(PrintString, "Game msgs: %d sent (%d bytes), %d held back, %d replaced by newer ones (%d bytes)",
+        stats.fMsgsSent, stats.fMsgBytesSent, stats.fMsgsDeferred, stats.fMsgsCoalesced, stats.fMsgBytesCoalesced);
+
+    // Saved sends are estimated at the average size of the ones that went out
+    uint32_t avgState = stats.fStatesSent ? stats.fStateBytesSent / stats.fStatesSent : 0;
+    uint32_t savedBytes = stats.fMsgBytesCoalesced + stats.fStatesCoalesced * avgState;
+    uint32_t totalBytes = stats.fMsgBytesSent + stats.fStateBytesSent + savedBytes;
+    PrintStringF(PrintString, "SDL states: %d sent (%d bytes), %d held back, %d sends saved (~%d bytes)",
+        stats.fStatesSent, stats.fStateBytesSent, stats.fStatesDeferred, stats.fStatesCoalesced, stats.fStatesCoalesced * avgState);
+    PrintStringF(PrintString, "Low priority bandwidth saved: %d of %d bytes (%.1f%%)",
+        savedBytes, totalBytes, totalBytes ? savedBytes * 100.0 / totalBytes : 0.0);
+}
+
+PF_CONSOLE_CMD( Net,        // groupName
+               SDLDeltaEncoding,    // fxnName
+               "bool on", // paramList
+               "Send SDL states relative to the last ones sent for the object, once the server and everyone in the age can read them" )    // helpString
+{
+    bool on = params[0];
+    plSDLMgr::GetInstance()->SetDeltaEncoding(on);
+    if (!on)
+        plSDLMgr::GetInstance()->ClearDeltaChains();
+}
+
+PF_CONSOLE_CMD( Net,        // groupName
+               SDLDeltaStats,   // fxnName
+               "...", // paramList
+               "Show delta encoded SDL records sent and received. Pass 'clear' to start over" )    // helpString
+{
+    plSDLMgr::DeltaStats& stats = plSDLMgr::GetInstance()->GetDeltaStats();
+    if (numParams > 0 && !stricmp(params[0], "clear"))
+    {
+        stats.Clear();
+        PrintString("SDL delta stats cleared");
+        return;
+    }
+
+    PrintStringF(PrintString, "Delta encoding %s, %s. Sent %d records (%d bytes, avg %d) in %d chains",
+        plSDLMgr::GetInstance()->GetDeltaEncoding() ? "on" : "off",
+        plNetClientMgr::GetInstance()->IsDeltaEncodingAgreed() ? "agreed" : "not agreed", stats.fRecordsWritten, stats.fBytesWritten,
+        stats.fRecordsWritten ? stats.fBytesWritten / stats.fRecordsWritten : 0, stats.fChainsStarted);
+    PrintStringF(PrintString, "Received %d records, %d dropped waiting for a new chain, %d new chains asked for",
+        stats.fRecordsRead, stats.fRecordsDropped, stats.fResyncsAsked);
+}
+
 PF_CONSOLE_CMD( Net,        // groupName
                ShowLists,   // fxnName
                "bool on", // paramList
@@ -601,6 +692,424 @@ PF_CONSOLE_CMD( Net,            // groupName
     plNetApp::GetInstance()->SetFlagsBit(plNetApp::kScreenMessages, on);
 }
 
+PF_CONSOLE_CMD( Net,            // groupName
+               BenchmarkSDL,        // fxnName
+               "string sdlName, int count", // paramList
+               "Time creating, reading and comparing count records of the latest version of an SDL descriptor" )   // helpString
+{
+    plStateDescriptor* sd = plSDLMgr::GetInstance()->FindDescriptor(params[0], plSDL::kLatestVersion);
+    if (!sd)
+    {
+        PrintStringF(PrintString, "Can't find SDL descriptor %s", (char*)params[0]);
+        return;
+    }
+    int count = params[1];
+    if (count < 1)
+        count = 1;
+
+    // source record with every plain var away from its default, so the values go over the wire
+    plStateDataRecord src(sd);
+    src.SetFromDefaults(false);
+    int i, j;
+    for (i = 0; i < src.GetNumVars(); i++)
+    {
+        plSimpleStateVariable* var = src.GetVar(i);
+        const char* value = var->GetSimpleVarDescriptor()->GetAtomicType() == plVarDescriptor::kString32 ? "bench" : "1";
+        for (j = 0; j < var->GetCount(); j++)
+            var->SetFromString(value, j, false);
+    }
+    hsRAMStream stream;
+    src.Write(&stream, 0);
+
+    std::vector<plStateDataRecord*> recs(count);
+
+    double start = hsTimer::GetSeconds();
+    for (i = 0; i < count; i++)
+        recs[i] = new plStateDataRecord(sd);
+    double created = hsTimer::GetSeconds();
+
+    for (i = 0; i < count; i++)
+    {
+        stream.Rewind();
+        recs[i]->Read(&stream, 0);
+    }
+    double read = hsTimer::GetSeconds();
+
+    int same = 0;
+    for (i = 0; i < count; i++)
+    {
+        recs[i]->FlagDifferentState(src);
+        if (*recs[i] == src)
+            same++;
+    }
+    double compared = hsTimer::GetSeconds();
+
+    for (i = 0; i < count; i++)
+        delete recs[i];
+
+    const plSDLLayout* layout = sd->GetLayout();
+    int numFlat = 0;
+    for (i = 0; i < layout->fSlots.size(); i++)
+        if (layout->fSlots[i].fOffset != plSDLLayout::kNotFlat)
+            numFlat++;
+
+    PrintStringF(PrintString, "%d x %s v%d, %d bytes serialized", count, sd->GetName(), sd->GetVersion(), stream.GetEOF());
+    PrintStringF(PrintString, "create %.2fms, read %.2fms, compare %.2fms (%d equal)",
+        (created - start) * 1000.0, (read - created) * 1000.0, (compared - read) * 1000.0, same);
+    PrintStringF(PrintString, "%d of %d vars flat, record block %d bytes (%d of values)",
+        numFlat, layout->fSlots.size(), layout->GetBlockSize(), layout->fValueSize);
+}
+
+// ref/unrefs one shared message payload in a tight loop
+class plRefBenchThread : public hsThread
+{
+public:
+    plNetCommonMessageData* fData;
+    int                     fNumRefs;
+
+    virtual hsError Run()
+    {
+        int i;
+        for (i = 0; i < fNumRefs; i++)
+        {
+            fData->Ref();
+            fData->UnRef();
+        }
+        return hsOK;
+    }
+};
+
+PF_CONSOLE_CMD( Net,            // groupName
+               BenchmarkRefCnt,     // fxnName
+               "...", // paramList
+               "Ref/unref shared net message data from several threads and report the rate. Params are (optional) thread count and refs per thread" )   // helpString
+{
+    int numThreads = 4;
+    int numRefs = 1000000;
+    if (numParams > 0)
+        numThreads = params[0];
+    if (numParams > 1)
+        numRefs = params[1];
+    if (numThreads < 1)
+        numThreads = 1;
+
+    plNetCommonMessageData* data = new plNetCommonMessageData(new char[64]);
+    plRefBenchThread* threads = new plRefBenchThread[numThreads];
+
+    double start = hsTimer::GetSeconds();
+    int i;
+    for (i = 0; i < numThreads; i++)
+    {
+        threads[i].fData = data;
+        threads[i].fNumRefs = numRefs;
+        threads[i].Start();
+    }
+    for (i = 0; i < numThreads; i++)
+        threads[i].Stop();
+    double secs = hsTimer::GetSeconds() - start;
+
+    int refCnt = data->RefCnt();
+    delete [] threads;
+    hsRefCnt_SafeUnRef(data);
+
+    PrintStringF(PrintString, "%d ref/unref pairs from %d threads in %.1fms (%.0f pairs/sec), final refcnt %d",
+        numThreads * numRefs, numThreads, secs * 1000.0, secs > 0 ? numThreads * numRefs / secs : 0.0, refCnt);
+}
+
+PF_CONSOLE_CMD( Net,            // groupName
+               CompressionThreads,  // fxnName
+               "int num", // paramList
+               "Set the number of helper threads used to compress large payloads. 0 compresses on the calling thread" )   // helpString
+{
+    plZlibCompress::SetNumBlockThreads(params[0]);
+}
+
+PF_CONSOLE_CMD( Net,            // groupName
+               AdaptiveCompression, // fxnName
+               "bool on", // paramList
+               "Skip compressing stream types that don't shrink enough to be worth the CPU" )   // helpString
+{
+    bool on = params[0];
+    plNetMsgStreamHelper::SetAdaptiveCompression(on);
+}
+
+PF_CONSOLE_CMD( Net,            // groupName
+               CaptureCompression,  // fxnName
+               "bool on", // paramList
+               "Keep copies of the payloads we compress, for Net.BenchmarkCompression. Turning it on clears the old ones" )   // helpString
+{
+    bool on = params[0];
+    if (on)
+        plNetMsgStreamHelper::ClearCapturedPayloads();
+    plNetMsgStreamHelper::SetCapturePayloads(on);
+}
+
+// Compresses and uncompresses every payload, checking the round trip
+static bool IBenchCompression(const std::vector< std::vector<uint8_t> >& payloads, int passes,
+                              double* compressSecs, double* uncompressSecs, uint32_t* compressedBytes)
+{
+    plZlibCompress compressor;
+    std::vector<uint8_t> packed, unpacked;
+    bool ok = true;
+
+    *compressSecs = *uncompressSecs = 0;
+    *compressedBytes = 0;
+
+    int p, i;
+    for (p = 0; p < passes; p++)
+    {
+        for (i = 0; i < payloads.size(); i++)
+        {
+            const std::vector<uint8_t>& src = payloads[i];
+            uint32_t srcLen = src.size();
+            if (srcLen == 0)
+                continue;
+
+            packed.resize((uint32_t)(srcLen * 1.1 + 12));
+            uint32_t packedLen = packed.size();
+            double start = hsTimer::GetSeconds();
+            ok &= compressor.Compress(&packed[0], &packedLen, &src[0], srcLen);
+            *compressSecs += hsTimer::GetSeconds() - start;
+
+            unpacked.resize(srcLen);
+            uint32_t unpackedLen = srcLen;
+            start = hsTimer::GetSeconds();
+            ok &= compressor.Uncompress(&unpacked[0], &unpackedLen, &packed[0], packedLen);
+            *uncompressSecs += hsTimer::GetSeconds() - start;
+
+            ok &= (unpackedLen == srcLen && memcmp(&unpacked[0], &src[0], srcLen) == 0);
+            if (p == 0)
+                *compressedBytes += packedLen;
+        }
+    }
+    return ok;
+}
+
+PF_CONSOLE_CMD( Net,            // groupName
+               BenchmarkCompression, // fxnName
+               "...", // paramList
+               "Compress the payloads grabbed by Net.CaptureCompression, one at a time and all together as one big buffer. Param is (optional) pass count" )   // helpString
+{
+    int passes = (numParams > 0) ? (int)params[0] : 10;
+    if (passes < 1)
+        passes = 1;
+
+    std::vector< std::vector<uint8_t> > payloads;
+    plNetMsgStreamHelper::GetCapturedPayloads(payloads);
+    if (payloads.empty())
+    {
+        PrintString("Nothing captured, turn on Net.CaptureCompression and play for a bit first");
+        return;
+    }
+
+    // Everything end to end, the way a big age state or vault upload would go out
+    std::vector< std::vector<uint8_t> > combined(1);
+    uint32_t totalBytes = 0;
+    int i;
+    for (i = 0; i < payloads.size(); i++)
+    {
+        combined[0].insert(combined[0].end(), payloads[i].begin(), payloads[i].end());
+        totalBytes += payloads[i].size();
+    }
+
+    double mb = totalBytes * passes / (1024.0 * 1024.0);
+    double packSecs, unpackSecs;
+    uint32_t packedBytes;
+
+    bool ok = IBenchCompression(payloads, passes, &packSecs, &unpackSecs, &packedBytes);
+    PrintStringF(PrintString, "%d payloads, %d bytes -> %d (%.1f%%)", payloads.size(), totalBytes, packedBytes,
+        totalBytes ? packedBytes * 100.0 / totalBytes : 0.0);
+    PrintStringF(PrintString, "  each: compress %.1f MB/s, uncompress %.1f MB/s%s",
+        packSecs > 0 ? mb / packSecs : 0.0, unpackSecs > 0 ? mb / unpackSecs : 0.0, ok ? "" : " ROUND TRIP FAILED");
+
+    int numThreads = plZlibCompress::GetNumBlockThreads();
+    plZlibCompress::SetNumBlockThreads(0);
+    ok = IBenchCompression(combined, passes, &packSecs, &unpackSecs, &packedBytes);
+    PrintStringF(PrintString, "  combined, 1 thread: compress %.1f MB/s (%d bytes), uncompress %.1f MB/s%s",
+        packSecs > 0 ? mb / packSecs : 0.0, packedBytes, unpackSecs > 0 ? mb / unpackSecs : 0.0, ok ? "" : " ROUND TRIP FAILED");
+
+    plZlibCompress::SetNumBlockThreads(numThreads);
+    if (numThreads > 0)
+    {
+        ok = IBenchCompression(combined, passes, &packSecs, &unpackSecs, &packedBytes);
+        PrintStringF(PrintString, "  combined, %d helper threads: compress %.1f MB/s (%d bytes), uncompress %.1f MB/s%s",
+            numThreads, packSecs > 0 ? mb / packSecs : 0.0, packedBytes, unpackSecs > 0 ? mb / unpackSecs : 0.0, ok ? "" : " ROUND TRIP FAILED");
+    }
+}
+
+// A message shaped like the real ones: some integers, a string and a blob
+enum { kNetCliBenchMsg };
+static const NetMsgField kNetCliBenchFields[] = {
+    NET_MSG_FIELD_DWORD(),
+    NET_MSG_FIELD_DWORD_ARRAY(8),
+    NET_MSG_FIELD_STRING(64),
+    NET_MSG_FIELD_VAR_COUNT(1, 1024 * 1024),
+    NET_MSG_FIELD_VAR_PTR(),
+};
+static const NetMsg kNetCliBenchMsgDesc = NET_MSG(kNetCliBenchMsg, kNetCliBenchFields);
+
+struct plNetCliBenchRecv
+{
+    uint32_t    fMsgs;
+    uint64_t    fBytes;
+};
+
+static bool IRecvNetCliBench(const uint8_t msg[], unsigned bytes, void* param)
+{
+    plNetCliBenchRecv* recv = (plNetCliBenchRecv*)param;
+    recv->fMsgs++;
+    recv->fBytes += bytes;
+    return true;
+}
+
+static void IBenchNetCli(bool encrypt, uint32_t payloadBytes, uint32_t count, void (*PrintString)(const char*))
+{
+    plNetCliBenchRecv recv;
+    recv.fMsgs = 0;
+    recv.fBytes = 0;
+
+    NetCli* client;
+    NetCli* server;
+    NetCliCreateLoopback(kNetProtocolDebug, encrypt, &recv, &client, &server);
+    if (!client)
+    {
+        PrintString("Couldn't create the loopback connection");
+        return;
+    }
+
+    std::vector<uint8_t> payload(payloadBytes);
+    uint32_t i;
+    for (i = 0; i < payloadBytes; i++)
+        payload[i] = (uint8_t)i;
+    uint32_t ints[8] = { 1, 2, 3, 4, 5, 6, 7, 8 };
+
+    double start = hsTimer::GetSeconds();
+    for (i = 0; i < count; i++)
+    {
+        const uintptr_t msg[] = {
+            kNetCliBenchMsg,
+            i,
+            (uintptr_t)ints,
+            (uintptr_t)L"Benchmark",
+            payloadBytes,
+            (uintptr_t)(payloadBytes ? &payload[0] : nil),
+        };
+        NetCliSend(client, msg, arrsize(msg));
+    }
+    NetCliFlush(client);
+    double secs = hsTimer::GetSeconds() - start;
+
+    NetCliSendStats stats;
+    NetCliGetSendStats(client, &stats);
+    double mb = stats.bytesSent / (1024.0 * 1024.0);
+
+    PrintStringF(PrintString, "%s, %d byte payloads: %.0f msgs/s, %.1f MB/s%s",
+        encrypt ? "encrypted" : "plain", payloadBytes, secs > 0 ? count / secs : 0.0,
+        secs > 0 ? mb / secs : 0.0, recv.fMsgs == count ? "" : " MESSAGES LOST");
+    PrintStringF(PrintString, "  %d sends, %.1f KB copied, %.1f KB gathered, %d allocs",
+        stats.socketSends, stats.bytesCopied / 1024.0, stats.bytesGathered / 1024.0, stats.allocs);
+
+    NetCliDelete(client, false);
+    NetCliDelete(server, false);
+}
+
+PF_CONSOLE_CMD( Net,            // groupName
+               BenchmarkNetCli, // fxnName
+               "...", // paramList
+               "Push messages through an in-memory client/server connection pair, plain and encrypted. Params are (optional) message count and payload bytes" )   // helpString
+{
+    uint32_t count = (numParams > 0) ? (int)params[0] : 10000;
+    uint32_t payloadBytes = (numParams > 1) ? (int)params[1] : 4096;
+
+    static const NetMsgInitSend kSend[] = { { kNetCliBenchMsgDesc } };
+    static const NetMsgInitRecv kRecv[] = { { kNetCliBenchMsgDesc, IRecvNetCliBench } };
+    NetMsgProtocolRegister(kNetProtocolDebug, false, kSend, arrsize(kSend), nil, 0, 0, plBigNum(), plBigNum());
+    NetMsgProtocolRegister(kNetProtocolDebug, true, nil, 0, kRecv, arrsize(kRecv), 0, plBigNum(), plBigNum());
+
+    IBenchNetCli(false, 64, count, PrintString);
+    IBenchNetCli(true, 64, count, PrintString);
+    IBenchNetCli(false, payloadBytes, count, PrintString);
+    IBenchNetCli(true, payloadBytes, count, PrintString);
+
+    NetMsgProtocolDestroy(kNetProtocolDebug, false);
+    NetMsgProtocolDestroy(kNetProtocolDebug, true);
+}
+
+PF_CONSOLE_CMD( Net,        // groupName
+               BenchmarkSDLDelta,   // fxnName
+               "...", // paramList
+               "Compare plain and delta encoded sizes of a moving physical's SDL, and check it decodes. Param is (optional) update count" )   // helpString
+{
+    int count = (numParams > 0) ? (int)params[0] : 1000;
+
+    plStateDescriptor* desc = plSDLMgr::GetInstance()->FindDescriptor(kSDLPhysical, plSDL::kLatestVersion);
+    if (!desc)
+    {
+        PrintString("No physical SDL descriptor");
+        return;
+    }
+
+    plUoid uoid(plLocation::kGlobalFixedLoc, 0, "SDLDeltaBenchmark");
+    uint32_t writeOptions = plSDL::kDirtyOnly | plSDL::kBroadcast | plSDL::kTimeStampOnRead;
+    uint32_t plainBytes = 0, deltaBytes = 0;
+    int failures = 0;
+    float maxError = 0;
+
+    plStateDataRecord rec(desc);
+    int i, j;
+    for(i=0;i<count;i++)
+    {
+        // walking along a slope, turning slowly
+        float t = i * 0.1f;
+        float angle = t * 0.2f;
+        float pos[3] = { 120.f + t * 1.4f, -35.f + sinf(t) * 0.5f, 8.f + t * 0.05f };
+        float quat[4] = { 0, 0, sinf(angle / 2), cosf(angle / 2) };
+        float linear[3] = { 1.4f, cosf(t) * 0.5f, 0.05f };
+        float angular[3] = { 0, 0, 0.2f };
+        rec.FindVar("position")->Set(pos);
+        rec.FindVar("orientation")->Set(quat);
+        rec.FindVar("linear")->Set(linear);
+        rec.FindVar("angular")->Set(angular);
+
+        plNetMsgSDLState* plainMsg = rec.PrepNetMsg(0, writeOptions);
+        plNetMsgSDLState* deltaMsg = rec.PrepNetMsg(0, writeOptions | plSDL::kDeltaEncode, &uoid);
+        plainBytes += plainMsg->StreamInfo()->GetStreamLen();
+        deltaBytes += deltaMsg->StreamInfo()->GetStreamLen();
+
+        // decode as a receiver would
+        hsReadOnlyStream stream(deltaMsg->StreamInfo()->GetStreamLen(), deltaMsg->StreamInfo()->GetStreamBuf());
+        char* descName = nil;
+        int ver;
+        plStateDataRecord::ReadStreamHeader(&stream, &descName, &ver);
+        delete [] descName;
+
+        plStateDataRecord got(desc);
+        got.SetAssocObject(uoid);
+        if (got.Read(&stream, 0, 0))
+        {
+            float gotPos[3], gotQuat[4];
+            got.FindVar("position")->Get(gotPos);
+            got.FindVar("orientation")->Get(gotQuat);
+            for(j=0;j<3;j++)
+                maxError = hsMaximum(maxError, hsABS(gotPos[j] - pos[j]));
+            for(j=0;j<4;j++)
+                maxError = hsMaximum(maxError, hsABS(gotQuat[j] - quat[j]));
+        }
+        else
+            failures++;
+
+        delete plainMsg;
+        delete deltaMsg;
+    }
+
+    plSDLMgr::GetInstance()->RemoveDeltaChain(uoid, desc, true);
+    plSDLMgr::GetInstance()->RemoveDeltaChain(uoid, desc, false);
+
+    PrintStringF(PrintString, "%d updates: plain %d bytes, delta %d bytes (%.1f%%)",
+        count, plainBytes, deltaBytes, plainBytes ? deltaBytes * 100.0 / plainBytes : 0.0);
+    PrintStringF(PrintString, "Decode failures %d, max position/orientation error %f", failures, maxError);
+}
+
 #endif
 
 ///////////////////////////////////////
@@ -252,6 +252,19 @@ public:
     virtual void                        SetMaxCullNodes(uint16_t n) = 0; // Debug/analysis only
     virtual uint16_t                    GetMaxCullNodes() const = 0; // Debug/analysis only
 
+    // Where the occluder polys go. See plOcclusionBuffer.
+    enum OcclusionMode
+    {
+        kOcclusionNone          = 0,    // Frustum culling only
+        kOcclusionCullTree,             // Occluders built into the cull tree (default)
+        kOcclusionBuffer,               // Occluders rasterized into a software depth buffer
+        kOcclusionBoth,                 // Cull tree, then the buffer over whatever survives it
+
+        kNumOcclusionModes
+    };
+    virtual void                        SetOcclusionMode(uint8_t mode) = 0; // Debug/analysis only
+    virtual uint8_t                     GetOcclusionMode() const = 0; // Debug/analysis only
+
     // Properties
     enum Properties
     {
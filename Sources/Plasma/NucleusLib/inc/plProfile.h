@@ -180,6 +180,7 @@ public:
     void UpdateAvg();
 
     uint32_t GetValue();
+    float GetValueFloat();    // Same, but timers keep their fractions of a msec
 
     void PrintValue(char* buf, bool printType=true);
     void PrintAvg(char* buf, bool printType=true);
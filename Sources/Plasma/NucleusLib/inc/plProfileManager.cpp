@@ -308,6 +308,14 @@ uint32_t plProfileBase::GetValue()
         return fValue;
 }
 
+float plProfileBase::GetValueFloat()
+{
+    if (hsCheckBits(fDisplayFlags, kDisplayTime))
+        return TicksToMSec(fValue);
+    else
+        return float(fValue);
+}
+
 // Stolen from plMemTracker.cpp
 static  const char  *insertCommas(unsigned int value)
 {
@@ -74,6 +74,10 @@ public:
 
     uint32_t GetProcessorSpeed() { return fProcessorSpeed; }
 
+    // For tools that want to walk every var themselves (ie. plFrameBench)
+    uint32_t GetNumVars() const { return fVars.size(); }
+    plProfileVar* GetVar(uint32_t i) const { return fVars[i]; }
+
     // Backdoor for hack timers in calculated profiles
     static uint32_t GetTime();
 };
@@ -246,6 +246,20 @@ bool AsyncSocketSend (
     unsigned                bytes
 );
 
+struct AsyncSocketBuf {
+    const void *            data;
+    unsigned                bytes;
+};
+
+// Sends the buffers back to back, as if they had been copied together and
+// passed to AsyncSocketSend. The buffers only need to stay valid for the
+// duration of the call. Returns false if socket has been closed
+bool AsyncSocketSendv (
+    AsyncSocket             sock,
+    const AsyncSocketBuf    bufs[],
+    unsigned                count
+);
+
 // Buffer must stay valid until I/O has completed
 // Returns false if socket has been closed
 bool AsyncSocketWrite (
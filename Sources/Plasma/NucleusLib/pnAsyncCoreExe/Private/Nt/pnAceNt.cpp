@@ -440,6 +440,7 @@ void NtGetApi (AsyncApi * api) {
     api->socketDisconnect       = NtSocketDisconnect;
     api->socketDelete           = NtSocketDelete;
     api->socketSend             = NtSocketSend;
+    api->socketSendv            = NtSocketSendv;
     api->socketWrite            = NtSocketWrite;
     api->socketSetNotifyProc    = NtSocketSetNotifyProc;
     api->socketSetBacklogAlloc  = NtSocketSetBacklogAlloc;
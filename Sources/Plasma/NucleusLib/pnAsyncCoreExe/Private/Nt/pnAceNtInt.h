@@ -213,6 +213,11 @@ bool NtSocketSend (
     const void *    data,
     unsigned        bytes
 );
+bool NtSocketSendv (
+    AsyncSocket             sock,
+    const AsyncSocketBuf    bufs[],
+    unsigned                count
+);
 bool NtSocketWrite (
     AsyncSocket     sock,
     const void *    buffer,
@@ -1369,6 +1369,90 @@ bool NtSocketSend (
     return result;
 }
 
+//===========================================================================
+bool NtSocketSendv (
+    AsyncSocket             conn,
+    const AsyncSocketBuf    bufs[],
+    unsigned                count
+) {
+    NtSock * sock = (NtSock *) conn;
+    ASSERT(sock);
+    ASSERT(bufs);
+    ASSERT(count);
+    ASSERT(sock->ioType == kNtSocket);
+
+    const unsigned kMaxGatherBufs = 16;
+
+    bool result;
+    sock->critsect.Enter();
+    for (;;) {
+        // Is the socket closing?
+        if (sock->closeTimeMs) {
+            result = false;
+            break;
+        }
+
+        // if there isn't any data queued, hand the OS as much as it'll take
+        unsigned first = 0;
+        unsigned skip  = 0;
+        bool dataQueued = sock->opList.Head() != nil;
+        if (!dataQueued) {
+            WSABUF wsaBufs[kMaxGatherBufs];
+            unsigned wsaCount = min(count, kMaxGatherBufs);
+            for (unsigned i = 0; i < wsaCount; ++i) {
+                wsaBufs[i].buf = (char *) bufs[i].data;
+                wsaBufs[i].len = bufs[i].bytes;
+            }
+
+            DWORD bytesSent;
+            if (!WSASend((SOCKET) sock->handle, wsaBufs, wsaCount, &bytesSent, 0, nil, nil)) {
+                result = true;
+
+                // skip past the buffers that went out in full
+                while (first < count && bytesSent >= bufs[first].bytes) {
+                    bytesSent -= bufs[first].bytes;
+                    ++first;
+                }
+                skip = bytesSent;
+
+                // if we sent all the data then exit
+                if (first == count)
+                    break;
+            }
+            else if (WSAEWOULDBLOCK != WSAGetLastError()) {
+                // an error occurred -- destroy connection
+                NtSocketDisconnect((AsyncSocket) sock, true);
+                result = false;
+                break;
+            }
+        }
+
+        // queue whatever is left, just like NtSocketSend
+        NtOpSocketWrite * op = nil;
+        for (unsigned i = first; i < count; ++i, skip = 0) {
+            if (bufs[i].bytes == skip)
+                continue;
+            NtOpSocketWrite * queued = SocketQueueAsyncWrite(
+                sock,
+                (const uint8_t *) bufs[i].data + skip,
+                bufs[i].bytes - skip
+            );
+            if (!queued)
+                break;
+            if (!op)
+                op = queued;
+        }
+        if (op && !dataQueued)
+            result = INtSocketOpCompleteQueuedSocketWrite(sock, op);
+        else
+            result = true;
+        break;
+    }
+    sock->critsect.Leave();
+
+    return result;
+}
+
 //===========================================================================
 bool NtSocketWrite (
     AsyncSocket     conn,
@@ -135,6 +135,12 @@ typedef bool (* FAsyncSocketSend) (
     unsigned        bytes
 );
 
+typedef bool (* FAsyncSocketSendv) (
+    AsyncSocket             sock,
+    const AsyncSocketBuf    bufs[],
+    unsigned                count
+);
+
 typedef bool (* FAsyncSocketWrite) (
     AsyncSocket     sock,
     const void *    buffer,
@@ -190,6 +196,7 @@ struct AsyncApi {
     FAsyncSocketDisconnect          socketDisconnect;
     FAsyncSocketDelete              socketDelete;
     FAsyncSocketSend                socketSend;
+    FAsyncSocketSendv               socketSendv;
     FAsyncSocketWrite               socketWrite;
     FAsyncSocketSetNotifyProc       socketSetNotifyProc;
     FAsyncSocketSetBacklogAlloc     socketSetBacklogAlloc;
@@ -262,6 +262,24 @@ bool AsyncSocketSend (
     return g_api.socketSend(sock, data, bytes);
 }
 
+//===========================================================================
+bool AsyncSocketSendv (
+    AsyncSocket             sock,
+    const AsyncSocketBuf    bufs[],
+    unsigned                count
+) {
+    if (g_api.socketSendv)
+        return g_api.socketSendv(sock, bufs, count);
+
+    // No gather support, send the pieces one after another
+    ASSERT(g_api.socketSend);
+    for (unsigned i = 0; i < count; ++i) {
+        if (bufs[i].bytes && !g_api.socketSend(sock, bufs[i].data, bufs[i].bytes))
+            return false;
+    }
+    return true;
+}
+
 //===========================================================================
 bool AsyncSocketWrite (
     AsyncSocket             sock,
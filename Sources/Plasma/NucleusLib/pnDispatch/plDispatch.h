@@ -43,6 +43,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #ifndef plDispatch_inc
 #define plDispatch_inc
 #include "hsTemplates.h"
+#include "hsFastArray.h"
 #include "hsStlUtils.h"
 #include "plgDispatch.h"
 #include "hsThread.h"
@@ -84,7 +85,7 @@ protected:
     static hsTArray<plMessage*>     fMsgWatch;
     static MsgRecieveCallback       fMsgRecieveCallback;
 
-    hsTArray<plTypeFilter*>         fRegisteredExactTypes;
+    hsFastArray<plTypeFilter*>      fRegisteredExactTypes;
     std::list<plMessage*>           fQueuedMsgList;
     hsMutex                         fQueuedMsgListMutex; // mutex for above
     bool                            fQueuedMsgOn;       // Turns on or off Queued Messages, Plugins need them off
@@ -164,6 +164,7 @@ plFixedKeyValidator plFixedKeyValidator::fValidator;
 //  file gets compiled.
 
 plUoid::plUoid(plFixedKeyId fixedkey)
+    : fObjectName(nil)
 {
     hsAssert(fixedkey < kLast_Fixed_KEY, "Request for Fixed key is out of Range");
 
@@ -173,7 +174,7 @@ plUoid::plUoid(plFixedKeyId fixedkey)
 
     fLocation = plLocation::kGlobalFixedLoc;
     fClassType = p->fType;
-    fObjectName = p->fObj;
+    fObjectName = plKeyNameTable::Intern(p->fObj);
     fObjectID = 0;
     fCloneID = 0;
     fClonePlayerID = 0;
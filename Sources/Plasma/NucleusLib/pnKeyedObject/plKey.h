@@ -152,6 +152,10 @@ protected:
     friend class plKey;
 
     // Refcount--the number of plKeys that have pointers to us.
+    // Deliberately not atomic: the 0<->1 transitions call into the ResManager
+    // (IKeyReffed/IKeyUnreffed), which is main thread only, so an atomic count
+    // alone would not make cross-thread plKey copies safe.  Other threads hand
+    // keys around as plUoids and resolve them on the main thread.
     uint16_t fRefCount;
 };
 
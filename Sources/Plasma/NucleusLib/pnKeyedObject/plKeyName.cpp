@@ -0,0 +1,227 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+#include "plKeyName.h"
+#include "hsThread.h"
+#include <ctype.h>
+#include <vector>
+
+//// Table ///////////////////////////////////////////////////////////////////
+//  Split into stripes by the top bits of the hash, each with its own lock
+//  and buckets. Built on first use and never torn down, since static uoids
+//  intern their names during static init and drop them during static exit.
+
+enum
+{
+    kNumStripes         = 16,
+    kStripeShift        = 28,   // top 4 bits of the hash pick the stripe
+    kInitialBuckets     = 64    // per stripe, power of two
+};
+
+class plKeyNameStripe
+{
+public:
+    hsMutex                 fMutex;
+    std::vector<plKeyName*> fBuckets;
+    uint32_t                fNumNames;
+    uint32_t                fNameBytes;
+
+    plKeyNameStripe() : fNumNames(0), fNameBytes(0) { fBuckets.resize(kInitialBuckets, nil); }
+
+    plKeyName** IFindSlot(const plString& name, uint32_t hash);
+    void        IGrow();
+};
+
+namespace
+{
+    plKeyNameStripe* IGetStripes()
+    {
+        static plKeyNameStripe* stripes = new plKeyNameStripe[kNumStripes];
+        return stripes;
+    }
+
+    plKeyNameStripe& IGetStripe(uint32_t hash)
+    {
+        return IGetStripes()[hash >> kStripeShift];
+    }
+}
+
+// Slot holding the entry for this name, or the empty slot at the end of
+// its chain. Caller holds the stripe lock.
+plKeyName** plKeyNameStripe::IFindSlot(const plString& name, uint32_t hash)
+{
+    plKeyName** slot = &fBuckets[hash & (fBuckets.size() - 1)];
+    while (*slot && ((*slot)->fHash != hash || (*slot)->fName != name))
+        slot = &(*slot)->fNext;
+    return slot;
+}
+
+// Doubles the bucket count, caller holds the stripe lock
+void plKeyNameStripe::IGrow()
+{
+    std::vector<plKeyName*> buckets(fBuckets.size() * 2, nil);
+    uint32_t mask = buckets.size() - 1;
+
+    int i;
+    for (i = 0; i < fBuckets.size(); i++)
+    {
+        plKeyName* entry = fBuckets[i];
+        while (entry)
+        {
+            plKeyName* next = entry->fNext;
+            entry->fNext = buckets[entry->fHash & mask];
+            buckets[entry->fHash & mask] = entry;
+            entry = next;
+        }
+    }
+    fBuckets.swap(buckets);
+}
+
+//// Public //////////////////////////////////////////////////////////////////
+
+// FNV-1a over the lowercased bytes, so names differing only in case share a hash.
+// Empty names hash to 0 to match plUoid::GetObjectNameHash for a nil name.
+uint32_t plKeyNameTable::HashName(const plString& name)
+{
+    if (name.IsEmpty())
+        return 0;
+
+    uint32_t hash = 2166136261u;
+    const char* cp = name.c_str();
+    while (*cp)
+    {
+        hash ^= (uint8_t)tolower((uint8_t)*cp++);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+const plKeyName* plKeyNameTable::Intern(const plString& name)
+{
+    if (name.IsEmpty())
+        return nil;
+
+    uint32_t hash = HashName(name);
+    plKeyNameStripe& stripe = IGetStripe(hash);
+    hsTempMutexLock lock(stripe.fMutex);
+
+    plKeyName** slot = stripe.IFindSlot(name, hash);
+    if (*slot)
+    {
+        // Under the lock, so this can't race the last UnRef freeing it
+        AtomicAdd(&(*slot)->fRefs, 1);
+        return *slot;
+    }
+
+    plKeyName* entry = new plKeyName(name, hash);
+    *slot = entry;
+    stripe.fNumNames++;
+    stripe.fNameBytes += name.GetSize() + 1;
+
+    if (stripe.fNumNames > stripe.fBuckets.size())
+        stripe.IGrow();
+
+    return entry;
+}
+
+void plKeyNameTable::Ref(const plKeyName* entry)
+{
+    // The caller already holds a ref, so the entry can't go away under us
+    if (entry)
+        AtomicAdd(&entry->fRefs, 1);
+}
+
+void plKeyNameTable::UnRef(const plKeyName* entry)
+{
+    if (!entry)
+        return;
+
+    // Dropping a ref that isn't the last needs no lock. The count only
+    // reaches zero under the stripe lock, where Intern can't revive it.
+    for (;;)
+    {
+        long refs = entry->fRefs;
+        if (refs <= 1)
+            break;
+        if (AtomicCompareSet(&entry->fRefs, refs, refs - 1))
+            return;
+    }
+
+    plKeyNameStripe& stripe = IGetStripe(entry->fHash);
+    hsTempMutexLock lock(stripe.fMutex);
+
+    if (AtomicAdd(&entry->fRefs, -1) != 1)
+        return;     // Interned again while we waited for the lock
+
+    plKeyName** slot = stripe.IFindSlot(entry->fName, entry->fHash);
+    hsAssert(*slot == entry, "Key name missing from its table");
+    *slot = entry->fNext;
+    stripe.fNumNames--;
+    stripe.fNameBytes -= entry->fName.GetSize() + 1;
+    delete entry;
+}
+
+uint32_t plKeyNameTable::GetNumNames()
+{
+    uint32_t num = 0;
+    int i;
+    for (i = 0; i < kNumStripes; i++)
+    {
+        plKeyNameStripe& stripe = IGetStripes()[i];
+        hsTempMutexLock lock(stripe.fMutex);
+        num += stripe.fNumNames;
+    }
+    return num;
+}
+
+uint32_t plKeyNameTable::GetMemUsed()
+{
+    uint32_t bytes = 0;
+    int i;
+    for (i = 0; i < kNumStripes; i++)
+    {
+        plKeyNameStripe& stripe = IGetStripes()[i];
+        hsTempMutexLock lock(stripe.fMutex);
+        bytes += stripe.fNumNames * sizeof(plKeyName) + stripe.fNameBytes
+            + stripe.fBuckets.size() * sizeof(plKeyName*);
+    }
+    return bytes;
+}
@@ -0,0 +1,97 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+//////////////////////////////////////////////////////////////////////////////
+//
+//  plKeyName - Interned object names for plUoid.
+//              Each distinct name in use is stored once, so uoids hold a
+//              pointer and compare names by pointer. Entries are refcounted
+//              by the uoids holding them and go away with the last one, so
+//              names that come and go (network uoids, clones) don't pile up.
+//              Each entry carries a precomputed case-insensitive hash for
+//              the registry's case-insensitive lookups.
+//
+//////////////////////////////////////////////////////////////////////////////
+
+#ifndef plKeyName_h_inc
+#define plKeyName_h_inc
+
+#include "HeadSpin.h"
+#include "plString.h"
+
+class plKeyName
+{
+    friend class plKeyNameTable;
+    friend class plKeyNameStripe;
+
+protected:
+    plString    fName;
+    uint32_t    fHash;      // case-insensitive, see plKeyNameTable::HashName
+    mutable long fRefs;     // uoids holding this entry
+    plKeyName*  fNext;      // hash chain
+
+    plKeyName(const plString& name, uint32_t hash) : fName(name), fHash(hash), fRefs(1), fNext(nil) {}
+
+public:
+    const plString& GetName() const { return fName; }
+    uint32_t        GetHash() const { return fHash; }
+};
+
+class plKeyNameTable
+{
+public:
+    // Returns the one entry for this exact (case-sensitive) name, creating it
+    // if needed, with a ref the caller owns. Empty names intern to nil.
+    // Thread safe; the table is striped by hash so loaders on different
+    // threads rarely wait on each other.
+    static const plKeyName* Intern(const plString& name);
+
+    // Ref/UnRef take nil. The last UnRef frees the entry.
+    static void Ref(const plKeyName* entry);
+    static void UnRef(const plKeyName* entry);
+
+    static uint32_t HashName(const plString& name);
+
+    static uint32_t GetNumNames();
+    static uint32_t GetMemUsed();   // approximate bytes held by the table
+};
+
+#endif // plKeyName_h_inc
@@ -130,17 +130,19 @@ plLocation plLocation::MakeNormal(uint32_t number)
 //// plUoid //////////////////////////////////////////////////////////////////
 
 plUoid::plUoid(const plLocation& location, uint16_t classType, const plString& objectName, const plLoadMask& m)
+    : fObjectName(nil)
 {
     Invalidate();
 
     fLocation = location;
     fClassType = classType;
-    fObjectName = objectName;
+    fObjectName = plKeyNameTable::Intern(objectName);
     fLoadMask = m;
     fClonePlayerID = 0;
 }
 
 plUoid::plUoid(const plUoid& src)
+    : fObjectName(nil)
 {
     Invalidate();
     *this = src;
@@ -153,7 +155,7 @@ plUoid::~plUoid()
 
 void plUoid::Read(hsStream* s)
 {
-    hsAssert(fObjectName.IsNull(), "Reading over an old uoid? You're just asking for trouble, aren't you?");
+    hsAssert(!fObjectName, "Reading over an old uoid? You're just asking for trouble, aren't you?");
 
     // first read contents flags
     uint8_t contents = s->ReadByte();
@@ -169,7 +171,7 @@ void plUoid::Read(hsStream* s)
     s->LogReadLE(&fClassType, "ClassType");
     s->LogReadLE(&fObjectID, "ObjectID");
     s->LogSubStreamPushDesc("ObjectName");
-    fObjectName = s->LogReadSafeString_TEMP();
+    fObjectName = plKeyNameTable::Intern(s->LogReadSafeString_TEMP());
 
     // conditional cloneIDs read
     if (contents & kHasCloneIDs)
@@ -202,7 +204,7 @@ void plUoid::Write(hsStream* s) const
 
     s->WriteLE( fClassType );
     s->WriteLE( fObjectID );
-    s->WriteSafeString( fObjectName );
+    s->WriteSafeString( GetObjectName() );
 
     // conditional cloneIDs write
     if (contents & kHasCloneIDs)
@@ -220,7 +222,8 @@ void plUoid::Invalidate()
     fCloneID = 0;
     fClonePlayerID = 0;
     fClassType = 0;
-    fObjectName = plString::Null;
+    plKeyNameTable::UnRef(fObjectName);
+    fObjectName = nil;
     fLocation.Invalidate();
     fLoadMask = plLoadMask::kAlways;
 
@@ -228,7 +231,7 @@ void plUoid::Invalidate()
 
 bool plUoid::IsValid() const
 {
-    if (!fLocation.IsValid() || fObjectName.IsNull())
+    if (!fLocation.IsValid() || !fObjectName)
         return false;
 
     return true;
@@ -245,12 +248,36 @@ bool plUoid::operator==(const plUoid& u) const
             && fClonePlayerID == u.fClonePlayerID;
 }
 
+// Same fields as operator==, so uoids that are equal sort together
+bool plUoid::operator<(const plUoid& u) const
+{
+    if (fLocation.GetSequenceNumber() != u.fLocation.GetSequenceNumber())
+        return fLocation.GetSequenceNumber() < u.fLocation.GetSequenceNumber();
+    uint16_t flags = fLocation.GetFlags() & ~plLocation::kItinerant;
+    uint16_t uFlags = u.fLocation.GetFlags() & ~plLocation::kItinerant;
+    if (flags != uFlags)
+        return flags < uFlags;
+    if (fLoadMask != u.fLoadMask)
+        return fLoadMask < u.fLoadMask;
+    if (fClassType != u.fClassType)
+        return fClassType < u.fClassType;
+    if (fObjectName != u.fObjectName)
+        return fObjectName < u.fObjectName;
+    if (fObjectID != u.fObjectID)
+        return fObjectID < u.fObjectID;
+    if (fCloneID != u.fCloneID)
+        return fCloneID < u.fCloneID;
+    return fClonePlayerID < u.fClonePlayerID;
+}
+
 plUoid& plUoid::operator=(const plUoid& rhs)
 {
     fObjectID = rhs.fObjectID;
     fCloneID = rhs.fCloneID;
     fClonePlayerID = rhs.fClonePlayerID;
     fClassType = rhs.fClassType;
+    plKeyNameTable::Ref(rhs.fObjectName);   // before the UnRef, in case rhs is us
+    plKeyNameTable::UnRef(fObjectName);
     fObjectName = rhs.fObjectName;
     fLocation = rhs.fLocation;
     fLoadMask = rhs.fLoadMask;
@@ -264,7 +291,7 @@ plString plUoid::StringIze() const // Format to displayable string
     return plString::Format("(0x%x:0x%x:%s:C:[%u,%u])",
         fLocation.GetSequenceNumber(), 
         int(fLocation.GetFlags()), 
-        fObjectName.c_str(),
+        GetObjectName().c_str(),
         GetClonePlayerID(), 
         GetCloneID());
 }
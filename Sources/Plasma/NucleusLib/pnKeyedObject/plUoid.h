@@ -58,6 +58,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plFixedKey.h"
 #include "plLoadMask.h"
 #include "plString.h"
+#include "plKeyName.h"
 
 class hsStream;
 
@@ -149,7 +150,7 @@ public:
 class plUoid
 {
 public:
-    plUoid() { Invalidate(); }
+    plUoid() : fObjectName(nil) { Invalidate(); }
     plUoid(const plLocation& location, uint16_t classType, const plString& objectName, const plLoadMask& m=plLoadMask::kAlways);
     plUoid(plFixedKeyId fixedKey);
     plUoid(const plUoid& src);
@@ -157,7 +158,8 @@ public:
 
     const plLocation&   GetLocation() const { return fLocation; }
     uint16_t            GetClassType() const { return fClassType; }
-    const plString&     GetObjectName() const { return fObjectName; }
+    const plString&     GetObjectName() const { return fObjectName ? fObjectName->GetName() : plString::Null; }
+    uint32_t            GetObjectNameHash() const { return fObjectName ? fObjectName->GetHash() : 0; }
     const plLoadMask&   GetLoadMask() const { return fLoadMask; }
 
     void Read(hsStream* s);
@@ -169,6 +171,7 @@ public:
     plUoid& operator=(const plUoid& u);
     bool  operator==(const plUoid& u) const;
     bool  operator!=(const plUoid& u) const { return !operator==(u); }
+    bool  operator<(const plUoid& u) const;   // for maps, orders names by entry so not alphabetical
 
     bool  IsClone() const             { return fCloneID != 0; }
     uint32_t  GetClonePlayerID() const    { return fClonePlayerID; }
@@ -193,7 +196,7 @@ protected:
     uint32_t    fClonePlayerID; // The ID of the player who made this clone
     uint16_t    fCloneID;       // The ID of this clone (unique per client)
     uint16_t    fClassType;
-    plString    fObjectName;
+    const plKeyName* fObjectName;   // interned and ref'd, compare by pointer
     plLocation  fLocation;
     plLoadMask  fLoadMask;
 };
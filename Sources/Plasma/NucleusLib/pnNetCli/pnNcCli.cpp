@@ -143,6 +143,12 @@ struct NetCli : THashKeyVal<Uuid> {
     // Message buffers
     uint8_t                    sendBuffer[kAsyncSocketBufferSize];
     ARRAY(uint8_t)             recvBuffer;
+
+    // In memory peer, used instead of sock by NetCliCreateLoopback
+    NetCli *                loopback;
+    void *                  loopbackParam;
+
+    NetCliSendStats         sendStats;
 };
 
 struct NetCliQueue {
@@ -169,10 +175,7 @@ namespace pnNetCli {
 ***/
 
 //============================================================================
-static void PutBufferOnWire (NetCli * cli, void * data, unsigned bytes) {
-
-    uint8_t * temp = NULL;
-
+static void LogBufferToNetlog (NetCli * cli, const void * data, unsigned bytes) {
 #if !defined(PLASMA_EXTERNAL_RELEASE) && defined(HS_BUILD_FOR_WIN32)
     // Write to the netlog
     if (s_netlog) {
@@ -189,19 +192,28 @@ static void PutBufferOnWire (NetCli * cli, void * data, unsigned bytes) {
         LeaveCriticalSection(&s_pipeCritical);
     }
 #endif // PLASMA_EXTERNAL_RELEASE
+}
 
-    if (cli->mode == kNetCliModeEncrypted && cli->cryptOut) {
-        temp = (uint8_t *)malloc(bytes);
+//============================================================================
+static void SendToPeer (NetCli * cli, const void * data, unsigned bytes) {
+    ++cli->sendStats.socketSends;
+    cli->sendStats.bytesSent += bytes;
 
-        memcpy(temp, data, bytes);
-        CryptEncrypt(cli->cryptOut, bytes, temp);
-        data = temp;
-    }
     if (cli->sock)
         AsyncSocketSend(cli->sock, data, bytes);
-        
-    // free heap buffer (if any)
-    free(temp);
+    else if (cli->loopback)
+        NetCliDispatch(cli->loopback, (const uint8_t *) data, bytes, cli->loopbackParam);
+}
+
+//============================================================================
+// Encrypts in place, so only ever hand this the send buffer
+static void PutBufferOnWire (NetCli * cli, uint8_t * data, unsigned bytes) {
+    LogBufferToNetlog(cli, data, bytes);
+
+    if (cli->mode == kNetCliModeEncrypted && cli->cryptOut)
+        CryptEncrypt(cli->cryptOut, bytes, data);
+
+    SendToPeer(cli, data, bytes);
 }
 
 //============================================================================
@@ -212,6 +224,43 @@ static void FlushSendBuffer (NetCli * cli) {
     cli->sendCurr = cli->sendBuffer;
 }
 
+//============================================================================
+// Sends whatever is buffered followed by data, without copying data.
+// Only usable when there's no encryption to apply.
+static void GatherSendBuffer (
+    NetCli *            cli,
+    unsigned            bytes,
+    void const * const  data
+) {
+    AsyncSocketBuf bufs[2];
+    unsigned count = 0;
+
+    const unsigned buffered = cli->sendCurr - cli->sendBuffer;
+    if (buffered) {
+        bufs[count].data  = cli->sendBuffer;
+        bufs[count].bytes = buffered;
+        ++count;
+    }
+    bufs[count].data  = data;
+    bufs[count].bytes = bytes;
+    ++count;
+
+    for (unsigned i = 0; i < count; ++i)
+        LogBufferToNetlog(cli, bufs[i].data, bufs[i].bytes);
+
+    cli->sendStats.bytesGathered += bytes;
+    if (cli->sock) {
+        ++cli->sendStats.socketSends;
+        cli->sendStats.bytesSent += buffered + bytes;
+        AsyncSocketSendv(cli->sock, bufs, count);
+    }
+    else {
+        for (unsigned i = 0; i < count; ++i)
+            SendToPeer(cli, bufs[i].data, bufs[i].bytes);
+    }
+    cli->sendCurr = cli->sendBuffer;
+}
+
 //===========================================================================
 static void AddToSendBuffer (
     NetCli *            cli,
@@ -220,37 +269,70 @@ static void AddToSendBuffer (
 ) {
     uint8_t const * src = (uint8_t const *) data;
 
-    if (bytes > arrsize(cli->sendBuffer)) {
-        // Let the OS fragment oversize buffers
-        FlushSendBuffer(cli);
-        void * heap = malloc(bytes);
-        memcpy(heap, data, bytes);
-        PutBufferOnWire(cli, heap, bytes);
-        free(heap);
+    // Let the OS fragment oversize buffers. If they need encrypting they
+    // have to be copied anyway, so they stream through the send buffer
+    // and get encrypted there.
+    if (bytes > arrsize(cli->sendBuffer) && !(cli->mode == kNetCliModeEncrypted && cli->cryptOut)) {
+        GatherSendBuffer(cli, bytes, data);
+        return;
     }
-    else {
-        for (;;) {
-            // calculate the space left in the output buffer and use it
-            // to determine the maximum number of bytes that will fit
-            unsigned const left = &cli->sendBuffer[arrsize(cli->sendBuffer)] - cli->sendCurr;
-            unsigned const copy = min(bytes, left);
-
-            // copy the data into the buffer
-            for (unsigned i = 0; i < copy; ++i)
-                cli->sendCurr[i] = src[i];
-            cli->sendCurr += copy;
-            ASSERT(cli->sendCurr - cli->sendBuffer <= sizeof(cli->sendBuffer));
-
-            // if we copied all the data then bail
-            if (copy < left)
-                break;
 
-            src   += copy;
-            bytes -= copy;
+    for (;;) {
+        // calculate the space left in the output buffer and use it
+        // to determine the maximum number of bytes that will fit
+        unsigned const left = &cli->sendBuffer[arrsize(cli->sendBuffer)] - cli->sendCurr;
+        unsigned const copy = min(bytes, left);
+
+        // copy the data into the buffer
+        memcpy(cli->sendCurr, src, copy);
+        cli->sendCurr += copy;
+        cli->sendStats.bytesCopied += copy;
+        ASSERT(cli->sendCurr - cli->sendBuffer <= sizeof(cli->sendBuffer));
+
+        // if we copied all the data then bail
+        if (copy < left)
+            break;
+
+        src   += copy;
+        bytes -= copy;
+
+        FlushSendBuffer(cli);
+    }
+}
 
+//===========================================================================
+// Writes an array of integers in wire (little endian) order. Big endian
+// hosts swap each value straight into the send buffer.
+static void AddIntegersToSendBuffer (
+    NetCli *            cli,
+    unsigned            size,
+    unsigned            count,
+    void const * const  data
+) {
+#if LITTLE_ENDIAN
+    AddToSendBuffer(cli, size * count, data);
+#else
+    uint8_t const * src = (uint8_t const *) data;
+    for (unsigned i = 0; i < count; ++i, src += size) {
+        if ((unsigned) (&cli->sendBuffer[arrsize(cli->sendBuffer)] - cli->sendCurr) < size)
             FlushSendBuffer(cli);
+
+        if (size == sizeof(uint8_t)) {
+            *cli->sendCurr = *src;
+        } else if (size == sizeof(uint16_t)) {
+            uint16_t value = hsToLE16(*(const uint16_t *) src);
+            memcpy(cli->sendCurr, &value, sizeof(value));
+        } else if (size == sizeof(uint32_t)) {
+            uint32_t value = hsToLE32(*(const uint32_t *) src);
+            memcpy(cli->sendCurr, &value, sizeof(value));
+        } else if (size == sizeof(uint64_t)) {
+            uint64_t value = hsToLE64(*(const uint64_t *) src);
+            memcpy(cli->sendCurr, &value, sizeof(value));
         }
+        cli->sendCurr += size;
+        cli->sendStats.bytesCopied += size;
     }
+#endif
 }
 
 //============================================================================
@@ -266,9 +348,11 @@ static void BufferedSendData (
     ASSERT(msg);
     ASSERT(fieldCount);
 
-    if (!cli->sock)
+    if (!cli->sock && !cli->loopback)
         return;
 
+    ++cli->sendStats.msgs;
+
     uintptr_t const * const msgEnd = msg + fieldCount;
 
     const NetMsgInitSend * sendMsg = NetMsgChannelFindSendMessage(cli->channel, msg[0]);
@@ -290,42 +374,29 @@ static void BufferedSendData (
         switch (cmd->type) {
             case kNetMsgFieldInteger: {
                 const unsigned count = cmd->count ? cmd->count : 1;
-                const unsigned bytes = cmd->size * count;
-                void * temp = malloc(bytes);
-                
+
                 if (count == 1)
                 {
                     // Single values are passed by value
                     if (cmd->size == sizeof(uint8_t)) {
-                        *(uint8_t*)temp = *(uint8_t*)msg;
+                        const uint8_t value = (uint8_t)*msg;
+                        AddToSendBuffer(cli, sizeof(value), &value);
                     } else if (cmd->size == sizeof(uint16_t)) {
-                        *(uint16_t*)temp = hsToLE16(*(uint16_t*)msg);
+                        const uint16_t value = hsToLE16((uint16_t)*msg);
+                        AddToSendBuffer(cli, sizeof(value), &value);
                     } else if (cmd->size == sizeof(uint32_t)) {
-                        *(uint32_t*)temp = hsToLE32(*(uint32_t*)msg);
+                        const uint32_t value = hsToLE32((uint32_t)*msg);
+                        AddToSendBuffer(cli, sizeof(value), &value);
                     } else if (cmd->size == sizeof(uint64_t)) {
-                        *(uint64_t*)temp = hsToLE64(*(uint64_t*)msg);
+                        const uint64_t value = hsToLE64(*(const uint64_t *)msg);
+                        AddToSendBuffer(cli, sizeof(value), &value);
                     }
                 }
                 else
                 {
                     // Value arrays are passed in by ptr
-                    for (size_t i = 0; i < count; i++) {
-                        if (cmd->size == sizeof(uint8_t)) {
-                            ((uint8_t*)temp)[i] = ((uint8_t*)*msg)[i];
-                        } else if (cmd->size == sizeof(uint16_t)) {
-                            ((uint16_t*)temp)[i] = hsToLE16(((uint16_t*)*msg)[i]);
-                        } else if (cmd->size == sizeof(uint32_t)) {
-                            ((uint32_t*)temp)[i] = hsToLE32(((uint32_t*)*msg)[i]);
-                        } else if (cmd->size == sizeof(uint64_t)) {
-                            ((uint64_t*)temp)[i] = hsToLE64(((uint64_t*)*msg)[i]);
-                        }
-                    }
+                    AddIntegersToSendBuffer(cli, cmd->size, count, (const void *) *msg);
                 }
-                
-                // Write values to send buffer
-                AddToSendBuffer(cli, bytes, temp);
-
-                free(temp);
             }
             break;
 
@@ -1069,6 +1140,9 @@ void NetCliDelete (
     if (cli->sock && deleteSocket)
         AsyncSocketDelete(cli->sock);
 
+    if (cli->loopback)
+        cli->loopback->loopback = nil;
+
     if (cli->cryptIn)
         CryptKeyClose(cli->cryptIn);
     if (cli->cryptOut)
@@ -1088,6 +1162,64 @@ void NetCliFlush (
         FlushSendBuffer(cli);
 }
 
+//============================================================================
+void NetCliGetSendStats (
+    NetCli *            cli,
+    NetCliSendStats *   stats
+) {
+    *stats = cli->sendStats;
+}
+
+//============================================================================
+void NetCliResetSendStats (
+    NetCli *        cli
+) {
+    memset(&cli->sendStats, 0, sizeof(cli->sendStats));
+}
+
+//============================================================================
+void NetCliCreateLoopback (
+    unsigned        protocol,
+    bool            encrypt,
+    void *          recvParam,
+    NetCli **       client,
+    NetCli **       server
+) {
+    *client = nil;
+    *server = nil;
+
+    NetCli * cli = ConnCreate(nil, protocol, kNetCliModeClientStart);
+    NetCli * srv = ConnCreate(nil, protocol, kNetCliModeServerStart);
+    if (!cli || !srv) {
+        if (cli)
+            NetCliDelete(cli, false);
+        if (srv)
+            NetCliDelete(srv, false);
+        return;
+    }
+
+    // Skip the handshake; both ends start out already connected
+    cli->mode = kNetCliModeEncrypted;
+    srv->mode = kNetCliModeEncrypted;
+
+    if (encrypt) {
+        uint8_t sharedSeed[kNetMaxSymmetricSeedBytes];
+        CryptCreateRandomSeed(sizeof(sharedSeed), sharedSeed);
+        cli->cryptIn  = CryptKeyCreate(kCryptRc4, sizeof(sharedSeed), sharedSeed);
+        cli->cryptOut = CryptKeyCreate(kCryptRc4, sizeof(sharedSeed), sharedSeed);
+        srv->cryptIn  = CryptKeyCreate(kCryptRc4, sizeof(sharedSeed), sharedSeed);
+        srv->cryptOut = CryptKeyCreate(kCryptRc4, sizeof(sharedSeed), sharedSeed);
+    }
+
+    cli->loopback       = srv;
+    cli->loopbackParam  = recvParam;
+    srv->loopback       = cli;
+    srv->loopbackParam  = recvParam;
+
+    *client = cli;
+    *server = srv;
+}
+
 //============================================================================
 void NetCliSend (
     NetCli *            cli,
@@ -436,5 +436,35 @@ bool NetCliDispatch (
     void *          param
 );
 
+struct NetCliSendStats {
+    unsigned    msgs;           // messages sent
+    unsigned    socketSends;    // calls into the socket layer
+    unsigned    allocs;         // heap allocations made by the send path
+    uint64_t    bytesSent;      // bytes handed to the socket
+    uint64_t    bytesCopied;    // bytes copied into the send buffer
+    uint64_t    bytesGathered;  // bytes sent straight out of the caller's memory
+};
+
+void NetCliGetSendStats (
+    NetCli *            cli,
+    NetCliSendStats *   stats
+);
+
+void NetCliResetSendStats (
+    NetCli *        cli
+);
+
+// Creates two connections wired back to back in memory. Whatever one sends
+// is dispatched straight into the other, through RC4 if encrypt is set, and
+// recvParam is handed to the receive handlers. This exercises the message
+// pipeline without a socket, for benchmarks. Free both with NetCliDelete.
+void NetCliCreateLoopback (
+    unsigned        protocol,
+    bool            encrypt,
+    void *          recvParam,
+    NetCli **       client,
+    NetCli **       server
+);
+
 
 #endif // PLASMA20_SOURCES_PLASMA_NUCLEUSLIB_PNNETCLI_PNNETCLI_H
@@ -48,6 +48,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plInterp/plInterpCreatable.h"
 #include "plInputCore/plInputCoreCreatable.h"
 #include "plPipeline/plPipelineCreatable.h"
+#include "plNullPipeline/plNullPipelineCreatable.h"
 #include "plResMgr/plResMgrCreatable.h"
 #include "plSurface/plSurfaceCreatable.h"
 #include "plNetClient/plNetClientCreatable.h"
@@ -935,6 +935,7 @@ bool plAudioSystem::MsgReceive(plMessage* msg)
         //if( fListener )
         {
             plProfile_BeginLap(AudioUpdate, this->GetKey()->GetUoid().GetObjectName().c_str());
+            plSoundBuffer::ReportDecodeStats();
             if(hsTimer::GetMilliSeconds() - fLastUpdateTimeMs > UPDATE_TIME_MS)
             {
                 IUpdateSoftSounds( fCurrListenerPos );
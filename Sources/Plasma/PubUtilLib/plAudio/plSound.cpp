@@ -503,6 +503,8 @@ void plSound::Stop( void )
     // if the audio data is loading while stop is called we need to make sure the sounds doesn't play, and the data is unloaded.
     fPlayOnReactivate = false;  
     fFreeData = true;
+    if(fLoading)
+        FreeSoundData();
     
     // Do we have an ending fade?
     if( fFadeOutParams.fLengthInSecs > 0 && !plgAudioSys::IsRestarting() )
@@ -825,6 +827,14 @@ void plSound::FreeSoundData()
     if(buffer)
     {
         buffer->UnLoad();
+
+        // Unloading takes back a decode that hadn't started, so there's nothing left to wait for
+        if(fLoading && !buffer->IsLoading())
+        {
+            fLoading = false;
+            fPlayWhenLoaded = false;
+            fFreeData = false;
+        }
     }
 }
 
@@ -851,6 +861,7 @@ plSoundBuffer::ELoadReturnVal plSound::IPreLoadBuffer( bool playWhenLoaded, bool
     if(buffer && buffer->IsValid() )
     {
         plProfile_BeginTiming( SoundLoadTime );
+        buffer->SetDecodePriority( playWhenLoaded, fDistToListenerSquared );
         plSoundBuffer::ELoadReturnVal retVal = buffer->AsyncLoad(buffer->HasFlag(plSoundBuffer::kStreamCompressed) ? plAudioFileReader::kStreamNative : plAudioFileReader::kStreamWAV);
         if(retVal == plSoundBuffer::kPending)
         {
@@ -164,6 +164,7 @@ plSoundBuffer::ELoadReturnVal plWin32StreamingSound::IPreLoadBuffer( bool playWh
 
         if(!fStartPos)
         {
+            buffer->SetDecodePriority( playWhenLoaded, fDistToListenerSquared );
             if(buffer->AsyncLoad(type, isIncidental ? 0 : STREAMING_BUFFERS * STREAM_BUFFER_SIZE ) == plSoundBuffer::kPending)
             {
                 fPlayWhenLoaded = playWhenLoaded;
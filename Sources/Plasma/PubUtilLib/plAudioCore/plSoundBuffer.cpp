@@ -54,15 +54,31 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plUnifiedTime/plUnifiedTime.h"
 #include "plStatusLog/plStatusLog.h"
 #include "hsTimer.h"
-
+#include "plProfile.h"
+
+#if HS_BUILD_FOR_UNIX
+#include <unistd.h>
+#endif
+
+plProfile_CreateCounterNoReset( "Decode Threads", "Sound", SoundDecodeThreads );
+plProfile_CreateCounterNoReset( "Decode Queued", "Sound", SoundDecodeQueued );
+plProfile_CreateCounter( "Decoded", "Sound", SoundDecoded );
+plProfile_CreateCounter( "Decode Cancelled", "Sound", SoundDecodeCancelled );
+plProfile_CreateCounter( "Decoded KB", "Sound", SoundDecodedKB );
+plProfile_CreateCounter( "Decode Avg Wait ms", "Sound", SoundDecodeAvgWait );
+plProfile_CreateCounter( "Decode Max Wait ms", "Sound", SoundDecodeMaxWait );
+
+//  Anything with a directory in it (either separator) or a drive letter is
+//  already a path, bare names live in sfx.
 static void GetFullPath( const char filename[], char *destStr )
 {
     char    path[ kFolderIterator_MaxPath ];
 
-    if( strchr( filename, '\\' ) != nil )
+    if( strchr( filename, '\\' ) != nil || strchr( filename, '/' ) != nil
+        || ( filename[ 0 ] != 0 && filename[ 1 ] == ':' ) )
         strcpy( path, filename );
     else
-        sprintf( path, "sfx\\%s", filename );
+        sprintf( path, "sfx" PATH_SEPARATOR_STR "%s", filename );
 
     strcpy( destStr, path );
 }
@@ -89,74 +105,287 @@ static plAudioFileReader *CreateReader( bool fullpath, const char filename[], pl
     return reader;
 }
 
-hsError plSoundPreloader::Run()
+//// plSoundDecodeThread ///////////////////////////////////////////////////
+//  One of the preloader's threads. All the work is in the preloader.
+
+class plSoundDecodeThread : public hsThread
 {
-    hsTArray<plSoundBuffer*> templist;
+protected:
+    plSoundPreloader*   fPool;
 
-    while (fRunning)
+public:
+    plSoundDecodeThread(plSoundPreloader* pool) : fPool(pool) {}
+
+    virtual hsError Run()
     {
-        fCritSect.Lock();
-        while (fBuffers.GetCount())
+        while (fPool->IDecodeNext())
+            ;
+        return hsOK;
+    }
+};
+
+static int IGetNumCores()
+{
+#if HS_BUILD_FOR_WIN32
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (int)info.dwNumberOfProcessors;
+#else
+    long numCores = sysconf(_SC_NPROCESSORS_ONLN);
+    return numCores > 0 ? (int)numCores : 1;
+#endif
+}
+
+//// plSoundPreloader ////////////////////////////////////////////////////////
+
+plSoundPreloader::plSoundPreloader()
+:   fNumThreads(0),
+    fRunning(false)
+{
+    memset(fThreads, 0, sizeof(fThreads));
+}
+
+plSoundPreloader::~plSoundPreloader()
+{
+    Stop();
+}
+
+void plSoundPreloader::Start(int numThreads)
+{
+    if (fRunning)
+        return;
+
+    // Leave a core for the client itself
+    if (numThreads <= 0)
+        numThreads = IGetNumCores() - 1;
+    if (numThreads < 1)
+        numThreads = 1;
+    if (numThreads > kMaxThreads)
+        numThreads = kMaxThreads;
+
+    fRunning = true;
+    fNumThreads = numThreads;
+    for (int i = 0; i < fNumThreads; i++)
+    {
+        fThreads[i] = new plSoundDecodeThread(this);
+        fThreads[i]->Start();
+    }
+
+    plStatusLog::AddLineS("audio.log", "Sound preloader started with %d decode threads", fNumThreads);
+}
+
+void plSoundPreloader::Stop()
+{
+    if (!fRunning)
+        return;
+
+    fCritSect.Lock();
+    fRunning = false;
+    fCritSect.Unlock();
+    fEvent.Signal();
+
+    for (int i = 0; i < fNumThreads; i++)
+    {
+        fThreads[i]->Stop();
+        delete fThreads[i];
+        fThreads[i] = nil;
+    }
+    fNumThreads = 0;
+
+    // we need to be sure that all buffers are removed from our load list when shutting this thread down or we will hang,
+    // since the sound buffer will wait to be destroyed until it is marked as loaded 
+    fCritSect.Lock();
+    for (int i = 0; i < fBuffers.GetCount(); i++)
+        fBuffers[i].fBuffer->SetLoaded(true);
+    fBuffers.Reset();
+    fCritSect.Unlock();
+}
+
+int plSoundPreloader::GetNumQueued()
+{
+    hsTempMutexLock lock(fCritSect);
+    return fBuffers.GetCount();
+}
+
+void plSoundPreloader::AddBuffer(plSoundBuffer* buffer)
+{
+    Request req;
+    req.fBuffer = buffer;
+    req.fQueuedAt = hsTimer::GetSeconds();
+
+    fCritSect.Lock();
+    fBuffers.Append(req);
+    fCritSect.Unlock();
+
+    fEvent.Signal();
+}
+
+bool plSoundPreloader::Cancel(plSoundBuffer* buffer)
+{
+    hsTempMutexLock lock(fCritSect);
+    for (int i = 0; i < fBuffers.GetCount(); i++)
+    {
+        if (fBuffers[i].fBuffer == buffer)
         {
-            templist.Append(fBuffers.Pop());
+            fBuffers.Remove(i);
+            fStats.fNumCancelled++;
+            return true;
         }
-        fCritSect.Unlock();
+    }
+    return false;
+}
 
-        if (templist.GetCount() == 0)
+void plSoundPreloader::WaitFor(plSoundBuffer* buffer)
+{
+    // fDoneEvent stays signalled until it's waited on, so a decode finishing
+    // between the check and the wait can't be missed.
+    while (!buffer->IsLoaded())
+        fDoneEvent.Wait();
+}
+
+void plSoundPreloader::GrabStats(plSoundDecodeStats& stats)
+{
+    hsTempMutexLock lock(fCritSect);
+    stats = fStats;
+    fStats.Clear();
+}
+
+//// IPickNext ///////////////////////////////////////////////////////////////
+//  Sounds that will play when they're loaded beat ones that won't, then the
+//  nearer one wins, then the one that's waited longer. Call with fCritSect
+//  held.
+
+int plSoundPreloader::IPickNext() const
+{
+    int best = 0;
+    for (int i = 1; i < fBuffers.GetCount(); i++)
+    {
+        const plSoundBuffer* cand = fBuffers[i].fBuffer;
+        const plSoundBuffer* curr = fBuffers[best].fBuffer;
+
+        if (cand->GetDecodePlaying() != curr->GetDecodePlaying())
         {
-            fEvent.Wait();
+            if (cand->GetDecodePlaying())
+                best = i;
         }
-        else
+        else if (cand->GetDecodeDistSquared() != curr->GetDecodeDistSquared())
         {
-            plAudioFileReader *reader = nil;
-            while (templist.GetCount())
-            {
-                plSoundBuffer* buf = templist.Pop();
-
-                if (buf->GetData())
-                {
-                    reader = CreateReader(true, buf->GetFileName(), buf->GetAudioReaderType(), buf->GetReaderSelect());  
-                    
-                    if( reader )
-                    {
-                        unsigned readLen = buf->GetAsyncLoadLength() ? buf->GetAsyncLoadLength() : buf->GetDataLength(); 
-                        reader->Read( readLen, buf->GetData() );
-                        buf->SetAudioReader(reader);     // give sound buffer reader, since we may need it later
-                    }
-                    else
-                    {
-                        buf->SetError();
-                    }
-                }
-
-                buf->SetLoaded(true);
-            }
+            if (cand->GetDecodeDistSquared() < curr->GetDecodeDistSquared())
+                best = i;
         }
+        else if (fBuffers[i].fQueuedAt < fBuffers[best].fQueuedAt)
+            best = i;
     }
+    return best;
+}
 
-    // we need to be sure that all buffers are removed from our load list when shutting this thread down or we will hang,
-    // since the sound buffer will wait to be destroyed until it is marked as loaded 
+//// IDecodeNext /////////////////////////////////////////////////////////////
+//  Runs on the decode threads. Sleeps until there's a buffer queued, then
+//  decodes the most wanted one. Returns false when the pool is stopping.
+//  fEvent wakes everyone waiting on it but only stays set until one of them
+//  takes it, so a thread that leaves buffers in the queue, or leaves because
+//  we're stopping, sets it again for whoever hasn't woken yet.
+
+bool plSoundPreloader::IDecodeNext()
+{
     fCritSect.Lock();
-    while (fBuffers.GetCount())
+    while (fRunning && !fBuffers.GetCount())
     {
-        plSoundBuffer* buf = fBuffers.Pop();
-        buf->SetLoaded(true);
+        fCritSect.Unlock();
+        fEvent.Wait();
+        fCritSect.Lock();
+    }
+    if (!fRunning)
+    {
+        fCritSect.Unlock();
+        fEvent.Signal();
+        return false;
+    }
+
+    int idx = IPickNext();
+    Request req = fBuffers[idx];
+    fBuffers.Remove(idx);
+    bool more = (fBuffers.GetCount() > 0);
+    fCritSect.Unlock();
+
+    if (more)
+        fEvent.Signal();
+
+    double startTime = hsTimer::GetSeconds();
+
+    plSoundBuffer* buf = req.fBuffer;
+    uint32_t bytes = 0;
+    if (buf->GetData())
+    {
+        plAudioFileReader* reader = CreateReader(true, buf->GetFileName(), buf->GetAudioReaderType(), buf->GetReaderSelect());  
+
+        if( reader )
+        {
+            unsigned readLen = buf->GetAsyncLoadLength() ? buf->GetAsyncLoadLength() : buf->GetDataLength(); 
+            reader->Read( readLen, buf->GetData() );
+            buf->SetAudioReader(reader);     // give sound buffer reader, since we may need it later
+            bytes = readLen;
+        }
+        else
+        {
+            buf->SetError();
+        }
     }
+
+    double wait = startTime - req.fQueuedAt;
+
+    fCritSect.Lock();
+    fStats.fNumDecoded++;
+    fStats.fBytesDecoded += bytes;
+    fStats.fWaitSecs += wait;
+    if (wait > fStats.fMaxWaitSecs)
+        fStats.fMaxWaitSecs = wait;
+
+    // Once it's marked loaded the buffer may go away under us, so this is the last touch
+    buf->SetLoaded(true);
     fCritSect.Unlock();
 
-    return hsOK;
+    fDoneEvent.Signal();
+
+    return true;
 }
 
 static plSoundPreloader gLoaderThread;
 
-void plSoundBuffer::Init()
+void plSoundBuffer::Init(int numDecodeThreads)
 {
-    gLoaderThread.Start();
+    gLoaderThread.Start(numDecodeThreads);
+    plProfile_Set(SoundDecodeThreads, gLoaderThread.GetNumThreads());
 }
 
 void plSoundBuffer::Shutdown()
 {
     gLoaderThread.Stop();
+    plProfile_Set(SoundDecodeThreads, 0);
+}
+
+int plSoundBuffer::GetNumDecodeThreads()
+{
+    return gLoaderThread.GetNumThreads();
+}
+
+void plSoundBuffer::GrabDecodeStats(plSoundDecodeStats& stats)
+{
+    gLoaderThread.GrabStats(stats);
+}
+
+void plSoundBuffer::ReportDecodeStats()
+{
+    plSoundDecodeStats stats;
+    gLoaderThread.GrabStats(stats);
+
+    plProfile_Set(SoundDecodeQueued, gLoaderThread.GetNumQueued());
+    plProfile_Set(SoundDecoded, stats.fNumDecoded);
+    plProfile_Set(SoundDecodeCancelled, stats.fNumCancelled);
+    plProfile_Set(SoundDecodedKB, stats.fBytesDecoded / 1024);
+    plProfile_Set(SoundDecodeMaxWait, (uint32_t)(stats.fMaxWaitSecs * 1000.0));
+    if (stats.fNumDecoded)
+        plProfile_Set(SoundDecodeAvgWait, (uint32_t)(stats.fWaitSecs * 1000.0 / stats.fNumDecoded));
 }
 
 //// Constructor/Destructor //////////////////////////////////////////////////
@@ -180,10 +409,9 @@ plSoundBuffer::~plSoundBuffer()
     // otherwise it may try to access this buffer after it's been deleted
     if(fLoading)
     {
-        while(!fLoaded)
-        {
-            hsSleep::Sleep(10);
-        }
+        if(!gLoaderThread.Cancel(this))
+            gLoaderThread.WaitFor(this);
+        fLoading = false;
     }
 
     delete [] fFileName;
@@ -202,6 +430,10 @@ void plSoundBuffer::IInitBuffer()
     fReader = nil;
     fLoaded = 0;
     fLoading = false;
+    fAsyncLoadLength = 0;
+    fStreamType = plAudioFileReader::kStreamNative;
+    fDecodePlaying = false;
+    fDecodeDistSquared = 0.f;
     fHeader.fFormatTag = 0;
     fHeader.fNumChannels = 0;
     fHeader.fNumSamplesPerSec = 0;
@@ -332,15 +564,7 @@ void    plSoundBuffer::IGetFullPath( char *destStr )
         *destStr = 0;
         return;
     }
-    char    path[ kFolderIterator_MaxPath ];
-
-
-    if( strchr( fFileName, '\\' ) != nil )
-        strcpy( path, fFileName );
-    else
-        sprintf( path, "sfx\\%s", fFileName );
-
-    strcpy( destStr, path );
+    GetFullPath( fFileName, destStr );
 }
 
 
@@ -365,8 +589,8 @@ plSoundBuffer::ELoadReturnVal plSoundBuffer::AsyncLoad(plAudioFileReader::Stream
                 return kError;
         }
 
-        gLoaderThread.AddBuffer(this);
         fLoading = true;
+        gLoaderThread.AddBuffer(this);
     }
     if(fLoaded) 
     {   
@@ -401,7 +625,13 @@ void    plSoundBuffer::UnLoad( void )
     if(fLoaded)
         int i = 0;
     if(fLoading) 
-        return;
+    {
+        // Still queued, so take it back before anyone decodes it. Once a
+        // thread has it we have to let it finish.
+        if(fLoaded || !gLoaderThread.Cancel(this))
+            return;
+        fLoading = false;
+    }
 
     if(fReader)
         fReader->Close();
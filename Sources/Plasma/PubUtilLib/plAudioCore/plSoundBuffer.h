@@ -61,6 +61,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 class plUnifiedTime;
 class plAudioFileReader;
+struct plSoundDecodeStats;
 class plSoundBuffer : public hsKeyedObject
 {       
 public:
@@ -107,12 +108,23 @@ public:
     // Must be called until return value is kSuccess. starts an asynchronous load first time called. returns kSuccess when finished.
     ELoadReturnVal      AsyncLoad( plAudioFileReader::StreamType type, unsigned length = 0 );   
     void                UnLoad( );
+    bool                IsLoading() const { return fLoading; }
+    bool                IsLoaded() const { return fLoaded; }
+
+    // Ordering hints for the preloader, may be updated while the load is pending
+    void                SetDecodePriority( bool playWhenLoaded, float distToListenerSquared )
+                        { fDecodePlaying = playWhenLoaded; fDecodeDistSquared = distToListenerSquared; }
+    bool                GetDecodePlaying() const { return fDecodePlaying; }
+    float               GetDecodeDistSquared() const { return fDecodeDistSquared; }
 
     plAudioCore::ChannelSelect  GetReaderSelect( void ) const;
 
     
-    static void         Init();
+    static void         Init(int numDecodeThreads = 0);
     static void         Shutdown();
+    static int          GetNumDecodeThreads();
+    static void         GrabDecodeStats(plSoundDecodeStats& stats);
+    static void         ReportDecodeStats();    // once a frame, from the main thread
     plAudioFileReader * GetAudioReader();   // transfers ownership to caller
     void                SetAudioReader(plAudioFileReader *reader);
     void                SetLoaded(bool loaded);
@@ -152,43 +164,92 @@ protected:
     uint32_t              fDataLength;
     uint32_t              fAsyncLoadLength;
     plAudioFileReader::StreamType fStreamType;
+    bool                fDecodePlaying;
+    float               fDecodeDistSquared;
 
     // for plugins only
     plAudioFileReader   *IGetReader( bool fullpath );
 };
 
 
-class plSoundPreloader : public hsThread
+//// plSoundDecodeStats //////////////////////////////////////////////////////
+//  What the preloader has finished since the stats were last grabbed.
+
+struct plSoundDecodeStats
 {
+    uint32_t    fNumDecoded;
+    uint32_t    fNumCancelled;
+    uint32_t    fBytesDecoded;
+    double      fWaitSecs;      // summed time buffers sat in the queue
+    double      fMaxWaitSecs;
+
+    plSoundDecodeStats() { Clear(); }
+    void Clear()
+    {
+        fNumDecoded = fNumCancelled = fBytesDecoded = 0;
+        fWaitSecs = fMaxWaitSecs = 0;
+    }
+};
+
+//// plSoundPreloader ////////////////////////////////////////////////////////
+//  Pool of threads decoding plSoundBuffers for AsyncLoad. There's one thread
+//  per core less the one the client runs on. Idle threads sleep on fEvent
+//  until a buffer is queued. Each thread takes the queued buffer that's most
+//  wanted: sounds waiting to play first, then the one nearest the listener,
+//  then the oldest. Priorities are read when a buffer is picked, so sounds
+//  that refresh them while they wait reorder the queue.
+
+class plSoundDecodeThread;
+class plSoundPreloader
+{
+    friend class plSoundDecodeThread;
+
 protected:
-    hsTArray<plSoundBuffer*> fBuffers;
-    hsEvent fEvent;
-    bool fRunning;
-    hsMutex fCritSect;
+    struct Request
+    {
+        plSoundBuffer*  fBuffer;
+        double          fQueuedAt;
+    };
 
-public:
-    virtual hsError Run();
+    enum
+    {
+        kMaxThreads = 8
+    };
 
-    virtual void Start() {
-        fRunning = true;
-        hsThread::Start();
-    }
+    hsTArray<Request>       fBuffers;
+    plSoundDecodeThread*    fThreads[kMaxThreads];
+    int                     fNumThreads;
+    hsEvent                 fEvent;     // work queued, or we're stopping
+    hsEvent                 fDoneEvent; // a decode finished
+    bool                    fRunning;
+    hsMutex                 fCritSect;
+    plSoundDecodeStats      fStats;
 
-    virtual void Stop() {
-        fRunning = false;
-        fEvent.Signal();
-        hsThread::Stop();
-    }
+    int                     IPickNext() const;
+    bool                    IDecodeNext();
+
+public:
+    plSoundPreloader();
+    ~plSoundPreloader();
+
+    void Start(int numThreads = 0);     // 0 sizes the pool to the cores
+    void Stop();
 
     bool IsRunning() const { return fRunning; }
+    int GetNumThreads() const { return fNumThreads; }
+    int GetNumQueued();
 
-    void AddBuffer(plSoundBuffer* buffer) {
-        fCritSect.Lock();
-        fBuffers.Push(buffer);
-        fCritSect.Unlock();
+    void AddBuffer(plSoundBuffer* buffer);
 
-        fEvent.Signal();
-    }
+    // Takes a buffer back out of the queue. Returns false if it isn't queued,
+    // meaning it's being decoded or already done.
+    bool Cancel(plSoundBuffer* buffer);
+
+    // Blocks until a buffer a thread has picked up is decoded.
+    void WaitFor(plSoundBuffer* buffer);
+
+    // Copies out the stats and starts counting again
+    void GrabStats(plSoundDecodeStats& stats);
 };
 
 #endif //_plSoundBuffer_h
@@ -0,0 +1,652 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+/** \file plAGCompiledGraph.cpp
+    \brief Flattened evaluation of a plAGMasterMod's transform channels
+
+    \ingroup Avatar
+    \ingroup AniGraph
+*/
+#include "HeadSpin.h"
+#include "plAGCompiledGraph.h"
+
+#include "hsCpuID.h"
+#include "hsTemplates.h"
+#include "hsThread.h"
+#include "plProfile.h"
+
+#include "plAGApplicator.h"
+#include "plAGModifier.h"
+#include "plMatrixChannel.h"
+#include "plScalarChannel.h"
+#include "plInterp/plController.h"
+#include "plInterp/hsInterp.h"
+
+#ifdef HS_SIMD_INCLUDE
+#  include HS_SIMD_INCLUDE
+#endif
+
+plProfile_Extern(AffineInterp);
+plProfile_Extern(AffineBlend);
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Kernels
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+// Same result as hsInterp::LinInterp for a blend weight strictly between 0 and 1.
+typedef void(*blend_parts_ptr)(const hsAffineParts* a, const hsAffineParts* b, float t, hsAffineParts* out);
+
+static void blend_parts_fpu(const hsAffineParts* a, const hsAffineParts* b, float t, hsAffineParts* out)
+{
+    hsInterp::LinInterp(a, b, t, out);
+}
+
+static void blend_parts_sse1(const hsAffineParts* a, const hsAffineParts* b, float t, hsAffineParts* out)
+{
+#ifdef HS_SSE1
+    if (a->fF != b->fF)
+        hsStatusMessageF("WARNING: Inequality in affine parts flip value.");
+
+    // The slerp weights need acos and sin, so they stay scalar. After that
+    // both quaternions are just a weighted sum of four lanes.
+    float qa, qb, ua, ub;
+    hsQuat::GetSlerpWeights(a->fQ, b->fQ, t, &qa, &qb);
+    hsQuat::GetSlerpWeights(a->fU, b->fU, t, &ua, &ub);
+
+    __m128 q = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(qa), _mm_loadu_ps(&a->fQ.fX)),
+                          _mm_mul_ps(_mm_set1_ps(qb), _mm_loadu_ps(&b->fQ.fX)));
+    __m128 u = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(ua), _mm_loadu_ps(&a->fU.fX)),
+                          _mm_mul_ps(_mm_set1_ps(ub), _mm_loadu_ps(&b->fU.fX)));
+
+    // Translation and stretch are three floats each: T plus K.x in one
+    // register and the rest of K in another covers both with two lerps.
+    const __m128 vt = _mm_set1_ps(t);
+    __m128 tA = _mm_set_ps(a->fK.fX, a->fT.fZ, a->fT.fY, a->fT.fX);
+    __m128 tB = _mm_set_ps(b->fK.fX, b->fT.fZ, b->fT.fY, b->fT.fX);
+    __m128 kA = _mm_set_ps(0.f, 0.f, a->fK.fZ, a->fK.fY);
+    __m128 kB = _mm_set_ps(0.f, 0.f, b->fK.fZ, b->fK.fY);
+    tA = _mm_add_ps(tA, _mm_mul_ps(vt, _mm_sub_ps(tB, tA)));
+    kA = _mm_add_ps(kA, _mm_mul_ps(vt, _mm_sub_ps(kB, kA)));
+
+    float tk[8];
+    _mm_storeu_ps(tk, tA);
+    _mm_storeu_ps(tk + 4, kA);
+
+    _mm_storeu_ps(&out->fQ.fX, q);
+    _mm_storeu_ps(&out->fU.fX, u);
+    out->fT.Set(tk[0], tk[1], tk[2]);
+    out->fK.Set(tk[3], tk[4], tk[5]);
+    out->fF = a->fF;
+#endif // HS_SSE1
+}
+
+static hsFunctionDispatcher<blend_parts_ptr> blend_parts(blend_parts_fpu, blend_parts_sse1);
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// plAGCompiledGraph
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+
+plAGCompiledGraph::Op::Op(uint8_t code)
+:   fCode(code),
+    fTime(0),
+    fWeight(0),
+    fResult(0),
+    fA(0),
+    fB(0),
+    fSkip(0),
+    fPose(0),
+    fChannel(nil),
+    fCache(nil),
+    fMod(nil),
+    fApp(nil)
+{
+}
+
+plAGCompiledGraph::plAGCompiledGraph()
+:   fNumBones(0),
+    fStale(false)
+{
+}
+
+void plAGCompiledGraph::Reset()
+{
+    fOps.clear();
+    fTimeOps.clear();
+    fWeightOps.clear();
+    fTimes.clear();
+    fWeights.clear();
+    fPoses.clear();
+    fResults.clear();
+    fFallbacks.clear();
+    fLive.clear();
+    fTimeRegs.clear();
+    fWeightRegs.clear();
+    fNumBones = 0;
+    fStale = false;
+}
+
+// BUILD
+void plAGCompiledGraph::Build(const std::vector<plAGModifier*> &mods)
+{
+    Reset();
+
+    // Register 0 is always the world time we're applied at.
+    fTimes.push_back(0);
+
+    for (int i = 0; i < mods.size(); i++)
+    {
+        plAGModifier *mod = mods[i];
+        if (!ICanCompile(mod))
+        {
+            fFallbacks.push_back(mod);
+            continue;
+        }
+
+        plMatrixChannelApplicator *app = (plMatrixChannelApplicator*)mod->GetApplicator(kAGPinTransform);
+
+        Op begin(kOpBeginBone);
+        begin.fMod = mod;
+        begin.fApp = app;
+        begin.fChannel = plMatrixChannel::ConvertNoRef(app->GetChannel());
+        begin.fA = fNumBones;
+        uint32_t beginIdx = IAddOp(begin);
+
+        Op apply(kOpApply);
+        apply.fMod = mod;
+        apply.fApp = app;
+        apply.fA = IFlatten(begin.fChannel, 0);
+        IAddOp(apply);
+
+        fOps[beginIdx].fSkip = fOps.size() - beginIdx - 1;
+        fLive.push_back(false);
+        fNumBones++;
+    }
+
+    fTimeRegs.clear();
+    fWeightRegs.clear();
+}
+
+// ICANCOMPILE
+// Only the plain transform applicator is flattened; derived applicators
+// (delayed correction, difference, ...) do more than compose and set.
+bool plAGCompiledGraph::ICanCompile(plAGModifier *mod) const
+{
+    if (mod->GetNumApplicators() != 1)
+        return false;
+
+    plAGApplicator *app = mod->GetApplicator(kAGPinTransform);
+    if (!app || app->ClassIndex() != plMatrixChannelApplicator::Index())
+        return false;
+
+    return plMatrixChannel::ConvertNoRef(app->GetChannel()) != nil;
+}
+
+// IFLATTEN
+// Emit the ops for one channel and everything upstream of it. Returns the
+// result slot the channel's parts will be found in.
+uint32_t plAGCompiledGraph::IFlatten(plMatrixChannel *chan, uint16_t time)
+{
+    uint16_t classIdx = chan->ClassIndex();
+
+    if (classIdx == plMatrixTimeScale::Index())
+    {
+        // A time scale is nothing but a new time register for its input.
+        plMatrixTimeScale *scale = (plMatrixTimeScale*)chan;
+        if (scale->fTimeSource && scale->fChannelIn)
+            return IFlatten(scale->fChannelIn, ITimeReg(scale->fTimeSource, time));
+    }
+    else if (classIdx == plMatrixBlend::Index())
+    {
+        plMatrixBlend *blend = (plMatrixBlend*)chan;
+        if (blend->fChannelBias && blend->fChannelA && blend->fChannelB)
+        {
+            uint16_t weight = IWeightReg(blend->fChannelBias, time);
+
+            Op skipA(kOpSkipIfOne);
+            skipA.fWeight = weight;
+            uint32_t skipAIdx = IAddOp(skipA);
+            uint32_t a = IFlatten(blend->fChannelA, time);
+            fOps[skipAIdx].fSkip = fOps.size() - skipAIdx - 1;
+
+            Op skipB(kOpSkipIfZero);
+            skipB.fWeight = weight;
+            uint32_t skipBIdx = IAddOp(skipB);
+            uint32_t b = IFlatten(blend->fChannelB, time);
+            fOps[skipBIdx].fSkip = fOps.size() - skipBIdx - 1;
+
+            Op op(kOpBlend);
+            op.fWeight = weight;
+            op.fA = a;
+            op.fB = b;
+            op.fPose = fPoses.size();
+            fPoses.push_back(hsAffineParts());
+            return fOps[IAddOp(op)].fResult;
+        }
+    }
+    else if (classIdx == plMatrixControllerCacheChannel::Index())
+    {
+        plMatrixControllerCacheChannel *cacheChan = (plMatrixControllerCacheChannel*)chan;
+        plMatrixControllerChannel *ctlChan = cacheChan->fControllerChannel;
+        if (ctlChan && ctlChan->ClassIndex() == plMatrixControllerChannel::Index() && ctlChan->fController)
+        {
+            Op op(kOpController);
+            op.fTime = time;
+            op.fChannel = ctlChan;
+            op.fCache = cacheChan->fCache;
+            return fOps[IAddOp(op)].fResult;
+        }
+    }
+    else if (classIdx == plMatrixControllerChannel::Index())
+    {
+        if (((plMatrixControllerChannel*)chan)->fController)
+        {
+            Op op(kOpController);
+            op.fTime = time;
+            op.fChannel = chan;
+            return fOps[IAddOp(op)].fResult;
+        }
+    }
+
+    // Anything else (constants, quat/point combines, channels we don't know)
+    // is a leaf we just ask for its value.
+    Op op(kOpChannel);
+    op.fTime = time;
+    op.fChannel = chan;
+    return fOps[IAddOp(op)].fResult;
+}
+
+// IADDOP
+uint32_t plAGCompiledGraph::IAddOp(const Op &op)
+{
+    fOps.push_back(op);
+
+    Op &added = fOps.back();
+    switch (added.fCode)
+    {
+    case kOpController:
+    case kOpChannel:
+    case kOpBlend:
+        added.fResult = fResults.size();
+        fResults.push_back(nil);
+        break;
+    }
+
+    return fOps.size() - 1;
+}
+
+// ITIMEREG
+// Every bone of an animation shares the same time source, so it is only
+// sampled once per frame.
+uint16_t plAGCompiledGraph::ITimeReg(plScalarChannel *source, uint16_t time)
+{
+    ScalarKey key(source, time);
+    ScalarRegMap::iterator it = fTimeRegs.find(key);
+    if (it != fTimeRegs.end())
+        return it->second;
+
+    ScalarOp op;
+    op.fChannel = source;
+    op.fIn = time;
+    op.fOut = fTimes.size();
+    fTimes.push_back(0);
+    fTimeOps.push_back(op);
+
+    fTimeRegs[key] = op.fOut;
+    return op.fOut;
+}
+
+// IWEIGHTREG
+// Likewise for the blend bias an animation instance hands to all its channels.
+uint16_t plAGCompiledGraph::IWeightReg(plScalarChannel *bias, uint16_t time)
+{
+    ScalarKey key(bias, time);
+    ScalarRegMap::iterator it = fWeightRegs.find(key);
+    if (it != fWeightRegs.end())
+        return it->second;
+
+    ScalarOp op;
+    op.fChannel = bias;
+    op.fIn = time;
+    op.fOut = fWeights.size();
+    fWeights.push_back(0);
+    fWeightOps.push_back(op);
+
+    fWeightRegs[key] = op.fOut;
+    return op.fOut;
+}
+
+// APPLY
+void plAGCompiledGraph::Apply(double time)
+{
+    Prepare(time);
+    Evaluate();
+    Commit();
+}
+
+// PREPARE
+// Anything that might reach outside the graph happens here: time sources
+// and blend biases go through their plAnimTimeConvert, which can send
+// callbacks, and a leaf channel could be anything at all.
+void plAGCompiledGraph::Prepare(double time)
+{
+    int i;
+
+    // Time sources first, in the order they were found, so a time scale
+    // under another time scale sees its parent's register filled in.
+    fTimes[0] = time;
+    for (i = 0; i < fTimeOps.size(); i++)
+    {
+        const ScalarOp &op = fTimeOps[i];
+        fTimes[op.fOut] = op.fChannel->Value(fTimes[op.fIn]);
+    }
+    for (i = 0; i < fWeightOps.size(); i++)
+    {
+        const ScalarOp &op = fWeightOps[i];
+        fWeights[op.fOut] = op.fChannel->Value(fTimes[op.fIn]);
+    }
+
+    const uint32_t numOps = fOps.size();
+    uint32_t pc = 0;
+    while (pc < numOps)
+    {
+        const Op &op = fOps[pc++];
+        switch (op.fCode)
+        {
+        case kOpBeginBone:
+            fLive[op.fA] = false;
+
+            // Attach and detach both flag the master for a rebuild, but if
+            // the applicators were swapped some other way our channel
+            // pointers can't be trusted. Do this bone the slow way.
+            if (op.fMod->GetNumApplicators() != 1 ||
+                op.fMod->GetApplicator(kAGPinTransform) != op.fApp ||
+                op.fApp->GetChannel() != op.fChannel)
+            {
+                op.fMod->Apply(time);
+                fStale = true;
+                pc += op.fSkip;
+            }
+            else if (!op.fMod->IsEnabled() || !op.fApp->IsEnabled())
+                pc += op.fSkip;
+            else
+                fLive[op.fA] = true;
+            break;
+
+        case kOpChannel:
+            fResults[op.fResult] = &op.fChannel->AffineValue(fTimes[op.fTime]);
+            break;
+
+        case kOpSkipIfOne:
+            if (fWeights[op.fWeight] == 1)
+                pc += op.fSkip;
+            break;
+
+        case kOpSkipIfZero:
+            if (fWeights[op.fWeight] == 0)
+                pc += op.fSkip;
+            break;
+        }
+    }
+}
+
+// EVALUATE
+// Controllers only read their keys and write their own channel's parts,
+// and blends only write our pose buffer. An uncached controller keeps its
+// key search hint on the shared controller, but any key index is a fine
+// place to start the search from, so racing on it is harmless.
+void plAGCompiledGraph::Evaluate(bool timed)
+{
+    const uint32_t numOps = fOps.size();
+    uint32_t pc = 0;
+    while (pc < numOps)
+    {
+        const Op &op = fOps[pc++];
+        switch (op.fCode)
+        {
+        case kOpBeginBone:
+            if (!fLive[op.fA])
+                pc += op.fSkip;
+            break;
+
+        case kOpController:
+            {
+                plMatrixControllerChannel *ctlChan = (plMatrixControllerChannel*)op.fChannel;
+                if (timed)
+                    plProfile_BeginTiming(AffineInterp);
+                ctlChan->fController->Interp((float)fTimes[op.fTime], &ctlChan->fAP, op.fCache);
+                if (timed)
+                    plProfile_EndTiming(AffineInterp);
+                fResults[op.fResult] = &ctlChan->fAP;
+            }
+            break;
+
+        case kOpSkipIfOne:
+            if (fWeights[op.fWeight] == 1)
+                pc += op.fSkip;
+            break;
+
+        case kOpSkipIfZero:
+            if (fWeights[op.fWeight] == 0)
+                pc += op.fSkip;
+            break;
+
+        case kOpBlend:
+            {
+                float blend = fWeights[op.fWeight];
+                if (blend == 0)
+                    fResults[op.fResult] = fResults[op.fA];
+                else if (blend == 1)
+                    fResults[op.fResult] = fResults[op.fB];
+                else
+                {
+                    hsAffineParts *pose = &fPoses[op.fPose];
+                    if (timed)
+                        plProfile_BeginTiming(AffineBlend);
+                    blend_parts.call(fResults[op.fA], fResults[op.fB], blend, pose);
+                    if (timed)
+                        plProfile_EndTiming(AffineBlend);
+                    fResults[op.fResult] = pose;
+                }
+            }
+            break;
+        }
+    }
+}
+
+// COMMIT
+void plAGCompiledGraph::Commit()
+{
+    int i;
+
+    const uint32_t numOps = fOps.size();
+    uint32_t pc = 0;
+    while (pc < numOps)
+    {
+        const Op &begin = fOps[pc];
+        pc += begin.fSkip + 1;
+        if (!fLive[begin.fA])
+            continue;
+
+        // Between a batched Prepare and Commit the rest of the eval ran; if
+        // it swapped this bone's applicator, leave the bone alone this frame.
+        if (begin.fMod->GetApplicator(kAGPinTransform) != begin.fApp)
+        {
+            fStale = true;
+            continue;
+        }
+
+        // The bone's ops end with its kOpApply.
+        const Op &apply = fOps[pc - 1];
+        apply.fApp->ApplyAffineParts(apply.fMod, *fResults[apply.fA]);
+    }
+
+    for (i = 0; i < fFallbacks.size(); i++)
+        fFallbacks[i]->Apply(fTimes[0]);
+}
+
+/////////////////////////////////////////////////////////////////////////////////////////
+//
+// Threaded Evaluation
+//
+/////////////////////////////////////////////////////////////////////////////////////////
+// Like plSoftwareSkin's threads, these are started once and kept waiting on
+// their start event, since there's a batch every frame. A graph is the unit
+// of work; avatars differ a lot in size, so rather than cutting the batch
+// into fixed ranges every thread keeps taking the next graph until none
+// are left.
+
+static plAGCompiledGraph    **sQueue = nil;
+static int                  sQueueCount = 0;
+static int                  sQueueNext = 0;
+static hsMutex              sQueueLock;     // Guards sQueueNext
+
+static void EvaluateQueue()
+{
+    for (;;)
+    {
+        plAGCompiledGraph *graph;
+        {
+            hsTempMutexLock lock(sQueueLock);
+            if (sQueueNext >= sQueueCount)
+                return;
+            graph = sQueue[sQueueNext++];
+        }
+        graph->Evaluate(false);
+    }
+}
+
+class plAGGraphThread : public hsThread
+{
+public:
+    hsEvent fStartEvent;
+    hsEvent fDoneEvent;
+
+    virtual hsError Run()
+    {
+        for (;;)
+        {
+            fStartEvent.Wait();
+            if (GetQuit())
+                break;
+            EvaluateQueue();
+            fDoneEvent.Signal();
+        }
+        return hsOK;
+    }
+
+    virtual void Stop()
+    {
+        SetQuit(true);
+        fStartEvent.Signal();
+        hsThread::Stop();
+    }
+};
+
+int plAGCompiledGraph::fNumThreads = 2;
+
+static hsTArray<plAGGraphThread*> sGraphThreads;
+static hsMutex sGraphThreadLock;    // One batch at a time
+
+void plAGCompiledGraph::SetNumThreads(int n)
+{
+    hsTempMutexLock lock(sGraphThreadLock);
+    IStopThreads();
+    fNumThreads = n < 0 ? 0 : (n > kMaxThreads ? kMaxThreads : n);
+}
+
+// Caller holds sGraphThreadLock
+void plAGCompiledGraph::IStartThreads()
+{
+    int i;
+    for (i = sGraphThreads.GetCount(); i < fNumThreads; i++)
+    {
+        plAGGraphThread *thread = new plAGGraphThread;
+        thread->Start();
+        sGraphThreads.Append(thread);
+    }
+}
+
+void plAGCompiledGraph::IStopThreads()
+{
+    hsTempMutexLock lock(sGraphThreadLock);
+    int i;
+    for (i = 0; i < sGraphThreads.GetCount(); i++)
+    {
+        sGraphThreads[i]->Stop();
+        delete sGraphThreads[i];
+    }
+    sGraphThreads.Reset();
+}
+
+// EVALUATEBATCH
+void plAGCompiledGraph::EvaluateBatch(plAGCompiledGraph **graphs, int count)
+{
+    int i;
+    if (!fNumThreads || count < 2)
+    {
+        for (i = 0; i < count; i++)
+            graphs[i]->Evaluate();
+        return;
+    }
+
+    hsTempMutexLock lock(sGraphThreadLock);
+    IStartThreads();
+
+    sQueue = graphs;
+    sQueueCount = count;
+    sQueueNext = 0;
+
+    int numHelpers = hsMinimum((int)sGraphThreads.GetCount(), count - 1);
+    for (i = 0; i < numHelpers; i++)
+        sGraphThreads[i]->fStartEvent.Signal();
+
+    EvaluateQueue();
+
+    for (i = 0; i < numHelpers; i++)
+        sGraphThreads[i]->fDoneEvent.Wait();
+
+    sQueue = nil;
+    sQueueCount = 0;
+}
@@ -0,0 +1,206 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+/** \file plAGCompiledGraph.h
+    \brief Flattened evaluation of a plAGMasterMod's transform channels
+
+    \ingroup Avatar
+    \ingroup AniGraph
+*/
+#ifndef PLAGCOMPILEDGRAPH_INC
+#define PLAGCOMPILEDGRAPH_INC
+
+#include "HeadSpin.h"
+#include <map>
+#include <vector>
+
+#include "plTransform/hsAffineParts.h"
+
+class plAGModifier;
+class plControllerCacheInfo;
+class plMatrixChannel;
+class plMatrixChannelApplicator;
+class plScalarChannel;
+
+/** \class plAGCompiledGraph
+    The transform channels of every bone of a master modifier, flattened into
+    one linear program. Evaluating the virtual plAGChannel tree walks the same
+    blend and time scale nodes for each bone and asks each animation's time
+    source and blend bias for its value once per bone; here those scalars are
+    evaluated once per frame into registers, and each bone is a straight run
+    of controller, skip and blend ops writing into a contiguous pose buffer.
+
+    The program only depends on the shape of the graph, not on blend weights,
+    so it is rebuilt when animations attach or detach. A weight of exactly 0
+    or 1 skips the dead branch just like plMatrixBlend::AffineValue does.
+
+    Modifiers that aren't a lone plMatrixChannelApplicator are left for the
+    caller to Apply the old way; see GetNumFallbacks.
+
+    Applying is three steps. Prepare and Commit touch the scene and have to
+    run on the main thread; Evaluate in between only touches this graph's
+    own channels and poses, so the graphs of different masters can be
+    evaluated side by side. See EvaluateBatch. */
+class plAGCompiledGraph
+{
+public:
+    plAGCompiledGraph();
+
+    /** Flatten the transform graphs of the given modifiers. Anything we
+        can't flatten is remembered and applied through plAGModifier::Apply. */
+    void Build(const std::vector<plAGModifier*> &mods);
+    void Reset();
+
+    /** Evaluate every bone at the given world time and apply the results.
+        Same as Prepare, Evaluate and Commit in a row. */
+    void Apply(double time);
+
+    /** Sample the time sources and blend weights, check each bone's
+        modifier and ask any leaf channels for their values. Bones whose
+        applicators changed underneath us are applied the old way here. */
+    void Prepare(double time);
+
+    /** Run the controller and blend ops of a prepared graph. Pass false
+        when calling from another thread; the profile timers aren't safe
+        to touch from there. */
+    void Evaluate(bool timed = true);
+
+    /** Compose each bone's result into its transform, then apply the
+        fallbacks. */
+    void Commit();
+
+    /** Evaluate prepared graphs on the graph threads, with the calling
+        thread taking its share. Returns when all of them are done. */
+    static void EvaluateBatch(plAGCompiledGraph **graphs, int count);
+
+    enum
+    {
+        kMaxThreads = 7     // Extra threads, not counting the caller
+    };
+
+    /** Extra threads to evaluate batches on, 0 for none. Changing it (or
+        Shutdown) stops the current threads; new ones start on next use. */
+    static void SetNumThreads(int n);
+    static int GetNumThreads() { return fNumThreads; }
+    static void Shutdown() { IStopThreads(); }
+
+    /** True if a modifier's applicators changed underneath us since Build.
+        Those bones were applied the old way; the caller should rebuild. */
+    bool IsStale() const { return fStale; }
+
+    uint32_t GetNumBones() const { return fNumBones; }
+    uint32_t GetNumFallbacks() const { return fFallbacks.size(); }
+    uint32_t GetNumOps() const { return fOps.size(); }
+    uint32_t GetNumBlends() const { return fPoses.size(); }
+    uint32_t GetNumScalars() const { return fTimeOps.size() + fWeightOps.size(); }
+
+protected:
+    enum OpCode
+    {
+        kOpBeginBone,   // skip the bone if its modifier or applicator is off
+        kOpController,  // controller interp into the channel's own parts
+        kOpChannel,     // any other channel, evaluated as a leaf
+        kOpSkipIfOne,   // weight == 1: the A side of a blend is dead
+        kOpSkipIfZero,  // weight == 0: the B side of a blend is dead
+        kOpBlend,       // blend two results by a weight register
+        kOpApply,       // compose a result into the bone's transform
+    };
+
+    struct Op
+    {
+        uint8_t     fCode;
+        uint16_t    fTime;      // time register the op is evaluated at
+        uint16_t    fWeight;    // weight register for skips and blends
+        uint32_t    fResult;    // result slot written by this op
+        uint32_t    fA;         // blend inputs, the bone's root result for kOpApply,
+                                // or the bone's index for kOpBeginBone
+        uint32_t    fB;
+        uint32_t    fSkip;      // ops to jump over
+        uint32_t    fPose;      // pose buffer slot for blends
+
+        plMatrixChannel             *fChannel;
+        plControllerCacheInfo       *fCache;
+        plAGModifier                *fMod;
+        plMatrixChannelApplicator   *fApp;
+
+        Op(uint8_t code);
+    };
+
+    struct ScalarOp
+    {
+        plScalarChannel *fChannel;
+        uint16_t        fIn;    // time register the channel is sampled at
+        uint16_t        fOut;
+    };
+
+    typedef std::pair<plScalarChannel*, uint16_t> ScalarKey;
+    typedef std::map<ScalarKey, uint16_t> ScalarRegMap;
+
+    std::vector<Op>                     fOps;
+    std::vector<ScalarOp>               fTimeOps;
+    std::vector<ScalarOp>               fWeightOps;
+    std::vector<double>                 fTimes;
+    std::vector<float>                  fWeights;
+    std::vector<hsAffineParts>          fPoses;
+    std::vector<const hsAffineParts*>   fResults;
+    std::vector<plAGModifier*>          fFallbacks;
+    std::vector<uint8_t>                fLive;      // per bone, set by Prepare
+
+    uint32_t    fNumBones;
+    bool        fStale;
+
+    static int  fNumThreads;
+
+    static void IStartThreads();
+    static void IStopThreads();
+
+    // Build helpers; only valid during Build.
+    ScalarRegMap fTimeRegs;
+    ScalarRegMap fWeightRegs;
+
+    bool ICanCompile(plAGModifier *mod) const;
+    uint32_t IFlatten(plMatrixChannel *chan, uint16_t time);
+    uint32_t IAddOp(const Op &op);
+    uint16_t ITimeReg(plScalarChannel *source, uint16_t time);
+    uint16_t IWeightReg(plScalarChannel *bias, uint16_t time);
+};
+
+#endif // PLAGCOMPILEDGRAPH_INC
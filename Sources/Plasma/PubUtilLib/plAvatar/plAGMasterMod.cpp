@@ -48,6 +48,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plAGModifier.h"
 // #include "plAvatarAnim.h"
 #include "plAGMasterSDLModifier.h"
+#include "plAGCompiledGraph.h"
 #include "plMatrixChannel.h"
 
 // global
@@ -75,15 +76,25 @@ plAGMasterMod::plAGMasterMod()
   fFirstEval(true),
   fAGMasterSDLMod(nil),
   fNeedCompile(false),
+  fCompiledGraph(nil),
+  fNeedBuildGraph(true),
+  fInBatch(false),
   fIsGrouped(false),
   fIsGroupMaster(false),
   fMsgForwarder(nil)
 {
 }
 
+bool plAGMasterMod::fUseCompiledGraph = true;
+
+static std::vector<plAGMasterMod*> sGraphBatch;
+static bool sGraphBatching = false;
+
 // DTOR
 plAGMasterMod::~plAGMasterMod()
 {
+    IRemoveFromBatch();
+    delete fCompiledGraph;
 }
 
 void plAGMasterMod::Write(hsStream *stream, hsResMgr *mgr)
@@ -190,6 +201,7 @@ void plAGMasterMod::AddTarget(plSceneObject * object)
 
 void plAGMasterMod::RemoveTarget(plSceneObject* o)
 {
+    IFinishBatched();
     hsAssert(o == fTarget, "Removing target I don't have");
 
     DetachAllAnimations();
@@ -216,6 +228,7 @@ plProfile_CreateTimer("  AffineCompose", "Animation", AffineCompose);
 plProfile_CreateTimer("  AffineApplicator", "Animation", MatrixApplicator);
 plProfile_CreateTimer("AnimatingPhysicals", "Animation", AnimatingPhysicals);
 plProfile_CreateTimer("StoppedAnimPhysicals", "Animation", StoppedAnimPhysicals);
+plProfile_CreateTimer("GraphBatch", "Animation", GraphBatch);
 
 // IEVAL
 bool plAGMasterMod::IEval(double secs, float del, uint32_t dirty)
@@ -249,15 +262,42 @@ void plAGMasterMod::ApplyAnimations(double time, float elapsed)
         fAnimInstances[i]->ProcessFade(elapsed);
     }
     
-    AdvanceAnimsToTime(time);
+    IAdvanceAnimsToTime(time, sGraphBatching);
 
     plProfile_EndLap(ApplyAnimation,this->GetKey()->GetUoid().GetObjectName().c_str());
 }
 
 void plAGMasterMod::AdvanceAnimsToTime(double time)
 {
+    IAdvanceAnimsToTime(time, false);
+}
+
+void plAGMasterMod::IAdvanceAnimsToTime(double time, bool batch)
+{
+    // Already applied once this frame (a task stepping us, say); finish
+    // that before the graph gets compiled or evaluated again.
+    IFinishBatched();
+
     if(fNeedCompile)
         Compile(time);
+
+    if(fUseCompiledGraph)
+    {
+        if(fNeedBuildGraph)
+            IBuildCompiledGraph();
+
+        fCompiledGraph->Prepare(time);
+        if(batch && plAGCompiledGraph::GetNumThreads() > 0)
+        {
+            sGraphBatch.push_back(this);
+            fInBatch = true;
+            return;
+        }
+
+        fCompiledGraph->Evaluate();
+        ICommitGraph();
+        return;
+    }
     
     for(plChannelModMap::iterator j = fChannelMods.begin(); j != fChannelMods.end(); j++)
     {
@@ -266,6 +306,84 @@ void plAGMasterMod::AdvanceAnimsToTime(double time)
     }
 }
 
+void plAGMasterMod::ICommitGraph()
+{
+    fCompiledGraph->Commit();
+
+    // somebody rearranged a modifier's applicators behind our back
+    if(fCompiledGraph->IsStale())
+        fNeedBuildGraph = true;
+}
+
+// IFINISHBATCHED
+// Anything that changes our channels or modifiers has to call this first,
+// or the batch would evaluate channels that are no longer there.
+void plAGMasterMod::IFinishBatched()
+{
+    if(IRemoveFromBatch())
+    {
+        fCompiledGraph->Evaluate();
+        ICommitGraph();
+    }
+}
+
+bool plAGMasterMod::IRemoveFromBatch()
+{
+    if(!fInBatch)
+        return false;
+
+    fInBatch = false;
+    std::vector<plAGMasterMod*>::iterator it = std::find(sGraphBatch.begin(), sGraphBatch.end(), this);
+    if(it != sGraphBatch.end())
+        sGraphBatch.erase(it);
+    return true;
+}
+
+void plAGMasterMod::BeginGraphBatch()
+{
+    sGraphBatching = true;
+}
+
+void plAGMasterMod::EndGraphBatch()
+{
+    sGraphBatching = false;
+    if(sGraphBatch.empty())
+        return;
+
+    plProfile_BeginTiming(GraphBatch);
+
+    std::vector<plAGMasterMod*> batch;
+    batch.swap(sGraphBatch);
+
+    std::vector<plAGCompiledGraph*> graphs(batch.size());
+    int i;
+    for(i = 0; i < batch.size(); i++)
+        graphs[i] = batch[i]->fCompiledGraph;
+    plAGCompiledGraph::EvaluateBatch(&graphs[0], graphs.size());
+
+    // Commit in the order the masters were evaluated in.
+    for(i = 0; i < batch.size(); i++)
+    {
+        batch[i]->fInBatch = false;
+        batch[i]->ICommitGraph();
+    }
+
+    plProfile_EndTiming(GraphBatch);
+}
+
+void plAGMasterMod::IBuildCompiledGraph()
+{
+    std::vector<plAGModifier*> mods;
+    mods.reserve(fChannelMods.size());
+    for(plChannelModMap::iterator j = fChannelMods.begin(); j != fChannelMods.end(); j++)
+        mods.push_back((*j).second);
+
+    if(!fCompiledGraph)
+        fCompiledGraph = new plAGCompiledGraph;
+    fCompiledGraph->Build(mods);
+    fNeedBuildGraph = false;
+}
+
 void plAGMasterMod::SetNeedCompile(bool needCompile)
 {
     fNeedCompile = true;
@@ -295,6 +413,7 @@ void plAGMasterMod::Compile(double time)
 
 void plAGMasterMod::DumpAniGraph(const char *justThisChannel, bool optimized, double time)
 {
+    IFinishBatched();
     plChannelModMap::iterator end = fChannelMods.end();
     fNeedCompile = false;
 
@@ -395,7 +514,9 @@ plAGAnimInstance * plAGMasterMod::AttachAnimationBlended(plAGAnim *anim,
     plAnimVector::iterator i;
     if(anim)
     {
+        IFinishBatched();
         fNeedCompile = true;    // need to recompile the graph since we're editing it...
+        fNeedBuildGraph = true;
         for (i = fPrivateAnims.begin(); i != fPrivateAnims.end(); i++) 
         {
             if (*i == anim)
@@ -548,7 +669,9 @@ void plAGMasterMod::DetachAnimation(plAGAnimInstance *anim)
     plInstanceVector::iterator i;
     plAnimVector::iterator j;
     
+    IFinishBatched();
     fNeedCompile = true;    // need to recompile the graph since we're editing it...
+    fNeedBuildGraph = true;
 
     for ( i = fAnimInstances.begin(); i != fAnimInstances.end(); i++)
     {
@@ -736,10 +859,19 @@ bool plAGMasterMod::MsgReceive(plMessage* msg)
         plAGModifier *agmod;
         if (agmod = plAGModifier::ConvertNoRef(genRefMsg->GetRef()))
         {
+            // A modifier going away may already be half destroyed, so
+            // don't apply to it; this frame's pose is dropped instead.
             if (genRefMsg->GetContext() & (plRefMsg::kOnCreate|plRefMsg::kOnRequest))
+            {
+                IFinishBatched();
                 fChannelMods[agmod->GetChannelName()] = agmod;
+            }
             else
+            {
+                IRemoveFromBatch();
                 fChannelMods.erase(agmod->GetChannelName());
+            }
+            fNeedBuildGraph = true;
 
             return true;
         }
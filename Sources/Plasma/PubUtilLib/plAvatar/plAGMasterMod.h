@@ -68,6 +68,7 @@ class plAGAnimInstance;
 class plAGAnim;
 class plATCAnim;
 class plAGMasterSDLModifier;
+class plAGCompiledGraph;
 
 ////////////////
 //
@@ -198,6 +199,19 @@ public:
     void SetIsGrouped(bool grouped);
     void SetIsGroupMaster(bool master, plMsgForwarder* msgForwarder);
 
+    /** Evaluate transform channels through a flattened plAGCompiledGraph
+        instead of walking each modifier's channel tree. On by default. */
+    static bool fUseCompiledGraph;
+    const plAGCompiledGraph *GetCompiledGraph() const { return fCompiledGraph; }
+
+    /** While a graph batch is open, ApplyAnimations only prepares the
+        compiled graph and queues it. EndGraphBatch evaluates everything
+        queued on the graph threads, then commits the results to the
+        bones on this thread. plClient opens one around the plEvalMsg so
+        every avatar's graph is evaluated at once. */
+    static void BeginGraphBatch();
+    static void EndGraphBatch();
+
     // PLASMA PROTOCOL
     virtual int GetNumTargets() const { return fTarget ? 1 : 0; }
     virtual plSceneObject* GetTarget(int w) const { /* hsAssert(w < GetNumTargets(), "Bad target"); */ return fTarget; }
@@ -224,6 +238,12 @@ protected:
     
     virtual void IApplyDynamic() {};    // dummy function required by base class
 
+    void IBuildCompiledGraph();
+    void IAdvanceAnimsToTime(double time, bool batch);
+    void ICommitGraph();
+    void IFinishBatched();
+    bool IRemoveFromBatch();
+
     // Find markers in an anim for environment effects (footsteps)
     virtual void ISetupMarkerCallbacks(plATCAnim *anim, plAnimTimeConvert *atc) {}
 
@@ -254,6 +274,11 @@ protected:
 
     bool fNeedCompile;
 
+    // flattened transform graph, rebuilt when channels attach or detach
+    plAGCompiledGraph *fCompiledGraph;
+    bool fNeedBuildGraph;
+    bool fInBatch;      // prepared and waiting on EndGraphBatch
+
     bool fIsGrouped;
     bool fIsGroupMaster;
     plMsgForwarder* fMsgForwarder;
@@ -126,6 +126,9 @@ public:
     plAGChannel * GetChannel(int i) { return fApps[i]->GetChannel(); }
 
     void Enable(bool val);
+    bool IsEnabled() const { return fEnabled; }
+
+    int GetNumApplicators() const { return fApps.size(); }
 
     // PERSISTENCE
     virtual void Read(hsStream *stream, hsResMgr *mgr);
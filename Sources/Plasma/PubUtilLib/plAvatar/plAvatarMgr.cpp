@@ -51,6 +51,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plOneShotMod.h"
 #include "plArmatureMod.h"
 #include "plAGModifier.h"
+#include "plAGCompiledGraph.h"
 #include "plAnimStage.h"
 #include "plCoopCoordinator.h"
 #include "plAvBrainCoop.h"
@@ -120,6 +121,8 @@ plAvatarMgr * plAvatarMgr::GetInstance()
 // SHUTDOWN
 void plAvatarMgr::ShutDown()
 {
+    plAGCompiledGraph::Shutdown();
+
     if(fInstance)
     {
         fInstance->UnRef();
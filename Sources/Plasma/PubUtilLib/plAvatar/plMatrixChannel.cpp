@@ -736,28 +736,32 @@ void plMatrixChannelApplicator::IApply(const plAGModifier *mod, double time)
 
         if(matChan)
         {
-            hsMatrix44 inverse;
-
             plProfile_BeginTiming(AffineValue);
             const hsAffineParts &ap = matChan->AffineValue(time);
             plProfile_EndTiming(AffineValue);
-            
-            hsMatrix44 result;
-
-            plProfile_BeginTiming(AffineCompose);
-            ap.ComposeMatrix(&result);
-            ap.ComposeInverseMatrix(&inverse);
-            //result.GetInverse(&inverse);
-            plProfile_EndTiming(AffineCompose);
 
-            plProfile_BeginTiming(MatrixApplicator);
-            plCoordinateInterface *CI = IGetCI(mod);
-            CI->SetLocalToParent(result, inverse);
-            plProfile_EndTiming(MatrixApplicator);  
+            ApplyAffineParts(mod, ap);
         }
     }
 }
 
+void plMatrixChannelApplicator::ApplyAffineParts(const plAGModifier *mod, const hsAffineParts &ap)
+{
+    hsMatrix44 result;
+    hsMatrix44 inverse;
+
+    plProfile_BeginTiming(AffineCompose);
+    ap.ComposeMatrix(&result);
+    ap.ComposeInverseMatrix(&inverse);
+    //result.GetInverse(&inverse);
+    plProfile_EndTiming(AffineCompose);
+
+    plProfile_BeginTiming(MatrixApplicator);
+    plCoordinateInterface *CI = IGetCI(mod);
+    CI->SetLocalToParent(result, inverse);
+    plProfile_EndTiming(MatrixApplicator);  
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////
 //
 // plMatrixDelayedCorrectionApplicator
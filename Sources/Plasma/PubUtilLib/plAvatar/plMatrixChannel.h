@@ -132,6 +132,8 @@ protected:
     plScalarChannel *fTimeSource;
     plMatrixChannel *fChannelIn;
 
+    friend class plAGCompiledGraph;
+
 public:
     plMatrixTimeScale();
     plMatrixTimeScale(plMatrixChannel *channel, plScalarChannel *timeSource);
@@ -164,6 +166,8 @@ protected:
     plScalarChannel * fChannelBias;
     int fPriority;
 
+    friend class plAGCompiledGraph;
+
 public:
     // xTORs
     plMatrixBlend();
@@ -214,6 +218,8 @@ class plMatrixControllerChannel : public plMatrixChannel
 protected:
     plController    *fController;
 
+    friend class plAGCompiledGraph;
+
 public:
     // xTORs
     plMatrixControllerChannel();
@@ -249,6 +255,8 @@ class plMatrixControllerCacheChannel : public plMatrixChannel
 protected:
     plControllerCacheInfo *fCache;
     plMatrixControllerChannel *fControllerChannel;
+
+    friend class plAGCompiledGraph;
     
 public:
     plMatrixControllerCacheChannel();
@@ -316,6 +324,11 @@ public:
     CLASSNAME_REGISTER( plMatrixChannelApplicator );
     GETINTERFACE_ANY( plMatrixChannelApplicator, plAGApplicator );
 
+    /** Compose the given parts into our target's local-to-parent transform.
+        This is the tail end of IApply, split out so plAGCompiledGraph can
+        feed it parts it evaluated itself. */
+    void ApplyAffineParts(const plAGModifier *mod, const hsAffineParts &ap);
+
     virtual bool CanCombine(plAGApplicator *app) { return false; }
     virtual plAGPinType GetPinType() { return kAGPinTransform; }
 };
@@ -43,12 +43,419 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "zlib.h"
 #include "hsMemory.h"
 #include "hsStream.h"
+#include "hsThread.h"
+#include "hsTemplates.h"
+
+//// Context Pool ////////////////////////////////////////////////////////////
+//  A deflate context is a couple hundred KB of zlib state. Rather than set
+//  one up and tear it down for every message, finished contexts are reset
+//  and parked on a free list for the next caller, whichever thread it's on.
+
+class plZlibContextPool
+{
+protected:
+    enum
+    {
+        kMaxFree        = 4,            // Per type, extras are deleted on release
+        kMaxFreeBuffer  = 1024 * 1024   // Scratch bigger than this isn't kept around
+    };
+
+    hsMutex                 fLock;
+    hsTArray<plZlibContext*> fFree[ plZlibContext::kNumTypes ];
+
+public:
+    ~plZlibContextPool();
+
+    plZlibContext*  Acquire(plZlibContext::Type type);
+    void            Release(plZlibContext* ctx);
+};
+
+static plZlibContextPool    gContextPool;
+
+plZlibContextPool::~plZlibContextPool()
+{
+    int i, j;
+    for (i = 0; i < plZlibContext::kNumTypes; i++)
+    {
+        for (j = 0; j < fFree[i].GetCount(); j++)
+            delete fFree[i][j];
+        fFree[i].Reset();
+    }
+}
+
+plZlibContext* plZlibContextPool::Acquire(plZlibContext::Type type)
+{
+    plZlibContext* ctx = nil;
+
+    fLock.Lock();
+    if (fFree[type].GetCount() > 0)
+        ctx = fFree[type].Pop();
+    fLock.Unlock();
+
+    if (!ctx)
+        ctx = new plZlibContext(type);
+    return ctx;
+}
+
+void plZlibContextPool::Release(plZlibContext* ctx)
+{
+    z_streamp zstream = (z_streamp)ctx->fStream;
+    if (ctx->fInitOk)
+    {
+        if (ctx->fType == plZlibContext::kInflate || ctx->fType == plZlibContext::kInflateRaw)
+            ctx->fInitOk = (inflateReset(zstream) == Z_OK);
+        else
+            ctx->fInitOk = (deflateReset(zstream) == Z_OK);
+    }
+    if (ctx->fBuffer.size() > kMaxFreeBuffer)
+        std::vector<uint8_t>().swap(ctx->fBuffer);
+
+    if (ctx->fInitOk)
+    {
+        fLock.Lock();
+        if (fFree[ctx->fType].GetCount() < kMaxFree)
+        {
+            fFree[ctx->fType].Push(ctx);
+            ctx = nil;
+        }
+        fLock.Unlock();
+    }
+    delete ctx;
+}
+
+plZlibContext::plZlibContext(Type type) : fType(type)
+{
+    z_streamp zstream = new z_stream_s;
+    memset(zstream, 0, sizeof(z_stream_s));
+    fStream = zstream;
+
+    // Negative window bits leave off the zlib header and trailer
+    switch (type)
+    {
+    case kDeflate:
+        fInitOk = (deflateInit(zstream, Z_DEFAULT_COMPRESSION) == Z_OK);
+        break;
+    case kDeflateRaw:
+        fInitOk = (deflateInit2(zstream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK);
+        break;
+    case kInflate:
+        fInitOk = (inflateInit(zstream) == Z_OK);
+        break;
+    case kInflateRaw:
+        fInitOk = (inflateInit2(zstream, -MAX_WBITS) == Z_OK);
+        break;
+    default:
+        fInitOk = false;
+        break;
+    }
+    hsAssert(fInitOk, "plZlibContext: zlib init failed");
+}
+
+plZlibContext::~plZlibContext()
+{
+    z_streamp zstream = (z_streamp)fStream;
+    if (fInitOk)
+    {
+        if (fType == kInflate || fType == kInflateRaw)
+            inflateEnd(zstream);
+        else
+            deflateEnd(zstream);
+    }
+    delete zstream;
+}
+
+plZlibContext* plZlibContext::Acquire(Type type)
+{
+    return gContextPool.Acquire(type);
+}
+
+void plZlibContext::Release(plZlibContext* ctx)
+{
+    gContextPool.Release(ctx);
+}
+
+//// Block Compression ///////////////////////////////////////////////////////
+//  Each block is deflated on its own, primed with the 32k of input before it
+//  so it loses next to nothing against one big deflate. All but the last end
+//  on a sync flush, which leaves them byte aligned and not final, so they can
+//  be laid end to end behind one zlib header. The adler32s of the blocks are
+//  combined for the trailer.
+
+struct plZlibBlock
+{
+    uint32_t    fOutLen;
+    uLong       fAdler;
+    bool        fOk;
+};
+
+class plZlibBlockJob
+{
+public:
+    const uint8_t*  fIn;
+    uint32_t        fInLen;
+    uint8_t*        fOut;
+    uint32_t        fRegionSize;    // Room for one full block's output
+    uint32_t        fNumBlocks;
+    plZlibBlock*    fBlocks;
+
+    uint32_t        fNextBlock;     // Guarded by the thread pool's lock
+    uint32_t        fPending;       // Ditto
+    hsEvent         fDone;
+
+    uint32_t        IBlockStart(uint32_t i) const { return i * plZlibCompress::kBlockSize; }
+    uint8_t*        IRegion(uint32_t i) const { return fOut + 2 + i * fRegionSize; }
+
+    void            CompressBlock(uint32_t i);
+};
+
+// deflateBound for a bare stream, plus the sync flush marker and a little slack
+static uint32_t IBlockBound(uint32_t len)
+{
+    return len + (len >> 12) + (len >> 14) + (len >> 25) + 13 + 5 + 8;
+}
+
+void plZlibBlockJob::CompressBlock(uint32_t i)
+{
+    uint32_t start = IBlockStart(i);
+    uint32_t len = hsMinimum(fInLen - start, (uint32_t)plZlibCompress::kBlockSize);
+    bool last = (i == fNumBlocks - 1);
+    plZlibBlock& block = fBlocks[i];
+
+    plZlibContext* ctx = plZlibContext::Acquire(plZlibContext::kDeflateRaw);
+    z_streamp zstream = (z_streamp)ctx->fStream;
+
+    block.fOk = ctx->fInitOk;
+    if (block.fOk && start > 0)
+    {
+        uint32_t dictLen = hsMinimum(start, (uint32_t)(1 << MAX_WBITS));
+        block.fOk = (deflateSetDictionary(zstream, fIn + start - dictLen, dictLen) == Z_OK);
+    }
+    if (block.fOk)
+    {
+        zstream->next_in = (Bytef*)(fIn + start);
+        zstream->avail_in = len;
+        zstream->next_out = IRegion(i);
+        zstream->avail_out = last ? IBlockBound(len) : fRegionSize;
+
+        // A sync flush that fills the output exactly may not be done yet
+        int ret = deflate(zstream, last ? Z_FINISH : Z_SYNC_FLUSH);
+        if (last)
+            block.fOk = (ret == Z_STREAM_END);
+        else
+            block.fOk = (ret == Z_OK && zstream->avail_in == 0 && zstream->avail_out != 0);
+        block.fOutLen = zstream->total_out;
+    }
+    block.fAdler = adler32(adler32(0, nil, 0), fIn + start, len);
+
+    plZlibContext::Release(ctx);
+}
+
+class plZlibBlockThread;
+
+class plZlibBlockThreads
+{
+protected:
+    enum
+    {
+        kIdleWait = 100     // ms, so quitting threads never wait long for a wakeup
+    };
+
+    hsMutex                     fLock;
+    hsMutex                     fThreadLock;    // Guards starting and stopping threads
+    hsEvent                     fWork;
+    hsTArray<plZlibBlockThread*> fThreads;
+    hsTArray<plZlibBlockJob*>   fJobs;      // Jobs with blocks left to hand out
+
+    bool    ITakeBlock(plZlibBlockJob** job, uint32_t* idx);
+    void    IFinishBlock(plZlibBlockJob* job);
+
+public:
+    ~plZlibBlockThreads() { SetNumThreads(0); }
+
+    void    SetNumThreads(int num);
+    int     GetNumThreads() const { return fThreads.GetCount(); }
+
+    // Compresses every block of the job, with help from the threads
+    void    Run(plZlibBlockJob* job);
+
+    // Thread side, returns false when the thread should quit
+    bool    WorkOne(plZlibBlockThread* thread);
+};
+
+class plZlibBlockThread : public hsThread
+{
+protected:
+    plZlibBlockThreads* fOwner;
+
+public:
+    plZlibBlockThread(plZlibBlockThreads* owner) : fOwner(owner) {}
+
+    bool    IsQuitting() const { return GetQuit(); }
+    void    Quit() { SetQuit(true); }
+
+    virtual hsError Run()
+    {
+        while (fOwner->WorkOne(this))
+            ;
+        return hsOK;
+    }
+};
+
+static plZlibBlockThreads   gBlockThreads;
+
+void plZlibBlockThreads::SetNumThreads(int num)
+{
+    hsTempMutexLock lock(fThreadLock);
+
+    int i;
+    if (num == fThreads.GetCount())
+        return;
+
+    for (i = 0; i < fThreads.GetCount(); i++)
+        fThreads[i]->Quit();
+    fWork.Signal();
+    for (i = 0; i < fThreads.GetCount(); i++)
+    {
+        fThreads[i]->Stop();
+        delete fThreads[i];
+    }
+    fThreads.Reset();
+
+    for (i = 0; i < num; i++)
+    {
+        plZlibBlockThread* thread = new plZlibBlockThread(this);
+        fThreads.Append(thread);
+        thread->Start();
+    }
+}
+
+// Pass in a nil job to take a block from whichever job is first in line.
+// Taking the job and the block under one lock keeps us from touching a job
+// whose owner has already gone home.
+bool plZlibBlockThreads::ITakeBlock(plZlibBlockJob** job, uint32_t* idx)
+{
+    hsTempMutexLock lock(fLock);
+    if (*job == nil)
+    {
+        if (fJobs.GetCount() == 0)
+            return false;
+        *job = fJobs[0];
+    }
+    if ((*job)->fNextBlock >= (*job)->fNumBlocks)
+        return false;
+
+    *idx = (*job)->fNextBlock++;
+    if ((*job)->fNextBlock == (*job)->fNumBlocks)
+        fJobs.RemoveItem(*job);
+    return true;
+}
+
+void plZlibBlockThreads::IFinishBlock(plZlibBlockJob* job)
+{
+    // Signal with the lock held, so the owner can't return and take the
+    // event with it while we're still inside Signal
+    hsTempMutexLock lock(fLock);
+    if (--job->fPending == 0)
+        job->fDone.Signal();
+}
+
+void plZlibBlockThreads::Run(plZlibBlockJob* job)
+{
+    job->fNextBlock = 0;
+    job->fPending = job->fNumBlocks;
+
+    fLock.Lock();
+    fJobs.Append(job);
+    fLock.Unlock();
+
+    // Wakes every idle thread, they'll go back to sleep if there's nothing left for them
+    fWork.Signal();
+
+    // Pitch in rather than sit idle
+    uint32_t idx;
+    while (ITakeBlock(&job, &idx))
+    {
+        job->CompressBlock(idx);
+
+        fLock.Lock();
+        --job->fPending;
+        fLock.Unlock();
+    }
+
+    // Wakeups can be spurious, so keep checking. Looking at fPending under
+    // the lock also lets the signalling thread get out of IFinishBlock.
+    fLock.Lock();
+    while (job->fPending != 0)
+    {
+        fLock.Unlock();
+        job->fDone.Wait();
+        fLock.Lock();
+    }
+    fLock.Unlock();
+}
+
+bool plZlibBlockThreads::WorkOne(plZlibBlockThread* thread)
+{
+    // Grab blocks from whatever jobs are up until there are none left
+    plZlibBlockJob* job = nil;
+    uint32_t idx;
+    while (ITakeBlock(&job, &idx))
+    {
+        job->CompressBlock(idx);
+        IFinishBlock(job);
+        job = nil;
+    }
+
+    if (thread->IsQuitting())
+        return false;
+    fWork.Wait(kIdleWait);
+    return !thread->IsQuitting();
+}
+
+//// plZlibCompress //////////////////////////////////////////////////////////
+
+int plZlibCompress::fNumBlockThreads = plZlibCompress::kDefaultBlockThreads;
+
+void plZlibCompress::SetNumBlockThreads(int num)
+{
+    fNumBlockThreads = hsMaximum(num, 0);
+    gBlockThreads.SetNumThreads(fNumBlockThreads);
+}
+
+bool plZlibCompress::IDeflate(plZlibContext* ctx, uint8_t* bufOut, uint32_t* bufLenOut, const uint8_t* bufIn, uint32_t bufLenIn)
+{
+    if (!ctx->fInitOk)
+        return false;
+
+    z_streamp zstream = (z_streamp)ctx->fStream;
+    zstream->next_in = (Bytef*)bufIn;
+    zstream->avail_in = bufLenIn;
+    zstream->next_out = bufOut;
+    zstream->avail_out = *bufLenOut;
+
+    bool result = (deflate(zstream, Z_FINISH) == Z_STREAM_END);
+    *bufLenOut = zstream->total_out;
+    return result;
+}
 
 bool plZlibCompress::Uncompress(uint8_t* bufOut, uint32_t* bufLenOut, const uint8_t* bufIn, uint32_t bufLenIn)
 {
-    unsigned long buflen_out = *bufLenOut;
-    bool result = (uncompress(bufOut, &buflen_out, bufIn, bufLenIn) == Z_OK);
-    *bufLenOut = buflen_out;
+    plZlibContext* ctx = plZlibContext::Acquire(plZlibContext::kInflate);
+    z_streamp zstream = (z_streamp)ctx->fStream;
+
+    bool result = false;
+    if (ctx->fInitOk)
+    {
+        zstream->next_in = (Bytef*)bufIn;
+        zstream->avail_in = bufLenIn;
+        zstream->next_out = bufOut;
+        zstream->avail_out = *bufLenOut;
+
+        result = (inflate(zstream, Z_FINISH) == Z_STREAM_END);
+        *bufLenOut = zstream->total_out;
+    }
+
+    plZlibContext::Release(ctx);
     return result;
 }
 
@@ -56,31 +463,70 @@ bool plZlibCompress::Compress(uint8_t* bufOut, uint32_t* bufLenOut, const uint8_
 {
     // according to compress doc, the bufOut buffer should be at least .1% larger than source buffer, plus 12 bytes.
     hsAssert(*bufLenOut>=(int)(bufLenIn*1.1+12), "bufOut compress buffer is not large enough");
-    unsigned long buflen_out = *bufLenOut;
-    bool result = (compress(bufOut, &buflen_out, bufIn, bufLenIn) == Z_OK);
-    *bufLenOut = buflen_out;
+
+    if (bufLenIn >= kBlockThreshold && fNumBlockThreads > 0)
+        return CompressBlocks(bufOut, bufLenOut, bufIn, bufLenIn);
+
+    plZlibContext* ctx = plZlibContext::Acquire(plZlibContext::kDeflate);
+    bool result = IDeflate(ctx, bufOut, bufLenOut, bufIn, bufLenIn);
+    plZlibContext::Release(ctx);
     return result;
 }
 
-//
-// copy bufOut to bufIn, set bufLenIn=bufLenOut
-//
-bool plZlibCompress::ICopyBuffers(uint8_t** bufIn, uint32_t* bufLenIn, char* bufOut, uint32_t bufLenOut, int offset, bool ok)
+bool plZlibCompress::CompressBlocks(uint8_t* bufOut, uint32_t* bufLenOut, const uint8_t* bufIn, uint32_t bufLenIn)
 {
-    if (ok)
+    plZlibBlockJob job;
+    job.fIn = bufIn;
+    job.fInLen = bufLenIn;
+    job.fOut = bufOut;
+    job.fRegionSize = IBlockBound(kBlockSize);
+    job.fNumBlocks = (bufLenIn + kBlockSize - 1) / kBlockSize;
+
+    // Every block gets a worst case sized region, they're packed down afterwards
+    uint32_t lastLen = bufLenIn - (job.fNumBlocks - 1) * kBlockSize;
+    uint32_t needed = 2 + (job.fNumBlocks - 1) * job.fRegionSize + IBlockBound(lastLen) + 4;
+    if (job.fNumBlocks < 2 || *bufLenOut < needed)
     {
-        *bufLenIn = bufLenOut+offset;
-        uint8_t* newBuf = new uint8_t[*bufLenIn];           // alloc new buffer
-        HSMemory::BlockMove(*bufIn, newBuf, offset);    // copy offset (uncompressed) part
-        delete [] *bufIn;                               // delete original buffer
+        plZlibContext* ctx = plZlibContext::Acquire(plZlibContext::kDeflate);
+        bool result = IDeflate(ctx, bufOut, bufLenOut, bufIn, bufLenIn);
+        plZlibContext::Release(ctx);
+        return result;
+    }
 
-        HSMemory::BlockMove(bufOut, newBuf+offset, bufLenOut);  // copy compressed part
-        delete [] bufOut;
-        *bufIn = newBuf;
-        return true;
+    if (gBlockThreads.GetNumThreads() != fNumBlockThreads)
+        gBlockThreads.SetNumThreads(fNumBlockThreads);
+
+    std::vector<plZlibBlock> blocks(job.fNumBlocks);
+    job.fBlocks = &blocks[0];
+    gBlockThreads.Run(&job);
+
+    // Same header deflateInit writes for the default level
+    bufOut[0] = 0x78;
+    bufOut[1] = 0x9C;
+
+    uint32_t outLen = 2;
+    uLong adler = adler32(0, nil, 0);
+    uint32_t i;
+    for (i = 0; i < job.fNumBlocks; i++)
+    {
+        if (!blocks[i].fOk)
+            return false;
+
+        // Regions only ever move toward the front, so this never stomps a block we still need
+        memmove(bufOut + outLen, job.IRegion(i), blocks[i].fOutLen);
+        outLen += blocks[i].fOutLen;
+
+        uint32_t len = hsMinimum(bufLenIn - job.IBlockStart(i), (uint32_t)kBlockSize);
+        adler = adler32_combine(adler, blocks[i].fAdler, len);
     }
-    delete [] bufOut;
-    return false;
+
+    bufOut[outLen++] = (uint8_t)(adler >> 24);
+    bufOut[outLen++] = (uint8_t)(adler >> 16);
+    bufOut[outLen++] = (uint8_t)(adler >> 8);
+    bufOut[outLen++] = (uint8_t)adler;
+
+    *bufLenOut = outLen;
+    return true;
 }
 
 //
@@ -92,13 +538,34 @@ bool plZlibCompress::Compress(uint8_t** bufIn, uint32_t* bufLenIn, int offset)
     uint32_t adjBufLenIn = *bufLenIn - offset;
     uint8_t* adjBufIn = *bufIn + offset;
 
+    // Compress into the context's scratch, so the only allocation is the
+    // right sized result
+    plZlibContext* ctx = plZlibContext::Acquire(plZlibContext::kDeflate);
+
     // according to compress doc, the bufOut buffer should be at least .1% larger than source buffer, plus 12 bytes.
     uint32_t bufLenOut = (int)(adjBufLenIn*1.1+12);
-    char* bufOut = new char[bufLenOut];
-    
-    bool ok=(Compress((uint8_t*)bufOut, &bufLenOut, (uint8_t*)adjBufIn, adjBufLenIn) && 
-        bufLenOut < adjBufLenIn);
-    return ICopyBuffers(bufIn, bufLenIn, bufOut, bufLenOut, offset, ok);
+    if (ctx->fBuffer.size() < bufLenOut)
+        ctx->fBuffer.resize(bufLenOut);
+
+    bool ok;
+    if (adjBufLenIn >= kBlockThreshold && fNumBlockThreads > 0)
+        ok = CompressBlocks(&ctx->fBuffer[0], &bufLenOut, adjBufIn, adjBufLenIn);
+    else
+        ok = IDeflate(ctx, &ctx->fBuffer[0], &bufLenOut, adjBufIn, adjBufLenIn);
+    ok = ok && bufLenOut < adjBufLenIn;
+
+    if (ok)
+    {
+        uint8_t* newBuf = new uint8_t[bufLenOut+offset];
+        HSMemory::BlockMove(*bufIn, newBuf, offset);                    // copy offset (uncompressed) part
+        HSMemory::BlockMove(&ctx->fBuffer[0], newBuf+offset, bufLenOut);  // copy compressed part
+        delete [] *bufIn;
+        *bufIn = newBuf;
+        *bufLenIn = bufLenOut+offset;
+    }
+
+    plZlibContext::Release(ctx);
+    return ok;
 }
 
 //
@@ -109,10 +576,20 @@ bool plZlibCompress::Uncompress(uint8_t** bufIn, uint32_t* bufLenIn, uint32_t bu
     uint32_t adjBufLenIn = *bufLenIn - offset;
     uint8_t* adjBufIn = *bufIn + offset;
 
-    char* bufOut = new char[bufLenOut];
-    
-    bool ok=Uncompress((uint8_t*)bufOut, &bufLenOut, (uint8_t*)adjBufIn, adjBufLenIn) ? true : false;
-    return ICopyBuffers(bufIn, bufLenIn, bufOut, bufLenOut, offset, ok);
+    // Inflate straight into the new buffer, behind the offset part
+    uint8_t* newBuf = new uint8_t[bufLenOut+offset];
+    HSMemory::BlockMove(*bufIn, newBuf, offset);
+
+    if (!Uncompress(newBuf+offset, &bufLenOut, adjBufIn, adjBufLenIn))
+    {
+        delete [] newBuf;
+        return false;
+    }
+
+    delete [] *bufIn;
+    *bufIn = newBuf;
+    *bufLenIn = bufLenOut+offset;
+    return true;
 }
 
 //// .gz File Versions ///////////////////////////////////////////////////////
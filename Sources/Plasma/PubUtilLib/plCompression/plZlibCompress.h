@@ -43,14 +43,33 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #define plZlibCompress_h
 
 #include "plCompress.h"
+#include <vector>
 
 class hsStream;
+class plZlibContext;
 
+//
+// Compress and Uncompress borrow their zlib state from a shared pool, so
+// back to back calls don't pay for allocating and initializing it again.
+// Large buffers are split into blocks that are deflated on helper threads;
+// the blocks are stitched back into a single zlib stream, so the receiving
+// end can't tell the difference.
+//
 class plZlibCompress : public plCompress
 {
 protected:
-    bool ICopyBuffers(uint8_t** bufIn, uint32_t* bufLenIn, char* bufOut, uint32_t bufLenOut, int offset, bool ok );
+    static int fNumBlockThreads;
+
+    static bool IDeflate(plZlibContext* ctx, uint8_t* bufOut, uint32_t* bufLenOut, const uint8_t* bufIn, uint32_t bufLenIn);
+
 public:
+    enum
+    {
+        kBlockSize          = 128 * 1024,       // Input per independently deflated block
+        kBlockThreshold     = 2 * kBlockSize,   // Smaller buffers go through in one piece
+        kDefaultBlockThreads = 2
+    };
+
     bool Uncompress(uint8_t* bufOut, uint32_t* bufLenOut, const uint8_t* bufIn, uint32_t bufLenIn);
     bool Compress(uint8_t* bufOut, uint32_t* bufLenOut, const uint8_t* bufIn, uint32_t bufLenIn);
 
@@ -58,6 +77,15 @@ public:
     bool Uncompress(uint8_t** bufIn, uint32_t* bufLenIn, uint32_t maxBufLenOut, int offset=0);
     bool Compress(uint8_t** bufIn, uint32_t* bufLenIn, int offset=0);
 
+    // Block version, used by Compress for buffers over kBlockThreshold.
+    // bufOut needs the same slack as Compress. Falls back to a single
+    // deflate if it doesn't have it.
+    bool CompressBlocks(uint8_t* bufOut, uint32_t* bufLenOut, const uint8_t* bufIn, uint32_t bufLenIn);
+
+    // Helper threads for CompressBlocks, 0 deflates every block on the calling thread
+    static void SetNumBlockThreads(int num);
+    static int  GetNumBlockThreads() { return fNumBlockThreads; }
+
     // .gz versions
     static bool   UncompressFile( const char *compressedPath, const char *destPath );
     static bool   CompressFile( const char *uncompressedPath, const char *destPath );
@@ -67,4 +95,34 @@ public:
     static bool   CompressToFile( hsStream * s, const char * filename );
 };
 
+//
+// A zlib stream plus a scratch buffer, handed out by plZlibCompress's pool.
+// Acquire gives you a context that's been reset and is ready to go, Release
+// puts it back.
+//
+class plZlibContext
+{
+public:
+    enum Type
+    {
+        kDeflate,       // zlib wrapped deflate
+        kDeflateRaw,    // bare deflate, for the pieces of a block stream
+        kInflate,       // zlib wrapped inflate
+        kInflateRaw,    // bare inflate, for plZlibStream's gzip data
+
+        kNumTypes
+    };
+
+    void*                   fStream;    // z_streamp, kept opaque so zlib.h stays out of the header
+    Type                    fType;
+    bool                    fInitOk;
+    std::vector<uint8_t>    fBuffer;    // Scratch output, kept between uses
+
+    plZlibContext(Type type);
+    ~plZlibContext();
+
+    static plZlibContext*   Acquire(Type type);
+    static void             Release(plZlibContext* ctx);
+};
+
 #endif  // plZlibCompress_h
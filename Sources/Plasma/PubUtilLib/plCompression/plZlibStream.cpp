@@ -40,25 +40,20 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 *==LICENSE==*/
 #include "plZlibStream.h"
+#include "plZlibCompress.h"
 #include <zlib.h>
 
-voidpf ZlibAlloc(voidpf opaque, uInt items, uInt size)
-{
-    return malloc(items*size);
-}
-
-void ZlibFree(voidpf opaque, voidpf address)
-{
-    free(address);
-}
+// Inflated data is collected in the context's buffer and handed to the
+// output in chunks this big
+static const uint32_t kOutputChunk = 32 * 1024;
 
-plZlibStream::plZlibStream() : fOutput(nil), fZStream(nil), fHeader(kNeedMoreData), fDecompressedOk(false)
+plZlibStream::plZlibStream() : fOutput(nil), fContext(nil), fHeader(kNeedMoreData), fDecompressedOk(false)
 {
 }
 
 plZlibStream::~plZlibStream()
 {
-    hsAssert(!fOutput && !fZStream, "plZlibStream not closed");
+    hsAssert(!fOutput && !fContext, "plZlibStream not closed");
 }
 
 bool plZlibStream::Open(const char* filename, const char* mode)
@@ -88,12 +83,10 @@ bool plZlibStream::Close()
         delete fOutput;
         fOutput = nil;
     }
-    if (fZStream)
+    if (fContext)
     {
-        z_streamp zstream = (z_streamp)fZStream;
-        inflateEnd(zstream);
-        delete zstream;
-        fZStream = nil;
+        plZlibContext::Release(fContext);
+        fContext = nil;
     }
 
     return true;
@@ -123,16 +116,19 @@ uint32_t plZlibStream::Write(uint32_t byteCount, const void* buffer)
     if (fHeader == kValidHeader)
     {
         ASSERT(fOutput);
-        ASSERT(fZStream);
-        z_streamp zstream = (z_streamp)fZStream;
+        ASSERT(fContext);
+        z_streamp zstream = (z_streamp)fContext->fStream;
         zstream->avail_in = byteCount;
         zstream->next_in = byteBuf;
 
-        char outBuf[2048];
+        if (fContext->fBuffer.size() < kOutputChunk)
+            fContext->fBuffer.resize(kOutputChunk);
+        uint8_t* outBuf = &fContext->fBuffer[0];
+
         while (zstream->avail_in != 0)
         {
-            zstream->avail_out = sizeof(outBuf);
-            zstream->next_out = (uint8_t*)outBuf;
+            zstream->avail_out = kOutputChunk;
+            zstream->next_out = outBuf;
 
             uint32_t amtWritten = zstream->total_out;
 
@@ -250,18 +246,10 @@ int plZlibStream::IValidateGzHeader(uint32_t byteCount, const void* buffer)
     uint32_t headerSize = s.GetPosition();
     uint32_t clipBuffer = headerSize - initCacheSize;
     
-    // Initialize the zlib stream
-    z_streamp zstream = new z_stream_s;
-    memset(zstream, 0, sizeof(z_stream_s));
-    zstream->zalloc = ZlibAlloc;
-    zstream->zfree = ZlibFree;
-    zstream->opaque = nil;
-    zstream->avail_in = byteCount - clipBuffer;
-    zstream->next_in = (uint8_t*)&fHeaderCache[clipBuffer];
-    // Gotta use inflateInit2, because there's no header for zlib to look at.
-    // The -15 tells it to not try and find a header
-    bool initOk = (inflateInit2(zstream, -15) == Z_OK);
-    fZStream = zstream;
+    // Grab a zlib stream. It has to be a raw inflate, because there's no
+    // header for zlib to look at.
+    fContext = plZlibContext::Acquire(plZlibContext::kInflateRaw);
+    bool initOk = fContext->fInitOk;
 
     fHeaderCache.clear();
 
@@ -271,7 +259,7 @@ int plZlibStream::IValidateGzHeader(uint32_t byteCount, const void* buffer)
         fHeader = kInvalidHeader;
         return 0;
     }
-    ASSERT(fZStream);
+    ASSERT(fContext);
 
     fHeader = kValidHeader;
     return clipBuffer;
@@ -45,6 +45,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "hsStream.h"
 #include "hsStlUtils.h"
 
+class plZlibContext;
+
 //
 // This is for reading a .gz file from a buffer, and writing the uncompressed data to a file.
 // Call open with the name of the uncompressed file, then call write with the compressed data.
@@ -53,7 +55,7 @@ class plZlibStream : public hsStream
 {
 protected:
     hsStream* fOutput;
-    void* fZStream;
+    plZlibContext* fContext;    // From plZlibCompress's pool, holds the inflate state and output buffer
     bool fDecompressedOk;
 
     enum Validate { kNeedMoreData, kInvalidHeader, kValidHeader };
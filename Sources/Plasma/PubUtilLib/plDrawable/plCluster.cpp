@@ -48,6 +48,15 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plSpanInstance.h"
 
 #include "hsFastMath.h"
+#include "hsThread.h"
+
+#include <vector>
+
+#ifdef HS_SIMD_INCLUDE
+#  include HS_SIMD_INCLUDE
+#endif
+
+hsFunctionDispatcher<plCluster::xform_verts_ptr> plCluster::xform_verts(plCluster::xform_verts_fpu, plCluster::xform_verts_sse1);
 
 plCluster::plCluster()
 :   fGroup(nil)
@@ -93,42 +102,136 @@ void plCluster::Write(hsStream* s) const
     }
 }
 
-inline void inlTESTPOINT(const hsPoint3& destP, 
-                         float& minX, float& minY, float& minZ, 
-                         float& maxX, float& maxY, float& maxZ)
+void plCluster::xform_verts_fpu(const hsMatrix44& l2w, const hsMatrix44& w2l, const float* delPos,
+                                uint8_t* pos, uint8_t* norm, int stride, int numVerts, bool normalize, float* bnd)
 {
-    if( destP.fX < minX )
-        minX = destP.fX;
-    else if( destP.fX > maxX )
-        maxX = destP.fX;
-
-    if( destP.fY < minY )
-        minY = destP.fY;
-    else if( destP.fY > maxY )
-        maxY = destP.fY;
-
-    if( destP.fZ < minZ )
-        minZ = destP.fZ;
-    else if( destP.fZ > maxZ )
-        maxZ = destP.fZ;
+    int i;
+    for( i = 0; i < numVerts; i++ )
+    {
+        hsPoint3* p = (hsPoint3*)pos;
+        if( delPos )
+        {
+            p->fX += delPos[0];
+            p->fY += delPos[1];
+            p->fZ += delPos[2];
+            delPos += 3;
+        }
+        *p = l2w * *p;
+
+        if( p->fX < bnd[0] )
+            bnd[0] = p->fX;
+        if( p->fX > bnd[3] )
+            bnd[3] = p->fX;
+        if( p->fY < bnd[1] )
+            bnd[1] = p->fY;
+        if( p->fY > bnd[4] )
+            bnd[4] = p->fY;
+        if( p->fZ < bnd[2] )
+            bnd[2] = p->fZ;
+        if( p->fZ > bnd[5] )
+            bnd[5] = p->fZ;
+
+        hsVector3* n = (hsVector3*)norm;
+        *n = w2l * *n;
+        if( normalize )
+            hsFastMath::NormalizeAppr(*n);
+
+        pos += stride;
+        norm += stride;
+    }
 }
 
-void plCluster::UnPack(uint8_t* vDst, uint16_t* iDst, int idxOffset, hsBounds3Ext& wBnd) const
+void plCluster::xform_verts_sse1(const hsMatrix44& l2w, const hsMatrix44& w2l, const float* delPos,
+                                uint8_t* pos, uint8_t* norm, int stride, int numVerts, bool normalize, float* bnd)
 {
-    float minX = 1.e33f;
-    float minY = 1.e33f;
-    float minZ = 1.e33f;
+#ifdef HS_SSE1
+    // The matrix multiplies skip identity matrices, and so must we.
+    if( (l2w.fFlags | w2l.fFlags) & hsMatrix44::kIsIdent )
+    {
+        xform_verts_fpu(l2w, w2l, delPos, pos, norm, stride, numVerts, normalize, bnd);
+        return;
+    }
+
+    // Columns of the matrices, so each lane does its row's sum in the same order as
+    // the scalar hsMatrix44 multiplies, and gets the same answer.
+    const __m128 p0 = _mm_setr_ps(l2w.fMap[0][0], l2w.fMap[1][0], l2w.fMap[2][0], 0);
+    const __m128 p1 = _mm_setr_ps(l2w.fMap[0][1], l2w.fMap[1][1], l2w.fMap[2][1], 0);
+    const __m128 p2 = _mm_setr_ps(l2w.fMap[0][2], l2w.fMap[1][2], l2w.fMap[2][2], 0);
+    const __m128 p3 = _mm_setr_ps(l2w.fMap[0][3], l2w.fMap[1][3], l2w.fMap[2][3], 0);
+
+    const __m128 n0 = _mm_setr_ps(w2l.fMap[0][0], w2l.fMap[1][0], w2l.fMap[2][0], 0);
+    const __m128 n1 = _mm_setr_ps(w2l.fMap[0][1], w2l.fMap[1][1], w2l.fMap[2][1], 0);
+    const __m128 n2 = _mm_setr_ps(w2l.fMap[0][2], w2l.fMap[1][2], w2l.fMap[2][2], 0);
+
+    __m128 bMin = _mm_setr_ps(bnd[0], bnd[1], bnd[2], 0);
+    __m128 bMax = _mm_setr_ps(bnd[3], bnd[4], bnd[5], 0);
+
+    float out[4];
+    int i;
+    for( i = 0; i < numVerts; i++ )
+    {
+        float* p = (float*)pos;
+        float x = p[0];
+        float y = p[1];
+        float z = p[2];
+        if( delPos )
+        {
+            x += delPos[0];
+            y += delPos[1];
+            z += delPos[2];
+            delPos += 3;
+        }
+        __m128 r = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(x), p0),
+                                                    _mm_mul_ps(_mm_set1_ps(y), p1)),
+                                         _mm_mul_ps(_mm_set1_ps(z), p2)),
+                              p3);
+        bMin = _mm_min_ps(bMin, r);
+        bMax = _mm_max_ps(bMax, r);
+        _mm_storeu_ps(out, r);
+        p[0] = out[0];
+        p[1] = out[1];
+        p[2] = out[2];
+
+        hsVector3* n = (hsVector3*)norm;
+        r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(n->fX), n0),
+                                  _mm_mul_ps(_mm_set1_ps(n->fY), n1)),
+                       _mm_mul_ps(_mm_set1_ps(n->fZ), n2));
+        _mm_storeu_ps(out, r);
+        n->fX = out[0];
+        n->fY = out[1];
+        n->fZ = out[2];
+        if( normalize )
+            hsFastMath::NormalizeAppr(*n);
+
+        pos += stride;
+        norm += stride;
+    }
 
-    float maxX = -1.e33f;
-    float maxY = -1.e33f;
-    float maxZ = -1.e33f;
+    _mm_storeu_ps(out, bMin);
+    bnd[0] = out[0];
+    bnd[1] = out[1];
+    bnd[2] = out[2];
+    _mm_storeu_ps(out, bMax);
+    bnd[3] = out[0];
+    bnd[4] = out[1];
+    bnd[5] = out[2];
+#endif // HS_SSE1
+}
 
+void plCluster::UnPack(uint8_t* vDst, uint16_t* iDst, int idxOffset, hsBounds3Ext& wBnd) const
+{
+    UnPackIndices(iDst, idxOffset);
+    UnPackVerts(vDst, wBnd);
+}
+
+void plCluster::UnPackIndices(uint16_t* iDst, int idxOffset) const
+{
     hsAssert(fGroup->GetTemplate(), "Can't unpack without a template");
     const plSpanTemplate& templ = *fGroup->GetTemplate();
     int i;
     for( i = 0; i < fInsts.GetCount(); i++ )
     {
-        // First, just copy our template, offsetting by prescribed amount.
+        // Just copy our template, offsetting by prescribed amount.
         const uint16_t* iSrc = templ.IndexData();
         int n = templ.NumIndices();
         while( n-- )
@@ -138,77 +241,129 @@ void plCluster::UnPack(uint8_t* vDst, uint16_t* iDst, int idxOffset, hsBounds3Ex
             iSrc++;
         }
         idxOffset += templ.NumVerts();
+    }
+}
 
-        memcpy(vDst, templ.VertData(), templ.VertSize());
+void plCluster::UnPackVerts(uint8_t* vDst, hsBounds3Ext& wBnd) const
+{
+    float bnd[6] = { 1.e33f, 1.e33f, 1.e33f, -1.e33f, -1.e33f, -1.e33f };
+
+    hsAssert(fGroup->GetTemplate(), "Can't unpack without a template");
+    const plSpanTemplate& templ = *fGroup->GetTemplate();
+    const int numVerts = templ.NumVerts();
+    const int posOff = templ.PositionOffset();
+    const int normOff = templ.NormalOffset();
+    const int colOff = templ.ColorOffset();
+    const int stride = templ.Stride();
+
+    std::vector<float> delPos;
 
-        // Now we need to fix it up. That means,
+    int i;
+    for( i = 0; i < fInsts.GetCount(); i++ )
+    {
+        // First copy our template, then fix it up. That means,
         // a) Possibly adding a delta to the position.
         // b) Transforming the position and normal.
         // c) Possibly overwriting some (or all) of the color.
+        memcpy(vDst, templ.VertData(), templ.VertSize());
 
-        // If we have individual position and/or color info, apply
-        // it, along with the transform.
-        if( GetInst(i).HasPosDelta() || GetInst(i).HasColor() )
-        {
-            const int posOff = templ.PositionOffset();
-            const int normOff = templ.NormalOffset();
-            const int colOff = templ.ColorOffset();
-            const int stride = templ.Stride();
-
-            const hsMatrix44 l2w = GetInst(i).LocalToWorld();
-            hsMatrix44 w2l;
-            GetInst(i).WorldToLocal().GetTranspose(&w2l);
-            
-            plSpanInstanceIter iter(fInsts[i], fEncoding, templ.NumVerts());
-            const int numVerts = templ.NumVerts();
-            int iVert;
-            for( iVert = 0, iter.Begin(); iVert < numVerts; iVert++, iter.Advance() )
-            {
-                hsPoint3* pos = (hsPoint3*)(vDst + posOff);
-                *pos = iter.Position(*pos);
-                *pos = l2w * *pos;
-                inlTESTPOINT(*pos, minX, minY, minZ, maxX, maxY, maxZ);
-
-                hsVector3* norm = (hsVector3*)(vDst + normOff);
-                *norm = w2l * *norm;
-                hsFastMath::NormalizeAppr(*norm);
-
-                uint32_t* color = (uint32_t*)(vDst + colOff);
-                *color = iter.Color(*color);
-
-                vDst += stride;
-            }
-        }
-        else
+        const plSpanInstance& inst = GetInst(i);
+
+        const hsMatrix44 l2w = inst.LocalToWorld();
+        hsMatrix44 w2l;
+        inst.WorldToLocal().GetTranspose(&w2l);
+
+        const float* delta = nil;
+        if( inst.HasPosDelta() )
         {
-            // Just transform the position and normal.
-            const int posOff = templ.PositionOffset();
-            const int normOff = templ.NormalOffset();
-            const int stride = templ.Stride();
-            
-            const hsMatrix44 l2w = GetInst(i).LocalToWorld();
-            hsMatrix44 w2l;
-            GetInst(i).WorldToLocal().GetTranspose(&w2l);
-            
-            const int numVerts = templ.NumVerts();
-            int iVert;
-            for( iVert = 0; iVert < numVerts; iVert++ )
-            {
-                hsPoint3* pos = (hsPoint3*)(vDst + posOff);
-                *pos = l2w * *pos;
-                inlTESTPOINT(*pos, minX, minY, minZ, maxX, maxY, maxZ);
-
-                hsVector3* norm = (hsVector3*)(vDst + normOff);
-                *norm = w2l * *norm;
-
-                vDst += stride;
-            }
+            delPos.resize(numVerts * 3);
+            inst.DecodePosDelta(fEncoding, numVerts, &delPos[0]);
+            delta = &delPos[0];
         }
+
+        // Instances with their own position or color info get their normals
+        // renormalized, the rest are just transformed.
+        const bool normalize = inst.HasPosDelta() || inst.HasColor();
+        xform_verts.call(l2w, w2l, delta, vDst + posOff, vDst + normOff, stride, numVerts, normalize, bnd);
+
+        if( inst.HasColor() )
+            inst.DecodeColor(fEncoding, numVerts, vDst, colOff, stride);
+
+        vDst += numVerts * stride;
     }
-    hsPoint3 min(minX, minY, minZ);
+    hsPoint3 min(bnd[0], bnd[1], bnd[2]);
     wBnd.Reset(&min);
-    hsPoint3 max(maxX, maxY, maxZ);
+    hsPoint3 max(bnd[3], bnd[4], bnd[5]);
     wBnd.Union(&max);
 }
 
+uint32_t plCluster::PackedSize() const
+{
+    const uint32_t numVerts = fGroup->GetTemplate()->NumVerts();
+    const uint32_t posStride = plSpanInstance::PosStrideFromEncoding(fEncoding);
+    const uint32_t colStride = plSpanInstance::ColStrideFromEncoding(fEncoding);
 
+    uint32_t size = sizeof(*this) + fInsts.GetCount() * (sizeof(plSpanInstance*) + sizeof(plSpanInstance));
+    int i;
+    for( i = 0; i < fInsts.GetCount(); i++ )
+    {
+        if( GetInst(i).HasPosDelta() )
+            size += numVerts * posStride;
+        if( GetInst(i).HasColor() )
+            size += numVerts * colStride;
+    }
+    return size;
+}
+
+// Decodes every fStep'th job starting at fFirst. Jobs write to disjoint
+// ranges of preallocated storage, so the stripes need no locking.
+class plClusterUnPackThread : public hsThread
+{
+public:
+    plClusterUnPackJob* fJobs;
+    int                 fNumJobs;
+    int                 fFirst;
+    int                 fStep;
+
+    virtual hsError Run()
+    {
+        int i;
+        for( i = fFirst; i < fNumJobs; i += fStep )
+            fJobs[i].fCluster->UnPackVerts(fJobs[i].fVDst, fJobs[i].fBounds);
+        return hsOK;
+    }
+};
+
+// Below this many vertices, starting threads costs more than it saves.
+static const uint32_t kMinThreadedUnPackVerts = 16384;
+
+void plCluster::UnPackJobs(plClusterUnPackJob* jobs, int numJobs, int maxThreads)
+{
+    uint32_t numVerts = 0;
+    int i;
+    for( i = 0; i < numJobs; i++ )
+        numVerts += jobs[i].fCluster->NumInsts() * jobs[i].fCluster->GetTemplate()->NumVerts();
+
+    int numThreads = hsMinimum(maxThreads, numJobs);
+    if( (numThreads < 2) || (numVerts < kMinThreadedUnPackVerts) )
+    {
+        for( i = 0; i < numJobs; i++ )
+            jobs[i].fCluster->UnPackVerts(jobs[i].fVDst, jobs[i].fBounds);
+        return;
+    }
+
+    // The calling thread takes the first stripe itself.
+    std::vector<plClusterUnPackThread> threads(numThreads - 1);
+    for( i = 0; i < threads.size(); i++ )
+    {
+        threads[i].fJobs = jobs;
+        threads[i].fNumJobs = numJobs;
+        threads[i].fFirst = i + 1;
+        threads[i].fStep = numThreads;
+        threads[i].Start();
+    }
+    for( i = 0; i < numJobs; i += numThreads )
+        jobs[i].fCluster->UnPackVerts(jobs[i].fVDst, jobs[i].fBounds);
+    for( i = 0; i < threads.size(); i++ )
+        threads[i].Stop();
+}
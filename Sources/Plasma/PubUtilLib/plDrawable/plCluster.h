@@ -45,6 +45,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #define plCluster_inc
 
 #include "hsTemplates.h"
+#include "hsCpuID.h"
+#include "hsBounds.h"
 
 #include "plClusterGroup.h"
 #include "plSpanInstance.h"
@@ -56,7 +58,14 @@ class hsKeyedObject;
 class plLightInfo;
 class plSpanTemplate;
 class plVisRegion;
-class hsBounds3Ext;
+
+// One cluster's vertices to decode into preallocated storage, and the bounds they come out with.
+struct plClusterUnPackJob
+{
+    const plCluster*    fCluster;
+    uint8_t*            fVDst;
+    hsBounds3Ext        fBounds;
+};
 
 class plCluster
 {
@@ -75,6 +84,18 @@ protected:
     friend class plClusterUtil;
     plSpanInstance*             IGetInst(int i) const { return fInsts[i]; }
     void                        IAddInst(plSpanInstance* inst) { fInsts.Append(inst); }
+
+    // Adds the optional (x,y,z) float deltas to the positions at pos, then transforms
+    // positions by l2w and the normals at norm by w2l (already transposed), numVerts
+    // vertices stride bytes apart. Normals are renormalized if requested. Expands the
+    // running world bounds in bnd (minX,minY,minZ,maxX,maxY,maxZ).
+    typedef void(*xform_verts_ptr)(const hsMatrix44& l2w, const hsMatrix44& w2l, const float* delPos,
+                                    uint8_t* pos, uint8_t* norm, int stride, int numVerts, bool normalize, float* bnd);
+    static void xform_verts_fpu(const hsMatrix44& l2w, const hsMatrix44& w2l, const float* delPos,
+                                    uint8_t* pos, uint8_t* norm, int stride, int numVerts, bool normalize, float* bnd);
+    static void xform_verts_sse1(const hsMatrix44& l2w, const hsMatrix44& w2l, const float* delPos,
+                                    uint8_t* pos, uint8_t* norm, int stride, int numVerts, bool normalize, float* bnd);
+    static hsFunctionDispatcher<xform_verts_ptr> xform_verts;
 public:
 
     plCluster();
@@ -88,6 +109,17 @@ public:
 
     void UnPack(uint8_t* vDst, uint16_t* iDst, int idxOffset, hsBounds3Ext& wBnd) const;
 
+    // The two halves of UnPack, so the vertices can be decoded on another thread.
+    void UnPackIndices(uint16_t* iDst, int idxOffset) const;
+    void UnPackVerts(uint8_t* vDst, hsBounds3Ext& wBnd) const;
+
+    // Bytes held by the encoded instances, for comparison with the unpacked size.
+    uint32_t PackedSize() const;
+
+    // Runs UnPackVerts for each job, spread over up to maxThreads threads (including
+    // the caller's). Batches too small to be worth the threads run on the caller alone.
+    static void UnPackJobs(plClusterUnPackJob* jobs, int numJobs, int maxThreads);
+
     // Getters and setters, mostly for export construction.
     const plSpanTemplate* GetTemplate() const { return fGroup->GetTemplate(); }
 
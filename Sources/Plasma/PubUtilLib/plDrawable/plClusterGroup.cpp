@@ -65,6 +65,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plgDispatch.h"
 #include "plMessage/plAgeLoadedMsg.h"
 
+int plClusterGroup::fUnPackThreads = 4;
+
 plClusterGroup::plClusterGroup()
 :   fSceneNode(nil),
     fDrawable(nil),
@@ -108,6 +108,8 @@ protected:
 
     plRenderLevel                   fRenderLevel;
 
+    static int                      fUnPackThreads;
+
     bool        IAddVisRegion(plVisRegion* reg);
     bool        IRemoveVisRegion(plVisRegion* reg);
     bool        IAddLight(plLightInfo* li);
@@ -158,6 +160,10 @@ public:
     plKey GetDrawable() const { return fDrawable; }
 
     plRenderLevel GetRenderLevel() const { return fRenderLevel; }
+
+    // Large groups are decoded at load on up to fUnPackThreads threads.
+    static void SetUnPackThreads(int n) { fUnPackThreads = n > 0 ? n : 1; }
+    static int GetUnPackThreads() { return fUnPackThreads; }
 };
 
 #endif // plClusterGroup_inc
@@ -47,6 +47,13 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plAccessGeometry.h"
 
 #include "hsStream.h"
+#include "plProfile.h"
+
+#include <algorithm>
+
+#ifdef HS_SIMD_INCLUDE
+#  include HS_SIMD_INCLUDE
+#endif
 
 // Test hack
 #include "plDrawableSpans.h"
@@ -58,6 +65,11 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plSurface/hsGMaterial.h"
 #include "plSurface/plLayerInterface.h"
 
+plProfile_CreateCounter("CutTris", "DynaDecal", CutTris);
+plProfile_CreateCounter("ClipTris", "DynaDecal", ClipTris);
+
+hsFunctionDispatcher<plCutter::classify_tris_ptr> plCutter::classify_tris(plCutter::classify_tris_fpu, plCutter::classify_tris_sse1);
+
 void plCutter::Read(hsStream* stream, hsResMgr* mgr)
 {
     plCreatable::Read(stream, mgr);
@@ -274,42 +286,14 @@ inline void plCutter::ICutoutVtxMidW(const plCutoutVtx& inVtx, const plCutoutVtx
 }
 
 // IPolyClip
-bool plCutter::IPolyClip(hsTArray<plCutoutVtx>& poly, const hsPoint3 vPos[]) const
+// The poly's UVWs are already set, and classify_tris has said it isn't
+// entirely outside any of the planes.
+bool plCutter::IPolyClip(hsTArray<plCutoutVtx>& poly) const
 {
     static hsTArray<plCutoutVtx> accum;
     accum.SetCount(0);
 
-    poly[0].fUVW.fX = vPos[0].InnerProduct(fDirU) - fDistU;
-    poly[0].fUVW.fY = vPos[0].InnerProduct(fDirV) - fDistV;
-    poly[0].fUVW.fZ = vPos[0].InnerProduct(fDirW) - fDistW;
-
-    poly[1].fUVW.fX = vPos[1].InnerProduct(fDirU) - fDistU;
-    poly[1].fUVW.fY = vPos[1].InnerProduct(fDirV) - fDistV;
-    poly[1].fUVW.fZ = vPos[1].InnerProduct(fDirW) - fDistW;
-
-    poly[2].fUVW.fX = vPos[2].InnerProduct(fDirU) - fDistU;
-    poly[2].fUVW.fY = vPos[2].InnerProduct(fDirV) - fDistV;
-    poly[2].fUVW.fZ = vPos[2].InnerProduct(fDirW) - fDistW;
-
-    // Try an early out test.
     int i;
-    for( i = 0; i < 3; i++ )
-    {
-        int lo = 1;
-        int hi = 1;
-        int j;
-        for( j = 0; j < 3; j++ )
-        {
-            lo &= poly[j].fUVW[i] <= 0;
-            hi &= poly[j].fUVW[i] >= 1.f;
-        }
-        if( lo || hi )
-        {
-            poly.SetCount(0);
-            return false;
-        }
-    }
-
 
     // First trim to lower bounds.
     for( i = 0; i < poly.GetCount(); i++ )
@@ -735,164 +719,348 @@ bool plCutter::FindHitPointsConstHeight(const hsTArray<plCutoutPoly>& src, hsTAr
     return false;
 }
 
-void plCutter::ICutoutTransformedConstHeight(plAccessSpan& src, hsTArray<plCutoutPoly>& dst) const
+// The UVW of a point is (Dot(pos, fDirU) - fDistU, ...), so the cutter box is [0..1] on each axis.
+// A tri is rejected if all three verts are on the outside of the same plane, and only
+// needs clipping if some vert is outside some plane. Otherwise the clip would hand back
+// the tri untouched.
+inline void plCutter::IClassifyTri(const float* planes, const float* pos, int i, float* uvw, uint8_t* flags)
 {
-    const hsMatrix44& l2w = src.GetLocalToWorld();
-    hsMatrix44 l2wNorm;
-    src.GetWorldToLocal().GetTranspose(&l2wNorm);
+    int rejLo = 0x7;
+    int rejHi = 0x7;
+    int clip = 0;
+    int j;
+    for( j = 0; j < 3; j++ )
+    {
+        float x = pos[(j*3+0) * kCutBatch + i];
+        float y = pos[(j*3+1) * kCutBatch + i];
+        float z = pos[(j*3+2) * kCutBatch + i];
+        int k;
+        for( k = 0; k < 3; k++ )
+        {
+            const float* pl = planes + k * 4;
+            float t = x * pl[0];
+            t += y * pl[1];
+            t += z * pl[2];
+            t -= pl[3];
+            uvw[(j*3+k) * kCutBatch + i] = t;
+
+            if( !(t <= 0) )
+                rejLo &= ~(1 << k);
+            if( !(t >= 1.f) )
+                rejHi &= ~(1 << k);
+            if( (t < 0) || (t > 1.f) )
+                clip = 1;
+        }
+    }
+    flags[i] = (rejLo | rejHi) ? kTriReject : clip ? kTriClip : 0;
+}
 
-    bool baseHasAlpha = 0 != (src.GetMaterial()->GetLayer(0)->GetBlendFlags() & hsGMatState::kBlendAlpha);
+void plCutter::classify_tris_fpu(const float* planes, const float* pos, int num, float* uvw, uint8_t* flags)
+{
+    int i;
+    for( i = 0; i < num; i++ )
+        IClassifyTri(planes, pos, i, uvw, flags);
+}
 
-    plAccTriIterator tri(&src.AccessTri());
-    // For each tri
-    for( tri.Begin(); tri.More(); tri.Advance() )
+void plCutter::classify_tris_sse1(const float* planes, const float* pos, int num, float* uvw, uint8_t* flags)
+{
+#ifdef HS_SSE1
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+
+    int i;
+    for( i = 0; i + 4 <= num; i += 4 )
     {
-        // Do a polygon clip of tri to box
-        static hsTArray<plCutoutVtx> poly;
-        poly.SetCount(3);
-
-        // Not sure about this, whether the constant water height should be world space or local.
-        // We'll leave it in local for now.
-        const hsVector3 up(0, 0, 1.f);
-        hsPoint3 vPos[3];
-        vPos[0] = l2w * hsPoint3(tri.Position(0).fX, tri.Position(0).fY, src.GetWaterHeight());
-        vPos[1] = l2w * hsPoint3(tri.Position(1).fX, tri.Position(1).fY, src.GetWaterHeight());
-        vPos[2] = l2w * hsPoint3(tri.Position(2).fX, tri.Position(2).fY, src.GetWaterHeight());
-
-        poly[0].Init(l2w * hsPoint3(tri.Position(0).fX, tri.Position(0).fY, tri.Position(0).fZ), l2wNorm * up, tri.DiffuseRGBA(0));
-        poly[1].Init(l2w * hsPoint3(tri.Position(1).fX, tri.Position(1).fY, tri.Position(1).fZ), l2wNorm * up, tri.DiffuseRGBA(1));
-        poly[2].Init(l2w * hsPoint3(tri.Position(2).fX, tri.Position(2).fY, tri.Position(2).fZ), l2wNorm * up, tri.DiffuseRGBA(2));
-
-        // If we got a polygon
-        if( IPolyClip(poly, vPos) )
+        __m128 reject = zero;
+        __m128 clip = zero;
+        int k;
+        for( k = 0; k < 3; k++ )
         {
-            // tessalate the polygon into dst
-            IConstruct(dst, poly, baseHasAlpha);
+            const __m128 dx = _mm_set1_ps(planes[k*4+0]);
+            const __m128 dy = _mm_set1_ps(planes[k*4+1]);
+            const __m128 dz = _mm_set1_ps(planes[k*4+2]);
+            const __m128 dist = _mm_set1_ps(planes[k*4+3]);
+
+            __m128 lo = _mm_cmpeq_ps(zero, zero);
+            __m128 hi = lo;
+            int j;
+            for( j = 0; j < 3; j++ )
+            {
+                __m128 t = _mm_mul_ps(_mm_loadu_ps(pos + (j*3+0) * kCutBatch + i), dx);
+                t = _mm_add_ps(t, _mm_mul_ps(_mm_loadu_ps(pos + (j*3+1) * kCutBatch + i), dy));
+                t = _mm_add_ps(t, _mm_mul_ps(_mm_loadu_ps(pos + (j*3+2) * kCutBatch + i), dz));
+                t = _mm_sub_ps(t, dist);
+                _mm_storeu_ps(uvw + (j*3+k) * kCutBatch + i, t);
+
+                lo = _mm_and_ps(lo, _mm_cmple_ps(t, zero));
+                hi = _mm_and_ps(hi, _mm_cmpge_ps(t, one));
+                clip = _mm_or_ps(clip, _mm_or_ps(_mm_cmplt_ps(t, zero), _mm_cmpgt_ps(t, one)));
+            }
+            reject = _mm_or_ps(reject, _mm_or_ps(lo, hi));
         }
+        int rejBits = _mm_movemask_ps(reject);
+        int clipBits = _mm_movemask_ps(clip);
+        int j;
+        for( j = 0; j < 4; j++ )
+            flags[i+j] = (rejBits & (1 << j)) ? kTriReject : (clipBits & (1 << j)) ? kTriClip : 0;
     }
+    for( ; i < num; i++ )
+        IClassifyTri(planes, pos, i, uvw, flags);
+#endif // HS_SSE1
 }
 
+// Positions are run through classify_tris a batch at a time, and we only go back
+// to the span for normals and colors on tris that survive. Most of a span is
+// usually nowhere near the cutter.
+//
 // We usually don't need to do any transform, because the kind of surface you
 // would leave prints on tends to be static, with the transform folded into the
-// verts. So it's worth having 2 separate versions of the function.
-void plCutter::ICutoutTransformed(plAccessSpan& src, hsTArray<plCutoutPoly>& dst) const
+// verts.
+//
+// Not sure about the const water height, whether it should be world space or local.
+// We'll leave it in local for now.
+void plCutter::ICutout(plAccessSpan& src, const uint32_t* triIdx, uint32_t numTris, hsTArray<plCutoutPoly>& dst) const
 {
     const hsMatrix44& l2w = src.GetLocalToWorld();
+    const bool transformed = !(l2w.fFlags & hsMatrix44::kIsIdent);
+    const bool constHeight = src.HasWaterHeight();
+    const float waterHeight = constHeight ? src.GetWaterHeight() : 0;
+
     hsMatrix44 l2wNorm;
-    src.GetWorldToLocal().GetTranspose(&l2wNorm);
+    if( transformed )
+        src.GetWorldToLocal().GetTranspose(&l2wNorm);
+
+    const hsVector3 up(0, 0, 1.f);
+    const hsVector3 worldUp = transformed ? l2wNorm * up : up;
 
     bool baseHasAlpha = 0 != (src.GetMaterial()->GetLayer(0)->GetBlendFlags() & hsGMatState::kBlendAlpha);
 
+    const float planes[12] = {
+        fDirU.fX, fDirU.fY, fDirU.fZ, fDistU,
+        fDirV.fX, fDirV.fY, fDirV.fZ, fDistV,
+        fDirW.fX, fDirW.fY, fDirW.fZ, fDistW
+    };
+
+    float pos[9 * kCutBatch];
+    float uvw[9 * kCutBatch];
+    uint8_t flags[kCutBatch];
+
+    static hsTArray<plCutoutVtx> poly;
+
+    plProfile_IncCount(CutTris, numTris);
+
     plAccTriIterator tri(&src.AccessTri());
-    // For each tri
-    for( tri.Begin(); tri.More(); tri.Advance() )
+    uint32_t iBatch;
+    for( iBatch = 0; iBatch < numTris; iBatch += kCutBatch )
     {
-        // Do a polygon clip of tri to box
-        static hsTArray<plCutoutVtx> poly;
-        poly.SetCount(3);
+        int num = int(hsMinimum(numTris - iBatch, uint32_t(kCutBatch)));
 
-        hsPoint3 vPos[3];
-        vPos[0] = l2w * tri.Position(0);
-        vPos[1] = l2w * tri.Position(1);
-        vPos[2] = l2w * tri.Position(2);
+        int i;
+        for( i = 0; i < num; i++ )
+        {
+            tri.SetTri(triIdx ? triIdx[iBatch + i] : iBatch + i);
+            int j;
+            for( j = 0; j < 3; j++ )
+            {
+                hsPoint3 p = tri.Position(j);
+                if( constHeight )
+                    p.fZ = waterHeight;
+                if( transformed )
+                    p = l2w * p;
+                pos[(j*3+0) * kCutBatch + i] = p.fX;
+                pos[(j*3+1) * kCutBatch + i] = p.fY;
+                pos[(j*3+2) * kCutBatch + i] = p.fZ;
+            }
+        }
 
-        poly[0].Init(vPos[0], l2wNorm * tri.Normal(0), tri.DiffuseRGBA(0));
-        poly[1].Init(vPos[1], l2wNorm * tri.Normal(1), tri.DiffuseRGBA(1));
-        poly[2].Init(vPos[2], l2wNorm * tri.Normal(2), tri.DiffuseRGBA(2));
+        classify_tris.call(planes, pos, num, uvw, flags);
 
-        // If we got a polygon
-        if( IPolyClip(poly, vPos) )
+        for( i = 0; i < num; i++ )
         {
+            if( flags[i] & kTriReject )
+                continue;
+
+            tri.SetTri(triIdx ? triIdx[iBatch + i] : iBatch + i);
+            poly.SetCount(3);
+            int j;
+            for( j = 0; j < 3; j++ )
+            {
+                if( constHeight )
+                {
+                    // The real position, not the one at water height we clipped with.
+                    const hsPoint3& p = tri.Position(j);
+                    poly[j].Init(transformed ? l2w * p : p, worldUp, tri.DiffuseRGBA(j));
+                }
+                else
+                {
+                    hsPoint3 p(pos[(j*3+0) * kCutBatch + i], pos[(j*3+1) * kCutBatch + i], pos[(j*3+2) * kCutBatch + i]);
+                    poly[j].Init(p, transformed ? l2wNorm * tri.Normal(j) : tri.Normal(j), tri.DiffuseRGBA(j));
+                }
+                poly[j].fUVW.Set(uvw[(j*3+0) * kCutBatch + i], uvw[(j*3+1) * kCutBatch + i], uvw[(j*3+2) * kCutBatch + i]);
+            }
+
+            if( flags[i] & kTriClip )
+            {
+                plProfile_Inc(ClipTris);
+                if( !IPolyClip(poly) )
+                    continue;
+            }
+
             // tessalate the polygon into dst
             IConstruct(dst, poly, baseHasAlpha);
         }
     }
 }
 
-void plCutter::ICutoutConstHeight(plAccessSpan& src, hsTArray<plCutoutPoly>& dst) const
+// Cutout
+void plCutter::Cutout(plAccessSpan& src, hsTArray<plCutoutPoly>& dst) const
 {
-    if( !(src.GetLocalToWorld().fFlags & hsMatrix44::kIsIdent) )
-    {
-        ICutoutTransformedConstHeight(src, dst);
+    if( !src.HasAccessTri() )
         return;
-    }
 
-    bool baseHasAlpha = 0 != (src.GetMaterial()->GetLayer(0)->GetBlendFlags() & hsGMatState::kBlendAlpha);
+    ICutout(src, nil, src.AccessTri().TriCount(), dst);
+}
 
-    plAccTriIterator tri(&src.AccessTri());
-    // For each tri
-    for( tri.Begin(); tri.More(); tri.Advance() )
-    {
-        // Do a polygon clip of tri to box
-        static hsTArray<plCutoutVtx> poly;
-        poly.SetCount(3);
+void plCutter::Cutout(plAccessSpan& src, const std::vector<uint32_t>& tris, hsTArray<plCutoutPoly>& dst) const
+{
+    if( !src.HasAccessTri() || tris.empty() )
+        return;
 
-        const hsVector3 up(0, 0, 1.f);
+    ICutout(src, &tris[0], uint32_t(tris.size()), dst);
+}
 
-        hsPoint3 vPos[3];
-        vPos[0].Set(tri.Position(0).fX, tri.Position(0).fY, src.GetWaterHeight());
-        vPos[1].Set(tri.Position(1).fX, tri.Position(1).fY, src.GetWaterHeight());
-        vPos[2].Set(tri.Position(2).fX, tri.Position(2).fY, src.GetWaterHeight());
+/////////////////////////////////////////////////////////////////////////////////////////////////////
 
-        poly[0].Init(hsPoint3(tri.Position(0).fX, tri.Position(0).fY, tri.Position(0).fZ), up, tri.DiffuseRGBA(0));
-        poly[1].Init(hsPoint3(tri.Position(1).fX, tri.Position(1).fY, tri.Position(1).fZ), up, tri.DiffuseRGBA(1));
-        poly[2].Init(hsPoint3(tri.Position(2).fX, tri.Position(2).fY, tri.Position(2).fZ), up, tri.DiffuseRGBA(2));
+inline int plCutterCells::ICellX(float x) const
+{
+    int i = int((x - fMinX) * fInvCellX);
+    return i < 0 ? 0 : i >= fNumX ? fNumX-1 : i;
+}
 
-        // If we got a polygon
-        if( IPolyClip(poly, vPos) )
-        {
-            // tessalate the polygon into dst
-            IConstruct(dst, poly, baseHasAlpha);
-        }
-    }
+inline int plCutterCells::ICellY(float y) const
+{
+    int i = int((y - fMinY) * fInvCellY);
+    return i < 0 ? 0 : i >= fNumY ? fNumY-1 : i;
 }
 
-// Cutout
-void plCutter::Cutout(plAccessSpan& src, hsTArray<plCutoutPoly>& dst) const
+void plCutterCells::Build(plAccessSpan& src)
 {
+    fStart.clear();
+    fTris.clear();
+    fNumX = fNumY = 0;
+
     if( !src.HasAccessTri() )
         return;
 
-    if( src.HasWaterHeight() )
-    {
-        ICutoutConstHeight(src, dst);
+    plAccessTriSpan& acc = src.AccessTri();
+    const uint32_t numTris = acc.TriCount();
+    if( !numTris )
         return;
-    }
 
-    if( !(src.GetLocalToWorld().fFlags & hsMatrix44::kIsIdent) )
+    hsAssert(src.GetLocalToWorld().fFlags & hsMatrix44::kIsIdent, "Building cells on transformed span");
+
+    plAccTriIterator tri(&acc);
+
+    float maxX, maxY;
+    tri.Begin();
+    fMinX = maxX = tri.Position(0).fX;
+    fMinY = maxY = tri.Position(0).fY;
+    for( ; tri.More(); tri.Advance() )
     {
-        ICutoutTransformed(src, dst);
-        return;
+        int j;
+        for( j = 0; j < 3; j++ )
+        {
+            const hsPoint3& p = tri.Position(j);
+            fMinX = hsMinimum(fMinX, p.fX);
+            fMinY = hsMinimum(fMinY, p.fY);
+            maxX = hsMaximum(maxX, p.fX);
+            maxY = hsMaximum(maxY, p.fY);
+        }
     }
 
-    bool baseHasAlpha = 0 != (src.GetMaterial()->GetLayer(0)->GetBlendFlags() & hsGMatState::kBlendAlpha);
-
-    plAccTriIterator tri(&src.AccessTri());
-    // For each tri
-    for( tri.Begin(); tri.More(); tri.Advance() )
+    int n = int(sqrt(float(numTris) / float(kTrisPerCell)));
+    if( n < 1 )
+        n = 1;
+    if( n > kMaxCellsPerAxis )
+        n = kMaxCellsPerAxis;
+    fNumX = fNumY = n;
+    fInvCellX = maxX > fMinX ? float(n) / (maxX - fMinX) : 0;
+    fInvCellY = maxY > fMinY ? float(n) / (maxY - fMinY) : 0;
+
+    // Count, then fill, so each cell's tris are contiguous and ascending.
+    fStart.resize(fNumX * fNumY + 1, 0);
+    int pass;
+    for( pass = 0; pass < 2; pass++ )
     {
-        // Do a polygon clip of tri to box
-        static hsTArray<plCutoutVtx> poly;
-        poly.SetCount(3);
+        std::vector<uint32_t> next;
+        if( pass )
+        {
+            int c;
+            for( c = 0; c < fNumX * fNumY; c++ )
+                fStart[c+1] += fStart[c];
+            fTris.resize(fStart[fNumX * fNumY]);
+            next.assign(fStart.begin(), fStart.end() - 1);
+        }
 
-        hsPoint3 vPos[3];
-        vPos[0] = tri.Position(0);
-        vPos[1] = tri.Position(1);
-        vPos[2] = tri.Position(2);
+        uint32_t iTri = 0;
+        for( tri.Begin(); tri.More(); tri.Advance(), iTri++ )
+        {
+            const hsPoint3& p0 = tri.Position(0);
+            const hsPoint3& p1 = tri.Position(1);
+            const hsPoint3& p2 = tri.Position(2);
+            int x0 = ICellX(hsMinimum(p0.fX, hsMinimum(p1.fX, p2.fX)));
+            int x1 = ICellX(hsMaximum(p0.fX, hsMaximum(p1.fX, p2.fX)));
+            int y0 = ICellY(hsMinimum(p0.fY, hsMinimum(p1.fY, p2.fY)));
+            int y1 = ICellY(hsMaximum(p0.fY, hsMaximum(p1.fY, p2.fY)));
+            int x, y;
+            for( y = y0; y <= y1; y++ )
+            {
+                for( x = x0; x <= x1; x++ )
+                {
+                    if( pass )
+                        fTris[next[y * fNumX + x]++] = iTri;
+                    else
+                        fStart[y * fNumX + x + 1]++;
+                }
+            }
+        }
+    }
+}
 
-        poly[0].Init(vPos[0], tri.Normal(0), tri.DiffuseRGBA(0));
-        poly[1].Init(vPos[1], tri.Normal(1), tri.DiffuseRGBA(1));
-        poly[2].Init(vPos[2], tri.Normal(2), tri.DiffuseRGBA(2));
+void plCutterCells::Gather(const hsBounds3Ext& bnd, std::vector<uint32_t>& tris) const
+{
+    tris.clear();
+    if( !fNumX || (bnd.GetType() != kBoundsNormal) )
+        return;
 
-        // If we got a polygon
-        if( IPolyClip(poly, vPos) )
+    // The cutter's UVW box and its world bounds are built separately, so
+    // allow a little slop rather than lose a sliver on the edge.
+    hsPoint3 lo = bnd.GetMins();
+    hsPoint3 hi = bnd.GetMaxs();
+    float pad = hsMaximum(hi.fX - lo.fX, hi.fY - lo.fY) * 0.01f + 1.e-3f;
+
+    int x0 = ICellX(lo.fX - pad);
+    int x1 = ICellX(hi.fX + pad);
+    int y0 = ICellY(lo.fY - pad);
+    int y1 = ICellY(hi.fY + pad);
+    int x, y;
+    for( y = y0; y <= y1; y++ )
+    {
+        for( x = x0; x <= x1; x++ )
         {
-            // tessalate the polygon into dst
-            IConstruct(dst, poly, baseHasAlpha);
+            int c = y * fNumX + x;
+            tris.insert(tris.end(), fTris.begin() + fStart[c], fTris.begin() + fStart[c+1]);
         }
     }
+    if( (x0 != x1) || (y0 != y1) )
+    {
+        std::sort(tris.begin(), tris.end());
+        tris.erase(std::unique(tris.begin(), tris.end()), tris.end());
+    }
 }
 
+/////////////////////////////////////////////////////////////////////////////////////////////////////
+
 void plCutter::IConstruct(hsTArray<plCutoutPoly>& dst, hsTArray<plCutoutVtx>& poly, bool baseHasAlpha) const
 {
     int iDst = dst.GetCount();
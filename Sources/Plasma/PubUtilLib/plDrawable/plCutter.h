@@ -50,6 +50,9 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "hsBounds.h"
 #include "plIntersect/plVolumeIsect.h"
 #include "hsColorRGBA.h"
+#include "hsCpuID.h"
+
+#include <vector>
 
 struct hsPoint3;
 struct hsVector3;
@@ -100,9 +103,54 @@ public:
     void Reset() { fVerts.SetCount(0); fIdx.SetCount(0); }
 };
 
+// plCutterCells - the triangles of a static span binned into a grid over
+// its XY footprint, so a cutter only visits the triangles under it.
+// Triangles are filed in every cell their bounds overlap.
+class plCutterCells
+{
+public:
+    enum
+    {
+        kTrisPerCell    = 8,
+        kMaxCellsPerAxis = 64
+    };
+protected:
+    float                   fMinX;
+    float                   fMinY;
+    float                   fInvCellX;
+    float                   fInvCellY;
+    int                     fNumX;
+    int                     fNumY;
+    std::vector<uint32_t>   fStart;     // fNumX*fNumY+1 offsets into fTris
+    std::vector<uint32_t>   fTris;
+
+    inline int      ICellX(float x) const;
+    inline int      ICellY(float y) const;
+
+public:
+    plCutterCells() : fMinX(0), fMinY(0), fInvCellX(0), fInvCellY(0), fNumX(0), fNumY(0) {}
+
+    // Source must be untransformed, the cells are built from the raw positions.
+    void        Build(plAccessSpan& src);
+
+    // Fills tris with every triangle that might be under bnd, ascending with no repeats.
+    void        Gather(const hsBounds3Ext& bnd, std::vector<uint32_t>& tris) const;
+
+    uint32_t    GetNumRefs() const { return uint32_t(fTris.size()); }
+};
+
 class plCutter : public plCreatable
 {
 protected:
+    enum
+    {
+        kCutBatch       = 64        // Triangles classified per pass
+    };
+    enum
+    {
+        kTriReject      = 0x1,      // All verts on the outside of one cutter plane
+        kTriClip        = 0x2       // Some vert outside some cutter plane
+    };
 
     // Permanent attributes
     float fLengthU;
@@ -121,8 +169,17 @@ protected:
     hsBounds3Ext    fWorldBounds;
     plBoundsIsect   fIsect;
 
+    // Batch of triangles as 9 streams of kCutBatch floats (x0,y0,z0,x1,...,z2), in world space.
+    // Writes cutter space coordinates into uvw in the same layout (u0,v0,w0,u1,...,w2),
+    // and kTriReject/kTriClip for each triangle into flags. Planes are (dirU,distU,dirV,distV,dirW,distW).
+    typedef void(*classify_tris_ptr)(const float* planes, const float* pos, int num, float* uvw, uint8_t* flags);
+    static inline void IClassifyTri(const float* planes, const float* pos, int i, float* uvw, uint8_t* flags);
+    static void classify_tris_fpu(const float* planes, const float* pos, int num, float* uvw, uint8_t* flags);
+    static void classify_tris_sse1(const float* planes, const float* pos, int num, float* uvw, uint8_t* flags);
+    static hsFunctionDispatcher<classify_tris_ptr> classify_tris;
+
     void            IConstruct(hsTArray<plCutoutPoly>& dst, hsTArray<plCutoutVtx>& poly, bool baseHasAlpha) const;
-    bool            IPolyClip(hsTArray<plCutoutVtx>& poly, const hsPoint3 vPos[]) const;
+    bool            IPolyClip(hsTArray<plCutoutVtx>& poly) const;
     
     inline void     ICutoutVtxHiU(const plCutoutVtx& inVtx, const plCutoutVtx& outVtx, plCutoutVtx& dst) const;
     inline void     ICutoutVtxHiV(const plCutoutVtx& inVtx, const plCutoutVtx& outVtx, plCutoutVtx& dst) const;
@@ -138,9 +195,7 @@ protected:
 
     inline void     ISetPosNorm(float parm, const plCutoutVtx& inVtx, const plCutoutVtx& outVtx, plCutoutVtx& dst) const;
 
-    void            ICutoutTransformed(plAccessSpan& src, hsTArray<plCutoutPoly>& dst) const;
-    void            ICutoutConstHeight(plAccessSpan& src, hsTArray<plCutoutPoly>& dst) const;
-    void            ICutoutTransformedConstHeight(plAccessSpan& src, hsTArray<plCutoutPoly>& dst) const;
+    void            ICutout(plAccessSpan& src, const uint32_t* triIdx, uint32_t numTris, hsTArray<plCutoutPoly>& dst) const;
 
 
 public:
@@ -160,6 +215,8 @@ public:
     void        Set(const hsPoint3& pos, const hsVector3& dir, const hsVector3& out, bool flip=false);
 
     void        Cutout(plAccessSpan& src, hsTArray<plCutoutPoly>& dst) const;
+    // Same as above, but only considers the listed triangles (ascending), e.g. from plCutterCells::Gather().
+    void        Cutout(plAccessSpan& src, const std::vector<uint32_t>& tris, hsTArray<plCutoutPoly>& dst) const;
     bool        CutoutGrid(int nWid, int nLen, plFlatGridMesh& dst) const;
 
     void        SetLength(const hsVector3& s) { fLengthU = s.fX; fLengthV = s.fY; fLengthW = s.fZ; }
@@ -62,6 +62,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plDrawableSpans.h"
 #include "hsStream.h"
 #include "hsResMgr.h"
+#include "hsFastArray.h"
 #include "plPipeline.h"
 #include "plGeometrySpan.h"
 #include "plSpaceTree.h"
@@ -102,6 +103,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plStatusLog/plStatusLog.h"
 
 #include <algorithm>
+#include <vector>
 
 //// Local Konstants /////////////////////////////////////////////////////////
 
@@ -1539,7 +1541,7 @@ void    plDrawableSpans::SortSpan( uint32_t index, plPipeline *pipe )
 
     ICheckSpanForSortable(index);
 
-    static hsTArray<hsRadixSort::Elem>  sortList;
+    static hsFastArray<hsRadixSort::Elem>   sortList;
     static hsTArray<uint16_t>             tempTriList;
     hsRadixSort::Elem                   *elem;
 
@@ -1629,8 +1631,8 @@ void plDrawableSpans::SortVisibleSpans(const hsTArray<int16_t>& visList, plPipel
         return;
 
 
-    static hsLargeArray<hsRadixSort::Elem>  sortScratch;
-    static hsLargeArray<uint16_t>         triList;
+    static hsFastArray<hsRadixSort::Elem>   sortScratch;
+    static hsFastArray<uint16_t>          triList;
     static hsTArray<int32_t>              counters;
     static hsTArray<uint32_t>             startIndex;
     
@@ -1821,8 +1823,8 @@ void plDrawableSpans::SortVisibleSpans(const hsTArray<int16_t>& visList, plPipel
 
     plProfile_BeginTiming(FaceSort);
 
-    static hsLargeArray<hsRadixSort::Elem>  sortScratch;
-    static hsLargeArray<uint16_t>         triList;
+    static hsFastArray<hsRadixSort::Elem>   sortScratch;
+    static hsFastArray<uint16_t>          triList;
     static hsTArray<int32_t>              counters;
     static hsTArray<uint32_t>             startIndex;
     
@@ -2067,7 +2069,7 @@ void plDrawableSpans::SortVisibleSpansUnit(const hsTArray<int16_t>& visList, plP
 
     plProfile_BeginTiming(FaceSort);
 
-    static hsLargeArray<uint16_t>         triList;
+    static hsFastArray<uint16_t>          triList;
     
     int i;
     
@@ -2110,7 +2112,7 @@ void plDrawableSpans::SortVisibleSpansUnit(const hsTArray<int16_t>& visList, plP
         uint16_t      fIndex2;
         float    fDist;
     };
-    static hsLargeArray<sortFace>   sortList;
+    static hsFastArray<sortFace>    sortList;
 
     struct SelectCloserFace
     {
@@ -3192,8 +3194,26 @@ void    plDrawableSpans::IMakeSpanSortable( uint32_t index )
     span->fProps |= plSpan::kPropFacesSortable;
 }
 
+plProfile_CreateTimer("UnPackCluster", "Update", UnPackCluster);
+plProfile_CreateCounter("ClusterVerts", "Update", ClusterVerts);
+
+uint8_t* plDrawableSpans::IGetClusterVerts(const plIcicle& span) const
+{
+    plGBufferGroup* grp = fGroups[span.fGroupIdx];
+    return grp->GetVertBufferData(span.fVBufferIdx)
+        + grp->GetCell(span.fVBufferIdx, span.fCellIdx)->fVtxStart
+        + span.fCellOffset * grp->GetVertexSize();
+}
+
+// UnPackCluster
+// Each of the cluster group's clusters becomes one icicle, with its vertices and indices
+// packed into isolated cells of our buffer groups. All the storage is reserved and the
+// spans set up before any decoding, then the vertices are decoded, spread across
+// threads for big groups.
 void plDrawableSpans::UnPackCluster(plClusterGroup* cluster)
 {
+    plProfile_BeginTiming(UnPackCluster);
+
     const uint32_t vertsPerInst = cluster->GetTemplate()->NumVerts();
     const uint32_t idxPerInst = cluster->GetTemplate()->NumIndices();
 
@@ -3217,6 +3237,8 @@ void plDrawableSpans::UnPackCluster(plClusterGroup* cluster)
 
     const hsTArray<plLightInfo*>& lights = cluster->GetLights();
 
+    uint32_t totalVerts = 0;
+
     int iStart;
     for( iStart = 0; iStart < cluster->GetNumClusters(); )
     {
@@ -3225,21 +3247,20 @@ void plDrawableSpans::UnPackCluster(plClusterGroup* cluster)
         int iEnd;
         for( iEnd = iStart; iEnd < cluster->GetNumClusters(); iEnd++ )
         {
-            numVerts += vertsPerInst * cluster->GetCluster(iEnd)->NumInsts();
-            numIdx += idxPerInst * cluster->GetCluster(iEnd)->NumInsts();
-
-            if( (numVerts > plGBufferGroup::kMaxNumVertsPerBuffer)
-                ||(numIdx > plGBufferGroup::kMaxNumIndicesPerBuffer) )
-            {
-                // Oops, too much.
-                numVerts -= vertsPerInst * cluster->GetCluster(iEnd)->NumInsts();
-                numIdx -= idxPerInst * cluster->GetCluster(iEnd)->NumInsts();
-
-                iEnd--;
+            const int instVerts = vertsPerInst * cluster->GetCluster(iEnd)->NumInsts();
+            const int instIdx = idxPerInst * cluster->GetCluster(iEnd)->NumInsts();
 
+            // Stop before the cluster that would overflow the buffer, unless it's the
+            // only one, in which case it has to go somewhere.
+            if( (iEnd > iStart)
+                && ((numVerts + instVerts > plGBufferGroup::kMaxNumVertsPerBuffer)
+                    ||(numIdx + instIdx > plGBufferGroup::kMaxNumIndicesPerBuffer)) )
                 break;
-            }
+
+            numVerts += instVerts;
+            numIdx += instIdx;
         }
+        hsAssert(numVerts <= plGBufferGroup::kMaxNumVertsPerBuffer, "Single cluster too big for a buffer");
 
         // Still in trouble here. We need to fake up that cell crap for each of 
         // our clusters to make a span for it. Whoo-hoo.
@@ -3257,17 +3278,12 @@ void plDrawableSpans::UnPackCluster(plClusterGroup* cluster)
         fGroups[grpIdx]->ReserveIndexStorage(numIdx, &ibufferIdx, &istartIdx);
         uint32_t iOffset = 0;
 
-        uint8_t* vData = fGroups[grpIdx]->GetVertBufferData(vbufferIdx);
-        uint16_t* iData = fGroups[grpIdx]->GetIndexBufferData(ibufferIdx);
-        uint8_t* pvData = vData;
-        uint16_t* piData = iData;
+        // Indices are just the template's, offset, so we always do them now.
+        uint16_t* piData = fGroups[grpIdx]->GetIndexBufferData(ibufferIdx);
         int i;
         for( i = iStart; i < iEnd; i++ )
         {
-            hsBounds3Ext bnd;
-            cluster->GetCluster(i)->UnPack(pvData, piData, cellOffset, bnd);
-            fIcicles[iSpan].fLocalBounds = bnd;
-            fIcicles[iSpan].fWorldBounds = bnd;
+            cluster->GetCluster(i)->UnPackIndices(piData, cellOffset);
 
             fIcicles[iSpan].fTypeMask = plSpan::kSpan | plSpan::kVertexSpan | plSpan::kIcicleSpan;
             // STUB - need to set whether strictly runtime lit or preshaded based on cluster.
@@ -3314,19 +3330,36 @@ void plDrawableSpans::UnPackCluster(plClusterGroup* cluster)
 
             iSpan++;
 
-            const uint32_t vSize = cluster->GetCluster(i)->NumInsts() * cluster->GetTemplate()->VertSize();
-            pvData += vSize;
             piData += iLength;
         }
+        totalVerts += numVerts;
 
         iStart = iEnd;
     }
+
+    std::vector<plClusterUnPackJob> jobs(numClust);
+    int i;
+    for( i = 0; i < numClust; i++ )
+    {
+        jobs[i].fCluster = cluster->GetCluster(i);
+        jobs[i].fVDst = IGetClusterVerts(fIcicles[i]);
+    }
+    plCluster::UnPackJobs(&jobs[0], numClust, plClusterGroup::GetUnPackThreads());
+    for( i = 0; i < numClust; i++ )
+    {
+        fIcicles[i].fLocalBounds = jobs[i].fBounds;
+        fIcicles[i].fWorldBounds = jobs[i].fBounds;
+    }
+    plProfile_IncCount(ClusterVerts, totalVerts);
+
     fMaterials.SetCountAndZero(1);
     plGenRefMsg* refMsg = new plGenRefMsg(GetKey(), plRefMsg::kOnCreate, 0, kMsgMaterial);
     hsgResMgr::ResMgr()->SendRef(cluster->GetMaterial()->GetKey(), refMsg, plRefFlags::kActiveRef);
 
     fRenderLevel = cluster->GetRenderLevel();
     GetSpaceTree();
+
+    plProfile_EndTiming(UnPackCluster);
 }
 
 //// IFindBufferGroup ////////////////////////////////////////////////////////
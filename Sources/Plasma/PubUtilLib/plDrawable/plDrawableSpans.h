@@ -199,6 +199,8 @@ class plDrawableSpans : public plDrawable
         uint32_t  IRefMaterial( uint32_t index );
         void    ICheckToRemoveMaterial( uint32_t materialIdx );
 
+        uint8_t*    IGetClusterVerts( const plIcicle& span ) const;
+
         // Annoying to need this, but necessary until materials can test for properties on any of their layers (might add in the future)
         bool    ITestMatForSpecularity( hsGMaterial *mat );
 
@@ -100,10 +100,15 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include "plProfile.h"
 
+#include <algorithm>
+#include <map>
+#include <vector>
+
 plProfile_CreateTimerNoReset("Total", "DynaDecal", Total);
 plProfile_CreateTimerNoReset("Cutter", "DynaDecal", Cutter);
 plProfile_CreateTimerNoReset("Process", "DynaDecal", Process);
 plProfile_CreateTimerNoReset("Callback", "DynaDecal", Callback);
+plProfile_CreateCounter("CellTris", "DynaDecal", CellTris);
 
 static plRandom sRand;
 static const int    kBinBlockSize = 20;
@@ -132,6 +137,107 @@ static const float kInitAuxSpans = 5;
 
 using namespace std;
 
+///////////////////////////////////////////////////////////////////////////
+// Cell cache
+///////////////////////////////////////////////////////////////////////////
+
+// plCutterCells for the static spans we've cut into. Spans which are
+// transformed, volatile, or too small to bother with get no cells, and
+// are cut the slow way through every tri.
+class plDecalCellCache
+{
+public:
+    enum
+    {
+        kMinTris        = 32,
+        kMaxCachedRefs  = 256 * 1024    // Flush everything beyond this
+    };
+
+    class plDrawableCells
+    {
+    public:
+        plKey                       fKey;   // Held so the key can't be recycled while cached
+        std::vector<plCutterCells*> fSpans;
+    };
+
+protected:
+    typedef std::map<plKeyImp*, plDrawableCells*> plDrawableMap;
+
+    plDrawableMap   fDrawables;
+    uint32_t        fNumRefs;
+
+public:
+    plDecalCellCache() : fNumRefs(0) {}
+    ~plDecalCellCache() { Flush(); }
+
+    const plCutterCells* GetCells(plDrawableSpans* dr, uint32_t spanIdx, plAccessSpan& src);
+    void Flush();
+};
+
+const plCutterCells* plDecalCellCache::GetCells(plDrawableSpans* dr, uint32_t spanIdx, plAccessSpan& src)
+{
+    plKeyImp* key = dr->GetKey();
+    if( !key
+        || (dr->GetSpan(spanIdx)->fProps & plSpan::kPropVolatile)
+        || !src.HasAccessTri()
+        || (src.AccessTri().TriCount() < kMinTris)
+        || !(src.GetLocalToWorld().fFlags & hsMatrix44::kIsIdent) )
+        return nil;
+
+    plDrawableMap::iterator iter = fDrawables.find(key);
+    plDrawableCells* dc;
+    if( iter == fDrawables.end() )
+    {
+        dc = new plDrawableCells;
+        dc->fKey = dr->GetKey();
+        fDrawables[key] = dc;
+    }
+    else
+        dc = iter->second;
+
+    if( spanIdx >= dc->fSpans.size() )
+        dc->fSpans.resize(dr->GetNumSpans(), nil);
+
+    plCutterCells* cells = dc->fSpans[spanIdx];
+    if( !cells )
+    {
+        cells = new plCutterCells;
+        cells->Build(src);
+
+        // Over budget, start over with just this one.
+        if( fNumRefs + cells->GetNumRefs() > kMaxCachedRefs )
+        {
+            Flush();
+            dc = new plDrawableCells;
+            dc->fKey = dr->GetKey();
+            dc->fSpans.resize(dr->GetNumSpans(), nil);
+            fDrawables[key] = dc;
+        }
+        dc->fSpans[spanIdx] = cells;
+        fNumRefs += cells->GetNumRefs();
+    }
+    return cells;
+}
+
+void plDecalCellCache::Flush()
+{
+    plDrawableMap::iterator iter;
+    for( iter = fDrawables.begin(); iter != fDrawables.end(); ++iter )
+    {
+        plDrawableCells* dc = iter->second;
+        int i;
+        for( i = 0; i < dc->fSpans.size(); i++ )
+            delete dc->fSpans[i];
+        delete dc;
+    }
+    fDrawables.clear();
+    fNumRefs = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// plDynaDecalMgr
+///////////////////////////////////////////////////////////////////////////
+
 bool plDynaDecalMgr::fDisableAccumulate = false;
 bool plDynaDecalMgr::fDisableUpdate = false;
 
@@ -154,6 +260,7 @@ plDynaDecalMgr::plDynaDecalMgr()
     fPartyTime(1.f)
 {
     fCutter = new plCutter;
+    fCellCache = new plDecalCellCache;
 }
 
 plDynaDecalMgr::~plDynaDecalMgr()
@@ -177,6 +284,7 @@ plDynaDecalMgr::~plDynaDecalMgr()
     }
 
     delete fCutter;
+    delete fCellCache;
 }
 
 void plDynaDecalMgr::SetKey(plKey k)
@@ -455,6 +563,7 @@ bool plDynaDecalMgr::MsgReceive(plMessage* msg)
                 int idx = fTargets.Find((plSceneObject*)refMsg->GetRef());
                 if( idx != fTargets.kMissingIndex )
                     fTargets.Remove(idx);
+                fCellCache->Flush();
             }
             return true;
         case kRefPartyObject:
@@ -1435,6 +1544,23 @@ bool plDynaDecalMgr::ICutoutGrid(plDrawableSpans* drawable, int iSpan, hsGMateri
     return IProcessGrid(drawable, iSpan, mat, secs, grid);
 }
 
+// Static spans only have the tris under the cutter cut, the rest go through them all.
+void plDynaDecalMgr::ICutoutSpan(plDrawableSpans* dr, uint32_t spanIdx, plAccessSpan& src, hsTArray<plCutoutPoly>& dst)
+{
+    const plCutterCells* cells = fCellCache->GetCells(dr, spanIdx, src);
+    if( !cells )
+    {
+        fCutter->Cutout(src, dst);
+        return;
+    }
+
+    static std::vector<uint32_t> tris;
+    cells->Gather(fCutter->GetWorldBounds(), tris);
+    plProfile_IncCount(CellTris, uint32_t(tris.size()));
+
+    fCutter->Cutout(src, tris, dst);
+}
+
 bool plDynaDecalMgr::ICutoutObject(plSceneObject* so, double secs)
 {
     if( fDisableAccumulate )
@@ -1474,7 +1600,7 @@ bool plDynaDecalMgr::ICutoutObject(plSceneObject* so, double secs)
                         dst.SetCount(0);
 
                         plProfile_BeginTiming(Cutter);
-                        fCutter->Cutout(src, dst);
+                        ICutoutSpan(dr, diIndex[k], src, dst);
                         plProfile_EndTiming(Cutter);
 
                         plProfile_BeginTiming(Process);
@@ -1531,7 +1657,7 @@ bool plDynaDecalMgr::ICutoutList(hsTArray<plDrawVisList>& drawVis, double secs)
 
         plAccessGeometry::Instance()->OpenRO(drawVis[iDraw].fDrawable, drawVis[iDraw].fVisList[iSpan], src[i]);
 
-        fCutter->Cutout(src[i], dst);
+        ICutoutSpan((plDrawableSpans*)drawVis[iDraw].fDrawable, drawVis[iDraw].fVisList[iSpan], src[i], dst);
 
         if( IProcessPolys((plDrawableSpans*)drawVis[iDraw].fDrawable, drawVis[iDraw].fVisList[iSpan], secs, dst) )
             retVal = true;
@@ -70,6 +70,7 @@ class plMessage;
 
 class plCutter;
 class plCutoutPoly;
+class plDecalCellCache;
 class plFlatGridMesh;
 
 class plDrawVisList;
@@ -139,6 +140,7 @@ protected:
     hsTArray<plGBufferGroup*>   fGroups;
 
     plCutter*                   fCutter;
+    plDecalCellCache*           fCellCache;
 
     hsTArray<plAuxSpan*>        fAuxSpans;
 
@@ -219,6 +221,7 @@ protected:
     bool                ICutoutGrid(plDrawableSpans* drawable, int iSpan, hsGMaterial* mat, double secs);
     bool                IHitTestFlatGrid(const plFlatGridMesh& grid) const;
 
+    void                ICutoutSpan(plDrawableSpans* dr, uint32_t spanIdx, plAccessSpan& src, hsTArray<plCutoutPoly>& dst);
     bool                ICutoutList(hsTArray<plDrawVisList>& drawVis, double secs);
     bool                ICutoutObject(plSceneObject* so, double secs);
     bool                ICutoutTargets(double secs);
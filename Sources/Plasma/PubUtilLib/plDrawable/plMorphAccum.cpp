@@ -0,0 +1,337 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "HeadSpin.h"
+#include "plMorphAccum.h"
+
+#include "hsCpuID.h"
+#include "hsFastMath.h"
+#include "hsGeometry3.h"
+
+#include "plAccessSpan.h"
+#include "plAccessVtxSpan.h"
+#include "plMorphDelta.h"
+
+#ifdef HS_SIMD_INCLUDE
+#  include HS_SIMD_INCLUDE
+#endif
+
+///////////////////////////////////////////////////////////////////////////
+// Kernels
+///////////////////////////////////////////////////////////////////////////
+
+// Sum one packed delta span, scaled by weight, into the dense scratch.
+// src is the plMorphSpan::fPacked layout, dst is posX,posY,posZ,normX,normY,normZ
+// blocks of numVerts floats each.
+typedef void(*accum_ptr)(const uint16_t* idx, const float* src, int n, float weight, float* dst, uint32_t numVerts);
+
+// Add the accumulated normal deltas (if any) into the span's normals and renormalize.
+typedef void(*renorm_ptr)(const plAccessVtxSpan& vtx, const float* accNorm);
+
+static void accum_fpu(const uint16_t* idx, const float* src, int n, float weight, float* dst, uint32_t numVerts)
+{
+    int c;
+    for( c = 0; c < 6; c++ )
+    {
+        const float* s = src + c * n;
+        float* d = dst + c * numVerts;
+        int i;
+        for( i = 0; i < n; i++ )
+            d[idx[i]] += s[i] * weight;
+    }
+}
+
+static void accum_sse1(const uint16_t* idx, const float* src, int n, float weight, float* dst, uint32_t numVerts)
+{
+#ifdef HS_SSE1
+    float tmp[4];
+    const __m128 w = _mm_set1_ps(weight);
+    const int n4 = n & ~3;
+
+    int c;
+    for( c = 0; c < 6; c++ )
+    {
+        const float* s = src + c * n;
+        float* d = dst + c * numVerts;
+        int i;
+        for( i = 0; i < n4; i += 4 )
+        {
+            _mm_storeu_ps(tmp, _mm_mul_ps(_mm_loadu_ps(s + i), w));
+            d[idx[i+0]] += tmp[0];
+            d[idx[i+1]] += tmp[1];
+            d[idx[i+2]] += tmp[2];
+            d[idx[i+3]] += tmp[3];
+        }
+        for( ; i < n; i++ )
+            d[idx[i]] += s[i] * weight;
+    }
+#endif // HS_SSE1
+}
+
+static void renorm_fpu(const plAccessVtxSpan& vtx, const float* accNorm)
+{
+    const int n = vtx.VertCount();
+    int i;
+    for( i = 0; i < n; i++ )
+    {
+        hsVector3& norm = vtx.Normal(i);
+        if( accNorm )
+        {
+            norm.fX += accNorm[i];
+            norm.fY += accNorm[n + i];
+            norm.fZ += accNorm[2*n + i];
+        }
+        hsFastMath::Normalize(norm);
+    }
+}
+
+static void renorm_sse1(const plAccessVtxSpan& vtx, const float* accNorm)
+{
+#ifdef HS_SSE1
+    const int n = vtx.VertCount();
+    const int n4 = n & ~3;
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 one = _mm_set1_ps(1.f);
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 three = _mm_set1_ps(3.f);
+    float x[4];
+    float y[4];
+    float z[4];
+
+    int i;
+    for( i = 0; i < n4; i += 4 )
+    {
+        hsVector3& n0 = vtx.Normal(i+0);
+        hsVector3& n1 = vtx.Normal(i+1);
+        hsVector3& n2 = vtx.Normal(i+2);
+        hsVector3& n3 = vtx.Normal(i+3);
+
+        __m128 vx = _mm_set_ps(n3.fX, n2.fX, n1.fX, n0.fX);
+        __m128 vy = _mm_set_ps(n3.fY, n2.fY, n1.fY, n0.fY);
+        __m128 vz = _mm_set_ps(n3.fZ, n2.fZ, n1.fZ, n0.fZ);
+        if( accNorm )
+        {
+            vx = _mm_add_ps(vx, _mm_loadu_ps(accNorm + i));
+            vy = _mm_add_ps(vy, _mm_loadu_ps(accNorm + n + i));
+            vz = _mm_add_ps(vz, _mm_loadu_ps(accNorm + 2*n + i));
+        }
+
+        __m128 lenSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+
+        // rsqrt estimate plus one Newton-Raphson step, which is about as
+        // good as hsFastMath::InvSqrt. Degenerate normals are left alone.
+        __m128 r = _mm_rsqrt_ps(lenSq);
+        r = _mm_mul_ps(_mm_mul_ps(half, r), _mm_sub_ps(three, _mm_mul_ps(_mm_mul_ps(lenSq, r), r)));
+        __m128 valid = _mm_cmpgt_ps(lenSq, zero);
+        r = _mm_or_ps(_mm_and_ps(valid, r), _mm_andnot_ps(valid, one));
+
+        _mm_storeu_ps(x, _mm_mul_ps(vx, r));
+        _mm_storeu_ps(y, _mm_mul_ps(vy, r));
+        _mm_storeu_ps(z, _mm_mul_ps(vz, r));
+
+        n0.Set(x[0], y[0], z[0]);
+        n1.Set(x[1], y[1], z[1]);
+        n2.Set(x[2], y[2], z[2]);
+        n3.Set(x[3], y[3], z[3]);
+    }
+    for( ; i < n; i++ )
+    {
+        hsVector3& norm = vtx.Normal(i);
+        if( accNorm )
+        {
+            norm.fX += accNorm[i];
+            norm.fY += accNorm[n + i];
+            norm.fZ += accNorm[2*n + i];
+        }
+        hsFastMath::Normalize(norm);
+    }
+#endif // HS_SSE1
+}
+
+static hsFunctionDispatcher<accum_ptr> accum(accum_fpu, accum_sse1);
+static hsFunctionDispatcher<renorm_ptr> renorm(renorm_fpu, renorm_sse1);
+
+///////////////////////////////////////////////////////////////////////////
+// plMorphAccum
+///////////////////////////////////////////////////////////////////////////
+
+plMorphAccum::plMorphAccum()
+:   fScratch(nil),
+    fScratchVerts(0),
+    fUVWScratch(nil),
+    fUVWScratchSize(0)
+{
+}
+
+plMorphAccum::~plMorphAccum()
+{
+    delete [] fScratch;
+    delete [] fUVWScratch;
+}
+
+uint32_t plMorphAccum::GetNumVerts() const
+{
+    if( !fSpans.GetCount() )
+        return 0;
+    const plSpanAccum& last = fSpans[fSpans.GetCount()-1];
+    return last.fFirstVert + last.fNumVerts;
+}
+
+// MorphAccum - Begin
+// Lay out the scratch to match dst and clear it.
+void plMorphAccum::Begin(const hsTArray<plAccessSpan>& dst)
+{
+    fSpans.SetCount(dst.GetCount());
+
+    uint32_t numVerts = 0;
+    uint32_t numUVWs = 0;
+    int i;
+    for( i = 0; i < dst.GetCount(); i++ )
+    {
+        hsAssert(dst[i].HasAccessVtx(), "Come on, everyone has vertices");
+        const plAccessVtxSpan& accVtx = dst[i].AccessVtx();
+
+        plSpanAccum& s = fSpans[i];
+        s.fFirstVert = numVerts;
+        s.fFirstUVW = numUVWs;
+        s.fNumVerts = accVtx.VertCount();
+        s.fNumUVWs = accVtx.HasUVWs() ? accVtx.NumUVWs() : 0;
+        s.fTouched = false;
+
+        numVerts += s.fNumVerts;
+        numUVWs += s.fNumVerts * s.fNumUVWs;
+    }
+
+    if( numVerts > fScratchVerts )
+    {
+        delete [] fScratch;
+        fScratch = new float[6 * numVerts];
+        fScratchVerts = numVerts;
+    }
+    if( numUVWs > fUVWScratchSize )
+    {
+        delete [] fUVWScratch;
+        fUVWScratch = new hsPoint3[numUVWs];
+        fUVWScratchSize = numUVWs;
+    }
+
+    if( numVerts )
+        memset(fScratch, 0, 6 * numVerts * sizeof(float));
+    if( numUVWs )
+        memset(fUVWScratch, 0, numUVWs * sizeof(hsPoint3));
+}
+
+// MorphAccum - AddSpan
+// Sum weight * span's deltas into the scratch for dst span iSpan.
+void plMorphAccum::AddSpan(int iSpan, const plMorphSpan& span, float weight)
+{
+    const int n = span.fDeltas.GetCount();
+    if( !n || iSpan >= fSpans.GetCount() )
+        return;
+
+    plSpanAccum& s = fSpans[iSpan];
+    s.fTouched = true;
+
+    accum.call(span.fPackedIdx, span.fPacked, n, weight, IPosX(s), s.fNumVerts);
+
+    // UVW deltas are rare enough on the avatar to leave scalar.
+    const int numUVWs = s.fNumUVWs < span.fNumUVWChans ? s.fNumUVWs : span.fNumUVWChans;
+    if( numUVWs )
+    {
+        const hsPoint3* uvwDel = span.fUVWs;
+        int i;
+        for( i = 0; i < n; i++ )
+        {
+            hsPoint3* uvws = fUVWScratch + s.fFirstUVW + span.fPackedIdx[i] * s.fNumUVWs;
+            int j;
+            for( j = 0; j < numUVWs; j++ )
+                uvws[j] += uvwDel[j] * weight;
+            uvwDel += span.fNumUVWChans;
+        }
+    }
+}
+
+// MorphAccum - Commit
+// Single pass over the destination, adding in the accumulated deltas.
+// Every normal is renormalized, touched or not, just as the old
+// per-delta path did once all the deltas were in.
+void plMorphAccum::Commit(hsTArray<plAccessSpan>& dst)
+{
+    hsAssert(dst.GetCount() == fSpans.GetCount(), "Committing to different spans than we began with");
+
+    int i;
+    for( i = 0; i < dst.GetCount(); i++ )
+    {
+        const plSpanAccum& s = fSpans[i];
+        plAccessVtxSpan& accVtx = dst[i].AccessVtx();
+
+        if( s.fTouched )
+        {
+            const float* posX = IPosX(s);
+            const float* posY = posX + s.fNumVerts;
+            const float* posZ = posY + s.fNumVerts;
+            uint32_t j;
+            for( j = 0; j < s.fNumVerts; j++ )
+            {
+                hsPoint3& pos = accVtx.Position(j);
+                pos.fX += posX[j];
+                pos.fY += posY[j];
+                pos.fZ += posZ[j];
+            }
+
+            if( s.fNumUVWs )
+            {
+                const hsPoint3* uvwDel = fUVWScratch + s.fFirstUVW;
+                for( j = 0; j < s.fNumVerts; j++ )
+                {
+                    hsPoint3* uvws = accVtx.UVWs(j);
+                    int k;
+                    for( k = 0; k < s.fNumUVWs; k++ )
+                        uvws[k] += *uvwDel++;
+                }
+            }
+        }
+
+        if( accVtx.HasNormals() )
+            renorm.call(accVtx, s.fTouched ? INormX(s) : nil);
+    }
+}
@@ -0,0 +1,99 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#ifndef plMorphAccum_inc
+#define plMorphAccum_inc
+
+#include "hsTemplates.h"
+
+class plAccessSpan;
+class plMorphSpan;
+struct hsPoint3;
+
+// MorphAccum - scratch space for applying a whole stack of morph layers
+// at once. Rather than each delta reading and writing the (interleaved)
+// vertex buffer in turn, every active delta is summed into dense
+// structure-of-arrays buffers here, and Commit() then makes a single
+// pass over the destination, adding the totals and renormalizing.
+//
+// Usage:
+//      acc.Begin(dst);
+//      for each layer: morphArray.Accumulate(acc, weights);
+//      acc.Commit(dst);
+//
+// The scratch is only ever grown, so keeping one of these around
+// means morphing doesn't allocate after the first frame.
+class plMorphAccum
+{
+protected:
+    class plSpanAccum
+    {
+    public:
+        uint32_t    fFirstVert;     // Offset into the scratch, in verts
+        uint32_t    fFirstUVW;      // Offset into the uvw scratch, in hsPoint3s
+        uint32_t    fNumVerts;
+        uint16_t    fNumUVWs;
+        bool        fTouched;
+    };
+
+    hsTArray<plSpanAccum>   fSpans;
+
+    float*                  fScratch;       // 6 floats per vert (pos xyz, norm xyz), SoA per span
+    uint32_t                fScratchVerts;
+    hsPoint3*               fUVWScratch;
+    uint32_t                fUVWScratchSize;
+
+    float*      IPosX(const plSpanAccum& s) const { return fScratch + 6 * s.fFirstVert; }
+    float*      INormX(const plSpanAccum& s) const { return IPosX(s) + 3 * s.fNumVerts; }
+
+public:
+    plMorphAccum();
+    virtual ~plMorphAccum();
+
+    void        Begin(const hsTArray<plAccessSpan>& dst);
+    void        AddSpan(int iSpan, const plMorphSpan& span, float weight);
+    void        Commit(hsTArray<plAccessSpan>& dst);
+
+    uint32_t    GetNumVerts() const;
+};
+
+#endif // plMorphAccum_inc
@@ -71,6 +71,16 @@ void plMorphArray::Apply(hsTArray<plAccessSpan>& dst, hsTArray<float>* weights /
     }
 }
 
+// MorphArray - Accumulate
+// Like Apply, but sums into the accumulator, which makes the vertex
+// order question above moot. See plMorphAccum.
+void plMorphArray::Accumulate(plMorphAccum& acc, hsTArray<float>* weights /* = nil */) const
+{
+    int i;
+    for( i = 0; i < fDeltas.GetCount(); i++ )
+        fDeltas[i].Accumulate(acc, (weights ? weights->Get(i) : -1.f));
+}
+
 void plMorphArray::Read(hsStream* s, hsResMgr* mgr)
 {
     int n = s->ReadLE32();
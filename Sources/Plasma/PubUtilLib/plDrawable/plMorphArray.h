@@ -54,6 +54,7 @@ public:
     virtual ~plMorphArray();
 
     void Apply(hsTArray<plAccessSpan>& dst, hsTArray<float>* weights = nil) const;
+    void Accumulate(plMorphAccum& acc, hsTArray<float>* weights = nil) const;
 
     void Read(hsStream* s, hsResMgr* mgr);
     void Write(hsStream* s, hsResMgr* mgr); 
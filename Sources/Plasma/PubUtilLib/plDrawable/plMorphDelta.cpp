@@ -50,6 +50,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plAccessSpan.h"
 #include "plAccessVtxSpan.h"
 #include "plGeometrySpan.h"
+#include "plMorphAccum.h"
 
 #include "plTweak.h"
 
@@ -57,13 +58,56 @@ static const float kMinWeight = 1.e-2f;
 
 plMorphSpan::plMorphSpan()
 :   fUVWs(nil),
-    fNumUVWChans(0)
+    fNumUVWChans(0),
+    fPackedIdx(nil),
+    fPacked(nil)
 {
 }
 
 plMorphSpan::~plMorphSpan()
 {
     delete [] fUVWs;
+    ReleasePacked();
+}
+
+void plMorphSpan::ReleasePacked()
+{
+    delete [] fPackedIdx;
+    fPackedIdx = nil;
+    delete [] fPacked;
+    fPacked = nil;
+}
+
+void plMorphSpan::Pack()
+{
+    ReleasePacked();
+
+    const int n = fDeltas.GetCount();
+    if( !n )
+        return;
+
+    fPackedIdx = new uint16_t[n];
+    fPacked = new float[6 * n];
+
+    float* posX = fPacked;
+    float* posY = posX + n;
+    float* posZ = posY + n;
+    float* normX = posZ + n;
+    float* normY = normX + n;
+    float* normZ = normY + n;
+
+    int i;
+    for( i = 0; i < n; i++ )
+    {
+        const plVertDelta& delta = fDeltas[i];
+        fPackedIdx[i] = delta.fIdx;
+        posX[i] = delta.fPos.fX;
+        posY[i] = delta.fPos.fY;
+        posZ[i] = delta.fPos.fZ;
+        normX[i] = delta.fNorm.fX;
+        normY[i] = delta.fNorm.fY;
+        normZ[i] = delta.fNorm.fZ;
+    }
 }
 
 plMorphDelta::plMorphDelta()
@@ -140,6 +184,22 @@ void plMorphDelta::Apply(hsTArray<plAccessSpan>& dst, float weight /* = -1.f */)
     }
 }
 
+// MorphDelta - Accumulate
+// Same as Apply, but hands the packed deltas to the accumulator instead
+// of touching the destination vertices.
+void plMorphDelta::Accumulate(plMorphAccum& acc, float weight /* = -1.f */) const
+{
+    if( weight == -1.f)
+        weight = fWeight; // None passed in, use our stored value
+
+    if( weight <= kMinWeight )
+        return;
+
+    int iSpan;
+    for( iSpan = 0; iSpan < fSpans.GetCount(); iSpan++ )
+        acc.AddSpan(iSpan, fSpans[iSpan], weight);
+}
+
 // MorphDelta - ComputeDeltas
 void plMorphDelta::ComputeDeltas(const hsTArray<plAccessSpan>& base, const hsTArray<plAccessSpan>& moved)
 {
@@ -275,6 +335,7 @@ void plMorphDelta::SetNumSpans(int n)
 
 void plMorphDelta::AllocDeltas(int iSpan, int nDel, int nUVW)
 {
+    fSpans[iSpan].ReleasePacked();
     fSpans[iSpan].fDeltas.SetCount(nDel);
     fSpans[iSpan].fNumUVWChans = nUVW;
 
@@ -297,6 +358,7 @@ void plMorphDelta::SetDeltas(int iSpan, const hsTArray<plVertDelta>& deltas, int
         if( numUVWChans )
             HSMemory::BlockMove(uvws, fSpans[iSpan].fUVWs, deltas.GetCount() * numUVWChans * sizeof(*uvws));
     }
+    fSpans[iSpan].Pack();
 }
 
 void plMorphDelta::Read(hsStream* s, hsResMgr* mgr)
@@ -317,6 +379,7 @@ void plMorphDelta::Read(hsStream* s, hsResMgr* mgr)
             if( nUVW )
                 s->Read(nDel * nUVW * sizeof(hsPoint3), fSpans[iSpan].fUVWs);
         }
+        fSpans[iSpan].Pack();
     }
 
 }
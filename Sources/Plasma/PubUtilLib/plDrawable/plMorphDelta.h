@@ -49,6 +49,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include "plAccessSpan.h"
 
+class plMorphAccum;
+
 class plVertDelta
 {
 public:
@@ -68,6 +70,15 @@ public:
 
     uint16_t                  fNumUVWChans;
     hsPoint3*               fUVWs; // Length is fUVWChans*fDeltas.GetCount() (*sizeof(hsPoint3) in bytes).
+
+    // Structure-of-arrays copy of fDeltas, rebuilt whenever the deltas change.
+    // fPacked holds posX, posY, posZ, normX, normY, normZ, each a block of
+    // fDeltas.GetCount() floats, so the accumulator can stream it with SIMD.
+    uint16_t*               fPackedIdx;
+    float*                  fPacked;
+
+    void                    Pack();
+    void                    ReleasePacked();
 };
 
 class plMorphDelta : public plCreatable
@@ -90,6 +101,7 @@ public:
     float    GetWeight() const { return fWeight; }
 
     void        Apply(hsTArray<plAccessSpan>& dst, float weight = -1.f) const;
+    void        Accumulate(plMorphAccum& acc, float weight = -1.f) const;
 
     void        ComputeDeltas(const hsTArray<plAccessSpan>& base, const hsTArray<plAccessSpan>& moved);
     void        ComputeDeltas(const hsTArray<plGeometrySpan*>& base, const hsTArray<plGeometrySpan*>& moved, const hsMatrix44& d2b, const hsMatrix44& d2bTInv);
@@ -59,10 +59,19 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plMessage/plRenderMsg.h"
 
 #include "plSharedMesh.h"
+#include "plMorphAccum.h"
 
 #include "plTweak.h"
 #include "hsTimer.h"
 #include "hsFastMath.h"
+#include "hsThread.h"
+#include "plProfile.h"
+
+#include <float.h>
+
+plProfile_CreateTimer("MorphApply", "Animation", MorphApply);
+plProfile_CreateCounter("MorphVerts", "Animation", MorphVerts);
+plProfile_CreateTimer("MorphBatch", "Animation", MorphBatch);
 
 ///////////////////////////////////////////////////////////////////////////
 
@@ -110,6 +119,113 @@ public:
 
 hsTArray<plMorphTarget> fTgtWgts;
 
+// One morph being applied. The mesh is reset and opened and the scratch
+// laid out on the main thread, the layers are summed into the scratch
+// (on a morph thread, if batched), then the sums are added into the mesh
+// and it's closed back on the main thread. Summing only reads the morph
+// data and weights and only writes our own scratch.
+class plMorphJob
+{
+public:
+    plMorphAccum                    fAccum;
+    hsTArray<plAccessSpan>          fDst;
+    const hsTArray<plMorphArray>*   fMorphs;
+    hsTArray<plMorphArrayWeights>*  fWeights;   // nil to use the deltas' own
+    const plMorphSequence*          fOwner;     // nil once done or dropped
+
+    plMorphJob() : fMorphs(nil), fWeights(nil), fOwner(nil) {}
+
+    void Accumulate()
+    {
+        int i;
+        for( i = 0; i < fMorphs->GetCount(); i++ )
+            (*fMorphs)[i].Accumulate(fAccum, fWeights ? &(*fWeights)[i].fDeltaWeights : nil);
+    }
+
+    void Commit()
+    {
+        // Add and renormalize in one go
+        fAccum.Commit(fDst);
+        plProfile_IncCount(MorphVerts, fAccum.GetNumVerts());
+
+        // Close up the access spans
+        plAccessGeometry::Instance()->Close(fDst);
+        fOwner = nil;
+    }
+};
+
+// Morphs are only ever applied from the render message on the main thread.
+// Unbatched, everyone shares one job and its scratch space. A batch needs
+// a job per queued morph; they're kept from frame to frame, so the
+// scratch stops growing after the first few.
+static bool                     sBatching = false;
+static hsTArray<plMorphJob*>    sJobs;
+static int                      sNumQueued = 0;
+
+static plMorphJob& IGetUnbatchedJob()
+{
+    static plMorphJob job;
+    return job;
+}
+
+static plMorphAccum& IGetAccum()
+{
+    return IGetUnbatchedJob().fAccum;
+}
+
+static plMorphJob* IGetJob(const plMorphSequence* owner)
+{
+    plMorphJob* job = &IGetUnbatchedJob();
+    if( sBatching && plMorphSequence::GetNumThreads() )
+    {
+        if( sNumQueued == sJobs.GetCount() )
+            sJobs.Append(new plMorphJob);
+        job = sJobs[sNumQueued];
+    }
+    job->fOwner = owner;
+    return job;
+}
+
+// Queue the job if we're batching, otherwise finish it now.
+static void IRunJob(plMorphJob* job)
+{
+    if( job != &IGetUnbatchedJob() )
+    {
+        sNumQueued++;
+        return;
+    }
+    job->Accumulate();
+    job->Commit();
+}
+
+// Applying again in the same batch resets the mesh, so whatever is still
+// queued for it has to go in first.
+static void IFinishQueued(const plMorphSequence* owner)
+{
+    int i;
+    for( i = 0; i < sNumQueued; i++ )
+    {
+        if( sJobs[i]->fOwner == owner )
+        {
+            sJobs[i]->Accumulate();
+            sJobs[i]->Commit();
+        }
+    }
+}
+
+static void IDropQueued(const plMorphSequence* owner)
+{
+    int i;
+    for( i = 0; i < sNumQueued; i++ )
+    {
+        if( sJobs[i]->fOwner == owner )
+        {
+            plAccessGeometry::Instance()->Close(sJobs[i]->fDst);
+            sJobs[i]->fOwner = nil;
+        }
+    }
+}
+
 plMorphSequence::plMorphSequence()
 :   fMorphFlags(0),
     fMorphSDLMod(nil),
@@ -119,6 +235,7 @@ plMorphSequence::plMorphSequence()
 
 plMorphSequence::~plMorphSequence()
 {
+    IDropQueued(this);
     DeInit();
 }
 
@@ -389,21 +506,6 @@ void plMorphSequence::DeInit()
     }
 }
 
-void plMorphSequence::IRenormalize(hsTArray<plAccessSpan>& dst) const
-{
-    int i;
-    for( i = 0; i < dst.GetCount(); i++ )
-    {
-        hsAssert(dst[i].HasAccessVtx(), "Come on, everyone has vertices");
-        plAccessVtxSpan& accVtx = dst[i].AccessVtx();
-        int j;
-        for( j = 0; j < accVtx.VertCount(); j++ )
-        {
-            hsFastMath::Normalize(accVtx.Normal(j));
-        }
-    }
-}
-
 // MorphSequence - Apply
 void plMorphSequence::Apply() const
 {
@@ -411,25 +513,23 @@ void plMorphSequence::Apply() const
     if( !di )
         return;
 
+    IFinishQueued(this);
+
     // Reset to initial.
     Reset(di);
 
-    // We'll be accumulating into the buffer, so open RW
-    hsTArray<plAccessSpan> dst;
-    plAccessGeometry::Instance()->OpenRW(di, dst);
+    plProfile_BeginTiming(MorphApply);
 
-    // For each MorphArray
-    int i;
-    for( i = 0; i < fMorphs.GetCount(); i++ )
-    {
-        // Apply Delta
-        fMorphs[i].Apply(dst);
-    }
+    // We'll be accumulating into the buffer, so open RW
+    plMorphJob* job = IGetJob(this);
+    plAccessGeometry::Instance()->OpenRW(di, job->fDst);
 
-    IRenormalize(dst);
+    job->fAccum.Begin(job->fDst);
+    job->fMorphs = &fMorphs;
+    job->fWeights = nil;
+    IRunJob(job);
 
-    // Close up the access spans
-    plAccessGeometry::Instance()->Close(dst);
+    plProfile_EndTiming(MorphApply);
 }
 
 // MorphSequence - Reset to initial
@@ -539,6 +639,8 @@ void plMorphSequence::IResetShared()
 
 void plMorphSequence::IApplyShared()
 {
+    IFinishQueued(this);
+
     int i;
     for (i = 0; i < fSharedMeshes.GetCount(); i++)
     {
@@ -571,7 +673,10 @@ void plMorphSequence::IApplyShared(int iShare)
 
     plSharedMeshInfo& mInfo = fSharedMeshes[iShare];
 
-    hsTArray<plAccessSpan> dst;
+    plProfile_BeginTiming(MorphApply);
+
+    plMorphJob* job = IGetJob(this);
+    job->fDst.SetCount(0);
     // Now copy each shared mesh geometryspan into the drawable
     // to get it back to it's pristine condition.
     int i;
@@ -580,21 +685,165 @@ void plMorphSequence::IApplyShared(int iShare)
         plAccessSpan dstAcc;
         plAccessGeometry::Instance()->OpenRW(mInfo.fCurrDraw, mInfo.fCurrIdx[i], dstAcc);
 
-        dst.Append(dstAcc);
+        job->fDst.Append(dstAcc);
     }
 
-    // For each MorphArray
-    for( i = 0; i < mInfo.fMesh->fMorphSet->fMorphs.GetCount(); i++ )
+    job->fAccum.Begin(job->fDst);
+    job->fMorphs = &mInfo.fMesh->fMorphSet->fMorphs;
+    job->fWeights = &mInfo.fArrayWeights;
+    IRunJob(job);
+
+    mInfo.fFlags &= ~plSharedMeshInfo::kInfoDirtyMesh;
+
+    plProfile_EndTiming(MorphApply);
+}
+
+// The renormalize the old Apply path did as a separate pass, kept for Benchmark.
+static void IBenchRenormalize(hsTArray<plAccessSpan>& dst)
+{
+    int i;
+    for( i = 0; i < dst.GetCount(); i++ )
     {
-        // Apply Delta
-        mInfo.fMesh->fMorphSet->fMorphs[i].Apply(dst, &mInfo.fArrayWeights[i].fDeltaWeights);
+        plAccessVtxSpan& accVtx = dst[i].AccessVtx();
+        int j;
+        for( j = 0; j < accVtx.VertCount(); j++ )
+        {
+            hsFastMath::Normalize(accVtx.Normal(j));
+        }
     }
+}
 
-    IRenormalize(dst);
+static void IBenchGrab(hsTArray<plAccessSpan>& dst, hsTArray<hsPoint3>& pos, hsTArray<hsVector3>& norm)
+{
+    pos.SetCount(0);
+    norm.SetCount(0);
+    int i;
+    for( i = 0; i < dst.GetCount(); i++ )
+    {
+        plAccPosNormIterator iter(&dst[i].AccessVtx());
+        for( iter.Begin(); iter.More(); iter.Advance() )
+        {
+            pos.Append(*iter.Position());
+            norm.Append(*iter.Normal());
+        }
+    }
+}
 
-    // Close up the access spans
-    plAccessGeometry::Instance()->Close(dst);
-    mInfo.fFlags &= ~plSharedMeshInfo::kInfoDirtyMesh;
+bool plMorphSequence::IBenchReset(int iShare, hsTArray<plAccessSpan>& dst)
+{
+    dst.SetCount(0);
+    if( iShare >= 0 )
+    {
+        if( !IResetShared(iShare) )
+            return false;
+
+        plSharedMeshInfo& mInfo = fSharedMeshes[iShare];
+        int i;
+        for( i = 0; i < mInfo.fMesh->fSpans.GetCount(); i++ )
+        {
+            plAccessSpan dstAcc;
+            plAccessGeometry::Instance()->OpenRW(mInfo.fCurrDraw, mInfo.fCurrIdx[i], dstAcc);
+
+            dst.Append(dstAcc);
+        }
+        return true;
+    }
+
+    const plDrawInterface* di = IGetDrawInterface();
+    if( !di || !GetHaveSnap() )
+        return false;
+
+    Reset(di);
+    plAccessGeometry::Instance()->OpenRW(di, dst);
+    return true;
+}
+
+bool plMorphSequence::Benchmark(int numPasses, double& oldSecs, double& newSecs, float& maxPosErr, float& maxNormErr, uint32_t& numVerts)
+{
+    oldSecs = newSecs = 0;
+    maxPosErr = maxNormErr = 0;
+    numVerts = 0;
+
+    // Shared meshes morph with their own arrays and weights, bench the first one in use.
+    int iShare = -1;
+    const hsTArray<plMorphArray>* morphs = &fMorphs;
+    if( GetUseSharedMesh() )
+    {
+        int i;
+        for( i = 0; i < fSharedMeshes.GetCount(); i++ )
+        {
+            if( fSharedMeshes[i].fCurrDraw )
+                break;
+        }
+        if( i == fSharedMeshes.GetCount() )
+            return false;
+        iShare = i;
+        morphs = &fSharedMeshes[iShare].fMesh->fMorphSet->fMorphs;
+    }
+
+    hsTArray<plAccessSpan> dst;
+    hsTArray<hsPoint3> oldPos, newPos;
+    hsTArray<hsVector3> oldNorm, newNorm;
+
+    int pass;
+    for( pass = 0; pass < numPasses; pass++ )
+    {
+        if( !IBenchReset(iShare, dst) )
+            return false;
+
+        double start = hsTimer::GetSeconds();
+        int i;
+        for( i = 0; i < morphs->GetCount(); i++ )
+            (*morphs)[i].Apply(dst, iShare >= 0 ? &fSharedMeshes[iShare].fArrayWeights[i].fDeltaWeights : nil);
+        IBenchRenormalize(dst);
+        oldSecs += hsTimer::GetSeconds() - start;
+
+        if( !pass )
+            IBenchGrab(dst, oldPos, oldNorm);
+        plAccessGeometry::Instance()->Close(dst);
+    }
+
+    for( pass = 0; pass < numPasses; pass++ )
+    {
+        if( !IBenchReset(iShare, dst) )
+            return false;
+
+        double start = hsTimer::GetSeconds();
+        plMorphAccum& acc = IGetAccum();
+        acc.Begin(dst);
+        int i;
+        for( i = 0; i < morphs->GetCount(); i++ )
+            (*morphs)[i].Accumulate(acc, iShare >= 0 ? &fSharedMeshes[iShare].fArrayWeights[i].fDeltaWeights : nil);
+        acc.Commit(dst);
+        newSecs += hsTimer::GetSeconds() - start;
+
+        if( !pass )
+            IBenchGrab(dst, newPos, newNorm);
+        plAccessGeometry::Instance()->Close(dst);
+    }
+
+    oldSecs /= numPasses;
+    newSecs /= numPasses;
+
+    // Both passes leave the mesh fully morphed, so there's nothing to restore.
+    numVerts = newPos.GetCount();
+    int i;
+    for( i = 0; i < newPos.GetCount() && i < oldPos.GetCount(); i++ )
+    {
+        hsVector3 del(&newPos[i], &oldPos[i]);
+        float mag = del.Magnitude();
+        if( mag > maxPosErr )
+            maxPosErr = mag;
+
+        del = newNorm[i] - oldNorm[i];
+        mag = del.Magnitude();
+        if( mag > maxNormErr )
+            maxNormErr = mag;
+    }
+    if( oldPos.GetCount() != newPos.GetCount() )
+        maxPosErr = maxNormErr = FLT_MAX;
+
+    return true;
 }
 
 bool plMorphSequence::IResetShared(int iShare)
@@ -820,4 +1069,132 @@ void plMorphSequence::ISetSingleSharedToGlobal(int idx)
     int i;
     for (i = 0; i < fSharedMeshes[fGlobalLayerRef].fArrayWeights[0].fDeltaWeights.GetCount(); i++)
         SetWeight(0, i, fSharedMeshes[fGlobalLayerRef].fArrayWeights[0].fDeltaWeights[i], fSharedMeshes[idx].fMesh->GetKey());
-}
\ No newline at end of file
+}
+//// Batched Morphs ///////////////////////////////////////////////////////////
+// Same arrangement as plSoftwareSkin's threads: started once and left
+// waiting on their start event. Avatars differ a lot in how many verts
+// and layers they morph, so instead of fixed ranges each thread keeps
+// taking the next queued job until there are none left.
+
+static int      sNextJob = 0;
+static hsMutex  sNextJobLock;
+
+static void IAccumulateQueued()
+{
+    for( ;; )
+    {
+        plMorphJob* job;
+        {
+            hsTempMutexLock lock( sNextJobLock );
+            if( sNextJob >= sNumQueued )
+                return;
+            job = sJobs[sNextJob++];
+        }
+        if( job->fOwner )
+            job->Accumulate();
+    }
+}
+
+class plMorphThread : public hsThread
+{
+public:
+    hsEvent     fStartEvent;
+    hsEvent     fDoneEvent;
+
+    virtual hsError Run()
+    {
+        for( ;; )
+        {
+            fStartEvent.Wait();
+            if( GetQuit() )
+                break;
+            IAccumulateQueued();
+            fDoneEvent.Signal();
+        }
+        return hsOK;
+    }
+
+    virtual void Stop()
+    {
+        SetQuit( true );
+        fStartEvent.Signal();
+        hsThread::Stop();
+    }
+};
+
+int plMorphSequence::fNumThreads = 2;
+
+static hsTArray<plMorphThread*> sMorphThreads;
+static hsMutex sMorphThreadLock;
+
+void plMorphSequence::SetNumThreads( int n )
+{
+    hsTempMutexLock lock( sMorphThreadLock );
+    IStopThreads();
+    fNumThreads = n < 0 ? 0 : ( n > kMaxThreads ? kMaxThreads : n );
+}
+
+// Caller holds sMorphThreadLock
+void plMorphSequence::IStartThreads()
+{
+    int i;
+    for( i = sMorphThreads.GetCount(); i < fNumThreads; i++ )
+    {
+        plMorphThread* thread = new plMorphThread;
+        thread->Start();
+        sMorphThreads.Append( thread );
+    }
+}
+
+void plMorphSequence::IStopThreads()
+{
+    hsTempMutexLock lock( sMorphThreadLock );
+    int i;
+    for( i = 0; i < sMorphThreads.GetCount(); i++ )
+    {
+        sMorphThreads[i]->Stop();
+        delete sMorphThreads[i];
+    }
+    sMorphThreads.Reset();
+}
+
+void plMorphSequence::BeginMorphBatch()
+{
+    sBatching = true;
+}
+
+void plMorphSequence::EndMorphBatch()
+{
+    sBatching = false;
+    if( !sNumQueued )
+        return;
+
+    plProfile_BeginTiming(MorphBatch);
+
+    {
+        hsTempMutexLock lock( sMorphThreadLock );
+        IStartThreads();
+
+        sNextJob = 0;
+        int numHelpers = hsMinimum( (int)sMorphThreads.GetCount(), sNumQueued - 1 );
+        int i;
+        for( i = 0; i < numHelpers; i++ )
+            sMorphThreads[i]->fStartEvent.Signal();
+
+        IAccumulateQueued();
+
+        for( i = 0; i < numHelpers; i++ )
+            sMorphThreads[i]->fDoneEvent.Wait();
+    }
+
+    // Into the meshes in the order they were applied.
+    int i;
+    for( i = 0; i < sNumQueued; i++ )
+    {
+        if( sJobs[i]->fOwner )
+            sJobs[i]->Commit();
+    }
+    sNumQueued = 0;
+
+    plProfile_EndTiming(MorphBatch);
+}
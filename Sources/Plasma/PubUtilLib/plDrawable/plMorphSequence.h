@@ -131,13 +131,14 @@ protected:
     bool        IFindIndices(int iShare);
     void        IReleaseIndices(int iShare);
 
-    void        IRenormalize(hsTArray<plAccessSpan>& dst) const;
-
     void        IResetShared();
     void        IReleaseIndices(); // Puts everyone inactive
     void        IFindIndices(); // Refresh Indicies
     void        IApplyShared(); // Apply whatever morphs are active
 
+    // Benchmark helper, iShare < 0 means our own draw interface.
+    bool        IBenchReset(int iShare, hsTArray<plAccessSpan>& dst);
+
     int32_t       IFindPendingStateIndex(plKey meshKey) const; // Do we have pending state for this mesh?
     int32_t       IFindSharedMeshIndex(plKey meshKey) const; // What's this mesh's index in our array?
     bool        IIsUsingDrawable(plDrawable *draw); // Are we actively looking at spans in this drawable?
@@ -169,6 +170,11 @@ public:
     void Apply() const;
     void Reset(const plDrawInterface* di=nil) const;
 
+    // Time the old per-array Apply and renormalize against the accumulate path on
+    // the current weights, leaving the mesh as Apply would. Returns false if there's
+    // nothing active to morph.
+    bool Benchmark(int numPasses, double& oldSecs, double& newSecs, float& maxPosErr, float& maxNormErr, uint32_t& numVerts);
+
     int GetNumLayers(plKey meshKey = nil) const; 
     void AddLayer(const plMorphArray& ma) { fMorphs.Append(ma); }
 
@@ -185,6 +191,30 @@ public:
     void RemoveSharedMesh(plSharedMesh* mesh);
     static void FindMorphMods(const plSceneObject *so, hsTArray<const plMorphSequence*> &mods);
     plMorphSequenceSDLMod *GetSDLMod() const { return fMorphSDLMod; }
+
+    // While a morph batch is open, applying only resets and opens the mesh
+    // and queues up the layers. EndMorphBatch sums the layers of everything
+    // queued on the morph threads, then adds them into the meshes on this
+    // thread. plClient opens one around the plRenderMsg.
+    static void BeginMorphBatch();
+    static void EndMorphBatch();
+
+    enum
+    {
+        kMaxThreads         = 7     // Extra threads, not counting the caller
+    };
+
+    // Extra threads to accumulate batched morphs on, 0 for none. Changing it
+    // (or Shutdown) stops the current threads; new ones start on next use.
+    static void SetNumThreads(int n);
+    static int GetNumThreads() { return fNumThreads; }
+    static void Shutdown() { IStopThreads(); }
+
+protected:
+    static int  fNumThreads;
+
+    static void IStartThreads();
+    static void IStopThreads();
 };
 
 #endif // plMorphSequence_inc
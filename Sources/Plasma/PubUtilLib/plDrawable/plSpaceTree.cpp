@@ -86,6 +86,7 @@ plSpaceTree::plSpaceTree()
     fNumLeaves(0),
     fCache(nil)
 {
+    INewSerial();
 }
 
 plSpaceTree::~plSpaceTree()
@@ -117,10 +118,20 @@ void plSpaceTree::IRefreshRecur(int16_t which)
     }
 }
 
+void plSpaceTree::INewSerial()
+{
+    static uint32_t nextSerial = 0;
+    fSerial = ++nextSerial;
+}
+
 void plSpaceTree::Refresh()
 {
     if( !IsEmpty() )
+    {
+        if( IsDirty() )
+            INewSerial();
         IRefreshRecur(fRoot);
+    }
 }
 
 void plSpaceTree::SetTreeFlag(uint16_t f, bool on)
@@ -297,6 +308,60 @@ void plSpaceTree::HarvestEnabledLeaves(plVolumeIsect* cull, const hsBitVector& c
         IHarvestEnabledLeaves(fRoot, cache, list);
 }
 
+void plSpaceTree::IHarvestAndCullAllLeaves(int16_t subIdx, hsTArray<int16_t>& list) const
+{
+    const plSpaceTreeNode& subRoot = fTree[subIdx];
+
+    plVolumeCullResult res = fCullFunc->Test(subRoot.fWorldBounds);
+    if( res == kVolumeCulled )
+        return;
+
+    if( subRoot.fFlags & plSpaceTreeNode::kIsLeaf )
+    {
+        list.Append(subIdx);
+    }
+    else
+    {
+        if( res == kVolumeClear )
+        {
+            IHarvestAllLeaves(subRoot.fChildren[0], list);
+            IHarvestAllLeaves(subRoot.fChildren[1], list);
+        }
+        else
+        {
+            IHarvestAndCullAllLeaves(subRoot.fChildren[0], list);
+            IHarvestAndCullAllLeaves(subRoot.fChildren[1], list);
+        }
+    }
+}
+
+void plSpaceTree::IHarvestAllLeaves(int16_t subIdx, hsTArray<int16_t>& list) const
+{
+    const plSpaceTreeNode& subRoot = fTree[subIdx];
+
+    if( subRoot.fFlags & plSpaceTreeNode::kIsLeaf )
+    {
+        plProfile_Inc(HarvestLeaves);
+        list.Append(subIdx);
+    }
+    else
+    {
+        IHarvestAllLeaves(subRoot.fChildren[0], list);
+        IHarvestAllLeaves(subRoot.fChildren[1], list);
+    }
+}
+
+void plSpaceTree::HarvestAllLeaves(plVolumeIsect* cull, hsTArray<int16_t>& list) const
+{
+    if( IsEmpty() )
+        return;
+
+    if( fCullFunc = cull )
+        IHarvestAndCullAllLeaves(fRoot, list);
+    else
+        IHarvestAllLeaves(fRoot, list);
+}
+
 void plSpaceTree::IHarvestEnabledLeaves(int16_t subIdx, const hsBitVector& cache, hsBitVector& totList, hsBitVector& list) const
 {
     if( IsDisabled(subIdx) )
@@ -326,6 +391,8 @@ void plSpaceTree::MoveLeaf(int16_t idx, const hsBounds3Ext& bnd)
 
     fTree[idx].fWorldBounds = bnd;
 
+    INewSerial();
+
     while( idx != kRootParent )
     {
         if( fTree[idx].fFlags & plSpaceTreeNode::kDirty )
@@ -554,6 +621,8 @@ void plSpaceTree::Read(hsStream* s, hsResMgr* mgr)
     int i;
     for( i = 0; i < n; i++ )
         fTree[i].Read(s);
+
+    INewSerial();
 }
 
 void plSpaceTree::Write(hsStream* s, hsResMgr* mgr)
@@ -110,7 +110,10 @@ private:
 
     hsPoint3                        fViewPos;
 
+    uint32_t                          fSerial;
+
     void        IRefreshRecur(int16_t which);
+    void        INewSerial();
     
     void        IHarvestAndCullLeaves(const plSpaceTreeNode& subRoot, hsTArray<int16_t>& list) const;
     void        IHarvestLeaves(const plSpaceTreeNode& subRoot, hsTArray<int16_t>& list) const;
@@ -120,6 +123,9 @@ private:
 
     void        IHarvestLevel(int16_t subRoot, int level, int currLevel, hsTArray<int16_t>& list) const;
 
+    void        IHarvestAndCullAllLeaves(int16_t subIdx, hsTArray<int16_t>& list) const;
+    void        IHarvestAllLeaves(int16_t subIdx, hsTArray<int16_t>& list) const;
+
     void        IHarvestAndCullEnabledLeaves(int16_t subRoot, const hsBitVector& cache, hsTArray<int16_t>& list) const;
     void        IHarvestEnabledLeaves(int16_t subRoot, const hsBitVector& cache, hsTArray<int16_t>& list) const;
     void        IHarvestEnabledLeaves(int16_t subIdx, const hsBitVector& cache, hsBitVector& totList, hsBitVector& list) const;
@@ -154,6 +160,9 @@ public:
     void EnableLeaf(int16_t idx, hsBitVector& cache) const;
     void EnableLeaves(const hsTArray<int16_t>& list, hsBitVector& cache) const;
     void HarvestEnabledLeaves(plVolumeIsect* cullFunc, const hsBitVector& cache, hsTArray<int16_t>& list) const;
+    // Same walk (and same order) as HarvestEnabledLeaves with every node enabled. Disabled
+    // flags are ignored too, so HarvestEnabledLeaves with any cache gives a subset of this.
+    void HarvestAllLeaves(plVolumeIsect* cullFunc, hsTArray<int16_t>& list) const;
     void SetCache(const hsBitVector* cache) { fCache = cache; }
 
     void BitVectorToList(hsTArray<int16_t>& list, const hsBitVector& bitVec) const;
@@ -180,6 +189,10 @@ public:
 
     int16_t GetNumLeaves() const { return fNumLeaves; }
 
+    // Changes whenever any bounds in the tree might have, and is never shared by two trees,
+    // so anything cached off the bounds can check it's still good.
+    uint32_t GetSerial() const { return fSerial; }
+
     virtual void Read(hsStream* s, hsResMgr* mgr);
     virtual void Write(hsStream* s, hsResMgr* mgr);
 
@@ -165,6 +165,129 @@ void plSpanInstance::SetLocalToWorld(const hsMatrix44& l2w)
     }
 }
 
+void plSpanInstance::DecodePosDelta(const plSpanEncoding& encoding, uint32_t numVerts, float* delPos) const
+{
+    const float scale = encoding.fPosScale;
+    int i;
+    switch(encoding.fCode & plSpanEncoding::kPosMask)
+    {
+    case plSpanEncoding::kPos888:
+        {
+            const int8_t* pos888 = (const int8_t*)fPosDelta;
+            for( i = 0; i < numVerts; i++ )
+            {
+                delPos[0] = pos888[0] * scale;
+                delPos[1] = pos888[1] * scale;
+                delPos[2] = pos888[2] * scale;
+                pos888 += 3;
+                delPos += 3;
+            }
+        }
+        break;
+    case plSpanEncoding::kPos161616:
+        {
+            const int16_t* pos161616 = (const int16_t*)fPosDelta;
+            for( i = 0; i < numVerts; i++ )
+            {
+                delPos[0] = pos161616[0] * scale;
+                delPos[1] = pos161616[1] * scale;
+                delPos[2] = pos161616[2] * scale;
+                pos161616 += 3;
+                delPos += 3;
+            }
+        }
+        break;
+    case plSpanEncoding::kPos101010:
+        {
+            const uint32_t* pos101010 = (const uint32_t*)fPosDelta;
+            for( i = 0; i < numVerts; i++ )
+            {
+                delPos[0] = int(*pos101010 & 0x3f) * scale;
+                delPos[1] = int((*pos101010 >> 10) & 0x3f) * scale;
+                delPos[2] = int((*pos101010 >> 20) & 0x3f) * scale;
+                pos101010++;
+                delPos += 3;
+            }
+        }
+        break;
+    case plSpanEncoding::kPos008:
+        {
+            const int8_t* pos008 = (const int8_t*)fPosDelta;
+            for( i = 0; i < numVerts; i++ )
+            {
+                delPos[0] = 0;
+                delPos[1] = 0;
+                delPos[2] = *pos008 * scale;
+                pos008++;
+                delPos += 3;
+            }
+        }
+        break;
+    default:
+        memset(delPos, 0, numVerts * 3 * sizeof(float));
+        break;
+    }
+}
+
+void plSpanInstance::DecodeColor(const plSpanEncoding& encoding, uint32_t numVerts, uint8_t* vDst, int colOff, int stride) const
+{
+    if( !fCol )
+        return;
+
+    // Step through the source the same way plSpanInstanceIter does.
+    const uint16_t colStride = ColStrideFromEncoding(encoding);
+    const uint8_t* src = fCol;
+    vDst += colOff;
+    int i;
+    switch(encoding.fCode & plSpanEncoding::kColMask)
+    {
+    case plSpanEncoding::kColA8:
+        for( i = 0; i < numVerts; i++, vDst += stride, src += colStride )
+        {
+            uint32_t* color = (uint32_t*)vDst;
+            *color = (*color & 0x00ffffff) | *src;
+        }
+        break;
+    case plSpanEncoding::kColI8:
+        for( i = 0; i < numVerts; i++, vDst += stride, src += colStride )
+        {
+            uint32_t* color = (uint32_t*)vDst;
+            *color = (*color & 0xff000000)
+                | (*src << 16)
+                | (*src << 8)
+                | (*src << 0);
+        }
+        break;
+    case plSpanEncoding::kColAI88:
+        for( i = 0; i < numVerts; i++, vDst += stride, src += colStride )
+        {
+            const uint16_t ai = *(const uint16_t*)src;
+            const uint32_t col = ai & 0xff;
+            *(uint32_t*)vDst = ((ai & 0xff00) << 24)
+                | (col << 16)
+                | (col << 8)
+                | (col << 0);
+        }
+        break;
+    case plSpanEncoding::kColRGB888:
+        for( i = 0; i < numVerts; i++, vDst += stride, src += colStride )
+        {
+            uint32_t* color = (uint32_t*)vDst;
+            *color = (*color & 0xff000000)
+                | (src[0] << 16)
+                | (src[1] << 8)
+                | (src[2] << 0);
+        }
+        break;
+    case plSpanEncoding::kColARGB8888:
+        for( i = 0; i < numVerts; i++, vDst += stride, src += colStride )
+            *(uint32_t*)vDst = *(const uint32_t*)src;
+        break;
+    default:
+        break;
+    }
+}
+
 void plSpanInstance::Encode(const plSpanEncoding& encoding, uint32_t numVerts, const hsVector3* delPos, const uint32_t* color)
 {
     Alloc(encoding, numVerts);
@@ -154,6 +154,13 @@ public:
     bool HasPosDelta() const { return fPosDelta != nil; }
     bool HasColor() const { return fCol != nil; }
 
+    // Bulk versions of plSpanInstanceIter::DelPos() and Color(), with the switch on
+    // encoding hoisted out of the vertex loop. DecodePosDelta writes numVerts (x,y,z)
+    // float triples into delPos. DecodeColor overwrites the color at vDst + colOff in
+    // each of numVerts vertices stride bytes apart. Results match the iterator exactly.
+    void DecodePosDelta(const plSpanEncoding& encoding, uint32_t numVerts, float* delPos) const;
+    void DecodeColor(const plSpanEncoding& encoding, uint32_t numVerts, uint8_t* vDst, int colOff, int stride) const;
+
     static uint16_t PosStrideFromEncoding(const plSpanEncoding& encoding)
     {
         switch(encoding.fCode & plSpanEncoding::kPosMask)
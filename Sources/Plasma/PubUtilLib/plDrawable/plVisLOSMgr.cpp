@@ -42,7 +42,9 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include "HeadSpin.h"
 #include "hsBounds.h"
+#include "hsCpuID.h"
 #include "hsFastMath.h"
+#include "plProfile.h"
 
 #include "plVisLOSMgr.h"
 
@@ -69,7 +71,234 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plTweak.h"
 
 #include <algorithm>
+#include <cfloat>
 #include <functional>
+#include <map>
+#include <vector>
+
+#ifdef HS_SIMD_INCLUDE
+#  include HS_SIMD_INCLUDE
+#endif
+
+plProfile_CreateTimer("VisLOS", "Draw", VisLOS);
+plProfile_CreateCounter("VisLOSRays", "Draw", VisLOSRays);
+plProfile_CreateCounter("VisLOSTriTests", "Draw", VisLOSTriTests);
+plProfile_CreateCounter("VisLOSCachedTris", "Draw", VisLOSCachedTris);
+
+///////////////////////////////////////////////////////////////////////////
+// Triangle cache
+///////////////////////////////////////////////////////////////////////////
+
+// Local space triangles for each span we've traced against, so repeated
+// queries don't go back through plAccessGeometry for the vertex and
+// index buffers. Volatile spans are re-fetched every time into a scratch
+// entry, since their vertices can change under us.
+class plVisTriCache
+{
+public:
+    enum
+    {
+        kFloatsPerTri   = 12,           // p0, p1, p2, face normal
+        kMaxCachedTris  = 256 * 1024    // Flush everything beyond this
+    };
+
+    class plSpanTris
+    {
+    public:
+        std::vector<float>  fTris;
+        bool                fTwoSided;
+    };
+
+    class plDrawableTris
+    {
+    public:
+        plKey                       fKey;   // Held so the key can't be recycled while cached
+        std::vector<plSpanTris*>    fSpans;
+    };
+
+protected:
+    typedef std::map<plKeyImp*, plDrawableTris*> plDrawableMap;
+
+    plDrawableMap   fDrawables;
+    uint32_t        fNumTris;
+    plSpanTris      fScratch;
+
+    void IFill(plDrawableSpans* dr, uint32_t spanIdx, plSpanTris& tris);
+
+public:
+    plVisTriCache() : fNumTris(0) {}
+    ~plVisTriCache() { Flush(); }
+
+    const plSpanTris& GetSpan(plDrawableSpans* dr, uint32_t spanIdx);
+    void Flush();
+};
+
+void plVisTriCache::IFill(plDrawableSpans* dr, uint32_t spanIdx, plSpanTris& tris)
+{
+    plAccessSpan src;
+    plAccessGeometry::Instance()->OpenRO(dr, spanIdx, src);
+
+    tris.fTwoSided = !!(src.GetMaterial()->GetLayer(0)->GetMiscFlags() & hsGMatState::kMiscTwoSided);
+
+    tris.fTris.resize(src.AccessTri().TriCount() * kFloatsPerTri);
+    float* dst = tris.fTris.empty() ? nil : &tris.fTris[0];
+
+    plAccTriIterator tri(&src.AccessTri());
+    for( tri.Begin(); tri.More(); tri.Advance() )
+    {
+        const hsPoint3& p0 = tri.Position(0);
+        const hsPoint3& p1 = tri.Position(1);
+        const hsPoint3& p2 = tri.Position(2);
+        hsVector3 norm = hsVector3(&p1, &p0) % hsVector3(&p2, &p0);
+
+        dst[0] = p0.fX; dst[1] = p0.fY; dst[2] = p0.fZ;
+        dst[3] = p1.fX; dst[4] = p1.fY; dst[5] = p1.fZ;
+        dst[6] = p2.fX; dst[7] = p2.fY; dst[8] = p2.fZ;
+        dst[9] = norm.fX; dst[10] = norm.fY; dst[11] = norm.fZ;
+        dst += kFloatsPerTri;
+    }
+    plAccessGeometry::Instance()->Close(src);
+}
+
+const plVisTriCache::plSpanTris& plVisTriCache::GetSpan(plDrawableSpans* dr, uint32_t spanIdx)
+{
+    plKeyImp* key = dr->GetKey();
+    if( !key || (dr->GetSpan(spanIdx)->fProps & plSpan::kPropVolatile) )
+    {
+        IFill(dr, spanIdx, fScratch);
+        return fScratch;
+    }
+
+    plDrawableMap::iterator iter = fDrawables.find(key);
+    plDrawableTris* dt;
+    if( iter == fDrawables.end() )
+    {
+        dt = new plDrawableTris;
+        dt->fKey = dr->GetKey();
+        fDrawables[key] = dt;
+    }
+    else
+        dt = iter->second;
+
+    if( spanIdx >= dt->fSpans.size() )
+        dt->fSpans.resize(dr->GetNumSpans(), nil);
+
+    plSpanTris* tris = dt->fSpans[spanIdx];
+    if( !tris )
+    {
+        tris = new plSpanTris;
+        IFill(dr, spanIdx, *tris);
+        dt->fSpans[spanIdx] = tris;
+
+        uint32_t numTris = uint32_t(tris->fTris.size() / kFloatsPerTri);
+        fNumTris += numTris;
+        plProfile_IncCount(VisLOSCachedTris, numTris);
+
+        // Over budget, start over. The span we just built is handed back
+        // through the scratch so the caller still gets valid data.
+        if( fNumTris > kMaxCachedTris )
+        {
+            fScratch = *tris;
+            Flush();
+            return fScratch;
+        }
+    }
+    return *tris;
+}
+
+void plVisTriCache::Flush()
+{
+    plDrawableMap::iterator iter;
+    for( iter = fDrawables.begin(); iter != fDrawables.end(); ++iter )
+    {
+        plDrawableTris* dt = iter->second;
+        int i;
+        for( i = 0; i < dt->fSpans.size(); i++ )
+            delete dt->fSpans[i];
+        delete dt;
+    }
+    fDrawables.clear();
+    fNumTris = 0;
+}
+
+///////////////////////////////////////////////////////////////////////////
+// Packet slab tests
+///////////////////////////////////////////////////////////////////////////
+
+// Test every ray in mask against the box [bmin,bmax]. Returns the mask of
+// rays that hit, with each hitting ray's entry t (clamped to 0 when the
+// ray starts inside) in enter.
+typedef uint32_t(*slab_ptr)(const plVisRayPacket& pkt, uint32_t mask, const float* bmin, const float* bmax, float* enter);
+
+static uint32_t slab_fpu(const plVisRayPacket& pkt, uint32_t mask, const float* bmin, const float* bmax, float* enter)
+{
+    uint32_t hit = 0;
+    int i;
+    for( i = 0; i < plVisRayPacket::kPacketSize; i++ )
+    {
+        if( !(mask & (1 << i)) )
+            continue;
+
+        float tx0 = (bmin[0] - pkt.fFromX[i]) * pkt.fInvDirX[i];
+        float tx1 = (bmax[0] - pkt.fFromX[i]) * pkt.fInvDirX[i];
+        float ty0 = (bmin[1] - pkt.fFromY[i]) * pkt.fInvDirY[i];
+        float ty1 = (bmax[1] - pkt.fFromY[i]) * pkt.fInvDirY[i];
+        float tz0 = (bmin[2] - pkt.fFromZ[i]) * pkt.fInvDirZ[i];
+        float tz1 = (bmax[2] - pkt.fFromZ[i]) * pkt.fInvDirZ[i];
+
+        float tNear = std::max(std::max(std::min(tx0, tx1), std::min(ty0, ty1)), std::max(std::min(tz0, tz1), 0.f));
+        float tFar = std::min(std::min(std::max(tx0, tx1), std::max(ty0, ty1)), std::min(std::max(tz0, tz1), pkt.fMaxT[i]));
+
+        if( tNear <= tFar )
+        {
+            enter[i] = tNear;
+            hit |= 1 << i;
+        }
+    }
+    return hit;
+}
+
+#ifdef HS_SSE1
+static uint32_t slab_sse1(const plVisRayPacket& pkt, uint32_t mask, const float* bmin, const float* bmax, float* enter)
+{
+    __m128 fromX = _mm_loadu_ps(pkt.fFromX);
+    __m128 fromY = _mm_loadu_ps(pkt.fFromY);
+    __m128 fromZ = _mm_loadu_ps(pkt.fFromZ);
+
+    __m128 tx0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bmin[0]), fromX), _mm_loadu_ps(pkt.fInvDirX));
+    __m128 tx1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bmax[0]), fromX), _mm_loadu_ps(pkt.fInvDirX));
+    __m128 ty0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bmin[1]), fromY), _mm_loadu_ps(pkt.fInvDirY));
+    __m128 ty1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bmax[1]), fromY), _mm_loadu_ps(pkt.fInvDirY));
+    __m128 tz0 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bmin[2]), fromZ), _mm_loadu_ps(pkt.fInvDirZ));
+    __m128 tz1 = _mm_mul_ps(_mm_sub_ps(_mm_set1_ps(bmax[2]), fromZ), _mm_loadu_ps(pkt.fInvDirZ));
+
+    __m128 tNear = _mm_max_ps(_mm_max_ps(_mm_min_ps(tx0, tx1), _mm_min_ps(ty0, ty1)),
+                              _mm_max_ps(_mm_min_ps(tz0, tz1), _mm_setzero_ps()));
+    __m128 tFar = _mm_min_ps(_mm_min_ps(_mm_max_ps(tx0, tx1), _mm_max_ps(ty0, ty1)),
+                             _mm_min_ps(_mm_max_ps(tz0, tz1), _mm_loadu_ps(pkt.fMaxT)));
+
+    _mm_storeu_ps(enter, tNear);
+    return uint32_t(_mm_movemask_ps(_mm_cmple_ps(tNear, tFar))) & mask;
+}
+#endif // HS_SSE1
+
+static hsFunctionDispatcher<slab_ptr> slab_test(slab_fpu, slab_sse1);
+
+///////////////////////////////////////////////////////////////////////////
+// plVisLOSMgr
+///////////////////////////////////////////////////////////////////////////
+
+plVisLOSMgr::plVisLOSMgr()
+:   fPageMgr(nil),
+    fPipe(nil),
+    fTriCache(new plVisTriCache)
+{
+}
+
+plVisLOSMgr::~plVisLOSMgr()
+{
+    delete fTriCache;
+}
 
 plVisLOSMgr* plVisLOSMgr::Instance()
 {
@@ -77,41 +306,52 @@ plVisLOSMgr* plVisLOSMgr::Instance()
     return &inst;
 }
 
-bool plVisLOSMgr::ICheckSpaceTreeRecur(plSpaceTree* space, int which, hsTArray<plSpaceHit>& hits)
+void plVisLOSMgr::FlushCache()
+{
+    fTriCache->Flush();
+}
+
+uint32_t plVisLOSMgr::ICheckBound(const plVisRayPacket& pkt, uint32_t mask, const hsBounds3Ext& bnd, float* enter)
+{
+    if( bnd.GetType() != kBoundsNormal )
+        return 0;
+
+    return slab_test.call(pkt, mask, &bnd.GetMins().fX, &bnd.GetMaxs().fX, enter);
+}
+
+void plVisLOSMgr::ICheckSpaceTreeRecur(plSpaceTree* space, int which, const plVisRayPacket& pkt, uint32_t mask, hsTArray<plSpaceHit>& hits)
 {
     const plSpaceTreeNode& node = space->GetNode(which);
 
     if( node.fFlags & plSpaceTreeNode::kDisabled )
-        return false;
+        return;
 
-    float closest;
-    // If it's a hit
-    if( ICheckBound(node.fWorldBounds, closest) )
-    {
-        // If it's a leaf, 
-        if( node.IsLeaf() )
-        {
-            // add it to the list with the closest intersection point,
-            plSpaceHit* hit = hits.Push();
-            hit->fIdx = which;
-            hit->fClosest = closest;
+    float enter[plVisRayPacket::kPacketSize];
+    mask = ICheckBound(pkt, mask, node.fWorldBounds, enter);
+    if( !mask )
+        return;
 
-            return true;
-        }
-        // else recurse on its children
-        else
+    // If it's a leaf, add it to the list along with which rays hit and where
+    // they went in, else recurse on its children with just the rays that made it.
+    if( node.IsLeaf() )
+    {
+        plSpaceHit* hit = hits.Push();
+        hit->fIdx = which;
+        hit->fMask = mask;
+        hit->fClosest = FLT_MAX;
+        int i;
+        for( i = 0; i < plVisRayPacket::kPacketSize; i++ )
         {
-            bool retVal = false;
-            if( ICheckSpaceTreeRecur(space, node.GetChild(0), hits) )
-                retVal = true;
-
-            if( ICheckSpaceTreeRecur(space, node.GetChild(1), hits) )
-                retVal = true;
-
-            return retVal;
+            hit->fEnter[i] = enter[i];
+            if( (mask & (1 << i)) && (enter[i] < hit->fClosest) )
+                hit->fClosest = enter[i];
         }
     }
-    return false;
+    else
+    {
+        ICheckSpaceTreeRecur(space, node.GetChild(0), pkt, mask, hits);
+        ICheckSpaceTreeRecur(space, node.GetChild(1), pkt, mask, hits);
+    }
 }
 
 struct plCompSpaceHit : public std::binary_function<plSpaceHit, plSpaceHit, bool>
@@ -123,15 +363,15 @@ struct plCompSpaceHit : public std::binary_function<plSpaceHit, plSpaceHit, bool
 };
 
 
-bool plVisLOSMgr::ICheckSpaceTree(plSpaceTree* space, hsTArray<plSpaceHit>& hits)
+bool plVisLOSMgr::ICheckSpaceTree(plSpaceTree* space, const plVisRayPacket& pkt, uint32_t mask, hsTArray<plSpaceHit>& hits)
 {
     hits.SetCount(0);
 
     if( space->IsEmpty() )
         return false;
 
-    // Hierarchical search down the tree for bounds intersecting the current ray.
-    bool retVal = ICheckSpaceTreeRecur(space, space->GetRoot(), hits);
+    // Hierarchical search down the tree for bounds intersecting the current rays.
+    ICheckSpaceTreeRecur(space, space->GetRoot(), pkt, mask, hits);
 
     // Now sort them front to back.
     plSpaceHit* begin = hits.AcquireArray();
@@ -139,281 +379,291 @@ bool plVisLOSMgr::ICheckSpaceTree(plSpaceTree* space, hsTArray<plSpaceHit>& hits
 
     std::sort(begin, end, plCompSpaceHit());
 
-    return retVal;
+    return hits.GetCount() > 0;
+}
+
+// Rays from a leaf hit that are still worth following, i.e. that haven't
+// already hit something closer than where they enter this leaf.
+uint32_t plVisLOSMgr::IStillLive(const plVisRayPacket& pkt, const plSpaceHit& hit) const
+{
+    uint32_t live = 0;
+    int i;
+    for( i = 0; i < plVisRayPacket::kPacketSize; i++ )
+    {
+        if( (hit.fMask & (1 << i)) && (hit.fEnter[i] <= pkt.fMaxT[i]) )
+            live |= 1 << i;
+    }
+    return live;
 }
 
-bool plVisLOSMgr::ISetup(const hsPoint3& pStart, const hsPoint3& pEnd)
+void plVisLOSMgr::ISetupPacket(plVisRayPacket& pkt, const hsPoint3* pStart, const hsPoint3* pEnd, plVisHit* hits, int numRays, uint32_t& mask)
 {
-    fCurrFrom = pStart;
-    fCurrTarg = pEnd;
+    // Keep 1/0 out of the slab test. A huge reciprocal puts the slab
+    // boundaries far outside [0,1] just the same.
+    const float kMinDir = 1.e-20f;
+    const float kHugeInv = 1.e30f;
+
+    mask = 0;
+    pkt.fHitMask = 0;
 
-    fMaxDist = hsVector3(&fCurrTarg, &fCurrFrom).Magnitude();
+    int i;
+    for( i = 0; i < plVisRayPacket::kPacketSize; i++ )
+    {
+        // Pad out short packets with copies of the first ray, masked off.
+        int src = i < numRays ? i : 0;
+
+        pkt.fFrom[i] = pStart[src];
+        pkt.fDir[i].Set(&pEnd[src], &pStart[src]);
+        pkt.fLength[i] = pkt.fDir[i].Magnitude();
+        pkt.fHits[i] = &hits[src];
+
+        pkt.fFromX[i] = pkt.fFrom[i].fX;
+        pkt.fFromY[i] = pkt.fFrom[i].fY;
+        pkt.fFromZ[i] = pkt.fFrom[i].fZ;
 
-    const float kMinMaxDist(0);
-    return fMaxDist > kMinMaxDist;
+        const hsVector3& dir = pkt.fDir[i];
+        pkt.fInvDirX[i] = fabs(dir.fX) > kMinDir ? 1.f / dir.fX : (dir.fX < 0 ? -kHugeInv : kHugeInv);
+        pkt.fInvDirY[i] = fabs(dir.fY) > kMinDir ? 1.f / dir.fY : (dir.fY < 0 ? -kHugeInv : kHugeInv);
+        pkt.fInvDirZ[i] = fabs(dir.fZ) > kMinDir ? 1.f / dir.fZ : (dir.fZ < 0 ? -kHugeInv : kHugeInv);
+
+        pkt.fMaxT[i] = 1.f;
+
+        const float kMinMaxDist(0);
+        if( (i < numRays) && (pkt.fLength[i] > kMinMaxDist) )
+            mask |= 1 << i;
+    }
 }
 
-bool plVisLOSMgr::Check(const hsPoint3& pStart, const hsPoint3& pEnd, plVisHit& hit)
+int plVisLOSMgr::CheckBatch(const hsPoint3* pStart, const hsPoint3* pEnd, plVisHit* hits, bool* isHit, int numRays)
 {
-    if( !fPageMgr )
-        return false;
+    int i;
+    for( i = 0; i < numRays; i++ )
+        isHit[i] = false;
 
-    // Setup any internals, like fMaxDist
-    if( !ISetup(pStart, pEnd) )
-        return false;
+    if( !fPageMgr || !fPageMgr->GetSpaceTree() )
+        return 0;
 
-    // Go through the nodes in the PageMgr and find the closest
-    // point of intersection for each scene node. If none are before
-    // pEnd, return false.
-    // Node come out sorted by closest point, front to back
-    static hsTArray<plSpaceHit> hits;
-    if( !ICheckSpaceTree(fPageMgr->GetSpaceTree(), hits) )
-        return false;
+    plProfile_BeginTiming(VisLOS);
+    plProfile_IncCount(VisLOSRays, numRays);
 
-    // In front to back order, check inside each node.
-    // Our max distance can be changing as we do this, because a
-    // face hit will limit how far we need to look. When we hit the
-    // first node with a closest distance < fMaxDist, we're done.
-    bool retVal = false;
+    // Node hits are per packet, but the recursion shares them, so
+    // one list per level.
+    static hsTArray<plSpaceHit> nodeHits;
 
-    int i;
-    for( i = 0; i < hits.GetCount(); i++ )
+    int numHit = 0;
+    int base;
+    for( base = 0; base < numRays; base += plVisRayPacket::kPacketSize )
     {
-        if( hits[i].fClosest > fMaxDist )
-            break;
+        const int numInPkt = std::min(numRays - base, int(plVisRayPacket::kPacketSize));
+
+        plVisRayPacket pkt;
+        uint32_t mask;
+        ISetupPacket(pkt, pStart + base, pEnd + base, hits + base, numInPkt, mask);
+        if( !mask )
+            continue;
 
-        if( ICheckSceneNode(fPageMgr->GetNodes()[hits[i].fIdx], hit)  )
-            retVal = true;
+        // Go through the nodes in the PageMgr front to back. Each ray's max t
+        // shrinks as it hits faces, so nodes beyond every ray's current hit
+        // drop out without being looked into.
+        if( !ICheckSpaceTree(fPageMgr->GetSpaceTree(), pkt, mask, nodeHits) )
+            continue;
+
+        for( i = 0; i < nodeHits.GetCount(); i++ )
+        {
+            uint32_t live = IStillLive(pkt, nodeHits[i]);
+            if( live )
+                ICheckSceneNode(fPageMgr->GetNodes()[nodeHits[i].fIdx], pkt, live);
+        }
+
+        for( i = 0; i < numInPkt; i++ )
+        {
+            if( pkt.fHitMask & (1 << i) )
+            {
+                isHit[base + i] = true;
+                numHit++;
+            }
+        }
     }
 
-    return retVal;
+    plProfile_EndTiming(VisLOS);
+
+    return numHit;
 }
 
-bool plVisLOSMgr::ICheckSceneNode(plSceneNode* node, plVisHit& hit)
+bool plVisLOSMgr::Check(const hsPoint3& pStart, const hsPoint3& pEnd, plVisHit& hit)
+{
+    bool isHit = false;
+    CheckBatch(&pStart, &pEnd, &hit, &isHit, 1);
+    return isHit;
+}
+
+void plVisLOSMgr::ICheckSceneNode(plSceneNode* node, plVisRayPacket& pkt, uint32_t mask)
 {
     static hsTArray<plSpaceHit> hits;
-    if( !ICheckSpaceTree(node->GetSpaceTree(), hits) )
-        return false;
+    if( !ICheckSpaceTree(node->GetSpaceTree(), pkt, mask, hits) )
+        return;
 
-    bool retVal = false;
     int i;
     for( i = 0; i < hits.GetCount(); i++ )
     {
-        if( hits[i].fClosest > fMaxDist )
-            break;
+        uint32_t live = IStillLive(pkt, hits[i]);
+        if( !live )
+            continue;
 
         if( (node->GetDrawPool()[hits[i].fIdx]->GetRenderLevel().Level() > 0)
             && !node->GetDrawPool()[hits[i].fIdx]->GetNativeProperty(plDrawable::kPropHasVisLOS) )
             continue;
 
-        if( ICheckDrawable(node->GetDrawPool()[hits[i].fIdx], hit) )
-            retVal = true;
+        ICheckDrawable(node->GetDrawPool()[hits[i].fIdx], pkt, live);
     }
-
-    return retVal;
 }
 
 
-bool plVisLOSMgr::ICheckDrawable(plDrawable* d, plVisHit& hit)
+void plVisLOSMgr::ICheckDrawable(plDrawable* d, plVisRayPacket& pkt, uint32_t mask)
 {
     plDrawableSpans* ds = plDrawableSpans::ConvertNoRef(d);
     if( !ds )
-        return false;
+        return;
 
     static hsTArray<plSpaceHit> hits;
-    if( !ICheckSpaceTree(ds->GetSpaceTree(), hits) )
-        return false;
+    if( !ICheckSpaceTree(ds->GetSpaceTree(), pkt, mask, hits) )
+        return;
 
     const bool isOpaque = !ds->GetRenderLevel().Level();
 
-    const hsTArray<plSpan *> spans = ds->GetSpanArray();
+    const hsTArray<plSpan *>& spans = ds->GetSpanArray();
 
-    bool retVal = false;
     int i;
     for( i = 0; i < hits.GetCount(); i++ )
     {
-        if( hits[i].fClosest > fMaxDist )
-            break;
+        uint32_t live = IStillLive(pkt, hits[i]);
+        if( !live )
+            continue;
 
         if( isOpaque || (spans[hits[i].fIdx]->fProps & plSpan::kVisLOS) )
-        {
-            if( ICheckSpan(ds, hits[i].fIdx, hit) )
-                retVal = true;
-        }
+            ICheckSpan(ds, hits[i].fIdx, pkt, live);
     }
-
-    return retVal;
 }
 
-bool plVisLOSMgr::ICheckSpan(plDrawableSpans* dr, uint32_t spanIdx, plVisHit& hit)
+void plVisLOSMgr::ICheckSpan(plDrawableSpans* dr, uint32_t spanIdx, plVisRayPacket& pkt, uint32_t mask)
 {
-    if( !(dr->GetSpan(spanIdx)->fTypeMask & plSpan::kIcicleSpan) )
-        return false;
+    const plSpan* span = dr->GetSpan(spanIdx);
+    if( !(span->fTypeMask & plSpan::kIcicleSpan) )
+        return;
 
-    plAccessSpan src;
-    plAccessGeometry::Instance()->OpenRO(dr, spanIdx, src);
+    const plVisTriCache::plSpanTris& tris = fTriCache->GetSpan(dr, spanIdx);
+    const int numTris = int(tris.fTris.size() / plVisTriCache::kFloatsPerTri);
+    if( !numTris )
+        return;
+
+    // We move each ray into local space, look for hits, and convert the closest
+    // we find (if any) back into world space at the end.
+    const int kMaxRays = plVisRayPacket::kPacketSize;
+    hsPoint3 currFrom[kMaxRays];
+    hsVector3 currDir[kMaxRays];
+    float maxDist[kMaxRays];
+    hsPoint3 hitPos[kMaxRays];
+    int rayIdx[kMaxRays];
+    int numLocal = 0;
+
+    int j;
+    for( j = 0; j < kMaxRays; j++ )
+    {
+        if( !(mask & (1 << j)) )
+            continue;
 
-    const bool twoSided = !!(src.GetMaterial()->GetLayer(0)->GetMiscFlags() & hsGMatState::kMiscTwoSided);
+        hsPoint3 worldTarg = pkt.fFrom[j] + pkt.fDir[j] * pkt.fMaxT[j];
+        currFrom[numLocal] = span->fWorldToLocal * pkt.fFrom[j];
+        hsPoint3 currTarg = span->fWorldToLocal * worldTarg;
 
-    bool retVal = false;
+        currDir[numLocal].Set(&currTarg, &currFrom[numLocal]);
+        maxDist[numLocal] = currDir[numLocal].Magnitude();
+        if( maxDist[numLocal] <= 0 )
+            continue;
+        currDir[numLocal] /= maxDist[numLocal];
 
-    // We move into local space, look for hits, and convert the closest we find 
-    // (if any) back into world space at the end.
-    hsPoint3 currFrom = src.GetWorldToLocal() * fCurrFrom;
-    hsPoint3 currTarg = src.GetWorldToLocal() * fCurrTarg;
+        rayIdx[numLocal++] = j;
+    }
+    if( !numLocal )
+        return;
 
-    hsVector3 currDir(&currTarg, &currFrom);
-    float maxDist = currDir.Magnitude();
+    plProfile_IncCount(VisLOSTriTests, numTris * numLocal);
 
-    currDir /= maxDist;
+    uint32_t localHits = 0;
 
-    plAccTriIterator tri(&src.AccessTri());
-    for( tri.Begin(); tri.More(); tri.Advance() )
+    // Triangles on the outside, so each one is loaded once for the whole packet.
+    const float* t = &tris.fTris[0];
+    int i;
+    for( i = 0; i < numTris; i++, t += plVisTriCache::kFloatsPerTri )
     {
-        // Project the current ray onto the tri plane
-        hsVector3 norm = hsVector3(&tri.Position(1), &tri.Position(0)) % hsVector3(&tri.Position(2), &tri.Position(0));
-        float dotNorm = norm.InnerProduct(currDir);
+        const hsPoint3 p0(t[0], t[1], t[2]);
+        const hsPoint3 p1(t[3], t[4], t[5]);
+        const hsPoint3 p2(t[6], t[7], t[8]);
+        const hsVector3 norm(t[9], t[10], t[11]);
 
-        const float kMinDotNorm = 1.e-3f;
-        if( dotNorm >= -kMinDotNorm )
+        for( j = 0; j < numLocal; j++ )
         {
-            if( !twoSided )
+            // Project the current ray onto the tri plane
+            float dotNorm = norm.InnerProduct(currDir[j]);
+
+            const float kMinDotNorm = 1.e-3f;
+            if( dotNorm >= -kMinDotNorm )
+            {
+                if( !tris.fTwoSided )
+                    continue;
+                if( dotNorm <= kMinDotNorm )
+                    continue;
+            }
+            float dist = hsVector3(&p0, &currFrom[j]).InnerProduct(norm);
+            if( dist > 0 )
                 continue;
-            if( dotNorm <= kMinDotNorm )
+            dist /= dotNorm;
+
+            // If the distance from source point to projected point is too long, skip
+            if( dist > maxDist[j] )
                 continue;
-        }
-        float dist = hsVector3(&tri.Position(0), &currFrom).InnerProduct(norm);
-        if( dist > 0 )
-            continue;
-        dist /= dotNorm;
-        hsPoint3 projPt = currFrom;
-        projPt += currDir * dist;
 
-        // If the distance from source point to projected point is too long, skip
-        if( dist > maxDist )
-            continue;
+            hsPoint3 projPt = currFrom[j];
+            projPt += currDir[j] * dist;
 
-        // Find the 3 cross products (v[i+1]-v[i]) X (proj - v[i]) dotted with current ray
-        hsVector3 cross0 = hsVector3(&tri.Position(1), &tri.Position(0)) % hsVector3(&projPt, &tri.Position(0));
-        float dot0 = cross0.InnerProduct(currDir);
+            // Find the 3 cross products (v[i+1]-v[i]) X (proj - v[i]) dotted with current ray
+            hsVector3 cross0 = hsVector3(&p1, &p0) % hsVector3(&projPt, &p0);
+            float dot0 = cross0.InnerProduct(currDir[j]);
 
-        hsVector3 cross1 = hsVector3(&tri.Position(2), &tri.Position(1)) % hsVector3(&projPt, &tri.Position(1));
-        float dot1 = cross1.InnerProduct(currDir);
+            hsVector3 cross1 = hsVector3(&p2, &p1) % hsVector3(&projPt, &p1);
+            float dot1 = cross1.InnerProduct(currDir[j]);
 
-        hsVector3 cross2 = hsVector3(&tri.Position(0), &tri.Position(2)) % hsVector3(&projPt, &tri.Position(2));
-        float dot2 = cross2.InnerProduct(currDir);
+            hsVector3 cross2 = hsVector3(&p0, &p2) % hsVector3(&projPt, &p2);
+            float dot2 = cross2.InnerProduct(currDir[j]);
 
-        // If all 3 are negative, projPt is a hit
-        // If all 3 are positive and we're two sided, projPt is a hit
-        // We've already checked for back facing (when we checked for edge on in projection),
-        // so we'll accept either case here.
-        if( ((dot0 <= 0) && (dot1 <= 0) && (dot2 <= 0))
-            ||((dot0 >= 0) && (dot1 >= 0) && (dot2 >= 0)) )
-        {
-            if( dist < maxDist )
+            // If all 3 are negative, projPt is a hit
+            // If all 3 are positive and we're two sided, projPt is a hit
+            // We've already checked for back facing (when we checked for edge on in projection),
+            // so we'll accept either case here.
+            if( ((dot0 <= 0) && (dot1 <= 0) && (dot2 <= 0))
+                ||((dot0 >= 0) && (dot1 >= 0) && (dot2 >= 0)) )
             {
-                maxDist = dist;
-                hit.fPos = projPt;
-                retVal = true;
+                if( dist < maxDist[j] )
+                {
+                    maxDist[j] = dist;
+                    hitPos[j] = projPt;
+                    localHits |= 1 << j;
+                }
             }
         }
     }
-    plAccessGeometry::Instance()->Close(src);
 
-    if( retVal )
+    for( j = 0; j < numLocal; j++ )
     {
-        hit.fPos = src.GetLocalToWorld() * hit.fPos;
-        fCurrTarg = hit.fPos;
-        fMaxDist = hsVector3(&fCurrTarg, &fCurrFrom).Magnitude();
-    }
-
-    return retVal;
-}
-
-bool plVisLOSMgr::ICheckBound(const hsBounds3Ext& bnd, float& closest)
-{
-    if( bnd.GetType() != kBoundsNormal )
-        return false;
-
-    if( bnd.IsInside(&fCurrFrom) || bnd.IsInside(&fCurrTarg) )
-    {
-        closest = 0;
-        return true;
-    }
-
-    const int face[6][4] =
-    {
-        {0,1,3,2},
-        {1,5,7,3},
-        {2,3,7,6},
-        {5,4,6,7},
-        {0,4,5,1},
-        {0,2,6,4}
-    };
-
-    hsPoint3 corn[8];
-    bnd.GetCorners(corn);
-
-    bool retVal = false;
-
-    const hsPoint3& currFrom = fCurrFrom;
-    const hsPoint3& currTarg = fCurrTarg;
-
-    hsVector3 currDir(&currTarg, &currFrom);
-    const float maxDistSq = currDir.MagnitudeSquared();
-
-    currDir *= hsFastMath::InvSqrt(maxDistSq);
-
-    int i;
-    for( i = 0; i < 6; i++ )
-    {
-        const hsPoint3& p0 = corn[face[i][0]];
-        const hsPoint3& p1 = corn[face[i][1]];
-        const hsPoint3& p2 = corn[face[i][2]];
-        const hsPoint3& p3 = corn[face[i][3]];
-
-        // Project the current ray onto the tri plane
-        hsVector3 norm = hsVector3(&p1, &p0) % hsVector3(&p2, &p0);
-        float dotNorm = norm.InnerProduct(currDir);
-
-        const float kMinDotNorm = 1.e-3f;
-        if( dotNorm >= -kMinDotNorm )
-        {
-            continue;
-        }
-        float dist = hsVector3(&p0, &currFrom).InnerProduct(norm);
-        if( dist >= 0 )
+        if( !(localHits & (1 << j)) )
             continue;
-        dist /= dotNorm;
-
-        // If the distance from source point to projected point is too long, skip
-        if( dist > fMaxDist )
-            continue;
-
-        hsPoint3 projPt = currFrom;
-        projPt += currDir * dist;
 
-        // Find the 3 cross products (v[i+1]-v[i]) X (proj - v[i]) dotted with current ray
-        hsVector3 cross0 = hsVector3(&p1, &p0) % hsVector3(&projPt, &p0);
-        float dot0 = cross0.InnerProduct(currDir);
-
-        hsVector3 cross1 = hsVector3(&p2, &p1) % hsVector3(&projPt, &p1);
-        float dot1 = cross1.InnerProduct(currDir);
-
-        hsVector3 cross2 = hsVector3(&p3, &p2) % hsVector3(&projPt, &p2);
-        float dot2 = cross2.InnerProduct(currDir);
-
-        hsVector3 cross3 = hsVector3(&p0, &p3) % hsVector3(&projPt, &p3);
-        float dot3 = cross3.InnerProduct(currDir);
-
-        // If all 4 are negative, projPt is a hit
-        if( (dot0 <= 0) && (dot1 <= 0) && (dot2 <= 0) && (dot3 <= 0) )
-        {
-            closest = dist;
-            return true;
-        }
+        const int r = rayIdx[j];
+        plVisHit* hit = pkt.fHits[r];
+        hit->fPos = span->fLocalToWorld * hitPos[j];
+        pkt.fMaxT[r] = hsVector3(&hit->fPos, &pkt.fFrom[r]).Magnitude() / pkt.fLength[r];
+        pkt.fHitMask |= 1 << r;
     }
-    return false;
 }
 
 bool plVisLOSMgr::CursorCheck(plVisHit& hit)
@@ -61,40 +61,80 @@ public:
     hsPoint3        fPos;
 };
 
+// A bundle of up to kPacketSize rays traced together. Rays are stored as
+// segments (from, from + fDir), with t in [0,1] along the segment, so a
+// single slab test against a node bound serves every ray in the packet.
+class plVisRayPacket
+{
+public:
+    enum { kPacketSize = 4 };
+
+    float       fFromX[kPacketSize];
+    float       fFromY[kPacketSize];
+    float       fFromZ[kPacketSize];
+    float       fInvDirX[kPacketSize];
+    float       fInvDirY[kPacketSize];
+    float       fInvDirZ[kPacketSize];
+    float       fMaxT[kPacketSize];         // Shrinks as hits are found
+
+    hsPoint3    fFrom[kPacketSize];
+    hsVector3   fDir[kPacketSize];
+    float       fLength[kPacketSize];
+
+    plVisHit*   fHits[kPacketSize];
+    uint32_t    fHitMask;
+};
+
 class plSpaceHit
 {
 public:
     int         fIdx;
-    float    fClosest;
+    float       fClosest;                   // Smallest entry t of any ray in fMask
+    uint32_t    fMask;                      // Which rays of the packet hit this leaf
+    float       fEnter[plVisRayPacket::kPacketSize];
 };
 
+class plVisTriCache;
+
 class plVisLOSMgr
 {
 protected:
     plPageTreeMgr*  fPageMgr;
     plPipeline*     fPipe;
 
-    float        fMaxDist;
+    plVisTriCache*  fTriCache;
 
-    hsPoint3        fCurrFrom;
-    hsPoint3        fCurrTarg;
+    void ISetupPacket(plVisRayPacket& pkt, const hsPoint3* pStart, const hsPoint3* pEnd, plVisHit* hits, int numRays, uint32_t& mask);
+    uint32_t ICheckBound(const plVisRayPacket& pkt, uint32_t mask, const hsBounds3Ext& bnd, float* enter);
+    void ICheckSpaceTreeRecur(plSpaceTree* space, int which, const plVisRayPacket& pkt, uint32_t mask, hsTArray<plSpaceHit>& hits);
+    bool ICheckSpaceTree(plSpaceTree* space, const plVisRayPacket& pkt, uint32_t mask, hsTArray<plSpaceHit>& hits);
+    uint32_t IStillLive(const plVisRayPacket& pkt, const plSpaceHit& hit) const;
+    void ICheckSceneNode(plSceneNode* node, plVisRayPacket& pkt, uint32_t mask);
+    void ICheckDrawable(plDrawable* d, plVisRayPacket& pkt, uint32_t mask);
+    void ICheckSpan(plDrawableSpans* dr, uint32_t spanIdx, plVisRayPacket& pkt, uint32_t mask);
 
-    bool ISetup(const hsPoint3& pStart, const hsPoint3& pEnd);
-    bool ICheckBound(const hsBounds3Ext& bnd, float& closest);
-    bool ICheckSpaceTreeRecur(plSpaceTree* space, int which, hsTArray<plSpaceHit>& hits);
-    bool ICheckSpaceTree(plSpaceTree* space, hsTArray<plSpaceHit>& hits);
-    bool ICheckSceneNode(plSceneNode* node, plVisHit& hit);
-    bool ICheckDrawable(plDrawable* d, plVisHit& hit);
-    bool ICheckSpan(plDrawableSpans* dr, uint32_t spanIdx, plVisHit& hit);
+    plVisLOSMgr();
     
 public:
+    ~plVisLOSMgr();
+
     bool Check(const hsPoint3& pStart, const hsPoint3& pEnd, plVisHit& hit);
     bool CursorCheck(plVisHit& hit);
 
+    // Trace numRays segments at once. isHit[i] and hits[i] are filled in for
+    // each ray; returns the number of rays that hit something. Rays are traced
+    // in packets, so batching rays with similar origins and directions (camera
+    // probes, a cursor pick and its neighbors) pays off the most.
+    int CheckBatch(const hsPoint3* pStart, const hsPoint3* pEnd, plVisHit* hits, bool* isHit, int numRays);
+
+    // Drop all cached span triangles. Called on DeInit, and should be called if
+    // static geometry is ever rewritten in place.
+    void FlushCache();
+
     static plVisLOSMgr* Instance();
 
     static void Init(plPipeline* pipe, plPageTreeMgr* mgr) { Instance()->fPipe = pipe; Instance()->fPageMgr = mgr; }
-    static void DeInit() { Instance()->fPipe = nil; Instance()->fPageMgr = nil; }
+    static void DeInit() { Instance()->FlushCache(); Instance()->fPipe = nil; Instance()->fPageMgr = nil; }
 };
 
 #endif // plVisLOSMgr_inc
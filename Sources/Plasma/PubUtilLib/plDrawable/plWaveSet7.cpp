@@ -43,6 +43,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "HeadSpin.h"
 #include "hsFastMath.h"
 #include "hsTimer.h"
+#include "hsThread.h"
 
 #include "plWaveSet7.h"
 #include "plWaveSetShaderConsts.h"
@@ -110,6 +111,12 @@ using namespace plShaderID;
 ///////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////
 
+#include <vector>
+
+#ifdef HS_SIMD_INCLUDE
+#  include HS_SIMD_INCLUDE
+#endif
+
 #define TEST_ENVSPH
 
 // #define TEST_UVWS
@@ -263,6 +270,189 @@ void plWaveSet7::StopLog()
 #endif // PLASMA_EXTERNAL_RELEASE
 
 
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// The wave update thread. One thread is shared by all the wavesets, it runs their per frame
+// wave state updates in the order they were queued. It's started when the first waveset
+// queues an update and stopped when the last waveset that used it goes away.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class plWaveUpdateThread : public hsThread
+{
+protected:
+    hsTArray<plWaveSet7*>   fQueue;
+    plWaveSet7*             fBusy;
+    hsMutex                 fCritSect;
+    hsEvent                 fWorkEvent;
+    hsEvent                 fDoneEvent;
+    bool                    fRunning;
+
+    static plWaveUpdateThread*  fInstance;
+    static int                  fNumUsers;
+
+public:
+    plWaveUpdateThread() : fBusy(nil), fRunning(false) {}
+
+    virtual hsError Run();
+
+    virtual void Start() {
+        fRunning = true;
+        hsThread::Start();
+    }
+
+    virtual void Stop() {
+        fRunning = false;
+        fWorkEvent.Signal();
+        hsThread::Stop();
+    }
+
+    void Queue(plWaveSet7* waveSet);
+    void Finish(plWaveSet7* waveSet);
+
+    static plWaveUpdateThread* Instance() { return fInstance; }
+    static plWaveUpdateThread* Acquire();
+    static void Release();
+};
+
+plWaveUpdateThread* plWaveUpdateThread::fInstance = nil;
+int plWaveUpdateThread::fNumUsers = 0;
+
+hsError plWaveUpdateThread::Run()
+{
+    while( fRunning )
+    {
+        fCritSect.Lock();
+        if( fQueue.GetCount() )
+        {
+            fBusy = fQueue[0];
+            fQueue.Remove(0);
+        }
+        plWaveSet7* waveSet = fBusy;
+        fCritSect.Unlock();
+
+        if( !waveSet )
+        {
+            fWorkEvent.Wait();
+            continue;
+        }
+
+        waveSet->IRunUpdate(waveSet->fSimDel);
+
+        fCritSect.Lock();
+        fBusy = nil;
+        fCritSect.Unlock();
+
+        fDoneEvent.Signal();
+    }
+    return hsOK;
+}
+
+void plWaveUpdateThread::Queue(plWaveSet7* waveSet)
+{
+    fCritSect.Lock();
+    fQueue.Append(waveSet);
+    fCritSect.Unlock();
+
+    fWorkEvent.Signal();
+}
+
+// Block until the waveset's update (if any) is done. The done event fires for every
+// finished update, so just keep checking until it's ours.
+void plWaveUpdateThread::Finish(plWaveSet7* waveSet)
+{
+    for( ;; )
+    {
+        fCritSect.Lock();
+        bool pending = (fBusy == waveSet) || (fQueue.Find(waveSet) != fQueue.kMissingIndex);
+        fCritSect.Unlock();
+
+        if( !pending )
+            return;
+
+        fDoneEvent.Wait();
+    }
+}
+
+plWaveUpdateThread* plWaveUpdateThread::Acquire()
+{
+    if( !fNumUsers++ )
+    {
+        fInstance = new plWaveUpdateThread;
+        fInstance->Start();
+    }
+    return fInstance;
+}
+
+void plWaveUpdateThread::Release()
+{
+    hsAssert(fNumUsers > 0, "Unbalanced wave update thread release");
+    if( !--fNumUsers )
+    {
+        fInstance->Stop();
+        delete fInstance;
+        fInstance = nil;
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Shore texture cache. The graph, bubble and edge textures are rebuilt every time an age with
+// water loads, but they only depend on a few state values (and, for the bubbles, on where the
+// random holes landed). So hang on to the pixels and copy them back in when they're asked for
+// again with the same settings.
+///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+class plShoreTexCacheEntry
+{
+public:
+    enum {
+        kMaxKey = 12
+    };
+
+    plShoreTexCacheEntry() : fRef(0), fNumKey(0) {}
+
+    uint32_t                fRef;
+    int                     fNumKey;
+    float                   fKey[kMaxKey];
+    std::vector<uint32_t>   fPixels;
+
+    bool Matches(uint32_t ref, const float* key, int numKey) const
+    {
+        if( (fRef != ref) || (fNumKey != numKey) )
+            return false;
+        int i;
+        for( i = 0; i < numKey; i++ )
+        {
+            if( fKey[i] != key[i] )
+                return false;
+        }
+        return true;
+    }
+};
+
+enum {
+    kMaxShoreTexCache = 8
+};
+static plShoreTexCacheEntry gShoreTexCache[kMaxShoreTexCache];
+static int gNextShoreTexCache = 0;
+
+bool plWaveSet7::fThreadedUpdate = true;
+bool plWaveSet7::fCacheShoreTex = true;
+
+void plWaveSet7::SetCacheShoreTex(bool on)
+{
+    fCacheShoreTex = on;
+    if( !on )
+        FlushShoreTexCache();
+}
+
+void plWaveSet7::FlushShoreTexCache()
+{
+    int i;
+    for( i = 0; i < kMaxShoreTexCache; i++ )
+    {
+        gShoreTexCache[i].fNumKey = 0;
+        std::vector<uint32_t>().swap(gShoreTexCache[i].fPixels);
+    }
+    gNextShoreTexCache = 0;
+}
+
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 // Enough of that, WaveSet (system manager) follows
 ///////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -301,6 +491,12 @@ plWaveSet7::plWaveSet7()
     fTexTransCountDown(0),
     fTexTransDel(0),
 
+    fSimDel(0),
+    fUpdateQueued(false),
+    fUsingUpdateThread(false),
+    fWasVisible(false),
+    fLastGraph(0),
+
     fStatusLog(nil),
     fStatusGraph(nil)
 {
@@ -348,6 +544,12 @@ plWaveSet7::plWaveSet7()
 
 plWaveSet7::~plWaveSet7()
 {
+    if( fUsingUpdateThread )
+    {
+        IWaitForUpdate();
+        plWaveUpdateThread::Release();
+    }
+
     delete fStatusLog;
 
     delete fBumpReqMsg;
@@ -368,6 +570,7 @@ void plWaveSet7::Read(hsStream* stream, hsResMgr* mgr)
     fMaxLen = stream->ReadLEScalar();
 
     fState.Read(stream);
+    fSimState = fState;
     IUpdateWindDir(0);
 
     int n = stream->ReadLE32();
@@ -431,6 +634,10 @@ void plWaveSet7::Write(hsStream* stream, hsResMgr* mgr)
 
 bool plWaveSet7::MsgReceive(plMessage* msg)
 {
+    // Nothing below may touch the wave state while the update thread owns it.
+    if( fUpdateQueued )
+        IWaitForUpdate();
+
     plEvalMsg* update = plEvalMsg::ConvertNoRef(msg);
     if( update )
     {
@@ -462,31 +669,47 @@ bool plWaveSet7::MsgReceive(plMessage* msg)
         IUpdateWindDir(dt);
 
         IFloatBuoys(dt);
+
+        // The buoys were the last to look at the waves this frame, so if we're likely
+        // to be drawn, get the render's wave update going now.
+        if( fWasVisible && fThreadedUpdate )
+            IQueueUpdate();
         return true;
     }
 
     plRenderMsg* rend = plRenderMsg::ConvertNoRef(msg);
     if( rend )
     {
-        if( !IAnyBoundsVisible(rend->Pipeline()) )
+        fWasVisible = IAnyBoundsVisible(rend->Pipeline());
+        if( !fWasVisible )
+        {
+            // We started an update on the strength of last frame, the time it covered is spent.
+            if( fUpdateQueued )
+            {
+                fUpdateQueued = false;
+                fLastTime = fCurrTime;
+            }
             return true;
+        }
 
-        fCurrTime = hsTimer::GetSysSeconds();
-        // Can't just use GetDelSysSeconds() or else we lose time if we skip a frame render because of high FPS.
-        float dt = fLastTime > 0 ? float(fCurrTime - fLastTime) : hsTimer::GetDelSysSeconds();
-        if( dt > kTimeClamp )
-            dt = kTimeClamp;
+        if( fUpdateQueued )
+        {
+            fUpdateQueued = false;
+        }
+        else
+        {
+            fSimDel = IGetUpdateDel();
+            IBeginUpdate();
+            IRunUpdate(fSimDel);
+        }
 
         IUpdateRefObject();
 
-        IUpdateLayers(dt);
-
-        IUpdateWaves(dt);
+        IUpdateLayers();
 
         hsMatrix44 l2w;
         hsMatrix44 w2l;
         IUpdateShaders(rend->Pipeline(), l2w, w2l);
-        IUpdateGraphShaders(rend->Pipeline(), dt);
 
         fLastTime = fCurrTime;
         return true;
@@ -763,12 +986,21 @@ void plWaveSet7::SetState(const plFixedWaterState7& state, float dur)
     }
 }
 
-void plWaveSet7::IUpdateWaves(float dt)
+float plWaveSet7::IGetUpdateDel()
 {
-    ITransition(dt);
-    ITransTex(dt);
-    ICalcScale();
-    fScrunchLen = 1.e33f;
+    fCurrTime = hsTimer::GetSysSeconds();
+    // Can't just use GetDelSysSeconds() or else we lose time if we skip a frame render because of high FPS.
+    float dt = fLastTime > 0 ? float(fCurrTime - fLastTime) : hsTimer::GetDelSysSeconds();
+    if( dt > kTimeClamp )
+        dt = kTimeClamp;
+    return dt;
+}
+
+// Main thread half of the update. Snapshot the state the update reads, and
+// take care of anything that has to create resources.
+void plWaveSet7::IBeginUpdate()
+{
+    fSimState = fState;
 
     if( fTrialUpdate & kReInitWaves )
     {
@@ -776,6 +1008,49 @@ void plWaveSet7::IUpdateWaves(float dt)
         ISetupTextureWaves();
         ICreateBumpMipmapPS();
     }
+}
+
+void plWaveSet7::IQueueUpdate()
+{
+    if( fUpdateQueued )
+        return;
+
+    if( !fUsingUpdateThread )
+    {
+        plWaveUpdateThread::Acquire();
+        fUsingUpdateThread = true;
+    }
+
+    fSimDel = IGetUpdateDel();
+    IBeginUpdate();
+
+    fUpdateQueued = true;
+    plWaveUpdateThread::Instance()->Queue(this);
+}
+
+void plWaveSet7::IWaitForUpdate()
+{
+    if( fUsingUpdateThread )
+        plWaveUpdateThread::Instance()->Finish(this);
+}
+
+// Everything here only touches the wave, texture wave and graph states, the graph
+// shaders and fRand, and reads fSimState and fWindDir. Safe on the update thread.
+void plWaveSet7::IRunUpdate(float dt)
+{
+    IUpdateTexWaves(dt);
+
+    IUpdateWaves(dt);
+
+    IUpdateGraphShaders(dt);
+}
+
+void plWaveSet7::IUpdateWaves(float dt)
+{
+    ITransition(dt);
+    ITransTex(dt);
+    ICalcScale();
+    fScrunchLen = 1.e33f;
 
     int i;
     for( i = 0; i < kNumWaves; i++ )
@@ -910,14 +1185,12 @@ void plWaveSet7::IUpdateWave(float dt, int i)
 
     float len = FreqToLen(wave.fFreq);
 
-    float speed = hsFastMath::InvSqrtAppr(len / (2.f * M_PI * kGravConst));
-
     static float speedHack = 1.f;
-    speed *= speedHack;
+    float speed = fWaveSpeed[i] * speedHack;
     wave.fPhase += speed * dt;
 //  wave.fPhase = fmod( speed * t, 2.f * M_PI);
 
-    float amp = GeoState().fAmpOverLen * len / float(kNumWaves);
+    float amp = fSimState.fGeoState.fAmpOverLen * len / float(kNumWaves);
 
     amp *= fFreqMod[i] * fFreqScale;
 
@@ -941,13 +1214,16 @@ void plWaveSet7::IReInitWaves()
 void plWaveSet7::IInitWave(int i)
 {
     plWorldWave7& wave = fWorldWaves[i];
+    const plFixedWaterState7::WaveState& geoState = fSimState.fGeoState;
 
-    wave.fLength = GeoState().fMinLength + fRand.RandZeroToOne() * (GeoState().fMaxLength - GeoState().fMinLength);
+    wave.fLength = geoState.fMinLength + fRand.RandZeroToOne() * (geoState.fMaxLength - geoState.fMinLength);
 
     float len = wave.fLength;
 
     wave.fFreq = LenToFreq(len);
 
+    fWaveSpeed[i] = hsFastMath::InvSqrtAppr(FreqToLen(wave.fFreq) / (2.f * M_PI * kGravConst));
+
     wave.fPhase = 0;
 
     wave.fAmplitude = 0;
@@ -959,7 +1235,7 @@ void plWaveSet7::IInitWave(int i)
     plConst(float) kMaxRotDeg(180.f);
     hsVector3 dir = fWindDir;
 
-    float rotBase = GeoState().fAngleDev;
+    float rotBase = geoState.fAngleDev;
 
     float rads = rotBase * fRand.RandMinusOneToOne();
     float rx = float(cosf(rads));
@@ -1324,6 +1600,7 @@ void plWaveSet7::IInitState()
     state.fEnvRefresh = 0.f;
 
     fState = state;
+    fSimState = state;
 
     IUpdateWindDir(0);
 }
@@ -1404,7 +1681,9 @@ void plWaveSet7::ISetupTextureWaves()
 
 void plWaveSet7::IInitTexWave(int i)
 {
-    float rads = fRand.RandMinusOneToOne() * TexState().fAngleDev;
+    const plFixedWaterState7::WaveState& texState = fSimState.fTexState;
+
+    float rads = fRand.RandMinusOneToOne() * texState.fAngleDev;
     float dx = sin(rads);
     float dy = cos(rads);
 
@@ -1413,8 +1692,8 @@ void plWaveSet7::IInitTexWave(int i)
     dx = fWindDir.fY * dx - fWindDir.fX * dy;
     dy = fWindDir.fX * tx + fWindDir.fY * dy;
 
-    float maxLen = TexState().fMaxLength * kCompositeSize / State().fRippleScale;
-    float minLen = TexState().fMinLength * kCompositeSize / State().fRippleScale;
+    float maxLen = texState.fMaxLength * kCompositeSize / fSimState.fRippleScale;
+    float minLen = texState.fMinLength * kCompositeSize / fSimState.fRippleScale;
     float len = float(i) / float(kNumTexWaves-1) * (maxLen - minLen) + minLen;
 
     float reps = float(kCompositeSize) / len;
@@ -1430,8 +1709,9 @@ void plWaveSet7::IInitTexWave(int i)
     float effK = hsFastMath::InvSqrt(dx*dx + dy*dy);
     fTexWaves[i].fLen = float(kCompositeSize) * effK;
     fTexWaves[i].fFreq = M_PI * 2.f / fTexWaves[i].fLen;
-    fTexWaves[i].fAmp = fTexWaves[i].fLen * TexState().fAmpOverLen;
+    fTexWaves[i].fAmp = fTexWaves[i].fLen * texState.fAmpOverLen;
     fTexWaves[i].fPhase = fRand.RandZeroToOne();
+    fTexWaveSpeed[i] = hsFastMath::InvSqrtAppr(fTexWaves[i].fLen / (2.f * M_PI * kGravConst));
     
     fTexWaves[i].fDirX = dx * effK;
     fTexWaves[i].fDirY = dy * effK;
@@ -1469,23 +1749,30 @@ void plWaveSet7::RemoveDynaDecalMgr(plKey& key)
 //////////////////////////////////////////////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////////////////////
 
-void plWaveSet7::IUpdateLayers(float dt)
+void plWaveSet7::IUpdateLayers()
 {
-    IUpdateBumpLayers(dt);
+    IUpdateBumpLayers();
 
     ISubmitRenderRequests();
 }
 
-void plWaveSet7::IUpdateBumpLayers(float dt)
+void plWaveSet7::IUpdateTexWaves(float dt)
 {
     plCONST(float) speedHack(1.f / 3.f);
     int i;
     for( i = 0; i < kNumTexWaves; i++ )
     {
-        float speed = hsFastMath::InvSqrtAppr(fTexWaves[i].fLen / (2.f * M_PI * kGravConst)) * speedHack;
+        float speed = fTexWaveSpeed[i] * speedHack;
         fTexWaves[i].fPhase -= dt * speed;
         fTexWaves[i].fPhase -= int(fTexWaves[i].fPhase);
+    }
+}
 
+void plWaveSet7::IUpdateBumpLayers()
+{
+    int i;
+    for( i = 0; i < kNumTexWaves; i++ )
+    {
         if( fBumpLayers[i] )
         {
             hsMatrix44 xfm = fBumpLayers[i]->GetTransform();
@@ -3722,6 +4009,94 @@ plMipmap* plWaveSet7::ICreateBlankTex(const char* name, int width, int height, u
     return mipMap;
 }
 
+int plWaveSet7::IGetShoreTexKey(const plMipmap* mipMap, uint32_t ref, float* key) const
+{
+    int n = 0;
+    key[n++] = float(mipMap->GetWidth());
+    key[n++] = float(mipMap->GetHeight());
+    switch( ref )
+    {
+    case kRefBubbleShoreTex:
+        {
+            const hsColorRGBA maxColor = State().fMaxColor;
+            const hsColorRGBA minColor = State().fMinColor;
+            key[n++] = State().fWispiness;
+            key[n++] = maxColor.r;
+            key[n++] = maxColor.g;
+            key[n++] = maxColor.b;
+            key[n++] = maxColor.a;
+            key[n++] = minColor.r;
+            key[n++] = minColor.g;
+            key[n++] = minColor.b;
+            key[n++] = minColor.a;
+        }
+        break;
+    case kRefEdgeShoreTex:
+        key[n++] = State().fEdgeRadius;
+        key[n++] = State().fEdgeOpac;
+        break;
+    }
+    hsAssert(n <= plShoreTexCacheEntry::kMaxKey, "Shore texture key overflow");
+    return n;
+}
+
+bool plWaveSet7::IFetchShoreTex(plMipmap* mipMap, uint32_t ref) const
+{
+    if( !fCacheShoreTex )
+        return false;
+
+    float key[plShoreTexCacheEntry::kMaxKey];
+    const int numKey = IGetShoreTexKey(mipMap, ref, key);
+    const size_t numTexels = size_t(mipMap->GetWidth()) * mipMap->GetHeight();
+
+    int i;
+    for( i = 0; i < kMaxShoreTexCache; i++ )
+    {
+        const plShoreTexCacheEntry& entry = gShoreTexCache[i];
+        if( entry.Matches(ref, key, numKey) && (entry.fPixels.size() == numTexels) )
+        {
+            memcpy(mipMap->GetAddr32(0,0), &entry.fPixels[0], numTexels * sizeof(uint32_t));
+            mipMap->MakeDirty();
+            return true;
+        }
+    }
+    return false;
+}
+
+void plWaveSet7::IStoreShoreTex(const plMipmap* mipMap, uint32_t ref) const
+{
+    if( !fCacheShoreTex )
+        return;
+
+    float key[plShoreTexCacheEntry::kMaxKey];
+    const int numKey = IGetShoreTexKey(mipMap, ref, key);
+
+    // Replace our old pixels if we're a remake, else take the oldest slot.
+    plShoreTexCacheEntry* entry = nil;
+    int i;
+    for( i = 0; i < kMaxShoreTexCache; i++ )
+    {
+        if( gShoreTexCache[i].Matches(ref, key, numKey) )
+        {
+            entry = &gShoreTexCache[i];
+            break;
+        }
+    }
+    if( !entry )
+    {
+        entry = &gShoreTexCache[gNextShoreTexCache];
+        if( ++gNextShoreTexCache >= kMaxShoreTexCache )
+            gNextShoreTexCache = 0;
+    }
+
+    entry->fRef = ref;
+    entry->fNumKey = numKey;
+    memcpy(entry->fKey, key, numKey * sizeof(float));
+
+    const uint32_t* src = mipMap->GetAddr32(0,0);
+    entry->fPixels.assign(src, src + mipMap->GetWidth() * mipMap->GetHeight());
+}
+
 plMipmap* plWaveSet7::ICreateGraphShoreTex(int width, int height)
 {
     // GraphShoreLayer has a texture with white color (possibly noised),
@@ -3736,6 +4111,9 @@ plMipmap* plWaveSet7::ICreateGraphShoreTex(int width, int height)
     {
         plMipmap* mipMap = ICreateBlankTex("Graph", width, height, kRefGraphShoreTex);
 
+        if( IFetchShoreTex(mipMap, kRefGraphShoreTex) )
+            return fGraphShoreTex;
+
         plConst(float) kRampFrac(0.4f);
         plConst(float) kTruncFrac(0.8f);
         const int rampEnd = int(kRampFrac * height + 0.5f);
@@ -3765,18 +4143,53 @@ plMipmap* plWaveSet7::ICreateGraphShoreTex(int width, int height)
                     | (0xff << 8)
                     | 0xff;
 
+            uint32_t* row = mipMap->GetAddr32(0, j);
             int i;
             for( i = 0; i < width; i++ )
             {
-                uint32_t* val = mipMap->GetAddr32(i, j);
-                *val = color;
+                row[i] = color;
             }
         }
+        IStoreShoreTex(mipMap, kRefGraphShoreTex);
     }
 
     return fGraphShoreTex;
 }
 
+// Scale the alpha of n texels by the matching factors in f, leaving the color alone.
+// The sse2 version wants n to be a multiple of 4.
+typedef void(*carve_row_ptr)(uint32_t* val, const float* f, int n);
+
+static void carve_row_fpu(uint32_t* val, const float* f, int n)
+{
+    int i;
+    for( i = 0; i < n; i++ )
+    {
+        uint32_t alpha = val[i] >> 24;
+        alpha = uint32_t(float(alpha) * f[i]);
+        val[i] &= 0x00ffffff;
+        val[i] |= (alpha << 24);
+    }
+}
+
+static void carve_row_sse2(uint32_t* val, const float* f, int n)
+{
+#ifdef HS_SSE2
+    const __m128i rgbMask = _mm_set1_epi32(0x00ffffff);
+    int i;
+    for( i = 0; i < n; i += 4 )
+    {
+        __m128i v = _mm_loadu_si128((const __m128i*)(val + i));
+        __m128 alpha = _mm_cvtepi32_ps(_mm_srli_epi32(v, 24));
+        __m128i carved = _mm_cvttps_epi32(_mm_mul_ps(alpha, _mm_loadu_ps(f + i)));
+        v = _mm_or_si128(_mm_and_si128(v, rgbMask), _mm_slli_epi32(carved, 24));
+        _mm_storeu_si128((__m128i*)(val + i), v);
+    }
+#endif // HS_SSE2
+}
+
+static hsFunctionDispatcher<carve_row_ptr> carve_row(carve_row_fpu, 0, carve_row_sse2);
+
 void plWaveSet7::IRefillBubbleShoreTex()
 {
     plMipmap* mipMap = fBubbleShoreTex;
@@ -3791,6 +4204,19 @@ void plWaveSet7::IRefillBubbleShoreTex()
     plConst(int) kMinNumBub(1024);
     plConst(int) kMaxNumBub(6000);
     const int kNumBub = (int)(kMinNumBub + State().fWispiness * (kMaxNumBub - kMinNumBub));
+
+    plConst(float) kMinRad(2.f);
+    plConst(float) kMaxRad(5.0f);
+    plConst(float) kMinAlpha(0.8f);
+    plConst(float) kMaxAlpha(1.f);
+
+    // Every hole of a given radius carves the same falloff, so we only figure it
+    // when the radius changes. Rows are padded out to a multiple of 4 with 1's,
+    // which leave the alpha as is.
+    std::vector<float> kernel;
+    int kernRadius = -1;
+    int kernWidth = 0;
+
     int k;
     for( k = 0; k < kNumBub; k++ )
     {
@@ -3799,12 +4225,39 @@ void plWaveSet7::IRefillBubbleShoreTex()
         int jLoc = (int)(fRand.RandZeroToOne() * height);
 
         // Select a random radius
-        plConst(float) kMinRad(2.f);
-        plConst(float) kMaxRad(5.0f);
         int radius = int(kMinRad + fRand.RandZeroToOne() * (kMaxRad - kMinRad));
-        float invRadiusSq = 1.f / float(radius*radius);
 
-        // Carve out a hole.
+        if( radius != kernRadius )
+        {
+            kernRadius = radius;
+            kernWidth = (2 * radius + 3) & ~3;
+            kernel.resize(2 * radius * kernWidth);
+
+            float invRadiusSq = 1.f / float(radius*radius);
+            int j;
+            for( j = -radius; j < radius; j++ )
+            {
+                float* f = &kernel[(j + radius) * kernWidth];
+                int c;
+                for( c = 0; c < kernWidth; c++ )
+                {
+                    f[c] = 1.f;
+                    if( c < 2 * radius )
+                    {
+                        int i = c - radius;
+                        f[c] = float(i*i + j*j) * invRadiusSq;
+                        if( f[c] > 1.f )
+                            f[c] = 1.f;
+                        f[c] *= (kMaxAlpha - kMinAlpha);
+                        f[c] += kMinAlpha;
+                    }
+                }
+            }
+        }
+
+        // Carve out a hole. Unless it wraps around in U, a whole row goes at once.
+        const int iFirst = iLoc - radius;
+        const bool wrapU = (iFirst < 0) || (iFirst + kernWidth > width);
         int j;
         for( j = -radius; j < radius; j++ )
         {
@@ -3814,55 +4267,58 @@ void plWaveSet7::IRefillBubbleShoreTex()
             else if( jj >= height )
                 jj -= height;
 
-            int i;
-            for( i = -radius; i < radius; i++ )
+            uint32_t* row = mipMap->GetAddr32(0, jj);
+            const float* f = &kernel[(j + radius) * kernWidth];
+            if( !wrapU )
+            {
+                carve_row.call(row + iFirst, f, kernWidth);
+                continue;
+            }
+
+            int c;
+            for( c = 0; c < 2 * radius; c++ )
             {
-                int ii = iLoc + i;
+                int ii = iFirst + c;
                 if( ii < 0 )
                     ii += width;
                 else if( ii >= width )
                     ii -= width;
 
-                float f = float(i*i + j*j) * invRadiusSq;
-                if( f > 1.f )
-                    f = 1.f;
-                plConst(float) kMinAlpha(0.8f);
-                plConst(float) kMaxAlpha(1.f);
-                f *= (kMaxAlpha - kMinAlpha);
-                f += kMinAlpha;
-
-                uint32_t* val = mipMap->GetAddr32(ii, jj);
-                uint32_t alpha = (*val) >> 24;
-                alpha = uint32_t(float(alpha) * f);
-                *val &= 0x00ffffff;
-                *val |= (alpha << 24);
+                carve_row_fpu(row + ii, f + c, 1);
             }
         }
     }
 
+    // Only the alpha's been touched (the color is still white), so the final
+    // color only depends on the alpha. Work out all 256 and look them up.
     const hsColorRGBA maxColor = State().fMaxColor;
     const hsColorRGBA minColor = State().fMinColor;
-    int j;
-    for( j = 0; j < height; j++ )
+    uint32_t colorLUT[256];
+    int a;
+    for( a = 0; a < 256; a++ )
     {
-        int i;
-        for( i = 0; i < width; i++ )
-        {
-            uint32_t* val = mipMap->GetAddr32(i, j);
-            hsColorRGBA col;
-            col.FromARGB32(*val);
-            float alpha = col.a;
-            col = maxColor - minColor;
-            col *= alpha;
-            col += minColor;
-
-            *val = col.ToARGB32();
+        hsColorRGBA col;
+        col.FromARGB32((uint32_t(a) << 24) | 0x00ffffff);
+        float alpha = col.a;
+        col = maxColor - minColor;
+        col *= alpha;
+        col += minColor;
+
+        colorLUT[a] = col.ToARGB32();
+    }
 
-        }
+    uint32_t* val = mipMap->GetAddr32(0,0);
+    const int numTexels = width * height;
+    int i;
+    for( i = 0; i < numTexels; i++ )
+    {
+        val[i] = colorLUT[val[i] >> 24];
     }
     mipMap->MakeDirty();
 
     fTrialUpdate &= ~kRemakeBubble;
+
+    IStoreShoreTex(mipMap, kRefBubbleShoreTex);
 }
 
 plMipmap* plWaveSet7::ICreateBubbleShoreTex(int width, int height)
@@ -3876,7 +4332,8 @@ plMipmap* plWaveSet7::ICreateBubbleShoreTex(int width, int height)
     {
         plMipmap* mipMap = ICreateBlankTex("Bubble", width, height, kRefBubbleShoreTex);
 
-        IRefillBubbleShoreTex();
+        if( !IFetchShoreTex(mipMap, kRefBubbleShoreTex) )
+            IRefillBubbleShoreTex();
     }
 
     return fBubbleShoreTex;
@@ -3933,19 +4390,23 @@ void plWaveSet7::IRefillEdgeShoreTex()
             alpha = uint32_t(a * maxAlpha);
         }
 
+        const uint32_t color = (alpha << 24)
+            | (alpha << 16)
+            | (alpha << 8)
+            | (alpha << 0);
+
+        uint32_t* row = mipMap->GetAddr32(0, j);
         int i;
         for( i = 0; i < width; i++ )
         {
-            uint32_t* val = mipMap->GetAddr32(i, j);
-            *val = (alpha << 24)
-                | (alpha << 16)
-                | (alpha << 8)
-                | (alpha << 0);
+            row[i] = color;
         }
     }
     mipMap->MakeDirty();
 
     fTrialUpdate &= ~kRemakeEdge;
+
+    IStoreShoreTex(mipMap, kRefEdgeShoreTex);
 }
 
 plMipmap* plWaveSet7::ICreateEdgeShoreTex(int width, int height)
@@ -3961,7 +4422,8 @@ plMipmap* plWaveSet7::ICreateEdgeShoreTex(int width, int height)
     {
         plMipmap* mipMap = ICreateBlankTex("Edge", width, height, kRefEdgeShoreTex);
 
-        IRefillEdgeShoreTex();
+        if( !IFetchShoreTex(mipMap, kRefEdgeShoreTex) )
+            IRefillEdgeShoreTex();
     }
 
     return fEdgeShoreTex;
@@ -4193,6 +4655,9 @@ void plWaveSet7::ISetupGraphShore(hsGMaterial* mat)
 {
     if( !fGraphShoreRT[0] )
     {
+        // The graphs get initialized from the update snapshot, make sure it's current.
+        fSimState = fState;
+
         // Create the material
         ICreateGraphShoreMaterials();
 
@@ -4303,13 +4768,11 @@ void plWaveSet7::IInitGraph(int iPass)
     // Age starts off 0.
     gs.fAge = 0;
 
-    static int lastOne = 0;
-
     plConst(float) kBasePeriod(3.f);
-    float life = State().fPeriod * kBasePeriod * (1.f + fRand.RandZeroToOne()); 
-    gs.fInvLife = (1.f + float(lastOne)/float(kGraphShorePasses-1)) / life;
+    float life = fSimState.fPeriod * kBasePeriod * (1.f + fRand.RandZeroToOne()); 
+    gs.fInvLife = (1.f + float(fLastGraph)/float(kGraphShorePasses-1)) / life;
 
-    lastOne = !lastOne;
+    fLastGraph = !fLastGraph;
 
     gs.fUOff = fRand.RandZeroToOne();
 
@@ -4414,7 +4877,7 @@ void plWaveSet7::IUpdateGraphShader(float dt, int iPass)
 
             plConst(float) kCMax(1.f);
             plConst(float) kCMin(3.f);
-            float cMin = kCMax + (kCMin - kCMax) * State().fFingerLength;
+            float cMin = kCMax + (kCMin - kCMax) * fSimState.fFingerLength;
             plConst(float) k2ndLayerScale(2.f);
             plConst(float) k2ndLayerVoff(1.5f);
             shader->SetVector(plGraphVS::kUVWConsts,
@@ -4426,7 +4889,7 @@ void plWaveSet7::IUpdateGraphShader(float dt, int iPass)
     }
 }
 
-void plWaveSet7::IUpdateGraphShaders(plPipeline* pipe, float dt)
+void plWaveSet7::IUpdateGraphShaders(float dt)
 {
     if( fGraphShoreDraw[0] )
     {
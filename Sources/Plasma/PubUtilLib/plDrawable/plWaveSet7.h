@@ -76,6 +76,7 @@ class plPipeline;
 class plRipVSConsts;
 class plStatusLog;
 class plGraphPlate;
+class plWaveUpdateThread;
 
 class plWorldWaveData7
 {
@@ -98,6 +99,8 @@ public:
 
 class plWaveSet7 : public plWaveSetBase
 {
+    friend class plWaveUpdateThread;
+
 public:
     // Props inc by 1 (bit shift in bitvector).
     enum plDrawProperties {
@@ -204,9 +207,25 @@ protected:
 
     plWorldWave7    fWorldWaves[kNumWaves];
     float        fFreqMod[kNumWaves];
+    float        fWaveSpeed[kNumWaves];      // Phase speeds, only change when a wave is (re)spawned.
+    float        fTexWaveSpeed[kNumTexWaves];
 
     plRandom        fRand;
 
+    // Per frame wave state update. It's started at the end of the plEvalMsg (when the last
+    // frame was visible) and finished on the plRenderMsg, so on the update thread it runs
+    // alongside transforms, simulation and visibility. While it's in flight, it owns the wave,
+    // texture wave and graph states and reads fSimState instead of fState.
+    plFixedWaterState7      fSimState;
+    float                fSimDel;
+    bool                    fUpdateQueued;
+    bool                    fUsingUpdateThread;
+    bool                    fWasVisible;
+    int                     fLastGraph;
+
+    static bool             fThreadedUpdate;
+    static bool             fCacheShoreTex;
+
     plKey               fSceneNode;
 
     hsTArray<plDynaDecalMgr*>       fDecalMgrs;
@@ -350,8 +369,14 @@ protected:
 
     void            ICalcWindow(float dt);
     void            ICalcScale();
+    float           IGetUpdateDel();
+    void            IBeginUpdate();
+    void            IQueueUpdate();
+    void            IWaitForUpdate();
+    void            IRunUpdate(float dt);
     void            IUpdateWaves(float dt);
     void            IUpdateWave(float dt, int i);
+    void            IUpdateTexWaves(float dt);
     bool            IAnyBoundsVisible(plPipeline* pipe) const;
 
     void            IInitWave(int i);
@@ -385,8 +410,8 @@ protected:
     void                IInitTexWave(int i);
     void                ISetupTextureWaves();
 
-    void                IUpdateLayers(float dt);
-    void                IUpdateBumpLayers(float dt);
+    void                IUpdateLayers();
+    void                IUpdateBumpLayers();
     
     plRenderRequest*    ICreateRenderRequest(plRenderTarget* rt, plDrawableSpans* draw, float pri);
     void                ISubmitRenderRequests();
@@ -422,6 +447,9 @@ protected:
     void                IRefillBubbleShoreTex();
     plMipmap*           ICreateEdgeShoreTex(int width, int height);
     void                IRefillEdgeShoreTex();
+    int                 IGetShoreTexKey(const plMipmap* mipMap, uint32_t ref, float* key) const;
+    bool                IFetchShoreTex(plMipmap* mipMap, uint32_t ref) const;
+    void                IStoreShoreTex(const plMipmap* mipMap, uint32_t ref) const;
     void                ISetAsTexture(plLayer* lay, plBitmap* tex);
     void                ICreateGraphShoreLayer(hsGMaterial* mat, int iPass);
     void                ICreateGraphBubbleLayer(hsGMaterial* mat, int iPass);
@@ -474,7 +502,7 @@ protected:
     void                IUpdateShoreVShader(plPipeline* pipe, const hsMatrix44& l2w, const hsMatrix44& w2l);
     void                IUpdateFixedVShader(plPipeline* pipe, const hsMatrix44& l2w, const hsMatrix44& w2l);
     void                IUpdateFixedPShader(plPipeline* pipe, const hsMatrix44& l2w, const hsMatrix44& w2l);
-    void                IUpdateGraphShaders(plPipeline* pipe, float dt);
+    void                IUpdateGraphShaders(float dt);
     void                IUpdateDecVShader(int t, plPipeline* pipe);
     void                IUpdateDecVShaders(plPipeline* pipe, const hsMatrix44& l2w, const hsMatrix44& w2l);
 
@@ -653,6 +681,16 @@ public:
     void StartGraph();
     void StopGraph();
     bool Graphing() const { return fStatusGraph != nil; }
+
+    // Run the per frame wave state update on the shared wave update thread.
+    static void SetThreadedUpdate(bool on) { fThreadedUpdate = on; }
+    static bool GetThreadedUpdate() { return fThreadedUpdate; }
+
+    // Keep the generated shore textures around, so reloading an age (or loading another
+    // with the same shore settings) doesn't have to rebuild them.
+    static void SetCacheShoreTex(bool on);
+    static bool GetCacheShoreTex() { return fCacheShoreTex; }
+    static void FlushShoreTexCache();
 };
 
 #endif // plWaveSet7_inc
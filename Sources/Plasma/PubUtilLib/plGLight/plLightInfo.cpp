@@ -107,6 +107,9 @@ plLightInfo::plLightInfo()
 
     fRegisteredForRenderMsg = false;
 
+    fAffectedUseCount = 0;
+    fIsectSerial = 0;
+
     fVisSet.SetBit(plVisMgr::kNormal);
 }
 
@@ -125,6 +128,10 @@ plLightInfo::~plLightInfo()
     }
 
     delete fProxyGen;
+
+    int i;
+    for( i = 0; i < fAffectedCaches.GetCount(); i++ )
+        delete fAffectedCaches[i];
 }
 
 void plLightInfo::SetDeviceRef( hsGDeviceRef *ref )
@@ -215,7 +222,104 @@ void plLightInfo::GetAffected(const plSpaceTree* space, hsBitVector& list, bool
     }
 }
 
+bool plLightInfo::AffectsLeaves(const plSpaceTree* space, const hsTArray<int16_t>& leaves)
+{
+    Refresh();
+
+    if( !IGetIsect() || space->IsEmpty() )
+        return true;
+
+    static hsBitVector cache;
+    static hsTArray<int16_t> litList;
+    cache.Clear();
+    litList.SetCount(0);
+    space->EnableLeaves(leaves, cache);
+    space->HarvestEnabledLeaves(IGetIsect(), cache, litList);
+
+    return litList.GetCount() > 0;
+}
+
 const hsTArray<int16_t>& plLightInfo::GetAffected(plSpaceTree* space, const hsTArray<int16_t>& visList, hsTArray<int16_t>& litList, bool charac)
+{
+    static hsBitVector cache;
+    cache.Clear();
+    space->EnableLeaves(visList, cache);
+
+    return GetAffected(space, visList, cache, litList, charac);
+}
+
+void plLightAffectedCache::Reset(const plSpaceTree* space, uint32_t isectSerial)
+{
+    fSpace = space;
+    fSpaceSerial = space->GetSerial();
+    fIsectSerial = isectSerial;
+    fBuilt = false;
+    fLeaves.SetCount(0);
+}
+
+void plLightAffectedCache::Harvest(const plSpaceTree* space, plVolumeIsect* isect, uint32_t isectSerial,
+                                   const hsTArray<int16_t>& visList, const hsBitVector& visCache, hsTArray<int16_t>& litList)
+{
+    if( (fSpace != space) || (fSpaceSerial != space->GetSerial()) || (fIsectSerial != isectSerial) )
+    {
+        Reset(space, isectSerial);
+    }
+    else if( !fBuilt )
+    {
+        space->HarvestAllLeaves(isect, fLeaves);
+        fBuilt = true;
+    }
+
+    const int kMaxLeavesPerVis = 16;
+    if( fBuilt && (fLeaves.GetCount() <= visList.GetCount() * kMaxLeavesPerVis) )
+    {
+        int i;
+        for( i = 0; i < fLeaves.GetCount(); i++ )
+        {
+            if( visCache.IsBitSet(fLeaves[i]) )
+                litList.Append(fLeaves[i]);
+        }
+    }
+    else
+    {
+        space->HarvestEnabledLeaves(isect, visCache, litList);
+    }
+}
+
+// Find (or make, or recycle the least recently used) cache for this tree.
+// The caller must hand it to Harvest with the same tree.
+plLightAffectedCache* plLightInfo::IGetAffectedCache(const plSpaceTree* space)
+{
+    fAffectedUseCount++;
+
+    plLightAffectedCache* oldest = nil;
+    int i;
+    for( i = 0; i < fAffectedCaches.GetCount(); i++ )
+    {
+        plLightAffectedCache* cache = fAffectedCaches[i];
+        if( cache->fSpace == space )
+        {
+            cache->fLastUsed = fAffectedUseCount;
+            return cache;
+        }
+        if( !oldest || (cache->fLastUsed < oldest->fLastUsed) )
+            oldest = cache;
+    }
+
+    plLightAffectedCache* cache = oldest;
+    if( fAffectedCaches.GetCount() < kMaxAffectedCaches )
+    {
+        cache = new plLightAffectedCache;
+        fAffectedCaches.Append(cache);
+    }
+    // Harvest will see a new tree and start it over.
+    cache->fSpace = nil;
+    cache->fLastUsed = fAffectedUseCount;
+
+    return cache;
+}
+
+const hsTArray<int16_t>& plLightInfo::GetAffected(plSpaceTree* space, const hsTArray<int16_t>& visList, const hsBitVector& visCache, hsTArray<int16_t>& litList, bool charac)
 {
     Refresh();
 
@@ -225,11 +329,7 @@ const hsTArray<int16_t>& plLightInfo::GetAffected(plSpaceTree* space, const hsTA
         {
             if( IGetIsect() )
             {
-                static hsBitVector cache;
-                cache.Clear();
-                space->EnableLeaves(visList, cache);
-
-                space->HarvestEnabledLeaves(IGetIsect(), cache, litList);
+                IGetAffectedCache(space)->Harvest(space, IGetIsect(), fIsectSerial, visList, visCache, litList);
 
                 return litList;
             }
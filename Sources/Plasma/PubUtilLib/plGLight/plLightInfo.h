@@ -68,6 +68,38 @@ class plRenderTarget;
 
 class plLightProxy;
 
+// plLightAffectedCache - Every leaf of a space tree a light volume reaches,
+// ignoring visibility, along with the serials of the tree and the volume
+// it was made with.
+//
+// The leaves a light reaches only change when the light or the tree does.
+// So for a light and a tree that are both holding still, Harvest keeps the
+// full list and each frame just picks out the leaves enabled in visCache.
+// That gives the same list, in the same order, as walking the tree for the
+// visible leaves (see plSpaceTree::HarvestAllLeaves), with none of the
+// volume tests.
+// The list is only built once the serials have held for one call, so a
+// moving light pays nothing extra. A visList that is very short next to
+// the full list also takes the walk, since the walk is cheaper then.
+class plLightAffectedCache
+{
+public:
+    const plSpaceTree*      fSpace;
+    uint32_t                fSpaceSerial;
+    uint32_t                fIsectSerial;
+    uint32_t                fLastUsed;
+    bool                    fBuilt;
+    hsTArray<int16_t>       fLeaves;
+
+    plLightAffectedCache() : fSpace(nil), fSpaceSerial(0), fIsectSerial(0), fLastUsed(0), fBuilt(false) {}
+
+    void Reset(const plSpaceTree* space, uint32_t isectSerial);
+
+    // Appends to litList, like plSpaceTree::HarvestEnabledLeaves.
+    void Harvest(const plSpaceTree* space, plVolumeIsect* isect, uint32_t isectSerial,
+                 const hsTArray<int16_t>& visList, const hsBitVector& visCache, hsTArray<int16_t>& litList);
+};
+
 class plLightInfo : public plObjInterface
 {
 public:
@@ -143,6 +175,14 @@ protected:
     // Small shadow section
     hsBitVector                 fSlaveBits;
 
+    // Caches of the leaves we reach in the last few space trees we've lit.
+    enum { kMaxAffectedCaches = 16 };
+    hsTArray<plLightAffectedCache*> fAffectedCaches;
+    uint32_t                    fAffectedUseCount;
+    uint32_t                    fIsectSerial;   // Bumped whenever our isect might have changed
+
+    plLightAffectedCache*       IGetAffectedCache(const plSpaceTree* space);
+
     virtual void                IMakeIsect() = 0;
     virtual plVolumeIsect*      IGetIsect() = 0;
     virtual void                IRefresh();
@@ -182,13 +222,19 @@ public:
     bool IsShadowCaster() const { return GetProperty(kLPCastShadows); }
     void SetShadowCaster(bool on) { SetProperty(kLPCastShadows, on); }
 
-    void Refresh() { if( IsDirty() ) { IRefresh(); SetDirty(false); } }
+    void Refresh() { if( IsDirty() ) { IRefresh(); SetDirty(false); fIsectSerial++; } }
     virtual void GetStrengthAndScale(const hsBounds3Ext& bnd, float& strength, float& scale) const;
 
     bool AffectsBound(const hsBounds3Ext& bnd) { return IGetIsect() ? IGetIsect()->Test(bnd) != kVolumeCulled : true; }
+    // Whether we reach any of the given leaves of space, ignoring light groups.
+    // Only walks the branches leading down to those leaves.
+    bool AffectsLeaves(const plSpaceTree* space, const hsTArray<int16_t>& leaves);
     void GetAffectedForced(const plSpaceTree* space, hsBitVector& list, bool charac);
     void GetAffected(const plSpaceTree* space, hsBitVector& list, bool charac);
     const hsTArray<int16_t>& GetAffected(plSpaceTree* space, const hsTArray<int16_t>& visList, hsTArray<int16_t>& litList, bool charac);
+    // Same as above, with visCache already filled in by space->EnableLeaves(visList, visCache),
+    // so it can be shared by all the lights looking at the same list.
+    const hsTArray<int16_t>& GetAffected(plSpaceTree* space, const hsTArray<int16_t>& visList, const hsBitVector& visCache, hsTArray<int16_t>& litList, bool charac);
     bool InVisSet(const hsBitVector& visSet) const { return fVisSet.Overlap(visSet); }
     bool InVisNot(const hsBitVector& visNot) const { return fVisNot.Overlap(visNot); }
 
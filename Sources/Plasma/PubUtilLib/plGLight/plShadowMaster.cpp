@@ -67,6 +67,28 @@ float plShadowMaster::fGlobalMaxDist = 160.f; // PERSPTEST
 // float plShadowMaster::fGlobalMaxDist = 100000.f; // PERSPTEST
 float plShadowMaster::fGlobalVisParm = 1.f;
 
+// What a slave's light space setup was built from, and what came out of it.
+// Everything up through the LUTs depends only on the caster bounds, the
+// light's transform, the atten distance and the slave's starting flags.
+// Only the size and priority, and the fade in ILastChanceToBail, look at
+// the camera, so those are still done every frame.
+class plShadowSlaveCache
+{
+public:
+    hsBounds3Ext        fCasterBnd;
+    hsMatrix44          fLightL2W;
+    float               fAttenDist;
+    uint32_t            fFlags;
+
+    hsMatrix44          fWorldToLight;
+    hsMatrix44          fLightToWorld;
+    hsMatrix44          fCastLUT;
+    hsMatrix44          fRcvLUT;
+    hsBounds3Ext        fWorldBounds;
+
+    uint32_t            fLastUsed;
+};
+
 void plShadowMaster::SetGlobalShadowQuality(float s) 
 { 
     if( s < 0 )
@@ -108,7 +130,8 @@ plShadowMaster::plShadowMaster()
     fMaxSize(256),
     fMinSize(256),
     fPower(1.f),
-    fLightInfo(nil)
+    fLightInfo(nil),
+    fRenderFrame(0)
 {
 }
 
@@ -120,6 +143,8 @@ plShadowMaster::~plShadowMaster()
     int i;
     for( i = 0; i < fSlavePool.GetCount(); i++ )
         delete fSlavePool[i];
+
+    IPurgeSlaveCaches(true);
 }
 
 void plShadowMaster::Read(hsStream* stream, hsResMgr* mgr)
@@ -175,6 +200,9 @@ void plShadowMaster::SetMaxDist(float f)
 
 #include "plProfile.h"
 plProfile_CreateTimer("ShadowMaster", "RenderSetup", ShadowMaster);
+plProfile_CreateCounter("ShadowCulled", "RenderSetup", ShadowCulled);
+plProfile_CreateCounter("ShadowRebuilt", "RenderSetup", ShadowRebuilt);
+plProfile_CreateCounter("ShadowReused", "RenderSetup", ShadowReused);
 bool plShadowMaster::MsgReceive(plMessage* msg)
 {
     plRenderMsg* rendMsg = plRenderMsg::ConvertNoRef(msg);
@@ -201,6 +229,12 @@ void plShadowMaster::IBeginRender()
     fSlavePool.SetCount(0);
     if( ISetLightInfo() ) 
         fLightInfo->ClearSlaveBits();
+
+    // Casters that have stopped showing up (unloaded, out of range, etc.)
+    // don't need to hang onto their setup forever.
+    const uint32_t kPurgeFrames = 32;
+    if( !(++fRenderFrame % kPurgeFrames) )
+        IPurgeSlaveCaches(false);
 }
 
 bool plShadowMaster::IOnCastMsg(plShadowCastMsg* castMsg)
@@ -224,6 +258,12 @@ bool plShadowMaster::IOnCastMsg(plShadowCastMsg* castMsg)
     if( !caster->Spans().GetCount() )
         return false;
 
+    if( !IAffectsCaster(caster) )
+    {
+        plProfile_Inc(ShadowCulled);
+        return false;
+    }
+
     hsBounds3Ext casterBnd;
     IComputeCasterBounds(caster, casterBnd);
 
@@ -306,6 +346,106 @@ void plShadowMaster::IComputeCasterBounds(const plShadowCaster* caster, hsBounds
     }
 }
 
+// Ask the drawables' space trees whether our light reaches any of the caster's spans.
+// Only the branches leading down to the caster's leaves get walked, and a branch
+// wholly inside the light volume is accepted without testing below it.
+// A caster that fails this would only have come out with no power anyway.
+bool plShadowMaster::IAffectsCaster(const plShadowCaster* caster) const
+{
+    static hsTArray<int16_t> leaves;
+
+    const hsTArray<plShadowCastSpan>& castSpans = caster->Spans();
+    int i = 0;
+    while( i < castSpans.GetCount() )
+    {
+        // ICollectAllSpans gathers each drawable's spans together, so go a drawable at a time.
+        plDrawableSpans* dr = castSpans[i].fDraw;
+        leaves.SetCount(0);
+        for( ; (i < castSpans.GetCount()) && (castSpans[i].fDraw == dr); i++ )
+            leaves.Append(int16_t(castSpans[i].fIndex));
+
+        if( fLightInfo->AffectsLeaves(dr->GetSpaceTree(), leaves) )
+            return true;
+    }
+    return false;
+}
+
+// If neither the caster nor the light has changed since this caster's slave was last
+// set up, copy that setup into the slave and return true. Called after slave->Init(),
+// with the caster bounds, atten dist and flags already filled in.
+bool plShadowMaster::IFetchSlaveCache(plShadowSlave* slave)
+{
+    if( slave->fCasterWorldBounds.GetType() != kBoundsNormal )
+        return false;
+
+    plSlaveCacheMap::iterator iter = fSlaveCaches.find(slave->fCaster);
+    if( iter == fSlaveCaches.end() )
+        return false;
+
+    plShadowSlaveCache* cache = iter->second;
+    cache->fLastUsed = fRenderFrame;
+
+    if( (cache->fFlags != slave->fFlags)
+        || (cache->fAttenDist != slave->fAttenDist)
+        || (cache->fCasterBnd.GetType() != kBoundsNormal)
+        || !(cache->fCasterBnd.GetMins() == slave->fCasterWorldBounds.GetMins())
+        || !(cache->fCasterBnd.GetMaxs() == slave->fCasterWorldBounds.GetMaxs())
+        || !(cache->fLightL2W == fLightInfo->GetLightToWorld()) )
+        return false;
+
+    slave->fWorldToLight = cache->fWorldToLight;
+    slave->fLightToWorld = cache->fLightToWorld;
+    slave->fCastLUT = cache->fCastLUT;
+    slave->fRcvLUT = cache->fRcvLUT;
+    slave->fWorldBounds = cache->fWorldBounds;
+
+    return true;
+}
+
+// Remember the setup just computed for this slave's caster. The flags stored are the
+// ones the slave started with, since that's what the next IFetchSlaveCache compares.
+void plShadowMaster::IStoreSlaveCache(const plShadowSlave* slave, uint32_t initFlags)
+{
+    if( slave->fCasterWorldBounds.GetType() != kBoundsNormal )
+        return;
+
+    plShadowSlaveCache*& cache = fSlaveCaches[slave->fCaster];
+    if( !cache )
+        cache = new plShadowSlaveCache;
+
+    cache->fCasterBnd = slave->fCasterWorldBounds;
+    cache->fLightL2W = fLightInfo->GetLightToWorld();
+    cache->fAttenDist = slave->fAttenDist;
+    cache->fFlags = initFlags;
+
+    cache->fWorldToLight = slave->fWorldToLight;
+    cache->fLightToWorld = slave->fLightToWorld;
+    cache->fCastLUT = slave->fCastLUT;
+    cache->fRcvLUT = slave->fRcvLUT;
+    cache->fWorldBounds = slave->fWorldBounds;
+
+    cache->fLastUsed = fRenderFrame;
+}
+
+void plShadowMaster::IPurgeSlaveCaches(bool all)
+{
+    const uint32_t kMaxIdleFrames = 32;
+
+    plSlaveCacheMap::iterator iter = fSlaveCaches.begin();
+    while( iter != fSlaveCaches.end() )
+    {
+        if( all || (fRenderFrame - iter->second->fLastUsed > kMaxIdleFrames) )
+        {
+            delete iter->second;
+            fSlaveCaches.erase(iter++);
+        }
+        else
+        {
+            ++iter;
+        }
+    }
+}
+
 plShadowSlave* plShadowMaster::INextSlave(const plShadowCaster* caster)
 {
     int iSlave = fSlavePool.GetCount();
@@ -338,15 +478,34 @@ plShadowSlave* plShadowMaster::ICreateShadowSlave(plShadowCastMsg* castMsg, cons
 
     // Order of these matters, since values calculated in one are
     // used by later functions. Rearrange at your own risk.
-    IComputeWorldToLight(casterBnd, slave);
+    // The light space setup (WorldToLight, Bounds and LUT) is the same as last
+    // frame unless the caster or light moved, so try the cache for those first.
+    const uint32_t initFlags = slave->fFlags;
+    const bool reused = IFetchSlaveCache(slave);
+
+    if( !reused )
+    {
+        IComputeWorldToLight(casterBnd, slave);
 
-    IComputeBounds(casterBnd, slave);
+        IComputeBounds(casterBnd, slave);
+    }
 
     IComputeWidthAndHeight(castMsg, slave);
 
     IComputeProjections(castMsg, slave);
 
-    IComputeLUT(castMsg, slave);
+    if( !reused )
+    {
+        IComputeLUT(castMsg, slave);
+
+        IStoreSlaveCache(slave, initFlags);
+
+        plProfile_Inc(ShadowRebuilt);
+    }
+    else
+    {
+        plProfile_Inc(ShadowReused);
+    }
 
     IComputeISect(casterBnd, slave);
 
@@ -44,9 +44,11 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #define plShadowMaster_inc
 
 #include "pnSceneObject/plObjInterface.h"
+#include <map>
 
 class plShadowCaster;
 class plShadowSlave;
+class plShadowSlaveCache;
 
 struct hsMatrix44;
 class hsBounds3Ext;
@@ -89,6 +91,12 @@ protected:
     hsTArray<plShadowSlave*>        fSlavePool;
     plLightInfo*                    fLightInfo;
 
+    // The light space setup each caster's slave was last built with. A caster
+    // and light that both hold still get it back instead of recomputing it.
+    typedef std::map<const plShadowCaster*, plShadowSlaveCache*> plSlaveCacheMap;
+    plSlaveCacheMap                 fSlaveCaches;
+    uint32_t                        fRenderFrame;
+
     // These are specific to the projection type (perspective or orthogonal), so have to
     // be implemented by the derived class.
     virtual void IComputeWorldToLight(const hsBounds3Ext& bnd, plShadowSlave* slave) const = 0;
@@ -108,6 +116,11 @@ protected:
 
     virtual plShadowSlave* ICreateShadowSlave(plShadowCastMsg* castMsg, const hsBounds3Ext& casterBnd, float power);
 
+    bool IAffectsCaster(const plShadowCaster* caster) const;
+    bool IFetchSlaveCache(plShadowSlave* slave);
+    void IStoreSlaveCache(const plShadowSlave* slave, uint32_t initFlags);
+    void IPurgeSlaveCaches(bool all);
+
     virtual plShadowSlave* INewSlave(const plShadowCaster* caster) = 0;
     virtual plShadowSlave* INextSlave(const plShadowCaster* caster);
 
@@ -48,17 +48,24 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plgDispatch.h"
 #include "plMessage/plListenerMsg.h"
 
+uint32_t plSoftVolume::fVersion = 1;
+bool plSoftVolume::fUseCache = true;
+
 plSoftVolume::plSoftVolume() 
 :   fListenState(0),
     fListenStrength(0),
+    fListenVersion(0),
     fInsideStrength(1.f),
-    fOutsideStrength(0)
+    fOutsideStrength(0),
+    fCache(nil)
 {
     fListenPos.Set(0,0,0);
 }
 
 plSoftVolume::~plSoftVolume()
 {
+    delete [] fCache;
+    DirtyCaches();
 }
 
 void plSoftVolume::Read(hsStream* s, hsResMgr* mgr)
@@ -71,6 +78,8 @@ void plSoftVolume::Read(hsStream* s, hsResMgr* mgr)
 
     fInsideStrength = s->ReadLEScalar();
     fOutsideStrength = s->ReadLEScalar();
+
+    DirtyCaches();
 }
 
 void plSoftVolume::Write(hsStream* s, hsResMgr* mgr)
@@ -83,9 +92,78 @@ void plSoftVolume::Write(hsStream* s, hsResMgr* mgr)
     s->WriteLEScalar(fOutsideStrength);
 }
 
+plSoftVolume::CachedStrength* plSoftVolume::ICacheSlot(const hsPoint3& pos) const
+{
+    if( !fCache )
+    {
+        fCache = new CachedStrength[kNumCachedStrengths];
+        int i;
+        for( i = 0; i < kNumCachedStrengths; i++ )
+            fCache[i].fVersion = 0;
+    }
+
+    uint32_t bits[3];
+    memcpy(bits, &pos.fX, sizeof(bits));
+    uint32_t hash = (bits[0] * 73856093) ^ (bits[1] * 19349663) ^ (bits[2] * 83492791);
+    hash ^= hash >> 16;
+
+    return fCache + (hash & (kNumCachedStrengths-1));
+}
+
 float plSoftVolume::GetStrength(const hsPoint3& pos) const 
 { 
-    return IRemapStrength(IGetStrength(pos));
+    if( !fUseCache )
+        return EvalStrength(pos);
+
+    CachedStrength* slot = ICacheSlot(pos);
+    if( (slot->fVersion == fVersion) && (slot->fPos == pos) )
+        return slot->fStrength;
+
+    slot->fPos = pos;
+    slot->fStrength = EvalStrength(pos);
+    slot->fVersion = fVersion;
+
+    return slot->fStrength;
+}
+
+void plSoftVolume::GetStrengths(const hsPoint3* pos, int num, float* strengths) const
+{
+    IGetStrengths(pos, num, strengths);
+
+    int i;
+    for( i = 0; i < num; i++ )
+        strengths[i] = IRemapStrength(strengths[i]);
+}
+
+void plSoftVolume::CacheStrengths(const hsPoint3* pos, int num) const
+{
+    if( !fUseCache )
+        return;
+
+    const int kChunk = 64;
+    float strengths[kChunk];
+    int first;
+    for( first = 0; first < num; first += kChunk )
+    {
+        const int cnt = hsMinimum(kChunk, num - first);
+        GetStrengths(pos + first, cnt, strengths);
+
+        int i;
+        for( i = 0; i < cnt; i++ )
+        {
+            CachedStrength* slot = ICacheSlot(pos[first + i]);
+            slot->fPos = pos[first + i];
+            slot->fStrength = strengths[i];
+            slot->fVersion = fVersion;
+        }
+    }
+}
+
+void plSoftVolume::IGetStrengths(const hsPoint3* pos, int num, float* strengths) const
+{
+    int i;
+    for( i = 0; i < num; i++ )
+        strengths[i] = IGetStrength(pos[i]);
 }
 
 float plSoftVolume::GetListenerStrength() const
@@ -95,20 +173,31 @@ float plSoftVolume::GetListenerStrength() const
         // Some screw-up, haven't received a pos yet. Turn it off till we do.
         return fListenStrength = IRemapStrength(0);
     }
-    if( fListenState & kListenDirty )
+    if( (fListenState & kListenDirty) || (fListenVersion != fVersion) )
     {
         fListenStrength = IUpdateListenerStrength();
         fListenState &= ~kListenDirty;
+        fListenVersion = fVersion;
     }
     return fListenStrength;
 }
 
 void plSoftVolume::UpdateListenerPosition(const hsPoint3& pos)
 {
+    // The listener is broadcast every frame whether it moved or not.
+    if( (fListenState & kListenPosSet) && (pos == fListenPos) )
+        return;
+
     fListenPos = pos;
     fListenState |= kListenDirty | kListenPosSet;
 }
 
+void plSoftVolume::SetProperty(int prop, bool on)
+{
+    plRegionBase::SetProperty(prop, on);
+    DirtyCaches();
+}
+
 void plSoftVolume::SetCheckListener(bool on)
 {
     if( on )
@@ -147,6 +236,7 @@ void plSoftVolume::SetInsideStrength(float s)
     else if( s > 1.f )
         s = 1.f;
     fInsideStrength = s;
+    DirtyCaches();
 }
 
 void plSoftVolume::SetOutsideStrength(float s)
@@ -156,4 +246,5 @@ void plSoftVolume::SetOutsideStrength(float s)
     else if( s > 1.f )
         s = 1.f;
     fOutsideStrength = s;
+    DirtyCaches();
 }
@@ -69,17 +69,38 @@ protected:
     hsPoint3                fListenPos;
     mutable float        fListenStrength;
     mutable uint32_t          fListenState;
+    mutable uint32_t          fListenVersion;
 
     float                fInsideStrength;
     float                fOutsideStrength;
 
+    // Strengths already handed out, so a point asked about more than once (a span
+    // center for every light and every render pass) is only evaluated once. Entries
+    // are good as long as no volume anywhere has changed since, which fVersion tracks.
+    enum { kNumCachedStrengths = 256 };
+    class CachedStrength
+    {
+    public:
+        hsPoint3    fPos;
+        float       fStrength;
+        uint32_t    fVersion;
+    };
+    mutable CachedStrength*     fCache;
+
+    static uint32_t             fVersion;
+    static bool                 fUseCache;
+
     virtual float        IUpdateListenerStrength() const;
 
     float                IRemapStrength(float s) const { return fOutsideStrength + s * (fInsideStrength - fOutsideStrength); }
 
+    CachedStrength*      ICacheSlot(const hsPoint3& pos) const;
+
 private:
     // Don't call this, use public GetStrength().
     virtual float        IGetStrength(const hsPoint3& pos) const = 0;
+    // Or this, use public GetStrengths(). Defaults to IGetStrength on each point.
+    virtual void         IGetStrengths(const hsPoint3* pos, int num, float* strengths) const;
 
 public:
     plSoftVolume();
@@ -89,6 +110,12 @@ public:
     GETINTERFACE_ANY( plSoftVolume, plRegionBase );
 
     virtual float GetStrength(const hsPoint3& pos) const;
+    // GetStrength without the cache, for volumes evaluating their children.
+    float EvalStrength(const hsPoint3& pos) const { return IRemapStrength(IGetStrength(pos)); }
+    // EvalStrength for each of num points, into strengths.
+    void GetStrengths(const hsPoint3* pos, int num, float* strengths) const;
+    // Evaluates num points in one batch and caches them for GetStrength.
+    void CacheStrengths(const hsPoint3* pos, int num) const;
     virtual bool IsInside(const hsPoint3& pos) const { return GetStrength(pos) >= 1.f; }
 
     virtual void SetTransform(const hsMatrix44& l2w, const hsMatrix44& w2l) = 0;
@@ -102,6 +129,8 @@ public:
 
     virtual bool MsgReceive(plMessage* msg);
 
+    virtual void SetProperty(int prop, bool on);
+
     virtual void Read(hsStream* stream, hsResMgr* mgr);
     virtual void Write(hsStream* stream, hsResMgr* mgr);
 
@@ -110,6 +139,13 @@ public:
 
     float GetInsideStrength() const { return fInsideStrength; }
     float GetOutsideStrength() const { return fOutsideStrength; }
+
+    // Anything that changes what some volume would return must call this,
+    // which drops every cached strength and listener strength.
+    static void DirtyCaches() { fVersion++; }
+
+    static void SetUseCache(bool on) { fUseCache = on; DirtyCaches(); }
+    static bool GetUseCache() { return fUseCache; }
 };
 
 #endif // plSoftVolume_inc
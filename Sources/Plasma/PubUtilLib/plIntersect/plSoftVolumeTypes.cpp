@@ -49,6 +49,9 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plVolumeIsect.h"
 #include "plSoftVolumeTypes.h"
 
+// Complex volumes evaluate their children this many points at a time.
+static const int kBatchChunk = 64;
+
 /////////////////////////////////////////////////////////////////////////////
 /////////////////////////////////////////////////////////////////////////////
 
@@ -81,10 +84,35 @@ float plSoftVolumeSimple::IGetStrength(const hsPoint3& pos) const
     return 1.f - dist;
 }
 
+void plSoftVolumeSimple::IGetStrengths(const hsPoint3* pos, int num, float* strengths) const
+{
+    int i;
+    if( !fVolume || GetProperty(kDisable) )
+    {
+        for( i = 0; i < num; i++ )
+            strengths[i] = 0;
+        return;
+    }
+
+    fVolume->TestBatch(pos, num, strengths);
+
+    for( i = 0; i < num; i++ )
+    {
+        float dist = strengths[i];
+        if( dist <= 0 )
+            strengths[i] = 1.f;
+        else if( dist >= fSoftDist )
+            strengths[i] = 0;
+        else
+            strengths[i] = 1.f - dist / fSoftDist;
+    }
+}
+
 void plSoftVolumeSimple::SetTransform(const hsMatrix44& l2w, const hsMatrix44& w2l)
 {
     if( fVolume )
         fVolume->SetTransform(l2w, w2l);
+    DirtyCaches();
 }
 
 void plSoftVolumeSimple::Read(hsStream* s, hsResMgr* mgr)
@@ -94,6 +122,7 @@ void plSoftVolumeSimple::Read(hsStream* s, hsResMgr* mgr)
     fSoftDist = s->ReadLEScalar();
 
     fVolume = plVolumeIsect::ConvertNoRef(mgr->ReadCreatable(s));
+    DirtyCaches();
 }
 
 void plSoftVolumeSimple::Write(hsStream* s, hsResMgr* mgr)
@@ -109,6 +138,7 @@ void plSoftVolumeSimple::SetVolume(plVolumeIsect* v)
 {
     delete fVolume;
     fVolume = v;
+    DirtyCaches();
 }
 
 /////////////////////////////////////////////////////////////////////////////
@@ -160,6 +190,7 @@ bool plSoftVolumeComplex::MsgReceive(plMessage* msg)
             if( idx != fSubVolumes.kMissingIndex )
                 fSubVolumes.Remove(idx);
         }
+        DirtyCaches();
         return true;
     }
     return plSoftVolume::MsgReceive(msg);
@@ -190,7 +221,7 @@ float plSoftVolumeUnion::IGetStrength(const hsPoint3& pos) const
     int i;
     for( i = 0; i < fSubVolumes.GetCount(); i++ )
     {
-        float subRet = fSubVolumes[i]->GetStrength(pos);
+        float subRet = fSubVolumes[i]->EvalStrength(pos);
         if( subRet >= 1.f )
             return 1.f;
         if( subRet > retVal )
@@ -199,6 +230,51 @@ float plSoftVolumeUnion::IGetStrength(const hsPoint3& pos) const
     return retVal;
 }
 
+void plSoftVolumeUnion::IGetStrengths(const hsPoint3* pos, int num, float* strengths) const
+{
+    hsPoint3 subPos[kBatchChunk];
+    float sub[kBatchChunk];
+    int idx[kBatchChunk];
+    int first;
+    for( first = 0; first < num; first += kBatchChunk )
+    {
+        const int cnt = hsMinimum(kBatchChunk, num - first);
+        float* dst = strengths + first;
+
+        int j;
+        for( j = 0; j < cnt; j++ )
+            dst[j] = 0;
+
+        int i;
+        for( i = 0; i < fSubVolumes.GetCount(); i++ )
+        {
+            // Points already fully inside are done, like the early out in IGetStrength.
+            int n = 0;
+            for( j = 0; j < cnt; j++ )
+            {
+                if( dst[j] < 1.f )
+                {
+                    idx[n] = j;
+                    subPos[n++] = pos[first + j];
+                }
+            }
+            if( !n )
+                break;
+
+            fSubVolumes[i]->GetStrengths(subPos, n, sub);
+            int k;
+            for( k = 0; k < n; k++ )
+            {
+                j = idx[k];
+                if( sub[k] >= 1.f )
+                    dst[j] = 1.f;
+                else if( sub[k] > dst[j] )
+                    dst[j] = sub[k];
+            }
+        }
+    }
+}
+
 float plSoftVolumeUnion::IUpdateListenerStrength() const
 {
     float retVal = 0;
@@ -234,7 +310,7 @@ float plSoftVolumeIntersect::IGetStrength(const hsPoint3& pos) const
     int i;
     for( i = 0; i < fSubVolumes.GetCount(); i++ )
     {
-        float subRet = fSubVolumes[i]->GetStrength(pos);
+        float subRet = fSubVolumes[i]->EvalStrength(pos);
         if( subRet <= 0 )
             return 0;
         if( subRet < retVal )
@@ -243,6 +319,51 @@ float plSoftVolumeIntersect::IGetStrength(const hsPoint3& pos) const
     return retVal;
 }
 
+void plSoftVolumeIntersect::IGetStrengths(const hsPoint3* pos, int num, float* strengths) const
+{
+    hsPoint3 subPos[kBatchChunk];
+    float sub[kBatchChunk];
+    int idx[kBatchChunk];
+    int first;
+    for( first = 0; first < num; first += kBatchChunk )
+    {
+        const int cnt = hsMinimum(kBatchChunk, num - first);
+        float* dst = strengths + first;
+
+        int j;
+        for( j = 0; j < cnt; j++ )
+            dst[j] = 1.f;
+
+        int i;
+        for( i = 0; i < fSubVolumes.GetCount(); i++ )
+        {
+            // Points already outside are done, like the early out in IGetStrength.
+            int n = 0;
+            for( j = 0; j < cnt; j++ )
+            {
+                if( dst[j] > 0 )
+                {
+                    idx[n] = j;
+                    subPos[n++] = pos[first + j];
+                }
+            }
+            if( !n )
+                break;
+
+            fSubVolumes[i]->GetStrengths(subPos, n, sub);
+            int k;
+            for( k = 0; k < n; k++ )
+            {
+                j = idx[k];
+                if( sub[k] <= 0 )
+                    dst[j] = 0;
+                else if( sub[k] < dst[j] )
+                    dst[j] = sub[k];
+            }
+        }
+    }
+}
+
 float plSoftVolumeIntersect::IUpdateListenerStrength() const
 {
     float retVal = 1.f;
@@ -276,11 +397,28 @@ float plSoftVolumeInvert::IGetStrength(const hsPoint3& pos) const
 {
     hsAssert(fSubVolumes.GetCount() <= 1, "Too many subvolumes on inverter");
     if( fSubVolumes.GetCount() )
-        return 1.f - fSubVolumes[0]->GetStrength(pos);
+        return 1.f - fSubVolumes[0]->EvalStrength(pos);
 
     return 1.f;
 }
 
+void plSoftVolumeInvert::IGetStrengths(const hsPoint3* pos, int num, float* strengths) const
+{
+    hsAssert(fSubVolumes.GetCount() <= 1, "Too many subvolumes on inverter");
+    int i;
+    if( fSubVolumes.GetCount() )
+    {
+        fSubVolumes[0]->GetStrengths(pos, num, strengths);
+        for( i = 0; i < num; i++ )
+            strengths[i] = 1.f - strengths[i];
+    }
+    else
+    {
+        for( i = 0; i < num; i++ )
+            strengths[i] = 1.f;
+    }
+}
+
 float plSoftVolumeInvert::IUpdateListenerStrength() const
 {
     hsAssert(fSubVolumes.GetCount() <= 1, "Too many subvolumes on inverter");
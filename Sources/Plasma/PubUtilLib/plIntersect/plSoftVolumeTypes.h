@@ -56,6 +56,7 @@ protected:
 
 private:
     virtual float            IGetStrength(const hsPoint3& pos) const;
+    virtual void                IGetStrengths(const hsPoint3* pos, int num, float* strengths) const;
 
 public:
     plSoftVolumeSimple();
@@ -74,7 +75,7 @@ public:
     void SetVolume(plVolumeIsect* v); // Takes ownership, don't delete after giving to SoftVolume
 
     float GetDistance() const { return fSoftDist; }
-    void SetDistance(float d) { fSoftDist = d; }
+    void SetDistance(float d) { fSoftDist = d; DirtyCaches(); }
 
 };
 
@@ -112,6 +113,7 @@ protected:
 
 private:
     virtual float            IGetStrength(const hsPoint3& pos) const;
+    virtual void                IGetStrengths(const hsPoint3* pos, int num, float* strengths) const;
 
 public:
     plSoftVolumeUnion();
@@ -129,6 +131,7 @@ protected:
 
 private:
     virtual float            IGetStrength(const hsPoint3& pos) const;
+    virtual void                IGetStrengths(const hsPoint3* pos, int num, float* strengths) const;
 
 public:
     plSoftVolumeIntersect();
@@ -146,6 +149,7 @@ protected:
 
 private:
     virtual float            IGetStrength(const hsPoint3& pos) const;
+    virtual void                IGetStrengths(const hsPoint3* pos, int num, float* strengths) const;
 
 public:
     plSoftVolumeInvert();
@@ -48,8 +48,36 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "hsResMgr.h"
 #include "plIntersect/plClosest.h"
 
+#ifdef HS_SIMD_INCLUDE
+#  include HS_SIMD_INCLUDE
+#endif
+
 static const float kDefLength = 5.f;
 
+// Points are batched a chunk at a time wherever a volume needs scratch space
+// for its children's results.
+static const int kBatchChunk = 64;
+
+hsFunctionDispatcher<plSphereIsect::test_points_ptr> plSphereIsect::test_points(plSphereIsect::test_points_fpu, plSphereIsect::test_points_sse1);
+hsFunctionDispatcher<plConvexIsect::test_points_ptr> plConvexIsect::test_points(plConvexIsect::test_points_fpu, plConvexIsect::test_points_sse1);
+
+void plVolumeIsect::TestBatch(const hsPoint3* pos, int num, float* dists) const
+{
+    int i;
+    for( i = 0; i < num; i++ )
+        dists[i] = Test(pos[i]);
+}
+
+#ifdef HS_SSE1
+// Gathers four points into x, y and z registers.
+static inline void ILoadPoints(const hsPoint3* pos, __m128& x, __m128& y, __m128& z)
+{
+    x = _mm_setr_ps(pos[0].fX, pos[1].fX, pos[2].fX, pos[3].fX);
+    y = _mm_setr_ps(pos[0].fY, pos[1].fY, pos[2].fY, pos[3].fY);
+    z = _mm_setr_ps(pos[0].fZ, pos[1].fZ, pos[2].fZ, pos[3].fZ);
+}
+#endif // HS_SSE1
+
 plSphereIsect::plSphereIsect()
 :   fRadius(1.f)
 {
@@ -149,6 +177,51 @@ float plSphereIsect::Test(const hsPoint3& pos) const
     return dist - fRadius;
 }
 
+void plSphereIsect::TestBatch(const hsPoint3* pos, int num, float* dists) const
+{
+    test_points.call(pos, num, fWorldCenter, fRadius, dists);
+}
+
+void plSphereIsect::test_points_fpu(const hsPoint3* pos, int num, const hsPoint3& center, float radius, float* dists)
+{
+    int i;
+    for( i = 0; i < num; i++ )
+    {
+        float dist = (pos[i] - center).MagnitudeSquared();
+        if( dist < radius*radius )
+            dists[i] = 0;
+        else
+            dists[i] = float(sqrt(dist)) - radius;
+    }
+}
+
+void plSphereIsect::test_points_sse1(const hsPoint3* pos, int num, const hsPoint3& center, float radius, float* dists)
+{
+#ifdef HS_SSE1
+    const __m128 cx = _mm_set1_ps(center.fX);
+    const __m128 cy = _mm_set1_ps(center.fY);
+    const __m128 cz = _mm_set1_ps(center.fZ);
+    const __m128 rad = _mm_set1_ps(radius);
+    const __m128 radSq = _mm_set1_ps(radius*radius);
+
+    int i;
+    for( i = 0; i + 4 <= num; i += 4 )
+    {
+        __m128 x, y, z;
+        ILoadPoints(pos + i, x, y, z);
+        x = _mm_sub_ps(x, cx);
+        y = _mm_sub_ps(y, cy);
+        z = _mm_sub_ps(z, cz);
+        __m128 distSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y)), _mm_mul_ps(z, z));
+
+        __m128 inside = _mm_cmplt_ps(distSq, radSq);
+        __m128 dist = _mm_sub_ps(_mm_sqrt_ps(distSq), rad);
+        _mm_storeu_ps(dists + i, _mm_andnot_ps(inside, dist));
+    }
+    test_points_fpu(pos + i, num - i, center, radius, dists + i);
+#endif // HS_SSE1
+}
+
 void plSphereIsect::Read(hsStream* s, hsResMgr* mgr)
 {
     fCenter.Read(s);
@@ -775,6 +848,56 @@ float plConvexIsect::Test(const hsPoint3& pos) const
     return maxDist;
 }
 
+void plConvexIsect::TestBatch(const hsPoint3* pos, int num, float* dists) const
+{
+    test_points.call(pos, num, fPlanes.GetCount() ? &fPlanes[0] : nil, fPlanes.GetCount(), dists);
+}
+
+void plConvexIsect::test_points_fpu(const hsPoint3* pos, int num, const SinglePlane* planes, int numPlanes, float* dists)
+{
+    int i;
+    for( i = 0; i < num; i++ )
+    {
+        float maxDist = 0;
+        int j;
+        for( j = 0; j < numPlanes; j++ )
+        {
+            float dist = planes[j].fWorldNorm.InnerProduct(pos[i]) - planes[j].fWorldDist;
+
+            if( dist > maxDist )
+                maxDist = dist;
+        }
+        dists[i] = maxDist;
+    }
+}
+
+void plConvexIsect::test_points_sse1(const hsPoint3* pos, int num, const SinglePlane* planes, int numPlanes, float* dists)
+{
+#ifdef HS_SSE1
+    int i;
+    for( i = 0; i + 4 <= num; i += 4 )
+    {
+        __m128 x, y, z;
+        ILoadPoints(pos + i, x, y, z);
+
+        __m128 maxDist = _mm_setzero_ps();
+        int j;
+        for( j = 0; j < numPlanes; j++ )
+        {
+            const hsVector3& norm = planes[j].fWorldNorm;
+            __m128 dist = _mm_mul_ps(x, _mm_set1_ps(norm.fX));
+            dist = _mm_add_ps(dist, _mm_mul_ps(y, _mm_set1_ps(norm.fY)));
+            dist = _mm_add_ps(dist, _mm_mul_ps(z, _mm_set1_ps(norm.fZ)));
+            dist = _mm_sub_ps(dist, _mm_set1_ps(planes[j].fWorldDist));
+
+            maxDist = _mm_max_ps(dist, maxDist);
+        }
+        _mm_storeu_ps(dists + i, maxDist);
+    }
+    test_points_fpu(pos + i, num - i, planes, numPlanes, dists + i);
+#endif // HS_SSE1
+}
+
 void plConvexIsect::Read(hsStream* s, hsResMgr* mgr)
 {
     int16_t n = s->ReadLE16();
@@ -957,6 +1080,37 @@ float plUnionIsect::Test(const hsPoint3& pos) const
     return retVal;
 }
 
+void plUnionIsect::TestBatch(const hsPoint3* pos, int num, float* dists) const
+{
+    float sub[kBatchChunk];
+    int first;
+    for( first = 0; first < num; first += kBatchChunk )
+    {
+        const int cnt = hsMinimum(kBatchChunk, num - first);
+        float* dst = dists + first;
+
+        int j;
+        for( j = 0; j < cnt; j++ )
+            dst[j] = 1.e33f;
+
+        int i;
+        for( i = 0; i < fVolumes.GetCount(); i++ )
+        {
+            fVolumes[i]->TestBatch(pos + first, cnt, sub);
+            for( j = 0; j < cnt; j++ )
+            {
+                if( dst[j] > 0 )
+                {
+                    if( sub[j] <= 0 )
+                        dst[j] = 0;
+                    else if( sub[j] < dst[j] )
+                        dst[j] = sub[j];
+                }
+            }
+        }
+    }
+}
+
 ///////////////////////////////////////////////////////////////////////////
 ///////////////////////////////////////////////////////////////////////////
 
@@ -1003,3 +1157,29 @@ float plIntersectionIsect::Test(const hsPoint3& pos) const
     return retVal;
 }
 
+void plIntersectionIsect::TestBatch(const hsPoint3* pos, int num, float* dists) const
+{
+    float sub[kBatchChunk];
+    int first;
+    for( first = 0; first < num; first += kBatchChunk )
+    {
+        const int cnt = hsMinimum(kBatchChunk, num - first);
+        float* dst = dists + first;
+
+        int j;
+        for( j = 0; j < cnt; j++ )
+            dst[j] = -1.f;
+
+        int i;
+        for( i = 0; i < fVolumes.GetCount(); i++ )
+        {
+            fVolumes[i]->TestBatch(pos + first, cnt, sub);
+            for( j = 0; j < cnt; j++ )
+            {
+                if( sub[j] > dst[j] )
+                    dst[j] = sub[j];
+            }
+        }
+    }
+}
+
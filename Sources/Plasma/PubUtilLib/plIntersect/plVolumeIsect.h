@@ -47,6 +47,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "hsMatrix44.h"
 #include "hsTemplates.h"
 #include "hsBounds.h"
+#include "hsCpuID.h"
 
 #include "pnFactory/plCreatable.h"
 
@@ -70,6 +71,9 @@ public:
     virtual plVolumeCullResult  Test(const hsBounds3Ext& bnd) const = 0;    
     virtual float            Test(const hsPoint3& pos) const = 0;
 
+    // Test(pos) for each of num points, into dists.
+    virtual void                TestBatch(const hsPoint3* pos, int num, float* dists) const;
+
     virtual void Read(hsStream* s, hsResMgr* mgr) = 0;
     virtual void Write(hsStream* s, hsResMgr* mgr) = 0;
 };
@@ -82,6 +86,11 @@ protected:
     float            fRadius;
     hsPoint3            fMins;
     hsPoint3            fMaxs;
+
+    typedef void(*test_points_ptr)(const hsPoint3* pos, int num, const hsPoint3& center, float radius, float* dists);
+    static void test_points_fpu(const hsPoint3* pos, int num, const hsPoint3& center, float radius, float* dists);
+    static void test_points_sse1(const hsPoint3* pos, int num, const hsPoint3& center, float radius, float* dists);
+    static hsFunctionDispatcher<test_points_ptr> test_points;
 public:
     plSphereIsect();
     virtual ~plSphereIsect();
@@ -98,6 +107,7 @@ public:
 
     virtual plVolumeCullResult  Test(const hsBounds3Ext& bnd) const;    
     virtual float            Test(const hsPoint3& pos) const; // return 0 if point inside, else "distance" from pos to volume
+    virtual void                TestBatch(const hsPoint3* pos, int num, float* dists) const;
 
     virtual void Read(hsStream* s, hsResMgr* mgr);
     virtual void Write(hsStream* s, hsResMgr* mgr);
@@ -230,6 +240,11 @@ protected:
 
     hsTArray<SinglePlane>   fPlanes;
 
+    typedef void(*test_points_ptr)(const hsPoint3* pos, int num, const SinglePlane* planes, int numPlanes, float* dists);
+    static void test_points_fpu(const hsPoint3* pos, int num, const SinglePlane* planes, int numPlanes, float* dists);
+    static void test_points_sse1(const hsPoint3* pos, int num, const SinglePlane* planes, int numPlanes, float* dists);
+    static hsFunctionDispatcher<test_points_ptr> test_points;
+
 public:
     plConvexIsect();
     virtual ~plConvexIsect();
@@ -246,6 +261,7 @@ public:
 
     virtual plVolumeCullResult  Test(const hsBounds3Ext& bnd) const;
     virtual float            Test(const hsPoint3& pos) const;
+    virtual void                TestBatch(const hsPoint3* pos, int num, float* dists) const;
 
     virtual void Read(hsStream* s, hsResMgr* mgr);
     virtual void Write(hsStream* s, hsResMgr* mgr);
@@ -306,6 +322,7 @@ public:
 
     virtual plVolumeCullResult  Test(const hsBounds3Ext& bnd) const;
     virtual float            Test(const hsPoint3& pos) const;
+    virtual void                TestBatch(const hsPoint3* pos, int num, float* dists) const;
 };
 
 class plIntersectionIsect : public plComplexIsect
@@ -319,6 +336,7 @@ public:
 
     virtual plVolumeCullResult  Test(const hsBounds3Ext& bnd) const;
     virtual float            Test(const hsPoint3& pos) const;
+    virtual void                TestBatch(const hsPoint3* pos, int num, float* dists) const;
 };
 
 #endif // plVolumeIsect_inc
@@ -241,6 +241,9 @@ REGISTER_CREATABLE(plRoomLoadNotifyMsg);
 #include "plMemberUpdateMsg.h"
 REGISTER_CREATABLE(plMemberUpdateMsg);
 
+#include "plSDLDeltaResyncMsg.h"
+REGISTER_CREATABLE(plSDLDeltaResyncMsg);
+
 #include "plAgeLoadedMsg.h"
 REGISTER_CREATABLE(plAgeLoadedMsg);
 REGISTER_CREATABLE(plAgeLoaded2Msg);
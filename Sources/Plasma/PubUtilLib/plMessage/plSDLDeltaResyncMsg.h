@@ -0,0 +1,85 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+#ifndef plSDLDeltaResyncMsg_INC
+#define plSDLDeltaResyncMsg_INC
+
+#include "pnMessage/plMessage.h"
+#include "pnKeyedObject/plUoid.h"
+#include "hsStream.h"
+#include "plString.h"
+
+//
+// Sent by a client which lost track of a remote player's delta encoded
+// state (see plSDLDeltaChain), to that player's netClientMgr.  The
+// player answers with a full send of the state, which starts a new chain.
+//
+class plSDLDeltaResyncMsg : public plMessage
+{
+protected:
+    plUoid      fUoid;
+    plString    fSDLName;
+public:
+    CLASSNAME_REGISTER( plSDLDeltaResyncMsg );
+    GETINTERFACE_ANY( plSDLDeltaResyncMsg, plMessage );
+
+    plSDLDeltaResyncMsg() {}
+    plSDLDeltaResyncMsg(const plUoid& uoid, const plString& sdlName) : fUoid(uoid), fSDLName(sdlName) {}
+
+    const plUoid& GetUoid() const { return fUoid; }
+    const plString& GetSDLName() const { return fSDLName; }
+
+    // IO 
+    void Read(hsStream* stream, hsResMgr* mgr)
+    {
+        plMessage::IMsgRead(stream, mgr);
+        fUoid.Read(stream);
+        fSDLName = stream->ReadSafeString_TEMP();
+    }
+    void Write(hsStream* stream, hsResMgr* mgr)
+    {
+        plMessage::IMsgWrite(stream, mgr);
+        fUoid.Write(stream);
+        stream->WriteSafeString(fSDLName);
+    }
+};
+
+#endif      // plSDLDeltaResyncMsg_INC
@@ -60,6 +60,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plMessage/plLoadAgeMsg.h"
 #include "plMessage/plAgeLoadedMsg.h"
 #include "plMessage/plInputIfaceMgrMsg.h"
+#include "plSDL/plSDL.h"
 
 
 
@@ -224,6 +225,9 @@ void plNCAgeLeaver::ExecNextOp () {
             nc->ISendCameraReset(false/*leaving age*/);         // reset camera
             nc->IUnloadRemotePlayers();                         // unload other players
             nc->IUnloadNPCs();                                  // unload non-player clones
+            nc->fInterest.Reset();                              // forget low priority states and msgs held back, the game server's gone
+            plSDLMgr::GetInstance()->ClearDeltaChains();        // forget what delta encoded states were relative to
+            plSDLMgr::GetInstance()->ClearDeltaPeers();         // and who could read them
 
             if (NetCommNeedToLoadAvatar())
                 am->UnLoadLocalPlayer();
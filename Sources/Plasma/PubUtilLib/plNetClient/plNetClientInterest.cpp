@@ -0,0 +1,342 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+#include "plNetClientInterest.h"
+#include "plNetClientMgr.h"
+
+#include "pnMessage/plMessage.h"
+#include "pnNetCommon/plSDLTypes.h"
+#include "pnSceneObject/plSceneObject.h"
+
+#include "plAvatar/plAvatarMgr.h"
+#include "plAvatar/plArmatureMod.h"
+#include "plMessage/plInputEventMsg.h"
+#include "plNetMessage/plNetMessage.h"
+#include "plNetTransport/plNetTransportMember.h"
+#include "plScene/plRelevanceMgr.h"
+
+#include <algorithm>
+
+static const double kDefaultDeferInterval = 5.0;   // secs between updates nobody can see
+static const double kHintInterval = 1.0;           // secs between relevance hint updates
+
+plNetClientInterest::plNetClientInterest() :
+    fEnabled(true),
+    fSendHints(false),
+    fDeferInterval(kDefaultDeferInterval),
+    fMsgsHeldSince(0),
+    fLastHintSend(0)
+{
+}
+
+plNetClientInterest::~plNetClientInterest()
+{
+    Reset();
+}
+
+void plNetClientInterest::Reset()
+{
+    int i;
+    for (i = 0; i < fDeferredMsgs.size(); i++)
+        delete fDeferredMsgs[i].fNetMsg;
+    fDeferredMsgs.clear();
+    fDeferred.clear();
+    fInterestedPlayers.clear();
+    fLastHintSend = 0;
+}
+
+//
+// Without regions everybody cares about everything
+//
+bool plNetClientInterest::IRegionsActive() const
+{
+    plRelevanceMgr* mgr = plRelevanceMgr::Instance();
+    return mgr && mgr->GetEnabled() && mgr->GetNumRegions() > 1;
+}
+
+//
+// Same test the server does for kUseRelevanceRegions msgs: does any remote
+// player care about a region the object is in. Remote players whose avatar
+// isn't loaded yet count as caring.
+//
+bool plNetClientInterest::IAnyoneCares(const plKey& objKey, std::vector<uint32_t>* players) const
+{
+    hsBitVector regionsImIn, regionsICareAbout;
+
+    plSceneObject* so = objKey ? plSceneObject::ConvertNoRef(objKey->ObjectIsLoaded()) : nil;
+    if (so)
+        plRelevanceMgr::Instance()->SetRegionVectors(so->GetLocalToWorld().GetTranslate(), regionsImIn, regionsICareAbout);
+    else
+    {
+        const plArmatureMod* localAvatar = plAvatarMgr::GetInstance()->GetLocalAvatar();
+        if (!localAvatar)
+            return true;
+        regionsImIn = localAvatar->GetRelRegionImIn();
+    }
+
+    bool cares = false;
+    const plNetTransport& transport = plNetClientMgr::GetInstance()->TransportMgr();
+    int i;
+    for (i = 0; i < transport.GetNumMembers(); i++)
+    {
+        plNetTransportMember* mbr = transport.GetMember(i);
+        if (!mbr || mbr->IsServer())
+            continue;
+
+        plKey avKey = mbr->GetAvatarKey();
+        plArmatureMod* avMod = avKey ? plAvatarMgr::FindAvatar(avKey) : nil;
+        if (!avMod || avMod->GetRelRegionCareAbout().Overlap(regionsImIn))
+        {
+            cares = true;
+            if (!players)
+                break;
+            players->push_back(mbr->GetPlayerID());
+        }
+    }
+    return cares;
+}
+
+bool plNetClientInterest::IIsLowPriority(uint32_t sendFlags, const char* sdlName) const
+{
+    return (sendFlags & plSynchedObject::kUseRelevanceRegions) ||
+        !stricmp(sdlName, kSDLParticleSystem);
+}
+
+plNetClientInterest::DeferredState* plNetClientInterest::IFindDeferred(const plKey& objKey, const char* sdlName)
+{
+    DeferredStateVec::iterator it;
+    for (it = fDeferred.begin(); it != fDeferred.end(); it++)
+    {
+        if ((*it).fObjKey == objKey && !stricmp((*it).fSDLName.c_str(), sdlName))
+            return &(*it);
+    }
+
+    DeferredState state;
+    state.fObjKey = objKey;
+    state.fSDLName = sdlName;
+    fDeferred.push_back(state);
+    return &fDeferred.back();
+}
+
+void plNetClientInterest::Update(double secs)
+{
+    if (!fSendHints || !IRegionsActive())
+        return;
+
+    plArmatureMod* localAvatar = plAvatarMgr::GetInstance()->GetLocalAvatar();
+    if (!localAvatar || !localAvatar->GetTarget(0))
+        return;
+
+    if (secs - fLastHintSend < kHintInterval)
+        return;
+
+    std::vector<uint32_t> players;
+    IAnyoneCares(localAvatar->GetTarget(0)->GetKey(), &players);
+    std::sort(players.begin(), players.end());
+    if (players == fInterestedPlayers)
+        return;
+
+    fInterestedPlayers = players;
+    fLastHintSend = secs;
+
+    // The hints ride along with the regions, SendMsg attaches them
+    plNetMsgRelevanceRegions relRegionsNetMsg;
+    relRegionsNetMsg.SetNetProtocol(kNetProtocolCli2Game);
+    relRegionsNetMsg.SetRegionsICareAbout(localAvatar->GetRelRegionCareAbout());
+    relRegionsNetMsg.SetRegionsImIn(localAvatar->GetRelRegionImIn());
+    plNetClientMgr::GetInstance()->SendMsg(&relRegionsNetMsg);
+}
+
+//
+// Which held back msgs a newer one makes moot.  Input states are the whole
+// state, only the latest matters.  A control event only replaces a repeat of
+// itself, presses and releases all go out.
+//
+static int32_t ICoalesceCode(plMessage* msg)
+{
+    if (plAvatarInputStateMsg::ConvertNoRef(msg))
+        return 0;
+
+    plControlEventMsg* ctrlMsg = plControlEventMsg::ConvertNoRef(msg);
+    if (ctrlMsg && !ctrlMsg->GetCmdString())
+        return ctrlMsg->GetControlCode() * 2 + (ctrlMsg->ControlActivated() ? 1 : 0);
+
+    return -1;
+}
+
+bool plNetClientInterest::AllowGameMessage(plMessage* msg, plNetMsgGameMessage* netMsg, double secs)
+{
+    uint32_t bytes = netMsg->StreamInfo()->GetStreamLen();
+
+    // Msgs for particular players were asked for, they always go. 
+    // So does everything once somebody cares, unless older msgs are still waiting
+    bool send = !fEnabled || !IRegionsActive() || plNetMsgGameMessageDirected::ConvertNoRef(netMsg) ||
+        (fDeferredMsgs.empty() && IAnyoneCares(msg->GetSender()));
+    if (send)
+    {
+        fStats.fMsgsSent++;
+        fStats.fMsgBytesSent += bytes;
+        return true;
+    }
+
+    DeferredMsg deferred;
+    deferred.fSender = msg->GetSender();
+    deferred.fClassIdx = msg->ClassIndex();
+    deferred.fCoalesceCode = ICoalesceCode(msg);
+    deferred.fNetMsg = netMsg;
+
+    if (deferred.fCoalesceCode != -1)
+    {
+        DeferredMsgVec::iterator it;
+        for (it = fDeferredMsgs.begin(); it != fDeferredMsgs.end(); it++)
+        {
+            if ((*it).fSender == deferred.fSender && (*it).fClassIdx == deferred.fClassIdx &&
+                (*it).fCoalesceCode == deferred.fCoalesceCode)
+            {
+                // the newer one goes out where it would have, after everything held before it
+                fStats.fMsgsCoalesced++;
+                fStats.fMsgBytesCoalesced += (*it).fNetMsg->StreamInfo()->GetStreamLen();
+                delete (*it).fNetMsg;
+                fDeferredMsgs.erase(it);
+                break;
+            }
+        }
+    }
+
+    if (fDeferredMsgs.empty())
+        fMsgsHeldSince = secs;
+    fDeferredMsgs.push_back(deferred);
+    fStats.fMsgsDeferred++;
+    return false;
+}
+
+void plNetClientInterest::PopDueMsgs(double secs, bool flushAll, std::vector<plNetMsgGameMessage*>& due)
+{
+    if (fDeferredMsgs.empty())
+        return;
+
+    // They all go together, so they stay in order
+    if (flushAll || !fEnabled || !IRegionsActive() || secs - fMsgsHeldSince >= fDeferInterval ||
+        IAnyoneCares(fDeferredMsgs.front().fSender))
+    {
+        int i;
+        for (i = 0; i < fDeferredMsgs.size(); i++)
+        {
+            fStats.fMsgsSent++;
+            fStats.fMsgBytesSent += fDeferredMsgs[i].fNetMsg->StreamInfo()->GetStreamLen();
+            due.push_back(fDeferredMsgs[i].fNetMsg);
+        }
+        fDeferredMsgs.clear();
+    }
+}
+
+bool plNetClientInterest::AllowDirtyState(plSynchedObject::StateDefn* state, double secs)
+{
+    if (!fEnabled || !IIsLowPriority(state->fSendFlags, state->fSDLName.c_str()) || !IRegionsActive())
+        return true;
+
+    DeferredState* deferred = IFindDeferred(state->fObjKey, state->fSDLName.c_str());
+
+    // Full sends are for people joining, they always go
+    bool send = (state->fSendFlags & plSynchedObject::kForceFullSend) ||
+        IAnyoneCares(state->fObjKey) ||
+        (!deferred->fHeld && secs - deferred->fLastSent >= fDeferInterval);
+
+    if (send)
+    {
+        // Anything held goes out with this one
+        state->fSendFlags |= deferred->fHeld ? deferred->fSendFlags : 0;
+        deferred->fHeld = false;
+        deferred->fLastSent = secs;
+        return true;
+    }
+
+    if (deferred->fHeld)
+        fStats.fStatesCoalesced++;
+    else
+    {
+        fStats.fStatesDeferred++;
+        deferred->fHeld = true;
+        deferred->fSendFlags = 0;
+    }
+    deferred->fSendFlags |= state->fSendFlags;
+    return false;
+}
+
+void plNetClientInterest::PopDueStates(double secs, bool flushAll, std::vector<plSynchedObject::StateDefn>& due)
+{
+    bool regionsActive = IRegionsActive();
+
+    DeferredStateVec::iterator it = fDeferred.begin();
+    while (it != fDeferred.end())
+    {
+        // Don't keep keys to things that have gone away
+        if (!(*it).fObjKey->ObjectIsLoaded())
+        {
+            it = fDeferred.erase(it);
+            continue;
+        }
+
+        if ((*it).fHeld && (flushAll || !fEnabled || !regionsActive ||
+            secs - (*it).fLastSent >= fDeferInterval || IAnyoneCares((*it).fObjKey)))
+        {
+            due.push_back(plSynchedObject::StateDefn((*it).fObjKey, (*it).fSendFlags, (*it).fSDLName.c_str()));
+            (*it).fHeld = false;
+            (*it).fLastSent = secs;
+        }
+        it++;
+    }
+}
+
+void plNetClientInterest::NoteStateSent(uint32_t sendFlags, const char* sdlName, uint32_t bytes)
+{
+    if (IIsLowPriority(sendFlags, sdlName))
+    {
+        fStats.fStatesSent++;
+        fStats.fStateBytesSent += bytes;
+    }
+}
+
+void plNetClientInterest::AttachHints(plNetMsgRelevanceRegions* msg) const
+{
+    if (fSendHints)
+        msg->SetHintPlayerIDs(fInterestedPlayers);
+}
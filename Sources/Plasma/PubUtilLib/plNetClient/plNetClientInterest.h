@@ -0,0 +1,159 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+#ifndef plNetClientInterest_h
+#define plNetClientInterest_h
+
+#include "HeadSpin.h"
+#include "hsStlUtils.h"
+#include "hsBitVector.h"
+#include "pnKeyedObject/plKey.h"
+#include "pnNetCommon/plSynchedObject.h"
+
+class plMessage;
+class plNetMsgGameMessage;
+class plNetMsgRelevanceRegions;
+
+//
+// Client side interest management.
+// Uses the relevance regions of the local and remote avatars to decide
+// whether anybody in the age can see an outgoing low priority update
+// (avatar physics and control msgs, particle system state).
+// Nobody cares -> game msgs and dirty SDL states are held back and coalesced,
+// going out at most once every fDeferInterval secs until somebody cares again.
+// Game msgs are only coalesced where a newer one makes an older one moot, the
+// rest go out in order.
+//
+class plNetClientInterest
+{
+public:
+    struct Stats
+    {
+        uint32_t fMsgsSent;         // low priority game msgs sent
+        uint32_t fMsgBytesSent;
+        uint32_t fMsgsDeferred;     // game msgs held back
+        uint32_t fMsgsCoalesced;    // held back game msgs a newer one replaced
+        uint32_t fMsgBytesCoalesced;
+        uint32_t fStatesSent;       // low priority SDL states sent
+        uint32_t fStateBytesSent;
+        uint32_t fStatesDeferred;   // dirty SDL states held back
+        uint32_t fStatesCoalesced;  // sends saved by dirtying a state that was already held back
+
+        Stats() { Clear(); }
+        void Clear() { memset(this, 0, sizeof(*this)); }
+    };
+
+private:
+    // A low priority state we've seen, and whether it's being held back
+    struct DeferredState
+    {
+        plKey       fObjKey;
+        std::string fSDLName;
+        uint32_t    fSendFlags;
+        double      fLastSent;
+        bool        fHeld;
+        DeferredState() : fObjKey(nil), fSendFlags(0), fLastSent(0), fHeld(false) {}
+    };
+    typedef std::vector<DeferredState> DeferredStateVec;
+
+    // A low priority game msg held back, ready to send
+    struct DeferredMsg
+    {
+        plKey       fSender;
+        uint16_t    fClassIdx;
+        int32_t     fCoalesceCode;  // replaced by a newer msg with the same sender, class and code. -1 never is
+        plNetMsgGameMessage* fNetMsg;
+    };
+    typedef std::vector<DeferredMsg> DeferredMsgVec;
+
+    bool                fEnabled;
+    bool                fSendHints;
+    double              fDeferInterval;
+    DeferredStateVec    fDeferred;
+    DeferredMsgVec      fDeferredMsgs;      // in the order they're to go out
+    double              fMsgsHeldSince;
+    std::vector<uint32_t> fInterestedPlayers;   // remote players who care about the local avatar, sorted
+    double              fLastHintSend;
+    Stats               fStats;
+
+    bool IRegionsActive() const;
+    bool IAnyoneCares(const plKey& objKey, std::vector<uint32_t>* players=nil) const;
+    bool IIsLowPriority(uint32_t sendFlags, const char* sdlName) const;
+    DeferredState* IFindDeferred(const plKey& objKey, const char* sdlName);
+
+public:
+    plNetClientInterest();
+    ~plNetClientInterest();
+
+    void SetEnabled(bool e) { fEnabled = e; }
+    bool GetEnabled() const { return fEnabled; }
+
+    // Hints are the IDs of the remote players who care about us, tacked onto plNetMsgRelevanceRegions.
+    // Off by default, older servers don't expect them.
+    void SetSendHints(bool s) { fSendHints = s; }
+    bool GetSendHints() const { return fSendHints; }
+
+    void SetDeferInterval(double secs) { fDeferInterval = secs; }
+    double GetDeferInterval() const { return fDeferInterval; }
+
+    const Stats& GetStats() const { return fStats; }
+    void ClearStats() { fStats.Clear(); }
+
+    // Call once a frame, before the dirty states go out
+    void Update(double secs);
+    // Forget everything about the current age
+    void Reset();
+
+    // For game msgs flagged kNetUseRelevanceRegions. False means the net msg has been taken, 
+    // and will come back from PopDueMsgs
+    bool AllowGameMessage(plMessage* msg, plNetMsgGameMessage* netMsg, double secs);
+    // Held back game msgs that should go out now, in order. The caller sends and deletes them
+    void PopDueMsgs(double secs, bool flushAll, std::vector<plNetMsgGameMessage*>& due);
+    // For queued dirty states. False means it's been taken and will come back from PopDueStates.
+    bool AllowDirtyState(plSynchedObject::StateDefn* state, double secs);
+    // Held back states that should go out now
+    void PopDueStates(double secs, bool flushAll, std::vector<plSynchedObject::StateDefn>& due);
+    void NoteStateSent(uint32_t sendFlags, const char* sdlName, uint32_t bytes);
+
+    void AttachHints(plNetMsgRelevanceRegions* msg) const;
+};
+
+#endif  // plNetClientInterest_h
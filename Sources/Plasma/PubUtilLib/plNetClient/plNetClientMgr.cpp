@@ -86,6 +86,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plMessage/plNetClientMgrMsg.h"
 #include "plMessage/plResPatcherMsg.h"
 #include "plMessage/plVaultNotifyMsg.h"
+#include "plMessage/plSDLDeltaResyncMsg.h"
 #include "plResMgr/plKeyFinder.h"
 #include "plResMgr/plPageInfo.h"
 #include "plNetTransport/plNetTransportMember.h"
@@ -177,7 +178,8 @@ plNetClientMgr::~plNetClientMgr()
 //
 void plNetClientMgr::Shutdown()
 {
-    ISendDirtyState(hsTimer::GetSysSeconds());
+    ISendDirtyState(hsTimer::GetSysSeconds(), true);
+    ISendDeferredGameMsgs(hsTimer::GetSysSeconds(), true);
 
     plNetLinkingMgr::GetInstance()->LeaveAge(true);
 
@@ -581,7 +583,10 @@ int plNetClientMgr::Update(double secs)
     {
         MaybeSendPendingPagingRoomMsgs();
         ICheckPendingStateLoad(secs);
+        fInterest.Update(secs);
         ISendDirtyState(secs);
+        ISendDeferredGameMsgs(secs);
+        ISendDeltaResyncs();
         IUpdateListenList(secs);
         if (GetFlagsBit(plNetClientApp::kShowLists))
             IShowLists();
@@ -1088,6 +1093,13 @@ bool plNetClientMgr::MsgReceive( plMessage* msg )
         return true;
     }
 
+    plSDLDeltaResyncMsg* resync = plSDLDeltaResyncMsg::ConvertNoRef(msg);
+    if (resync)
+    {
+        IHandleDeltaResyncMsg(resync);
+        return true;
+    }
+
     plClientMsg* clientMsg = plClientMsg::ConvertNoRef(msg);
     if (clientMsg && clientMsg->GetClientMsgFlag()==plClientMsg::kInitComplete)
     {
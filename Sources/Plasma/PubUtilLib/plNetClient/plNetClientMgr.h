@@ -49,6 +49,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plNetVoiceList.h"
 #include "plNetClientMsgHandler.h"
 #include "plNetClientMsgScreener.h"
+#include "plNetClientInterest.h"
 
 #include "pnNetCommon/plNetApp.h"
 
@@ -80,6 +81,7 @@ class plNetVoiceListMsg;
 class plStateDataRecord;
 class plCCRPetitionMsg;
 class plNetMsgPagingRoom;
+class plSDLDeltaResyncMsg;
 
 
 struct plNetClientCommMsgHandler : plNetClientComm::MsgHandler {
@@ -178,6 +180,7 @@ private:
 
     plNetClientMsgHandler   fMsgHandler;
     plNetClientMsgScreener  fScreener;
+    plNetClientInterest     fInterest;
 
     // recorder support
     plNetClientRecorder* fMsgRecorder;
@@ -206,7 +209,10 @@ private:
     void IShowAvatars();
     void IShowRelevanceRegions();
     
-    int ISendDirtyState(double secs);
+    int ISendDirtyState(double secs, bool flushAll=false);
+    int ISendDeferredGameMsgs(double secs, bool flushAll=false);
+    void ISendDeltaResyncs();
+    void IHandleDeltaResyncMsg(plSDLDeltaResyncMsg* msg);
     int ISendMembersListRequest();
     int ISendRoomsReset();
     void ISendCCRPetition(plCCRPetitionMsg* petMsg);    
@@ -343,6 +349,9 @@ public:
 
     const plNetTransport& TransportMgr() const { return fTransport; }
     plNetTransport& TransportMgr() { return fTransport; }
+
+    const plNetClientInterest& InterestMgr() const { return fInterest; }
+    plNetClientInterest& InterestMgr() { return fInterest; }
     
     bool ObjectInLocalAge(const plSynchedObject* obj) const;
     
@@ -385,6 +394,7 @@ public:
     void SetObjectOwner(bool own);
 
     void StoreSDLState(const plStateDataRecord* sdRec, const plUoid& uoid, uint32_t sendFlags, uint32_t writeOptions);
+    bool IsDeltaEncodingAgreed() const;
 
     void UpdateServerTimeOffset(plNetMessage* msg);
     void ResetServerTimeOffset(bool delayed=false);
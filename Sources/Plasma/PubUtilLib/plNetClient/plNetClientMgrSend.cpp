@@ -56,7 +56,9 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "plAvatar/plArmatureMod.h"
 #include "plAvatar/plAvatarMgr.h"
 #include "plNetMessage/plNetMessage.h"
+#include "plNetTransport/plNetTransportMember.h"
 #include "plMessage/plCCRMsg.h"
+#include "plMessage/plSDLDeltaResyncMsg.h"
 #include "plVault/plVault.h"
 #include "plContainer/plConfigInfo.h"
 #include "plDrawable/plMorphSequence.h"
@@ -94,7 +96,7 @@ int plNetClientMgr::ISendRoomsReset()
 // Make sure all dirty objects save their state.
 // Mark those objects as clean and clear the dirty list.
 //
-int plNetClientMgr::ISendDirtyState(double secs)
+int plNetClientMgr::ISendDirtyState(double secs, bool flushAll)
 {
     std::vector<plSynchedObject::StateDefn> carryOvers;
 
@@ -125,15 +127,89 @@ int plNetClientMgr::ISendDirtyState(double secs)
             }
         }
 
+        // low priority state nobody can see right now, the interest mgr hangs on to it
+        if (!flushAll && !fInterest.AllowDirtyState(state, secs))
+            continue;
+
         obj->CallDirtyNotifiers();
         obj->SendSDLStateMsg(state->fSDLName.c_str(), state->fSendFlags);       
     }
 
     plSynchedObject::ClearDirtyState(carryOvers);
 
+    // held back states whose turn has come
+    std::vector<plSynchedObject::StateDefn> due;
+    fInterest.PopDueStates(secs, flushAll, due);
+    for (i = 0; i < due.size(); i++)
+    {
+        plSynchedObject* obj = due[i].GetObject();
+        if (!obj)
+            continue;
+
+        obj->CallDirtyNotifiers();
+        obj->SendSDLStateMsg(due[i].fSDLName.c_str(), due[i].fSendFlags);
+    }
+
     return hsOK;
 }
 
+//
+// Send held back game msgs whose turn has come
+//
+int plNetClientMgr::ISendDeferredGameMsgs(double secs, bool flushAll)
+{
+    std::vector<plNetMsgGameMessage*> due;
+    fInterest.PopDueMsgs(secs, flushAll, due);
+
+    int i;
+    for (i = 0; i < due.size(); i++)
+    {
+        SendMsg(due[i]);
+        delete due[i];
+    }
+
+    return hsOK;
+}
+
+//
+// Ask the senders of delta encoded state we lost track of for a full send,
+// which starts a new chain, rather than wait for their chain to run out.
+//
+void plNetClientMgr::ISendDeltaResyncs()
+{
+    std::vector<plSDLDeltaChainKey> resyncs;
+    plSDLMgr::GetInstance()->PopDeltaResyncs(&resyncs);
+    for (int i = 0; i < resyncs.size(); i++)
+    {
+        plSDLDeltaResyncMsg* msg = new plSDLDeltaResyncMsg(resyncs[i].fUoid, resyncs[i].fDesc->GetName());
+        msg->AddReceiver(GetKey());
+        msg->SetBCastFlag(plMessage::kNetPropagate);
+        msg->SetBCastFlag(plMessage::kLocalPropagate, false);
+        msg->AddNetReceiver(resyncs[i].fSender);
+        msg->Send();
+    }
+}
+
+//
+// Another player lost track of state we delta encoded, send it in full
+//
+void plNetClientMgr::IHandleDeltaResyncMsg(plSDLDeltaResyncMsg* msg)
+{
+    plKey key = hsgResMgr::ResMgr()->FindKey(msg->GetUoid());
+    plSynchedObject* obj = key ? plSynchedObject::ConvertNoRef(key->ObjectIsLoaded()) : nil;
+    if (!obj)
+        return;
+
+    if (obj->IsLocallyOwned() == plSynchedObject::kNo)
+    {
+        DebugMsg("Ignoring delta resync request for obj %s, sdl %s, we don't own it",
+            key->GetName().c_str(), msg->GetSDLName().c_str());
+        return;
+    }
+
+    obj->SendSDLStateMsg(msg->GetSDLName().c_str(), plSynchedObject::kBCastToClients | plSynchedObject::kForceFullSend);
+}
+
 //
 // Given a plasma petition msg, send a petition text node to the vault
 // vault will detect and fwd to CCR system.
@@ -350,9 +426,7 @@ int plNetClientMgr::ISendGameMessage(plMessage* msg)
     // currently only avatar control messages.
     // 
     if (msg->HasBCastFlag(plMessage::kNetUseRelevanceRegions))
-    {
         netMsgWrap->SetBit(plNetMessage::kUseRelevanceRegions);
-    }
 
     //
     // CCRs can route a plMessage to all online players.
@@ -390,6 +464,12 @@ int plNetClientMgr::ISendGameMessage(plMessage* msg)
                                 
     netMsgWrap->SetPlayerID(GetPlayerID()); 
     netMsgWrap->SetNetProtocol(kNetProtocolCli2Game);
+
+    // low priority msgs nobody can see right now, the interest mgr hangs on to them
+    if (msg->HasBCastFlag(plMessage::kNetUseRelevanceRegions) &&
+        !fInterest.AllowGameMessage(msg, netMsgWrap, hsTimer::GetSysSeconds()))
+        return hsOK;
+
     int ret = SendMsg(netMsgWrap);
 
     if (plNetObjectDebugger::GetInstance()->IsDebugObject(msg->GetSender() ? msg->GetSender()->ObjectIsLoaded() : nil))
@@ -424,6 +504,10 @@ int plNetClientMgr::SendMsg(plNetMessage* msg)
         msg->SetBit(plNetMessage::kEchoBackToSender, true);
     }
     
+    plNetMsgRelevanceRegions* relRegionsMsg = plNetMsgRelevanceRegions::ConvertNoRef(msg);
+    if (relRegionsMsg)
+        fInterest.AttachHints(relRegionsMsg);
+
     msg->SetTimeSent(plUnifiedTime::GetCurrentTime());
     int channel = IPrepMsg(msg);
     
@@ -444,11 +528,41 @@ int plNetClientMgr::SendMsg(plNetMessage* msg)
 }
 
 
+//
+// Delta encode only when it's turned on and the server and every other player
+// in the age have advertised they can read delta encoded records.  Someone we
+// haven't heard from yet gets plain ones.
+//
+bool plNetClientMgr::IsDeltaEncodingAgreed() const
+{
+    plSDLMgr* sdlMgr = plSDLMgr::GetInstance();
+    if (!sdlMgr->GetDeltaEncoding() || !sdlMgr->GetServerDeltaCapable())
+        return false;
+
+    int i;
+    for (i = 0; i < fTransport.GetNumMembers(); i++)
+    {
+        uint32_t playerID = fTransport.GetMember(i)->GetPlayerID();
+        if (playerID != GetPlayerID() && !sdlMgr->IsDeltaPeer(playerID))
+            return false;
+    }
+    return true;
+}
+
 void plNetClientMgr::StoreSDLState(const plStateDataRecord* sdRec, const plUoid& uoid, 
                                     uint32_t sendFlags, uint32_t writeOptions)
 {
+    plSDLMgr* sdlMgr = plSDLMgr::GetInstance();
+    if (IsDeltaEncodingAgreed())
+    {
+        // a forced full send starts a new delta chain, which catches up anyone who joined since
+        if (sendFlags & plSynchedObject::kForceFullSend)
+            sdlMgr->RemoveDeltaChain(uoid, sdRec->GetDescriptor(), true);
+        writeOptions |= plSDL::kDeltaEncode;
+    }
+
     // send to server
-    plNetMsgSDLState* msg = sdRec->PrepNetMsg(0, writeOptions);
+    plNetMsgSDLState* msg = sdRec->PrepNetMsg(0, writeOptions, &uoid);
     msg->SetNetProtocol(kNetProtocolCli2Game);
     msg->ObjectInfo()->SetUoid(uoid);
 
@@ -470,6 +584,8 @@ void plNetClientMgr::StoreSDLState(const plStateDataRecord* sdRec, const plUoid&
         msg->SetPlayerID(plNetClientApp::GetInstance()->GetPlayerID());
     }
 
+    fInterest.NoteStateSent(sendFlags, sdRec->GetDescriptor()->GetName(), msg->StreamInfo()->GetStreamLen());
+
     SendMsg(msg);
     delete msg;
 }
@@ -198,7 +198,18 @@ MSG_HANDLER_DEFN(plNetClientMsgHandler,plNetMsgGroupOwner)
     return hsOK;
 }
 
-
+//
+// Records advertise whether whoever wrote them reads delta encoded ones,
+// see plNetClientMgr::IsDeltaEncodingAgreed
+//
+static void INoteDeltaCapable(const plNetMsgSDLState* m, const plStateDataRecord* sdRec)
+{
+    plSDLMgr* sdlMgr = plSDLMgr::GetInstance();
+    if (sdRec->GetFlags() & plStateDataRecord::kServerDeltaCapable)
+        sdlMgr->SetServerDeltaCapable(true);
+    if (m->GetHasPlayerID() && !m->IsInitialState() && (sdRec->GetFlags() & plStateDataRecord::kDeltaCapable))
+        sdlMgr->AddDeltaPeer(m->GetPlayerID());
+}
 
 MSG_HANDLER_DEFN(plNetClientMsgHandler,plNetMsgSDLState)
 {
@@ -248,6 +259,12 @@ MSG_HANDLER_DEFN(plNetClientMsgHandler,plNetMsgSDLState)
     // ERROR CHECK SDL FILE
     //
     plStateDataRecord* sdRec  = des ? new plStateDataRecord(des) : nil;
+    if (sdRec)
+    {
+        // delta encoded states find what they're relative to by these
+        sdRec->SetAssocObject(m->ObjectInfo()->GetUoid());
+        sdRec->SetDeltaSender(m->JustGetPlayerID());
+    }
     if (!sdRec || sdRec->GetDescriptor()->GetVersion()!=ver)
     {
         std::string err;
@@ -266,6 +283,8 @@ MSG_HANDLER_DEFN(plNetClientMsgHandler,plNetMsgSDLState)
     }
     else if( sdRec->Read( &stream, 0, rwFlags ) )
     {
+        INoteDeltaCapable(m, sdRec);
+
         plStateDataRecord* stateRec = nil;
         if (m->IsInitialState())
         {
@@ -290,7 +309,10 @@ MSG_HANDLER_DEFN(plNetClientMsgHandler,plNetMsgSDLState)
                                   m->ObjectInfo()->GetObjectName().c_str(), des->GetName() ) );
     }
     else
+    {
+        INoteDeltaCapable(m, sdRec);    // a delta record we couldn't place still tells us that
         delete sdRec;
+    }
 
     delete [] descName; // We've only used descName for a lookup (via SDR, and some error strings. Must delete now.
 
@@ -478,6 +500,15 @@ MSG_HANDLER_DEFN(plNetClientMsgHandler,plNetMsgMembersList)
     {
         if (!nc->fTransport.GetMember(i)->IsServer())
         {           
+            // forget what anyone who has left was delta encoding against
+            uint32_t playerID = nc->fTransport.GetMember(i)->GetPlayerID();
+            int j;
+            for( j=0; j<m->MemberListInfo()->GetNumMembers(); j++ )
+                if (m->MemberListInfo()->GetMember(j)->GetClientGuid()->GetPlayerID()==playerID)
+                    break;
+            if (j==m->MemberListInfo()->GetNumMembers())
+                plSDLMgr::GetInstance()->RemoveDeltaSender(playerID);
+
             nc->fTransport.RemoveMember(i);         
         }
     } // for         
@@ -538,6 +569,7 @@ MSG_HANDLER_DEFN(plNetClientMsgHandler,plNetMsgMemberUpdate)
         }
         else
         {
+            plSDLMgr::GetInstance()->RemoveDeltaSender(nc->fTransport.GetMember(idx)->GetPlayerID());
             nc->fTransport.RemoveMember(idx);
         }
     }
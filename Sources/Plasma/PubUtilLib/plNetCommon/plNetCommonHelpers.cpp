@@ -242,7 +242,7 @@ void plCreatableListHelper::Read( hsStream* s, hsResMgr* mgr )
         s->LogSubStreamPushDesc("Compressed Data");
         s->Read( zBufSz, (void*)zBuf.data() );
         plZlibCompress compressor;
-        uint32_t tmp;
+        uint32_t tmp = bufSz;
         bool ans = compressor.Uncompress( (uint8_t*)buf.data(), &tmp, (uint8_t*)zBuf.data(), zBufSz );
         hsAssert( ans!=0, "plCreatableListHelper: Failed to uncompress buffer." );
         hsAssert( tmp==bufSz, "compression size mismatch" );
@@ -305,9 +305,10 @@ void plCreatableListHelper::Write( hsStream* s, hsResMgr* mgr )
         if ( fFlags&kWantCompression && bufSz>fCompressionThreshold )
         {
             plZlibCompress compressor;
-            uint32_t zBufSz;
+            // according to compress doc, the out buffer should be at least .1% larger than source buffer, plus 12 bytes.
+            uint32_t zBufSz = (uint32_t)(bufSz*1.1+12);
             std::string zBuf;
-            zBuf.resize( bufSz );
+            zBuf.resize( zBufSz );
             bool ans = compressor.Compress( (uint8_t*)zBuf.data(), &zBufSz, (const uint8_t*)buf.data(), bufSz );
             bool compressed = ( ans && zBufSz );
             hsAssert( compressed, "plCreatableListHelper: Failed to compress buffer." );
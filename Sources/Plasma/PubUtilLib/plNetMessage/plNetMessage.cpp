@@ -1355,6 +1355,16 @@ int plNetMsgRelevanceRegions::IPokeBuffer( hsStream* stream, uint32_t peekOption
     plNetMessage::IPokeBuffer( stream, peekOptions );
     fRegionsICareAbout.Write(stream);
     fRegionsImIn.Write(stream);
+
+    // Hints trail the msg and are only written when there are some,
+    // so servers that don't know about them never see any
+    if (!fHintPlayerIDs.empty())
+    {
+        stream->WriteLE16((uint16_t)fHintPlayerIDs.size());
+        int i;
+        for (i = 0; i < fHintPlayerIDs.size(); i++)
+            stream->WriteLE32(fHintPlayerIDs[i]);
+    }
     
     return stream->GetPosition();
 }
@@ -1367,6 +1377,16 @@ int plNetMsgRelevanceRegions::IPeekBuffer( hsStream* stream, uint32_t peekOption
     {
         fRegionsICareAbout.Read(stream);
         fRegionsImIn.Read(stream);
+
+        fHintPlayerIDs.clear();
+        if (stream->GetPosition() < stream->GetEOF())
+        {
+            uint16_t num = stream->ReadLE16();
+            fHintPlayerIDs.resize(num);
+            int i;
+            for (i = 0; i < num; i++)
+                fHintPlayerIDs[i] = stream->ReadLE32();
+        }
         
         bytes=stream->GetPosition();
     }
@@ -963,6 +963,7 @@ class plNetMsgRelevanceRegions : public plNetMessage
 protected:
     hsBitVector fRegionsImIn;
     hsBitVector fRegionsICareAbout;
+    std::vector<uint32_t> fHintPlayerIDs;   // optional, remote players the client thinks care about it
 
     int IPokeBuffer(hsStream* stream, uint32_t peekOptions=0);
     int IPeekBuffer(hsStream* stream, uint32_t peekOptions=0);
@@ -979,6 +980,9 @@ public:
     const hsBitVector& GetRegionsICareAbout() const { return fRegionsICareAbout;    }
     const hsBitVector& GetRegionsImIn() const       { return fRegionsImIn;  }
 
+    void SetHintPlayerIDs(const std::vector<uint32_t>& ids) { fHintPlayerIDs=ids; }
+    const std::vector<uint32_t>& GetHintPlayerIDs() const   { return fHintPlayerIDs; }
+
     plString AsStdString() const
     {
         plString b1, b2;
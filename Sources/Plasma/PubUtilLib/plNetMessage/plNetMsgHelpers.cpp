@@ -47,6 +47,8 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "pnKeyedObject/plKey.h"
 #include "pnMessage/plMessage.h"
 #include "hsStream.h"
+#include "hsThread.h"
+#include "hsTimer.h"
 #include <algorithm>
 
 
@@ -144,6 +146,34 @@ int plNetMsgCreatableHelper::Peek(hsStream * s, uint32_t peekOptions)
 // NOT A MSG
 // PL STREAM MSG - HELPER class
 /////////////////////////////////////////////////////////
+
+//
+// Compression history for one stream type
+//
+struct plNetMsgCompressionStats
+{
+    float       fRatio;         // Running average of compressed / uncompressed size
+    float       fSavedPerMs;    // Running average of bytes saved per ms spent compressing
+    uint32_t    fSkipped;       // Payloads passed over since the last one we tried
+};
+
+enum
+{
+    kMaxCaptureBytes    = 8 * 1024 * 1024,
+    kResampleInterval   = 32,           // Give a type that isn't paying off another try this often
+    kMinBytesSavedPerMs = 4 * 1024
+};
+static const float kMaxCompressionRatio = 0.9f;
+static const float kStatsWeight = 0.25f;
+
+static hsMutex gCompressionLock;
+static std::map<int16_t, plNetMsgCompressionStats> gCompressionStats;
+static std::vector< std::vector<uint8_t> > gCapturedPayloads;
+static uint32_t gCapturedBytes = 0;
+
+bool plNetMsgStreamHelper::fAdaptiveCompression = true;
+bool plNetMsgStreamHelper::fCapturePayloads = false;
+
 plNetMsgStreamHelper::plNetMsgStreamHelper() :  fStreamBuf(nil), fStreamType(-1), fStreamLen(0), 
         fCompressionType(plNetMessage::kCompressionNone), fUncompressedSize(0),
         fCompressionThreshold( kDefaultCompressionThreshold )
@@ -266,7 +296,7 @@ void plNetMsgStreamHelper::CopyFrom(const plNetMsgStreamHelper* other)
 
 bool plNetMsgStreamHelper::Compress(int offset)
 {
-    if ( !IsCompressable() )
+    if ( !IsCompressable() || !IWorthCompressing() )
         return true;
 
     plZlibCompress compressor;
@@ -274,7 +304,22 @@ bool plNetMsgStreamHelper::Compress(int offset)
     uint32_t bufLen = GetStreamLen();
     uint32_t uncompressedSize = bufLen;
     SetUncompressedSize( uncompressedSize );
-    if ( compressor.Compress( &buf, &bufLen, offset) )
+
+    if ( fCapturePayloads )
+    {
+        hsTempMutexLock lock( gCompressionLock );
+        if ( gCapturedBytes + bufLen - offset <= kMaxCaptureBytes )
+        {
+            gCapturedPayloads.push_back( std::vector<uint8_t>( buf + offset, buf + bufLen ) );
+            gCapturedBytes += bufLen - offset;
+        }
+    }
+
+    double start = hsTimer::GetSeconds();
+    bool compressed = compressor.Compress( &buf, &bufLen, offset );
+    IRecordCompression( uncompressedSize, compressed ? bufLen : uncompressedSize, hsTimer::GetSeconds() - start );
+
+    if ( compressed )
     {
         SetCompressionType( plNetMessage::kCompressionZlib );
         SetStreamLen(bufLen);
@@ -334,6 +379,70 @@ bool plNetMsgStreamHelper::IsCompressable() const
         && fStreamLen>fCompressionThreshold );
 }
 
+//
+// Checks the stream type's compression history. Passing a type over counts
+// towards resampling it, so only call this when we're about to compress.
+//
+bool plNetMsgStreamHelper::IWorthCompressing()
+{
+    if ( !fAdaptiveCompression )
+        return true;
+
+    hsTempMutexLock lock( gCompressionLock );
+    std::map<int16_t, plNetMsgCompressionStats>::iterator it = gCompressionStats.find( fStreamType );
+    if ( it == gCompressionStats.end() )
+        return true;
+
+    plNetMsgCompressionStats& stats = it->second;
+    if ( stats.fRatio <= kMaxCompressionRatio && stats.fSavedPerMs >= kMinBytesSavedPerMs )
+        return true;
+
+    // Hasn't been paying off, but the content may have changed
+    if ( ++stats.fSkipped >= kResampleInterval )
+    {
+        stats.fSkipped = 0;
+        return true;
+    }
+    return false;
+}
+
+void plNetMsgStreamHelper::IRecordCompression( uint32_t uncompressedLen, uint32_t compressedLen, double secs )
+{
+    float ratio = compressedLen / (float)uncompressedLen;
+    float ms = hsMaximum( (float)( secs * 1.e3 ), 0.001f );
+    float savedPerMs = ( uncompressedLen - hsMinimum( compressedLen, uncompressedLen ) ) / ms;
+
+    hsTempMutexLock lock( gCompressionLock );
+    std::map<int16_t, plNetMsgCompressionStats>::iterator it = gCompressionStats.find( fStreamType );
+    if ( it == gCompressionStats.end() )
+    {
+        plNetMsgCompressionStats stats;
+        stats.fRatio = ratio;
+        stats.fSavedPerMs = savedPerMs;
+        stats.fSkipped = 0;
+        gCompressionStats[ fStreamType ] = stats;
+    }
+    else
+    {
+        plNetMsgCompressionStats& stats = it->second;
+        stats.fRatio += ( ratio - stats.fRatio ) * kStatsWeight;
+        stats.fSavedPerMs += ( savedPerMs - stats.fSavedPerMs ) * kStatsWeight;
+    }
+}
+
+void plNetMsgStreamHelper::GetCapturedPayloads( std::vector< std::vector<uint8_t> >& payloads )
+{
+    hsTempMutexLock lock( gCompressionLock );
+    payloads = gCapturedPayloads;
+}
+
+void plNetMsgStreamHelper::ClearCapturedPayloads()
+{
+    hsTempMutexLock lock( gCompressionLock );
+    gCapturedPayloads.clear();
+    gCapturedBytes = 0;
+}
+
 
 
 ////////////////////////////////////////////////////////
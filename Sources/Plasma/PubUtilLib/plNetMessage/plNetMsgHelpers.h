@@ -132,7 +132,12 @@ protected:
     uint8_t   fCompressionType;   // see plNetMessage::CompressionType
     uint32_t  fCompressionThreshold;  // NOT WRITTEN
 
+    static bool fAdaptiveCompression;
+    static bool fCapturePayloads;
+
     void IAllocStream(uint32_t len);
+    bool IWorthCompressing();
+    void IRecordCompression(uint32_t uncompressedLen, uint32_t compressedLen, double secs);
 
 public:
     enum { kDefaultCompressionThreshold = 255 }; // bytes
@@ -179,6 +184,18 @@ public:
     bool    IsCompressable() const;
     uint32_t  GetCompressionThreshold() const { return fCompressionThreshold; }
     void    SetCompressionThreshold( uint32_t v ) { fCompressionThreshold=v; }
+
+    // When on, we keep track of how well each stream type compresses and how
+    // long it takes, and stop compressing types that aren't worth the CPU
+    static void SetAdaptiveCompression( bool on ) { fAdaptiveCompression=on; }
+    static bool GetAdaptiveCompression() { return fAdaptiveCompression; }
+
+    // Keeps a copy of every payload we compress (up to a limit), so
+    // compression can be benchmarked against real traffic
+    static void SetCapturePayloads( bool on ) { fCapturePayloads=on; }
+    static bool GetCapturePayloads() { return fCapturePayloads; }
+    static void GetCapturedPayloads( std::vector< std::vector<uint8_t> >& payloads );
+    static void ClearCapturedPayloads();
 };
 
 //
@@ -0,0 +1,972 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "HeadSpin.h"
+
+#include "plNullPipeline.h"
+#include "plPipeline/plPipeDebugFlags.h"
+#include "plPipeline/plPlates.h"
+#include "plPipeline/plGBufferGroup.h"
+#include "plPipeline/plRenderTarget.h"
+#include "plSoftwareSkin/plSoftwareSkin.h"
+
+#include "hsGMatState.inl"
+#include "plProfile.h"
+
+#include "plDrawable/plDrawableSpans.h"
+#include "plDrawable/plSpaceTree.h"
+#include "plDrawable/plSpanTypes.h"
+#include "plDrawable/plAccessSpan.h"
+#include "plSurface/hsGMaterial.h"
+#include "plSurface/plLayerInterface.h"
+#include "pnSceneObject/plSceneObject.h"
+#include "pnSceneObject/plDrawInterface.h"
+#include "plScene/plRenderRequest.h"
+#include "plScene/plVisMgr.h"
+#include "plGLight/plLightInfo.h"
+
+// Same counters plDXPipeline keeps, so a headless run reads like a real one.
+// They live here rather than in plDXPipeline.cpp so they exist in builds
+// without Direct3D; plDXPipeline externs them. RenderScene, VisEval and
+// VisSelect are also timed from plScene, plDrawable and plClient.
+plProfile_Extern(DrawOccBuild);
+plProfile_CreateTimer("RenderScene", "PipeT", RenderScene);
+plProfile_CreateTimer("VisEval", "PipeT", VisEval);
+plProfile_CreateTimer("VisSelect", "PipeT", VisSelect);
+plProfile_CreateCounter("Polys", "General", DrawTriangles);
+plProfile_CreateCounter("Draw Prim Static", "Draw", DrawPrimStatic);
+plProfile_CreateTimer("Harvest", "Draw", Harvest);
+plProfile_CreateCounter("Material Change", "Draw", MatChange);
+plProfile_CreateTimer("PrepDrawable", "PipeT", PrepDrawable);
+plProfile_CreateTimer("  Skin", "PipeT", Skin);
+plProfile_CreateCounter("OccPoly", "PipeC", OccPolyUsed);
+plProfile_CreateCounter("OccNode", "PipeC", OccNodeUsed);
+plProfile_CreateCounter("NumSkin", "PipeC", NumSkin);
+
+//// plNullPlateManager ///////////////////////////////////////////////////////
+// Plates still get created and sorted, they just never reach a device.
+
+class plNullPlateManager : public plPlateManager
+{
+    friend class plNullPipeline;
+
+protected:
+    plNullPlateManager(plPipeline* pipe) : plPlateManager(pipe) {}
+
+    virtual void    IDrawToDevice(plPipeline* pipe) {}
+};
+
+//// plNullViewSettings::Reset ////////////////////////////////////////////////
+// Same defaults as plDXViewSettings.
+
+void plNullPipeline::plNullViewSettings::Reset()
+{
+    fRenderState = plPipeline::kRenderNormal | plPipeline::kRenderClearColor | plPipeline::kRenderClearDepth;
+
+    fRenderRequest = nil;
+
+    fDrawableTypeMask = plDrawable::kNormal;
+    fSubDrawableTypeMask = plDrawable::kSubNormal;
+
+    fClearColor.Set(0, 0, 0, 0);
+    fClearDepth = 1.f;
+    fDefaultFog.Clear();
+
+    const uint16_t kCullMaxNodes = 250;
+    fCullTree.Reset();
+    fCullTreeDirty = true;
+    fCullMaxNodes = kCullMaxNodes;
+
+    fLocalToWorld.Reset();
+    fWorldToLocal.Reset();
+
+    fTransform.Reset();
+    fTransform.SetScreenSize(800, 600);
+}
+
+//// Constructor & Destructor /////////////////////////////////////////////////
+
+plNullPipeline::plNullPipeline(uint32_t width, uint32_t height)
+:   fCurrRenderTarget(nil),
+    fProperties(0),
+    fZBiasScale(1.f),
+    fOcclusionMode(kOcclusionCullTree),
+    fOccBufferValid(false),
+    fOverBaseLayer(nil),
+    fOverAllLayer(nil),
+    fActiveLights(nil),
+    fWidth(width),
+    fHeight(height),
+    fInSceneDepth(0),
+    fRenderCnt(0),
+    fLastMaterial(nil),
+    fNumMaterialChanges(0),
+    fNumShadowSlaves(0)
+{
+    fView.Reset();
+    fView.fTransform.SetScreenSize((uint16_t)width, (uint16_t)height);
+    fView.fTransform.SetViewPort(0, 0, float(width), float(height), false);
+
+    fDesktopParams.Width = width;
+    fDesktopParams.Height = height;
+    fDesktopParams.ColorDepth = 32;
+
+    fMatOverOn.Reset();
+    fMatOverOff.Reset();
+
+    new plNullPlateManager(this);
+}
+
+plNullPipeline::~plNullPipeline()
+{
+    while( fActiveLights )
+        UnRegisterLight(fActiveLights);
+
+    while( fOverrideMat.GetCount() )
+        PopOverrideMaterial(nil);
+
+    delete &plPlateManager::Instance();
+
+    plSoftwareSkin::Shutdown();
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//// Visibility ///////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+// IRefreshCullTree ////////////////////////////////////////////////////////////
+// Rebuild the cull tree and occlusion buffer from this frame's occluders,
+// exactly as plDXPipeline::IRefreshCullTree does (minus the debug snapshot).
+void plNullPipeline::IRefreshCullTree()
+{
+    if( !fView.fCullTreeDirty )
+        return;
+
+    plProfile_BeginTiming(DrawOccBuild);
+
+    fView.fCullTree.Reset();
+    fView.fCullTree.SetViewPos(GetViewPositionWorld());
+    fView.fCullTree.InitFrustum(GetViewTransform().GetWorldToNDC());
+    fView.fCullTreeDirty = false;
+
+    if( !fViewStack.GetCount() )
+        fOccBufferValid = false;
+
+    if( fView.fCullMaxNodes )
+    {
+        if( !fViewStack.GetCount()
+            && ((fOcclusionMode == kOcclusionBuffer) || (fOcclusionMode == kOcclusionBoth)) )
+        {
+            IRefreshOcclusionBuffer();
+        }
+
+        int i = 0;
+        if( (fOcclusionMode == kOcclusionCullTree) || (fOcclusionMode == kOcclusionBoth) )
+        {
+            for( i = 0; i < fCullPolys.GetCount(); i++ )
+            {
+                fView.fCullTree.AddPoly(*fCullPolys[i]);
+                if( fView.fCullTree.GetNumNodes() >= fView.fCullMaxNodes )
+                    break;
+            }
+
+            int j;
+            for( j = 0; j < fCullHoles.GetCount(); j++ )
+                fView.fCullTree.AddPoly(*fCullHoles[j]);
+        }
+        fCullPolys.SetCount(0);
+        plProfile_Set(OccPolyUsed, i);
+
+        fCullHoles.SetCount(0);
+        plProfile_Set(OccNodeUsed, fView.fCullTree.GetNumNodes());
+    }
+
+    plProfile_EndTiming(DrawOccBuild);
+}
+
+// IRefreshOcclusionBuffer /////////////////////////////////////////////////////
+void plNullPipeline::IRefreshOcclusionBuffer()
+{
+    fOccBuffer.Begin(GetViewTransform().GetWorldToNDC(), GetViewPositionWorld());
+
+    int i;
+    for( i = 0; i < fCullPolys.GetCount(); i++ )
+        fOccBuffer.AddOccluder(*fCullPolys[i]);
+    for( i = 0; i < fCullHoles.GetCount(); i++ )
+        fOccBuffer.AddHole(*fCullHoles[i]);
+
+    fOccBuffer.End();
+
+    fOccBufferValid = !fOccBuffer.IsEmpty();
+}
+
+void plNullPipeline::SetOcclusionMode(uint8_t mode)
+{
+    if( mode >= kNumOcclusionModes )
+        return;
+
+    fOcclusionMode = mode;
+    fOccBufferValid = false;
+    fView.fCullTreeDirty = true;
+}
+
+bool plNullPipeline::SubmitOccluders(const hsTArray<const plCullPoly*>& polyList)
+{
+    fCullPolys.SetCount(0);
+    fCullHoles.SetCount(0);
+    int i;
+    for( i = 0; i < polyList.GetCount(); i++ )
+    {
+        if( polyList[i]->IsHole() )
+            fCullHoles.Append(polyList[i]);
+        else
+            fCullPolys.Append(polyList[i]);
+    }
+    fView.fCullTreeDirty = true;
+
+    return true;
+}
+
+void plNullPipeline::IHarvestVisible(plSpaceTree* space, hsTArray<int16_t>& visList)
+{
+    fView.fCullTree.Harvest(space, visList);
+    if( IOcclusionBufferActive() )
+        fOccBuffer.Filter(space, visList);
+}
+
+bool plNullPipeline::HarvestVisible(plSpaceTree* space, hsTArray<int16_t>& visList)
+{
+    if( !space )
+        return false;
+
+    space->SetViewPos(GetViewPositionWorld());
+
+    space->Refresh();
+
+    if( fView.fCullTreeDirty )
+        IRefreshCullTree();
+
+    plProfile_BeginTiming(Harvest);
+    IHarvestVisible(space, visList);
+    plProfile_EndTiming(Harvest);
+
+    return visList.GetCount() != 0;
+}
+
+// IGetVisibleSpans ///////////////////////////////////////////////////////////
+// See plDXPipeline::IGetVisibleSpans, including the distance fade rejection.
+void plNullPipeline::IGetVisibleSpans(plDrawableSpans* drawable, hsTArray<int16_t>& visList, plVisMgr* visMgr)
+{
+    static hsTArray<int16_t> tmpVis;
+    tmpVis.SetCount(0);
+    visList.SetCount(0);
+
+    drawable->GetSpaceTree()->SetViewPos(GetViewPositionWorld());
+
+    drawable->GetSpaceTree()->Refresh();
+
+    if( fView.fCullTreeDirty )
+        IRefreshCullTree();
+
+    const float viewDist = GetViewDirWorld().InnerProduct(GetViewPositionWorld());
+
+    const hsTArray<plSpan *>    &spans = drawable->GetSpanArray();
+
+    plProfile_BeginTiming(Harvest);
+    if( visMgr )
+    {
+        drawable->SetVisSet(visMgr);
+        IHarvestVisible(drawable->GetSpaceTree(), tmpVis);
+        drawable->SetVisSet(nil);
+    }
+    else
+    {
+        IHarvestVisible(drawable->GetSpaceTree(), tmpVis);
+    }
+
+    const bool skipVisDist = IsDebugFlagSet(plPipeDbg::kFlagSkipVisDist);
+    int i;
+    for( i = 0; i < tmpVis.GetCount(); i++ )
+    {
+        if( !(spans[tmpVis[i]]->fSubType & GetSubDrawableTypeMask()) )
+            continue;
+
+        float minDist, maxDist;
+        if( !skipVisDist && drawable->GetSubVisDists(tmpVis[i], minDist, maxDist) )
+        {
+            const hsBounds3Ext& bnd = drawable->GetSpaceTree()->GetNode(tmpVis[i]).fWorldBounds;
+            hsPoint2 depth;
+            bnd.TestPlane(GetViewDirWorld(), depth);
+            if( (0 < minDist + viewDist - depth.fY)
+                    ||(0 > maxDist + viewDist - depth.fX) )
+                continue;
+        }
+
+        visList.Append(tmpVis[i]);
+    }
+    plProfile_EndTiming(Harvest);
+}
+
+bool plNullPipeline::TestVisibleWorld(const hsBounds3Ext& wBnd)
+{
+    if( fView.fCullTreeDirty )
+        IRefreshCullTree();
+    if( wBnd.GetType() != kBoundsNormal )
+        return false;
+
+    if( !fView.fCullTree.BoundsVisible(wBnd) )
+        return false;
+    return !IOcclusionBufferActive() || fOccBuffer.BoundsVisible(wBnd);
+}
+
+bool plNullPipeline::TestVisibleWorld(const plSceneObject* sObj)
+{
+    const plDrawInterface* di = sObj->GetDrawInterface();
+    if( !di )
+        return false;
+
+    const int numDraw = di->GetNumDrawables();
+    int i;
+    for( i = 0; i < numDraw; i++ )
+    {
+        plDrawableSpans* dr = plDrawableSpans::ConvertNoRef(di->GetDrawable(i));
+        if( !dr )
+            continue;
+
+        plDISpanIndex& diIndex = dr->GetDISpans(di->GetDrawableMeshIndex(i));
+        if( diIndex.IsMatrixOnly() )
+            continue;
+
+        const int numSpan = diIndex.GetCount();
+        int j;
+        for( j = 0; j < numSpan; j++ )
+        {
+            const plSpan* span = dr->GetSpan(diIndex[j]);
+
+            if( span->fProps & plSpan::kPropNoDraw )
+                continue;
+
+            if( !span->GetVisSet().Overlap(plGlobalVisMgr::Instance()->GetVisSet())
+                || span->GetVisSet().Overlap(plGlobalVisMgr::Instance()->GetVisNot()) )
+                continue;
+
+            if( !TestVisibleWorld(span->fWorldBounds) )
+                continue;
+
+            return true;
+        }
+    }
+    return false;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//// Rendering ////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+bool plNullPipeline::PreRender(plDrawable* drawable, hsTArray<int16_t>& visList, plVisMgr* visMgr)
+{
+    plDrawableSpans *ds = plDrawableSpans::ConvertNoRef(drawable);
+    if( !ds )
+        return false;
+    if( ( ds->GetType() & fView.fDrawableTypeMask ) == 0 )
+        return false;
+
+    IGetVisibleSpans(ds, visList, visMgr);
+
+    return visList.GetCount() > 0;
+}
+
+bool plNullPipeline::PrepForRender(plDrawable* d, hsTArray<int16_t>& visList, plVisMgr* visMgr)
+{
+    plProfile_BeginTiming(PrepDrawable);
+
+    plDrawableSpans *drawable = plDrawableSpans::ConvertNoRef(d);
+    if( !drawable )
+    {
+        plProfile_EndTiming(PrepDrawable);
+        return false;
+    }
+
+    if( drawable->GetNativeProperty(plDrawable::kPropSortFaces) )
+        drawable->SortVisibleSpans(visList, this);
+
+    drawable->PrepForRender(this);
+
+    bool retVal = ISoftwareVertexBlend(drawable, visList);
+
+    plProfile_EndTiming(PrepDrawable);
+
+    return retVal;
+}
+
+// ISoftwareVertexBlend ///////////////////////////////////////////////////////
+// Same blend plDXPipeline does, but there's no locked vertex buffer to
+// blend into, so the results land in scratch and get thrown away.
+bool plNullPipeline::ISoftwareVertexBlend(plDrawableSpans* drawable, const hsTArray<int16_t>& visList)
+{
+    if( IsDebugFlagSet(plPipeDbg::kFlagNoSkinning) )
+        return true;
+
+    if( drawable->GetSkinTime() == fRenderCnt )
+        return true;
+
+    const hsBitVector   &blendBits = drawable->GetBlendingSpanVector();
+
+    if( blendBits.Empty() )
+    {
+        drawable->SetSkinTime(fRenderCnt);
+        return true;
+    }
+
+    plProfile_BeginTiming(Skin);
+
+    const hsTArray<plSpan *>& spans = drawable->GetSpanArray();
+    int i;
+    for( i = 0; i < visList.GetCount(); i++ )
+    {
+        if( !blendBits.IsBitSet(visList[i]) )
+            continue;
+
+        const plIcicle& span = *(plIcicle*)spans[visList[i]];
+        plGBufferGroup* grp = drawable->GetBufferGroup(span.fGroupIdx);
+
+        // Destination is the device format, weights and indices stripped.
+        const uint32_t destStride = sizeof(float) * 6 + sizeof(uint32_t) * 2
+                                    + sizeof(float) * 3 * grp->GetNumUVs();
+        if( fSkinScratch.size() < span.fVLength * destStride )
+            fSkinScratch.resize(span.fVLength * destStride);
+
+        plProfile_Inc(NumSkin);
+
+        hsMatrix44* matrixPalette = drawable->GetMatrixPalette(span.fBaseMatrix);
+        matrixPalette[0] = span.fLocalToWorld;
+
+        const uint8_t* src = grp->GetVertBufferData(span.fVBufferIdx) + span.fVStartIdx * grp->GetVertexSize();
+        plSoftwareSkin::BlendVertsThreaded( matrixPalette, span.fNumMatrices,
+                                             src,
+                                             grp->GetVertexFormat(),
+                                             grp->GetVertexSize(),
+                                             &fSkinScratch[0],
+                                             destStride,
+                                             span.fVLength,
+                                             span.fLocalUVWChans );
+
+        drawable->SetBlendingSpanVectorBit(visList[i], false);
+    }
+
+    plProfile_EndTiming(Skin);
+
+    if( drawable->GetBlendingSpanVector().Empty() )
+        drawable->SetSkinTime(fRenderCnt);
+
+    return true;
+}
+
+// IRecordSpan ///////////////////////////////////////////////////////////////
+// Stand in for the draw call plDXPipeline would make for this span.
+void plNullPipeline::IRecordSpan(plDrawableSpans* drawable, uint32_t spanIdx)
+{
+    const plSpan* span = drawable->GetSpan(spanIdx);
+    if( span->fProps & plSpan::kPropNoDraw )
+        return;
+
+    plDrawCall call;
+    call.fDrawable = drawable;
+    call.fMaterial = GetOverrideMaterial() ? GetOverrideMaterial() : drawable->GetMaterial(span->fMaterialIdx);
+    call.fTarget = fCurrRenderTarget;
+    call.fSpanIdx = spanIdx;
+    call.fNumVerts = 0;
+    call.fNumTris = 0;
+
+    if( span->fTypeMask & plSpan::kParticleSpan )
+    {
+        const plParticleSpan* pSpan = (const plParticleSpan*)span;
+        call.fNumVerts = pSpan->fNumParticles * 4;
+        call.fNumTris = pSpan->fNumParticles * 2;
+    }
+    else if( span->fTypeMask & plSpan::kIcicleSpan )
+    {
+        const plIcicle* ice = (const plIcicle*)span;
+        call.fNumVerts = ice->fVLength;
+        call.fNumTris = ice->fILength / 3;
+    }
+
+    if( call.fMaterial != fLastMaterial )
+    {
+        fLastMaterial = call.fMaterial;
+        fNumMaterialChanges++;
+        plProfile_Inc(MatChange);
+    }
+
+    plProfile_Inc(DrawPrimStatic);
+    plProfile_IncCount(DrawTriangles, call.fNumTris);
+
+    fDrawCalls.push_back(call);
+}
+
+void plNullPipeline::Render(plDrawable* d, const hsTArray<int16_t>& visList)
+{
+    plDrawableSpans *ds = plDrawableSpans::ConvertNoRef(d);
+    if( !ds )
+        return;
+
+    int i;
+    for( i = 0; i < visList.GetCount(); i++ )
+        IRecordSpan(ds, visList[i]);
+}
+
+void plNullPipeline::Draw(plDrawable* d)
+{
+    plDrawableSpans *ds = plDrawableSpans::ConvertNoRef(d);
+
+    if( ds )
+    {
+        if( ( ds->GetType() & fView.fDrawableTypeMask ) == 0 )
+            return;
+
+        static hsTArray<int16_t>visList;
+
+        PreRender(ds, visList);
+        PrepForRender(ds, visList);
+        Render(ds, visList);
+    }
+}
+
+uint32_t plNullPipeline::GetNumDrawTris() const
+{
+    uint32_t numTris = 0;
+    int i;
+    for( i = 0; i < fDrawCalls.size(); i++ )
+        numTris += fDrawCalls[i].fNumTris;
+    return numTris;
+}
+
+bool plNullPipeline::BeginRender()
+{
+    if( !fInSceneDepth++ )
+    {
+        fDrawCalls.clear();
+        fLastMaterial = nil;
+        fNumMaterialChanges = 0;
+        fNumShadowSlaves = 0;
+    }
+    fRenderCnt++;
+
+    return false;
+}
+
+bool plNullPipeline::EndRender()
+{
+    --fInSceneDepth;
+    return false;
+}
+
+void plNullPipeline::RenderScreenElements()
+{
+    if( plPlateManager::InstanceValid() )
+        plPlateManager::Instance().DrawToDevice(this);
+}
+
+void plNullPipeline::SubmitShadowSlave(plShadowSlave* slave)
+{
+    if( slave )
+        fNumShadowSlaves++;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//// Render Requests and Targets //////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void plNullPipeline::PushRenderRequest(plRenderRequest* req)
+{
+    hsMatrix44 l2w = fView.fLocalToWorld;
+    hsMatrix44 w2l = fView.fWorldToLocal;
+
+    plFogEnvironment defFog = fView.fDefaultFog;
+
+    fViewStack.Push(fView);
+
+    SetViewTransform(req->GetViewTransform());
+
+    PushRenderTarget(req->GetRenderTarget());
+    fView.fRenderState = req->GetRenderState();
+
+    fView.fRenderRequest = req;
+    hsRefCnt_SafeRef(fView.fRenderRequest);
+
+    SetDrawableTypeMask(req->GetDrawableMask());
+    SetSubDrawableTypeMask(req->GetSubDrawableMask());
+
+    fView.fClearColor = req->GetClearColor();
+    fView.fClearDepth = req->GetClearDepth();
+
+    if( req->GetFogStart() < 0 )
+        fView.fDefaultFog = defFog;
+    else
+        fView.fDefaultFog.Set( req->GetYon() * (1.f - req->GetFogStart()), req->GetYon(), 1.f, &req->GetClearColor());
+
+    if( req->GetOverrideMat() )
+        PushOverrideMaterial(req->GetOverrideMat());
+
+    fView.fWorldToLocal = w2l;
+    fView.fLocalToWorld = l2w;
+
+    if( req->GetIgnoreOccluders() )
+        fView.fCullMaxNodes = 0;
+
+    fView.fCullTreeDirty = true;
+}
+
+void plNullPipeline::PopRenderRequest(plRenderRequest* req)
+{
+    if( req->GetOverrideMat() )
+        PopOverrideMaterial(nil);
+
+    hsRefCnt_SafeUnRef(fView.fRenderRequest);
+    fView = fViewStack.Pop();
+
+    PopRenderTarget();
+}
+
+void plNullPipeline::PushRenderTarget(plRenderTarget* target)
+{
+    fCurrRenderTarget = target;
+    fRenderTargets.Push(target);
+}
+
+plRenderTarget* plNullPipeline::PopRenderTarget()
+{
+    plRenderTarget* old = fRenderTargets.Pop();
+    fCurrRenderTarget = fRenderTargets.GetCount() ? fRenderTargets.Peek() : nil;
+
+    return old;
+}
+
+void plNullPipeline::SetClear(const hsColorRGBA* col, const float* depth)
+{
+    if( col )
+        fView.fClearColor = *col;
+    if( depth )
+        fView.fClearDepth = *depth;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//// View /////////////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void plNullPipeline::Resize(uint32_t width, uint32_t height)
+{
+    fWidth = width;
+    fHeight = height;
+
+    fView.fTransform.SetScreenSize((uint16_t)width, (uint16_t)height);
+    fView.fTransform.SetViewPort(0, 0, float(width), float(height), false);
+    fView.fCullTreeDirty = true;
+}
+
+void plNullPipeline::GetViewAxesWorld(hsVector3 axes[3] /* ac,up,at */ ) const
+{
+    axes[ 0 ] = GetViewAcrossWorld();
+    axes[ 1 ] = GetViewUpWorld();
+    axes[ 2 ] = GetViewDirWorld();
+}
+
+void plNullPipeline::GetFOV(float& fovX, float& fovY) const
+{
+    fovX = GetViewTransform().GetFovXDeg();
+    fovY = GetViewTransform().GetFovYDeg();
+}
+
+void plNullPipeline::SetFOV(float fovX, float fovY)
+{
+    IGetViewTransform().SetFovDeg(fovX, fovY);
+    IGetViewTransform().SetPerspective(true);
+    fView.fCullTreeDirty = true;
+}
+
+void plNullPipeline::GetSize(float& width, float& height) const
+{
+    width = GetViewTransform().GetScreenWidth();
+    height = GetViewTransform().GetScreenHeight();
+}
+
+void plNullPipeline::SetSize(float width, float height)
+{
+    IGetViewTransform().SetWidth(width);
+    IGetViewTransform().SetHeight(height);
+    IGetViewTransform().SetOrthogonal(true);
+    fView.fCullTreeDirty = true;
+}
+
+void plNullPipeline::GetDepth(float& hither, float& yon) const
+{
+    GetViewTransform().GetDepth(hither, yon);
+}
+
+void plNullPipeline::SetDepth(float hither, float yon)
+{
+    IGetViewTransform().SetDepth(hither, yon);
+    fView.fCullTreeDirty = true;
+}
+
+void plNullPipeline::SetWorldToCamera(const hsMatrix44& w2c, const hsMatrix44& c2w)
+{
+    IGetViewTransform().SetCameraTransform(w2c, c2w);
+    fView.fCullTreeDirty = true;
+}
+
+void plNullPipeline::SetViewTransform(const plViewTransform& v)
+{
+    fView.fTransform = v;
+
+    if( !v.GetScreenWidth() || !v.GetScreenHeight() )
+        fView.fTransform.SetScreenSize((uint16_t)fWidth, (uint16_t)fHeight);
+
+    fView.fCullTreeDirty = true;
+}
+
+void plNullPipeline::ScreenToWorldPoint( int n, uint32_t stride, int32_t *scrX, int32_t *scrY, float dist, uint32_t strideOut, hsPoint3 *worldOut )
+{
+    while( n-- )
+    {
+        hsPoint3 scrP;
+        scrP.Set(float(*scrX++), float(*scrY++), float(dist));
+        *worldOut++ = GetViewTransform().ScreenToWorld(scrP);
+    }
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//// Lights, Buffers and Overrides ////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void plNullPipeline::RegisterLight(plLightInfo* liInfo)
+{
+    if( liInfo->IsLinked() )
+        return;
+
+    liInfo->Link(&fActiveLights);
+}
+
+void plNullPipeline::UnRegisterLight(plLightInfo* liInfo)
+{
+    liInfo->SetDeviceRef(nil);
+    liInfo->Unlink();
+}
+
+// OpenAccess /////////////////////////////////////////////////////////////////
+// No device buffers to lock, so hand out the buffer group's system copy,
+// laid out the way plDXPipeline::OpenAccess lays out the locked data.
+bool plNullPipeline::OpenAccess(plAccessSpan& dst, plDrawableSpans* drawable, const plVertexSpan* span, bool readOnly)
+{
+    plGBufferGroup* grp = drawable->GetBufferGroup(span->fGroupIdx);
+
+    const uint32_t stride = grp->GetVertexSize();
+    if( !span->fVLength || !grp->GetVertBufferData(span->fVBufferIdx) )
+    {
+        dst.SetType(plAccessSpan::kUndefined);
+        return false;
+    }
+
+    uint8_t* ptr = grp->GetVertBufferData(span->fVBufferIdx) + span->fVStartIdx * stride;
+
+    plAccessVtxSpan& acc = dst.AccessVtx();
+
+    acc.SetVertCount((uint16_t)(span->fVLength));
+
+    int32_t offset = (-(int32_t)(span->fVStartIdx)) * ((int32_t)stride);
+
+    acc.PositionStream(ptr, (uint16_t)stride, offset);
+    ptr += sizeof(hsPoint3);
+
+    int numWgts = grp->GetNumWeights();
+    if( numWgts )
+    {
+        acc.SetNumWeights(numWgts);
+        acc.WeightStream(ptr, (uint16_t)stride, offset);
+        ptr += numWgts * sizeof(float);
+        if( grp->GetVertexFormat() & plGBufferGroup::kSkinIndices )
+        {
+            acc.WgtIndexStream(ptr, (uint16_t)stride, offset);
+            ptr += sizeof(uint32_t);
+        }
+        else
+        {
+            acc.WgtIndexStream(nil, 0, offset);
+        }
+    }
+    else
+    {
+        acc.SetNumWeights(0);
+    }
+
+    acc.NormalStream(ptr, (uint16_t)stride, offset);
+    ptr += sizeof(hsVector3);
+
+    acc.DiffuseStream(ptr, (uint16_t)stride, offset);
+    ptr += sizeof(uint32_t);
+
+    acc.SpecularStream(ptr, (uint16_t)stride, offset);
+    ptr += sizeof(uint32_t);
+
+    acc.UVWStream(ptr, (uint16_t)stride, offset);
+
+    acc.SetNumUVWs(grp->GetNumUVs());
+
+    acc.SetVtxDeviceRef(nil);
+
+    return true;
+}
+
+bool plNullPipeline::CloseAccess(plAccessSpan& acc)
+{
+    return true;
+}
+
+hsGMaterial* plNullPipeline::PushOverrideMaterial(hsGMaterial* mat)
+{
+    hsGMaterial *ret = GetOverrideMaterial();
+    hsRefCnt_SafeRef(mat);
+    fOverrideMat.Push(mat);
+
+    return ret;
+}
+
+void plNullPipeline::PopOverrideMaterial(hsGMaterial* restore)
+{
+    hsGMaterial *pop = fOverrideMat.Pop();
+    hsRefCnt_SafeUnRef(pop);
+}
+
+hsGMaterial* plNullPipeline::GetOverrideMaterial() const
+{
+    return fOverrideMat.GetCount() ? fOverrideMat.Peek() : nil;
+}
+
+plLayerInterface* plNullPipeline::AppendLayerInterface(plLayerInterface* li, bool onAllLayers)
+{
+    if( onAllLayers )
+        return fOverAllLayer = li->Attach(fOverAllLayer);
+    else
+        return fOverBaseLayer = li->Attach(fOverBaseLayer);
+}
+
+plLayerInterface* plNullPipeline::RemoveLayerInterface(plLayerInterface* li, bool onAllLayers)
+{
+    if( onAllLayers )
+    {
+        if( !fOverAllLayer )
+            return nil;
+        return fOverAllLayer = fOverAllLayer->Remove(li);
+    }
+
+    if( !fOverBaseLayer )
+        return nil;
+
+    return fOverBaseLayer = fOverBaseLayer->Remove(li);
+}
+
+hsGMatState plNullPipeline::PushMaterialOverride(const hsGMatState& state, bool on)
+{
+    hsGMatState ret = GetMaterialOverride(on);
+    if( on )
+    {
+        fMatOverOn |= state;
+        fMatOverOff -= state;
+    }
+    else
+    {
+        fMatOverOff |= state;
+        fMatOverOn -= state;
+    }
+    return ret;
+}
+
+hsGMatState plNullPipeline::PushMaterialOverride(hsGMatState::StateIdx cat, uint32_t which, bool on)
+{
+    hsGMatState ret = GetMaterialOverride(on);
+    if( on )
+    {
+        fMatOverOn[ cat ] |= which;
+        fMatOverOff[ cat ] &= ~which;
+    }
+    else
+    {
+        fMatOverOn[ cat ] &= ~which;
+        fMatOverOff[ cat ] |= which;
+    }
+    return ret;
+}
+
+void plNullPipeline::PopMaterialOverride(const hsGMatState& restore, bool on)
+{
+    if( on )
+    {
+        fMatOverOn = restore;
+        fMatOverOff.Clear(restore);
+    }
+    else
+    {
+        fMatOverOff = restore;
+        fMatOverOn.Clear(restore);
+    }
+}
+
+const hsColorOverride& plNullPipeline::GetColorOverride() const
+{
+    static hsColorOverride ret;
+    return ret;
+}
+
+///////////////////////////////////////////////////////////////////////////////
+//// Display Modes ////////////////////////////////////////////////////////////
+///////////////////////////////////////////////////////////////////////////////
+
+void plNullPipeline::GetSupportedDisplayModes(std::vector<plDisplayMode> *res, int ColorDepth)
+{
+    res->clear();
+    res->push_back(fDesktopParams);
+}
+
+void plNullPipeline::ResetDisplayDevice(int Width, int Height, int ColorDepth, bool Windowed, int NumAASamples, int MaxAnisotropicSamples, bool vSync)
+{
+    Resize(Width, Height);
+}
@@ -0,0 +1,325 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#ifndef plNullPipeline_inc
+#define plNullPipeline_inc
+
+#include "plPipeline.h"
+#include "plPipeline/plCullTree.h"
+#include "plPipeline/plFogEnvironment.h"
+#include "plOcclusionBuffer.h"
+
+#include "hsMatrix44.h"
+#include "hsGeometry3.h"
+#include "hsTemplates.h"
+#include "hsColorRGBA.h"
+#include "hsBitVector.h"
+#include "plViewTransform.h"
+
+class plDrawableSpans;
+class plRenderTarget;
+
+// plNullPipeline - A pipeline with no device behind it.
+//
+// Everything the CPU does for a frame on plDXPipeline is done here the
+// same way: the cull tree and occlusion buffer are built from the same
+// occluders, the same spans are harvested and distance faded, drawables
+// get their clusters unpacked, faces sorted and PrepForRender called,
+// and skinned spans are blended with plSoftwareSkin (into scratch, since
+// there's no vertex buffer to put them in).
+//
+// Where plDXPipeline would issue a draw, a plDrawCall is recorded instead.
+// The list is cleared at the primary BeginRender, so after EndRender it
+// holds everything the frame would have drawn, render targets included.
+//
+// Per span light selection, shadow map and clothing texture generation
+// happen inside plDXPipeline's device code and aren't reproduced. Light
+// registration and shadow slave submission are only counted.
+//
+// Used for renderer-free runs of the client, like plFrameBench.
+class plNullPipeline : public plPipeline
+{
+public:
+    struct plDrawCall
+    {
+        plDrawableSpans*    fDrawable;
+        hsGMaterial*        fMaterial;
+        plRenderTarget*     fTarget;    // nil for the main view
+        uint32_t            fSpanIdx;
+        uint32_t            fNumVerts;
+        uint32_t            fNumTris;
+    };
+
+protected:
+    // The part of plDXViewSettings that doesn't involve a device.
+    class plNullViewSettings
+    {
+    public:
+        uint32_t            fRenderState;
+        plRenderRequest*    fRenderRequest;
+
+        uint32_t            fDrawableTypeMask;
+        uint32_t            fSubDrawableTypeMask;
+
+        hsColorRGBA         fClearColor;
+        float               fClearDepth;
+
+        plFogEnvironment    fDefaultFog;
+
+        plCullTree          fCullTree;
+        bool                fCullTreeDirty;
+        uint16_t            fCullMaxNodes;
+
+        hsMatrix44          fLocalToWorld;
+        hsMatrix44          fWorldToLocal;
+
+        plViewTransform     fTransform;
+
+        void                Reset();
+    };
+
+    plNullViewSettings              fView;
+    hsTArray<plNullViewSettings>    fViewStack;
+
+    hsTArray<plRenderTarget*>       fRenderTargets;
+    plRenderTarget*                 fCurrRenderTarget;
+
+    hsBitVector                     fDebugFlags;
+    uint32_t                        fProperties;
+    float                           fZBiasScale;
+
+    hsTArray<const plCullPoly*>     fCullPolys;
+    hsTArray<const plCullPoly*>     fCullHoles;
+
+    uint8_t                         fOcclusionMode;
+    plOcclusionBuffer               fOccBuffer;
+    bool                            fOccBufferValid;
+
+    hsTArray<hsGMaterial*>          fOverrideMat;
+    plLayerInterface*               fOverBaseLayer;
+    plLayerInterface*               fOverAllLayer;
+    hsGMatState                     fMatOverOn;
+    hsGMatState                     fMatOverOff;
+
+    plLightInfo*                    fActiveLights;
+
+    uint32_t                        fWidth;
+    uint32_t                        fHeight;
+
+    int                             fInSceneDepth;
+    uint32_t                        fRenderCnt;
+
+    std::vector<plDrawCall>         fDrawCalls;
+    hsGMaterial*                    fLastMaterial;
+    uint32_t                        fNumMaterialChanges;
+    uint32_t                        fNumShadowSlaves;
+
+    std::vector<uint8_t>            fSkinScratch;
+
+    bool        IOcclusionBufferActive() const { return fOccBufferValid && !fViewStack.GetCount(); }
+    void        IRefreshCullTree();
+    void        IRefreshOcclusionBuffer();
+    void        IHarvestVisible(plSpaceTree* space, hsTArray<int16_t>& visList);
+    void        IGetVisibleSpans(plDrawableSpans* drawable, hsTArray<int16_t>& visList, plVisMgr* visMgr);
+    bool        ISoftwareVertexBlend(plDrawableSpans* drawable, const hsTArray<int16_t>& visList);
+    void        IRecordSpan(plDrawableSpans* drawable, uint32_t spanIdx);
+
+    plViewTransform&    IGetViewTransform() { return fView.fTransform; }
+
+public:
+    plNullPipeline(uint32_t width, uint32_t height);
+    virtual ~plNullPipeline();
+
+    CLASSNAME_REGISTER( plNullPipeline );
+    GETINTERFACE_ANY( plNullPipeline, plPipeline );
+
+    // What was drawn since the primary BeginRender.
+    const std::vector<plDrawCall>&      GetDrawCalls() const { return fDrawCalls; }
+    uint32_t                            GetNumMaterialChanges() const { return fNumMaterialChanges; }
+    uint32_t                            GetNumShadowSlaves() const { return fNumShadowSlaves; }
+    uint32_t                            GetNumDrawTris() const;
+
+    virtual bool                        PreRender(plDrawable* drawable, hsTArray<int16_t>& visList, plVisMgr* visMgr=nil);
+    virtual bool                        PrepForRender(plDrawable* drawable, hsTArray<int16_t>& visList, plVisMgr* visMgr=nil);
+    virtual void                        Render(plDrawable* d, const hsTArray<int16_t>& visList);
+    virtual void                        Draw(plDrawable* d);
+
+    virtual plTextFont                  *MakeTextFont( char *face, uint16_t size ) { return nil; }
+
+    virtual void                        CheckVertexBufferRef(plGBufferGroup* owner, uint32_t idx) {}
+    virtual void                        CheckIndexBufferRef(plGBufferGroup* owner, uint32_t idx) {}
+
+    virtual bool                        OpenAccess(plAccessSpan& dst, plDrawableSpans* d, const plVertexSpan* span, bool readOnly);
+    virtual bool                        CloseAccess(plAccessSpan& acc);
+
+    virtual void                        CheckTextureRef(plLayerInterface* lay) {}
+
+    virtual void                        SetDefaultFogEnviron( plFogEnvironment *fog ) { fView.fDefaultFog = *fog; }
+    virtual const plFogEnvironment      &GetDefaultFogEnviron() const { return fView.fDefaultFog; }
+
+    virtual void                        RegisterLight(plLightInfo* light);
+    virtual void                        UnRegisterLight(plLightInfo* light);
+
+    virtual void                        PushRenderRequest(plRenderRequest* req);
+    virtual void                        PopRenderRequest(plRenderRequest* req);
+
+    virtual void                        ClearRenderTarget( plDrawable* d ) {}
+    virtual void                        ClearRenderTarget( const hsColorRGBA* col = nil, const float* depth = nil ) {}
+    virtual void                        SetClear(const hsColorRGBA* col=nil, const float* depth=nil);
+    virtual hsColorRGBA                 GetClearColor() const { return fView.fClearColor; }
+    virtual float                       GetClearDepth() const { return fView.fClearDepth; }
+    virtual hsGDeviceRef*               MakeRenderTargetRef( plRenderTarget *owner ) { return nil; }
+    virtual void                        PushRenderTarget( plRenderTarget *target );
+    virtual plRenderTarget*             PopRenderTarget();
+
+    virtual bool                        BeginRender();
+    virtual bool                        EndRender();
+    virtual void                        RenderScreenElements();
+
+    virtual bool                        BeginDrawable(plDrawable* d) { return true; }
+    virtual bool                        EndDrawable(plDrawable* d) { return true; }
+
+    virtual void                        BeginVisMgr(plVisMgr* visMgr) {}
+    virtual void                        EndVisMgr(plVisMgr* visMgr) {}
+
+    virtual bool                        IsFullScreen() const { return false; }
+    virtual uint32_t                    Width() const { return fWidth; }
+    virtual uint32_t                    Height() const { return fHeight; }
+    virtual uint32_t                    ColorDepth() const { return 32; }
+    virtual void                        Resize( uint32_t width, uint32_t height );
+
+    virtual bool                        TestVisibleWorld(const hsBounds3Ext& wBnd);
+    virtual bool                        TestVisibleWorld(const plSceneObject* sObj);
+    virtual bool                        HarvestVisible(plSpaceTree* space, hsTArray<int16_t>& visList);
+    virtual bool                        SubmitOccluders(const hsTArray<const plCullPoly*>& polyList);
+
+    virtual void                        SetDebugFlag( uint32_t flag, bool on ) { fDebugFlags.SetBit(flag, on); }
+    virtual bool                        IsDebugFlagSet( uint32_t flag ) const { return fDebugFlags.IsBitSet(flag); }
+    virtual void                        SetMaxCullNodes(uint16_t n) { fView.fCullMaxNodes = n; }
+    virtual uint16_t                    GetMaxCullNodes() const { return fView.fCullMaxNodes; }
+    virtual void                        SetOcclusionMode(uint8_t mode);
+    virtual uint8_t                     GetOcclusionMode() const { return fOcclusionMode; }
+
+    virtual bool                        CheckResources() { return false; }
+    virtual void                        LoadResources() {}
+
+    virtual void                        SetProperty( uint32_t prop, bool on ) { on ? fProperties |= prop : fProperties &= ~prop; }
+    virtual bool                        GetProperty( uint32_t prop ) const { return ( fProperties & prop ) ? true : false; }
+    virtual uint32_t                    GetMaxLayersAtOnce() const { return 8; }
+
+    virtual void                        SetDrawableTypeMask( uint32_t mask ) { fView.fDrawableTypeMask = mask; }
+    virtual uint32_t                    GetDrawableTypeMask() const { return fView.fDrawableTypeMask; }
+    virtual void                        SetSubDrawableTypeMask( uint32_t mask ) { fView.fSubDrawableTypeMask = mask; }
+    virtual uint32_t                    GetSubDrawableTypeMask() const { return fView.fSubDrawableTypeMask; }
+
+    virtual hsPoint3                    GetViewPositionWorld() const { return GetViewTransform().GetPosition(); }
+    virtual hsVector3                   GetViewAcrossWorld() const { return GetViewTransform().GetAcross(); }
+    virtual hsVector3                   GetViewUpWorld() const { return GetViewTransform().GetUp(); }
+    virtual hsVector3                   GetViewDirWorld() const { return GetViewTransform().GetDirection(); }
+    virtual void                        GetViewAxesWorld(hsVector3 axes[3] /* ac,up,at */ ) const;
+
+    virtual void                        GetFOV(float& fovX, float& fovY) const;
+    virtual void                        SetFOV(float fovX, float fovY);
+
+    virtual void                        GetSize(float& width, float& height) const;
+    virtual void                        SetSize(float width, float height);
+
+    virtual void                        GetDepth(float& hither, float& yon) const;
+    virtual void                        SetDepth(float hither, float yon);
+
+    virtual void                        SetZBiasScale( float scale ) { fZBiasScale = scale; }
+    virtual float                       GetZBiasScale() const { return fZBiasScale; }
+
+    virtual const hsMatrix44&           GetWorldToCamera() const { return fView.fTransform.GetWorldToCamera(); }
+    virtual const hsMatrix44&           GetCameraToWorld() const { return fView.fTransform.GetCameraToWorld(); }
+    virtual void                        SetWorldToCamera(const hsMatrix44& w2c, const hsMatrix44& c2w);
+
+    void                                SetViewTransform(const plViewTransform& trans);
+    virtual const plViewTransform&      GetViewTransform() const { return fView.fTransform; }
+
+    virtual const hsMatrix44&           GetWorldToLocal() const { return fView.fWorldToLocal; }
+    virtual const hsMatrix44&           GetLocalToWorld() const { return fView.fLocalToWorld; }
+
+    virtual void                        ScreenToWorldPoint( int n, uint32_t stride, int32_t *scrX, int32_t *scrY,
+                                                    float dist, uint32_t strideOut, hsPoint3 *worldOut );
+
+    virtual void                        RefreshMatrices() {}
+    virtual void                        RefreshScreenMatrices() {}
+
+    virtual hsGMaterial*                PushOverrideMaterial(hsGMaterial* mat);
+    virtual void                        PopOverrideMaterial(hsGMaterial* restore);
+    virtual hsGMaterial*                GetOverrideMaterial() const;
+
+    virtual plLayerInterface*           AppendLayerInterface(plLayerInterface* li, bool onAllLayers = false);
+    virtual plLayerInterface*           RemoveLayerInterface(plLayerInterface* li, bool onAllLayers = false);
+
+    virtual uint32_t                    GetMaterialOverrideOn(hsGMatState::StateIdx category) const { return fMatOverOn.Value(category); }
+    virtual uint32_t                    GetMaterialOverrideOff(hsGMatState::StateIdx category) const { return fMatOverOff.Value(category); }
+
+    virtual hsGMatState                 PushMaterialOverride(const hsGMatState& state, bool on);
+    virtual hsGMatState                 PushMaterialOverride(hsGMatState::StateIdx cat, uint32_t which, bool on);
+    virtual void                        PopMaterialOverride(const hsGMatState& restore, bool on);
+    virtual const hsGMatState&          GetMaterialOverride(bool on) const { return on ? fMatOverOn : fMatOverOff; }
+
+    virtual hsColorOverride             PushColorOverride(const hsColorOverride& over) { return GetColorOverride(); }
+    virtual void                        PopColorOverride(const hsColorOverride& restore) {}
+    virtual const hsColorOverride&      GetColorOverride() const;
+
+    virtual void                        SubmitShadowSlave(plShadowSlave* slave);
+    virtual void                        SubmitClothingOutfit(plClothingOutfit* co) {}
+
+    virtual bool                        SetGamma(float eR, float eG, float eB) { return false; }
+    virtual bool                        SetGamma(const uint16_t* const tabR, const uint16_t* const tabG, const uint16_t* const tabB) { return false; }
+
+    virtual bool                        CaptureScreen( plMipmap *dest, bool flipVertical = false, uint16_t desiredWidth = 0, uint16_t desiredHeight = 0 ) { return false; }
+    virtual plMipmap*                   ExtractMipMap(plRenderTarget* targ) { return nil; }
+
+    virtual const char                  *GetErrorString() { return nil; }
+
+    virtual void                        GetSupportedDisplayModes(std::vector<plDisplayMode> *res, int ColorDepth = 32 );
+    virtual int                         GetMaxAnisotropicSamples() { return 0; }
+    virtual int                         GetMaxAntiAlias(int Width, int Height, int ColorDepth) { return 0; }
+
+    virtual void                        ResetDisplayDevice(int Width, int Height, int ColorDepth, bool Windowed, int NumAASamples, int MaxAnisotropicSamples, bool vSync = false );
+};
+
+#endif // plNullPipeline_inc
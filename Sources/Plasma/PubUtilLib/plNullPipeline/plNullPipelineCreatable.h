@@ -39,6 +39,14 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
       Mead, WA   99021
 
 *==LICENSE==*/
-#include "hsSafeRefCnt.h"
 
-hsMutex hsSafeRefCnt::fMutex;
+#ifndef plNullPipelineCreatable_inc
+#define plNullPipelineCreatable_inc
+
+#include "pnFactory/plCreator.h"
+
+#include "plNullPipeline.h"
+
+REGISTER_NONCREATABLE( plNullPipeline );
+
+#endif // plNullPipelineCreatable_inc
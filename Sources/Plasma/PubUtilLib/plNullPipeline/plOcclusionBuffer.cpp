@@ -0,0 +1,597 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "HeadSpin.h"
+#include "plOcclusionBuffer.h"
+
+#include "hsBounds.h"
+#include "hsTimer.h"
+#include "plDrawable/plSpaceTree.h"
+#include "plScene/plCullPoly.h"
+#include "plProfile.h"
+
+#include <float.h>
+#include <math.h>
+
+#ifdef HS_SIMD_INCLUDE
+#  include HS_SIMD_INCLUDE
+#endif
+
+plProfile_CreateTimer("OccBuf Raster", "Draw", OccBufRaster);
+plProfile_CreateTimer("OccBuf Test", "Draw", OccBufTest);
+plProfile_CreateCounter("OccBuf Polys", "PipeC", OccBufPolys);
+plProfile_CreateCounter("OccBuf Tested", "PipeC", OccBufTested);
+plProfile_CreateCounter("OccBuf Culled", "PipeC", OccBufCulled);
+
+hsFunctionDispatcher<plOcclusionBuffer::raster_tri_ptr> plOcclusionBuffer::raster_tri(plOcclusionBuffer::raster_tri_fpu, plOcclusionBuffer::raster_tri_sse1);
+hsFunctionDispatcher<plOcclusionBuffer::test_span_ptr> plOcclusionBuffer::test_span(plOcclusionBuffer::test_span_fpu, plOcclusionBuffer::test_span_sse1);
+
+// Nothing has been drawn here. Never less than any depth, so never occludes.
+static const float kFarDepth = FLT_MAX;
+
+//// Triangle Setup ///////////////////////////////////////////////////////////
+// Edge functions and depth plane for one screen space triangle, set up to be
+// evaluated at integer pixel coordinates (the pixel centers are at +0.5).
+//
+// For an occluder, each edge is pulled in by half a pixel diagonal, so a
+// pixel passes only if all of it is inside, and the depth is pushed back to
+// the farthest the plane gets within the pixel. For a hole, the edges are
+// pushed out instead, so any pixel the hole touches passes.
+
+namespace
+{
+    struct plOccTriSetup
+    {
+        float   fA[3];
+        float   fB[3];
+        float   fC[3];
+
+        float   fZA;
+        float   fZB;
+        float   fZC;
+
+        int     fX0, fY0, fX1, fY1;
+
+        bool Init(const hsPoint3& v0, const hsPoint3& v1, const hsPoint3& v2, bool hole)
+        {
+            const float area = (v1.fX - v0.fX) * (v2.fY - v0.fY) - (v1.fY - v0.fY) * (v2.fX - v0.fX);
+            if( fabs(area) < 1.e-6f )
+                return false;
+
+            float minX = hsMinimum(v0.fX, hsMinimum(v1.fX, v2.fX));
+            float maxX = hsMaximum(v0.fX, hsMaximum(v1.fX, v2.fX));
+            float minY = hsMinimum(v0.fY, hsMinimum(v1.fY, v2.fY));
+            float maxY = hsMaximum(v0.fY, hsMaximum(v1.fY, v2.fY));
+            if( (maxX < 0) || (maxY < 0) || (minX >= plOcclusionBuffer::kWidth) || (minY >= plOcclusionBuffer::kHeight) )
+                return false;
+
+            fX0 = hsMaximum(0, int(floor(minX)));
+            fY0 = hsMaximum(0, int(floor(minY)));
+            fX1 = hsMinimum(int(plOcclusionBuffer::kWidth-1), int(floor(maxX)));
+            fY1 = hsMinimum(int(plOcclusionBuffer::kHeight-1), int(floor(maxY)));
+
+            const float sgn = area > 0 ? 1.f : -1.f;
+            const hsPoint3* v[3] = { &v0, &v1, &v2 };
+            int i;
+            for( i = 0; i < 3; i++ )
+            {
+                const hsPoint3& a = *v[i];
+                const hsPoint3& b = *v[i < 2 ? i+1 : 0];
+                fA[i] = -(b.fY - a.fY) * sgn;
+                fB[i] = (b.fX - a.fX) * sgn;
+                fC[i] = -(fA[i] * a.fX + fB[i] * a.fY);
+
+                const float halfPix = 0.5f * (fabs(fA[i]) + fabs(fB[i]));
+                fC[i] += 0.5f * (fA[i] + fB[i]) + (hole ? halfPix : -halfPix);
+            }
+
+            const float invArea = 1.f / area;
+            fZA = ((v1.fZ - v0.fZ) * (v2.fY - v0.fY) - (v2.fZ - v0.fZ) * (v1.fY - v0.fY)) * invArea;
+            fZB = ((v2.fZ - v0.fZ) * (v1.fX - v0.fX) - (v1.fZ - v0.fZ) * (v2.fX - v0.fX)) * invArea;
+            fZC = v0.fZ - fZA * v0.fX - fZB * v0.fY
+                + 0.5f * (fZA + fZB) + 0.5f * (fabs(fZA) + fabs(fZB));
+
+            return true;
+        }
+    };
+}
+
+//// FPU Version //////////////////////////////////////////////////////////////
+
+void plOcclusionBuffer::raster_tri_fpu(float* depth, const hsPoint3& v0, const hsPoint3& v1, const hsPoint3& v2, bool hole)
+{
+    plOccTriSetup tri;
+    if( !tri.Init(v0, v1, v2, hole) )
+        return;
+
+    int y;
+    for( y = tri.fY0; y <= tri.fY1; y++ )
+    {
+        float* row = depth + y * kWidth;
+
+        float e0 = tri.fA[0] * tri.fX0 + tri.fB[0] * y + tri.fC[0];
+        float e1 = tri.fA[1] * tri.fX0 + tri.fB[1] * y + tri.fC[1];
+        float e2 = tri.fA[2] * tri.fX0 + tri.fB[2] * y + tri.fC[2];
+        float z = tri.fZA * tri.fX0 + tri.fZB * y + tri.fZC;
+
+        int x;
+        for( x = tri.fX0; x <= tri.fX1; x++ )
+        {
+            if( (e0 >= 0) && (e1 >= 0) && (e2 >= 0) )
+            {
+                if( hole )
+                    row[x] = kFarDepth;
+                else if( z < row[x] )
+                    row[x] = z;
+            }
+            e0 += tri.fA[0];
+            e1 += tri.fA[1];
+            e2 += tri.fA[2];
+            z += tri.fZA;
+        }
+    }
+}
+
+bool plOcclusionBuffer::test_span_fpu(const float* depth, int count, float minZ)
+{
+    int i;
+    for( i = 0; i < count; i++ )
+    {
+        if( depth[i] >= minZ )
+            return true;
+    }
+    return false;
+}
+
+//// SSE Version //////////////////////////////////////////////////////////////
+// Same as above, 4 pixels at a time. The span is widened out to 4 pixel
+// boundaries, which is harmless since pixels off the triangle fail the
+// edge tests anyway. Rows are 16 byte aligned.
+
+void plOcclusionBuffer::raster_tri_sse1(float* depth, const hsPoint3& v0, const hsPoint3& v1, const hsPoint3& v2, bool hole)
+{
+#ifdef HS_SSE1
+    plOccTriSetup tri;
+    if( !tri.Init(v0, v1, v2, hole) )
+        return;
+
+    const int x0 = tri.fX0 & ~3;
+    const __m128 offs = _mm_set_ps(3.f, 2.f, 1.f, 0.f);
+    const __m128 zero = _mm_setzero_ps();
+    const __m128 far4 = _mm_set1_ps(kFarDepth);
+
+    const __m128 a0 = _mm_set1_ps(tri.fA[0]);
+    const __m128 a1 = _mm_set1_ps(tri.fA[1]);
+    const __m128 a2 = _mm_set1_ps(tri.fA[2]);
+    const __m128 za = _mm_set1_ps(tri.fZA);
+    const __m128 step0 = _mm_set1_ps(tri.fA[0] * 4.f);
+    const __m128 step1 = _mm_set1_ps(tri.fA[1] * 4.f);
+    const __m128 step2 = _mm_set1_ps(tri.fA[2] * 4.f);
+    const __m128 stepZ = _mm_set1_ps(tri.fZA * 4.f);
+
+    int y;
+    for( y = tri.fY0; y <= tri.fY1; y++ )
+    {
+        float* row = depth + y * kWidth;
+
+        __m128 e0 = _mm_add_ps(_mm_set1_ps(tri.fA[0] * x0 + tri.fB[0] * y + tri.fC[0]), _mm_mul_ps(a0, offs));
+        __m128 e1 = _mm_add_ps(_mm_set1_ps(tri.fA[1] * x0 + tri.fB[1] * y + tri.fC[1]), _mm_mul_ps(a1, offs));
+        __m128 e2 = _mm_add_ps(_mm_set1_ps(tri.fA[2] * x0 + tri.fB[2] * y + tri.fC[2]), _mm_mul_ps(a2, offs));
+        __m128 z = _mm_add_ps(_mm_set1_ps(tri.fZA * x0 + tri.fZB * y + tri.fZC), _mm_mul_ps(za, offs));
+
+        int x;
+        for( x = x0; x <= tri.fX1; x += 4 )
+        {
+            __m128 in = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+            if( _mm_movemask_ps(in) )
+            {
+                __m128 cur = _mm_load_ps(row + x);
+                __m128 val = hole ? far4 : _mm_min_ps(cur, z);
+                _mm_store_ps(row + x, _mm_or_ps(_mm_and_ps(in, val), _mm_andnot_ps(in, cur)));
+            }
+            e0 = _mm_add_ps(e0, step0);
+            e1 = _mm_add_ps(e1, step1);
+            e2 = _mm_add_ps(e2, step2);
+            z = _mm_add_ps(z, stepZ);
+        }
+    }
+#endif // HS_SSE1
+}
+
+bool plOcclusionBuffer::test_span_sse1(const float* depth, int count, float minZ)
+{
+#ifdef HS_SSE1
+    const __m128 z = _mm_set1_ps(minZ);
+    int i;
+    for( i = 0; i + 4 <= count; i += 4 )
+    {
+        if( _mm_movemask_ps(_mm_cmpge_ps(_mm_loadu_ps(depth + i), z)) )
+            return true;
+    }
+    for( ; i < count; i++ )
+    {
+        if( depth[i] >= minZ )
+            return true;
+    }
+#endif // HS_SSE1
+    return false;
+}
+
+//// Constructor & Destructor /////////////////////////////////////////////////
+
+plOcclusionBuffer::plOcclusionBuffer()
+:   fEmpty(true),
+    fBeginTime(0)
+{
+    fDepthMem = new uint8_t[kWidth * kHeight * sizeof(float) + 15];
+    fDepth = (float*)((uintptr_t(fDepthMem) + 15) & ~uintptr_t(15));
+
+    int i;
+    for( i = 0; i < kWidth * kHeight; i++ )
+        fDepth[i] = kFarDepth;
+    for( i = 0; i < kTilesWide * kTilesHigh; i++ )
+        fTileMax[i] = kFarDepth;
+
+    fWorldToNDC.Reset();
+    fViewPos.Set(0, 0, 0);
+    memset(&fStats, 0, sizeof(fStats));
+}
+
+plOcclusionBuffer::~plOcclusionBuffer()
+{
+    delete [] fDepthMem;
+}
+
+//// Building /////////////////////////////////////////////////////////////////
+
+void plOcclusionBuffer::Begin(const hsMatrix44& world2NDC, const hsPoint3& viewPos)
+{
+    fWorldToNDC = world2NDC;
+    fViewPos = viewPos;
+    fEmpty = true;
+
+    memset(&fStats, 0, sizeof(fStats));
+    fBeginTime = hsTimer::GetSeconds();
+
+    plProfile_BeginTiming(OccBufRaster);
+
+    int i;
+    for( i = 0; i < kWidth * kHeight; i++ )
+        fDepth[i] = kFarDepth;
+}
+
+// Same facing rules as plCullTree::AddPoly. One sided occluders only occlude
+// from the front, and a poly seen edge on isn't worth drawing.
+bool plOcclusionBuffer::IFacesView(const plCullPoly& poly) const
+{
+    hsVector3 cenToEye(&fViewPos, &poly.fCenter);
+    float camDist = cenToEye.InnerProduct(poly.fNorm);
+    const float kTol = 0.1f * cenToEye.Magnitude();
+    if( camDist < -kTol )
+        return poly.IsTwoSided();
+    return camDist >= kTol;
+}
+
+// Clip the poly to the hither plane and take it to screen space, into
+// fScrnVerts. Returns false if nothing is left.
+bool plOcclusionBuffer::IProjectPoly(const plCullPoly& poly)
+{
+    const float* hither = fWorldToNDC.fMap[2];
+
+    fClipVerts.SetCount(0);
+    const int n = poly.fVerts.GetCount();
+    int i;
+    for( i = 0; i < n; i++ )
+    {
+        const hsPoint3& p0 = poly.fVerts[i];
+        const hsPoint3& p1 = poly.fVerts[i < n-1 ? i+1 : 0];
+        const float d0 = hither[0] * p0.fX + hither[1] * p0.fY + hither[2] * p0.fZ + hither[3];
+        const float d1 = hither[0] * p1.fX + hither[1] * p1.fY + hither[2] * p1.fZ + hither[3];
+        if( d0 >= 0 )
+            fClipVerts.Append(p0);
+        if( (d0 >= 0) != (d1 >= 0) )
+        {
+            const float t = d0 / (d0 - d1);
+            hsPoint3 p(p0.fX + (p1.fX - p0.fX) * t, p0.fY + (p1.fY - p0.fY) * t, p0.fZ + (p1.fZ - p0.fZ) * t);
+            fClipVerts.Append(p);
+        }
+    }
+    if( fClipVerts.GetCount() < 3 )
+        return false;
+
+    fScrnVerts.SetCount(fClipVerts.GetCount());
+    for( i = 0; i < fClipVerts.GetCount(); i++ )
+    {
+        const hsPoint3& p = fClipVerts[i];
+        const float* m0 = fWorldToNDC.fMap[0];
+        const float* m1 = fWorldToNDC.fMap[1];
+        const float* m2 = fWorldToNDC.fMap[2];
+        const float* m3 = fWorldToNDC.fMap[3];
+        float w = m3[0] * p.fX + m3[1] * p.fY + m3[2] * p.fZ + m3[3];
+        if( w <= 0 )
+            return false;
+        float invW = 1.f / w;
+        float x = (m0[0] * p.fX + m0[1] * p.fY + m0[2] * p.fZ + m0[3]) * invW;
+        float y = (m1[0] * p.fX + m1[1] * p.fY + m1[2] * p.fZ + m1[3]) * invW;
+        float z = (m2[0] * p.fX + m2[1] * p.fY + m2[2] * p.fZ + m2[3]) * invW;
+
+        fScrnVerts[i].Set((x + 1.f) * (0.5f * kWidth), (1.f - y) * (0.5f * kHeight), z);
+    }
+    return true;
+}
+
+// Cull polys are convex, so a fan does it.
+void plOcclusionBuffer::IRasterPoly(bool hole)
+{
+    int i;
+    for( i = 2; i < fScrnVerts.GetCount(); i++ )
+        raster_tri.call(fDepth, fScrnVerts[0], fScrnVerts[i-1], fScrnVerts[i], hole);
+}
+
+bool plOcclusionBuffer::AddOccluder(const plCullPoly& poly)
+{
+    if( !IFacesView(poly) || !IProjectPoly(poly) )
+        return false;
+
+    IRasterPoly(false);
+    fStats.fOccluders++;
+    fEmpty = false;
+    return true;
+}
+
+// Holes are applied whichever way they face. Clearing more than needed only
+// costs some culling.
+bool plOcclusionBuffer::AddHole(const plCullPoly& poly)
+{
+    if( fEmpty || !IProjectPoly(poly) )
+        return false;
+
+    IRasterPoly(true);
+    fStats.fHoles++;
+    return true;
+}
+
+void plOcclusionBuffer::End()
+{
+    int ty;
+    for( ty = 0; ty < kTilesHigh; ty++ )
+    {
+        int tx;
+        for( tx = 0; tx < kTilesWide; tx++ )
+        {
+            const float* tile = fDepth + (ty << kTileShift) * kWidth + (tx << kTileShift);
+            float maxZ = -FLT_MAX;
+            int y;
+            for( y = 0; y < kTileSize; y++ )
+            {
+                int x;
+                for( x = 0; x < kTileSize; x++ )
+                {
+                    if( tile[x] > maxZ )
+                        maxZ = tile[x];
+                }
+                tile += kWidth;
+            }
+            fTileMax[ty * kTilesWide + tx] = maxZ;
+        }
+    }
+
+    plProfile_EndTiming(OccBufRaster);
+    plProfile_IncCount(OccBufPolys, fStats.fOccluders + fStats.fHoles);
+
+    fStats.fRasterTime = hsTimer::GetSeconds() - fBeginTime;
+}
+
+//// Testing //////////////////////////////////////////////////////////////////
+
+// True if any pixel in the (inclusive) rect is at or beyond minZ.
+bool plOcclusionBuffer::ITestRect(int x0, int y0, int x1, int y1, float minZ) const
+{
+    int ty;
+    for( ty = y0 >> kTileShift; ty <= (y1 >> kTileShift); ty++ )
+    {
+        const int py0 = hsMaximum(y0, ty << kTileShift);
+        const int py1 = hsMinimum(y1, ((ty+1) << kTileShift) - 1);
+
+        int tx;
+        for( tx = x0 >> kTileShift; tx <= (x1 >> kTileShift); tx++ )
+        {
+            if( fTileMax[ty * kTilesWide + tx] < minZ )
+                continue;
+
+            const int px0 = hsMaximum(x0, tx << kTileShift);
+            const int px1 = hsMinimum(x1, ((tx+1) << kTileShift) - 1);
+
+            int y;
+            for( y = py0; y <= py1; y++ )
+            {
+                if( test_span.call(fDepth + y * kWidth + px0, px1 - px0 + 1, minZ) )
+                    return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool plOcclusionBuffer::BoundsVisible(const hsBounds3Ext& bnd) const
+{
+    if( fEmpty || (bnd.GetType() != kBoundsNormal) )
+        return true;
+
+    fStats.fNodesTested++;
+
+    const hsPoint3& mins = bnd.GetMins();
+    const hsPoint3& maxs = bnd.GetMaxs();
+    const hsMatrix44& m = fWorldToNDC;
+
+    // Project the corner at mins, then build the others by adding in
+    // the projected extent along each axis.
+    float base[4];
+    float ext[3][4];
+    int j;
+    for( j = 0; j < 4; j++ )
+    {
+        base[j] = m.fMap[j][0] * mins.fX + m.fMap[j][1] * mins.fY + m.fMap[j][2] * mins.fZ + m.fMap[j][3];
+        ext[0][j] = m.fMap[j][0] * (maxs.fX - mins.fX);
+        ext[1][j] = m.fMap[j][1] * (maxs.fY - mins.fY);
+        ext[2][j] = m.fMap[j][2] * (maxs.fZ - mins.fZ);
+    }
+
+    float minX = FLT_MAX, minY = FLT_MAX, minZ = FLT_MAX;
+    float maxX = -FLT_MAX, maxY = -FLT_MAX;
+    int i;
+    for( i = 0; i < 8; i++ )
+    {
+        float c[4];
+        for( j = 0; j < 4; j++ )
+        {
+            c[j] = base[j];
+            if( i & 1 )
+                c[j] += ext[0][j];
+            if( i & 2 )
+                c[j] += ext[1][j];
+            if( i & 4 )
+                c[j] += ext[2][j];
+        }
+        // Anything reaching back past the hither is right on top of us.
+        if( (c[2] < 0) || (c[3] <= 0) )
+            return true;
+
+        const float invW = 1.f / c[3];
+        const float x = c[0] * invW;
+        const float y = c[1] * invW;
+        const float z = c[2] * invW;
+        if( x < minX ) minX = x;
+        if( x > maxX ) maxX = x;
+        if( y < minY ) minY = y;
+        if( y > maxY ) maxY = y;
+        if( z < minZ ) minZ = z;
+    }
+
+    // Screen y runs down, so NDC maxY is the top row.
+    const float scrX0 = (minX + 1.f) * (0.5f * kWidth);
+    const float scrX1 = (maxX + 1.f) * (0.5f * kWidth);
+    const float scrY0 = (1.f - maxY) * (0.5f * kHeight);
+    const float scrY1 = (1.f - minY) * (0.5f * kHeight);
+
+    // Off screen is the frustum's call, not ours.
+    if( (scrX1 < 0) || (scrY1 < 0) || (scrX0 >= kWidth) || (scrY0 >= kHeight) )
+        return true;
+
+    const int x0 = hsMaximum(0, int(floor(scrX0)));
+    const int y0 = hsMaximum(0, int(floor(scrY0)));
+    const int x1 = hsMinimum(int(kWidth-1), int(floor(scrX1)));
+    const int y1 = hsMinimum(int(kHeight-1), int(floor(scrY1)));
+
+    if( ITestRect(x0, y0, x1, y1, minZ) )
+        return true;
+
+    fStats.fNodesCulled++;
+    return false;
+}
+
+// Walk down from the root, but only into subtrees holding a leaf from
+// visList. An occluded interior node takes all of its leaves with it
+// without testing them.
+void plOcclusionBuffer::IFilterRecur(const plSpaceTree* space, int16_t idx) const
+{
+    const plSpaceTreeNode& node = space->GetNode(idx);
+    if( !BoundsVisible(node.GetWorldBounds()) )
+        return;
+
+    if( node.IsLeaf() )
+    {
+        fScratchVis.SetBit(idx);
+        return;
+    }
+
+    int i;
+    for( i = 0; i < 2; i++ )
+    {
+        int16_t child = node.GetChild(i);
+        if( fScratchMark.IsBitSet(child) )
+            IFilterRecur(space, child);
+    }
+}
+
+void plOcclusionBuffer::Filter(const plSpaceTree* space, hsTArray<int16_t>& visList) const
+{
+    if( fEmpty || !visList.GetCount() )
+        return;
+
+    plProfile_BeginTiming(OccBufTest);
+    double start = hsTimer::GetSeconds();
+    uint32_t tested = fStats.fNodesTested;
+
+    fScratchMark.Clear();
+    fScratchVis.Clear();
+
+    int i;
+    for( i = 0; i < visList.GetCount(); i++ )
+    {
+        int16_t idx = visList[i];
+        while( (idx != plSpaceTree::kRootParent) && !fScratchMark.IsBitSet(idx) )
+        {
+            fScratchMark.SetBit(idx);
+            idx = space->GetNode(idx).GetParent();
+        }
+    }
+
+    IFilterRecur(space, space->GetRoot());
+
+    // Keep the order the culler gave us.
+    int numVis = 0;
+    for( i = 0; i < visList.GetCount(); i++ )
+    {
+        if( fScratchVis.IsBitSet(visList[i]) )
+            visList[numVis++] = visList[i];
+    }
+    uint32_t culled = visList.GetCount() - numVis;
+    visList.SetCount(numVis);
+
+    fStats.fLeavesCulled += culled;
+    fStats.fTestTime += hsTimer::GetSeconds() - start;
+
+    plProfile_IncCount(OccBufTested, fStats.fNodesTested - tested);
+    plProfile_IncCount(OccBufCulled, culled);
+    plProfile_EndTiming(OccBufTest);
+}
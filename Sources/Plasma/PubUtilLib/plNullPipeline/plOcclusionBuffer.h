@@ -0,0 +1,165 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#ifndef plOcclusionBuffer_inc
+#define plOcclusionBuffer_inc
+
+#include "HeadSpin.h"
+#include "hsCpuID.h"
+#include "hsTemplates.h"
+#include "hsGeometry3.h"
+#include "hsMatrix44.h"
+#include "hsBitVector.h"
+
+class hsBounds3Ext;
+class plCullPoly;
+class plSpaceTree;
+
+// plOcclusionBuffer - Software rasterized occlusion, as an alternative
+// (or a second pass) to putting the occluder polys into the plCullTree.
+//
+// The cull tree grows a BSP node per occluder edge, so its cost climbs
+// quickly with the number of occluders, and the pipeline caps it with
+// fCullMaxNodes. The buffer instead rasterizes the occluders into a small
+// NDC depth buffer, with a max depth per 8x8 tile on top. Each tested
+// bound is projected to a screen rect and nearest depth, which is then
+// compared against the tiles, and only against pixels where a tile
+// can't decide.
+//
+// Everything errs on the side of visible. Occluders only write pixels
+// they cover completely, at the farthest depth they have within the
+// pixel. Holes clear every pixel they touch. Bounds touch every pixel
+// their rect overlaps, and any bound crossing the hither plane is
+// visible.
+//
+// Usage per view is Begin(), AddOccluder()/AddHole() for each poly (all
+// holes after all occluders), End(), then any number of BoundsVisible()
+// or Filter() calls until the next Begin().
+class plOcclusionBuffer
+{
+public:
+    enum
+    {
+        kWidth          = 256,
+        kHeight         = 128,
+        kTileShift      = 3,
+        kTileSize       = 1 << kTileShift,
+        kTilesWide      = kWidth >> kTileShift,
+        kTilesHigh      = kHeight >> kTileShift
+    };
+
+    // Totals since the last Begin(). Times are in seconds.
+    struct Stats
+    {
+        uint32_t    fOccluders;     // Polys actually rasterized
+        uint32_t    fHoles;
+        uint32_t    fNodesTested;   // Bounds tested, leaf or interior
+        uint32_t    fNodesCulled;
+        uint32_t    fLeavesCulled;  // Leaves Filter() took out of vis lists
+        double      fRasterTime;
+        double      fTestTime;
+    };
+
+protected:
+    float*                  fDepth;     // kWidth x kHeight, 16 byte aligned
+    uint8_t*                fDepthMem;
+    float                   fTileMax[kTilesWide * kTilesHigh];
+
+    hsMatrix44              fWorldToNDC;
+    hsPoint3                fViewPos;
+    bool                    fEmpty;     // No occluder pixels written
+
+    mutable Stats           fStats;
+    double                  fBeginTime;
+
+    // Scratch for clipping polys against the hither plane, and the
+    // clipped poly in screen space (pixels, with NDC z).
+    hsTArray<hsPoint3>      fClipVerts;
+    hsTArray<hsPoint3>      fScrnVerts;
+
+    // Scratch for Filter().
+    mutable hsBitVector     fScratchMark;
+    mutable hsBitVector     fScratchVis;
+
+    bool            IFacesView(const plCullPoly& poly) const;
+    bool            IProjectPoly(const plCullPoly& poly);
+    void            IRasterPoly(bool hole);
+    bool            ITestRect(int x0, int y0, int x1, int y1, float minZ) const;
+    void            IFilterRecur(const plSpaceTree* space, int16_t idx) const;
+
+    //  CPU-optimized functions
+    //  Triangles are in screen space, rows are kWidth floats.
+    typedef void(*raster_tri_ptr)(float*, const hsPoint3&, const hsPoint3&, const hsPoint3&, bool);
+    static void raster_tri_fpu(float*, const hsPoint3&, const hsPoint3&, const hsPoint3&, bool);
+    static void raster_tri_sse1(float*, const hsPoint3&, const hsPoint3&, const hsPoint3&, bool);
+    static hsFunctionDispatcher<raster_tri_ptr> raster_tri;
+
+    typedef bool(*test_span_ptr)(const float*, int, float);
+    static bool test_span_fpu(const float*, int, float);
+    static bool test_span_sse1(const float*, int, float);
+    static hsFunctionDispatcher<test_span_ptr> test_span;
+
+public:
+    plOcclusionBuffer();
+    ~plOcclusionBuffer();
+
+    void            Begin(const hsMatrix44& world2NDC, const hsPoint3& viewPos);
+    bool            AddOccluder(const plCullPoly& poly);
+    bool            AddHole(const plCullPoly& poly);
+    void            End();
+
+    bool            IsEmpty() const { return fEmpty; }
+
+    bool            BoundsVisible(const hsBounds3Ext& bnd) const;
+
+    // Remove from visList (leaf indices into space, as from a plCuller
+    // Harvest) any leaves whose bounds are fully occluded.
+    void            Filter(const plSpaceTree* space, hsTArray<int16_t>& visList) const;
+
+    const Stats&    GetStats() const { return fStats; }
+
+    // Raw access, for visualization and comparing against the cull tree.
+    const float*    GetDepth() const { return fDepth; }
+    float           GetTileMax(int tx, int ty) const { return fTileMax[ty * kTilesWide + tx]; }
+};
+
+#endif // plOcclusionBuffer_inc
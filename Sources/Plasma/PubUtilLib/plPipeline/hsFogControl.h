@@ -45,6 +45,9 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 //#include "hsSceneObject.h"
 //#include "hsGEnviron.h"
+#include "hsTemplates.h"
+#include "pnFactory/plCreatable.h"
+#include "pnKeyedObject/plKey.h"
 
 class hsSceneNode;
 class hsG3DDevice;
@@ -46,6 +46,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "hsBounds.h"
 #include "hsGeometry3.h"
 #include "hsBitVector.h"
+#include "hsFastArray.h"
 #include "plCuller.h"
 #include "plScene/plCullPoly.h"
 
@@ -74,9 +75,9 @@ protected:
     mutable float                        fVisYon;
 
     mutable hsTArray<plCullPoly>        fScratchPolys;
-    mutable hsLargeArray<int16_t>     fScratchClear;
-    mutable hsLargeArray<int16_t>     fScratchSplit;
-    mutable hsLargeArray<int16_t>     fScratchCulled;
+    mutable hsFastArray<int16_t>      fScratchClear;
+    mutable hsFastArray<int16_t>      fScratchSplit;
+    mutable hsFastArray<int16_t>      fScratchCulled;
     mutable hsBitVector             fScratchBitVec;
     mutable hsBitVector             fScratchTotVec;
 
@@ -102,9 +103,9 @@ protected:
 
     // Some scratch areas for the nodes use when building the tree etc.
     hsTArray<plCullPoly>&           ScratchPolys() const { return fScratchPolys; }
-    hsLargeArray<int16_t>&            ScratchClear() const { return fScratchClear; }
-    hsLargeArray<int16_t>&            ScratchSplit() const { return fScratchSplit; }
-    hsLargeArray<int16_t>&            ScratchCulled() const { return fScratchCulled; }
+    hsFastArray<int16_t>&             ScratchClear() const { return fScratchClear; }
+    hsFastArray<int16_t>&             ScratchSplit() const { return fScratchSplit; }
+    hsFastArray<int16_t>&             ScratchCulled() const { return fScratchCulled; }
     hsBitVector&                    ScratchBitVec() const { return fScratchBitVec; }
     hsBitVector&                    ScratchTotVec() const { return fScratchTotVec; }
 
@@ -175,7 +176,7 @@ protected:
     plCullNode::plCullStatus    ITestSphereRecur(const hsPoint3& center, float rad) const;
 
     // Using the nodes
-    plCullNode::plCullStatus    ITestNode(const plSpaceTree* space, int16_t who, hsLargeArray<int16_t>& clear, hsLargeArray<int16_t>& split, hsLargeArray<int16_t>& culled) const;
+    plCullNode::plCullStatus    ITestNode(const plSpaceTree* space, int16_t who, hsFastArray<int16_t>& clear, hsFastArray<int16_t>& split, hsFastArray<int16_t>& culled) const;
     void                        ITestNode(const plSpaceTree* space, int16_t who, hsBitVector& totList, hsBitVector& outList) const;
     void                        IHarvest(const plSpaceTree* space, hsTArray<int16_t>& outList) const;
 
@@ -194,9 +195,9 @@ protected:
                                     plCullPoly& srcPoly) const;
 
     hsTArray<plCullPoly>&           ScratchPolys() const { return fTree->ScratchPolys(); }
-    hsLargeArray<int16_t>&            ScratchClear() const { return fTree->ScratchClear(); }
-    hsLargeArray<int16_t>&            ScratchSplit() const { return fTree->ScratchSplit(); }
-    hsLargeArray<int16_t>&            ScratchCulled() const { return fTree->ScratchCulled(); }
+    hsFastArray<int16_t>&             ScratchClear() const { return fTree->ScratchClear(); }
+    hsFastArray<int16_t>&             ScratchSplit() const { return fTree->ScratchSplit(); }
+    hsFastArray<int16_t>&             ScratchCulled() const { return fTree->ScratchCulled(); }
     hsBitVector&                    ScratchBitVec() const { return fTree->ScratchBitVec(); }
     hsBitVector&                    ScratchTotVec() const { return fTree->ScratchTotVec(); }
 
@@ -106,6 +106,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include "pnSceneObject/plDrawInterface.h"
 #include "hsFastMath.h"
 #include "plGLight/plLightInfo.h"
+#include "plIntersect/plSoftVolume.h"
 #include "plParticleSystem/plParticleEmitter.h"
 #include "plParticleSystem/plParticle.h"
 #include "plAvatar/plAvatarClothing.h"
@@ -158,15 +159,12 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #endif
 
 #include "plCullTree.h"
+#include "plSoftwareSkin/plSoftwareSkin.h"
 
 #include "plTweak.h"
 
 #include <algorithm>
 
-#ifdef HS_SIMD_INCLUDE
-#  include HS_SIMD_INCLUDE
-#endif
-
 //#define MF_TOSSER
 
 int mfCurrentTest = 100;
@@ -201,43 +199,6 @@ void plReleaseObject(IUnknown* x)
 
 //// Local Static Stuff ///////////////////////////////////////////////////////
 
-/// Macros for getting/setting data in a D3D vertex buffer
-inline uint8_t* inlStuffPoint( uint8_t* ptr, const hsScalarTriple& point )
-{
-    register float* dst = (float*)ptr;
-    register const float* src = (float*)&point.fX;
-    *dst++ = *src++;
-    *dst++ = *src++;
-    *dst++ = *src++;
-    return (uint8_t*)dst;
-}
-inline uint8_t* inlStuffUInt32( uint8_t* ptr, const uint32_t uint )
-{
-    *(uint32_t*)ptr = uint;
-    return ptr + sizeof(uint);
-}
-inline uint8_t* inlExtractPoint( const uint8_t* ptr, const hsScalarTriple& pt )
-{
-    register const float* src = (float*)ptr;
-    register float* dst = (float*)&pt.fX;
-    *dst++ = *src++;
-    *dst++ = *src++;
-    *dst++ = *src++;
-    return (uint8_t*)src;
-}
-inline uint8_t* inlExtractFloat( const uint8_t*& ptr, float& f )
-{
-    register const float* src = (float*)ptr;
-    f = *src++;
-    return (uint8_t*)src;
-}
-inline uint8_t* inlExtractUInt32( const uint8_t*& ptr, uint32_t& uint )
-{
-    const uint32_t* src = (uint32_t*)ptr;
-    uint = *src++;
-    return (uint8_t*)src;
-}
-
 inline DWORD F2DW( FLOAT f ) 
 { 
     return *((DWORD*)&f); 
@@ -296,24 +257,24 @@ plProfile_CreateMemCounter("Pipeline Surfaces", "Memory", MemPipelineSurfaces);
 plProfile_Extern(MemVertex);
 plProfile_Extern(MemIndex);
 plProfile_CreateCounter("Feed Triangles", "Draw", DrawFeedTriangles);
-plProfile_CreateCounter("Polys", "General", DrawTriangles);
-plProfile_CreateCounter("Draw Prim Static", "Draw", DrawPrimStatic);
+plProfile_Extern(DrawTriangles);
+plProfile_Extern(DrawPrimStatic);
 plProfile_CreateMemCounter("Total Texture Size", "Draw", TotalTexSize);
-plProfile_CreateTimer("Harvest", "Draw", Harvest);
-plProfile_CreateCounter("Material Change", "Draw", MatChange);
+plProfile_Extern(Harvest);
+plProfile_Extern(MatChange);
 plProfile_CreateCounter("Layer Change", "Draw", LayChange);
 
 plProfile_Extern(DrawOccBuild);
 
 plProfile_CreateCounterNoReset("Reload", "PipeC", PipeReload);
 
-plProfile_CreateTimer("RenderScene", "PipeT", RenderScene);
-plProfile_CreateTimer("VisEval", "PipeT", VisEval);
-plProfile_CreateTimer("VisSelect", "PipeT", VisSelect);
+plProfile_Extern(RenderScene);
+plProfile_Extern(VisEval);
+plProfile_Extern(VisSelect);
 plProfile_CreateTimer("FindSceneLights", "PipeT", FindSceneLights);
 plProfile_CreateTimer("PrepShadows", "PipeT", PrepShadows);
-plProfile_CreateTimer("PrepDrawable", "PipeT", PrepDrawable);
-plProfile_CreateTimer("  Skin", "PipeT", Skin);
+plProfile_Extern(PrepDrawable);
+plProfile_Extern(Skin);
 plProfile_CreateTimer("  AvSort", "PipeT", AvatarSort);
 plProfile_CreateTimer("  Find Lights", "PipeT", FindLights);
 plProfile_CreateTimer("    Find Perms", "PipeT", FindPerm);
@@ -359,9 +320,9 @@ plProfile_CreateCounter("Perms Found", "PipeC", FindLightsPerm);
 plProfile_CreateCounter("Merge", "PipeC", SpanMerge);
 plProfile_CreateCounter("TexNum", "PipeC", NumTex);
 plProfile_CreateCounter("LiState", "PipeC", MatLightState);
-plProfile_CreateCounter("OccPoly", "PipeC", OccPolyUsed);
-plProfile_CreateCounter("OccNode", "PipeC", OccNodeUsed);
-plProfile_CreateCounter("NumSkin", "PipeC", NumSkin);
+plProfile_Extern(OccPolyUsed);
+plProfile_Extern(OccNodeUsed);
+plProfile_Extern(NumSkin);
 plProfile_CreateCounter("AvatarFaces", "PipeC", AvatarFaces);
 plProfile_CreateCounter("VertexChange", "PipeC", VertexChange);
 plProfile_CreateCounter("IndexChange", "PipeC", IndexChange);
@@ -693,6 +654,8 @@ plDXPipeline::~plDXPipeline()
     IReleaseDeviceObjects();
     IClearClothingOutfits(&fClothingOutfits);
     IClearClothingOutfits(&fPrevClothingOutfits);
+
+    plSoftwareSkin::Shutdown();
 }
 
 //// IClearMembers ////////////////////////////////////////////////////////////
@@ -787,6 +750,8 @@ void    plDXPipeline::IClearMembers()
     fView.Reset();
 
     fCullProxy = nil;
+    fOcclusionMode = kOcclusionCullTree;
+    fOccBufferValid = false;
 
     fTime = 0;
     fFrame = 0;
@@ -3022,6 +2987,51 @@ void plDXPipeline::EndVisMgr(plVisMgr* visMgr)
     fLights.fVisLights.SetCount(0);
 }
 
+// plLeafCache //////////////////////////////////////////////////////////////////////////
+// The space tree's enabled leaf cache for a list of spans (see plSpaceTree::EnableLeaves),
+// filled in the first time a light needs it.
+struct plLeafCache
+{
+    hsBitVector     fCache;
+    bool            fBuilt;
+
+    plLeafCache() : fBuilt(false) {}
+};
+
+static const hsBitVector& GetLeafCache(plSpaceTree* space, const hsTArray<int16_t>& list, plLeafCache& cache)
+{
+    if( !cache.fBuilt )
+    {
+        cache.fCache.Clear();
+        space->EnableLeaves(list, cache.fCache);
+        cache.fBuilt = true;
+    }
+    return cache.fCache;
+}
+
+// PrimeSoftVolume //////////////////////////////////////////////////////////////////////
+// Evaluates the light's soft volume at the centers of the next chunk of lit spans in one
+// batch, so that GetStrengthAndScale finds each of them already in the volume's cache.
+static const int kSoftPrimeChunk = 32;
+
+static void PrimeSoftVolume(const plLightInfo* light, plDrawableSpans* drawable, const hsTArray<int16_t>& litList, int first)
+{
+    const plSoftVolume* soft = light->GetSoftVolume();
+    if( !soft || !plSoftVolume::GetUseCache() )
+        return;
+
+    const int num = hsMinimum(kSoftPrimeChunk, litList.GetCount() - first);
+    if( num < 2 )
+        return;
+
+    hsPoint3 pos[kSoftPrimeChunk];
+    int i;
+    for( i = 0; i < num; i++ )
+        pos[i] = drawable->GetSpan(litList[first + i])->fWorldBounds.GetCenter();
+
+    soft->CacheStrengths(pos, num);
+}
+
 // ICheckLighting ///////////////////////////////////////////////////////
 // For every span in the list of visible span indices, find the list of
 // lights that currently affect the span with an estimate of the strength
@@ -3145,6 +3155,13 @@ void plDXPipeline::ICheckLighting(plDrawableSpans* drawable, hsTArray<int16_t>&
     }
     plProfile_EndTiming(FindActiveLights);
     
+    // Every light looking at the same span list walks the same part of the space tree,
+    // so the enabled leaves for each list are found once, on first use, and shared.
+    static plLeafCache visCache;
+    static plLeafCache specCache;
+    static plLeafCache moveCache;
+    visCache.fBuilt = specCache.fBuilt = moveCache.fBuilt = false;
+
     // Loop over the lights and for each light, extract a list of the spans that light
     // affects. Append the light to each spans list with a scalar strength of how strongly
     // the light affects it. Since the strength is based on the object's center position, 
@@ -3161,6 +3178,7 @@ void plDXPipeline::ICheckLighting(plDrawableSpans* drawable, hsTArray<int16_t>&
 
             const hsTArray<int16_t>& litList = light->GetAffected(drawable->GetSpaceTree(), 
                 visList, 
+                GetLeafCache(drawable->GetSpaceTree(), visList, visCache),
                 tmpList, 
                 drawable->GetNativeProperty(plDrawable::kPropCharacter) );
             
@@ -3171,6 +3189,9 @@ void plDXPipeline::ICheckLighting(plDrawableSpans* drawable, hsTArray<int16_t>&
             
             for( j = 0; j < litList.GetCount(); j++ )
             {
+                if( !(j % kSoftPrimeChunk) )
+                    PrimeSoftVolume(light, drawable, litList, j);
+
                 // Use the light IF light is enabled and 
                 //      1) light is movable
                 //      2) span is movable, or
@@ -3209,6 +3230,7 @@ void plDXPipeline::ICheckLighting(plDrawableSpans* drawable, hsTArray<int16_t>&
 
             const hsTArray<int16_t>& litList = light->GetAffected(drawable->GetSpaceTree(), 
                 specList, 
+                GetLeafCache(drawable->GetSpaceTree(), specList, specCache),
                 tmpList, 
                 drawable->GetNativeProperty(plDrawable::kPropCharacter) );
             
@@ -3219,6 +3241,9 @@ void plDXPipeline::ICheckLighting(plDrawableSpans* drawable, hsTArray<int16_t>&
             
             for( j = 0; j < litList.GetCount(); j++ )
             {
+                if( !(j % kSoftPrimeChunk) )
+                    PrimeSoftVolume(light, drawable, litList, j);
+
                 // Use the light IF light is enabled and 
                 //      1) light is movable
                 //      2) span is movable, or
@@ -3256,6 +3281,7 @@ void plDXPipeline::ICheckLighting(plDrawableSpans* drawable, hsTArray<int16_t>&
 
             const hsTArray<int16_t>& litList = light->GetAffected(drawable->GetSpaceTree(), 
                 moveList, 
+                GetLeafCache(drawable->GetSpaceTree(), moveList, moveCache),
                 tmpList, 
                 drawable->GetNativeProperty(plDrawable::kPropCharacter) );
             
@@ -3266,6 +3292,9 @@ void plDXPipeline::ICheckLighting(plDrawableSpans* drawable, hsTArray<int16_t>&
             
             for( j = 0; j < litList.GetCount(); j++ )
             {
+                if( !(j % kSoftPrimeChunk) )
+                    PrimeSoftVolume(light, drawable, litList, j);
+
                 // Use the light IF light is enabled and 
                 //      1) light is movable
                 //      2) span is movable, or
@@ -3325,12 +3354,23 @@ bool plDXPipeline::HarvestVisible(plSpaceTree* space, hsTArray<int16_t>& visList
         IRefreshCullTree();
 
     plProfile_BeginTiming(Harvest);
-    fView.fCullTree.Harvest(space, visList);
+    IHarvestVisible(space, visList);
     plProfile_EndTiming(Harvest);
 
     return visList.GetCount() != 0;
 }
 
+// IHarvestVisible ////////////////////////////////////////////////////////////////////////
+// Harvest from the cull tree, then, if it's in use for this view, let the occlusion
+// buffer take out anything hidden behind the occluders.
+void plDXPipeline::IHarvestVisible(plSpaceTree* space, hsTArray<int16_t>& visList)
+{
+    fView.fCullTree.Harvest(space, visList);
+
+    if( IOcclusionBufferActive() )
+        fOccBuffer.Filter(space, visList);
+}
+
 //// IGetVisibleSpans /////////////////////////////////////////////////////
 //  Given a drawable, returns a list of visible span indices. Disabled spans will not
 //  show up in the list, behaving as if they were culled. 
@@ -3356,12 +3396,12 @@ void plDXPipeline::IGetVisibleSpans( plDrawableSpans* drawable, hsTArray<int16_t
     if( visMgr )
     {
         drawable->SetVisSet(visMgr);
-        fView.fCullTree.Harvest(drawable->GetSpaceTree(), tmpVis);
+        IHarvestVisible(drawable->GetSpaceTree(), tmpVis);
         drawable->SetVisSet(nil);
     }
     else
     {
-        fView.fCullTree.Harvest(drawable->GetSpaceTree(), tmpVis);
+        IHarvestVisible(drawable->GetSpaceTree(), tmpVis);
     }
 
     // This is a big waste of time, As a desparate "optimization" pass, the artists
@@ -9039,7 +9079,11 @@ bool plDXPipeline::TestVisibleWorld( const hsBounds3Ext& wBnd )
     if( fView.fCullTreeDirty )
         IRefreshCullTree();
     if (wBnd.GetType() == kBoundsNormal)
-        return fView.fCullTree.BoundsVisible(wBnd);
+    {
+        if( !fView.fCullTree.BoundsVisible(wBnd) )
+            return false;
+        return !IOcclusionBufferActive() || fOccBuffer.BoundsVisible(wBnd);
+    }
     else
         return false;
 }
@@ -9327,22 +9371,38 @@ void plDXPipeline::IRefreshCullTree()
         fView.fCullTree.InitFrustum(GetViewTransform().GetWorldToNDC());
         fView.fCullTreeDirty = false;
 
+        // The occlusion buffer is only kept for the main view. Render targets and
+        // shadow views get by with their cull trees.
+        if( !fSettings.fViewStack.GetCount() )
+            fOccBufferValid = false;
+
         if( fView.fCullMaxNodes )
         {
-            int i;
-            for( i = 0; i < fCullPolys.GetCount(); i++ )
+            if( !fSettings.fViewStack.GetCount()
+                && ((fOcclusionMode == kOcclusionBuffer) || (fOcclusionMode == kOcclusionBoth)) )
             {
-                fView.fCullTree.AddPoly(*fCullPolys[i]);
-                if( fView.fCullTree.GetNumNodes() >= fView.fCullMaxNodes )
-                    break;
+                IRefreshOcclusionBuffer();
             }
-            fCullPolys.SetCount(0);
-            plProfile_Set(OccPolyUsed, i);
 
-            for( i = 0; i < fCullHoles.GetCount(); i++ )
+            int i = 0;
+            if( (fOcclusionMode == kOcclusionCullTree) || (fOcclusionMode == kOcclusionBoth) )
             {
-                fView.fCullTree.AddPoly(*fCullHoles[i]);
+                for( i = 0; i < fCullPolys.GetCount(); i++ )
+                {
+                    fView.fCullTree.AddPoly(*fCullPolys[i]);
+                    if( fView.fCullTree.GetNumNodes() >= fView.fCullMaxNodes )
+                        break;
+                }
+
+                int j;
+                for( j = 0; j < fCullHoles.GetCount(); j++ )
+                {
+                    fView.fCullTree.AddPoly(*fCullHoles[j]);
+                }
             }
+            fCullPolys.SetCount(0);
+            plProfile_Set(OccPolyUsed, i);
+
             fCullHoles.SetCount(0);
             plProfile_Set(OccNodeUsed, fView.fCullTree.GetNumNodes());
         }
@@ -9356,6 +9416,38 @@ void plDXPipeline::IRefreshCullTree()
     }
 }
 
+// IRefreshOcclusionBuffer /////////////////////////////////////////////////////////////
+// Rasterize this frame's occluders into the software occlusion buffer. See plOcclusionBuffer.h.
+// Unlike the cull tree, there's no cap on the number of occluders, the cost is linear in
+// the pixels they cover.
+void plDXPipeline::IRefreshOcclusionBuffer()
+{
+    fOccBuffer.Begin(GetViewTransform().GetWorldToNDC(), GetViewPositionWorld());
+
+    int i;
+    for( i = 0; i < fCullPolys.GetCount(); i++ )
+        fOccBuffer.AddOccluder(*fCullPolys[i]);
+    for( i = 0; i < fCullHoles.GetCount(); i++ )
+        fOccBuffer.AddHole(*fCullHoles[i]);
+
+    fOccBuffer.End();
+
+    fOccBufferValid = !fOccBuffer.IsEmpty();
+}
+
+// SetOcclusionMode ////////////////////////////////////////////////////////////////////
+// Choose between the cull tree and the occlusion buffer (or both, or neither) for the
+// occluder polys. Takes effect the next time the cull tree is built.
+void plDXPipeline::SetOcclusionMode(uint8_t mode)
+{
+    if( mode >= kNumOcclusionModes )
+        return;
+
+    fOcclusionMode = mode;
+    fOccBufferValid = false;
+    fView.fCullTreeDirty = true;
+}
+
 // IMakeOcclusionSnap /////////////////////////////////////////////////////////////////////
 // Debugging visualization tool only. Takes a snapshot of the current occlusion
 // BSP tree and renders it until told to stop.
@@ -10263,15 +10355,14 @@ bool      plDXPipeline::ISoftwareVertexBlend( plDrawableSpans* drawable, const h
 
                         uint8_t* ptr = vRef->fOwner->GetVertBufferData(vRef->fIndex);
                         ptr += span.fVStartIdx * vRef->fOwner->GetVertexSize();
-                        IBlendVertsIntoBuffer( (plSpan*)&span,
-                                                matrixPalette, span.fNumMatrices,
-                                                ptr, 
-                                                vRef->fOwner->GetVertexFormat(), 
-                                                vRef->fOwner->GetVertexSize(), 
-                                                destPtr + span.fVStartIdx * vRef->fVertexSize, 
-                                                vRef->fVertexSize, 
-                                                span.fVLength,
-                                                span.fLocalUVWChans );
+                        plSoftwareSkin::BlendVertsThreaded( matrixPalette, span.fNumMatrices,
+                                                             ptr, 
+                                                             vRef->fOwner->GetVertexFormat(), 
+                                                             vRef->fOwner->GetVertexSize(), 
+                                                             destPtr + span.fVStartIdx * vRef->fVertexSize, 
+                                                             vRef->fVertexSize, 
+                                                             span.fVLength,
+                                                             span.fLocalUVWChans );
                         vRef->SetDirty(true);
                     }
                 }
@@ -10544,288 +10635,6 @@ inline void inlTESTPOINT(const hsPoint3& destP,
         maxZ = destP.fZ;
 }
 
-//// IBlendVertsIntoBuffer ////////////////////////////////////////////////////
-//  Given a pointer into a buffer of verts that have blending data in the D3D
-//  format, blends them into the destination buffer given without the blending
-//  info.
-
-// FPU version
-#define MATRIXMULTBEGIN_FPU(xfm, wgt) \
-        float m00 = xfm.fMap[0][0]; \
-        float m01 = xfm.fMap[0][1]; \
-        float m02 = xfm.fMap[0][2]; \
-        float m03 = xfm.fMap[0][3]; \
-        float m10 = xfm.fMap[1][0]; \
-        float m11 = xfm.fMap[1][1]; \
-        float m12 = xfm.fMap[1][2]; \
-        float m13 = xfm.fMap[1][3]; \
-        float m20 = xfm.fMap[2][0]; \
-        float m21 = xfm.fMap[2][1]; \
-        float m22 = xfm.fMap[2][2]; \
-        float m23 = xfm.fMap[2][3]; \
-        float m_wgt = wgt; \
-        float srcX, srcY, srcZ;
-#define MATRIXMULTPOINTADD_FPU(dst, src) \
-        srcX = src.fX; \
-        srcY = src.fY; \
-        srcZ = src.fZ; \
-        \
-        dst.fX += (srcX * m00 + srcY * m01 + srcZ * m02 + m03) * m_wgt; \
-        dst.fY += (srcX * m10 + srcY * m11 + srcZ * m12 + m13) * m_wgt; \
-        dst.fZ += (srcX * m20 + srcY * m21 + srcZ * m22 + m23) * m_wgt;
-#define MATRIXMULTVECTORADD_FPU(dst, src) \
-        srcX = src.fX; \
-        srcY = src.fY; \
-        srcZ = src.fZ; \
-        \
-        dst.fX += (srcX * m00 + srcY * m01 + srcZ * m02) * m_wgt; \
-        dst.fY += (srcX * m10 + srcY * m11 + srcZ * m12) * m_wgt; \
-        dst.fZ += (srcX * m20 + srcY * m21 + srcZ * m22) * m_wgt;
-
-// SSE3 version
-#ifdef HS_SSE3
-#define MATRIXMULTBEGIN_SSE3(xfm, wgt) \
-        __m128 mc0, mc1, mc2, mwt, msr, _x, _y, _z, hbuf1, hbuf2; \
-        ALIGN(16) float hack[4]; \
-        mc0 = _mm_loadu_ps(xfm.fMap[0]); \
-        mc1 = _mm_loadu_ps(xfm.fMap[1]); \
-        mc2 = _mm_loadu_ps(xfm.fMap[2]); \
-        mwt = _mm_set_ps1(wgt);
-#define MATRIXMULTPOINTADD_SSE3(dst, src) \
-        msr = _mm_set_ps(1.f, src.fZ, src.fY, src.fX); \
-        _x  = _mm_mul_ps(_mm_mul_ps(mc0, msr), mwt); \
-        _y  = _mm_mul_ps(_mm_mul_ps(mc1, msr), mwt); \
-        _z  = _mm_mul_ps(_mm_mul_ps(mc2, msr), mwt); \
-        \
-        hbuf1 = _mm_hadd_ps(_x, _y); \
-        hbuf2 = _mm_hadd_ps(_z, _z); \
-        hbuf1 = _mm_hadd_ps(hbuf1, hbuf2); \
-        _mm_store_ps(hack, hbuf1); \
-        dst.fX += hack[0]; \
-        dst.fY += hack[1]; \
-        dst.fZ += hack[2];
-#define MATRIXMULTVECTORADD_SSE3(dst, src) \
-        msr = _mm_set_ps(0.f, src.fZ, src.fY, src.fX); \
-        _x  = _mm_mul_ps(_mm_mul_ps(mc0, msr), mwt); \
-        _y  = _mm_mul_ps(_mm_mul_ps(mc1, msr), mwt); \
-        _z  = _mm_mul_ps(_mm_mul_ps(mc2, msr), mwt); \
-        \
-        hbuf1 = _mm_hadd_ps(_x, _y); \
-        hbuf2 = _mm_hadd_ps(_z, _z); \
-        hbuf1 = _mm_hadd_ps(hbuf1, hbuf2); \
-        _mm_store_ps(hack, hbuf1); \
-        dst.fX += hack[0]; \
-        dst.fY += hack[1]; \
-        dst.fZ += hack[2];
-#endif
-
-// CPU-optimized functions requiring dispatch
-hsFunctionDispatcher<plDXPipeline::blend_vert_buffer_ptr> plDXPipeline::blend_vert_buffer(plDXPipeline::blend_vert_buffer_fpu, 0, 0, plDXPipeline::blend_vert_buffer_sse3);
-
-// Temporary macros for IBlendVertsIntoBuffer dispatch code de-duplication
-#define BLENDVERTSTART \
-    uint8_t     numUVs, numWeights; \
-    uint32_t    i, j, indices, color, specColor, uvChanSize; \
-    float       weights[ 4 ], weightSum; \
-    hsPoint3    pt, tempPt, destPt; \
-    hsVector3   vec, tempNorm, destNorm; \
-    \
-    /* Get some counts */\
-    switch( format & plGBufferGroup::kSkinWeightMask ) \
-    { \
-        case plGBufferGroup::kSkin1Weight:  numWeights = 1; break; \
-        case plGBufferGroup::kSkin2Weights: numWeights = 2; break; \
-        case plGBufferGroup::kSkin3Weights: numWeights = 3; break; \
-        default: hsAssert( false, "Invalid weight count in IBlendVertsIntoBuffer()" ); \
-    } \
-    \
-    numUVs = plGBufferGroup::CalcNumUVs( format ); \
-    uvChanSize = numUVs * sizeof( float ) * 3; \
-    \
-    /* localUVWChans is bump mapping tangent space vectors, which need to
-    // be skinned like the normal, as opposed to passed through like 
-    // garden variety UVW coordinates.
-    // There are no localUVWChans that I know of in production assets (i.e.
-    // the avatar is not skinned).*/\
-    if( !localUVWChans ) \
-    { \
-        /* Copy whilst blending */\
-        for( i = 0; i < count; i++ ) \
-        { \
-            /* Extract data */\
-            src = inlExtractPoint( src, pt ); \
-            for( j = 0, weightSum = 0; j < numWeights; j++ ) \
-            { \
-                src = inlExtractFloat( src, weights[ j ] ); \
-                weightSum += weights[ j ]; \
-            } \
-            weights[ j ] = 1 - weightSum; \
-            \
-            if( format & plGBufferGroup::kSkinIndices ) \
-            { \
-                src = inlExtractUInt32( src, indices ); \
-            } \
-            else \
-            { \
-                indices = 1 << 8; \
-            } \
-            src = inlExtractPoint( src, vec ); \
-            src = inlExtractUInt32( src, color ); \
-            src = inlExtractUInt32( src, specColor ); \
-            \
-            /* Blend */\
-            destPt.Set( 0, 0, 0 ); \
-            destNorm.Set( 0, 0, 0 ); \
-            for( j = 0; j < numWeights + 1; j++ ) \
-            { \
-                if( weights[ j ] ) \
-                {
-                    /*
-                    MATRIXMULTBEGIN(matrixPalette[indices & 0xff], weights[j]);
-
-                    MATRIXMULTPOINTADD(destPt, pt);
-                    MATRIXMULTVECTORADD(destNorm, vec);
-                    */
-#define BLENDVERTMID \
-                } \
-                \
-                indices >>= 8; \
-            } \
-            /* Probably don't really need to renormalize this. There errors are
-            // going to be subtle and "smooth".*/\
-            /* hsFastMath::NormalizeAppr(destNorm);*/ \
-            \
-            /* Slam data into position now */\
-            dest = inlStuffPoint( dest, destPt ); \
-            dest = inlStuffPoint( dest, destNorm ); \
-            dest = inlStuffUInt32( dest, color ); \
-            dest = inlStuffUInt32( dest, specColor ); \
-            memcpy( dest, src, uvChanSize ); \
-            src += uvChanSize; \
-            dest += uvChanSize; \
-        } \
-    } \
-    else \
-    { \
-        uint8_t hiChan = localUVWChans >> 8; \
-        uint8_t loChan = localUVWChans & 0xff; \
-        /* Copy whilst blending */\
-        for( i = 0; i < count; i++ ) \
-        { \
-            hsVector3 srcUVWs[plGeometrySpan::kMaxNumUVChannels]; \
-            hsVector3 dstUVWs[plGeometrySpan::kMaxNumUVChannels]; \
-            \
-            /* Extract data */\
-            src = inlExtractPoint( src, pt ); \
-            for( j = 0, weightSum = 0; j < numWeights; j++ ) \
-            { \
-                src = inlExtractFloat( src, weights[ j ] ); \
-                weightSum += weights[ j ]; \
-            } \
-            weights[ j ] = 1 - weightSum; \
-            \
-            if( format & plGBufferGroup::kSkinIndices ) \
-            { \
-                src = inlExtractUInt32( src, indices ); \
-            } \
-            else \
-            { \
-                indices = 1 << 8; \
-            } \
-            \
-            src = inlExtractPoint( src, vec ); \
-            src = inlExtractUInt32( src, color ); \
-            src = inlExtractUInt32( src, specColor ); \
-            \
-            uint8_t k; \
-            for( k = 0; k < numUVs; k++ ) \
-            { \
-                src = inlExtractPoint( src, srcUVWs[k] ); \
-            } \
-            memcpy( dstUVWs, srcUVWs, uvChanSize); \
-            dstUVWs[loChan].Set(0,0,0); \
-            dstUVWs[hiChan].Set(0,0,0); \
-            \
-            /* Blend */\
-            destPt.Set( 0, 0, 0 ); \
-            destNorm.Set( 0, 0, 0 ); \
-            for( j = 0; j < numWeights + 1; j++ ) \
-            { \
-                if( weights[ j ] ) \
-                { \
-                    /*
-                    MATRIXMULTBEGIN(matrixPalette[indices & 0xff], weights[j]);
-
-                    MATRIXMULTPOINTADD(destPt, pt);
-                    MATRIXMULTVECTORADD(destNorm, vec);
-                    MATRIXMULTVECTORADD(dstUVWs[loChan], srcUVWs[loChan]);
-                    MATRIXMULTVECTORADD(dstUVWs[hiChan], srcUVWs[hiChan]);
-                    */
-#define BLENDVERTEND \
-                } \
-                \
-                indices >>= 8; \
-            } \
-            /* Probably don't really need to renormalize this. There errors are
-            // going to be subtle and "smooth". */\
-            /* hsFastMath::NormalizeAppr(destNorm); */\
-            /* hsFastMath::NormalizeAppr(dstUVWs[loChan]); */\
-            /* hsFastMath::NormalizeAppr(dstUVWs[hiChan]); */\
-            \
-            /* Slam data into position now */\
-            dest = inlStuffPoint( dest, destPt ); \
-            dest = inlStuffPoint( dest, destNorm ); \
-            dest = inlStuffUInt32( dest, color ); \
-            dest = inlStuffUInt32( dest, specColor ); \
-            memcpy( dest, dstUVWs, uvChanSize ); \
-            dest += uvChanSize; \
-        } \
-    }
-
-void plDXPipeline::blend_vert_buffer_fpu( plSpan* span,
-                                          hsMatrix44* matrixPalette, int numMatrices,
-                                          const uint8_t *src, uint8_t format, uint32_t srcStride,
-                                          uint8_t *dest, uint32_t destStride, uint32_t count,
-                                          uint16_t localUVWChans )
-{
-    BLENDVERTSTART
-                    MATRIXMULTBEGIN_FPU(matrixPalette[indices & 0xff], weights[j]);
-
-                    MATRIXMULTPOINTADD_FPU(destPt, pt);
-                    MATRIXMULTVECTORADD_FPU(destNorm, vec);
-    BLENDVERTMID
-                    MATRIXMULTBEGIN_FPU(matrixPalette[indices & 0xff], weights[j]);
-
-                    MATRIXMULTPOINTADD_FPU(destPt, pt);
-                    MATRIXMULTVECTORADD_FPU(destNorm, vec);
-                    MATRIXMULTVECTORADD_FPU(dstUVWs[loChan], srcUVWs[loChan]);
-                    MATRIXMULTVECTORADD_FPU(dstUVWs[hiChan], srcUVWs[hiChan]);
-
-    BLENDVERTEND
-}
-
-void plDXPipeline::blend_vert_buffer_sse3( plSpan* span,
-                                           hsMatrix44* matrixPalette, int numMatrices,
-                                           const uint8_t *src, uint8_t format, uint32_t srcStride,
-                                           uint8_t *dest, uint32_t destStride, uint32_t count,
-                                           uint16_t localUVWChans )
-{
-#ifdef HS_SSE3
-    BLENDVERTSTART
-                    MATRIXMULTBEGIN_SSE3(matrixPalette[indices & 0xff], weights[j]);
-
-                    MATRIXMULTPOINTADD_SSE3(destPt, pt);
-                    MATRIXMULTVECTORADD_SSE3(destNorm, vec);
-    BLENDVERTMID
-                    MATRIXMULTBEGIN_SSE3(matrixPalette[indices & 0xff], weights[j]);
-
-                    MATRIXMULTPOINTADD_SSE3(destPt, pt);
-                    MATRIXMULTVECTORADD_SSE3(destNorm, vec);
-                    MATRIXMULTVECTORADD_SSE3(dstUVWs[loChan], srcUVWs[loChan]);
-                    MATRIXMULTVECTORADD_SSE3(dstUVWs[hiChan], srcUVWs[hiChan]);
-    BLENDVERTEND
-#endif // HS_SSE3
-}
 
 // ISetPipeConsts //////////////////////////////////////////////////////////////////
 // A shader can request that the pipeline fill in certain constants that are indeterminate
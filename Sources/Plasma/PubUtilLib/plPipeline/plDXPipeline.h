@@ -44,6 +44,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include "plPipeline.h"
 #include "plDXSettings.h"
+#include "plNullPipeline/plOcclusionBuffer.h"
 
 #include "plSurface/plLayerInterface.h"
 #include "hsMatrix44.h"
@@ -239,6 +240,10 @@ protected:
     hsTArray<const plCullPoly*> fCullPolys;
     hsTArray<const plCullPoly*> fCullHoles;
     plDrawableSpans*            fCullProxy;
+
+    uint8_t                     fOcclusionMode;
+    plOcclusionBuffer           fOccBuffer;
+    bool                        fOccBufferValid;    // Built for the main view this frame
     
     plDXVertexBufferRef*    fVtxBuffRefList;
     plDXIndexBufferRef*     fIdxBuffRefList;
@@ -462,11 +467,6 @@ protected:
     void            IMakeOcclusionSnap();
 
     bool            IAvatarSort(plDrawableSpans* d, const hsTArray<int16_t>& visList);
-    void            IBlendVertsIntoBuffer( plSpan* span, 
-                                            hsMatrix44* matrixPalette, int numMatrices,
-                                            const uint8_t *src, uint8_t format, uint32_t srcStride, 
-                                            uint8_t *dest, uint32_t destStride, uint32_t count, uint16_t localUVWChans )
-                                                { blend_vert_buffer.call(span, matrixPalette, numMatrices, src, format, srcStride, dest, destStride, count, localUVWChans); };
     bool            ISoftwareVertexBlend( plDrawableSpans* drawable, const hsTArray<int16_t>& visList );
 
 
@@ -521,6 +521,9 @@ protected:
     void        ISetViewport();
     void        IUpdateViewVectors() const;
     void        IRefreshCullTree();
+    void        IRefreshOcclusionBuffer();
+    bool        IOcclusionBufferActive() const { return fOccBufferValid && !fSettings.fViewStack.GetCount(); }
+    void        IHarvestVisible(plSpaceTree* space, hsTArray<int16_t>& visList);
     void        ISetAnisotropy(bool on);
 
     // Transforms
@@ -676,6 +679,8 @@ public:
     // These are also only for debugging.
     virtual void                        SetMaxCullNodes(uint16_t n) { fView.fCullMaxNodes = n; }
     virtual uint16_t                      GetMaxCullNodes() const { return fView.fCullMaxNodes; }
+    virtual void                        SetOcclusionMode(uint8_t mode);
+    virtual uint8_t                     GetOcclusionMode() const { return fOcclusionMode; }
 
     virtual bool                        CheckResources();
     virtual void                        LoadResources();    // Tells us where it's a good time to load in unmanaged resources.
@@ -798,14 +803,6 @@ public:
     virtual void                        GetSupportedDisplayModes(std::vector<plDisplayMode> *res, int ColorDepth = 32 );
     virtual int                         GetMaxAnisotropicSamples();
     virtual int                         GetMaxAntiAlias(int Width, int Height, int ColorDepth);
-
-
-    //  CPU-optimized functions
-protected:
-    typedef void(*blend_vert_buffer_ptr)(plSpan*, hsMatrix44*, int, const uint8_t *, uint8_t , uint32_t, uint8_t *, uint32_t, uint32_t, uint16_t);
-    static void blend_vert_buffer_fpu(plSpan*, hsMatrix44*, int, const uint8_t *, uint8_t , uint32_t, uint8_t *, uint32_t, uint32_t, uint16_t);
-    static void blend_vert_buffer_sse3(plSpan*, hsMatrix44*, int, const uint8_t *, uint8_t , uint32_t, uint8_t *, uint32_t, uint32_t, uint16_t);
-    static hsFunctionDispatcher<blend_vert_buffer_ptr> blend_vert_buffer;
 };
 
 
@@ -64,11 +64,15 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 
 // A bit of a hack so that we will have the correct instance in the SceneViewer
+#if HS_BUILD_FOR_WIN32
 static HINSTANCE gHInstance = GetModuleHandle(nil);
+#endif
 
 void SetHInstance(void *instance)
 {
+#if HS_BUILD_FOR_WIN32
     gHInstance = (HINSTANCE)instance;
+#endif
 }
 
 //////////////////////////////////////////////////////////////////////////////
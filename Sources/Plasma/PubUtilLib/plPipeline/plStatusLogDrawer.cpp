@@ -117,8 +117,8 @@ void    plStatusLogDrawer::Draw(plStatusLog* curLog, plStatusLog* firstLog)
     y += lineHt * 2;
     for( i = 0; i < IGetMaxNumLines( curLog ); i++ )
     {
-        if( IGetLines( curLog )[ i ] != nil )
-            drawText.DrawString( x + 4, y, IGetLines( curLog )[ i ], IGetColors( curLog )[ i ] );
+        if( IGetLine( curLog, i ) != nil )
+            drawText.DrawString( x + 4, y, IGetLine( curLog, i ), IGetColor( curLog, i ) );
         y += lineHt;
     }
 
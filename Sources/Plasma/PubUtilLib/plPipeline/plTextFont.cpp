@@ -75,6 +75,7 @@ plTextFont::~plTextFont()
 
 uint16_t  *plTextFont::IInitFontTexture( void )
 {
+#if HS_BUILD_FOR_WIN32
     int     nHeight, x, y, c;
     char    myChar[ 2 ] = "x";
     uint16_t  *tBits;
@@ -189,6 +190,11 @@ uint16_t  *plTextFont::IInitFontTexture( void )
     DeleteObject( hFont );
 
     return data;
+#else
+    // No GDI to draw the characters with. Only the device pipelines make
+    // text fonts, and those are all Windows.
+    return nil;
+#endif
 }
 
 //// Create ///////////////////////////////////////////////////////////////////
@@ -47,6 +47,10 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #include <math.h>
 #include "plGBufferGroup.h"
 
+#ifdef HS_SIMD_INCLUDE
+#  include HS_SIMD_INCLUDE
+#endif
+
 const float kPosQuantum = 1.f / float(1 << 10);
 const float kWeightQuantum = 1.f / float(1 << 15);
 const float kUVWQuantum = 1.f / float(1 << 16);
@@ -56,6 +60,10 @@ uint32_t  plVertCoder::fCodedBytes = 0;
 uint32_t  plVertCoder::fRawBytes = 0;
 uint32_t  plVertCoder::fSkippedBytes = 0;
 
+bool    plVertCoder::fBlockDecode = true;
+
+hsFunctionDispatcher<plVertCoder::dequant_floats_ptr> plVertCoder::dequant_floats(plVertCoder::dequant_floats_fpu, 0, plVertCoder::dequant_floats_sse2);
+
 static const float kQuanta[plVertCoder::kNumFloatFields] =
 {
     kPosQuantum,
@@ -419,7 +427,379 @@ inline void plVertCoder::IDecode(hsStream* s, uint8_t*& dst, const uint32_t stri
     }
 }
 
+///////////////////////////////////////////////////////////////////////////////////////////
+// Block decoding
+///////////////////////////////////////////////////////////////////////////////////////////
+
+// The quanta are all powers of two, so the multiply is exact and the add is the
+// only rounding, same as in IReadFloat.
+void plVertCoder::dequant_floats_fpu(const uint16_t* src, int num, float quantum, float offset, float* dst)
+{
+    int i;
+    for( i = 0; i < num; i++ )
+    {
+        float fval = float(src[i]) * quantum;
+        fval += offset;
+        dst[i] = fval;
+    }
+}
+
+void plVertCoder::dequant_floats_sse2(const uint16_t* src, int num, float quantum, float offset, float* dst)
+{
+#ifdef HS_SSE2
+    const __m128 q = _mm_set1_ps(quantum);
+    const __m128 o = _mm_set1_ps(offset);
+    const __m128i zero = _mm_setzero_si128();
+
+    int i;
+    for( i = 0; i + 8 <= num; i += 8 )
+    {
+        __m128i w = _mm_loadu_si128((const __m128i*)(src + i));
+        __m128 lo = _mm_cvtepi32_ps(_mm_unpacklo_epi16(w, zero));
+        __m128 hi = _mm_cvtepi32_ps(_mm_unpackhi_epi16(w, zero));
+        _mm_storeu_ps(dst + i, _mm_add_ps(_mm_mul_ps(lo, q), o));
+        _mm_storeu_ps(dst + i + 4, _mm_add_ps(_mm_mul_ps(hi, q), o));
+    }
+    dequant_floats_fpu(src + i, num - i, quantum, offset, dst + i);
+#endif // HS_SSE2
+}
+
+// Only 256 normal components can come out of IDecodeNormal, so look them up.
+class plVertCodeNormalTable
+{
+public:
+    float   fVal[256];
+
+    plVertCodeNormalTable()
+    {
+        int i;
+        for( i = 0; i < 256; i++ )
+        {
+            uint8_t ix = uint8_t(i);
+            fVal[i] = (ix / 255.9f - .5f) * 2.f;
+        }
+    }
+};
+static const plVertCodeNormalTable kNormalTable;
+
+// Parses straight out of the stream's read window, once we know the whole
+// block fits in it.
+class plVertCodeMemReader
+{
+public:
+    const uint8_t*  fCur;
+
+    plVertCodeMemReader(const void* p) : fCur((const uint8_t*)p) { }
+
+    uint8_t     ReadByte() { return *fCur++; }
+    bool        ReadBool() { return *fCur++ != 0; }
+    uint16_t    ReadLE16() { uint16_t v; memcpy(&v, fCur, 2); fCur += 2; return hsToLE16(v); }
+    uint32_t    ReadLE32() { uint32_t v; memcpy(&v, fCur, 4); fCur += 4; return hsToLE32(v); }
+    float       ReadLEScalar() { float v; memcpy(&v, fCur, 4); fCur += 4; return hsToLEFloat(v); }
+};
+
+// Anything else goes through the stream's inline reads.
+class plVertCodeStreamReader
+{
+public:
+    hsStream*   fStream;
+
+    plVertCodeStreamReader(hsStream* s) : fStream(s) { }
+
+    uint8_t     ReadByte() { uint8_t v; fStream->ReadLE(&v); return v; }
+    bool        ReadBool() { return fStream->ReadBool(); }
+    uint16_t    ReadLE16() { return fStream->ReadLE16(); }
+    uint32_t    ReadLE32() { return fStream->ReadLE32(); }
+    float       ReadLEScalar() { return fStream->ReadLEScalar(); }
+};
+
+template <class Reader>
+inline void plVertCoder::IParseFloat(Reader& r, const int field, const int chan, const int iChan, const uint32_t iVert)
+{
+    FloatCode& code = fFloats[field][chan];
+    if( !code.fCount )
+    {
+        code.fOffset = r.ReadLEScalar();
+        code.fAllSame = r.ReadBool();
+        code.fCount = r.ReadLE16();
+
+        IStartRun(iChan, iVert);
+    }
+
+    if( !code.fAllSame )
+        fQuant[iChan * kBlockVerts + iVert] = r.ReadLE16();
+
+    code.fCount--;
+}
+
+inline void plVertCoder::IStartRun(const int iChan, const uint32_t iVert)
+{
+    const FloatCode& code = fFloats[fChanField[iChan]][fChanIdx[iChan]];
+    FloatRun run;
+    run.fStart = iVert;
+    run.fOffset = code.fOffset;
+    run.fAllSame = code.fAllSame;
+    fRuns[iChan].push_back(run);
+}
+
+template <class Reader>
+inline void plVertCoder::IParseByte(Reader& r, const int chan, uint8_t* dst)
+{
+    byteCode& code = fColors[chan];
+    if( !code.fCount )
+    {
+        uint16_t cnt = r.ReadLE16();
+        if( cnt & kSameMask )
+        {
+            code.fSame = true;
+            code.fVal = r.ReadByte();
+
+            cnt &= ~kSameMask;
+        }
+        else
+        {
+            code.fSame = false;
+        }
+        code.fCount = cnt;
+    }
+    *dst = code.fSame ? code.fVal : r.ReadByte();
+
+    code.fCount--;
+}
+
+// Runs carry across blocks, so any channel in the middle of one gets it
+// restarted at the top of the block.
+void plVertCoder::IBeginBlock()
+{
+    int i;
+    for( i = 0; i < fNumChans; i++ )
+    {
+        fRuns[i].clear();
+        if( fFloats[fChanField[i]][fChanIdx[i]].fCount )
+            IStartRun(i, 0);
+    }
+}
+
+// Walks the coded vertices for block slots first through first+numVerts-1 exactly
+// as IDecode does, but only sorts the raw values into per channel arrays. Float
+// channels are numbered in stream order: position, then weights, then uvws.
+template <class Reader>
+void plVertCoder::IParseBlock(Reader& r, const uint32_t first, const uint32_t numVerts)
+{
+    uint8_t* normals = fBytes.data();
+    uint8_t* colors = normals + 3 * kBlockVerts;
+
+    uint32_t iVert;
+    for( iVert = first; iVert < first + numVerts; iVert++ )
+    {
+        IParseFloat(r, kPosition, 0, 0, iVert);
+        IParseFloat(r, kPosition, 1, 1, iVert);
+        IParseFloat(r, kPosition, 2, 2, iVert);
+
+        int iChan = 3;
+        int j;
+        for( j = 0; j < fNumWeights; j++ )
+            IParseFloat(r, kWeight, j, iChan++, iVert);
+
+        if( fHasIndices )
+            fSkinIdx[iVert] = r.ReadLE32();
+
+        normals[iVert] = r.ReadByte();
+        normals[kBlockVerts + iVert] = r.ReadByte();
+        normals[2 * kBlockVerts + iVert] = r.ReadByte();
+
+        IParseByte(r, 0, colors + iVert);
+        IParseByte(r, 1, colors + kBlockVerts + iVert);
+        IParseByte(r, 2, colors + 2 * kBlockVerts + iVert);
+        IParseByte(r, 3, colors + 3 * kBlockVerts + iVert);
+
+        for( j = 0; j < fNumUVWs; j++ )
+        {
+            IParseFloat(r, kUVW + j, 0, iChan++, iVert);
+            IParseFloat(r, kUVW + j, 1, iChan++, iVert);
+            IParseFloat(r, kUVW + j, 2, iChan++, iVert);
+        }
+    }
+}
+
+// Dequantizes every float channel of the block a run at a time, then writes the
+// vertices out in the same layout IDecode produces.
+void plVertCoder::IInterleave(uint8_t* dst, const uint32_t numVerts)
+{
+    int iChan;
+    for( iChan = 0; iChan < fNumChans; iChan++ )
+    {
+        const float quantum = kQuanta[fChanField[iChan]];
+        const uint16_t* src = fQuant.data() + iChan * kBlockVerts;
+        float* chan = fChannel.data() + iChan * kBlockVerts;
+
+        const std::vector<FloatRun>& runs = fRuns[iChan];
+        int iRun;
+        for( iRun = 0; iRun < runs.size(); iRun++ )
+        {
+            const uint32_t start = runs[iRun].fStart;
+            const uint32_t end = iRun + 1 < runs.size() ? runs[iRun+1].fStart : numVerts;
+            if( runs[iRun].fAllSame )
+            {
+                uint32_t k;
+                for( k = start; k < end; k++ )
+                    chan[k] = runs[iRun].fOffset;
+            }
+            else
+            {
+                dequant_floats.call(src + start, end - start, quantum, runs[iRun].fOffset, chan + start);
+            }
+        }
+    }
+
+    const float* floats = fChannel.data();
+    const uint8_t* normals = fBytes.data();
+    const uint8_t* colors = normals + 3 * kBlockVerts;
+
+    uint32_t iVert;
+    for( iVert = 0; iVert < numVerts; iVert++ )
+    {
+        float* fDst = (float*)dst;
+        fDst[0] = floats[iVert];
+        fDst[1] = floats[kBlockVerts + iVert];
+        fDst[2] = floats[2 * kBlockVerts + iVert];
+        fDst += 3;
+
+        iChan = 3;
+        int j;
+        for( j = 0; j < fNumWeights; j++ )
+            *fDst++ = floats[iChan++ * kBlockVerts + iVert];
+
+        if( fHasIndices )
+            *((uint32_t*)fDst++) = fSkinIdx[iVert];
+
+        fDst[0] = kNormalTable.fVal[normals[iVert]];
+        fDst[1] = kNormalTable.fVal[normals[kBlockVerts + iVert]];
+        fDst[2] = kNormalTable.fVal[normals[2 * kBlockVerts + iVert]];
+        fDst += 3;
+
+        uint8_t* bDst = (uint8_t*)fDst;
+        bDst[0] = colors[iVert];
+        bDst[1] = colors[kBlockVerts + iVert];
+        bDst[2] = colors[2 * kBlockVerts + iVert];
+        bDst[3] = colors[3 * kBlockVerts + iVert];
+        fDst++;
+
+        // COLOR2
+        *((uint32_t*)fDst++) = 0;
+
+        for( j = fNumUVWs * 3; j > 0; j-- )
+            *fDst++ = floats[iChan++ * kBlockVerts + iVert];
+
+        dst = (uint8_t*)fDst;
+    }
+}
+
+void plVertCoder::ISetupBlocks(const uint8_t format)
+{
+    fNumWeights = INumWeights(format);
+    fHasIndices = fNumWeights && (format & plGBufferGroup::kSkinIndices);
+    fNumUVWs = format & plGBufferGroup::kUVCountMask;
+    fNumChans = 3 + fNumWeights + fNumUVWs * 3;
+
+    int iChan = 0;
+    int i;
+    for( i = 0; i < 3; i++, iChan++ )
+    {
+        fChanField[iChan] = kPosition;
+        fChanIdx[iChan] = i;
+    }
+    for( i = 0; i < fNumWeights; i++, iChan++ )
+    {
+        fChanField[iChan] = kWeight;
+        fChanIdx[iChan] = i;
+    }
+    for( i = 0; i < fNumUVWs * 3; i++, iChan++ )
+    {
+        fChanField[iChan] = kUVW + i / 3;
+        fChanIdx[iChan] = i % 3;
+    }
+
+    if( fQuant.size() < fNumChans * kBlockVerts )
+    {
+        fQuant.resize(fNumChans * kBlockVerts);
+        fChannel.resize(fNumChans * kBlockVerts);
+    }
+    if( fRuns.size() < fNumChans )
+        fRuns.resize(fNumChans);
+    fBytes.resize(7 * kBlockVerts);
+    fSkinIdx.resize(kBlockVerts);
+}
+
+// Worst case, every float value comes with its own run header and every byte
+// channel with a count.
+uint32_t plVertCoder::IMaxCodedSize(const uint8_t format, const uint32_t numVerts)
+{
+    const int numWeights = INumWeights(format);
+    const int numChans = 3 + numWeights + (format & plGBufferGroup::kUVCountMask) * 3;
+    uint32_t vertSize = numChans * (4 + 1 + 2 + 2) + 3 + 4 * (2 + 1 + 1);
+    if( numWeights && (format & plGBufferGroup::kSkinIndices) )
+        vertSize += 4;
+
+    return vertSize * numVerts;
+}
+
 void plVertCoder::Read(hsStream* s, uint8_t* dst, const uint8_t format, const uint32_t stride, const uint16_t numVerts)
+{
+    // A stream that never holds its data in memory has nothing to gain from the
+    // block parse, since every value is a virtual read either way.
+    const void* window;
+    if( !fBlockDecode || !s->GetReadWindow(&window) )
+    {
+        ReadPerVertex(s, dst, format, stride, numVerts);
+        return;
+    }
+
+    Clear();
+    ISetupBlocks(format);
+
+    const uint32_t vertSize = (3 + fNumWeights + (fHasIndices ? 1 : 0) + 3 + 2 + fNumUVWs * 3) * sizeof(float);
+
+    const uint32_t maxCodedVert = IMaxCodedSize(format, 1);
+
+    uint32_t done = 0;
+    while( done < numVerts )
+    {
+        const uint32_t cnt = hsMinimum(uint32_t(kBlockVerts), numVerts - done);
+
+        IBeginBlock();
+
+        // Parse whatever is guaranteed to fit in the stream's read window straight
+        // out of memory. When it can't hold even one more vertex, a single vertex
+        // through the stream gets it to refill.
+        uint32_t iVert = 0;
+        while( iVert < cnt )
+        {
+            const uint32_t fit = s->GetReadWindow(&window) / maxCodedVert;
+            if( fit )
+            {
+                const uint32_t n = hsMinimum(fit, cnt - iVert);
+                plVertCodeMemReader r(window);
+                IParseBlock(r, iVert, n);
+                s->Skip(uint32_t(r.fCur - (const uint8_t*)window));
+                iVert += n;
+            }
+            else
+            {
+                plVertCodeStreamReader r(s);
+                IParseBlock(r, iVert, 1);
+                iVert++;
+            }
+        }
+
+        IInterleave(dst, cnt);
+
+        dst += cnt * vertSize;
+        done += cnt;
+    }
+}
+
+void plVertCoder::ReadPerVertex(hsStream* s, uint8_t* dst, const uint8_t format, const uint32_t stride, const uint16_t numVerts)
 {
     Clear();
 
@@ -458,6 +838,7 @@ plVertCoder::~plVertCoder()
 
 void plVertCoder::Clear()
 {
-    memset(this, 0, sizeof(*this));
+    memset(fFloats, 0, sizeof(fFloats));
+    memset(fColors, 0, sizeof(fColors));
 }
 
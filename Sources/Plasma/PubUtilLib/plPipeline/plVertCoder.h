@@ -43,6 +43,10 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #ifndef plVertCoder_inc
 #define plVertCoder_inc
 
+#include "hsCpuID.h"
+
+#include <vector>
+
 class hsStream;
 
 class plVertCoder
@@ -82,6 +86,46 @@ protected:
     static uint32_t   fRawBytes;
     static uint32_t   fSkippedBytes;
 
+    static bool     fBlockDecode;
+
+    // Block decoding scratch. The coded stream interleaves every channel of a vertex,
+    // so IParseBlock walks kBlockVerts vertices at a time, sorting the raw values into
+    // one array per channel. IInterleave then dequantizes each channel a run at a time
+    // and writes the block's vertices out.
+    enum { kBlockVerts = 256 };
+    class FloatRun
+    {
+    public:
+        uint32_t    fStart;
+        float       fOffset;
+        bool        fAllSame;
+    };
+    int                                 fNumWeights;
+    bool                                fHasIndices;
+    int                                 fNumUVWs;
+    int                                 fNumChans;
+    uint8_t                             fChanField[kNumFloatFields * 3];
+    uint8_t                             fChanIdx[kNumFloatFields * 3];
+    std::vector<uint16_t>               fQuant;     // Quantized floats, kBlockVerts per channel
+    std::vector<std::vector<FloatRun> > fRuns;      // Runs for each float channel
+    std::vector<uint8_t>                fBytes;     // Normal xyz then color bytes, kBlockVerts per channel
+    std::vector<uint32_t>               fSkinIdx;
+    std::vector<float>                  fChannel;   // Dequantized floats, kBlockVerts per channel
+
+    void ISetupBlocks(const uint8_t format);
+    inline void IStartRun(const int iChan, const uint32_t iVert);
+    template <class Reader> inline void IParseFloat(Reader& r, const int field, const int chan, const int iChan, const uint32_t iVert);
+    template <class Reader> inline void IParseByte(Reader& r, const int chan, uint8_t* dst);
+    void IBeginBlock();
+    template <class Reader> void IParseBlock(Reader& r, const uint32_t first, const uint32_t numVerts);
+    void IInterleave(uint8_t* dst, const uint32_t numVerts);
+    static uint32_t IMaxCodedSize(const uint8_t format, const uint32_t numVerts);
+
+    typedef void(*dequant_floats_ptr)(const uint16_t* src, int num, float quantum, float offset, float* dst);
+    static void dequant_floats_fpu(const uint16_t* src, int num, float quantum, float offset, float* dst);
+    static void dequant_floats_sse2(const uint16_t* src, int num, float quantum, float offset, float* dst);
+    static hsFunctionDispatcher<dequant_floats_ptr> dequant_floats;
+
     inline void ICountFloats(const uint8_t* src, uint16_t maxCnt, const float quant, const uint32_t stride, float& lo, bool& allSame, uint16_t& count);
     inline void IEncodeFloat(hsStream* s, const uint32_t vertsLeft, const int field, const int chan, const uint8_t*& src, const uint32_t stride);
     inline void IDecodeFloat(hsStream* s, const int field, const int chan, uint8_t*& dst, const uint32_t stride);
@@ -105,6 +149,7 @@ public:
     void Clear();
 
     void Read(hsStream* s, uint8_t* dst, const uint8_t format, const uint32_t stride, const uint16_t numVerts);
+    void ReadPerVertex(hsStream* s, uint8_t* dst, const uint8_t format, const uint32_t stride, const uint16_t numVerts);
     void Write(hsStream* s, const uint8_t* src, const uint8_t format, const uint32_t stride, const uint16_t numVerts);
 
 
@@ -117,6 +162,11 @@ public:
 
     static uint32_t SkippedBytes() { return fSkippedBytes; }
     static void AddSkippedBytes(uint32_t f) { fSkippedBytes += f; }
+
+    // Read decodes a channel at a time unless this is off, in which case it goes
+    // a vertex at a time straight off the stream. The output is identical.
+    static void SetBlockDecode(bool on) { fBlockDecode = on; }
+    static bool GetBlockDecode() { return fBlockDecode; }
 };
 
 #endif // plVertCoder_inc
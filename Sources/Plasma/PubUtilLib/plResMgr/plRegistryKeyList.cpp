@@ -81,12 +81,14 @@ plKeyImp* plRegistryKeyList::FindKey(const plString& keyName)
     // Search the static key list
     if (fFlags & kStaticUnsorted)
     {
-        // We're unsorted, brute force it.  May do a separate search table in the
-        // future if this is a bottlneck
+        // We're unsorted, brute force it.  Names are interned with a
+        // case-insensitive hash, so only matching hashes need a string compare.
+        uint32_t hash = plKeyNameTable::HashName(keyName);
         for (int i = 0; i < fStaticKeys.size(); i++)
         {
             plKeyImp* curKey = fStaticKeys[i];
-            if (curKey && !keyName.Compare(curKey->GetName(), plString::kCaseInsensitive))
+            if (curKey && curKey->GetUoid().GetObjectNameHash() == hash
+                && !keyName.Compare(curKey->GetName(), plString::kCaseInsensitive))
                 return curKey;
         }
     }
@@ -124,6 +126,8 @@ plKeyImp* plRegistryKeyList::FindKey(const plUoid& uoid)
         // because of local data. Verify that we have the right key by
         // name, and if it's wrong, do the slower find-by-name.
         plKeyImp *keyImp = fStaticKeys[objectID-1];
+        if (&keyImp->GetUoid().GetObjectName() == &uoid.GetObjectName())
+            return keyImp;  // same interned name entry
         if (keyImp->GetName().Compare(uoid.GetObjectName(), plString::kCaseInsensitive) != 0)
             return FindKey(uoid.GetObjectName());
         else
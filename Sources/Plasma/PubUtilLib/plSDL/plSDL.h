@@ -73,6 +73,7 @@ namespace plSDL
         kSameAsDefault  = 0x8,
         kHasDirtyFlag   = 0x10,
         kWantTimeStamp  = 0x20,
+        kHasDelta       = 0x40,     // var values are relative to the delta chain's values, see plSDLDeltaChain
 
         kAddedVarLengthIO = 0x8000,     // using to establish a new version in the header, can delete in 8/03
         
@@ -92,6 +93,7 @@ namespace plSDL
         kMakeDirty              = 1<< 8,            // read/write: set dirty flag on var read/write. 
         kDirtyNonDefaults       = 1<< 9,            // dirty the var if non default value.
         kForceConvert           = 1<<10,            // always try to convert rec to latest on read
+        kDeltaEncode            = 1<<11,            // send option. encode vars against the last values sent for the object. Readers tell from the record's io version
     };
 
     enum BehaviorFlags
@@ -102,6 +104,10 @@ namespace plSDL
     extern const plString kAgeSDLObjectName;
     void VariableLengthRead(hsStream* s, int size, int* val);
     void VariableLengthWrite(hsStream* s, int size, int val);
+
+    // 7 bits at a time, low bits first. used by delta encoded records
+    uint64_t VarUIntRead(hsStream* s);
+    void VarUIntWrite(hsStream* s, uint64_t val);
 };
 
 class plStateVarNotificationInfo
@@ -212,6 +218,8 @@ class plKey;
 class plClientUnifiedTime;
 class plSimpleStateVariable : public plStateVariable
 {
+    friend class plStateDescriptor;
+    friend class plStateDataRecord;
 protected:
     union
     {
@@ -232,8 +240,17 @@ protected:
     typedef std::vector<plStateChangeNotifier> StateChangeNotifiers;
     StateChangeNotifiers fChangeNotifiers;
 
+    // storage in the owning record's value block, see plSDLLayout
+    uint8_t*        fFlat;
+    uint32_t        fFlatSize;
+    const uint8_t*  fFlatDefaults;
+
     void IDeAlloc();
     void IInit();   // initize vars
+    bool IIsFlat() const { return fFlat && fBy==fFlat; }
+    void IDetachFlat();     // move values to heap storage before a type or count change
+    const void* IGetRawData() const { return fBy; }
+    static bool IValuesEqual(int atomicType, const void* a, const void* b, int cnt);
     void IVarSet(bool timeStampNow=false);
     
     // converter fxns
@@ -251,11 +268,23 @@ protected:
 
     bool IReadData(hsStream* s, float timeConvert, int idx, uint32_t readOptions);    
     bool IWriteData(hsStream* s, float timeConvert, int idx, uint32_t writeOptions) const;
+    bool IReadList(hsStream* s);            // whole list in one stream call, false if the type can't
+    bool IWriteList(hsStream* s) const;
+    bool ISameAsDefaults() const;
+    uint8_t IGetSaveFlags(uint32_t writeOptions, bool sameAsDefaults) const;
+
+    // delta encoded values, see plSDLDeltaChain. ref is nil when there is nothing to be relative to
+    bool IReadDeltaList(hsStream* s, float timeConvert, const plUnifiedTime& base, const plSimpleStateVariable* ref);
+    bool IWriteDeltaList(hsStream* s, float timeConvert, const plUnifiedTime& base, const plSimpleStateVariable* ref) const;
+    void ICopyToDeltaRef(plSimpleStateVariable* ref, bool quantize) const;
+
+    plSimpleStateVariable(plVarDescriptor* vd, uint8_t* flat, uint32_t flatSize, const uint8_t* flatDefaults) 
+        : fFlat(flat), fFlatSize(flatSize), fFlatDefaults(flatDefaults) { IInit(); CopyFrom(vd); }
 
 public:
 
-    plSimpleStateVariable() { IInit(); }        
-    plSimpleStateVariable(plVarDescriptor* vd) { IInit(); CopyFrom(vd); }   
+    plSimpleStateVariable() : fFlat(nil), fFlatSize(0), fFlatDefaults(nil) { IInit(); }        
+    plSimpleStateVariable(plVarDescriptor* vd) : fFlat(nil), fFlatSize(0), fFlatDefaults(nil) { IInit(); CopyFrom(vd); }   
     ~plSimpleStateVariable() { IDeAlloc(); }
     
     // conversion ops
@@ -323,6 +352,11 @@ public:
     // IO
     bool ReadData(hsStream* s, float timeConvert, uint32_t readOptions);  
     bool WriteData(hsStream* s, float timeConvert, uint32_t writeOptions) const;
+
+    // IO relative to the matching var of a delta chain, which is updated to the new values.
+    // times are written relative to base.
+    bool ReadDeltaData(hsStream* s, float timeConvert, uint32_t readOptions, const plUnifiedTime& base, plSimpleStateVariable* ref);
+    bool WriteDeltaData(hsStream* s, float timeConvert, uint32_t writeOptions, const plUnifiedTime& base, plSimpleStateVariable* ref) const;
 };
 
 //
@@ -391,6 +425,7 @@ public:
 // Contains the actual data contents and points to its associated descriptor
 //
 class plNetMsgSDLState;
+class plSDLDeltaChain;
 class plStateDataRecord : public plCreatable
 {
 public:
@@ -398,24 +433,36 @@ public:
     typedef std::vector<plSDStateVariable*> SDVarsList;
     enum Flags
     {
-        kVolatile = 0x1
+        kVolatile = 0x1,
+        kDeltaCapable = 0x2,        // writer reads delta encoded records. Set on every record we write
+        kServerDeltaCapable = 0x4   // only set by a server which stores and forwards delta encoded records
     };
 protected:
     typedef std::vector<plStateVariable*> VarsList;
 
     const plStateDescriptor* fDescriptor;
     plUoid      fAssocObject;       // optional
+    uint32_t    fDeltaSender;       // NOT WRITTEN. player a delta encoded record came from, picks its recv chain
     VarsList    fVarsList;          // list of variables
     VarsList    fSDVarsList;        // list of nested data records
+    uint8_t*    fVarBlock;          // simple vars and their flat values, see plSDLLayout
     uint32_t      fFlags;
     static const uint8_t kIOVersion;  // I/O Version
+    static const uint8_t kIODeltaVersion; // I/O Version of delta encoded records, older readers reject them
     
     void IDeleteVarsList(VarsList& vars);
+    void IDeleteSimpleVars();
+    bool ISameFlatValues(const plStateDataRecord& other) const;
     void IInitDescriptor(const char* name, int version);    // or plSDL::kLatestVersion
     void IInitDescriptor(const plStateDescriptor* sd);
     
     void IReadHeader(hsStream* s);
     void IWriteHeader(hsStream* s) const;
+    bool IReadSDVars(hsStream* s, float timeConvert, uint32_t readOptions);
+    void IWriteSDVars(hsStream* s, float timeConvert, uint32_t writeOptions) const;
+    bool IReadDelta(hsStream* s, float timeConvert, uint32_t readOptions);
+    void IWriteDelta(hsStream* s, float timeConvert, uint32_t writeOptions, plSDLDeltaChain* chain) const;
+    void IConvertToLatest(uint32_t readOptions);
     bool IConvertVar(plSimpleStateVariable* fromVar, plSimpleStateVariable* toVar, bool force);
 
     plStateVariable* IFindVar(const VarsList& vars, const char* name) const;
@@ -432,8 +479,8 @@ public:
 
     plStateDataRecord(const char* sdName, int version=plSDL::kLatestVersion);
     plStateDataRecord(plStateDescriptor* sd);
-    plStateDataRecord(const plStateDataRecord &other, uint32_t writeOptions=0 ):fFlags(0) { CopyFrom(other, writeOptions); }
-    plStateDataRecord():fFlags(0) {}
+    plStateDataRecord(const plStateDataRecord &other, uint32_t writeOptions=0 ):fDescriptor(nil),fDeltaSender(0),fVarBlock(nil),fFlags(0) { CopyFrom(other, writeOptions); }
+    plStateDataRecord():fDescriptor(nil),fDeltaSender(0),fVarBlock(nil),fFlags(0) {}
     ~plStateDataRecord();
     
     bool ConvertTo(plStateDescriptor* other, bool force=false );
@@ -481,11 +528,13 @@ public:
     const plStateDescriptor* GetDescriptor() const { return fDescriptor; }
     void SetDescriptor(const char* sdName, int version);
     
-    plNetMsgSDLState* PrepNetMsg(float timeConvert, uint32_t writeOptions) const; // create/prep a net msg with this data
+    plNetMsgSDLState* PrepNetMsg(float timeConvert, uint32_t writeOptions, const plUoid* deltaUoid=nil) const; // create/prep a net msg with this data
     
     void SetAssocObject(const plUoid& u) { fAssocObject=u; }        // optional 
     plUoid* GetAssocObject() { return &fAssocObject; }      // optional
     const plUoid* GetAssocObject() const { return &fAssocObject; }      // optional
+    void SetDeltaSender(uint32_t playerID) { fDeltaSender=playerID; }
+    uint32_t GetDeltaSender() const { return fDeltaSender; }
 
     // utils
     void FlagDifferentState(const plStateDataRecord& other);    // mark items which differ from 'other' as dirty
@@ -502,6 +551,60 @@ public:
     void WriteStreamHeader(hsStream* s, plUoid* objUoid=nil) const;
 };
 
+//
+// The values the receivers of an object's state last decoded, which delta 
+// encoded records are relative to.  The sender keeps the values as the receivers 
+// will decode them, so quantized floats don't drift.  Records are numbered within
+// a chain, and a chain restarts every few records so peers who joined late or 
+// missed a record pick up again.
+//
+class plSDLDeltaChain
+{
+public:
+    enum
+    {
+        kMaxLength = 8      // records per chain
+    };
+    static const double kMaxAge;    // secs before a chain restarts
+
+    uint16_t    fChainID;
+    uint16_t    fSeq;           // of the last record in the chain
+    double      fStartTime;
+    plStateDataRecord* fRec;    // nil until the chain starts, or after a receiver lost track
+    bool        fResyncAsked;   // receiver lost track and asked the sender for a new chain
+
+    plSDLDeltaChain() : fChainID(0), fSeq(0), fStartTime(0), fRec(nil), fResyncAsked(false) {}
+    ~plSDLDeltaChain();
+
+    void Restart(uint16_t chainID, const plStateDescriptor* sd, double now);
+    void Break();
+};
+
+//
+// What a delta chain is for: an object's state of one descriptor, from one
+// sender (0 for our own send chains).  Sorted by sender first, so all of a 
+// player's chains can be dropped together when they leave.
+//
+class plSDLDeltaChainKey
+{
+public:
+    plUoid      fUoid;
+    const plStateDescriptor* fDesc;
+    uint32_t    fSender;
+
+    plSDLDeltaChainKey(const plUoid& uoid, const plStateDescriptor* sd, uint32_t sender) 
+        : fUoid(uoid), fDesc(sd), fSender(sender) {}
+
+    bool operator<(const plSDLDeltaChainKey& k) const
+    {
+        if (fSender != k.fSender)
+            return fSender < k.fSender;
+        if (fDesc != k.fDesc)
+            return fDesc < k.fDesc;
+        return fUoid < k.fUoid;
+    }
+};
+
 //
 // Simple SDL parser
 //
@@ -537,7 +640,30 @@ private:
     plNetApp*   fNetApp;
     uint32_t      fBehaviorFlags;
 
+    typedef std::map<plSDLDeltaChainKey, plSDLDeltaChain*> DeltaChainMap;
+    DeltaChainMap   fSendChains;
+    DeltaChainMap   fRecvChains;
+    bool            fDeltaEncoding;
+    std::vector<plSDLDeltaChainKey> fDeltaResyncs;
+    std::set<uint32_t> fDeltaPeers;     // players whose records say they read delta encoded ones
+    bool            fServerDeltaCapable;
+
     void IDeleteDescriptors(plSDL::DescriptorList* dl);
+    void IApplyDeltaQuanta(plSDL::DescriptorList* dl);
+public:
+    struct DeltaStats
+    {
+        uint32_t fRecordsWritten;
+        uint32_t fBytesWritten;
+        uint32_t fRecordsRead;
+        uint32_t fRecordsDropped;   // relative to a chain we had lost track of
+        uint32_t fResyncsAsked;     // new chains asked of the senders of dropped records
+        uint32_t fChainsStarted;
+        DeltaStats() { Clear(); }
+        void Clear() { memset(this, 0, sizeof(*this)); }
+    };
+private:
+    DeltaStats      fDeltaStats;
 public:
     plSDLMgr();
     ~plSDLMgr();
@@ -559,6 +685,25 @@ public:
     void SetBehaviorFlags(uint32_t v) { fBehaviorFlags=v; }
     bool AllowTimeStamping() const { return ! ( fBehaviorFlags&plSDL::kDisallowTimeStamping ); }
 
+    // Delta encoded broadcasts. Off by default, and only used once the server and
+    // everyone in the age have advertised they can read them, see plStateDataRecord::kDeltaCapable
+    void SetDeltaEncoding(bool on) { fDeltaEncoding=on; }
+    bool GetDeltaEncoding() const { return fDeltaEncoding; }
+    void AddDeltaPeer(uint32_t playerID) { fDeltaPeers.insert(playerID); }
+    bool IsDeltaPeer(uint32_t playerID) const { return fDeltaPeers.find(playerID) != fDeltaPeers.end(); }
+    void SetServerDeltaCapable(bool on) { fServerDeltaCapable=on; }
+    bool GetServerDeltaCapable() const { return fServerDeltaCapable; }
+    void ClearDeltaPeers() { fDeltaPeers.clear(); fServerDeltaCapable=false; }   // on age change
+    // recv chains are kept per sending player as well, send chains ignore sender
+    plSDLDeltaChain* GetDeltaChain(const plUoid& uoid, const plStateDescriptor* sd, bool send, uint32_t sender=0);
+    void RemoveDeltaChain(const plUoid& uoid, const plStateDescriptor* sd, bool send, uint32_t sender=0);
+    void RemoveDeltaSender(uint32_t sender);    // drop a player's recv chains when they leave
+    void ClearDeltaChains();    // on age change
+    // recv chains we lost track of, whose senders should start a new one.  The net client sends these
+    void QueueDeltaResync(const plUoid& uoid, const plStateDescriptor* sd, uint32_t sender);
+    void PopDeltaResyncs(std::vector<plSDLDeltaChainKey>* resyncs) { resyncs->swap(fDeltaResyncs); fDeltaResyncs.clear(); }
+    DeltaStats& GetDeltaStats() { return fDeltaStats; }
+
     // I/O - return # of bytes read/written
     int Write(hsStream* s, const plSDL::DescriptorList* dl=nil);    // write descriptors to a stream
     int Read(hsStream* s, plSDL::DescriptorList* dl=nil);       // read descriptors into provided list (use legacyList if nil)
@@ -0,0 +1,810 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+#include <math.h>
+#include "hsStream.h"
+#include "hsTimer.h"
+#include "hsStlUtils.h"
+#include "plSDL.h"
+
+#include "pnNetCommon/plNetApp.h"
+#include "plUnifiedTime/plClientUnifiedTime.h"
+
+//
+// Delta encoded SDL records.
+//
+// A delta record starts a chain, or continues the chain the last record for the 
+// object was in.  Vars in it can be relative to the values the chain holds:
+// ints and shorts as the zig-zagged difference, floats as the difference in 
+// quantum steps when they have one (see kDeltaQuanta) and as the xor of the 
+// bits otherwise, all 7 bits at a time so small changes take a byte or two.
+// Bools are packed 8 to a byte and times are relative to the record's time.
+// Keys, strings, creatables and nested records are written in full.
+//
+
+// static 
+const uint8_t plStateDataRecord::kIODeltaVersion=0x86;
+const double plSDLDeltaChain::kMaxAge=4.0;
+
+enum DeltaFlags
+{
+    kDeltaHasBaseTime   = 0x1,  // times are relative to a base time following the header
+    kDeltaVarMask       = 0x2,  // vars are flagged 8 to a byte instead of listed by index
+};
+
+//
+// helpers
+//
+uint64_t plSDL::VarUIntRead(hsStream* s)
+{
+    uint64_t val=0;
+    int shift;
+    for(shift=0;shift<64;shift+=7)
+    {
+        uint8_t b=s->ReadByte();
+        val |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            break;
+    }
+    return val;
+}
+
+void plSDL::VarUIntWrite(hsStream* s, uint64_t val)
+{
+    while (val >= 0x80)
+    {
+        s->WriteByte((uint8_t)(val | 0x80));
+        val >>= 7;
+    }
+    s->WriteByte((uint8_t)val);
+}
+
+// small negative numbers to small positive ones
+static inline uint32_t IZigZag32(int32_t v) { return ((uint32_t)v << 1) ^ (uint32_t)(v >> 31); }
+static inline int32_t IUnZigZag32(uint32_t v) { return (int32_t)(v >> 1) ^ -(int32_t)(v & 1); }
+static inline uint64_t IZigZag64(int64_t v) { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+static inline int64_t IUnZigZag64(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+static inline uint32_t IFloatBits(float f) { uint32_t u; memcpy(&u, &f, sizeof(u)); return u; }
+static inline float IBitsFloat(uint32_t u) { float f; memcpy(&f, &u, sizeof(f)); return f; }
+static inline uint64_t IDoubleBits(double d) { uint64_t u; memcpy(&u, &d, sizeof(u)); return u; }
+static inline double IBitsDouble(uint64_t u) { double d; memcpy(&d, &u, sizeof(d)); return d; }
+
+static inline int32_t IQuantize(float v, float quantum)
+{
+    double q = floor((double)v / quantum + 0.5);
+    if (q > 2147483647.0)
+        return 0x7fffffff;
+    if (q < -2147483648.0)
+        return (int32_t)0x80000000;
+    return (int32_t)q;
+}
+
+static inline float IDequantize(int32_t q, float quantum)
+{
+    return (float)(q * (double)quantum);
+}
+
+//
+// times go out in microseconds from the record's base time
+//
+static void IWriteDeltaTime(hsStream* s, const plUnifiedTime& t, const plUnifiedTime& base)
+{
+    int64_t micros = ((int64_t)t.GetSecs() - (int64_t)base.GetSecs()) * 1000000 + 
+        ((int64_t)t.GetMicros() - (int64_t)base.GetMicros());
+    plSDL::VarUIntWrite(s, IZigZag64(micros));
+}
+
+static void IReadDeltaTime(hsStream* s, plUnifiedTime* t, const plUnifiedTime& base)
+{
+    int64_t micros = (int64_t)base.GetSecs() * 1000000 + base.GetMicros() + IUnZigZag64(plSDL::VarUIntRead(s));
+    if (micros < 0)
+        micros = 0;
+    t->SetSecs((time_t)(micros / 1000000));
+    t->SetMicros((uint32_t)(micros % 1000000));
+}
+
+// the types which can be relative to the chain's values
+static bool IIsDeltaType(int atomicType)
+{
+    return (atomicType==plVarDescriptor::kInt || atomicType==plVarDescriptor::kShort ||
+        atomicType==plVarDescriptor::kFloat || atomicType==plVarDescriptor::kDouble);
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// plSDLDeltaChain
+/////////////////////////////////////////////////////////////////////////////////
+
+plSDLDeltaChain::~plSDLDeltaChain()
+{
+    delete fRec;
+}
+
+//
+// start over with no values to be relative to
+//
+void plSDLDeltaChain::Restart(uint16_t chainID, const plStateDescriptor* sd, double now)
+{
+    delete fRec;
+    fRec = new plStateDataRecord((plStateDescriptor*)sd);
+    fChainID = chainID;
+    fSeq = 0;
+    fStartTime = now;
+    fResyncAsked = false;
+}
+
+//
+// lost track of the values, wait for the next chain
+//
+void plSDLDeltaChain::Break()
+{
+    delete fRec;
+    fRec = nil;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// plSimpleStateVariable
+/////////////////////////////////////////////////////////////////////////////////
+
+//
+// write the value list, relative to ref if there is one
+//
+bool plSimpleStateVariable::IWriteDeltaList(hsStream* s, float timeConvert, const plUnifiedTime& base, 
+                                            const plSimpleStateVariable* ref) const
+{
+    int i, cnt = fVar.GetAtomicCount()*fVar.GetCount();
+    float quantum = fVar.GetQuantum();
+    switch(fVar.GetAtomicType())
+    {
+    case plVarDescriptor::kInt:
+        for(i=0;i<cnt;i++)
+            plSDL::VarUIntWrite(s, IZigZag32((int32_t)((uint32_t)fI[i] - (ref ? (uint32_t)ref->fI[i] : 0))));
+        return true;
+    case plVarDescriptor::kShort:
+        for(i=0;i<cnt;i++)
+            plSDL::VarUIntWrite(s, IZigZag32((int16_t)(fS[i] - (ref ? ref->fS[i] : 0))));
+        return true;
+    case plVarDescriptor::kByte:
+        s->Write(cnt, fBy);
+        return true;
+    case plVarDescriptor::kBool:
+        {
+            uint8_t bits=0;
+            for(i=0;i<cnt;i++)
+            {
+                if (fB[i])
+                    bits |= 1<<(i&7);
+                if ((i&7)==7 || i==cnt-1)
+                {
+                    s->WriteByte(bits);
+                    bits=0;
+                }
+            }
+        }
+        return true;
+    case plVarDescriptor::kFloat:
+        if (quantum > 0)
+        {
+            for(i=0;i<cnt;i++)
+            {
+                int32_t q = IQuantize(fF[i], quantum);
+                int32_t r = ref ? IQuantize(ref->fF[i], quantum) : 0;
+                plSDL::VarUIntWrite(s, IZigZag32((int32_t)((uint32_t)q - (uint32_t)r)));
+            }
+        }
+        else if (ref)
+        {
+            // close values share the sign, exponent and top of the mantissa
+            for(i=0;i<cnt;i++)
+                plSDL::VarUIntWrite(s, IFloatBits(fF[i]) ^ IFloatBits(ref->fF[i]));
+        }
+        else
+            s->WriteLEScalar(cnt, fF);
+        return true;
+    case plVarDescriptor::kDouble:
+        if (ref)
+        {
+            for(i=0;i<cnt;i++)
+                plSDL::VarUIntWrite(s, IDoubleBits(fD[i]) ^ IDoubleBits(ref->fD[i]));
+        }
+        else
+            s->WriteLEDouble(cnt, fD);
+        return true;
+    case plVarDescriptor::kTime:
+        for(i=0;i<cnt;i++)
+        {
+            if (timeConvert != 0.0)
+                IWriteDeltaTime(s, plUnifiedTime(fT[i].GetSecsDouble() + timeConvert), base);
+            else
+                IWriteDeltaTime(s, fT[i], base);
+        }
+        return true;
+    default:
+        for(i=0;i<fVar.GetCount();i++)
+            if (!IWriteData(s, timeConvert, i, 0))
+                return false;
+        return true;
+    }
+}
+
+//
+// read the value list, relative to ref if there is one
+//
+bool plSimpleStateVariable::IReadDeltaList(hsStream* s, float timeConvert, const plUnifiedTime& base, 
+                                           const plSimpleStateVariable* ref)
+{
+    int i, cnt = fVar.GetAtomicCount()*fVar.GetCount();
+    float quantum = fVar.GetQuantum();
+    switch(fVar.GetAtomicType())
+    {
+    case plVarDescriptor::kInt:
+        for(i=0;i<cnt;i++)
+            fI[i] = (int32_t)((ref ? (uint32_t)ref->fI[i] : 0) + (uint32_t)IUnZigZag32((uint32_t)plSDL::VarUIntRead(s)));
+        return true;
+    case plVarDescriptor::kShort:
+        for(i=0;i<cnt;i++)
+            fS[i] = (short)((ref ? ref->fS[i] : 0) + IUnZigZag32((uint32_t)plSDL::VarUIntRead(s)));
+        return true;
+    case plVarDescriptor::kByte:
+        s->Read(cnt, fBy);
+        return true;
+    case plVarDescriptor::kBool:
+        {
+            uint8_t bits=0;
+            for(i=0;i<cnt;i++)
+            {
+                if ((i&7)==0)
+                    bits = s->ReadByte();
+                fB[i] = (bits & (1<<(i&7))) != 0;
+            }
+        }
+        return true;
+    case plVarDescriptor::kFloat:
+        if (quantum > 0)
+        {
+            for(i=0;i<cnt;i++)
+            {
+                int32_t r = ref ? IQuantize(ref->fF[i], quantum) : 0;
+                int32_t q = (int32_t)((uint32_t)r + (uint32_t)IUnZigZag32((uint32_t)plSDL::VarUIntRead(s)));
+                fF[i] = IDequantize(q, quantum);
+            }
+        }
+        else if (ref)
+        {
+            for(i=0;i<cnt;i++)
+                fF[i] = IBitsFloat(IFloatBits(ref->fF[i]) ^ (uint32_t)plSDL::VarUIntRead(s));
+        }
+        else
+            s->ReadLEScalar(cnt, fF);
+        return true;
+    case plVarDescriptor::kDouble:
+        if (ref)
+        {
+            for(i=0;i<cnt;i++)
+                fD[i] = IBitsDouble(IDoubleBits(ref->fD[i]) ^ plSDL::VarUIntRead(s));
+        }
+        else
+            s->ReadLEDouble(cnt, fD);
+        return true;
+    case plVarDescriptor::kTime:
+        for(i=0;i<cnt;i++)
+        {
+            IReadDeltaTime(s, &fT[i], base);
+            if (timeConvert != 0.0)
+            {
+                double newUt = (fT[i].GetSecsDouble() + timeConvert);
+                hsAssert(newUt>=0, "negative unified time");
+                fT[i].SetSecsDouble(newUt);
+            }
+        }
+        return true;
+    default:
+        for(i=0;i<fVar.GetCount();i++)
+            if (!IReadData(s, timeConvert, i, 0))
+                return false;
+        return true;
+    }
+}
+
+//
+// update the chain's copy of this var to the values the receivers decode
+//
+void plSimpleStateVariable::ICopyToDeltaRef(plSimpleStateVariable* ref, bool quantize) const
+{
+    if (ref->fVar.GetCount() != fVar.GetCount())
+        ref->Alloc(fVar.GetCount());
+
+    int i, cnt = fVar.GetAtomicCount()*fVar.GetCount();
+    float quantum = fVar.GetQuantum();
+    switch(fVar.GetAtomicType())
+    {
+    case plVarDescriptor::kInt:
+        memcpy(ref->fI, fI, cnt*sizeof(int));
+        break;
+    case plVarDescriptor::kShort:
+        memcpy(ref->fS, fS, cnt*sizeof(short));
+        break;
+    case plVarDescriptor::kFloat:
+        if (quantize && quantum > 0)
+        {
+            for(i=0;i<cnt;i++)
+                ref->fF[i] = IDequantize(IQuantize(fF[i], quantum), quantum);
+        }
+        else
+            memcpy(ref->fF, fF, cnt*sizeof(float));
+        break;
+    case plVarDescriptor::kDouble:
+        memcpy(ref->fD, fD, cnt*sizeof(double));
+        break;
+    default:
+        break;      // never relative to the chain
+    }
+    ref->SetUsed(true);
+}
+
+bool plSimpleStateVariable::WriteDeltaData(hsStream* s, float timeConvert, uint32_t writeOptions, 
+                                           const plUnifiedTime& base, plSimpleStateVariable* ref) const
+{
+    bool sameAsDefaults=ISameAsDefaults();
+    bool relative = ref && ref->IsUsed() && !sameAsDefaults && 
+        ref->GetCount()==GetCount() && IIsDeltaType(fVar.GetAtomicType());
+
+    // one flags byte, the base class's notification flag shares it.
+    // hints are hardly ever set, so leave out the empty ones.
+    bool writeNotificationInfo = ((writeOptions & plSDL::kSkipNotificationInfo)==0) && 
+        *GetNotificationInfo().GetHintString();
+
+    uint8_t saveFlags = IGetSaveFlags(writeOptions, sameAsDefaults);
+    if (relative)
+        saveFlags |= plSDL::kHasDelta;
+    if (writeNotificationInfo)
+        saveFlags |= plSDL::kHasNotificationInfo;
+    s->WriteLE(saveFlags);
+
+    if (writeNotificationInfo)
+        GetNotificationInfo().Write(s, writeOptions);
+
+    if (writeOptions & plSDL::kTimeStampOnWrite)
+    {
+        fTimeStamp.ToCurrentTime();
+        IWriteDeltaTime(s, fTimeStamp, base);
+    }
+    else if (writeOptions & plSDL::kWriteTimeStamps)
+        IWriteDeltaTime(s, fTimeStamp, base);
+
+    if (!sameAsDefaults)
+    {
+        if (GetVarDescriptor()->IsVariableLength())
+            plSDL::VarUIntWrite(s, GetVarDescriptor()->GetCount());
+
+        if (!IWriteDeltaList(s, timeConvert, base, relative ? ref : nil))
+            return false;
+    }
+
+    if (ref)
+        ICopyToDeltaRef(ref, !sameAsDefaults);
+    return true;
+}
+
+//
+// Delta records are only read into new records, so unlike ReadData there 
+// is no older timestamp to keep.
+//
+bool plSimpleStateVariable::ReadDeltaData(hsStream* s, float timeConvert, uint32_t readOptions, 
+                                          const plUnifiedTime& base, plSimpleStateVariable* ref)
+{
+    plUnifiedTime ut;
+    ut.ToEpoch();
+
+    uint8_t saveFlags;
+    s->ReadLE(&saveFlags);
+
+    if (saveFlags & plSDL::kHasNotificationInfo)
+        GetNotificationInfo().Read(s, readOptions);
+
+    bool isDirty = ( saveFlags & plSDL::kHasDirtyFlag )!=0;
+    bool setDirty = ( isDirty && ( readOptions & plSDL::kKeepDirty ) ) || ( readOptions & plSDL::kMakeDirty );
+    bool wantTimestamp = isDirty &&
+        plSDLMgr::GetInstance()->AllowTimeStamping() &&
+        (   ( saveFlags & plSDL::kWantTimeStamp ) ||
+            ( readOptions & plSDL::kTimeStampOnRead )   );
+
+    if (saveFlags & plSDL::kHasTimeStamp)
+        IReadDeltaTime(s, &ut, base);
+    else if ( wantTimestamp )
+        ut.ToCurrentTime();
+
+    bool relative = (saveFlags & plSDL::kHasDelta)!=0;
+    if (relative && !(ref && ref->IsUsed()))
+        return false;       // lost track of the chain
+
+    if (!(saveFlags & plSDL::kSameAsDefault))
+    {
+        setDirty = setDirty || ( readOptions & plSDL::kDirtyNonDefaults )!=0;
+
+        // read list size
+        if (GetVarDescriptor()->IsVariableLength())
+        {
+            uint64_t cnt = plSDL::VarUIntRead(s);
+            if (cnt<plSDL::kMaxListSize)
+                fVar.SetCount((int)cnt);
+            else
+                return false;
+
+            Alloc();        // alloc after setting count
+        }
+
+        if (relative && ref->GetCount()!=GetCount())
+            return false;
+    }
+
+    if ( (saveFlags & plSDL::kHasTimeStamp) || (readOptions & plSDL::kTimeStampOnRead) )
+        TimeStamp(ut);
+
+    // read list
+    if (!(saveFlags & plSDL::kSameAsDefault))
+    {
+        if (!IReadDeltaList(s, timeConvert, base, relative ? ref : nil))
+            return false;
+    }
+    else if (IIsFlat() && fFlatDefaults)
+    {
+        memcpy(fFlat, fFlatDefaults, fFlatSize);
+    }
+    else
+    {
+        Reset();
+        SetFromDefaults(false);
+    }
+
+    SetUsed( true );
+    SetDirty( setDirty );
+
+    if (ref)
+        ICopyToDeltaRef(ref, false);
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// plStateDataRecord
+/////////////////////////////////////////////////////////////////////////////////
+
+//
+// write the dirty or used vars relative to the chain's values, and move the chain along
+//
+void plStateDataRecord::IWriteDelta(hsStream* s, float timeConvert, uint32_t writeOptions, plSDLDeltaChain* chain) const
+{
+    plSDLMgr* mgr = plSDLMgr::GetInstance();
+    uint32_t pos = s->GetPosition();
+    double now = hsTimer::GetSysSeconds();
+
+    if (!chain->fRec || chain->fRec->GetDescriptor()!=fDescriptor || 
+        chain->fSeq+1 >= plSDLDeltaChain::kMaxLength || now-chain->fStartTime > plSDLDeltaChain::kMaxAge)
+    {
+        chain->Restart(chain->fChainID+1, fDescriptor, now);
+        mgr->GetDeltaStats().fChainsStarted++;
+    }
+    else
+        chain->fSeq++;
+
+    bool dirtyOnly = (writeOptions & plSDL::kDirtyOnly) != 0;
+    int i, j, numVars = fVarsList.size();
+    int num = dirtyOnly ? GetNumDirtyVars() : GetNumUsedVars();
+    bool all = (num==numVars);
+
+    // times are relative to now, if there are any
+    bool hasTimes = (writeOptions & (plSDL::kWriteTimeStamps | plSDL::kTimeStampOnWrite))!=0;
+    for(i=0;i<numVars && !hasTimes;i++)
+    {
+        if ( (dirtyOnly && fVarsList[i]->IsDirty()) || (!dirtyOnly && fVarsList[i]->IsUsed()) )
+            hasTimes = (GetVar(i)->GetSimpleVarDescriptor()->GetAtomicType()==plVarDescriptor::kTime);
+    }
+
+    // flag the vars 8 to a byte when that's smaller than listing their indices
+    int idxSize = numVars < (1<<8) ? 1 : numVars < (1<<16) ? 2 : 4;
+    bool useMask = !all && (numVars+7)/8 < num*idxSize;
+
+    uint8_t deltaFlags = 0;
+    if (hasTimes)
+        deltaFlags |= kDeltaHasBaseTime;
+    if (useMask)
+        deltaFlags |= kDeltaVarMask;
+
+    s->WriteLE16((uint16_t)((fFlags & ~kServerDeltaCapable) | kDeltaCapable));
+    s->WriteByte(kIODeltaVersion);
+    s->WriteLE16(chain->fChainID);
+    s->WriteLE16(chain->fSeq);
+    s->WriteByte(deltaFlags);
+
+    plUnifiedTime base;
+    base.ToEpoch();
+    if (hasTimes)
+    {
+        base.ToCurrentTime();
+        base.Write(s);
+    }
+
+    //
+    // write simple vars
+    //
+    if (useMask)
+    {
+        for(i=0;i<numVars;i+=8)
+        {
+            uint8_t mask=0;
+            for(j=i;j<numVars && j<i+8;j++)
+                if ( (dirtyOnly && fVarsList[j]->IsDirty()) || (!dirtyOnly && fVarsList[j]->IsUsed()) )
+                    mask |= 1<<(j-i);
+            s->WriteByte(mask);
+
+            for(j=i;j<numVars && j<i+8;j++)
+                if (mask & (1<<(j-i)))
+                    GetVar(j)->WriteDeltaData(s, timeConvert, writeOptions, base, chain->fRec->GetVar(j));
+        }
+    }
+    else
+    {
+        plSDL::VariableLengthWrite(s, numVars, num );   // write affected vars count
+        for(i=0;i<numVars;i++)
+        {
+            if ( (dirtyOnly && fVarsList[i]->IsDirty()) || (!dirtyOnly && fVarsList[i]->IsUsed()) )
+            {
+                if (!all)
+                    plSDL::VariableLengthWrite(s, numVars, i );     // index
+                GetVar(i)->WriteDeltaData(s, timeConvert, writeOptions, base, chain->fRec->GetVar(i));
+            }
+        }
+    }
+
+    //
+    // write nested vars
+    //
+    IWriteSDVars(s, timeConvert, writeOptions);
+
+    mgr->GetDeltaStats().fRecordsWritten++;
+    mgr->GetDeltaStats().fBytesWritten += s->GetPosition()-pos;
+}
+
+//
+// read a delta record, after the flags and io version. 
+// needs the assoc object to find the chain.
+//
+bool plStateDataRecord::IReadDelta(hsStream* s, float timeConvert, uint32_t readOptions)
+{
+    hsAssert(fDescriptor, "State Data Record has nil SDL descriptor");
+    if (!fDescriptor || !fAssocObject.IsValid())
+        return false;
+
+    plSDLMgr* mgr = plSDLMgr::GetInstance();
+    uint16_t chainID = s->ReadLE16();
+    uint16_t seq = s->ReadLE16();
+    uint8_t deltaFlags = s->ReadByte();
+
+    plUnifiedTime base;
+    base.ToEpoch();
+    if (deltaFlags & kDeltaHasBaseTime)
+        base.Read(s);
+
+    plSDLDeltaChain* chain = mgr->GetDeltaChain(fAssocObject, fDescriptor, false, fDeltaSender);
+    if (seq==0)
+        chain->Restart(chainID, fDescriptor, hsTimer::GetSysSeconds());
+    else if (chain->fRec && (chain->fChainID!=chainID || chain->fSeq+1!=seq || chain->fRec->GetDescriptor()!=fDescriptor))
+        chain->Break();     // missed a record
+    plStateDataRecord* ref = chain->fRec;
+
+    int i, j, numVars = fVarsList.size();
+    bool ok = true;
+    try
+    {
+        if (deltaFlags & kDeltaVarMask)
+        {
+            for(i=0;i<numVars && ok;i+=8)
+            {
+                uint8_t mask = s->ReadByte();
+                for(j=i;j<numVars && j<i+8 && ok;j++)
+                    if (mask & (1<<(j-i)))
+                        ok = GetVar(j)->ReadDeltaData(s, timeConvert, readOptions, base, ref ? ref->GetVar(j) : nil);
+            }
+        }
+        else
+        {
+            int num;
+            plSDL::VariableLengthRead(s, numVars, &num );
+            bool all = (num==numVars);
+            for(i=0;i<num && ok;i++)
+            {
+                int idx;
+                if (!all)
+                    plSDL::VariableLengthRead(s, numVars, &idx );
+                else
+                    idx=i;
+                ok = (idx<numVars && GetVar(idx)->ReadDeltaData(s, timeConvert, readOptions, base, ref ? ref->GetVar(idx) : nil));
+            }
+        }
+    }
+    catch(...)
+    {
+        hsAssert( false, 
+            xtl::format("Something bad happened while reading delta var data, desc:%s", fDescriptor->GetName()).c_str());
+        ok = false;
+    }
+
+    if (!ok)
+    {
+        chain->Break();
+        // ask the sender for a new chain rather than wait for one, once per chain
+        if (!chain->fResyncAsked && fDeltaSender)
+        {
+            chain->fResyncAsked = true;
+            mgr->QueueDeltaResync(fAssocObject, fDescriptor, fDeltaSender);
+        }
+        if (!ref)
+        {
+            // not an error, the new chain will catch us up
+            mgr->GetDeltaStats().fRecordsDropped++;
+        }
+        else if (mgr->GetNetApp())
+            mgr->GetNetApp()->ErrorMsg("Failed reading delta SDL, desc %s", fDescriptor->GetName());
+        return false;
+    }
+
+    if (ref)
+        chain->fSeq = seq;
+
+    //
+    // read nested var data
+    //
+    if (!IReadSDVars(s, timeConvert, readOptions))
+        return false;
+
+    mgr->GetDeltaStats().fRecordsRead++;
+    return true;
+}
+
+/////////////////////////////////////////////////////////////////////////////////
+// plSDLMgr
+/////////////////////////////////////////////////////////////////////////////////
+
+//
+// Steps quantized floats are rounded to, by descriptor and var.  These are kept
+// here rather than in the .sdl files, which the servers and older clients parse
+// too.  Every client has to agree on them, so change one only along with the
+// delta io version.
+//
+static const struct
+{
+    const char* fDesc;
+    const char* fVar;
+    float       fQuantum;
+} kDeltaQuanta[] =
+{
+    { "physical",       "position",     0.001f },   // mm
+    { "physical",       "orientation",  0.0001f },  // quaternion components
+    { "physical",       "linear",       0.001f },
+    { "physical",       "angular",      0.001f },
+    { "avatarPhysical", "position",     0.001f },
+    { "avatarPhysical", "rotation",     0.0005f },  // radians
+};
+
+void plSDLMgr::IApplyDeltaQuanta(plSDL::DescriptorList* dl)
+{
+    plSDL::DescriptorList::iterator it;
+    for(it=dl->begin(); it!=dl->end(); it++)
+    {
+        int i;
+        for(i=0;i<sizeof(kDeltaQuanta)/sizeof(kDeltaQuanta[0]);i++)
+        {
+            if (stricmp((*it)->GetName(), kDeltaQuanta[i].fDesc))
+                continue;
+            plVarDescriptor* var = (*it)->FindVar(kDeltaQuanta[i].fVar);
+            plSimpleVarDescriptor* sVar = var ? var->GetAsSimpleVarDescriptor() : nil;
+            if (sVar && sVar->GetAtomicType()==plVarDescriptor::kFloat)
+                sVar->SetQuantum(kDeltaQuanta[i].fQuantum);
+        }
+    }
+}
+
+//
+// find or start the chain for an object's state. 
+// send chains are ours, recv chains are what other clients sent us, one per sender
+// so two players sending the same object don't break each other's chains.
+//
+plSDLDeltaChain* plSDLMgr::GetDeltaChain(const plUoid& uoid, const plStateDescriptor* sd, bool send, uint32_t sender)
+{
+    DeltaChainMap& chains = send ? fSendChains : fRecvChains;
+    plSDLDeltaChainKey key(uoid, sd, send ? 0 : sender);
+    DeltaChainMap::iterator it = chains.lower_bound(key);
+    if (it != chains.end() && !(key < it->first))
+        return it->second;
+
+    plSDLDeltaChain* chain = new plSDLDeltaChain;
+    chain->fChainID = (uint16_t)rand();     // so a new sender doesn't pick up where the last one stopped
+    chains.insert(it, DeltaChainMap::value_type(key, chain));
+    return chain;
+}
+
+void plSDLMgr::RemoveDeltaChain(const plUoid& uoid, const plStateDescriptor* sd, bool send, uint32_t sender)
+{
+    DeltaChainMap& chains = send ? fSendChains : fRecvChains;
+    DeltaChainMap::iterator it = chains.find(plSDLDeltaChainKey(uoid, sd, send ? 0 : sender));
+    if (it != chains.end())
+    {
+        delete it->second;
+        chains.erase(it);
+    }
+}
+
+void plSDLMgr::RemoveDeltaSender(uint32_t sender)
+{
+    fDeltaPeers.erase(sender);
+
+    DeltaChainMap::iterator it = fRecvChains.begin();
+    while (it != fRecvChains.end())
+    {
+        if (it->first.fSender == sender)
+        {
+            delete it->second;
+            fRecvChains.erase(it++);
+        }
+        else if (it->first.fSender > sender)
+            break;
+        else
+            it++;
+    }
+}
+
+void plSDLMgr::QueueDeltaResync(const plUoid& uoid, const plStateDescriptor* sd, uint32_t sender)
+{
+    fDeltaResyncs.push_back(plSDLDeltaChainKey(uoid, sd, sender));
+    fDeltaStats.fResyncsAsked++;
+}
+
+void plSDLMgr::ClearDeltaChains()
+{
+    DeltaChainMap::iterator it;
+    for(it=fSendChains.begin(); it!=fSendChains.end(); it++)
+        delete it->second;
+    fSendChains.clear();
+    for(it=fRecvChains.begin(); it!=fRecvChains.end(); it++)
+        delete it->second;
+    fRecvChains.clear();
+    fDeltaResyncs.clear();
+}
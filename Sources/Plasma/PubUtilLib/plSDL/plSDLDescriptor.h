@@ -154,6 +154,7 @@ class plSimpleVarDescriptor : public plVarDescriptor
 protected:
     Type    fAtomicType;            // base type (it. quaternion == kFloat)
     int     fAtomicCount;           // computed from type in .sdl (ie. quaternion == 4)
+    float   fQuantum;               // step floats are rounded to when delta encoded, 0 for exact. see plSDLMgr::IApplyDeltaQuanta
 public:
     plSimpleVarDescriptor();
     virtual ~plSimpleVarDescriptor() {  }
@@ -171,9 +172,11 @@ public:
     int     GetAtomicSize() const;      // size of one item in bytes (regardless of count)
     Type    GetAtomicType() const       { return fAtomicType; }
     int     GetAtomicCount() const      { return fAtomicCount; }    
+    float   GetQuantum() const          { return fQuantum; }
     
     // setters
     bool    SetType(const char* type);
+    void    SetQuantum(float q)         { fQuantum=q; }
     void    SetType(Type t) { plVarDescriptor::SetType(t); }    // for lame compiler
     void    SetAtomicType(Type t) { fAtomicType=t; }    
 
@@ -212,6 +215,36 @@ public:
     void    Write(hsStream* s) const;
 };
 
+//
+// Compiled storage layout for the records of one state descriptor.
+// A plStateDataRecord allocates its simple vars and the values of every
+// fixed size, plain data var in one block:  [vars][values].
+// Built on first use by plStateDescriptor::GetLayout().
+//
+class plSDLLayout
+{
+public:
+    enum { kNotFlat = 0xffffffff };
+
+    struct VarSlot
+    {
+        uint32_t    fOffset;    // into the value area, or kNotFlat if the var allocates its own data
+        uint32_t    fSize;      // bytes
+    };
+
+    std::vector<VarSlot>    fSlots;         // one per simple var, in record order
+    uint32_t                fVarsSize;      // bytes of var objects at the start of the block
+    uint32_t                fValueSize;     // bytes of flat values following them
+    uint8_t*                fDefaults;      // flat values as set from the descriptor defaults
+
+    plSDLLayout() : fVarsSize(0), fValueSize(0), fDefaults(nil) {}
+    ~plSDLLayout() { delete [] fDefaults; }
+
+    uint32_t GetBlockSize() const { return fVarsSize + fValueSize; }
+
+    static bool IsFlatType(const plSimpleVarDescriptor* vd);
+};
+
 //
 // A state descriptor - describes the contents of a type of state buffer.
 // There is one of these for each persistent object type.
@@ -227,10 +260,12 @@ private:
     int fVersion;
     char* fName;
     std::string fFilename;  // the filename this descriptor was read from
+    mutable plSDLLayout* fLayout;   // built on demand, reset when the var list changes
 
     void IDeInit();
+    void IBuildLayout() const;
 public:
-    plStateDescriptor() : fVersion(-1),fName(nil) {}
+    plStateDescriptor() : fVersion(-1),fName(nil),fLayout(nil) {}
     ~plStateDescriptor(); 
 
     // getters
@@ -243,10 +278,11 @@ public:
     // setters
     void SetVersion(int v) { fVersion=v; }
     void SetName(const char* n) { delete [] fName; fName=hsStrcpy(n); }
-    void AddVar(plVarDescriptor* v) { fVarsList.push_back(v); }
+    void AddVar(plVarDescriptor* v) { fVarsList.push_back(v); delete fLayout; fLayout=nil; }
     void SetFilename( const char * n ) { fFilename=n;}
     
     plVarDescriptor* FindVar(const char* name, int* idx=nil) const;
+    const plSDLLayout* GetLayout() const { if (!fLayout) IBuildLayout(); return fLayout; }
 
     // IO
     bool Read(hsStream* s); 
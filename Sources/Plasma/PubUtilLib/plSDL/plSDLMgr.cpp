@@ -53,7 +53,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 //
 //
 //
-plSDLMgr::plSDLMgr() : fSDLDir("SDL"), fNetApp(nil), fBehaviorFlags(0)
+plSDLMgr::plSDLMgr() : fSDLDir("SDL"), fNetApp(nil), fBehaviorFlags(0), fDeltaEncoding(false), fServerDeltaCapable(false)
 {
 
 }
@@ -70,11 +70,14 @@ bool plSDLMgr::Init( uint32_t behaviorFlags )
 {
     fBehaviorFlags = behaviorFlags;
     plSDLParser parser;
-    return parser.Parse();
+    bool ok = parser.Parse();
+    IApplyDeltaQuanta(&fDescriptors);
+    return ok;
 }
 
 void plSDLMgr::DeInit()
 {
+    ClearDeltaChains();     // their records use the descriptors
     IDeleteDescriptors(&fDescriptors);
 }
 
@@ -172,6 +175,8 @@ int plSDLMgr::Read(hsStream* s, plSDL::DescriptorList* dl)
         dl=&fDescriptors;
 
     // clear dl
+    if (dl==&fDescriptors)
+        ClearDeltaChains();     // keyed by and holding records of the old descriptors
     IDeleteDescriptors(dl);
 
     uint16_t num;
@@ -197,6 +202,8 @@ int plSDLMgr::Read(hsStream* s, plSDL::DescriptorList* dl)
         return 0;
     }
 
+    IApplyDeltaQuanta(dl);
+
     int bytes=s->GetPosition()-pos;
     if (fNetApp)
     {
@@ -40,6 +40,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 *==LICENSE==*/
 #include <algorithm>
+#include <new>
 #include "hsTimer.h"
 #include "hsTemplates.h"
 #include "hsStream.h"
@@ -95,21 +96,21 @@ void plSDL::VariableLengthWrite(hsStream* s, int size, int val)
 /////////////////////////////////////////////////////////////////////////////////
 // State Data
 /////////////////////////////////////////////////////////////////////////////////
-plStateDataRecord::plStateDataRecord(const char* name, int version) : fFlags(0)
-, fDescriptor( nil )
+plStateDataRecord::plStateDataRecord(const char* name, int version) : fDescriptor( nil )
+, fDeltaSender( 0 ), fVarBlock( nil ), fFlags( 0 )
 {
     SetDescriptor(name, version);
 }
 
-plStateDataRecord::plStateDataRecord(plStateDescriptor* sd) : fFlags(0)
-, fDescriptor( nil )
+plStateDataRecord::plStateDataRecord(plStateDescriptor* sd) : fDescriptor( nil )
+, fDeltaSender( 0 ), fVarBlock( nil ), fFlags( 0 )
 {
     IInitDescriptor(sd);
 }
 
 plStateDataRecord::~plStateDataRecord() 
 { 
-    IDeleteVarsList(fVarsList);
+    IDeleteSimpleVars();
     IDeleteVarsList(fSDVarsList);
 }
 
@@ -125,6 +126,20 @@ void plStateDataRecord::IDeleteVarsList(VarsList& vars)
     vars.clear();
 }
 
+//
+// Simple vars are constructed in place in fVarBlock
+//
+void plStateDataRecord::IDeleteSimpleVars()
+{
+    int i;
+    for(i=0;i<fVarsList.size();i++)
+        ((plSimpleStateVariable*)fVarsList[i])->~plSimpleStateVariable();
+    fVarsList.clear();
+
+    delete [] fVarBlock;
+    fVarBlock=nil;
+}
+
 void plStateDataRecord::IInitDescriptor(const char* name, int version)
 {
     plStateDescriptor* sd = plSDLMgr::GetInstance()->FindDescriptor(name, version);
@@ -143,12 +158,20 @@ void plStateDataRecord::IInitDescriptor(const plStateDescriptor* sd)
     fDescriptor=sd;
 
     // delete old vars
-    IDeleteVarsList(fVarsList);
+    IDeleteSimpleVars();
     IDeleteVarsList(fSDVarsList);
 
     // create vars defined by state desc
     if (sd)
     {
+        // one block holds the simple vars followed by their flat values
+        const plSDLLayout* layout = sd->GetLayout();
+        fVarBlock = new uint8_t[layout->GetBlockSize()];
+        uint8_t* varMem = fVarBlock;
+        uint8_t* values = fVarBlock + layout->fVarsSize;
+        memset(values, 0, layout->fValueSize);     // keep padding comparable
+        fVarsList.reserve(layout->fSlots.size());
+
         for(int i = 0; i < sd->GetNumVars(); ++i)
         {
             if (plVarDescriptor* vd = sd->GetVar(i))
@@ -160,7 +183,15 @@ void plStateDataRecord::IInitDescriptor(const plStateDescriptor* sd)
                 else
                 {
                     hsAssert(vd->GetAsSimpleVarDescriptor(), "var class problem");
-                    fVarsList.push_back(new plSimpleStateVariable(vd->GetAsSimpleVarDescriptor()));
+                    const plSDLLayout::VarSlot& slot = layout->fSlots[fVarsList.size()];
+                    plSimpleStateVariable* var;
+                    if (slot.fOffset != plSDLLayout::kNotFlat)
+                        var = new(varMem) plSimpleStateVariable(vd, values + slot.fOffset, slot.fSize,
+                                                                layout->fDefaults + slot.fOffset);
+                    else
+                        var = new(varMem) plSimpleStateVariable(vd, nil, 0, nil);
+                    varMem += sizeof(plSimpleStateVariable);
+                    fVarsList.push_back(var);
                 }
             }
         }
@@ -238,6 +269,13 @@ bool plStateDataRecord::Read(hsStream* s, float timeConvert, uint32_t readOption
 {
     fFlags = s->ReadLE16();
     uint8_t ioVersion = s->ReadByte();
+    if (ioVersion == kIODeltaVersion)
+    {
+        if (!IReadDelta(s, timeConvert, readOptions))
+            return false;
+        IConvertToLatest(readOptions);
+        return true;
+    }
     if (ioVersion != kIOVersion)
         return false;
 
@@ -284,11 +322,26 @@ bool plStateDataRecord::Read(hsStream* s, float timeConvert, uint32_t readOption
     //
     // read nested var data
     //
+    if (!IReadSDVars(s, timeConvert, readOptions))
+        return false;
+
+    IConvertToLatest(readOptions);
+
+    return true;    // ok
+}
+
+//
+// read the nested records, return true on success
+//
+bool plStateDataRecord::IReadSDVars(hsStream* s, float timeConvert, uint32_t readOptions)
+{
+    int num;
     plSDL::VariableLengthRead(s, fDescriptor->GetNumVars(), &num );
 
     // if we are readeing the entire list, we don't need to write each index
-    all = (num==fSDVarsList.size());
+    bool all = (num==fSDVarsList.size());
 
+    int i;
     try
     {
         for(i=0;i<num;i++)
@@ -315,7 +368,14 @@ bool plStateDataRecord::Read(hsStream* s, float timeConvert, uint32_t readOption
         return false;
     }
 
-    // convert to latest descriptor
+    return true;
+}
+
+//
+// convert to latest descriptor after a read
+//
+void plStateDataRecord::IConvertToLatest(uint32_t readOptions)
+{
     // Only really need to do this the first time this descriptor is read...
     plStateDescriptor* latestDesc=plSDLMgr::GetInstance()->FindDescriptor(fDescriptor->GetName(), plSDL::kLatestVersion);
     hsAssert( latestDesc, xtl::format("Failed to find latest sdl descriptor for: %s", fDescriptor->GetName() ).c_str() );
@@ -326,8 +386,6 @@ bool plStateDataRecord::Read(hsStream* s, float timeConvert, uint32_t readOption
         ConvertTo( latestDesc, forceConvert );
         DumpToObjectDebugger( "PostConvert" );
     }
-
-    return true;    // ok
 }
 
 //
@@ -343,7 +401,8 @@ void plStateDataRecord::Write(hsStream* s, float timeConvert, uint32_t writeOpti
     }
 #endif
 
-    s->WriteLE16((uint16_t)fFlags);
+    // advertise we read delta encoded records. The server flag is only ever the server's to set
+    s->WriteLE16((uint16_t)((fFlags & ~kServerDeltaCapable) | kDeltaCapable));
     s->WriteByte(kIOVersion);
 
     //
@@ -371,12 +430,22 @@ void plStateDataRecord::Write(hsStream* s, float timeConvert, uint32_t writeOpti
     //
     // write nested vars
     //
-    num = dirtyOnly ? GetNumDirtySDVars() : GetNumUsedSDVars();
+    IWriteSDVars(s, timeConvert, writeOptions);
+}
+
+//
+// write out the nested records, along with their index
+//
+void plStateDataRecord::IWriteSDVars(hsStream* s, float timeConvert, uint32_t writeOptions) const
+{
+    bool dirtyOnly = (writeOptions & plSDL::kDirtyOnly) != 0;
+    int num = dirtyOnly ? GetNumDirtySDVars() : GetNumUsedSDVars();
     plSDL::VariableLengthWrite(s, fDescriptor->GetNumVars(), num ); // write affected vars count
 
     // if we are writing he entire list, we don't need to write each index
-    all = (num==fSDVarsList.size());
+    bool all = (num==fSDVarsList.size());
 
+    int i;
     for(i=0;i<fSDVarsList.size(); i++)
     {
         if ( (dirtyOnly && fSDVarsList[i]->IsDirty()) ||
@@ -443,12 +512,15 @@ void plStateDataRecord::WriteStreamHeader(hsStream* s, plUoid* objUoid) const
 //
 // create and prepare a net msg with this data
 //
-plNetMsgSDLState* plStateDataRecord::PrepNetMsg(float timeConvert, uint32_t writeOptions) const
+plNetMsgSDLState* plStateDataRecord::PrepNetMsg(float timeConvert, uint32_t writeOptions, const plUoid* deltaUoid) const
 {
     // save to stream
     hsRAMStream stream; 
     WriteStreamHeader(&stream);
-    Write(&stream, timeConvert, writeOptions);
+    if ((writeOptions & plSDL::kDeltaEncode) && deltaUoid)
+        IWriteDelta(&stream, timeConvert, writeOptions, plSDLMgr::GetInstance()->GetDeltaChain(*deltaUoid, fDescriptor, true));
+    else
+        Write(&stream, timeConvert, writeOptions);
     
     // fill in net msg
     plNetMsgSDLState* msg;  
@@ -467,6 +539,7 @@ plNetMsgSDLState* plStateDataRecord::PrepNetMsg(float timeConvert, uint32_t writ
 void plStateDataRecord::CopyFrom(const plStateDataRecord& other, uint32_t writeOptions/*=0*/)
 {
     fFlags = other.GetFlags();
+    fDeltaSender = other.GetDeltaSender();
     IInitDescriptor(other.GetDescriptor());
     int i;
     for(i=0;i<other.GetNumVars();i++)
@@ -524,14 +597,32 @@ void plStateDataRecord::UpdateFrom(const plStateDataRecord& other, uint32_t writ
 // dirty my items which are different from the corresponding one in 'other'.
 // Requires that records have the same descriptor.
 //
+//
+// True when the flat value areas of two records with the same descriptor
+// are byte for byte identical, which settles every var still bound to it.
+//
+bool plStateDataRecord::ISameFlatValues(const plStateDataRecord& other) const
+{
+    if (!fDescriptor || !fVarBlock || !other.fVarBlock)
+        return false;
+    const plSDLLayout* layout = fDescriptor->GetLayout();
+    return layout->fValueSize && 
+        !memcmp(fVarBlock+layout->fVarsSize, other.fVarBlock+layout->fVarsSize, layout->fValueSize);
+}
+
 void plStateDataRecord::FlagDifferentState(const plStateDataRecord& other)
 {
     if (other.GetDescriptor()==fDescriptor)
     {
+        bool sameFlat = ISameFlatValues(other);
         int i;
         for(i=0;i<other.GetNumVars();i++)
         {
-            bool diff = (GetVar(i)->IsUsed() && ! (*other.GetVar(i) == *GetVar(i)) );
+            bool diff;
+            if (sameFlat && GetVar(i)->IIsFlat() && other.GetVar(i)->IIsFlat())
+                diff = false;
+            else
+                diff = (GetVar(i)->IsUsed() && ! (*other.GetVar(i) == *GetVar(i)) );
             GetVar(i)->SetDirty(diff);
         }
 
@@ -612,9 +703,12 @@ bool plStateDataRecord::operator==(const plStateDataRecord &other) const
     if (other.GetDescriptor()!=fDescriptor)
         return false;
 
+    bool sameFlat = ISameFlatValues(other);
     int i;
     for(i=0;i<other.GetNumVars();i++)
     {
+        if (sameFlat && GetVar(i)->IIsFlat() && other.GetVar(i)->IIsFlat())
+            continue;
         if (! (*other.GetVar(i) == *GetVar(i)) )
             return false;
     }
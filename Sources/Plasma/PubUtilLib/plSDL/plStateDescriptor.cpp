@@ -61,6 +61,91 @@ void plStateDescriptor::IDeInit()
     for(i=0;i<fVarsList.size();i++)
         delete fVarsList[i];
     fVarsList.clear();
+    delete fLayout;
+    fLayout=nil;
+}
+
+//
+// Plain data vars with a fixed count can live in the record's value block.
+// Anything with constructors (keys, times, creatables) or a list size that
+// is only known on read keeps allocating its own storage.
+//
+bool plSDLLayout::IsFlatType(const plSimpleVarDescriptor* vd)
+{
+    if (vd->IsVariableLength() || vd->GetCount()==0)
+        return false;
+
+    switch(vd->GetAtomicType())
+    {
+    case plVarDescriptor::kInt:
+    case plVarDescriptor::kShort:
+    case plVarDescriptor::kByte:
+    case plVarDescriptor::kFloat:
+    case plVarDescriptor::kDouble:
+    case plVarDescriptor::kBool:
+    case plVarDescriptor::kString32:
+        return true;
+    default:
+        return false;
+    }
+}
+
+//
+// Assign each flat var its slice of the value block (aligned to its atomic
+// type) and capture the default values once, so writers can test
+// 'same as default' with a compare instead of building a temporary var.
+//
+void plStateDescriptor::IBuildLayout() const
+{
+    fLayout = new plSDLLayout;
+
+    int numSimple=0;
+    int i;
+    for(i=0;i<fVarsList.size();i++)
+    {
+        plSimpleVarDescriptor* vd = fVarsList[i]->GetAsSimpleVarDescriptor();
+        if (!vd)
+            continue;
+        numSimple++;
+
+        plSDLLayout::VarSlot slot;
+        slot.fOffset = plSDLLayout::kNotFlat;
+        slot.fSize = 0;
+        if (plSDLLayout::IsFlatType(vd))
+        {
+            uint32_t align = vd->GetAtomicSize() / vd->GetAtomicCount();
+            if (align > sizeof(double))
+                align = 1;      // string32
+            slot.fOffset = (fLayout->fValueSize + align-1) & ~(align-1);
+            slot.fSize = vd->GetAtomicSize()*vd->GetCount();
+            fLayout->fValueSize = slot.fOffset + slot.fSize;
+        }
+        fLayout->fSlots.push_back(slot);
+    }
+
+    fLayout->fVarsSize = (numSimple*sizeof(plSimpleStateVariable) + sizeof(double)-1) & ~(sizeof(double)-1);
+    fLayout->fValueSize = (fLayout->fValueSize + sizeof(double)-1) & ~(sizeof(double)-1);
+
+    if (fLayout->fValueSize)
+    {
+        fLayout->fDefaults = new uint8_t[fLayout->fValueSize];
+        memset(fLayout->fDefaults, 0, fLayout->fValueSize);
+
+        int slotIdx=0;
+        for(i=0;i<fVarsList.size();i++)
+        {
+            plSimpleVarDescriptor* vd = fVarsList[i]->GetAsSimpleVarDescriptor();
+            if (!vd)
+                continue;
+            const plSDLLayout::VarSlot& slot = fLayout->fSlots[slotIdx++];
+            if (slot.fOffset == plSDLLayout::kNotFlat)
+                continue;
+
+            plSimpleStateVariable def(vd);
+            def.SetFromDefaults(false /* timeStamp */);
+            memcpy(fLayout->fDefaults + slot.fOffset, def.IGetRawData(), slot.fSize);
+        }
+    }
 }
 
 plVarDescriptor* plStateDescriptor::FindVar(const char* name, int* idx) const
@@ -184,6 +184,9 @@ void plSimpleStateVariable::IInit()
 
 void plSimpleStateVariable::IDeAlloc()
 {
+    if (IIsFlat())
+        return;     // owned by the record's block
+
     int cnt = fVar.GetAtomicCount()*fVar.GetCount();
     int type = fVar.GetAtomicType();
     switch (type)
@@ -238,7 +241,11 @@ void plSimpleStateVariable::Alloc(int listSize)
     IInit();
     
     int cnt = fVar.GetAtomicCount()*fVar.GetCount();
-    if (cnt)
+    if (cnt && fFlat && plSDLLayout::IsFlatType(&fVar) && fVar.GetAtomicSize()*fVar.GetCount()==fFlatSize)
+    {
+        fBy = fFlat;
+    }
+    else if (cnt)
     {
         switch (fVar.GetAtomicType())
         {
@@ -303,6 +310,37 @@ void plSimpleStateVariable::Reset()
     }
 }
 
+//
+// A converted or resized var no longer matches its slot in the record's
+// value block, so give it private storage holding the current values.
+//
+void plSimpleStateVariable::IDetachFlat()
+{
+    if (!fFlat)
+        return;
+
+    bool wasFlat = IIsFlat();
+    std::vector<uint8_t> values;
+    if (wasFlat)
+        values.assign(fFlat, fFlat+fFlatSize);
+
+    uint32_t flags = fFlags;
+    plUnifiedTime timeStamp = fTimeStamp;
+
+    fFlat = nil;
+    fFlatSize = 0;
+    fFlatDefaults = nil;
+    if (wasFlat)
+    {
+        fBy = nil;
+        Alloc();
+        memcpy(fBy, &values[0], values.size());
+    }
+
+    fFlags = flags;
+    fTimeStamp = timeStamp;
+}
+
 //
 // Copy the descriptor settings and allocate list
 //
@@ -1172,6 +1210,8 @@ bool plSimpleStateVariable::ConvertTo(plSimpleVarDescriptor* toVar, bool force )
 {
     // NOTE: 'force' has no meaning here really, so it is not inforced.
 
+    IDetachFlat();
+
     plVarDescriptor::Type newType = toVar->GetType(); 
 
     int cnt = toVar->GetCount() ? toVar->GetCount() : fVar.GetCount();
@@ -1964,31 +2004,94 @@ bool plSimpleStateVariable::IReadData(hsStream* s, float timeConvert, int idx, u
 }
 #pragma optimize( "", on )  // restore optimizations to their defaults
 
-bool plSimpleStateVariable::WriteData(hsStream* s, float timeConvert, uint32_t writeOptions) const
+//
+// Plain data lists go through the stream's array calls in one go,
+// instead of one virtual read/write per element.
+//
+bool plSimpleStateVariable::IReadList(hsStream* s)
 {
-#ifdef HS_DEBUGGING
-    if (!IsUsed())
+    int i, cnt = fVar.GetAtomicCount()*fVar.GetCount();
+    switch(fVar.GetAtomicType())
     {
-        // hsAssert(false, "plSimpleStateVariable::WriteData Var doesn't contain data?");
-        plNetApp::StaticWarningMsg("plSimpleStateVariable::WriteData Var %s doesn't contain data?",
-            GetName());
+    case plVarDescriptor::kInt:
+        s->ReadLE32(cnt, (uint32_t*)fI);
+        return true;
+    case plVarDescriptor::kShort:
+        s->ReadLE16(cnt, (uint16_t*)fS);
+        return true;
+    case plVarDescriptor::kByte:
+        s->Read(cnt, fBy);
+        return true;
+    case plVarDescriptor::kFloat:
+        s->ReadLEScalar(cnt, fF);
+        return true;
+    case plVarDescriptor::kDouble:
+        s->ReadLEDouble(cnt, fD);
+        return true;
+    case plVarDescriptor::kBool:
+        s->Read(cnt, fBy);
+        for(i=0;i<cnt;i++)
+            fB[i] = (fBy[i]!=0);
+        return true;
+    case plVarDescriptor::kString32:
+        s->Read(cnt*sizeof(plVarDescriptor::String32), fS32);
+        return true;
+    default:
+        return false;
     }
-#endif
+}
 
-    // write base class data
-    plStateVariable::WriteData(s, timeConvert, writeOptions);   
+bool plSimpleStateVariable::IWriteList(hsStream* s) const
+{
+    int cnt = fVar.GetAtomicCount()*fVar.GetCount();
+    switch(fVar.GetAtomicType())
+    {
+    case plVarDescriptor::kInt:
+        s->WriteLE32(cnt, (const uint32_t*)fI);
+        return true;
+    case plVarDescriptor::kShort:
+        s->WriteLE16(cnt, (const uint16_t*)fS);
+        return true;
+    case plVarDescriptor::kByte:
+        s->Write(cnt, fBy);
+        return true;
+    case plVarDescriptor::kFloat:
+        s->WriteLEScalar(cnt, fF);
+        return true;
+    case plVarDescriptor::kDouble:
+        s->WriteLEDouble(cnt, fD);
+        return true;
+    case plVarDescriptor::kBool:
+        s->WriteBool(cnt, fB);
+        return true;
+    case plVarDescriptor::kString32:
+        s->Write(cnt*sizeof(plVarDescriptor::String32), fS32);
+        return true;
+    default:
+        return false;
+    }
+}
 
-    // check if the same as default
-    bool sameAsDefaults=false;
-    if (!GetVarDescriptor()->IsVariableLength())
+bool plSimpleStateVariable::ISameAsDefaults() const
+{
+    if (IIsFlat() && fFlatDefaults)
+    {
+        return IValuesEqual(fVar.GetAtomicType(), fBy, fFlatDefaults, 
+            fVar.GetAtomicCount()*fVar.GetCount());
+    }
+    else if (!GetVarDescriptor()->IsVariableLength())
     {
         plSimpleStateVariable def;
         def.fVar.CopyFrom(&fVar);   // copy descriptor
         def.Alloc();                // and rest
         def.SetFromDefaults(false /* timeStamp */);     // may do nothing if nor default
-        sameAsDefaults = (def == *this);
+        return (def == *this);
     }
+    return false;
+}
 
+uint8_t plSimpleStateVariable::IGetSaveFlags(uint32_t writeOptions, bool sameAsDefaults) const
+{
     bool writeTimeStamps = (writeOptions & plSDL::kWriteTimeStamps)!=0;
     bool writeDirtyFlags = (writeOptions & plSDL::kDontWriteDirtyFlag)==0;
     bool forceDirtyFlags = (writeOptions & plSDL::kMakeDirty)!=0;
@@ -1996,7 +2099,6 @@ bool plSimpleStateVariable::WriteData(hsStream* s, float timeConvert, uint32_t w
     bool needTimeStamp   = (writeOptions & plSDL::kTimeStampOnWrite)!=0;
     forceDirtyFlags = forceDirtyFlags || (!sameAsDefaults && (writeOptions & plSDL::kDirtyNonDefaults)!=0);
 
-    // write save flags
     uint8_t saveFlags = 0;
     saveFlags |= writeTimeStamps ? plSDL::kHasTimeStamp : 0;
     saveFlags |= forceDirtyFlags || (writeDirtyFlags && IsDirty()) ? plSDL::kHasDirtyFlag : 0;
@@ -2005,6 +2107,31 @@ bool plSimpleStateVariable::WriteData(hsStream* s, float timeConvert, uint32_t w
 
     if (sameAsDefaults)
         saveFlags |= plSDL::kSameAsDefault;
+    return saveFlags;
+}
+
+bool plSimpleStateVariable::WriteData(hsStream* s, float timeConvert, uint32_t writeOptions) const
+{
+#ifdef HS_DEBUGGING
+    if (!IsUsed())
+    {
+        // hsAssert(false, "plSimpleStateVariable::WriteData Var doesn't contain data?");
+        plNetApp::StaticWarningMsg("plSimpleStateVariable::WriteData Var %s doesn't contain data?",
+            GetName());
+    }
+#endif
+
+    // write base class data
+    plStateVariable::WriteData(s, timeConvert, writeOptions);   
+
+    // check if the same as default
+    bool sameAsDefaults=ISameAsDefaults();
+
+    bool writeTimeStamps = (writeOptions & plSDL::kWriteTimeStamps)!=0;
+    bool needTimeStamp   = (writeOptions & plSDL::kTimeStampOnWrite)!=0;
+
+    // write save flags
+    uint8_t saveFlags = IGetSaveFlags(writeOptions, sameAsDefaults);
     s->WriteLE(saveFlags);
     
     if (needTimeStamp) {
@@ -2025,10 +2152,13 @@ bool plSimpleStateVariable::WriteData(hsStream* s, float timeConvert, uint32_t w
             s->WriteLE32(GetVarDescriptor()->GetCount());     // have to write out as long since we don't know how big the list is
 
         // list
-        int i;
-        for(i=0;i<fVar.GetCount();i++)
-            if (!IWriteData(s, timeConvert, i, writeOptions))
-                return false;
+        if (!IWriteList(s))
+        {
+            int i;
+            for(i=0;i<fVar.GetCount();i++)
+                if (!IWriteData(s, timeConvert, i, writeOptions))
+                    return false;
+        }
     }
 
     return true;
@@ -2091,10 +2221,17 @@ bool plSimpleStateVariable::ReadData(hsStream* s, float timeConvert, uint32_t re
     // read list
     if (!(saveFlags & plSDL::kSameAsDefault))
     {
-        int i;
-        for(i=0;i<fVar.GetCount();i++)
-            if (!IReadData(s, timeConvert, i, readOptions))
-                return false;
+        if (!IReadList(s))
+        {
+            int i;
+            for(i=0;i<fVar.GetCount();i++)
+                if (!IReadData(s, timeConvert, i, readOptions))
+                    return false;
+        }
+    }
+    else if (IIsFlat() && fFlatDefaults)
+    {
+        memcpy(fFlat, fFlatDefaults, fFlatSize);
     }
     else
     {
@@ -2191,6 +2328,49 @@ case type:  \
             return false;   \
     break;  
 
+//
+// Same result as operator== on two value arrays of the given atomic type.
+// Identical bytes are always equal; floats and strings fall back to a
+// value compare so +0/-0 and case differences behave as before.
+//
+bool plSimpleStateVariable::IValuesEqual(int atomicType, const void* a, const void* b, int cnt)
+{
+    int i;
+    switch(atomicType)
+    {
+    case plVarDescriptor::kInt:
+        return !memcmp(a, b, cnt*sizeof(int));
+    case plVarDescriptor::kShort:
+        return !memcmp(a, b, cnt*sizeof(short));
+    case plVarDescriptor::kByte:
+        return !memcmp(a, b, cnt*sizeof(uint8_t));
+    case plVarDescriptor::kBool:
+        return !memcmp(a, b, cnt*sizeof(bool));
+    case plVarDescriptor::kFloat:
+        if (!memcmp(a, b, cnt*sizeof(float)))
+            return true;
+        for(i=0;i<cnt;i++)
+            if (((const float*)a)[i] != ((const float*)b)[i])
+                return false;
+        return true;
+    case plVarDescriptor::kDouble:
+        if (!memcmp(a, b, cnt*sizeof(double)))
+            return true;
+        for(i=0;i<cnt;i++)
+            if (((const double*)a)[i] != ((const double*)b)[i])
+                return false;
+        return true;
+    case plVarDescriptor::kString32:
+        for(i=0;i<cnt;i++)
+            if (stricmp(((const plVarDescriptor::String32*)a)[i], ((const plVarDescriptor::String32*)b)[i]))
+                return false;
+        return true;
+    default:
+        hsAssert(false, "invalid atomic type");
+        return false;
+    }
+}
+
 bool plSimpleStateVariable::operator==(const plSimpleStateVariable &other) const
 {
     hsAssert(fVar.GetType() == other.GetVarDescriptor()->GetType(), "type mismatch in equality check");
@@ -2202,6 +2382,9 @@ bool plSimpleStateVariable::operator==(const plSimpleStateVariable &other) const
 
     int i;
     int cnt = fVar.GetAtomicCount()*fVar.GetCount();
+    if (IIsFlat() && other.IIsFlat())
+        return IValuesEqual(fVar.GetAtomicType(), fBy, other.fBy, cnt);
+
     switch(fVar.GetAtomicType())
     {
         EQ_CHECK(plVarDescriptor::kAgeTimeOfDay, fF)
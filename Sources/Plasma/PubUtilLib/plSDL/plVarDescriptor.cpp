@@ -214,7 +214,8 @@ void plVarDescriptor::Write(hsStream* s) const
 
 plSimpleVarDescriptor::plSimpleVarDescriptor() :
     fAtomicType(kNone),
-    fAtomicCount(1)
+    fAtomicCount(1),
+    fQuantum(0)
 {   
 
 }
@@ -353,6 +354,7 @@ void plSimpleVarDescriptor::CopyFrom(const plSimpleVarDescriptor* other)
 
     fAtomicCount=other->GetAtomicCount();
     fAtomicType=other->GetAtomicType();
+    fQuantum=other->GetQuantum();
 }
 
 //
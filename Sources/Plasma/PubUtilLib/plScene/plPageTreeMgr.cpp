@@ -56,7 +56,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include "plTweak.h"
 
-static hsTArray<hsRadixSortElem> scratchList;
+static hsFastArray<hsRadixSortElem> scratchList;
 
 bool plPageTreeMgr::fDisableVisMgr = 0;
 
@@ -260,10 +260,14 @@ bool plPageTreeMgr::ISortByLevel(plPipeline* pipe, hsTArray<plDrawVisList>& draw
 
     listTrav = sortedList;
 
+    // drawList is done with once it's sorted, so hand the vis lists over
+    // instead of copying them. The old ones go back to drawList to be reused.
     while( listTrav )
     {
         plDrawVisList& drawVis = *(plDrawVisList*)listTrav->fBody;
-        sortedDrawList.Append(drawVis);
+        plDrawVisList* sorted = sortedDrawList.Push();
+        sorted->fDrawable = drawVis.fDrawable;
+        sorted->fVisList.Swap(drawVis.fVisList);
         
         listTrav = listTrav->fNext;
     }
@@ -280,8 +284,8 @@ int plPageTreeMgr::IPrepForRenderSortingSpans(plPipeline* pipe, hsTArray<plDrawV
 
     int i;
 
-    static hsTArray<plDrawVisList*> drawables;
-    static hsTArray<plDrawSpanPair> pairs;
+    static hsFastArray<plDrawVisList*> drawables;
+    static hsFastArray<plDrawSpanPair> pairs;
 
     // Given the input drawVisList (list of drawable/visList pairs), we make two new
     // lists. The list "drawables" is just the excerpted sub-list from drawVis starting
@@ -331,7 +335,7 @@ int plPageTreeMgr::IPrepForRenderSortingSpans(plPipeline* pipe, hsTArray<plDrawV
     return numDrawn;
 }
 
-bool plPageTreeMgr::IRenderSortingSpans(plPipeline* pipe, hsTArray<plDrawVisList*>& drawList, hsTArray<plDrawSpanPair>& pairs)
+bool plPageTreeMgr::IRenderSortingSpans(plPipeline* pipe, hsFastArray<plDrawVisList*>& drawList, hsFastArray<plDrawSpanPair>& pairs)
 {
 
     if( !pairs.GetCount() )
@@ -449,7 +453,7 @@ bool plPageTreeMgr::IRenderSortingSpans(plPipeline* pipe, hsTArray<plDrawVisList
     int curDraw = curPair.fDrawable;
     listTrav = listTrav->fNext;
 
-    static hsTArray<uint32_t> numDrawn;
+    static hsFastArray<uint32_t> numDrawn;
     numDrawn.SetCountAndZero(drawList.GetCount());
 
     visList.Append(drawList[curDraw]->fVisList[numDrawn[curDraw]++]);
@@ -44,6 +44,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 #define plPageTreeMgr_inc
 
 #include "hsTemplates.h"
+#include "hsFastArray.h"
 
 class plSceneNode;
 class plSpaceTree;
@@ -101,7 +102,7 @@ protected:
 
     bool                        ISortByLevel(plPipeline* pipe, hsTArray<plDrawVisList>& drawList, hsTArray<plDrawVisList>& sortedDrawList);
     int                         IPrepForRenderSortingSpans(plPipeline* pipe, hsTArray<plDrawVisList>& drawVis, int& iDrawStart);
-    bool                        IRenderSortingSpans(plPipeline* pipe, hsTArray<plDrawVisList*>& drawList, hsTArray<plDrawSpanPair>& pairs);
+    bool                        IRenderSortingSpans(plPipeline* pipe, hsFastArray<plDrawVisList*>& drawList, hsFastArray<plDrawSpanPair>& pairs);
     int                         IRenderVisList(plPipeline* pipe, hsTArray<plDrawVisList>& visList);
 
 public:
@@ -0,0 +1,421 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#include "HeadSpin.h"
+#include "plSoftwareSkin.h"
+
+#include "hsGeometry3.h"
+#include "hsMatrix44.h"
+#include "hsThread.h"
+
+#include "plPipeline/plGBufferGroup.h"
+#include "plDrawable/plGeometrySpan.h"
+
+#ifdef HS_SIMD_INCLUDE
+#  include HS_SIMD_INCLUDE
+#endif
+
+hsFunctionDispatcher<plSoftwareSkin::blend_verts_ptr> plSoftwareSkin::blend_verts(plSoftwareSkin::blend_verts_fpu, plSoftwareSkin::blend_verts_sse1);
+
+//// Vertex Layout ////////////////////////////////////////////////////////////
+
+namespace
+{
+    struct plSkinLayout
+    {
+        int         fNumWeights;
+        bool        fHasIndices;
+        uint32_t    fUVChanSize;
+        uint8_t     fNumUVs;
+
+        plSkinLayout(uint8_t format)
+        {
+            switch( format & plGBufferGroup::kSkinWeightMask )
+            {
+                case plGBufferGroup::kSkin1Weight:  fNumWeights = 1; break;
+                case plGBufferGroup::kSkin2Weights: fNumWeights = 2; break;
+                case plGBufferGroup::kSkin3Weights: fNumWeights = 3; break;
+                default: hsAssert( false, "Invalid weight count in plSoftwareSkin" ); fNumWeights = 0; break;
+            }
+            fHasIndices = 0 != (format & plGBufferGroup::kSkinIndices);
+            fNumUVs = plGBufferGroup::CalcNumUVs( format );
+            fUVChanSize = fNumUVs * sizeof( float ) * 3;
+        }
+    };
+
+    struct plSkinVert
+    {
+        hsPoint3    fPos;
+        float       fWeights[4];
+        uint32_t    fIndices;
+        hsVector3   fNorm;
+        uint32_t    fColor;
+        uint32_t    fSpecColor;
+        const uint8_t* fUVWs;
+    };
+}
+
+static inline const uint8_t* IExtractVert( const uint8_t* src, const plSkinLayout& layout, plSkinVert& v )
+{
+    const float* f = (const float*)src;
+    v.fPos.Set( f[0], f[1], f[2] );
+    f += 3;
+
+    float weightSum = 0;
+    int j;
+    for( j = 0; j < layout.fNumWeights; j++ )
+    {
+        v.fWeights[j] = *f++;
+        weightSum += v.fWeights[j];
+    }
+    v.fWeights[j] = 1 - weightSum;
+    for( j++; j < 4; j++ )
+        v.fWeights[j] = 0;
+
+    if( layout.fHasIndices )
+        v.fIndices = *(const uint32_t*)f++;
+    else
+        v.fIndices = 1 << 8;
+
+    v.fNorm.Set( f[0], f[1], f[2] );
+    f += 3;
+    v.fColor = *(const uint32_t*)f++;
+    v.fSpecColor = *(const uint32_t*)f++;
+
+    v.fUVWs = (const uint8_t*)f;
+    return v.fUVWs;
+}
+
+static inline uint8_t* IStuffVert( uint8_t* dest, const float* pos, const float* norm, const plSkinVert& v )
+{
+    float* f = (float*)dest;
+    *f++ = pos[0];
+    *f++ = pos[1];
+    *f++ = pos[2];
+    *f++ = norm[0];
+    *f++ = norm[1];
+    *f++ = norm[2];
+    *(uint32_t*)f++ = v.fColor;
+    *(uint32_t*)f++ = v.fSpecColor;
+    return (uint8_t*)f;
+}
+
+//// FPU Version //////////////////////////////////////////////////////////////
+// Transform by each bone and sum the weighted results.
+
+static inline void IMulPointAdd( const hsMatrix44& xfm, float wgt, const hsScalarTriple& src, hsScalarTriple& dst )
+{
+    dst.fX += (src.fX * xfm.fMap[0][0] + src.fY * xfm.fMap[0][1] + src.fZ * xfm.fMap[0][2] + xfm.fMap[0][3]) * wgt;
+    dst.fY += (src.fX * xfm.fMap[1][0] + src.fY * xfm.fMap[1][1] + src.fZ * xfm.fMap[1][2] + xfm.fMap[1][3]) * wgt;
+    dst.fZ += (src.fX * xfm.fMap[2][0] + src.fY * xfm.fMap[2][1] + src.fZ * xfm.fMap[2][2] + xfm.fMap[2][3]) * wgt;
+}
+
+static inline void IMulVectorAdd( const hsMatrix44& xfm, float wgt, const hsScalarTriple& src, hsScalarTriple& dst )
+{
+    dst.fX += (src.fX * xfm.fMap[0][0] + src.fY * xfm.fMap[0][1] + src.fZ * xfm.fMap[0][2]) * wgt;
+    dst.fY += (src.fX * xfm.fMap[1][0] + src.fY * xfm.fMap[1][1] + src.fZ * xfm.fMap[1][2]) * wgt;
+    dst.fZ += (src.fX * xfm.fMap[2][0] + src.fY * xfm.fMap[2][1] + src.fZ * xfm.fMap[2][2]) * wgt;
+}
+
+void plSoftwareSkin::blend_verts_fpu( const hsMatrix44* matrixPalette, int numMatrices,
+                                      const uint8_t* src, uint8_t format, uint32_t srcStride,
+                                      uint8_t* dest, uint32_t destStride, uint32_t count,
+                                      uint16_t localUVWChans )
+{
+    const plSkinLayout layout(format);
+
+    // localUVWChans is bump mapping tangent space vectors, which need to
+    // be skinned like the normal, as opposed to passed through like
+    // garden variety UVW coordinates.
+    const uint8_t hiChan = localUVWChans >> 8;
+    const uint8_t loChan = localUVWChans & 0xff;
+
+    plSkinVert v;
+    hsPoint3 destPt;
+    hsVector3 destNorm;
+    hsVector3 srcUVWs[plGeometrySpan::kMaxNumUVChannels];
+    hsVector3 dstUVWs[plGeometrySpan::kMaxNumUVChannels];
+
+    uint32_t i;
+    for( i = 0; i < count; i++ )
+    {
+        IExtractVert( src + i * srcStride, layout, v );
+
+        if( localUVWChans )
+        {
+            memcpy( srcUVWs, v.fUVWs, layout.fUVChanSize );
+            memcpy( dstUVWs, srcUVWs, layout.fUVChanSize );
+            dstUVWs[loChan].Set(0,0,0);
+            dstUVWs[hiChan].Set(0,0,0);
+        }
+
+        destPt.Set( 0, 0, 0 );
+        destNorm.Set( 0, 0, 0 );
+        uint32_t indices = v.fIndices;
+        int j;
+        for( j = 0; j < layout.fNumWeights + 1; j++ )
+        {
+            if( v.fWeights[j] )
+            {
+                const hsMatrix44& xfm = matrixPalette[indices & 0xff];
+                IMulPointAdd( xfm, v.fWeights[j], v.fPos, destPt );
+                IMulVectorAdd( xfm, v.fWeights[j], v.fNorm, destNorm );
+                if( localUVWChans )
+                {
+                    IMulVectorAdd( xfm, v.fWeights[j], srcUVWs[loChan], dstUVWs[loChan] );
+                    IMulVectorAdd( xfm, v.fWeights[j], srcUVWs[hiChan], dstUVWs[hiChan] );
+                }
+            }
+            indices >>= 8;
+        }
+        // Probably don't really need to renormalize this. There errors are
+        // going to be subtle and "smooth".
+
+        uint8_t* d = IStuffVert( dest + i * destStride, &destPt.fX, &destNorm.fX, v );
+        memcpy( d, localUVWChans ? (const uint8_t*)dstUVWs : v.fUVWs, layout.fUVChanSize );
+    }
+}
+
+//// SSE Version //////////////////////////////////////////////////////////////
+// Blend the (up to 4) bone matrices by their weights first, then make a
+// single transform of the point and normal by the result. Since the
+// transform is linear that's the same answer, but with one matrix blend
+// instead of a full transform per bone, and all of it 4 wide.
+
+void plSoftwareSkin::blend_verts_sse1( const hsMatrix44* matrixPalette, int numMatrices,
+                                       const uint8_t* src, uint8_t format, uint32_t srcStride,
+                                       uint8_t* dest, uint32_t destStride, uint32_t count,
+                                       uint16_t localUVWChans )
+{
+#ifdef HS_SSE1
+    // Tangent space vectors are rare enough (none in shipping assets) that
+    // there's no point in a special path for them.
+    if( localUVWChans )
+    {
+        blend_verts_fpu( matrixPalette, numMatrices, src, format, srcStride, dest, destStride, count, localUVWChans );
+        return;
+    }
+
+    const plSkinLayout layout(format);
+
+    plSkinVert v;
+    float pos[4];
+    float norm[4];
+
+    uint32_t i;
+    for( i = 0; i < count; i++ )
+    {
+        IExtractVert( src + i * srcStride, layout, v );
+
+        __m128 r0 = _mm_setzero_ps();
+        __m128 r1 = _mm_setzero_ps();
+        __m128 r2 = _mm_setzero_ps();
+        __m128 r3 = _mm_setzero_ps();
+
+        uint32_t indices = v.fIndices;
+        int j;
+        for( j = 0; j < layout.fNumWeights + 1; j++ )
+        {
+            if( v.fWeights[j] )
+            {
+                const hsMatrix44& xfm = matrixPalette[indices & 0xff];
+                const __m128 wgt = _mm_set1_ps(v.fWeights[j]);
+                r0 = _mm_add_ps(r0, _mm_mul_ps(_mm_loadu_ps(xfm.fMap[0]), wgt));
+                r1 = _mm_add_ps(r1, _mm_mul_ps(_mm_loadu_ps(xfm.fMap[1]), wgt));
+                r2 = _mm_add_ps(r2, _mm_mul_ps(_mm_loadu_ps(xfm.fMap[2]), wgt));
+            }
+            indices >>= 8;
+        }
+
+        // Rows to columns, so the transform is 3 multiply-adds.
+        _MM_TRANSPOSE4_PS(r0, r1, r2, r3);
+
+        const __m128 px = _mm_set1_ps(v.fPos.fX);
+        const __m128 py = _mm_set1_ps(v.fPos.fY);
+        const __m128 pz = _mm_set1_ps(v.fPos.fZ);
+        _mm_storeu_ps(pos, _mm_add_ps(_mm_add_ps(_mm_mul_ps(r0, px), _mm_mul_ps(r1, py)),
+                                      _mm_add_ps(_mm_mul_ps(r2, pz), r3)));
+
+        const __m128 nx = _mm_set1_ps(v.fNorm.fX);
+        const __m128 ny = _mm_set1_ps(v.fNorm.fY);
+        const __m128 nz = _mm_set1_ps(v.fNorm.fZ);
+        _mm_storeu_ps(norm, _mm_add_ps(_mm_add_ps(_mm_mul_ps(r0, nx), _mm_mul_ps(r1, ny)),
+                                       _mm_mul_ps(r2, nz)));
+
+        uint8_t* d = IStuffVert( dest + i * destStride, pos, norm, v );
+        memcpy( d, v.fUVWs, layout.fUVChanSize );
+    }
+#endif // HS_SSE1
+}
+
+bool plSoftwareSkin::HasSSE1()
+{
+#ifdef HS_SSE1
+    return hsCpuId::instance().has_sse1;
+#else
+    return false;
+#endif
+}
+
+//// Threaded Blending ////////////////////////////////////////////////////////
+// Unlike plCluster::UnPackJobs, which starts threads per call at load time,
+// skinning happens every frame, so the threads stay up waiting on their
+// start event. Each one gets a contiguous range of the span. The ranges
+// don't overlap in source or destination, so the start/done handshake is
+// the only synchronization.
+
+class plSoftwareSkinThread : public hsThread
+{
+public:
+    const hsMatrix44*   fPalette;
+    int                 fNumMatrices;
+    const uint8_t*      fSrc;
+    uint8_t             fFormat;
+    uint32_t            fSrcStride;
+    uint8_t*            fDest;
+    uint32_t            fDestStride;
+    uint32_t            fCount;
+    uint16_t            fLocalUVWChans;
+
+    hsEvent             fStartEvent;
+    hsEvent             fDoneEvent;
+
+    virtual hsError Run()
+    {
+        for( ;; )
+        {
+            fStartEvent.Wait();
+            if( GetQuit() )
+                break;
+            plSoftwareSkin::BlendVerts( fPalette, fNumMatrices, fSrc, fFormat, fSrcStride,
+                                        fDest, fDestStride, fCount, fLocalUVWChans );
+            fDoneEvent.Signal();
+        }
+        return hsOK;
+    }
+
+    virtual void Stop()
+    {
+        SetQuit( true );
+        fStartEvent.Signal();
+        hsThread::Stop();
+    }
+};
+
+int plSoftwareSkin::fNumThreads = 2;
+
+static hsTArray<plSoftwareSkinThread*> sSkinThreads;
+static hsMutex sSkinThreadLock;     // One threaded blend at a time
+
+void plSoftwareSkin::SetNumThreads( int n )
+{
+    hsTempMutexLock lock( sSkinThreadLock );
+    IStopThreads();
+    fNumThreads = n < 0 ? 0 : ( n > kMaxThreads ? kMaxThreads : n );
+}
+
+// Caller holds sSkinThreadLock
+void plSoftwareSkin::IStartThreads()
+{
+    int i;
+    for( i = sSkinThreads.GetCount(); i < fNumThreads; i++ )
+    {
+        plSoftwareSkinThread* thread = new plSoftwareSkinThread;
+        thread->Start();
+        sSkinThreads.Append( thread );
+    }
+}
+
+void plSoftwareSkin::IStopThreads()
+{
+    hsTempMutexLock lock( sSkinThreadLock );
+    int i;
+    for( i = 0; i < sSkinThreads.GetCount(); i++ )
+    {
+        sSkinThreads[i]->Stop();
+        delete sSkinThreads[i];
+    }
+    sSkinThreads.Reset();
+}
+
+void plSoftwareSkin::BlendVertsThreaded( const hsMatrix44* matrixPalette, int numMatrices,
+                                         const uint8_t* src, uint8_t format, uint32_t srcStride,
+                                         uint8_t* dest, uint32_t destStride, uint32_t count,
+                                         uint16_t localUVWChans )
+{
+    if( !fNumThreads || ( count < kMinThreadedVerts ) )
+    {
+        BlendVerts( matrixPalette, numMatrices, src, format, srcStride, dest, destStride, count, localUVWChans );
+        return;
+    }
+
+    hsTempMutexLock lock( sSkinThreadLock );
+    IStartThreads();
+
+    // Keep every range worth the handoff.
+    int numHelpers = hsMinimum( (int)sSkinThreads.GetCount(), (int)( count / ( kMinThreadedVerts / 2 ) ) - 1 );
+    const uint32_t perRange = count / ( numHelpers + 1 );
+    uint32_t start = count - perRange * numHelpers;   // ours, plus the remainder
+
+    int i;
+    for( i = 0; i < numHelpers; i++ )
+    {
+        plSoftwareSkinThread* thread = sSkinThreads[i];
+        thread->fPalette = matrixPalette;
+        thread->fNumMatrices = numMatrices;
+        thread->fSrc = src + start * srcStride;
+        thread->fFormat = format;
+        thread->fSrcStride = srcStride;
+        thread->fDest = dest + start * destStride;
+        thread->fDestStride = destStride;
+        thread->fCount = perRange;
+        thread->fLocalUVWChans = localUVWChans;
+        thread->fStartEvent.Signal();
+        start += perRange;
+    }
+
+    BlendVerts( matrixPalette, numMatrices, src, format, srcStride, dest, destStride,
+                count - perRange * numHelpers, localUVWChans );
+
+    for( i = 0; i < numHelpers; i++ )
+        sSkinThreads[i]->fDoneEvent.Wait();
+}
@@ -0,0 +1,124 @@
+/*==LICENSE==*
+
+CyanWorlds.com Engine - MMOG client, server and tools
+Copyright (C) 2011  Cyan Worlds, Inc.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Additional permissions under GNU GPL version 3 section 7
+
+If you modify this Program, or any covered work, by linking or
+combining it with any of RAD Game Tools Bink SDK, Autodesk 3ds Max SDK,
+NVIDIA PhysX SDK, Microsoft DirectX SDK, OpenSSL library, Independent
+JPEG Group JPEG library, Microsoft Windows Media SDK, or Apple QuickTime SDK
+(or a modified version of those libraries),
+containing parts covered by the terms of the Bink SDK EULA, 3ds Max EULA,
+PhysX SDK EULA, DirectX SDK EULA, OpenSSL and SSLeay licenses, IJG
+JPEG Library README, Windows Media SDK EULA, or QuickTime SDK EULA, the
+licensors of this Program grant you additional
+permission to convey the resulting work. Corresponding Source for a
+non-source form of such a combination shall include the source code for
+the parts of OpenSSL and IJG JPEG Library used as well as that of the covered
+work.
+
+You can contact Cyan Worlds, Inc. by email legal@cyan.com
+ or by snail mail at:
+      Cyan Worlds, Inc.
+      14617 N Newport Hwy
+      Mead, WA   99021
+
+*==LICENSE==*/
+
+#ifndef plSoftwareSkin_inc
+#define plSoftwareSkin_inc
+
+#include "HeadSpin.h"
+#include "hsCpuID.h"
+
+struct hsMatrix44;
+
+// plSoftwareSkin - CPU matrix palette skinning, independent of any
+// particular pipeline or device buffer.
+//
+// Takes verts in plGBufferGroup's skinned layout (position, 1-3 weights,
+// optional packed uint8_t indices, normal, diffuse, specular, uvws) and
+// writes the same verts with the weights and indices stripped, position
+// and normal blended by up to 4 bones out of the palette. Without
+// indices, bone 0 and bone 1 are used.
+//
+// BlendVerts only touches the count verts handed to it and keeps no
+// state, so a span can be split into ranges and blended from several
+// threads. BlendVertsThreaded does that for big spans, on a few threads
+// that are started once and kept waiting, since this runs every frame.
+class plSoftwareSkin
+{
+public:
+    static void BlendVerts(const hsMatrix44* matrixPalette, int numMatrices,
+                           const uint8_t* src, uint8_t format, uint32_t srcStride,
+                           uint8_t* dest, uint32_t destStride, uint32_t count,
+                           uint16_t localUVWChans)
+        { blend_verts.call(matrixPalette, numMatrices, src, format, srcStride, dest, destStride, count, localUVWChans); }
+
+    // Straight FPU version, bone by bone. This is the reference the
+    // SIMD versions are expected to match (to within float rounding).
+    static void BlendVertsRef(const hsMatrix44* matrixPalette, int numMatrices,
+                              const uint8_t* src, uint8_t format, uint32_t srcStride,
+                              uint8_t* dest, uint32_t destStride, uint32_t count,
+                              uint16_t localUVWChans)
+        { blend_verts_fpu(matrixPalette, numMatrices, src, format, srcStride, dest, destStride, count, localUVWChans); }
+
+    // The SSE1 version on its own, for checking against BlendVertsRef.
+    // Does nothing unless HasSSE1().
+    static void BlendVertsSSE1(const hsMatrix44* matrixPalette, int numMatrices,
+                               const uint8_t* src, uint8_t format, uint32_t srcStride,
+                               uint8_t* dest, uint32_t destStride, uint32_t count,
+                               uint16_t localUVWChans)
+        { blend_verts_sse1(matrixPalette, numMatrices, src, format, srcStride, dest, destStride, count, localUVWChans); }
+    static bool HasSSE1();
+
+    // Like BlendVerts, but spans of kMinThreadedVerts or more are cut into
+    // one range per thread, with the calling thread taking the first.
+    // Returns when all of it is done.
+    static void BlendVertsThreaded(const hsMatrix44* matrixPalette, int numMatrices,
+                                   const uint8_t* src, uint8_t format, uint32_t srcStride,
+                                   uint8_t* dest, uint32_t destStride, uint32_t count,
+                                   uint16_t localUVWChans);
+
+    enum
+    {
+        kMinThreadedVerts   = 4096, // Below this the handoff costs more than it saves
+        kMaxThreads         = 7     // Extra threads, not counting the caller
+    };
+
+    // Extra threads to help with big spans, 0 for none. Changing it (or
+    // Shutdown) stops the current threads; new ones start on next use.
+    static void SetNumThreads(int n);
+    static int GetNumThreads() { return fNumThreads; }
+    static void Shutdown() { IStopThreads(); }
+
+protected:
+    static int  fNumThreads;
+
+    static void IStartThreads();
+    static void IStopThreads();
+
+    //  CPU-optimized functions
+protected:
+    typedef void(*blend_verts_ptr)(const hsMatrix44*, int, const uint8_t*, uint8_t, uint32_t, uint8_t*, uint32_t, uint32_t, uint16_t);
+    static void blend_verts_fpu(const hsMatrix44*, int, const uint8_t*, uint8_t, uint32_t, uint8_t*, uint32_t, uint32_t, uint16_t);
+    static void blend_verts_sse1(const hsMatrix44*, int, const uint8_t*, uint8_t, uint32_t, uint8_t*, uint32_t, uint32_t, uint16_t);
+    static hsFunctionDispatcher<blend_verts_ptr> blend_verts;
+};
+
+#endif // plSoftwareSkin_inc
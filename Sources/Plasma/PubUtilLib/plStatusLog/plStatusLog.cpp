@@ -57,6 +57,7 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
 
 #include <stdarg.h>
 #include <stdlib.h>
+#include <new>
 #include "hsThread.h"
 #include "hsTemplates.h"
 #include "hsTimer.h"
@@ -74,6 +75,342 @@ You can contact Cyan Worlds, Inc. by email legal@cyan.com
     #include <Shlobj.h>
 #endif
 
+//////////////////////////////////////////////////////////////////////////////
+//// plStatusLogRecord ///////////////////////////////////////////////////////
+//  One queued line (or command) for the writer. Anything the file output
+//  needs from the moment the line was logged (times, thread) is captured
+//  here; the formatting happens on the writer. In the writer's ring the
+//  text follows the record, so a record only takes as much room as its line.
+
+class plStatusLogRecord
+{
+    public:
+
+        enum Type
+        {
+            kLine,
+            kCloseFile,
+            kWrap       // Ring only: the rest of the ring is unused, go back to the start
+        };
+
+        enum
+        {
+            kMaxLineLen = 2000
+        };
+
+        plStatusLog         *fLog;
+        uint8_t             fType;
+        uint32_t            fCount;
+        uint32_t            fSize;      // Bytes this record takes in the ring
+        const char          *fLine;
+        plUnifiedTime       fTime;
+        double              fRawTime;
+        hsThread::ThreadId  fThreadId;
+
+        void    Set( plStatusLog *log, uint8_t type, const char *line, uint32_t count );
+
+        static uint32_t ClampCount( uint32_t count ) { return count >= kMaxLineLen ? kMaxLineLen - 1 : count; }
+        static uint32_t RingSize( uint32_t count )
+        {
+            uint32_t size = sizeof( plStatusLogRecord ) + ClampCount( count ) + 1;
+            return ( size + sizeof( double ) - 1 ) & ~( sizeof( double ) - 1 );
+        }
+};
+
+// Doesn't copy the line, fLine points at the caller's text
+void    plStatusLogRecord::Set( plStatusLog *log, uint8_t type, const char *line, uint32_t count )
+{
+    fLog = log;
+    fType = type;
+    fLine = line;
+    fCount = ClampCount( count );
+
+    uint32_t flags = log->fFlags;
+    if( flags & ( plStatusLog::kTimestamp | plStatusLog::kTimestampGMT | plStatusLog::kTimeInSeconds | plStatusLog::kTimeAsDouble ) )
+        fTime.ToCurrentTime();
+    if( flags & plStatusLog::kRawTimeStamp )
+        fRawTime = hsTimer::GetSeconds();
+    if( flags & plStatusLog::kThreadID )
+        fThreadId = hsThread::GetMyThreadId();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+//// plStatusLogWriter ///////////////////////////////////////////////////////
+//  Drains a fixed byte ring of records to the log files in order. There's
+//  one queue for every log, so lines come out in the order they were logged,
+//  across logs and threads. Producers only block when the ring is full.
+//  Files are flushed once per drained batch instead of once per line.
+
+class plStatusLogWriter : public hsThread
+{
+    protected:
+
+        enum
+        {
+            kRingSize       = 64 * 1024,
+            kWakeThreshold  = kRingSize / 4,    // Wake early when the ring is filling up
+            kFlushInterval  = 100,              // ms
+            kCrashWait      = 500               // ms to let a busy writer finish before going around it
+        };
+
+        uint8_t             *fRing;
+        uint32_t            fHead;      // Offset of the next record to write
+        uint32_t            fTail;      // Offset of the next free byte
+        uint32_t            fUsed;      // Bytes between fHead and fTail, counting wrap waste
+        bool                fRunning;
+
+        hsMutex             fQueueLock; // Guards fHead/fTail/fUsed
+        hsMutex             fDrainLock; // One drainer at a time, also guards fDirty
+        hsEvent             fWorkEvent;
+        hsEvent             fSpaceEvent;
+
+        hsTArray<plStatusLog *> fDirty; // Written since the last flush
+
+        plStatusLogRecord   *IAt( uint32_t offset ) const { return (plStatusLogRecord *)( fRing + offset ); }
+        bool        IReserve( uint32_t size, uint32_t &offset );
+        bool        INextRecord( uint32_t &head, plStatusLogRecord *&rec );
+        void        IWrite( plStatusLogRecord &rec );
+        void        IDrain( void );
+        void        IDrainCrashing( void );
+
+    public:
+
+        plStatusLogWriter();
+        virtual ~plStatusLogWriter();
+
+        void    Push( plStatusLog *log, uint8_t type, const char *line, uint32_t count );
+        void    Flush( bool crashing );
+
+        virtual hsError Run( void );
+        virtual void    Start( void );
+        virtual void    Stop( void );
+};
+
+plStatusLogWriter::plStatusLogWriter()
+{
+    fRing = new uint8_t[ kRingSize ];
+    fHead = fTail = fUsed = 0;
+    fRunning = false;
+}
+
+plStatusLogWriter::~plStatusLogWriter()
+{
+    Stop();
+    delete [] fRing;
+}
+
+void    plStatusLogWriter::Start( void )
+{
+    fRunning = true;
+    hsThread::Start();
+}
+
+void    plStatusLogWriter::Stop( void )
+{
+    if( fRunning )
+    {
+        SetQuit( true );
+        fWorkEvent.Signal();
+        hsThread::Stop();
+        fRunning = false;
+    }
+    Flush( false );
+}
+
+// Called with fQueueLock held. Finds room for size contiguous bytes, marking
+// the end of the ring as a wrap if the record won't fit there.
+bool    plStatusLogWriter::IReserve( uint32_t size, uint32_t &offset )
+{
+    uint32_t waste = 0;
+    if( fTail + size > kRingSize )
+        waste = kRingSize - fTail;
+    if( fUsed + waste + size > kRingSize )
+        return false;
+
+    if( waste )
+    {
+        // A gap too small for a record header is skipped by the reader anyway
+        if( waste >= sizeof( plStatusLogRecord ) )
+        {
+            plStatusLogRecord *wrap = new( IAt( fTail ) ) plStatusLogRecord;
+            wrap->fType = plStatusLogRecord::kWrap;
+        }
+        fUsed += waste;
+        fTail = 0;
+    }
+
+    offset = fTail;
+    fTail = ( fTail + size ) % kRingSize;
+    fUsed += size;
+    return true;
+}
+
+void    plStatusLogWriter::Push( plStatusLog *log, uint8_t type, const char *line, uint32_t count )
+{
+    uint32_t size = plStatusLogRecord::RingSize( count );
+    uint32_t offset;
+
+    fQueueLock.Lock();
+    while( !IReserve( size, offset ) )
+    {
+        fQueueLock.Unlock();
+        if( fRunning )
+        {
+            fWorkEvent.Signal();
+            fSpaceEvent.Wait( kFlushInterval );
+        }
+        else
+            Flush( false );
+        fQueueLock.Lock();
+    }
+
+    // The reader won't look past fTail until we're done, but a second
+    // producer can't be let in before the record is filled, so fill it here.
+    plStatusLogRecord *rec = new( IAt( offset ) ) plStatusLogRecord;
+    char *text = (char *)( rec + 1 );
+    rec->Set( log, type, text, count );
+    rec->fSize = size;
+    memcpy( text, line, rec->fCount );
+    text[ rec->fCount ] = 0;
+
+    bool wake = ( fUsed >= kWakeThreshold && fUsed - size < kWakeThreshold );
+    fQueueLock.Unlock();
+
+    if( !fRunning )
+        Flush( false );
+    else if( wake )
+        fWorkEvent.Signal();
+}
+
+// Steps head past any wrap and returns the record there, or false if the
+// ring is empty. Wrap waste is given back as it's skipped.
+bool    plStatusLogWriter::INextRecord( uint32_t &head, plStatusLogRecord *&rec )
+{
+    if( fUsed == 0 )
+        return false;
+
+    uint32_t left = kRingSize - head;
+    if( left < sizeof( plStatusLogRecord ) || IAt( head )->fType == plStatusLogRecord::kWrap )
+    {
+        fUsed -= left;
+        head = 0;
+        if( fUsed == 0 )
+            return false;
+    }
+
+    rec = IAt( head );
+    return true;
+}
+
+void    plStatusLogWriter::IWrite( plStatusLogRecord &rec )
+{
+    plStatusLog *log = rec.fLog;
+
+    if( rec.fType == plStatusLogRecord::kCloseFile )
+    {
+        log->ICloseFile();
+        fDirty.RemoveItem( log );
+        return;
+    }
+
+    log->IPrintLineToFile( rec );
+    if( fDirty.Find( log ) == fDirty.kMissingIndex )
+        fDirty.Append( log );
+}
+
+// Called with fDrainLock held. The queue lock is only held to look at the
+// indices, so producers keep filling the ring while we write.
+void    plStatusLogWriter::IDrain( void )
+{
+    for( ;; )
+    {
+        plStatusLogRecord *rec;
+        fQueueLock.Lock();
+        bool more = INextRecord( fHead, rec );
+        fQueueLock.Unlock();
+        if( !more )
+            break;
+
+        IWrite( *rec );
+
+        fQueueLock.Lock();
+        fHead = ( fHead + rec->fSize ) % kRingSize;
+        fUsed -= rec->fSize;
+        fQueueLock.Unlock();
+
+        fSpaceEvent.Signal();
+    }
+
+    int i;
+    for( i = 0; i < fDirty.GetCount(); i++ )
+    {
+        plStatusLog *log = fDirty[ i ];
+        if( log->fFileHandle != nil && !( log->fFlags & plStatusLog::kNonFlushedLog ) )
+            fflush( log->fFileHandle );
+    }
+    fDirty.SetCount( 0 );
+
+    plStatusLogMgr &mgr = plStatusLogMgr::GetInstance();
+    if( mgr.fBouncePending )
+        mgr.IBounceFiles();
+}
+
+// Crash path, when the writer hasn't let go of the drain lock in time. It
+// may be wedged, so go around it: no locks, and every file is flushed as
+// it's written since fDirty belongs to the writer.
+void    plStatusLogWriter::IDrainCrashing( void )
+{
+    plStatusLogRecord *rec;
+    while( INextRecord( fHead, rec ) )
+    {
+        plStatusLog *log = rec->fLog;
+        if( rec->fType == plStatusLogRecord::kCloseFile )
+            log->ICloseFile();
+        else
+        {
+            log->IPrintLineToFile( *rec );
+            if( log->fFileHandle != nil )
+                fflush( log->fFileHandle );
+        }
+
+        fHead = ( fHead + rec->fSize ) % kRingSize;
+        fUsed -= rec->fSize;
+    }
+}
+
+void    plStatusLogWriter::Flush( bool crashing )
+{
+    if( crashing )
+    {
+        double giveUp = hsTimer::GetSysSeconds() + kCrashWait / 1000.0;
+        while( !fDrainLock.TryLock() )
+        {
+            if( hsTimer::GetSysSeconds() > giveUp )
+            {
+                IDrainCrashing();
+                return;
+            }
+            hsSleep::Sleep( 10 );
+        }
+    }
+    else
+        fDrainLock.Lock();
+
+    IDrain();
+
+    fDrainLock.Unlock();
+}
+
+hsError plStatusLogWriter::Run( void )
+{
+    while( !GetQuit() )
+    {
+        fWorkEvent.Wait( kFlushInterval );
+        Flush( false );
+    }
+    return hsOK;
+}
+
 //////////////////////////////////////////////////////////////////////////////
 //// plStatusLogMgr Stuff ////////////////////////////////////////////////////
 //////////////////////////////////////////////////////////////////////////////
@@ -88,6 +425,8 @@ plStatusLogMgr::plStatusLogMgr()
     fCurrDisplay = nil;
     fDrawer = nil;
     fLastLogChangeTime = 0;
+    fBouncePending = false;
+    fWriter = nil;
 
 #if HS_BUILD_FOR_WIN32
     SHGetSpecialFolderPathW(NULL, fBasePath, CSIDL_LOCAL_APPDATA, TRUE);
@@ -111,13 +450,18 @@ plStatusLogMgr::~plStatusLogMgr()
     // Unlink all the displays, but don't delete them; leave that to whomever owns them
     while( fDisplays != nil )
     {
+        fMutex.Lock();
         plStatusLog *log = fDisplays;
-
-        fDisplays->IUnlink();
+        log->IUnlink();
+        fMutex.Unlock();
 
         if( log->fFlags & plStatusLog::kDeleteForMe )
             delete log;
     }
+
+    // Should have been stopped before static teardown, but anything the
+    // surviving logs queued still goes out
+    StopWriter();
 }
 
 plStatusLogMgr  &plStatusLogMgr::GetInstance( void )
@@ -201,8 +545,10 @@ plStatusLog *plStatusLogMgr::CreateStatusLog( uint8_t numDisplayLines, const wch
 {
     IEnsurePathExists( fBasePath );
     plStatusLog *log = new plStatusLog( numDisplayLines, filename, flags );
+    log->fDisplayPointer = &fCurrDisplay;
 
     // Put the new log in its alphabetical position
+    hsTempMutexLock lock( fMutex );
     plStatusLog** nextLog = &fDisplays;
     while (*nextLog)
     {
@@ -212,8 +558,6 @@ plStatusLog *plStatusLogMgr::CreateStatusLog( uint8_t numDisplayLines, const wch
     }
     log->ILink(nextLog);
 
-    log->fDisplayPointer = &fCurrDisplay;
-
     return log;
 }
 
@@ -289,6 +633,7 @@ plStatusLog *plStatusLogMgr::FindLog( const char *filename, bool createIfNotFoun
 
 plStatusLog *plStatusLogMgr::FindLog( const wchar_t *filename, bool createIfNotFound )
 {
+    hsTempMutexLock lock( fMutex );
     plStatusLog *log = fDisplays;
 
     while( log != nil )
@@ -328,6 +673,7 @@ void plStatusLogMgr::SetBasePath( const wchar_t * path )
 
 void plStatusLogMgr::BounceLogs()
 {
+    hsTempMutexLock lock( fMutex );
     plStatusLog *log = fDisplays;
 
     while( log != nil )
@@ -338,6 +684,96 @@ void plStatusLogMgr::BounceLogs()
     }
 }
 
+//// IQueue /////////////////////////////////////////////////////////////////
+//  Hand a record to the writer, or write it on the spot if there isn't one
+//  (before StartWriter(), after StopWriter(), or in apps that never start it).
+
+void plStatusLogMgr::IQueue( plStatusLog *log, uint8_t type, const char *line, uint32_t count )
+{
+    hsTempMutexLock lock( fWriterLock );
+
+    if( fWriter != nil )
+    {
+        fWriter->Push( log, type, line, count );
+        return;
+    }
+
+    plStatusLogRecord rec;
+    rec.Set( log, type, line, count );
+    if( type == plStatusLogRecord::kCloseFile )
+        log->ICloseFile();
+    else
+    {
+        log->IPrintLineToFile( rec );
+        if( log->fFileHandle != nil && !( log->fFlags & plStatusLog::kNonFlushedLog ) )
+            fflush( log->fFileHandle );
+    }
+}
+
+//// StartWriter / StopWriter ////////////////////////////////////////////////
+
+void plStatusLogMgr::StartWriter( void )
+{
+    hsTempMutexLock lock( fWriterLock );
+    if( fWriter != nil )
+        return;
+
+    fWriter = new plStatusLogWriter;
+    fWriter->Start();
+}
+
+void plStatusLogMgr::StopWriter( void )
+{
+    hsTempMutexLock lock( fWriterLock );
+
+    // Stopping writes out whatever is still queued
+    delete fWriter;
+    fWriter = nil;
+}
+
+//// IBounceFiles /////////////////////////////////////////////////////////////
+//  A log outgrew kMaxFileSize. Called from the writer, so this only does the
+//  file side of BounceLogs(); the on-screen lines are left alone.
+//  The list lock is only tried: its owner may be stuck in IQueue waiting for
+//  us to make room in the ring. If it's busy we go again after the next batch.
+
+void plStatusLogMgr::IBounceFiles( void )
+{
+    if( !fMutex.TryLock() )
+    {
+        fBouncePending = true;
+        return;
+    }
+    fBouncePending = false;
+
+    plStatusLog *log = fDisplays;
+
+    while( log != nil )
+    {
+        log->IBounceFile();
+        log = log->fNext;
+    }
+
+    fMutex.Unlock();
+}
+
+//// Flush ////////////////////////////////////////////////////////////////////
+
+void plStatusLogMgr::Flush( bool crashing )
+{
+    // When crashing, whoever holds the writer lock may never let it go
+    if( crashing )
+    {
+        if( fWriter != nil )
+            fWriter->Flush( true );
+        return;
+    }
+
+    hsTempMutexLock lock( fWriterLock );
+    if( fWriter != nil )
+        fWriter->Flush( false );
+}
+
 //// DumpLogs ////////////////////////////////////////////////////////////////
 
 bool plStatusLogMgr::DumpLogs( const char *newFolderName )
@@ -411,6 +847,7 @@ plStatusLog::plStatusLog( uint8_t numDisplayLines, const wchar_t *filename, uint
     fSema = nil;
     fSize = 0;
     fForceLog = false;
+    fDisplayPointer = nil;
 
     fMaxNumLines = numDisplayLines;
     if( filename != nil )
@@ -447,11 +884,12 @@ void    plStatusLog::IInit()
 
     fFlags = fOrigFlags;
 
-    fLines = new char *[ fMaxNumLines ];
+    fLines = new char[ fMaxNumLines * kMaxDisplayLineLen ];
     fColors = new uint32_t[ fMaxNumLines ];
+    fFirstLine = 0;
     for( i = 0; i < fMaxNumLines; i++ )
     {
-        fLines[ i ] = nil;
+        fLines[ i * kMaxDisplayLineLen ] = 0;
         fColors[ i ] = kWhite;
     }
 
@@ -511,22 +949,20 @@ bool plStatusLog::IReOpen( void )
 
 void    plStatusLog::IFini( void )
 {
-    int     i;
+    // Make sure nothing of ours is still sitting in the writer's queue
+    plStatusLogMgr &mgr = plStatusLogMgr::GetInstance();
+    mgr.Flush();
 
-    if( fFileHandle != nil )
-    {
-        fclose( fFileHandle );
-        fFileHandle = nil;
-    }
-
-    if( *fDisplayPointer == this )
+    if( fDisplayPointer != nil && *fDisplayPointer == this )
         *fDisplayPointer = nil;
 
+    // Off the list before the file goes, so a bounce on the writer can't find us
+    mgr.fMutex.Lock();
     if( fBack != nil || fNext != nil )
         IUnlink();
+    mgr.fMutex.Unlock();
 
-    for( i = 0; i < fMaxNumLines; i++ )
-        delete [] fLines[ i ];
+    ICloseFile();
 
     if (fSema)
         delete fSema;
@@ -590,67 +1026,61 @@ void    plStatusLog::ILink( plStatusLog **back )
 }
 
 //// IAddLine ////////////////////////////////////////////////////////////////
-//  Actually add a stinking line.
+//  Actually add a stinking line. The display buffer is circular, so this
+//  overwrites the oldest line in place; file output is queued under the
+//  same lock so the file sees lines in the same order as the screen.
 
 bool plStatusLog::IAddLine( const char *line, int32_t count, uint32_t color )
 {
-    int     i;
-
     if(fLoggingOff && !fForceLog)
         return true;
 
-    /// Scroll pointers up
-    fSema->Wait();
+    if( line == nil )
+        count = 0;
+    else if( count < 0 )
+        count = strlen( line );
 
-    bool ret = true;
+    const char *c = count > 0 ? (const char *)memchr( line, '\n', count ) : nil;
+    if( c != nil )
+        count = c - line;
+
+    fSema->Wait();
 
     if (fMaxNumLines > 0)
     {
-        delete [] fLines[ 0 ];
-        for( i = 0; i < fMaxNumLines - 1; i++ )
-        {
-            fLines[ i ] = fLines[ i + 1 ];
-            fColors[ i ] = fColors[ i + 1 ];
-        }
+        char *dst = fLines + fFirstLine * kMaxDisplayLineLen;
+        int32_t len = count < kMaxDisplayLineLen - 1 ? count : kMaxDisplayLineLen - 1;
+        if( len > 0 )
+            memcpy( dst, line, len );
+        dst[ len ] = 0;
+
+        fColors[ fFirstLine ] = count > 0 ? color : 0;
+        fFirstLine = ( fFirstLine + 1 ) % fMaxNumLines;
     }
 
-    /// Add new
-    if( line == nil || strlen( line ) == 0 )
+    if( !( fFlags & kDontWriteFile ) )
     {
-        if (fMaxNumLines > 0)
-        {
-            fColors[ i ] = 0;
-            fLines[ i ] = nil;
-        }
-        ret = IPrintLineToFile( "", 0 );
+        IEchoLine( count > 0 ? line : "", count );
+        plStatusLogMgr::GetInstance().IQueue( this, plStatusLogRecord::kLine, count > 0 ? line : "", count );
     }
-    else
-    {
-        if( count < 0 )
-            count = strlen( line );
-
-        if (fMaxNumLines > 0)
-        {
-            fLines[ i ] = new char[ count + 1 ];
-            hsStrncpy( fLines[ i ], line, count + 1 );
-            fLines[ i ][ count ] = 0;
 
-            char *c = strchr( fLines[ i ], '\n' );
-            if( c != nil )
-            {
-                *c = 0;
-                count--;
-            }
+    fSema->Signal();
 
-            fColors[ i ] = color;
-        }
+    return true;
+}
 
-        ret = IPrintLineToFile( line, count );
-    }
+//// IGetDisplayLine /////////////////////////////////////////////////////////
+//  Display lines oldest first, nil for empty ones.
 
-    fSema->Signal();
+const char *plStatusLog::IGetDisplayLine( uint32_t i ) const
+{
+    const char *line = fLines + ( ( fFirstLine + i ) % fMaxNumLines ) * kMaxDisplayLineLen;
+    return *line ? line : nil;
+}
 
-    return ret;
+uint32_t plStatusLog::IGetDisplayColor( uint32_t i ) const
+{
+    return fColors[ ( fFirstLine + i ) % fMaxNumLines ];
 }
 
 //// AddLine /////////////////////////////////////////////////////////////////
@@ -751,12 +1181,11 @@ void    plStatusLog::Clear( void )
 {
     int     i;
 
-
+    fSema->Wait();
     for( i = 0; i < fMaxNumLines; i++ )
-    {
-        delete [] fLines[ i ];
-        fLines[ i ] = nil;
-    }
+        fLines[ i * kMaxDisplayLineLen ] = 0;
+    fFirstLine = 0;
+    fSema->Signal();
 }
 
 
@@ -767,18 +1196,44 @@ void    plStatusLog::Bounce( uint32_t flags)
     if (flags)
         fOrigFlags=flags;
     Clear();
+    plStatusLogMgr::GetInstance().IQueue( this, plStatusLogRecord::kCloseFile, "", 0 );
+    AddLine( "--------- Bounced Log ---------" );
+}
+
+//// ICloseFile //////////////////////////////////////////////////////////////
+//  Writer side only. The next line written reopens (and rotates) the file.
+
+void    plStatusLog::ICloseFile( void )
+{
     if( fFileHandle != nil )
     {
         fclose( fFileHandle );
         fFileHandle = nil;
     }
-    AddLine( "--------- Bounced Log ---------" );
+}
+
+//// IBounceFile /////////////////////////////////////////////////////////////
+
+void    plStatusLog::IBounceFile( void )
+{
+    if( fFlags & kDontWriteFile )
+        return;
+
+    ICloseFile();
+
+    static const char kBounced[] = "--------- Bounced Log ---------";
+    plStatusLogRecord rec;
+    rec.Set( this, plStatusLogRecord::kLine, kBounced, sizeof( kBounced ) - 1 );
+    IPrintLineToFile( rec );
 }
 
 //// IPrintLineToFile ////////////////////////////////////////////////////////
 
-bool plStatusLog::IPrintLineToFile( const char *line, uint32_t count )
+bool plStatusLog::IPrintLineToFile( const plStatusLogRecord &rec )
 {
+    const char *line = rec.fLine;
+    uint32_t count = rec.fCount;
+
     if( fFlags & kDontWriteFile )
         return true;
 
@@ -807,32 +1262,34 @@ bool plStatusLog::IPrintLineToFile( const char *line, uint32_t count )
         {
             if ( fFlags & kTimestamp )
             {
-                snprintf(work, arrsize(work), "(%s) ", plUnifiedTime(kNow).Format("%m/%d %H:%M:%S").c_str());
+                snprintf(work, arrsize(work), "(%s) ", rec.fTime.Format("%m/%d %H:%M:%S").c_str());
                 strncat(buf, work, arrsize(work));
             }
             if ( fFlags & kTimestampGMT )
             {
-                snprintf(work, arrsize(work), "(%s) ", plUnifiedTime::GetCurrentTime().Format("%m/%d %H:%M:%S UTC").c_str());
+                plUnifiedTime gmt = rec.fTime;
+                gmt.SetMode( plUnifiedTime::kGmt );
+                snprintf(work, arrsize(work), "(%s) ", gmt.Format("%m/%d %H:%M:%S UTC").c_str());
                 strncat(buf, work, arrsize(work));
             }
             if ( fFlags & kTimeInSeconds )
             {
-                snprintf(work, arrsize(work), "(%lu) ", (unsigned long)plUnifiedTime(kNow).GetSecs());
+                snprintf(work, arrsize(work), "(%lu) ", (unsigned long)rec.fTime.GetSecs());
                 strncat(buf, work, arrsize(work));
             }
             if ( fFlags & kTimeAsDouble )
             {
-                snprintf(work, arrsize(work), "(%f) ", plUnifiedTime(kNow).GetSecsDouble());
+                snprintf(work, arrsize(work), "(%f) ", rec.fTime.GetSecsDouble());
                 strncat(buf, work, arrsize(work));
             }
             if (fFlags & kRawTimeStamp)
             {
-                snprintf(work, arrsize(work), "[t=%10f] ", hsTimer::GetSeconds());
+                snprintf(work, arrsize(work), "[t=%10f] ", rec.fRawTime);
                 strncat(buf, work, arrsize(work));
             }
             if (fFlags & kThreadID)
             {
-                snprintf(work, arrsize(work), "[t=%lu] ", hsThread::GetMyThreadId());
+                snprintf(work, arrsize(work), "[t=%lu] ", (unsigned long)rec.fThreadId);
                 strncat(buf, work, arrsize(work));
             }
 
@@ -854,21 +1311,28 @@ bool plStatusLog::IPrintLineToFile( const char *line, uint32_t count )
             err = fwrite(buf,1,length,fFileHandle);
             ret = ( ferror( fFileHandle )==0 );
 
+            // Flushing is left to the writer, once per batch
             if ( ret )
-            {
                 fSize += err;
-                if (!(fFlags & kNonFlushedLog))
-                    fflush(fFileHandle);
-            }
         }
 
         if ( fSize>=kMaxFileSize )
         {
-            plStatusLogMgr::GetInstance().BounceLogs();
+            plStatusLogMgr::GetInstance().IBounceFiles();
         }
 
     }
 
+    return ret;
+}
+
+//// IEchoLine ///////////////////////////////////////////////////////////////
+//  Debug window and stdout copies go out right away on the logging thread,
+//  not through the writer, so they still interleave with everything else
+//  the process prints there.
+
+void    plStatusLog::IEchoLine( const char *line, uint32_t count )
+{
     if ( fFlags & kDebugOutput )
     {
 #if HS_BUILD_FOR_WIN32
@@ -886,7 +1350,5 @@ bool plStatusLog::IPrintLineToFile( const char *line, uint32_t count )
     {
         fprintf( stdout, "%.*s\n", count, line );
     }
-
-    return ret;
 }
 
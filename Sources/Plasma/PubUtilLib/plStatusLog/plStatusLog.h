@@ -70,14 +70,22 @@ class plPipeline;
 class plStatusLogMgr;
 class hsMutex;
 class plStatusLogDrawerStub;
+class plStatusLogRecord;
+class plStatusLogWriter;
 class plStatusLog
 {
     friend class plStatusLogMgr;
     friend class plStatusLogDrawerStub;
     friend class plStatusLogDrawer;
+    friend class plStatusLogWriter;
+    friend class plStatusLogRecord;
     
     protected:
 
+        enum
+        {
+            kMaxDisplayLineLen  = 256   // Longer lines are clipped on screen, not in the file
+        };
 
         mutable uint32_t      fFlags;     // Mutable so we can change it in IPrintLineToFile() internally
         uint32_t  fOrigFlags;
@@ -85,8 +93,9 @@ class plStatusLog
         uint32_t     fMaxNumLines;
         std::string  fCFilename; // used ONLY by GetFileName()
         std::wstring fFilename;
-        char**       fLines;
+        char*        fLines;        // fMaxNumLines * kMaxDisplayLineLen, circular
         uint32_t*    fColors;
+        uint32_t     fFirstLine;    // Oldest line in fLines
         hsSemaphore* fSema;
         FILE*        fFileHandle;
         uint32_t     fSize;
@@ -100,7 +109,13 @@ class plStatusLog
         void    ILink( plStatusLog **back );
 
         bool    IAddLine( const char *line, int32_t count, uint32_t color );
-        bool    IPrintLineToFile( const char *line, uint32_t count );
+        bool    IPrintLineToFile( const plStatusLogRecord &rec );
+        void    ICloseFile( void );
+        void    IBounceFile( void );
+        void    IEchoLine( const char *line, uint32_t count );
+
+        const char  *IGetDisplayLine( uint32_t i ) const;
+        uint32_t    IGetDisplayColor( uint32_t i ) const;
         void    IParseFileName(wchar_t* file, size_t fnsize, wchar_t* fileNoExt, wchar_t** ext) const;
 
         void    IInit( void );
@@ -158,6 +173,9 @@ class plStatusLog
 
         ~plStatusLog();
 
+        /// Lines go into the on-screen buffer immediately; file (and debug/stdout)
+        /// output is queued for the log writer thread, so the return value only
+        /// reflects whether the line was accepted, not whether it hit the disk.
         bool    AddLine( const char *line, uint32_t color = kWhite );
 
         /// printf-like functions
@@ -190,6 +208,7 @@ class plStatusLog
 class plStatusLogMgr
 {
     friend class plStatusLog;
+    friend class plStatusLogWriter;
 
     private:
 
@@ -203,6 +222,8 @@ class plStatusLogMgr
 
         plStatusLogDrawerStub   *fDrawer;
 
+        plStatusLogWriter       *fWriter;
+
         double fLastLogChangeTime;
 
         static wchar_t            fBasePath[];
@@ -212,7 +233,12 @@ class plStatusLogMgr
         void    IEnsurePathExists( const wchar_t *dirName );
         void    IPathAppend( wchar_t *base, const wchar_t *extra, unsigned maxLen );
 
-        hsMutex     fMutex;     // To make multithreaded-safe
+        void    IQueue( plStatusLog *log, uint8_t type, const char *line, uint32_t count );
+        void    IBounceFiles( void );
+
+        hsMutex     fMutex;     // Guards the fDisplays list, the writer walks it too
+        hsMutex     fWriterLock;    // Guards fWriter being started and stopped
+        bool        fBouncePending; // Writer side only, see IBounceFiles()
 
     public:
 
@@ -243,6 +269,16 @@ class plStatusLogMgr
 
         void        BounceLogs();
 
+        // The background file writer. Until it's started (and after it's
+        // stopped) lines are written to the files as they're logged. Stop it
+        // before static teardown so the thread isn't left to the CRT.
+        void        StartWriter( void );
+        void        StopWriter( void );
+
+        // Write out everything queued for the log files and flush them. With
+        // crashing set, waits briefly for a busy writer, then writes around it.
+        void        Flush( bool crashing = false );
+
         // Create a new folder and copy all log files into it (returns false on failure)
         bool        DumpLogs( const char *newFolderName );
         bool        DumpLogs( const wchar_t *newFolderName );
@@ -260,10 +296,10 @@ class plStatusLogDrawerStub
     protected:
 
         uint32_t      IGetMaxNumLines( plStatusLog *log ) const { return log->fMaxNumLines; }
-        char        **IGetLines( plStatusLog *log ) const { return log->fLines; }
+        const char  *IGetLine( plStatusLog *log, uint32_t i ) const { return log->IGetDisplayLine( i ); }
         const char  *IGetFilename( plStatusLog *log ) const { return log->GetFileName(); }
         const wchar_t *IGetFilenameW( plStatusLog *log ) const { return log->GetFileNameW(); }
-        uint32_t      *IGetColors( plStatusLog *log ) const { return log->fColors; }
+        uint32_t      IGetColor( plStatusLog *log, uint32_t i ) const { return log->IGetDisplayColor( i ); }
         uint32_t      IGetFlags( plStatusLog *log ) const { return log->fFlags; }
         
     public:
@@ -111,6 +111,9 @@ class hsReadOnlyLoggingStream : public hsReadOnlyStream, public plStreamLogger
 private:
 
 public:
+    // Every read has to come through Read to get logged, so no read window
+    virtual void Init(int size, const void* data) { hsReadOnlyStream::Init(size, data); fReadWindowEnd = fStart; }
+
     void    Rewind();
     void    FastFwd();
     void    SetPosition(uint32_t position);